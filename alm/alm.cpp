@@ -81,6 +81,11 @@ void ALM::set_print_symmetry(const int printsymmetry) const // PRINTSYM
     symmetry->set_print_symmetry(printsymmetry);
 }
 
+void ALM::set_symmetry_cache(const int use_symmetry_cache) const // SYMCACHE
+{
+    symmetry->set_use_symmetry_cache(use_symmetry_cache);
+}
+
 void ALM::set_datfile_train(const DispForceFile &dat_in) const
 {
     files->set_datfile_train(dat_in);
@@ -101,6 +106,12 @@ void ALM::set_displacement_param(const bool trim_dispsign_for_evenfunc) const //
     displace->set_trim_dispsign_for_evenfunc(trim_dispsign_for_evenfunc);
 }
 
+void ALM::set_random_pattern_params(const int nrandom,
+                                    const int random_seed) const // NRANDOM, RANDOM_SEED
+{
+    displace->set_random_pattern_params(nrandom, random_seed);
+}
+
 void ALM::set_displacement_basis(const std::string str_disp_basis) const // DBASIS
 {
     displace->set_disp_basis(str_disp_basis);
@@ -141,6 +152,12 @@ void ALM::set_u_train(const std::vector<std::vector<double>> &u) const
     optimize->set_u_train(u);
 }
 
+void ALM::append_training_data(const std::vector<std::vector<double>> &u,
+                               const std::vector<std::vector<double>> &f) const
+{
+    optimize->append_training_data(u, f);
+}
+
 void ALM::set_f_train(const std::vector<std::vector<double>> &f) const
 {
     optimize->set_f_train(f);
@@ -651,8 +668,8 @@ void ALM::get_matrix_elements(double *amat,
     optimize->get_matrix_elements_algebraic_constraint(maxorder,
                                                        amat_vec,
                                                        bvec_vec,
-                                                       optimize->get_u_train(),
-                                                       optimize->get_f_train(),
+                                                       optimize->get_u_train_matrix(),
+                                                       optimize->get_f_train_matrix(),
                                                        fnorm,
                                                        symmetry,
                                                        fcs,
@@ -716,6 +733,41 @@ int ALM::run_optimize()
     return info;
 }
 
+int ALM::run_optimize_incremental()
+{
+    if (!structure_initialized) {
+        std::cout << "initialize_structure must be called beforehand." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (!initialized_constraint_class) {
+        constraint->setup(system,
+                          fcs,
+                          cluster,
+                          symmetry,
+                          get_optimizer_control().linear_model,
+                          get_optimizer_control().mirror_image_conv,
+                          verbosity,
+                          timer);
+        initialized_constraint_class = true;
+    }
+    if (!ready_all_constraints()) {
+        constraint->update_constraint_matrix(system,
+                                             symmetry,
+                                             cluster,
+                                             fcs,
+                                             verbosity,
+                                             get_optimizer_control().mirror_image_conv);
+    }
+
+    return optimize->fit_incremental(cluster->get_maxorder(),
+                                     writer->get_output_maxorder(),
+                                     symmetry,
+                                     fcs,
+                                     constraint,
+                                     verbosity);
+}
+
 void ALM::run_suggest()
 {
     displace->gen_displacement_pattern(cluster,
@@ -772,6 +824,17 @@ void ALM::save_fc(const std::string filename,
                                           verbosity);
 }
 
+void ALM::get_fcs_arrays(FcsArrays &arrays,
+                         const int maxorder_to_save) const
+{
+    writer->set_output_maxorder(maxorder_to_save);
+    writer->get_fcs_arrays(system,
+                           symmetry,
+                           cluster,
+                           fcs,
+                           arrays);
+}
+
 void ALM::set_fcs_save_flag(const std::string fcs_format, const int val) const
 {
     writer->set_fcs_save_flag(fcs_format, val);
@@ -57,6 +57,8 @@ public:
 
     void set_print_symmetry(int printsymmetry) const;
 
+    void set_symmetry_cache(int use_symmetry_cache) const;
+
     void set_datfile_train(const DispForceFile &dat_in) const;
 
     void set_datfile_validation(const DispForceFile &dat_in) const;
@@ -65,6 +67,9 @@ public:
 
     void set_displacement_param(bool trim_dispsign_for_evenfunc) const;
 
+    void set_random_pattern_params(int nrandom,
+                                   int random_seed) const;
+
     void set_displacement_basis(std::string str_disp_basis) const;
 
     void set_periodicity(const int is_periodic[3]) const;
@@ -86,6 +91,9 @@ public:
 
     void set_f_train(const std::vector<std::vector<double>> &f) const;
 
+    void append_training_data(const std::vector<std::vector<double>> &u,
+                              const std::vector<std::vector<double>> &f) const;
+
     void set_validation_data(const std::vector<std::vector<double>> &u,
                              const std::vector<std::vector<double>> &f) const;
 
@@ -197,6 +205,10 @@ public:
 
     int run_optimize();
 
+    // Refit using the cached normal equations, incorporating only the
+    // configurations added via append_training_data since the last fit.
+    int run_optimize_incremental();
+
     void run_suggest();
 
     void init_fc_table();
@@ -205,6 +217,13 @@ public:
                  const std::string fc_format,
                  const int maxorder_to_save) const;
 
+    // Export the fitted force constants into the in-memory container
+    // shared with ANPHON (fcs_binary.h), so a driver running both codes
+    // in one process can hand them to Fcs_phonon::set_fcs_from_arrays
+    // without writing and re-parsing an FCSXML file.
+    void get_fcs_arrays(FcsArrays &arrays,
+                        const int maxorder_to_save) const;
+
     void set_fcs_save_flag(const std::string fcs_format, const int val) const;
 
     int get_fcs_save_flag(const std::string fcs_format) const;
@@ -57,7 +57,7 @@ void Cluster::init(const System *system,
     if (distall) {
         deallocate(distall);
     }
-    allocate(distall, nat, nat);
+    allocate(distall, symmetry->get_nat_prim(), nat);
 
     if (mindist_pairs) {
         deallocate(mindist_pairs);
@@ -98,6 +98,9 @@ void Cluster::init(const System *system,
     }
 
     get_pairs_of_minimum_distance(nat,
+                                  symmetry->get_nat_prim(),
+                                  nkd,
+                                  symmetry->get_map_p2s(),
                                   system->get_x_image(),
                                   system->get_exist_image());
 
@@ -578,47 +581,186 @@ double Cluster::distance(const double *x1,
 }
 
 void Cluster::get_pairs_of_minimum_distance(const size_t nat,
+                                            const size_t natmin,
+                                            const size_t nkd,
+                                            const std::vector<std::vector<int>> &map_p2s,
                                             const double *const *const *xc_in,
                                             const int *exist) const
 {
-    size_t i, j;
-    double vec[3];
+    size_t i, j, k;
+
+    // The tolerance below (1.e-3) should be chosen so that
+    // the mirror images with equal distances are found correctly.
+    // If this fails, the phonon dispersion would be incorrect.
+    const auto tol_image = 1.0e-3;
+
+    // Exhaustive image scan for the rows centered on the primitive-cell
+    // atoms. These rows feed the neighbor list, the cutoff-based pair
+    // selection, and the cluster enumeration, and they must be complete
+    // because the cutoff radii may be 'None' (negative, i.e. unbounded).
+
+#ifdef _OPENMP
+#pragma omp parallel for private(j, k)
+#endif
+    for (long ii = 0; ii < natmin; ++ii) {
+
+        const auto iat = map_p2s[ii][0];
+        double vec[3];
 
-    for (i = 0; i < nat; ++i) {
         for (j = 0; j < nat; ++j) {
 
-            distall[i][j].clear();
+            distall[ii][j].clear();
 
             for (auto icell = 0; icell < 27; ++icell) {
 
                 if (exist[icell]) {
 
-                    const auto dist_tmp = distance(xc_in[0][i], xc_in[icell][j]);
+                    const auto dist_tmp = distance(xc_in[0][iat], xc_in[icell][j]);
 
-                    for (auto k = 0; k < 3; ++k) vec[k] = xc_in[icell][j][k] - xc_in[0][i][k];
+                    for (k = 0; k < 3; ++k) vec[k] = xc_in[icell][j][k] - xc_in[0][iat][k];
 
-                    distall[i][j].emplace_back(DistInfo(icell, dist_tmp, vec));
+                    distall[ii][j].emplace_back(DistInfo(icell, dist_tmp, vec));
                 }
             }
-            std::sort(distall[i][j].begin(), distall[i][j].end());
+            std::sort(distall[ii][j].begin(), distall[ii][j].end());
+
+            mindist_pairs[iat][j].clear();
+
+            const auto dist_min = distall[ii][j][0].dist;
+            for (auto it = distall[ii][j].cbegin(); it != distall[ii][j].cend(); ++it) {
+                if (std::abs((*it).dist - dist_min) < tol_image) {
+                    mindist_pairs[iat][j].emplace_back(DistInfo(*it));
+                }
+            }
+        }
+    }
+
+    // The remaining pairs (both atoms outside the primitive cell) are only
+    // consulted by is_incutoff, and there only when a finite cutoff radius
+    // is defined. Instead of the former all-pairs scan over every mirror
+    // image, bin the atoms of all existing images into a linked-cell grid
+    // whose spacing is the largest finite cutoff radius, so each atom only
+    // visits candidates inside its cutoff sphere. Pairs farther apart than
+    // every finite cutoff are left empty and treated as out of range.
+
+    auto rc_max = -1.0;
+    for (auto order = 0; order < maxorder; ++order) {
+        for (i = 0; i < nkd; ++i) {
+            for (j = 0; j < nkd; ++j) {
+                rc_max = std::max(rc_max, cutoff_radii[order][i][j]);
+            }
+        }
+    }
+    if (rc_max < 0.0) return;
+
+    const auto rc_search = rc_max + tol_image;
+
+    std::vector<bool> is_prim(nat, false);
+    for (i = 0; i < natmin; ++i) is_prim[map_p2s[i][0]] = true;
+
+    // Bounding box of the atoms of all existing mirror images.
+
+    double xmin[3], xmax[3];
+    for (k = 0; k < 3; ++k) {
+        xmin[k] = xc_in[0][0][k];
+        xmax[k] = xc_in[0][0][k];
+    }
+    for (auto icell = 0; icell < 27; ++icell) {
+        if (!exist[icell]) continue;
+        for (j = 0; j < nat; ++j) {
+            for (k = 0; k < 3; ++k) {
+                xmin[k] = std::min(xmin[k], xc_in[icell][j][k]);
+                xmax[k] = std::max(xmax[k], xc_in[icell][j][k]);
+            }
         }
     }
 
-    // Construct pairs of minimum distance.
+    int nbin[3];
+    double binwidth[3];
+    for (k = 0; k < 3; ++k) {
+        const auto extent = xmax[k] - xmin[k];
+        nbin[k] = std::max(1, static_cast<int>(extent / rc_search));
+        binwidth[k] = extent / static_cast<double>(nbin[k]);
+    }
+
+    auto get_bin_index = [&](const double *x) {
+        int ib[3];
+        for (auto kk = 0; kk < 3; ++kk) {
+            ib[kk] = (binwidth[kk] > 0.0)
+                     ? static_cast<int>((x[kk] - xmin[kk]) / binwidth[kk]) : 0;
+            ib[kk] = std::max(0, std::min(nbin[kk] - 1, ib[kk]));
+        }
+        return (ib[0] * nbin[1] + ib[1]) * nbin[2] + ib[2];
+    };
+
+    std::vector<std::vector<std::pair<int, size_t>>> bins(nbin[0] * nbin[1] * nbin[2]);
 
-    for (i = 0; i < nat; ++i) {
+    for (auto icell = 0; icell < 27; ++icell) {
+        if (!exist[icell]) continue;
         for (j = 0; j < nat; ++j) {
-            mindist_pairs[i][j].clear();
-
-            const auto dist_min = distall[i][j][0].dist;
-            for (auto it = distall[i][j].cbegin(); it != distall[i][j].cend(); ++it) {
-                // The tolerance below (1.e-3) should be chosen so that
-                // the mirror images with equal distances are found correctly.
-                // If this fails, the phonon dispersion would be incorrect.
-                if (std::abs((*it).dist - dist_min) < 1.0e-3) {
-                    mindist_pairs[i][j].emplace_back(DistInfo(*it));
+            bins[get_bin_index(xc_in[icell][j])].emplace_back(icell, j);
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for private(j, k)
+#endif
+    for (long iat = 0; iat < nat; ++iat) {
+
+        if (is_prim[iat]) continue;
+
+        std::vector<std::pair<size_t, DistInfo>> candidates;
+        double vec[3];
+
+        int ib[3];
+        for (k = 0; k < 3; ++k) {
+            ib[k] = (binwidth[k] > 0.0)
+                    ? static_cast<int>((xc_in[0][iat][k] - xmin[k]) / binwidth[k]) : 0;
+            ib[k] = std::max(0, std::min(nbin[k] - 1, ib[k]));
+        }
+
+        for (auto ix = std::max(0, ib[0] - 1); ix <= std::min(nbin[0] - 1, ib[0] + 1); ++ix) {
+            for (auto iy = std::max(0, ib[1] - 1); iy <= std::min(nbin[1] - 1, ib[1] + 1); ++iy) {
+                for (auto iz = std::max(0, ib[2] - 1); iz <= std::min(nbin[2] - 1, ib[2] + 1); ++iz) {
+
+                    for (const auto &entry: bins[(ix * nbin[1] + iy) * nbin[2] + iz]) {
+
+                        const auto icell = entry.first;
+                        const auto jat = entry.second;
+
+                        const auto dist_tmp = distance(xc_in[0][iat], xc_in[icell][jat]);
+                        if (dist_tmp > rc_search + tol_image) continue;
+
+                        for (k = 0; k < 3; ++k) vec[k] = xc_in[icell][jat][k] - xc_in[0][iat][k];
+
+                        candidates.emplace_back(jat, DistInfo(icell, dist_tmp, vec));
+                    }
+                }
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const std::pair<size_t, DistInfo> &a,
+                     const std::pair<size_t, DistInfo> &b) {
+                      if (a.first != b.first) return a.first < b.first;
+                      return a.second.dist < b.second.dist;
+                  });
+
+        size_t ic = 0;
+        while (ic < candidates.size()) {
+            const auto jat = candidates[ic].first;
+            const auto dist_min = candidates[ic].second.dist;
+
+            mindist_pairs[iat][jat].clear();
+
+            if (dist_min <= rc_search) {
+                for (j = ic; j < candidates.size() && candidates[j].first == jat; ++j) {
+                    if (std::abs(candidates[j].second.dist - dist_min) < tol_image) {
+                        mindist_pairs[iat][jat].emplace_back(candidates[j].second);
+                    }
                 }
             }
+            while (ic < candidates.size() && candidates[ic].first == jat) ++ic;
         }
     }
 }
@@ -934,8 +1076,11 @@ bool Cluster::is_incutoff(const int n,
 
             const auto cutoff_tmp = cutoff_radii[order][ikd][jkd];
 
+            // Pairs not filled by the cell-list search are farther apart
+            // than the largest finite cutoff radius.
             if (cutoff_tmp >= 0.0 &&
-                (mindist_pairs[iat][jat][0].dist > cutoff_tmp)) {
+                (mindist_pairs[iat][jat].empty() ||
+                 mindist_pairs[iat][jat][0].dist > cutoff_tmp)) {
                 return false;
             }
 
@@ -1134,7 +1279,7 @@ void Cluster::set_interaction_cluster(const int order,
                     // as a candidate for the cluster.
                     // The mirror images whose distance is larger than the minimum value
                     // of the distance(iat, jat) can be added to the cell_vector list.
-                    for (const auto &it: distall[iat][jat]) {
+                    for (const auto &it: distall[i][jat]) {
                         if (exist[it.cell]) {
                             if (rc_tmp < 0.0 || it.dist <= rc_tmp) {
                                 cell_vector.push_back(it.cell);
@@ -304,8 +304,11 @@ private:
     std::vector<int> **interaction_pair; // List of atoms inside the cutoff radius for each order
     std::set<InteractionCluster> **interaction_cluster;
 
-    std::vector<DistInfo> **distall;       // Distance of all pairs (i,j) under the PBC
-    std::vector<DistInfo> **mindist_pairs; // All pairs (i,j) with the minimum distance
+    std::vector<DistInfo> **distall;       // Distances of pairs (i,j) under the PBC,
+    // stored only for atoms i in the primitive cell (indexed by primitive atom)
+    std::vector<DistInfo> **mindist_pairs; // All pairs (i,j) with the minimum distance.
+    // Rows of atoms outside the primitive cell only hold the pairs within the
+    // largest finite cutoff radius; empty entries mean "out of range".
     // Interacting many-body clusters with mirrow image information
 
     void set_default_variables();
@@ -315,6 +318,9 @@ private:
     // can be made const function, but mindist_pairs is modified
     // in this function.
     void get_pairs_of_minimum_distance(const size_t nat,
+                                       const size_t natmin,
+                                       const size_t nkd,
+                                       const std::vector<std::vector<int>> &map_p2s,
                                        const double *const *const *xc_in,
                                        const int *exist) const;
 
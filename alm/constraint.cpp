@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <unordered_set>
 #include <map>
+#include <tuple>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/foreach.hpp>
@@ -346,35 +347,12 @@ void Constraint::update_constraint_matrix(const System *system,
 
     if (!constraint_algebraic) {
 
-        size_t Pmax = 0;
         size_t nparams = 0;
-        for (auto order = 0; order < maxorder; ++order) {
-            Pmax += const_self[order].size()
-                    + const_rotation_cross[order].size();
-        }
-        if (fix_harmonic) {
-            Pmax -= const_self[0].size();
-            Pmax += fcs->get_nequiv()[0].size();
-        }
-        if (fix_cubic) {
-            Pmax -= const_self[1].size();
-            Pmax += fcs->get_nequiv()[1].size();
-        }
         for (auto order = 0; order < maxorder; ++order) {
             nparams += fcs->get_nequiv()[order].size();
         }
 
-        if (const_mat) {
-            deallocate(const_mat);
-        }
-        allocate(const_mat, Pmax, nparams);
-
-        if (const_rhs) {
-            deallocate(const_rhs);
-        }
-        allocate(const_rhs, Pmax);
-
-        // const_mat and const_rhs are updated.
+        // const_mat and const_rhs are allocated and updated.
         number_of_constraints = calc_constraint_matrix(maxorder,
                                                        fcs->get_nequiv(),
                                                        nparams);
@@ -493,27 +471,30 @@ void Constraint::print_constraint_information(const Cluster *cluster) const
 
 size_t Constraint::calc_constraint_matrix(const int maxorder,
                                           const std::vector<size_t> *nequiv,
-                                          const size_t nparams) const
+                                          const size_t nparams)
 {
     size_t i, j;
     int order;
-    double *arr_tmp;
-    std::vector<ConstraintClass> const_total;
 
-    const_total.clear();
-    allocate(arr_tmp, nparams);
+    // The constraint rows are kept in sparse form with the column indices
+    // shifted to the global parameter numbering. The redundancy removal
+    // then runs on the sparse rows directly, and the dense matrix handed
+    // to the solver is only allocated with its final number of rows.
+
+    ConstraintSparseForm const_total;
+    MapConstraintElement row_tmp;
 
     size_t nshift = 0;
 
     for (order = 0; order < maxorder; ++order) {
         const auto nelems = nequiv[order].size();
         if (const_fix[order].empty()) {
-            for (auto &p: const_self[order]) {
-                for (i = 0; i < nparams; ++i) arr_tmp[i] = 0.0;
+            for (const auto &p: const_self[order]) {
+                row_tmp.clear();
                 for (const auto &it: p) {
-                    arr_tmp[nshift + it.first] = it.second;
+                    row_tmp.emplace(nshift + it.first, it.second);
                 }
-                const_total.emplace_back(nparams, arr_tmp);
+                const_total.emplace_back(row_tmp);
             }
         }
         nshift += nelems;
@@ -526,28 +507,40 @@ size_t Constraint::calc_constraint_matrix(const int maxorder,
     for (order = 0; order < maxorder; ++order) {
         if (order > 0) {
             if (const_fix[order - 1].empty() && const_fix[order].empty()) {
-                for (auto &p: const_rotation_cross[order]) {
-                    for (i = 0; i < nparams; ++i) arr_tmp[i] = 0.0;
+                for (const auto &p: const_rotation_cross[order]) {
+                    row_tmp.clear();
                     for (const auto &it: p) {
-                        arr_tmp[nshift2 + it.first] = it.second;
+                        row_tmp.emplace(nshift2 + it.first, it.second);
                     }
-                    const_total.emplace_back(nparams, arr_tmp);
+                    const_total.emplace_back(row_tmp);
                 }
             }
 
             nshift2 += nequiv[order - 1].size();
         }
     }
-    deallocate(arr_tmp);
 
     if (nconst1 != const_total.size())
-        remove_redundant_rows(nparams, const_total, tolerance_constraint);
+        rref_sparse(nparams, const_total, tolerance_constraint);
 
     auto nconst = const_total.size();
 
     if (fix_harmonic) nconst += nequiv[0].size();
     if (fix_cubic) nconst += nequiv[1].size();
 
+    if (const_mat) {
+        deallocate(const_mat);
+        const_mat = nullptr;
+    }
+    if (const_rhs) {
+        deallocate(const_rhs);
+        const_rhs = nullptr;
+    }
+    if (nconst == 0) return 0;
+
+    allocate(const_mat, nconst, nparams);
+    allocate(const_rhs, nconst);
+
     for (i = 0; i < nconst; ++i) {
         for (j = 0; j < nparams; ++j) {
             const_mat[i][j] = 0.0;
@@ -586,9 +579,9 @@ size_t Constraint::calc_constraint_matrix(const int maxorder,
         icol += const_fix[1].size();
     }
 
-    for (auto &p: const_total) {
-        for (i = 0; i < nparams; ++i) {
-            const_mat[irow][i] = p.w_const[i];
+    for (const auto &p: const_total) {
+        for (const auto &it: p) {
+            const_mat[irow][it.first] = it.second;
         }
         ++irow;
     }
@@ -1072,6 +1065,11 @@ void Constraint::get_constraint_translation(const Cell &supercell,
 
     ConstEntry const_tmp;
 
+    // Fingerprints of the rows stored in constraint_all. Duplicated rows
+    // are rejected concurrently at generation time, so the serial merge
+    // and the final pass never compare whole rows.
+    ConstraintFingerprintSet<ConstEntry> fingerprints;
+
     if (order < 0) return;
 
     if (nparams == 0) return;
@@ -1150,7 +1148,9 @@ void Constraint::get_constraint_translation(const Cell &supercell,
                                 const_tmp.emplace_back(j, const_now[j]);
                             }
                         }
-                        constraint_all.emplace_back(const_tmp);
+                        if (fingerprints.insert(fingerprint_row(const_tmp), const_tmp)) {
+                            constraint_all.emplace_back(const_tmp);
+                        }
                     }
                 }
             }
@@ -1261,7 +1261,9 @@ void Constraint::get_constraint_translation(const Cell &supercell,
                                 if (const_tmp_omp.empty()) {
                                     std::cout << "This cannot happen" << std::endl;
                                 }
-                                constraint_list_omp.emplace_back(const_tmp_omp);
+                                if (fingerprints.insert(fingerprint_row(const_tmp_omp), const_tmp_omp)) {
+                                    constraint_list_omp.emplace_back(const_tmp_omp);
+                                }
                             }
                         }
                     }
@@ -1304,10 +1306,9 @@ void Constraint::get_constraint_translation(const Cell &supercell,
         intarr_copy = nullptr;
     }
 
+    // The rows are already unique; sorting just makes the output order
+    // independent of the thread schedule.
     std::sort(constraint_all.begin(), constraint_all.end());
-    constraint_all.erase(std::unique(constraint_all.begin(),
-                                     constraint_all.end()),
-                         constraint_all.end());
 
     MapConstraintElement const_tmp2;
     auto division_factor = 1.0;
@@ -1345,34 +1346,29 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
     int i, j;
     int iat, jat, jcrd;
     int idata;
-    int loc_nonzero;
 
     int *ind;
-    int *intarr, *intarr_copy;
     int **xyzcomponent;
 
     int ixyz;
     const auto natmin = symmetry->get_nat_prim();
     const auto nat = supercell.number_of_atoms;
 
-    // generate combinations of mirror images
-    long int i_mirror_images, i_tmp, j_tmp, i_tmp2;
-    long int n_mirror_images = nint(std::pow(static_cast<double>(27), order));
-
     unsigned int isize;
 
-    std::vector<int> data;
     std::unordered_set<FcProperty> list_found;
     std::unordered_set<FcProperty>::iterator iter_found;
     std::vector<std::vector<int>> data_vec;
-    std::vector<FcProperty> list_vec;
-    std::vector<double> const_now;
 
     typedef std::vector<ConstraintDoubleElement> ConstEntry;
     std::vector<ConstEntry> constraint_all;
 
     ConstEntry const_tmp;
 
+    // Concurrent dedup of candidate rows by fingerprint; exact redundancy
+    // is still removed by rref_sparse afterwards.
+    ConstraintFingerprintSet<ConstEntry> fingerprints;
+
     if (order < 0) return;
 
     if (nparams == 0) return;
@@ -1403,11 +1399,6 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
     allocate(xyzcomponent, nxyz, order + 1);
     fcs->get_xyzcomponent(order + 1, xyzcomponent);
 
-    allocate(intarr, order + 2);
-    allocate(intarr_copy, order + 2);
-
-    const_now.resize(nparams);
-
     for (i = 0; i < natmin; ++i) {
 
         iat = symmetry->get_map_p2s()[i][0];
@@ -1424,29 +1415,69 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
 
             auto intlist(cluster->get_interaction_pair(order, i));
             std::sort(intlist.begin(), intlist.end());
+            intlist.erase(std::unique(intlist.begin(), intlist.end()), intlist.end());
 
             data_vec.clear();
             // Generate data_vec that contains possible interacting clusters.
             // Each cluster contains (order + 1) atoms, and the last atom index
             // will be treated seperately below.
-            CombinationWithRepetition<int> g2(intlist.begin(), intlist.end(), order);
-            do {
-                data = g2.now();
+            // Fixing the first (smallest) element of each combination splits the
+            // lexicographic sequence of CombinationWithRepetition into independent
+            // partitions, so each thread enumerates its own block directly without
+            // materializing any prefix state of the generator.
+            const auto npart = intlist.size();
+            std::vector<std::vector<std::vector<int>>> data_vec_part(npart);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for (long ipart = 0; ipart < static_cast<long>(npart); ++ipart) {
 
-                intarr[0] = iat;
+                int *intarr_part;
+                allocate(intarr_part, order + 2);
+                intarr_part[0] = iat;
 
-                for (isize = 0; isize < data.size(); ++isize) {
-                    intarr[isize + 1] = data[isize];
-                }
+                std::vector<int> data(1, intlist[ipart]);
 
-                if (cluster->satisfy_nbody_rule(order + 1, intarr, order)) {
-                    if (cluster->is_incutoff(order + 1, intarr, order, supercell.kind)) {
-                        // Add to list if the atoms interact with each other.
-                        data_vec.push_back(data);
+                if (order == 1) {
+                    intarr_part[1] = data[0];
+                    if (cluster->satisfy_nbody_rule(order + 1, intarr_part, order)) {
+                        if (cluster->is_incutoff(order + 1, intarr_part, order, supercell.kind)) {
+                            data_vec_part[ipart].push_back(data);
+                        }
                     }
+                } else {
+                    CombinationWithRepetition<int> g2(intlist.begin() + ipart,
+                                                      intlist.end(), order - 1);
+                    do {
+                        const auto data_rest = g2.now();
+                        data.resize(1);
+                        data.insert(data.end(), data_rest.begin(), data_rest.end());
+
+                        for (unsigned int jsize = 0; jsize < data.size(); ++jsize) {
+                            intarr_part[jsize + 1] = data[jsize];
+                        }
+
+                        if (cluster->satisfy_nbody_rule(order + 1, intarr_part, order)) {
+                            if (cluster->is_incutoff(order + 1, intarr_part, order, supercell.kind)) {
+                                // Add to list if the atoms interact with each other.
+                                data_vec_part[ipart].push_back(data);
+                            }
+                        }
+
+                    } while (g2.next());
                 }
 
-            } while (g2.next());
+                deallocate(intarr_part);
+            }
+
+            // Concatenating the partitions in order restores the original
+            // lexicographic ordering of data_vec.
+            for (const auto &part: data_vec_part) {
+                for (const auto &it: part) {
+                    data_vec.push_back(it);
+                }
+            }
+            data_vec_part.clear();
 
             const auto ndata = data_vec.size();
 
@@ -1466,15 +1497,20 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
                 std::vector<int> data_omp;
                 std::vector<int> atom_tmp;
                 std::vector<int> sort_table, sort_table_tmp;
-                // std::vector<int> const_now_omp;
-                std::vector<std::vector<double> > consts_now_omp;
+                size_t i_tmp, j_tmp;
+                int i_tmp2;
+                long int i_mirror_images;
+
+                // Sparse accumulator holding (mirror image, parameter, value)
+                // triplets of a single constraint. This avoids clearing a dense
+                // 27^order x nparams workspace for every xyz component.
+                std::vector<std::tuple<long int, size_t, double>> contrib;
 
                 ConstEntry const_tmp_omp;
                 std::vector<ConstEntry> constraint_list_omp;
 
-                consts_now_omp.resize(n_mirror_images, std::vector<double>(nparams));
 #ifdef _OPENMP
-#pragma omp for private(isize, ixyz, jcrd, j, jat, iter_found, loc_nonzero, i_mirror_images), nowait
+#pragma omp for private(isize, ixyz, jcrd, j, jat, iter_found), nowait
 #endif
                 for (idata = 0; idata < ndata; ++idata) {
 
@@ -1490,13 +1526,8 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
                         // Loop for the xyz index of the last atom
                         for (jcrd = 0; jcrd < 3; ++jcrd) {
 
-                            // Reset the temporary array for another constraint
-                            //for (j = 0; j < nparams; ++j) const_now_omp[j] = 0;
-                            for (i_mirror_images = 0; i_mirror_images < n_mirror_images; i_mirror_images++) {
-                                for (j = 0; j < nparams; j++) {
-                                    consts_now_omp[i_mirror_images][j] = 0.0;
-                                }
-                            }
+                            // Reset the accumulator for another constraint
+                            contrib.clear();
 
                             // Loop for the last atom index
                             for (jat = 0; jat < 3 * nat; jat += 3) {
@@ -1560,8 +1591,9 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
                                                     i_mirror_images += cellvec[sort_table[i_tmp]];
                                                 }
                                                 // add to the constraint
-                                                consts_now_omp[i_mirror_images][(*iter_found).mother] +=
-                                                        weight * (*iter_found).sign;
+                                                contrib.emplace_back(i_mirror_images,
+                                                                     (*iter_found).mother,
+                                                                     weight * (*iter_found).sign);
                                             }
                                         }
                                     }
@@ -1569,23 +1601,47 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
                                 }
                             } // close loop jat
 
-                            // Add the constraint to the private array
-                            for (i_mirror_images = 0; i_mirror_images < n_mirror_images; i_mirror_images++) {
-                                if (!is_allzero(consts_now_omp[i_mirror_images], eps8, loc_nonzero, 0)) {
-                                    if (consts_now_omp[i_mirror_images][loc_nonzero] < 0) {
-                                        for (j = 0; j < nparams; ++j) consts_now_omp[i_mirror_images][j] *= -1.0;
-                                    }
+                            // Add the constraints to the private array.
+                            // Sorting the triplets groups the entries of each
+                            // mirror image together with ascending parameter index.
+                            std::sort(contrib.begin(), contrib.end());
 
-                                    const_tmp_omp.clear();
-                                    for (j = 0; j < nparams; ++j) {
-                                        if (std::abs(consts_now_omp[i_mirror_images][j]) > 0) {
-                                            const_tmp_omp.emplace_back(j, consts_now_omp[i_mirror_images][j]);
-                                        }
+                            size_t ic = 0;
+                            const auto ncontrib = contrib.size();
+                            while (ic < ncontrib) {
+                                const auto imirror = std::get<0>(contrib[ic]);
+                                const_tmp_omp.clear();
+                                while (ic < ncontrib && std::get<0>(contrib[ic]) == imirror) {
+                                    const auto jcol = std::get<1>(contrib[ic]);
+                                    auto sum_tmp = 0.0;
+                                    while (ic < ncontrib && std::get<0>(contrib[ic]) == imirror
+                                           && std::get<1>(contrib[ic]) == jcol) {
+                                        sum_tmp += std::get<2>(contrib[ic]);
+                                        ++ic;
                                     }
-                                    if (const_tmp_omp.empty()) {
-                                        std::cout << "This cannot happen" << std::endl;
+                                    if (std::abs(sum_tmp) > 0) {
+                                        const_tmp_omp.emplace_back(jcol, sum_tmp);
+                                    }
+                                }
+                                // Normalize the sign by the first element whose
+                                // modulus exceeds the tolerance; skip the row if
+                                // all elements are effectively zero.
+                                auto sign_tmp = 0.0;
+                                for (const auto &it: const_tmp_omp) {
+                                    if (std::abs(it.val) > eps8) {
+                                        sign_tmp = (it.val < 0.0) ? -1.0 : 1.0;
+                                        break;
+                                    }
+                                }
+                                if (sign_tmp != 0.0) {
+                                    if (sign_tmp < 0.0) {
+                                        for (auto &it: const_tmp_omp) it.val = -it.val;
+                                    }
+                                    if (fingerprints.insert(fingerprint_row(const_tmp_omp,
+                                                                            tolerance_constraint),
+                                                            const_tmp_omp)) {
+                                        constraint_list_omp.emplace_back(const_tmp_omp);
                                     }
-                                    constraint_list_omp.emplace_back(const_tmp_omp);
                                 }
                             }
                         }
@@ -1611,13 +1667,10 @@ void Constraint::get_constraint_translation_for_mirror_images(const Cell &superc
     }     // close loop i
 
     deallocate(xyzcomponent);
-    deallocate(intarr);
-    deallocate(intarr_copy);
 
+    // The rows are already deduplicated by fingerprint; sorting makes the
+    // output order independent of the thread schedule.
     std::sort(constraint_all.begin(), constraint_all.end());
-    constraint_all.erase(std::unique(constraint_all.begin(),
-                                     constraint_all.end()),
-                         constraint_all.end());
 
     MapConstraintElement const_tmp2;
     auto division_factor = 1.0;
@@ -2880,63 +2933,6 @@ bool Constraint::is_allzero(const std::vector<double> &vec,
 }
 
 
-void Constraint::remove_redundant_rows(const size_t n,
-                                       std::vector<ConstraintClass> &Constraint_vec,
-                                       const double tolerance) const
-{
-    size_t i, j;
-
-    auto nparam = n;
-    const auto nconst = Constraint_vec.size();
-    double *arr_tmp;
-    double **mat_tmp;
-
-    size_t nrank;
-
-    if (nconst > 0) {
-
-        allocate(mat_tmp, nconst, nparam);
-
-        i = 0;
-
-        for (auto &p: Constraint_vec) {
-            for (j = 0; j < nparam; ++j) {
-                mat_tmp[i][j] = p.w_const[j];
-            }
-            ++i;
-        }
-
-        rref(nconst, nparam, mat_tmp, nrank, tolerance);
-
-        allocate(arr_tmp, nparam);
-
-        Constraint_vec.clear();
-
-        for (i = 0; i < nrank; ++i) {
-            for (j = 0; j < nparam; ++j) arr_tmp[j] = 0.0;
-            long iloc = -1;
-            for (j = 0; j < nparam; ++j) {
-                if (std::abs(mat_tmp[i][j]) < tolerance) {
-                    arr_tmp[j] = 0.0;
-                } else {
-                    arr_tmp[j] = mat_tmp[i][j];
-                }
-                if (std::abs(arr_tmp[j]) >= tolerance) {
-                    iloc = j;
-                }
-            }
-
-            if (iloc != -1) {
-                Constraint_vec.emplace_back(nparam, arr_tmp);
-            }
-        }
-
-        deallocate(mat_tmp);
-        deallocate(arr_tmp);
-
-    }
-}
-
 void Constraint::print_constraint(const ConstraintSparseForm &const_in) const
 {
     const auto nconst = const_in.size();
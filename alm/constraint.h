@@ -18,39 +18,21 @@
 #include <iomanip>
 #include <map>
 #include <unordered_set>
+#include <cstdint>
+#include <cmath>
 #include "constants.h"
 #include "fcs.h"
 #include "cluster.h"
 #include "system.h"
 #include "timer.h"
 
-namespace ALM_NS {
-class ConstraintClass {
-public:
-    std::vector<double> w_const;
-
-    ConstraintClass() = default;
-
-    ConstraintClass(const ConstraintClass &a) = default;
-
-    ConstraintClass(std::vector<double> vec) : w_const(std::move(vec)) {}
+#ifdef _OPENMP
 
-    ConstraintClass(const int n,
-                    const double *arr,
-                    const int nshift = 0)
-    {
-        for (auto i = nshift; i < n; ++i) {
-            w_const.push_back(arr[i]);
-        }
-    }
+#include <omp.h>
 
-    bool operator<(const ConstraintClass &a) const
-    {
-        return std::lexicographical_compare(w_const.begin(), w_const.end(),
-                                            a.w_const.begin(), a.w_const.end());
-    }
-};
+#endif
 
+namespace ALM_NS {
 class ConstraintTypeFix {
 public:
     size_t p_index_target;
@@ -200,6 +182,106 @@ inline bool operator<(const std::map<size_t, double> &obj1,
     return obj1.begin()->first < obj2.begin()->first;
 }
 
+// FNV-1a fingerprint of a sparse constraint row. Rows are fingerprinted
+// after sign normalization, so identical rows always map to the same key.
+inline uint64_t fingerprint_row(const std::vector<ConstraintIntegerElement> &row)
+{
+    auto hash = 14695981039346656037ULL;
+    auto mix = [&hash](const uint64_t word) {
+        for (auto i = 0; i < 8; ++i) {
+            hash ^= (word >> (8 * i)) & 0xffULL;
+            hash *= 1099511628211ULL;
+        }
+    };
+    for (const auto &it: row) {
+        mix(static_cast<uint64_t>(it.col));
+        mix(static_cast<uint64_t>(static_cast<int64_t>(it.val)));
+    }
+    return hash;
+}
+
+// Same as above for double-valued rows. The values are quantized by the
+// given tolerance so that rows equal within the tolerance almost always
+// share a fingerprint; residual near-duplicates are removed later by the
+// exact reduction (rref_sparse).
+inline uint64_t fingerprint_row(const std::vector<ConstraintDoubleElement> &row,
+                                const double tolerance)
+{
+    auto hash = 14695981039346656037ULL;
+    auto mix = [&hash](const uint64_t word) {
+        for (auto i = 0; i < 8; ++i) {
+            hash ^= (word >> (8 * i)) & 0xffULL;
+            hash *= 1099511628211ULL;
+        }
+    };
+    for (const auto &it: row) {
+        mix(static_cast<uint64_t>(it.col));
+        mix(static_cast<uint64_t>(static_cast<int64_t>(std::llround(it.val / tolerance))));
+    }
+    return hash;
+}
+
+template<typename RowType>
+class ConstraintFingerprintSet {
+    // Concurrent dedup of candidate constraint rows while they are
+    // generated. The fingerprint selects the shard and the bucket, and on
+    // a bucket hit the candidate is compared element-wise against the
+    // rows already stored under that fingerprint, so a 64-bit hash
+    // collision between distinct rows costs one comparison instead of
+    // silently dropping a constraint. Sharding keeps threads inserting
+    // different rows off the same lock.
+public:
+    ConstraintFingerprintSet()
+    {
+#ifdef _OPENMP
+        for (auto i = 0; i < nshards; ++i) omp_init_lock(&locks[i]);
+#endif
+    }
+
+    ~ConstraintFingerprintSet()
+    {
+#ifdef _OPENMP
+        for (auto i = 0; i < nshards; ++i) omp_destroy_lock(&locks[i]);
+#endif
+    }
+
+    ConstraintFingerprintSet(const ConstraintFingerprintSet &) = delete;
+
+    ConstraintFingerprintSet &operator=(const ConstraintFingerprintSet &) = delete;
+
+    // Returns true if no row equal to the given one has been registered
+    // before. Equality is that of the RowType operator==, i.e. exact for
+    // integer rows and tolerance-based for double rows.
+    bool insert(const uint64_t fingerprint,
+                const RowType &row)
+    {
+        const auto ishard = static_cast<int>(fingerprint & (nshards - 1));
+        auto is_new = true;
+#ifdef _OPENMP
+        omp_set_lock(&locks[ishard]);
+#endif
+        auto &bucket = shards[ishard][fingerprint];
+        for (const auto &row_stored: bucket) {
+            if (row_stored == row) {
+                is_new = false;
+                break;
+            }
+        }
+        if (is_new) bucket.emplace_back(row);
+#ifdef _OPENMP
+        omp_unset_lock(&locks[ishard]);
+#endif
+        return is_new;
+    }
+
+private:
+    static const int nshards = 64;
+    std::unordered_map<uint64_t, std::vector<RowType>> shards[nshards];
+#ifdef _OPENMP
+    omp_lock_t locks[nshards];
+#endif
+};
+
 class Constraint {
 public:
     Constraint();
@@ -339,10 +421,12 @@ private:
                                         const double);
 
 
-    // const_mat and const_rhs are updated.
+    // const_mat and const_rhs are allocated and updated. The constraint
+    // rows are assembled and reduced in sparse form; the dense matrix is
+    // only materialized with its final number of rows.
     size_t calc_constraint_matrix(const int maxorder,
                                   const std::vector<size_t> *nequiv,
-                                  const size_t nparams) const;
+                                  const size_t nparams);
 
     void print_constraint(const ConstraintSparseForm &) const;
 
@@ -363,10 +447,6 @@ private:
                     const int nshift = 0) const;
 
 
-    void remove_redundant_rows(const size_t n,
-                               std::vector<ConstraintClass> &Constraint_vec,
-                               const double tolerance = eps12) const;
-
     // const_symmetry is updated.
     void generate_symmetry_constraint(const size_t nat,
                                       const Symmetry *symmetry,
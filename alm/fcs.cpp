@@ -24,6 +24,7 @@
 #include <cstddef>
 #include <string>
 #include <cmath>
+#include <cstdint>
 #include "../external/combination.hpp"
 #include <unordered_set>
 #include <boost/algorithm/string/case_conv.hpp>
@@ -208,12 +209,65 @@ void Fcs::generate_force_constant_table(const int order,
     allocate(xyzcomponent, nxyz, order + 2);
     get_xyzcomponent(order + 2, xyzcomponent);
 
+    // Canonicalized index tuples are deduplicated through a hash set.
+    // When the whole tuple fits into 64 bits, a packed integer key is
+    // used instead of IntList, which avoids one heap allocation and a
+    // loop of hash combinations per lookup.
+
     std::unordered_set<IntList> list_found;
+    std::unordered_set<uint64_t> list_found_packed;
+
+    auto nbits = 1;
+    while ((1ULL << nbits) < 3 * nat) ++nbits;
+    const auto use_packed_key = (order + 2) * nbits <= 64;
+
+    auto pack_key = [order, nbits](const int *idx) {
+        uint64_t key = 0;
+        for (auto m = 0; m < order + 2; ++m) {
+            key = (key << nbits) | static_cast<uint64_t>(idx[m]);
+        }
+        return key;
+    };
+    auto is_found = [&](const int *idx) {
+        if (use_packed_key) {
+            return list_found_packed.find(pack_key(idx)) != list_found_packed.end();
+        }
+        return list_found.find(IntList(order + 2, idx)) != list_found.end();
+    };
+    auto insert_found = [&](const int *idx) {
+        if (use_packed_key) {
+            list_found_packed.insert(pack_key(idx));
+        } else {
+            list_found.insert(IntList(order + 2, idx));
+        }
+    };
+
+    // The mapped atom indices depend only on the pair and the symmetry
+    // operation, so the operations keeping the mapped cluster inside the
+    // primitive cell are listed once per pair instead of once per xyz
+    // component.
+    std::vector<unsigned int> isym_in_use;
+    std::vector<int> atmn_mapped_all;
+    std::vector<std::vector<std::pair<int, double>>> coef_by_sym;
 
     for (const auto &pair: pairs) {
 
         for (i = 0; i < order + 2; ++i) atmn[i] = pair.iarray[i];
 
+        isym_in_use.clear();
+        atmn_mapped_all.clear();
+        for (isym = 0; isym < nsym_in_use; ++isym) {
+            for (i = 0; i < order + 2; ++i) atmn_mapped[i] = map_sym[atmn[i]][isym];
+            if (!is_inprim(order + 2,
+                           atmn_mapped,
+                           symm_in->get_nat_prim(),
+                           symm_in->get_map_p2s()))
+                continue;
+            isym_in_use.push_back(isym);
+            for (i = 0; i < order + 2; ++i) atmn_mapped_all.push_back(atmn_mapped[i]);
+        }
+        coef_by_sym.resize(isym_in_use.size());
+
         for (i1 = 0; i1 < nxyz; ++i1) {
             for (i = 0; i < order + 2; ++i) ind[i] = 3 * atmn[i] + xyzcomponent[i1][i];
 
@@ -227,30 +281,41 @@ void Fcs::generate_force_constant_table(const int order,
 
             is_zero = false;
 
-            if (list_found.find(IntList(order + 2, ind)) != list_found.end()) continue; // Already exits!
+            if (is_found(ind)) continue; // Already exits!
 
-            // Search symmetrically-dependent parameter set
+            // Search symmetrically-dependent parameter set.
+            // The rotation coefficients of the orbit members are computed
+            // in parallel; the hash-set updates below replay them in the
+            // original symmetry-operation order.
 
-            size_t ndeps = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+            for (long iu = 0; iu < isym_in_use.size(); ++iu) {
+                auto &entries = coef_by_sym[iu];
+                entries.clear();
+                for (auto jxyz = 0; jxyz < nxyz; ++jxyz) {
+                    const auto coef_tmp = coef_sym(order + 2,
+                                                   rotation[isym_in_use[iu]],
+                                                   xyzcomponent[i1],
+                                                   xyzcomponent[jxyz]);
+                    if (std::abs(coef_tmp) > eps12) entries.emplace_back(jxyz, coef_tmp);
+                }
+            }
 
-            for (isym = 0; isym < nsym_in_use; ++isym) {
+            size_t ndeps = 0;
 
-                for (i = 0; i < order + 2; ++i) atmn_mapped[i] = map_sym[atmn[i]][isym];
+            for (size_t iu = 0; iu < isym_in_use.size(); ++iu) {
 
-                if (!is_inprim(order + 2,
-                               atmn_mapped,
-                               symm_in->get_nat_prim(),
-                               symm_in->get_map_p2s()))
-                    continue;
+                for (i = 0; i < order + 2; ++i)
+                    atmn_mapped[i] = atmn_mapped_all[iu * (order + 2) + i];
 
-                for (i2 = 0; i2 < nxyz; ++i2) {
+                for (const auto &entry: coef_by_sym[iu]) {
 
-                    c_tmp = coef_sym(order + 2,
-                                     rotation[isym],
-                                     xyzcomponent[i1],
-                                     xyzcomponent[i2]);
+                    i2 = entry.first;
+                    c_tmp = entry.second;
 
-                    if (std::abs(c_tmp) > eps12) {
+                    {
                         for (i = 0; i < order + 2; ++i)
                             ind_mapped[i] = 3 * atmn_mapped[i] + xyzcomponent[i2][i];
 
@@ -273,8 +338,8 @@ void Fcs::generate_force_constant_table(const int order,
 
                         // Add to found list (set) and fcset (vector) if the created is new one.
 
-                        if (list_found.find(IntList(order + 2, ind_mapped)) == list_found.end()) {
-                            list_found.insert(IntList(order + 2, ind_mapped));
+                        if (!is_found(ind_mapped)) {
+                            insert_found(ind_mapped);
 
                             fc_vec.emplace_back(FcProperty(order + 2,
                                                            c_tmp,
@@ -379,6 +444,10 @@ void Fcs::get_constraint_symmetry(const size_t nat,
     std::vector<ConstEntry> constraint_all;
     ConstEntry const_tmp;
 
+    // Concurrent fingerprint set rejecting duplicated rows at generation
+    // time; the critical section then only appends unique rows.
+    ConstraintFingerprintSet<ConstEntry> fingerprints;
+
     int **map_sym;
     double ***rotation;
     const auto nsym = symmetry->get_SymmData().size();
@@ -426,9 +495,7 @@ void Fcs::get_constraint_symmetry(const size_t nat,
 #pragma omp parallel
 #endif
     {
-        int j;
         int i_prim;
-        int loc_nonzero;
         int *ind;
         int *atm_index, *atm_index_symm;
         int *xyz_index;
@@ -436,8 +503,14 @@ void Fcs::get_constraint_symmetry(const size_t nat,
         // double maxabs;
 
         std::unordered_set<FcProperty>::iterator iter_found;
-        std::vector<double> const_now_omp;
-        std::vector<std::vector<double>> const_omp;
+
+        // Each (orbit, symmetry operation) pair touches at most nxyz + 1 of
+        // the nparams entries. The accumulator therefore stays dense for
+        // O(1) indexed updates, but only the touched entries are scanned
+        // and reset, which removes the three O(nparams) sweeps per pair.
+        std::vector<double> const_now_omp(nparams, 0.0);
+        std::vector<size_t> touched_omp;
+        touched_omp.reserve(nxyz + 1);
 
         ConstEntry const_tmp_omp;
         std::vector<ConstEntry> constraint_list_omp;
@@ -447,9 +520,6 @@ void Fcs::get_constraint_symmetry(const size_t nat,
         allocate(atm_index_symm, order + 2);
         allocate(xyz_index, order + 2);
 
-        const_omp.clear();
-        const_now_omp.resize(nparams);
-
 #ifdef _OPENMP
 #pragma omp for private(i, isym, ixyz), schedule(static)
 #endif
@@ -466,9 +536,10 @@ void Fcs::get_constraint_symmetry(const size_t nat,
                     atm_index_symm[i] = map_sym[atm_index[i]][isym];
                 if (!is_inprim(order + 2, atm_index_symm, natmin, symmetry->get_map_p2s())) continue;
 
-                for (i = 0; i < nparams; ++i) const_now_omp[i] = 0.0;
+                touched_omp.clear();
 
                 const_now_omp[fc_table_in[ii].mother] = -fc_table_in[ii].sign;
+                touched_omp.push_back(fc_table_in[ii].mother);
 
                 for (ixyz = 0; ixyz < nxyz; ++ixyz) {
                     for (i = 0; i < order + 2; ++i)
@@ -482,23 +553,38 @@ void Fcs::get_constraint_symmetry(const size_t nat,
                     if (iter_found != list_found.end()) {
                         c_tmp = coef_sym(order + 2, rotation[isym], xyz_index, xyzcomponent[ixyz]);
                         const_now_omp[(*iter_found).mother] += (*iter_found).sign * c_tmp;
+                        touched_omp.push_back((*iter_found).mother);
                     }
                 }
 
-                if (!is_allzero(const_now_omp, eps8, loc_nonzero)) {
-                    if (const_now_omp[loc_nonzero] < 0.0) {
-                        for (j = 0; j < nparams; ++j) const_now_omp[j] *= -1.0;
+                std::sort(touched_omp.begin(), touched_omp.end());
+                touched_omp.erase(std::unique(touched_omp.begin(), touched_omp.end()),
+                                  touched_omp.end());
+
+                // The first touched column with a significant value plays the
+                // role of loc_nonzero of the dense scan.
+                auto division_sign = 0.0;
+                for (const auto &jcol: touched_omp) {
+                    if (std::abs(const_now_omp[jcol]) >= eps8) {
+                        division_sign = (const_now_omp[jcol] < 0.0) ? -1.0 : 1.0;
+                        break;
                     }
+                }
 
+                if (division_sign != 0.0) {
                     const_tmp_omp.clear();
-                    for (j = 0; j < nparams; ++j) {
-                        if (std::abs(const_now_omp[j]) >= eps8) {
-                            const_tmp_omp.emplace_back(j, const_now_omp[j]);
+                    for (const auto &jcol: touched_omp) {
+                        if (std::abs(const_now_omp[jcol]) >= eps8) {
+                            const_tmp_omp.emplace_back(jcol, division_sign * const_now_omp[jcol]);
                         }
                     }
-                    constraint_list_omp.emplace_back(const_tmp_omp);
+                    if (fingerprints.insert(fingerprint_row(const_tmp_omp, tolerance), const_tmp_omp)) {
+                        constraint_list_omp.emplace_back(const_tmp_omp);
+                    }
                 }
 
+                for (const auto &jcol: touched_omp) const_now_omp[jcol] = 0.0;
+
             } // close isym loop
         }     // close ii loop
 
@@ -521,10 +607,9 @@ void Fcs::get_constraint_symmetry(const size_t nat,
     deallocate(rotation);
     deallocate(map_sym);
 
+    // The rows are unique already; sorting keeps the output order
+    // independent of the thread schedule.
     std::sort(constraint_all.begin(), constraint_all.end());
-    constraint_all.erase(std::unique(constraint_all.begin(),
-                                     constraint_all.end()),
-                         constraint_all.end());
 
     MapConstraintElement const_tmp2;
     auto division_factor = 1.0;
@@ -576,6 +661,10 @@ void Fcs::get_constraint_symmetry_in_integer(const size_t nat,
     std::vector<ConstEntry> constraint_all;
     ConstEntry const_tmp;
 
+    // Concurrent fingerprint set rejecting duplicated rows at generation
+    // time; the critical section then only appends unique rows.
+    ConstraintFingerprintSet<ConstEntry> fingerprints;
+
     int **map_sym;
     double ***rotation;
     const auto nsym = symmetry->get_SymmData().size();
@@ -622,17 +711,20 @@ void Fcs::get_constraint_symmetry_in_integer(const size_t nat,
 #pragma omp parallel
 #endif
     {
-        int j;
         int i_prim;
-        int loc_nonzero;
         int *ind;
         int *atm_index, *atm_index_symm;
         int *xyz_index;
         int c_tmp;
 
         std::unordered_set<FcProperty>::iterator iter_found;
-        std::vector<int> const_now_omp;
-        std::vector<std::vector<int>> const_omp;
+
+        // Same sparse-accumulation scheme as in get_constraint_symmetry:
+        // only the entries touched by the current (orbit, symmetry
+        // operation) pair are scanned and reset.
+        std::vector<int> const_now_omp(nparams, 0);
+        std::vector<size_t> touched_omp;
+        touched_omp.reserve(nxyz + 1);
 
         ConstEntry const_tmp_omp;
         std::vector<ConstEntry> constraint_list_omp;
@@ -642,9 +734,6 @@ void Fcs::get_constraint_symmetry_in_integer(const size_t nat,
         allocate(atm_index_symm, order + 2);
         allocate(xyz_index, order + 2);
 
-        const_omp.clear();
-        const_now_omp.resize(nparams);
-
 #ifdef _OPENMP
 #pragma omp for private(i, isym, ixyz), schedule(static)
 #endif
@@ -661,9 +750,10 @@ void Fcs::get_constraint_symmetry_in_integer(const size_t nat,
                     atm_index_symm[i] = map_sym[atm_index[i]][isym];
                 if (!is_inprim(order + 2, atm_index_symm, natmin, symmetry->get_map_p2s())) continue;
 
-                for (i = 0; i < nparams; ++i) const_now_omp[i] = 0;
+                touched_omp.clear();
 
                 const_now_omp[fc_table_in[ii].mother] = -nint(fc_table_in[ii].sign);
+                touched_omp.push_back(fc_table_in[ii].mother);
 
                 for (ixyz = 0; ixyz < nxyz; ++ixyz) {
                     for (i = 0; i < order + 2; ++i)
@@ -677,23 +767,36 @@ void Fcs::get_constraint_symmetry_in_integer(const size_t nat,
                     if (iter_found != list_found.end()) {
                         c_tmp = nint(coef_sym(order + 2, rotation[isym], xyz_index, xyzcomponent[ixyz]));
                         const_now_omp[(*iter_found).mother] += nint((*iter_found).sign) * c_tmp;
+                        touched_omp.push_back((*iter_found).mother);
                     }
                 }
 
-                if (!is_allzero(const_now_omp, loc_nonzero)) {
-                    if (const_now_omp[loc_nonzero] < 0) {
-                        for (j = 0; j < nparams; ++j) const_now_omp[j] *= -1;
+                std::sort(touched_omp.begin(), touched_omp.end());
+                touched_omp.erase(std::unique(touched_omp.begin(), touched_omp.end()),
+                                  touched_omp.end());
+
+                auto division_sign = 0;
+                for (const auto &jcol: touched_omp) {
+                    if (const_now_omp[jcol] != 0) {
+                        division_sign = (const_now_omp[jcol] < 0) ? -1 : 1;
+                        break;
                     }
+                }
 
+                if (division_sign != 0) {
                     const_tmp_omp.clear();
-                    for (j = 0; j < nparams; ++j) {
-                        if (std::abs(const_now_omp[j]) > 0) {
-                            const_tmp_omp.emplace_back(j, const_now_omp[j]);
+                    for (const auto &jcol: touched_omp) {
+                        if (const_now_omp[jcol] != 0) {
+                            const_tmp_omp.emplace_back(jcol, division_sign * const_now_omp[jcol]);
                         }
                     }
-                    constraint_list_omp.emplace_back(const_tmp_omp);
+                    if (fingerprints.insert(fingerprint_row(const_tmp_omp), const_tmp_omp)) {
+                        constraint_list_omp.emplace_back(const_tmp_omp);
+                    }
                 }
 
+                for (const auto &jcol: touched_omp) const_now_omp[jcol] = 0;
+
             } // close isym loop
         }     // close ii loop
 
@@ -716,10 +819,9 @@ void Fcs::get_constraint_symmetry_in_integer(const size_t nat,
     deallocate(rotation);
     deallocate(map_sym);
 
+    // The rows are unique already; sorting keeps the output order
+    // independent of the thread schedule.
     std::sort(constraint_all.begin(), constraint_all.end());
-    constraint_all.erase(std::unique(constraint_all.begin(),
-                                     constraint_all.end()),
-                         constraint_all.end());
 
     MapConstraintElement const_tmp2;
     auto division_factor = 1.0;
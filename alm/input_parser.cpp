@@ -21,6 +21,9 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -78,34 +81,8 @@ void InputParser::parse_displacement_and_force_files(std::vector<std::vector<dou
 
     std::vector<double> value_arr;
 
-    std::string line;
-    double val;
-    auto nline_u = 0;
-
-    // Open the target file and copy the data to 1D temporary vector
-    std::ifstream ifs_data;
-    ifs_data.open(datfile_in.filename.c_str(), std::ios::in);
-    if (!ifs_data) exit("openfiles", "cannot open DFSET file");
-    auto reach_end = false;
-    while (std::getline(ifs_data >> std::ws, line)) {
-        if (line[0] != '#') {
-
-            std::istringstream iss(line);
-
-            while (iss >> val) {
-                value_arr.push_back(val);
-                ++nline_u;
-
-                if (nline_u == nrequired) {
-                    reach_end = true;
-                    break;
-                }
-            }
-        }
-
-        if (reach_end) break;
-    }
-    ifs_data.close();
+    // Copy the data of the file into the 1D temporary vector
+    load_dfset_values(datfile_in.filename, nrequired, value_arr);
 
     // Check if the length of the vector is correct.
     // Also, estimate ndata if it is not set. 
@@ -153,6 +130,93 @@ void InputParser::parse_displacement_and_force_files(std::vector<std::vector<dou
     value_arr.clear();
 }
 
+void InputParser::load_dfset_values(const std::string &fname,
+                                    const int nrequired,
+                                    std::vector<double> &value_arr) const
+{
+    // Bulk loader for DFSET files. The whole file is fetched with a single
+    // read request and the numbers are converted with strtod on the
+    // contiguous buffer, which avoids the per-token overhead of iostream
+    // extraction that dominates the loading time of large training sets.
+    // A binary variant of DFSET (see tools/dfset2bin.py) is recognized by
+    // its leading magic bytes and copied directly into the output array.
+
+    value_arr.clear();
+
+    std::ifstream ifs_data(fname.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs_data) exit("openfiles", "cannot open DFSET file");
+
+    static const char magic_binary[8]
+            = {'A', 'L', 'M', 'D', 'F', 'B', '0', '1'};
+    char header[8] = {};
+    ifs_data.read(header, 8);
+
+    if (ifs_data.gcount() == 8 && std::memcmp(header, magic_binary, 8) == 0) {
+
+        int64_t nvalues_file = 0;
+        ifs_data.read(reinterpret_cast<char *>(&nvalues_file), sizeof(nvalues_file));
+        if (!ifs_data || nvalues_file <= 0) {
+            exit("load_dfset_values", "Broken header of the binary DFSET file");
+        }
+        auto nread = nvalues_file;
+        if (nrequired > 0 && nrequired < nread) nread = nrequired;
+
+        value_arr.resize(nread);
+        ifs_data.read(reinterpret_cast<char *>(value_arr.data()),
+                      nread * static_cast<int64_t>(sizeof(double)));
+        if (ifs_data.gcount() != nread * static_cast<int64_t>(sizeof(double))) {
+            exit("load_dfset_values", "The binary DFSET file is truncated");
+        }
+        return;
+    }
+
+    // Plain text DFSET
+
+    ifs_data.clear();
+    ifs_data.seekg(0, std::ios::end);
+    const auto filesize = static_cast<size_t>(ifs_data.tellg());
+    std::string buffer(filesize, '\0');
+    ifs_data.seekg(0, std::ios::beg);
+    ifs_data.read(&buffer[0], filesize);
+
+    if (nrequired > 0) {
+        value_arr.reserve(nrequired);
+    }
+
+    // The buffer is NUL-terminated by c_str(), so strtod never runs past
+    // its end. strtod honors the global C locale, which ALM never changes
+    // from the default "C".
+    const char *p = buffer.c_str();
+    const char *const pend = p + filesize;
+
+    while (p < pend) {
+        while (p < pend &&
+               (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+            ++p;
+        }
+        if (p >= pend) break;
+        if (*p == '#') {
+            // Comment: discard the rest of the line
+            while (p < pend && *p != '\n') ++p;
+            continue;
+        }
+        char *p_next = nullptr;
+        const auto val = std::strtod(p, &p_next);
+        if (p_next == p) {
+            // Not a number. The iostream reader discarded the rest of the
+            // line when the extraction failed; do the same here.
+            while (p < pend && *p != '\n') ++p;
+            continue;
+        }
+        value_arr.push_back(val);
+        p = p_next;
+
+        if (nrequired > 0 &&
+            value_arr.size() == static_cast<size_t>(nrequired))
+            break;
+    }
+}
+
 void InputParser::parse_input(ALM *alm)
 {
     // The order of calling methods in this method is important.
@@ -214,10 +278,11 @@ void InputParser::parse_general_vars(ALM *alm)
 {
     size_t i;
     std::string str_tmp, str_disp_basis, basis_force_constant;
-    int printsymmetry, is_periodic[3];
+    int printsymmetry, symmetry_cache, is_periodic[3];
+    int nrandom, random_pattern_seed;
     size_t icount, ncount;
     auto trim_dispsign_for_evenfunc = true;
-    int print_hessian, print_fcs_alamode, print_fc2_qefc, print_fc3_shengbte;
+    int print_hessian, print_fcs_alamode, print_fcs_binary, print_fc2_qefc, print_fc3_shengbte;
     int noncollinear, trevsym;
     double **magmom, magmag{0.0};
     double tolerance;
@@ -227,10 +292,10 @@ void InputParser::parse_general_vars(ALM *alm)
 
     std::vector<std::string> kdname_v, periodic_v, magmom_v, str_split;
     const std::vector<std::string> input_list{
-            "PREFIX", "MODE", "NAT", "NKD", "KD", "PERIODIC", "PRINTSYM", "TOLERANCE",
-            "DBASIS", "TRIMEVEN", "VERBOSITY",
+            "PREFIX", "MODE", "NAT", "NKD", "KD", "PERIODIC", "PRINTSYM", "SYMCACHE", "TOLERANCE",
+            "DBASIS", "TRIMEVEN", "VERBOSITY", "NRANDOM", "RANDOM_SEED",
             "MAGMOM", "NONCOLLINEAR", "TREVSYM", "HESSIAN", "TOL_CONST", "FCSYM_BASIS",
-            "NMAXSAVE", "FC3_SHENGBTE", "FC2_QEFC", "FCS_ALAMODE", "FC_ZERO_THR"
+            "NMAXSAVE", "FC3_SHENGBTE", "FC2_QEFC", "FCS_ALAMODE", "FCS_BINARY", "FC_ZERO_THR"
     };
     std::vector<std::string> no_defaults{"PREFIX", "MODE", "NAT", "NKD", "KD"};
     std::map<std::string, std::string> general_var_dict;
@@ -275,6 +340,26 @@ void InputParser::parse_general_vars(ALM *alm)
         assign_val(printsymmetry, "PRINTSYM", general_var_dict);
     }
 
+    if (general_var_dict["SYMCACHE"].empty()) {
+        symmetry_cache = 0;
+    } else {
+        assign_val(symmetry_cache, "SYMCACHE", general_var_dict);
+    }
+
+    if (general_var_dict["NRANDOM"].empty()) {
+        nrandom = 0;
+    } else {
+        assign_val(nrandom, "NRANDOM", general_var_dict);
+        if (nrandom < 0) {
+            exit("parse_general_vars", "NRANDOM must be non-negative.");
+        }
+    }
+    if (general_var_dict["RANDOM_SEED"].empty()) {
+        random_pattern_seed = 0;
+    } else {
+        assign_val(random_pattern_seed, "RANDOM_SEED", general_var_dict);
+    }
+
     split_str_by_space(general_var_dict["KD"], kdname_v);
 
     if (kdname_v.size() != nkd) {
@@ -368,6 +453,11 @@ void InputParser::parse_general_vars(ALM *alm)
     } else {
         assign_val(print_fcs_alamode, "FCS_ALAMODE", general_var_dict);
     }
+    if (general_var_dict["FCS_BINARY"].empty()) {
+        print_fcs_binary = 0;
+    } else {
+        assign_val(print_fcs_binary, "FCS_BINARY", general_var_dict);
+    }
     if (general_var_dict["FC3_SHENGBTE"].empty()) {
         print_fc3_shengbte = 0;
     } else {
@@ -485,11 +575,13 @@ void InputParser::parse_general_vars(ALM *alm)
                                    nat,
                                    nkd,
                                    printsymmetry,
+                                   symmetry_cache,
                                    is_periodic,
                                    trim_dispsign_for_evenfunc,
                                    lspin,
                                    print_hessian,
                                    print_fcs_alamode,
+                                   print_fcs_binary,
                                    print_fc3_shengbte,
                                    print_fc2_qefc,
                                    noncollinear,
@@ -500,7 +592,9 @@ void InputParser::parse_general_vars(ALM *alm)
                                    tolerance_constraint,
                                    basis_force_constant,
                                    nmaxsave,
-                                   fc_zero_threshold);
+                                   fc_zero_threshold,
+                                   nrandom,
+                                   random_pattern_seed);
 
     allocate(magmom, nat, 3);
 
@@ -683,14 +777,14 @@ void InputParser::parse_optimize_vars(ALM *alm)
     std::vector<std::vector<double>> u_tmp2, f_tmp2;
 
     const std::vector<std::string> input_list{
-            "LMODEL", "SPARSE", "SPARSESOLVER",
+            "LMODEL", "SPARSE", "SPARSESOLVER", "STREAM", "SKETCH",
             "ICONST", "ROTAXIS", "FC2XML", "FC3XML",
             "NDATA", "NSTART", "NEND", "SKIP", "DFSET",
             "NDATA_CV", "NSTART_CV", "NEND_CV", "DFSET_CV",
             "L1_RATIO", "STANDARDIZE", "ENET_DNORM",
             "L1_ALPHA", "CV_MAXALPHA", "CV_MINALPHA", "CV_NALPHA",
             "CV", "MAXITER", "CONV_TOL", "NWRITE", "SOLUTION_PATH", "DEBIAS_OLS",
-            "MIRROR_IMAGE_CONV", "STOP_CRITERION"
+            "MIRROR_IMAGE_CONV", "STOP_CRITERION", "VALIDATE"
     };
 
     std::map<std::string, std::string> optimize_var_dict;
@@ -738,6 +832,15 @@ void InputParser::parse_optimize_vars(ALM *alm)
         }
         optcontrol.sparsesolver = str_sparsesolver;
     }
+    if (!optimize_var_dict["STREAM"].empty()) {
+        assign_val(optcontrol.stream_sensing_matrix, "STREAM", optimize_var_dict);
+    }
+    if (!optimize_var_dict["SKETCH"].empty()) {
+        assign_val(optcontrol.use_sketch_solver, "SKETCH", optimize_var_dict);
+    }
+    if (!optimize_var_dict["VALIDATE"].empty()) {
+        assign_val(optcontrol.validation_report, "VALIDATE", optimize_var_dict);
+    }
 
     if (!optimize_var_dict["ENET_DNORM"].empty()) {
         optcontrol.displacement_normalization_factor
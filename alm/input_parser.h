@@ -79,5 +79,11 @@ private:
     void parse_displacement_and_force_files(std::vector<std::vector<double>> &u,
                                             std::vector<std::vector<double>> &f,
                                             DispForceFile &datfile_in) const;
+
+    // Read up to nrequired (all when nrequired < 0) numbers of a DFSET
+    // file, either plain text or the binary variant, into value_arr.
+    void load_dfset_values(const std::string &fname,
+                           const int nrequired,
+                           std::vector<double> &value_arr) const;
 };
 }
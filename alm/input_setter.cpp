@@ -126,11 +126,13 @@ void InputSetter::set_general_vars(ALM *alm,
                                    const size_t nat_in,
                                    const size_t nkd_in,
                                    const int printsymmetry,
+                                   const int symmetry_cache,
                                    const int is_periodic_in[3],
                                    const bool trim_dispsign_for_evenfunc,
                                    const bool lspin_in,
                                    const int print_hessian,
                                    const int print_fcs_alamode,
+                                   const int print_fcs_binary,
                                    const int print_fc3_shengbte,
                                    const int print_fc2_qefc,
                                    const int noncollinear_in,
@@ -141,7 +143,9 @@ void InputSetter::set_general_vars(ALM *alm,
                                    const double tolerance_constraint,
                                    const std::string &basis_force_constant,
                                    const int nmaxsave,
-                                   const double fc_zero_threshold)
+                                   const double fc_zero_threshold,
+                                   const int nrandom,
+                                   const int random_pattern_seed)
 {
     size_t i;
 
@@ -150,6 +154,7 @@ void InputSetter::set_general_vars(ALM *alm,
     nat = nat_in;
     nkd = nkd_in;
     alm->set_print_symmetry(printsymmetry);
+    alm->set_symmetry_cache(symmetry_cache);
     alm->set_symmetry_tolerance(tolerance);
 
     if (kdname) {
@@ -180,6 +185,7 @@ void InputSetter::set_general_vars(ALM *alm,
 
     alm->set_fcs_save_flag("hessian", print_hessian);
     alm->set_fcs_save_flag("alamode", print_fcs_alamode);
+    alm->set_fcs_save_flag("binary", print_fcs_binary);
     alm->set_fcs_save_flag("shengbte", print_fc3_shengbte);
     alm->set_fcs_save_flag("qefc", print_fc2_qefc);
     alm->set_fc_zero_threshold(fc_zero_threshold);
@@ -190,6 +196,7 @@ void InputSetter::set_general_vars(ALM *alm,
     if (mode == "suggest") {
         alm->set_displacement_basis(str_disp_basis);
         alm->set_displacement_param(trim_dispsign_for_evenfunc);
+        alm->set_random_pattern_params(nrandom, random_pattern_seed);
     }
 }
 
@@ -47,11 +47,13 @@ public:
                           size_t nat_in,
                           size_t nkd_in,
                           int printsymmetry,
+                          int symmetry_cache,
                           const int is_periodic_in[3],
                           bool trim_dispsign_for_evenfunc,
                           bool lspin_in,
                           int print_hessian,
                           int print_fcs_alamode,
+                          int print_fcs_binary,
                           int print_fc3_shengbte,
                           int print_fc2_qefc,
                           int noncollinear_in,
@@ -62,7 +64,9 @@ public:
                           double tolerance_constraint,
                           const std::string &basis_force_constant,
                           const int nmaxsave,
-                          const double fc_zero_threshold);
+                          const double fc_zero_threshold,
+                          const int nrandom,
+                          const int random_pattern_seed);
 
     void set_optimize_vars(ALM *alm,
                            const std::vector<std::vector<double>> &u_train_in,
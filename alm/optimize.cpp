@@ -20,7 +20,9 @@
 #include "symmetry.h"
 #include "timer.h"
 #include <iostream>
+#include <iomanip>
 #include <cmath>
+#include <random>
 #include <string>
 #include <vector>
 #include <boost/lexical_cast.hpp>
@@ -50,6 +52,17 @@ void Optimize::set_default_variables()
 {
     params = nullptr;
     cv_l1_alpha = 0.0;
+    reset_normal_equation_cache();
+}
+
+void Optimize::reset_normal_equation_cache()
+{
+    AtA_cache.resize(0, 0);
+    Atb_cache.resize(0);
+    fnorm2_cache = 0.0;
+    bnorm2_cache = 0.0;
+    ndata_in_cache = 0;
+    coef_prev_enet.resize(0);
 }
 
 void Optimize::deallocate_variables()
@@ -200,6 +213,15 @@ int Optimize::optimize_main(const Symmetry *symmetry,
         auto maxorder_min = std::min(maxorder, output_maxorder);
         fcs->set_forceconstant_cartesian(maxorder_min,
                                          params);
+
+        if (optcontrol.validation_report) {
+            run_force_validation(maxorder,
+                                 file_prefix,
+                                 symmetry,
+                                 fcs,
+                                 verbosity,
+                                 timer);
+        }
     }
 
     fcs_tmp.clear();
@@ -217,6 +239,199 @@ int Optimize::optimize_main(const Symmetry *symmetry,
     return info_fitting;
 }
 
+void Optimize::run_force_validation(const int maxorder,
+                                    const std::string &file_prefix,
+                                    const Symmetry *symmetry,
+                                    const Fcs *fcs,
+                                    const int verbosity,
+                                    Timer *timer) const
+{
+    // Built-in closing check of a finished fit: the forces of the training
+    // (and, when present, validation) snapshots are recomputed from the
+    // fitted force constants through the same sensing-matrix machinery used
+    // for the fit, and the error distributions over snapshots and atoms are
+    // written to PREFIX.fiterr. This replaces external scripts that re-read
+    // DFSET and the XML just to verify a model.
+
+    timer->start_clock("validation");
+
+    const auto file_fiterr = file_prefix + ".fiterr";
+    std::ofstream ofs(file_fiterr.c_str(), std::ios::out);
+    if (!ofs) {
+        exit("run_force_validation", "cannot open file ", file_fiterr.c_str());
+    }
+
+    ofs << "# Force prediction errors of the fitted model." << std::endl;
+    ofs << "# Forces and errors are in the units of the input DFSET." << std::endl;
+
+    if (verbosity > 0) {
+        std::cout << "  VALIDATE = 1 : Recomputing the forces of the data sets" << std::endl;
+        std::cout << "                 with the fitted force constants ..." << std::endl << std::endl;
+    }
+
+    validate_dataset(maxorder, u_train, f_train,
+                     symmetry, fcs, "training", ofs, verbosity);
+
+    if (u_validation.rows() > 0) {
+        validate_dataset(maxorder, u_validation, f_validation,
+                         symmetry, fcs, "validation", ofs, verbosity);
+    }
+
+    ofs.close();
+
+    timer->stop_clock("validation");
+
+    if (verbosity > 0) {
+        std::cout << "  Error distributions are saved to the file " << file_fiterr << std::endl;
+        std::cout << "  Time Elapsed (validation): "
+                  << timer->get_walltime("validation") << " sec." << std::endl << std::endl;
+    }
+}
+
+void Optimize::validate_dataset(const int maxorder,
+                                const DataMatrix &u_in,
+                                const DataMatrix &f_in,
+                                const Symmetry *symmetry,
+                                const Fcs *fcs,
+                                const std::string &label,
+                                std::ofstream &ofs,
+                                const int verbosity) const
+{
+    const auto natmin = symmetry->get_nat_prim();
+    const auto natmin3 = 3 * natmin;
+    const auto ntran = symmetry->get_ntran();
+    const auto nat = natmin * ntran;
+    const auto ndata = static_cast<size_t>(u_in.rows());
+
+    size_t ncols = 0;
+    for (auto i = 0; i < maxorder; ++i) {
+        ncols += fcs->get_nequiv()[i].size();
+    }
+
+    const auto rows_per_snapshot = static_cast<size_t>(natmin3) * ntran;
+
+    // The snapshots are processed in blocks so that the sensing matrix of
+    // one block stays within ~512 MB regardless of the data set size.
+    const auto nblock = std::max(static_cast<size_t>(1),
+                                 (static_cast<size_t>(1) << 29)
+                                 / (sizeof(double) * rows_per_snapshot * ncols));
+
+    // Map each (translation, atom-in-primitive-cell) row pair of the
+    // sensing matrix back to the supercell atom whose original force the
+    // row carries, so that the errors can be attributed per atom of the
+    // input structure.
+    std::vector<std::vector<int>> atom_of_row(ntran, std::vector<int>(natmin, -1));
+    for (size_t jat = 0; jat < nat; ++jat) {
+        for (size_t itran = 0; itran < ntran; ++itran) {
+            const auto n_mapped = symmetry->get_map_sym()[jat][symmetry->get_symnum_tran()[itran]];
+            const auto iprim = inprim_index(3 * n_mapped, symmetry);
+            if (iprim >= 0) atom_of_row[itran][iprim / 3] = jat;
+        }
+    }
+
+    Eigen::Map<const Eigen::VectorXd> x(params, ncols);
+
+    std::vector<double> err2_snapshot(ndata, 0.0), fsq_snapshot(ndata, 0.0);
+    std::vector<double> err2_atom(nat, 0.0), fsq_atom(nat, 0.0);
+
+    std::vector<double> amat, bvec;
+
+    for (size_t ibegin = 0; ibegin < ndata; ibegin += nblock) {
+
+        const auto nsnap = std::min(nblock, ndata - ibegin);
+        const auto nrows = nsnap * rows_per_snapshot;
+
+        get_matrix_elements(maxorder,
+                            amat,
+                            bvec,
+                            u_in.middleRows(ibegin, nsnap),
+                            f_in.middleRows(ibegin, nsnap),
+                            symmetry,
+                            fcs);
+
+        // The sensing matrix is stored column major (see get_matrix_elements),
+        // so the model forces of the whole block follow from one gemv.
+        Eigen::Map<const Eigen::MatrixXd> A(amat.data(), nrows, ncols);
+        Eigen::Map<const Eigen::VectorXd> b(bvec.data(), nrows);
+        const Eigen::VectorXd resid = A * x - b;
+
+        for (size_t isnap = 0; isnap < nsnap; ++isnap) {
+            for (size_t itran = 0; itran < ntran; ++itran) {
+                const auto irow0 = (isnap * ntran + itran) * natmin3;
+                for (auto i = 0; i < natmin3; ++i) {
+                    const auto r = resid[irow0 + i];
+                    const auto fval = b[irow0 + i];
+                    const auto jat = atom_of_row[itran][i / 3];
+                    err2_snapshot[ibegin + isnap] += r * r;
+                    fsq_snapshot[ibegin + isnap] += fval * fval;
+                    err2_atom[jat] += r * r;
+                    fsq_atom[jat] += fval * fval;
+                }
+            }
+        }
+    }
+
+    auto err2_total = 0.0;
+    auto fsq_total = 0.0;
+    size_t isnap_worst = 0;
+
+    for (size_t i = 0; i < ndata; ++i) {
+        err2_total += err2_snapshot[i];
+        fsq_total += fsq_snapshot[i];
+        if (err2_snapshot[i] > err2_snapshot[isnap_worst]) isnap_worst = i;
+    }
+
+    ofs << "#" << std::endl;
+    ofs << "# Data set: " << label << " (" << ndata << " snapshots)" << std::endl;
+    ofs << "# Snapshot index (within the used range), RMS force error, RMS force, relative error (%)"
+        << std::endl;
+
+    for (size_t i = 0; i < ndata; ++i) {
+        ofs << std::setw(8) << i + 1;
+        ofs << std::setw(15) << std::scientific << std::setprecision(6)
+            << std::sqrt(err2_snapshot[i] / static_cast<double>(rows_per_snapshot));
+        ofs << std::setw(15)
+            << std::sqrt(fsq_snapshot[i] / static_cast<double>(rows_per_snapshot));
+        if (fsq_snapshot[i] > 0.0) {
+            ofs << std::setw(15) << std::sqrt(err2_snapshot[i] / fsq_snapshot[i]) * 100.0;
+        } else {
+            ofs << std::setw(15) << 0.0;
+        }
+        ofs << std::endl;
+    }
+
+    ofs << "#" << std::endl;
+    ofs << "# Atom index (supercell), RMS force error, RMS force, relative error (%)" << std::endl;
+
+    const auto nentry_atom = static_cast<double>(3 * ndata);
+
+    for (size_t jat = 0; jat < nat; ++jat) {
+        ofs << std::setw(8) << jat + 1;
+        ofs << std::setw(15) << std::scientific << std::setprecision(6)
+            << std::sqrt(err2_atom[jat] / nentry_atom);
+        ofs << std::setw(15) << std::sqrt(fsq_atom[jat] / nentry_atom);
+        if (fsq_atom[jat] > 0.0) {
+            ofs << std::setw(15) << std::sqrt(err2_atom[jat] / fsq_atom[jat]) * 100.0;
+        } else {
+            ofs << std::setw(15) << 0.0;
+        }
+        ofs << std::endl;
+    }
+
+    if (verbosity > 0) {
+        std::cout << "  " << label << " set (" << ndata << " snapshots):" << std::endl;
+        std::cout << "    RMS force error: "
+                  << std::sqrt(err2_total / static_cast<double>(ndata * rows_per_snapshot))
+                  << std::endl;
+        if (fsq_total > 0.0) {
+            std::cout << "    Relative error (%): "
+                      << std::sqrt(err2_total / fsq_total) * 100.0 << std::endl;
+        }
+        std::cout << "    Largest per-snapshot error at snapshot "
+                  << isnap_worst + 1 << " of the used range." << std::endl << std::endl;
+    }
+}
+
 int Optimize::least_squares(const int maxorder,
                             const size_t N,
                             const size_t N_new,
@@ -274,6 +489,40 @@ int Optimize::least_squares(const int maxorder,
                                                    optcontrol.sparsesolver,
                                                    verbosity);
 
+        } else if (optcontrol.stream_sensing_matrix) {
+
+            // Stream row blocks of the sensing matrix and accumulate the
+            // normal equations instead of storing the full dense matrix.
+            // (Requires less memory for very large training sets.)
+
+            Eigen::MatrixXd AtA;
+            Eigen::VectorXd Atb;
+            double fnorm2, bnorm2;
+
+            get_normal_equations_algebraic_constraint(maxorder,
+                                                      AtA,
+                                                      Atb,
+                                                      u_train,
+                                                      f_train,
+                                                      fnorm2,
+                                                      bnorm2,
+                                                      symmetry,
+                                                      fcs,
+                                                      constraint,
+                                                      verbosity);
+            fnorm = std::sqrt(fnorm2);
+
+            info_fitting = fit_normal_equations(N_new,
+                                                AtA,
+                                                Atb,
+                                                param_out,
+                                                fnorm,
+                                                bnorm2,
+                                                maxorder,
+                                                fcs,
+                                                constraint,
+                                                verbosity);
+
         } else {
 
             // Use a direct solver for a dense matrix
@@ -657,7 +906,7 @@ double Optimize::run_auto_cv(const std::string job_prefix,
         }
     }
 
-    const auto nstructures = u_train.size();
+    const auto nstructures = static_cast<size_t>(u_train.rows());
     const auto nsets = optcontrol.cross_validation;
 
     if (nsets > nstructures) {
@@ -672,11 +921,8 @@ double Optimize::run_auto_cv(const std::string job_prefix,
         }
     }
 
-    std::vector<std::vector<double>> u_train_tmp, u_validation_tmp;
-    std::vector<std::vector<double>> f_train_tmp, f_validation_tmp;
-
-    std::vector<double> amat_1D, amat_1D_validation;
-    std::vector<double> bvec, bvec_validation;
+    std::vector<double> amat_1D;
+    std::vector<double> bvec;
     std::vector<double> alphas, training_error, validation_error;
     std::vector<std::vector<int>> nonzeros;
     std::vector<std::vector<double>> training_error_accum, validation_error_accum;
@@ -687,62 +933,93 @@ double Optimize::run_auto_cv(const std::string job_prefix,
 
     if (verbosity > 0) {
         std::cout << "  Start " << nsets << "-fold CV with "
-                  << u_train.size() << " Datasets" << std::endl;
+                  << u_train.rows() << " Datasets" << std::endl;
         std::cout << std::endl;
     }
 
+    // Build the sensing matrix of the full training set once. Each
+    // structure occupies a contiguous block of rows, so the training and
+    // validation matrices of every fold are row-block copies of the full
+    // matrix; the old driver regenerated the matrix from scratch up to
+    // three times per fold.
+    std::vector<double> bvec_orig_full;
+
+    get_matrix_elements_algebraic_constraint(maxorder,
+                                             amat_1D,
+                                             bvec,
+                                             u_train,
+                                             f_train,
+                                             fnorm,
+                                             symmetry,
+                                             fcs,
+                                             constraint,
+                                             &bvec_orig_full);
+
+    const auto nrows_full = bvec.size();
+    const auto nrows_per_structure = nrows_full / nstructures;
+
+    Eigen::Map<Eigen::MatrixXd> A_full(&amat_1D[0], nrows_full, N_new);
+    Eigen::Map<Eigen::VectorXd> b_full(&bvec[0], nrows_full);
+
     if (optcontrol.linear_model == 3) {
-        get_matrix_elements_algebraic_constraint(maxorder,
-                                                 amat_1D,
-                                                 bvec,
-                                                 u_train,
-                                                 f_train,
-                                                 fnorm,
-                                                 symmetry,
-                                                 fcs,
-                                                 constraint);
-
-        Eigen::MatrixXd A_full = Eigen::Map<Eigen::MatrixXd>(&amat_1D[0], amat_1D.size() / N_new, N_new);
-        Eigen::VectorXd b_full = Eigen::Map<Eigen::VectorXd>(&bvec[0], bvec.size());
         Eigen::VectorXd x_ols = A_full.colPivHouseholderQr().solve(b_full);
         weight_adalasso = x_ols.cwiseAbs();
-    }
+
+        // Scale the columns once; the fold slices below inherit the weights.
+        for (size_t j = 0; j < N_new; ++j) {
+            A_full.col(j) *= weight_adalasso(j);
+        }
+    }
+
+    auto make_fold_matrices = [&](const int iset_in,
+                                  const size_t istart_structure,
+                                  Eigen::MatrixXd &A_out,
+                                  Eigen::VectorXd &b_out,
+                                  double &fnorm_out,
+                                  Eigen::MatrixXd &A_validation_out,
+                                  Eigen::VectorXd &b_validation_out,
+                                  double &fnorm_validation_out) {
+        const auto row_start = istart_structure * nrows_per_structure;
+        const auto nrow_validation = ndata_block[iset_in] * nrows_per_structure;
+        const auto row_end = row_start + nrow_validation;
+        const auto nrow_rest = nrows_full - row_end;
+
+        A_out.resize(nrows_full - nrow_validation, N_new);
+        b_out.resize(nrows_full - nrow_validation);
+
+        A_out.topRows(row_start) = A_full.topRows(row_start);
+        A_out.bottomRows(nrow_rest) = A_full.bottomRows(nrow_rest);
+        b_out.head(row_start) = b_full.head(row_start);
+        b_out.tail(nrow_rest) = b_full.tail(nrow_rest);
+
+        A_validation_out = A_full.middleRows(row_start, nrow_validation);
+        b_validation_out = b_full.segment(row_start, nrow_validation);
+
+        auto sum_train = 0.0;
+        auto sum_validation = 0.0;
+        for (size_t i = 0; i < nrows_full; ++i) {
+            if (i >= row_start && i < row_end) {
+                sum_validation += bvec_orig_full[i] * bvec_orig_full[i];
+            } else {
+                sum_train += bvec_orig_full[i] * bvec_orig_full[i];
+            }
+        }
+        fnorm_out = std::sqrt(sum_train);
+        fnorm_validation_out = std::sqrt(sum_validation);
+    };
 
     if (optcontrol.l1_alpha_max <= 0) {
         estimated_max_alpha = 0;
         for (auto iset = 0; iset < nsets; ++iset) {
-            const auto istart_validation = ishift;
-            const auto iend_validation = istart_validation + ndata_block[iset];
-
-            u_train_tmp.clear();
-            f_train_tmp.clear();
-            u_validation_tmp.clear();
-            f_validation_tmp.clear();
-
-            for (auto idata = 0; idata < nstructures; ++idata) {
-                if (idata >= istart_validation && idata < iend_validation) {
-                    u_validation_tmp.emplace_back(u_train[idata]);
-                    f_validation_tmp.emplace_back(f_train[idata]);
-                } else {
-                    u_train_tmp.emplace_back(u_train[idata]);
-                    f_train_tmp.emplace_back(f_train[idata]);
-                }
-            }
-            ishift += ndata_block[iset];
+            Eigen::MatrixXd A, A_validation;
+            Eigen::VectorXd b, b_validation;
+            double fnorm_tmp, fnorm_validation_tmp;
 
-            get_matrix_elements_algebraic_constraint(maxorder,
-                                                     amat_1D,
-                                                     bvec,
-                                                     u_train_tmp,
-                                                     f_train_tmp,
-                                                     fnorm,
-                                                     symmetry,
-                                                     fcs,
-                                                     constraint);
+            make_fold_matrices(iset, ishift,
+                               A, b, fnorm_tmp,
+                               A_validation, b_validation, fnorm_validation_tmp);
+            ishift += ndata_block[iset];
 
-            Eigen::MatrixXd A = Eigen::Map<Eigen::MatrixXd>(&amat_1D[0], amat_1D.size() / N_new, N_new);
-            Eigen::VectorXd b = Eigen::Map<Eigen::VectorXd>(&bvec[0], bvec.size());
-            if (optcontrol.linear_model == 3) A = A * weight_adalasso.asDiagonal();
             const auto this_estimated_max_alpha = get_estimated_max_alpha(A, b);
 
             if (verbosity > 0) {
@@ -764,56 +1041,15 @@ double Optimize::run_auto_cv(const std::string job_prefix,
             std::cout << std::endl;
             std::cout << "  SET : " << std::setw(3) << iset + 1 << std::endl;
         }
-        const auto istart_validation = ishift;
-        const auto iend_validation = istart_validation + ndata_block[iset];
 
-        u_train_tmp.clear();
-        f_train_tmp.clear();
-        u_validation_tmp.clear();
-        f_validation_tmp.clear();
+        Eigen::MatrixXd A, A_validation;
+        Eigen::VectorXd b, b_validation;
 
-        for (auto idata = 0; idata < nstructures; ++idata) {
-            if (idata >= istart_validation && idata < iend_validation) {
-                u_validation_tmp.emplace_back(u_train[idata]);
-                f_validation_tmp.emplace_back(f_train[idata]);
-            } else {
-                u_train_tmp.emplace_back(u_train[idata]);
-                f_train_tmp.emplace_back(f_train[idata]);
-            }
-        }
+        make_fold_matrices(iset, ishift,
+                           A, b, fnorm,
+                           A_validation, b_validation, fnorm_validation);
         ishift += ndata_block[iset];
 
-        get_matrix_elements_algebraic_constraint(maxorder,
-                                                 amat_1D,
-                                                 bvec,
-                                                 u_train_tmp,
-                                                 f_train_tmp,
-                                                 fnorm,
-                                                 symmetry,
-                                                 fcs,
-                                                 constraint);
-
-        get_matrix_elements_algebraic_constraint(maxorder,
-                                                 amat_1D_validation,
-                                                 bvec_validation,
-                                                 u_validation_tmp,
-                                                 f_validation_tmp,
-                                                 fnorm_validation,
-                                                 symmetry,
-                                                 fcs,
-                                                 constraint);
-
-        Eigen::MatrixXd A = Eigen::Map<Eigen::MatrixXd>(&amat_1D[0], amat_1D.size() / N_new, N_new);
-        Eigen::VectorXd b = Eigen::Map<Eigen::VectorXd>(&bvec[0], bvec.size());
-        Eigen::MatrixXd A_validation = Eigen::Map<Eigen::MatrixXd>(&amat_1D_validation[0],
-                                                                   amat_1D_validation.size() / N_new, N_new);
-        Eigen::VectorXd b_validation = Eigen::Map<Eigen::VectorXd>(&bvec_validation[0], bvec_validation.size());
-
-        if (optcontrol.linear_model == 3) {
-            A = A * weight_adalasso.asDiagonal();
-            A_validation = A_validation * weight_adalasso.asDiagonal();
-        }
-
         if (verbosity > 0) {
             std::cout << "  Recommended CV_MAXALPHA = "
                       << get_estimated_max_alpha(A, b)
@@ -1070,7 +1306,14 @@ void Optimize::solution_path(const int maxorder,
     size_t M = A.rows();
     size_t M_validation = A_validation.rows();
 
-    Prod.setZero(N_new, N_new);
+    if (N_new <= nmax_gram_cache) {
+        Prod.setZero(N_new, N_new);
+    } else if (verbosity > 0) {
+        std::cout << "  The number of columns (" << N_new
+                  << ") exceeds the Gram-cache limit;" << std::endl;
+        std::cout << "  coordinate descent will maintain residual vectors instead."
+                  << std::endl << std::endl;
+    }
     grad0.resize(N_new);
     grad.resize(N_new);
     x.setZero(N_new);
@@ -1109,6 +1352,17 @@ void Optimize::solution_path(const int maxorder,
     grad0 = A.transpose() * b;
     grad = grad0;
 
+    // Strong-rule screening along the path (sequential rule): when moving
+    // from lambda_{k-1} to lambda_k, a column j with
+    // |grad_j| / M < 2 lambda_k - lambda_{k-1} is discarded before the
+    // coordinate descent, and the KKT conditions of the discarded columns
+    // are re-checked afterwards; violators are added back and the descent
+    // is repeated. With warm starts this makes most path points nearly
+    // free, since only a small superset of the active set is swept.
+    std::vector<int> screened_cols;
+    std::vector<bool> in_screen(N_new);
+    auto lambda_prev = 0.0;
+
     if (verbosity == 1) std::cout << std::setw(3);
 
     for (size_t ialpha = 0; ialpha < alphas.size(); ++ialpha) {
@@ -1126,11 +1380,55 @@ void Optimize::solution_path(const int maxorder,
             scale_beta_enet(i) = 1.0 / (1.0 / scale_beta(i) + (1.0 - optcontrol.l1_ratio) * l1_alpha);
         }
 
-        coordinate_descent(M, N_new, l1_alpha,
-                           initialize_mode,
-                           x, A, b, grad0, has_prod, Prod, grad, fnorm,
-                           scale_beta_enet,
-                           verbosity);
+        const auto lambda_now = l1_alpha * optcontrol.l1_ratio;
+
+        if (initialize_mode == 1) {
+
+            // The gradient is up to date in the Gram mode; without the
+            // cache it has to be recomputed from the warm-start solution.
+            if (Prod.size() == 0) grad = grad0 - A.transpose() * (A * x);
+
+            const auto threshold = (2.0 * lambda_now - lambda_prev) * static_cast<double>(M);
+
+            screened_cols.clear();
+            for (size_t i = 0; i < N_new; ++i) {
+                in_screen[i] = (x(i) != 0.0) || (std::abs(grad(i)) >= threshold);
+                if (in_screen[i]) screened_cols.push_back(i);
+            }
+
+            while (true) {
+                coordinate_descent(M, N_new, l1_alpha,
+                                   initialize_mode,
+                                   x, A, b, grad0, has_prod, Prod, grad, fnorm,
+                                   scale_beta_enet,
+                                   verbosity,
+                                   &screened_cols);
+
+                if (screened_cols.size() == N_new) break;
+
+                // KKT check of the discarded columns
+                if (Prod.size() == 0) grad = grad0 - A.transpose() * (A * x);
+
+                auto kkt_violated = false;
+                for (size_t i = 0; i < N_new; ++i) {
+                    if (in_screen[i]) continue;
+                    if (std::abs(grad(i)) > lambda_now * static_cast<double>(M)) {
+                        in_screen[i] = true;
+                        screened_cols.push_back(i);
+                        kkt_violated = true;
+                    }
+                }
+                if (!kkt_violated) break;
+            }
+        } else {
+            coordinate_descent(M, N_new, l1_alpha,
+                               initialize_mode,
+                               x, A, b, grad0, has_prod, Prod, grad, fnorm,
+                               scale_beta_enet,
+                               verbosity);
+        }
+
+        lambda_prev = lambda_now;
 
         double correction_intercept = 0.0;
         for (size_t i = 0; i < N_new; ++i) {
@@ -1266,7 +1564,14 @@ void Optimize::optimize_with_given_l1alpha(const int maxorder,
         A = A * weight_adalasso.asDiagonal();
     }
 
-    Prod.setZero(N_new, N_new);
+    if (N_new <= nmax_gram_cache) {
+        Prod.setZero(N_new, N_new);
+    } else if (verbosity > 0) {
+        std::cout << "  The number of columns (" << N_new
+                  << ") exceeds the Gram-cache limit;" << std::endl;
+        std::cout << "  coordinate descent will maintain residual vectors instead."
+                  << std::endl << std::endl;
+    }
     grad0.resize(N_new);
     grad.resize(N_new);
     x.setZero(N_new);
@@ -1319,13 +1624,38 @@ void Optimize::optimize_with_given_l1alpha(const int maxorder,
         scale_beta(i) = 1.0 / (1.0 / scale_beta(i) + (1.0 - optcontrol.l1_ratio) * optcontrol.l1_alpha);
     }
 
+    // Warm start from the coefficients of the previous fit when available
+    // (e.g. after append_training_data). The gradient is made consistent
+    // with the nonzero starting point before entering the solver.
+    auto warm_start = 0;
+    if (coef_prev_enet.size() == static_cast<long>(N_new)) {
+        x = coef_prev_enet;
+        if (Prod.size() > 0) {
+            for (i = 0; i < N_new; ++i) {
+                if (std::abs(x(i)) > 0.0) {
+                    if (!has_prod[i]) {
+                        Prod.col(i) = A.transpose() * A.col(i);
+                        has_prod[i] = true;
+                    }
+                    grad -= Prod.col(i) * x(i);
+                }
+            }
+        }
+        warm_start = 1;
+        if (verbosity > 0) {
+            std::cout << "  Warm start from the previous coefficients." << std::endl << std::endl;
+        }
+    }
+
     // Coordinate Descent Method
     coordinate_descent(M, N_new, optcontrol.l1_alpha,
-                       0,
+                       warm_start,
                        x, A, b, grad0, has_prod, Prod, grad, fnorm,
                        scale_beta,
                        verbosity);
 
+    coef_prev_enet = x;
+
     if (optcontrol.linear_model == 2) {
         for (i = 0; i < N_new; ++i) {
             param_out[i] = x[i] * factor_std[i];
@@ -1432,20 +1762,38 @@ void Optimize::get_standardizer(const Eigen::MatrixXd &Amat,
     if (scale_beta.size() != ncols) scale_beta.resize(ncols);
 
     const auto inv_nrows = 1.0 / static_cast<double>(nrows);
-    double sum1, sum2;
+
+    // One fused pass per column: the running mean and the sum of squared
+    // deviations are accumulated together (Welford), which halves the
+    // memory traffic compared with separate mean and variance sweeps and
+    // avoids the cancellation of the sum-of-squares formula. The columns
+    // are contiguous in the column-major storage, so each pass streams
+    // the data once.
 
     if (optcontrol.standardize) {
-        for (auto j = 0; j < ncols; ++j) {
-            sum1 = Amat.col(j).sum() * inv_nrows;
-            sum2 = Amat.col(j).dot(Amat.col(j)) * inv_nrows;
-            mean(j) = sum1;
-            dev(j) = std::sqrt(sum2 - sum1 * sum1);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (long j = 0; j < ncols; ++j) {
+            const auto *col = Amat.col(j).data();
+            auto mean_run = 0.0;
+            auto m2_run = 0.0;
+            for (long i = 0; i < nrows; ++i) {
+                const auto delta = col[i] - mean_run;
+                mean_run += delta / static_cast<double>(i + 1);
+                m2_run += delta * (col[i] - mean_run);
+            }
+            mean(j) = mean_run;
+            dev(j) = std::sqrt(m2_run * inv_nrows);
             factor_std(j) = 1.0 / dev(j);
             scale_beta(j) = 1.0;
         }
     } else {
-        for (auto j = 0; j < ncols; ++j) {
-            sum2 = Amat.col(j).dot(Amat.col(j)) * inv_nrows;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (long j = 0; j < ncols; ++j) {
+            const auto sum2 = Amat.col(j).squaredNorm() * inv_nrows;
             mean(j) = 0.0;
             dev(j) = 1.0;
             factor_std(j) = 1.0;
@@ -1459,15 +1807,17 @@ void Optimize::apply_standardizer(Eigen::MatrixXd &Amat,
                                   const Eigen::VectorXd &dev) const
 {
     const auto ncols = Amat.cols();
-    const auto nrows = Amat.rows();
     if (mean.size() != ncols || dev.size() != ncols) {
         exit("apply_standardizer", "The number of colums is inconsistent.");
     }
 
-    for (auto i = 0; i < nrows; ++i) {
-        for (auto j = 0; j < ncols; ++j) {
-            Amat(i, j) = (Amat(i, j) - mean(j)) / dev(j);
-        }
+    // Single fused shift-and-scale sweep, column by column so that the
+    // writes stream through the column-major storage exactly once.
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (long j = 0; j < ncols; ++j) {
+        Amat.col(j) = (Amat.col(j).array() - mean(j)) / dev(j);
     }
 }
 
@@ -1476,25 +1826,20 @@ double Optimize::get_estimated_max_alpha(const Eigen::MatrixXd &Amat,
 {
     const auto ncols = Amat.cols();
     const auto nrows = Amat.rows();
-    Eigen::MatrixXd C = Amat;
 
-    Eigen::VectorXd mean = Eigen::VectorXd::Zero(Amat.cols());
-    Eigen::VectorXd dev = Eigen::VectorXd::Ones(Amat.cols());
+    // The standardization is applied lazily to the correlation vector:
+    // ((A - 1 mean^T) D^-1)^T b = D^-1 (A^T b - mean * sum(b)), so the
+    // matrix is read once by the matrix-vector product and never copied
+    // or rewritten.
+
+    Eigen::VectorXd C = Amat.transpose() * bvec;
 
     if (optcontrol.standardize) {
-        Eigen::VectorXd factor_std, scale_beta;
-        factor_std.resize(Amat.cols());
-        scale_beta.resize(Amat.cols());
+        Eigen::VectorXd mean, dev, factor_std, scale_beta;
         get_standardizer(Amat, mean, dev, factor_std, scale_beta);
+        C = (C - mean * bvec.sum()).cwiseQuotient(dev);
     }
 
-    for (auto i = 0; i < nrows; ++i) {
-        for (auto j = 0; j < ncols; ++j) {
-            C(i, j) = (C(i, j) - mean(j)) / dev(j);
-        }
-    }
-
-    C = C.transpose() * bvec;
     auto max_alpha = 0.0;
 
     for (auto i = 0; i < ncols; ++i) {
@@ -1505,26 +1850,18 @@ double Optimize::get_estimated_max_alpha(const Eigen::MatrixXd &Amat,
     return max_alpha;
 }
 
-void Optimize::apply_scaler_displacement(std::vector<std::vector<double>> &u_inout,
+void Optimize::apply_scaler_displacement(DataMatrix &u_inout,
                                          const double normalization_factor,
                                          const bool scale_back) const
 {
-    const auto nrows = u_inout.size();
-    const auto ncols = u_inout[0].size();
+    // The default ENET_DNORM = 1 makes both directions a no-op; skip the
+    // full sweep over the displacement data in that case.
+    if (std::abs(normalization_factor - 1.0) < eps) return;
 
     if (scale_back) {
-        for (auto i = 0; i < nrows; ++i) {
-            for (auto j = 0; j < ncols; ++j) {
-                u_inout[i][j] *= normalization_factor;
-            }
-        }
+        u_inout *= normalization_factor;
     } else {
-        const auto inv_scale_factor = 1.0 / normalization_factor;
-        for (auto i = 0; i < nrows; ++i) {
-            for (auto j = 0; j < ncols; ++j) {
-                u_inout[i][j] *= inv_scale_factor;
-            }
-        }
+        u_inout *= 1.0 / normalization_factor;
     }
 }
 
@@ -1601,26 +1938,16 @@ void Optimize::finalize_scalers(const int maxorder,
     }
 }
 
-void Optimize::apply_basis_converter(std::vector<std::vector<double>> &u_multi,
+void Optimize::apply_basis_converter(DataMatrix &u_multi,
                                      Eigen::Matrix3d cmat) const
 {
-    // Convert the basis of displacements from Cartesian to fractional
-    const auto nrows = u_multi.size();
-    const auto ncols = u_multi[0].size();
-    size_t i, j;
-    Eigen::Vector3d vec_tmp;
+    // Convert the basis of displacements from Cartesian to fractional.
+    // Each 3-column block holds one atom across all rows, so the
+    // conversion is a blocked matrix product over the flat storage.
+    const auto nat = u_multi.cols() / 3;
 
-    const auto nat = ncols / 3;
-    for (i = 0; i < nrows; ++i) {
-        for (j = 0; j < nat; ++j) {
-            for (int k = 0; k < 3; ++k) {
-                vec_tmp(k) = u_multi[i][3 * j + k];
-            }
-            vec_tmp = cmat * vec_tmp;
-            for (int k = 0; k < 3; ++k) {
-                u_multi[i][3 * j + k] = vec_tmp(k);
-            }
-        }
+    for (Eigen::Index j = 0; j < nat; ++j) {
+        u_multi.middleCols(3 * j, 3) = u_multi.middleCols(3 * j, 3) * cmat.transpose();
     }
 }
 
@@ -1649,42 +1976,195 @@ void Optimize::apply_basis_converter_amat(const int natmin3,
 
 void Optimize::set_u_train(const std::vector<std::vector<double>> &u_train_in)
 {
-    u_train.clear();
-    u_train = u_train_in;
-    u_train.shrink_to_fit();
+    copy_dataset_to_matrix(u_train_in, u_train);
+    reset_normal_equation_cache();
 }
 
 void Optimize::set_f_train(const std::vector<std::vector<double>> &f_train_in)
 {
-    f_train.clear();
-    f_train = f_train_in;
-    f_train.shrink_to_fit();
+    copy_dataset_to_matrix(f_train_in, f_train);
+    reset_normal_equation_cache();
+}
+
+void Optimize::copy_dataset_to_matrix(const std::vector<std::vector<double>> &data_in,
+                                      DataMatrix &mat_out) const
+{
+    const auto nrows = data_in.size();
+    const auto ncols = nrows > 0 ? data_in[0].size() : 0;
+
+    mat_out.resize(nrows, ncols);
+    for (size_t i = 0; i < nrows; ++i) {
+        for (size_t j = 0; j < ncols; ++j) {
+            mat_out(i, j) = data_in[i][j];
+        }
+    }
+}
+
+void Optimize::append_training_data(const std::vector<std::vector<double>> &u_in,
+                                    const std::vector<std::vector<double>> &f_in)
+{
+    if (u_in.size() != f_in.size()) {
+        exit("append_training_data",
+             "The lengths of displacement array and force array are diferent.");
+    }
+    if (u_train.rows() > 0 && !u_in.empty()
+        && u_in[0].size() != static_cast<size_t>(u_train.cols())) {
+        exit("append_training_data",
+             "The number of degrees of freedom does not match the existing training set.");
+    }
+
+    if (u_in.empty()) return;
+
+    const auto nold = u_train.rows();
+    const auto nadd = static_cast<Eigen::Index>(u_in.size());
+    const auto ncols = nold > 0 ? u_train.cols()
+                                : static_cast<Eigen::Index>(u_in[0].size());
+
+    u_train.conservativeResize(nold + nadd, ncols);
+    f_train.conservativeResize(nold + nadd, ncols);
+
+    for (Eigen::Index i = 0; i < nadd; ++i) {
+        for (Eigen::Index j = 0; j < ncols; ++j) {
+            u_train(nold + i, j) = u_in[i][j];
+            f_train(nold + i, j) = f_in[i][j];
+        }
+    }
+}
+
+int Optimize::fit_incremental(const int maxorder,
+                              const int output_maxorder,
+                              const Symmetry *symmetry,
+                              Fcs *fcs,
+                              const Constraint *constraint,
+                              const int verbosity)
+{
+    // Refit after append_training_data without paying for the snapshots
+    // that were already incorporated: the cached normal equations are
+    // rank-updated with the appended configurations only and re-solved.
+    // A 5% data increase therefore costs roughly 5% of a fresh fit.
+
+    size_t i;
+
+    if (!constraint->get_constraint_algebraic()) {
+        exit("fit_incremental",
+             "Incremental fitting requires ICONST = 10 or ICONST = 11.");
+    }
+
+    size_t N = 0;
+    size_t N_new = 0;
+    for (i = 0; i < maxorder; ++i) {
+        N += fcs->get_nequiv()[i].size();
+        N_new += constraint->get_index_bimap(i).size();
+    }
+
+    // Rebuild from scratch when the model changed under the cache or the
+    // training set was replaced rather than appended to.
+    if (AtA_cache.rows() != static_cast<long>(N_new)
+        || ndata_in_cache > static_cast<size_t>(u_train.rows())) {
+        const auto ndata_stale = ndata_in_cache;
+        reset_normal_equation_cache();
+        if (verbosity > 0 && ndata_stale > 0) {
+            std::cout << "  The cached normal equations are stale; rebuilding from scratch."
+                      << std::endl;
+        }
+    }
+
+    if (ndata_in_cache < static_cast<size_t>(u_train.rows())) {
+        if (verbosity > 0 && ndata_in_cache > 0) {
+            std::cout << "  Updating cached normal equations with "
+                      << u_train.rows() - ndata_in_cache
+                      << " appended configurations ..." << std::endl;
+        }
+        get_normal_equations_algebraic_constraint(maxorder,
+                                                  AtA_cache,
+                                                  Atb_cache,
+                                                  u_train,
+                                                  f_train,
+                                                  fnorm2_cache,
+                                                  bnorm2_cache,
+                                                  symmetry,
+                                                  fcs,
+                                                  constraint,
+                                                  verbosity,
+                                                  ndata_in_cache,
+                                                  ndata_in_cache == 0);
+        ndata_in_cache = u_train.rows();
+    } else if (verbosity > 0) {
+        std::cout << "  No new training data since the last fit; "
+                  << "reusing the cached normal equations." << std::endl;
+    }
+
+    std::vector<double> fcs_tmp(N, 0.0);
+
+    const auto info_fitting = fit_normal_equations(N_new,
+                                                   AtA_cache,
+                                                   Atb_cache,
+                                                   fcs_tmp,
+                                                   std::sqrt(fnorm2_cache),
+                                                   bnorm2_cache,
+                                                   maxorder,
+                                                   fcs,
+                                                   constraint,
+                                                   verbosity);
+
+    if (info_fitting == 0) {
+        if (params) {
+            deallocate(params);
+        }
+        allocate(params, N);
+        for (i = 0; i < N; ++i) params[i] = fcs_tmp[i];
+
+        fcs->set_forceconstant_cartesian(std::min(maxorder, output_maxorder),
+                                         params);
+    }
+
+    return info_fitting;
 }
 
 void Optimize::set_validation_data(const std::vector<std::vector<double>> &u_validation_in,
                                    const std::vector<std::vector<double>> &f_validation_in)
 {
-    u_validation.clear();
-    f_validation.clear();
-    u_validation = u_validation_in;
-    f_validation = f_validation_in;
-    u_validation.shrink_to_fit();
-    f_validation.shrink_to_fit();
+    copy_dataset_to_matrix(u_validation_in, u_validation);
+    copy_dataset_to_matrix(f_validation_in, f_validation);
 }
 
 std::vector<std::vector<double>> Optimize::get_u_train() const
 {
-    return u_train;
+    std::vector<std::vector<double>> u_out(u_train.rows(),
+                                           std::vector<double>(u_train.cols()));
+    for (Eigen::Index i = 0; i < u_train.rows(); ++i) {
+        for (Eigen::Index j = 0; j < u_train.cols(); ++j) {
+            u_out[i][j] = u_train(i, j);
+        }
+    }
+    return u_out;
 }
 
 std::vector<std::vector<double>> Optimize::get_f_train() const
+{
+    std::vector<std::vector<double>> f_out(f_train.rows(),
+                                           std::vector<double>(f_train.cols()));
+    for (Eigen::Index i = 0; i < f_train.rows(); ++i) {
+        for (Eigen::Index j = 0; j < f_train.cols(); ++j) {
+            f_out[i][j] = f_train(i, j);
+        }
+    }
+    return f_out;
+}
+
+const DataMatrix &Optimize::get_u_train_matrix() const
+{
+    return u_train;
+}
+
+const DataMatrix &Optimize::get_f_train_matrix() const
 {
     return f_train;
 }
 
 size_t Optimize::get_number_of_data() const
 {
-    return u_train.size();
+    return u_train.rows();
 }
 
 void Optimize::set_fcs_values(const int maxorder,
@@ -1726,21 +2206,182 @@ void Optimize::set_fcs_values(const int maxorder,
 
 size_t Optimize::get_number_of_rows_sensing_matrix() const
 {
-    return u_train.size() * u_train[0].size();
+    return u_train.rows() * u_train.cols();
 }
 
-int Optimize::fit_without_constraints(const size_t N,
-                                      const size_t M,
-                                      double *amat,
-                                      const double *bvec,
-                                      double *param_out,
-                                      const int verbosity) const
+int Optimize::solve_sketched_lsqr(const size_t M,
+                                  const size_t N,
+                                  const double *amat,
+                                  const double *bvec,
+                                  std::vector<double> &x_out,
+                                  const int verbosity) const
 {
-    int i;
-    int nrhs = 1, nrank, INFO, M_tmp, N_tmp;
-    auto rcond = -1.0;
-    auto f_square = 0.0;
-    double *WORK, *S, *fsum2;
+    // Randomized sketch-and-precondition solver for strongly overdetermined
+    // dense least-squares problems (M >> N). A count sketch compresses the
+    // M x N matrix to s x N with s ~ 4N in a single pass, the R factor of
+    // its QR decomposition preconditions the original system, and LSQR on
+    // A R^{-1} then converges in a few tens of iterations regardless of the
+    // conditioning of A. This avoids the O(MN^2) SVD of dgelss_ while
+    // solving the same problem to full accuracy.
+
+    size_t i, j;
+
+    if (M < N) {
+        exit("solve_sketched_lsqr",
+             "The sketch solver requires an overdetermined problem (M >= N).");
+    }
+
+    Eigen::Map<const Eigen::MatrixXd> A(amat, M, N);
+    Eigen::Map<const Eigen::VectorXd> b(bvec, M);
+
+    const auto nsketch = std::min(M, std::max(4 * N, N + 8));
+
+    if (verbosity > 0) {
+        std::cout << "  Entering fitting routine: sketch-preconditioned LSQR" << std::endl;
+        std::cout << "  Sketch size = " << nsketch << std::endl;
+    }
+
+    // Count sketch: each row of A is added to one random row of the sketch
+    // with a random sign. The seed is fixed so that repeated runs on the
+    // same input reproduce the same force constants.
+
+    std::mt19937 rng(12356);
+    std::uniform_int_distribution<size_t> dist_row(0, nsketch - 1);
+    std::uniform_int_distribution<int> dist_sign(0, 1);
+
+    std::vector<size_t> hash_row(M);
+    std::vector<double> sign_row(M);
+
+    for (i = 0; i < M; ++i) {
+        hash_row[i] = dist_row(rng);
+        sign_row[i] = dist_sign(rng) ? 1.0 : -1.0;
+    }
+
+    Eigen::MatrixXd A_sketch = Eigen::MatrixXd::Zero(nsketch, N);
+
+#ifdef _OPENMP
+#pragma omp parallel for private(i)
+#endif
+    for (long jcol = 0; jcol < N; ++jcol) {
+        for (i = 0; i < M; ++i) {
+            A_sketch(hash_row[i], jcol) += sign_row[i] * A(i, jcol);
+        }
+    }
+
+    const Eigen::HouseholderQR<Eigen::MatrixXd> qr(A_sketch);
+    const Eigen::MatrixXd R = qr.matrixQR().topRows(N).triangularView<Eigen::Upper>();
+
+    for (j = 0; j < N; ++j) {
+        if (std::abs(R(j, j)) < eps12) {
+            exit("solve_sketched_lsqr",
+                 "The sketched matrix is (numerically) rank-deficient.\n"
+                 "  The problem cannot be preconditioned reliably; "
+                 "please rerun with SKETCH = 0.");
+        }
+    }
+
+    const auto Rupper = R.triangularView<Eigen::Upper>();
+
+    // LSQR of Paige & Saunders on B = A R^{-1}, accumulating the solution
+    // y of min |By - b|; the force constants follow from Ry = x at the end.
+
+    const auto tolerance = optcontrol.tolerance_iteration;
+    const auto maxiter = optcontrol.maxnum_iteration;
+
+    Eigen::VectorXd u = b;
+    auto beta = u.norm();
+    if (beta > 0.0) u /= beta;
+
+    Eigen::VectorXd v = Rupper.transpose().solve(A.transpose() * u);
+    auto alpha = v.norm();
+    if (alpha > 0.0) v /= alpha;
+
+    Eigen::VectorXd w = v;
+    Eigen::VectorXd y = Eigen::VectorXd::Zero(N);
+
+    auto phibar = beta;
+    auto rhobar = alpha;
+    auto bnorm_est = 0.0;
+    auto iloop = 0;
+
+    for (iloop = 0; iloop < maxiter; ++iloop) {
+
+        u = A * Rupper.solve(v) - alpha * u;
+        beta = u.norm();
+        if (beta > 0.0) u /= beta;
+
+        v = Rupper.transpose().solve(A.transpose() * u) - beta * v;
+        alpha = v.norm();
+        if (alpha > 0.0) v /= alpha;
+
+        const auto rho = std::sqrt(rhobar * rhobar + beta * beta);
+        const auto cs = rhobar / rho;
+        const auto sn = beta / rho;
+        const auto theta = sn * alpha;
+        rhobar = -cs * alpha;
+        const auto phi = cs * phibar;
+        phibar = sn * phibar;
+
+        y += (phi / rho) * w;
+        w = v - (theta / rho) * w;
+
+        bnorm_est = std::sqrt(bnorm_est * bnorm_est + alpha * alpha
+                              + beta * beta + theta * theta);
+
+        // |B^T r| / (|B| |r|) ~ alpha |cs| / |B| is the normwise backward
+        // error of the preconditioned system.
+        if (alpha * std::abs(cs) <= tolerance * bnorm_est) break;
+    }
+
+    if (iloop == maxiter) {
+        warn("solve_sketched_lsqr",
+             "LSQR did not converge within the maximum number of iterations.");
+    }
+
+    const Eigen::VectorXd x = Rupper.solve(y);
+
+    x_out.resize(N);
+    for (i = 0; i < N; ++i) x_out[i] = x(i);
+
+    if (verbosity > 0) {
+        const Eigen::VectorXd res = b - A * x;
+        const auto rnorm = res.norm();
+        auto backward_error = 0.0;
+        if (rnorm > 0.0) {
+            backward_error = (A.transpose() * res).norm() / (A.norm() * rnorm);
+        }
+        std::cout << "  Number of LSQR iterations: " << iloop + 1 << std::endl;
+        std::cout << "  Estimated normwise backward error: "
+                  << backward_error << std::endl << std::endl;
+        std::cout << "  Residual sum of squares for the solution: "
+                  << rnorm << std::endl;
+        std::cout << "  Fitting error (%) : "
+                  << rnorm / b.norm() * 100.0 << std::endl;
+    }
+
+    return 0;
+}
+
+int Optimize::fit_without_constraints(const size_t N,
+                                      const size_t M,
+                                      double *amat,
+                                      const double *bvec,
+                                      double *param_out,
+                                      const int verbosity) const
+{
+    int i;
+    int nrhs = 1, nrank, INFO, M_tmp, N_tmp;
+    auto rcond = -1.0;
+    auto f_square = 0.0;
+    double *WORK, *S, *fsum2;
+
+    if (optcontrol.use_sketch_solver) {
+        std::vector<double> x_tmp;
+        const auto info_sketch = solve_sketched_lsqr(M, N, amat, bvec,
+                                                     x_tmp, verbosity);
+        for (i = 0; i < N; ++i) param_out[i] = x_tmp[i];
+        return info_sketch;
+    }
 
 
     const auto LMIN = std::min<int>(M, N);
@@ -1935,6 +2576,20 @@ int Optimize::fit_algebraic_constraints(const size_t N,
     auto rcond = -1.0;
     double *WORK, *S, *fsum2;
 
+    if (optcontrol.use_sketch_solver) {
+        std::vector<double> param_irred;
+        const auto info_sketch = solve_sketched_lsqr(M, N, amat, bvec,
+                                                     param_irred, verbosity);
+        if (info_sketch == 0) {
+            recover_original_forceconstants(maxorder,
+                                            param_irred,
+                                            param_out,
+                                            fcs->get_nequiv(),
+                                            constraint);
+        }
+        return info_sketch;
+    }
+
     if (verbosity > 0) {
         std::cout << "  Entering fitting routine: SVD with constraints considered algebraically." << std::endl;
     }
@@ -2014,8 +2669,8 @@ int Optimize::fit_algebraic_constraints(const size_t N,
 void Optimize::get_matrix_elements(const int maxorder,
                                    std::vector<double> &amat,
                                    std::vector<double> &bvec,
-                                   const std::vector<std::vector<double>> &u_in,
-                                   const std::vector<std::vector<double>> &f_in,
+                                   const DataMatrix &u_in,
+                                   const DataMatrix &f_in,
                                    const Symmetry *symmetry,
                                    const Fcs *fcs) const
 {
@@ -2023,16 +2678,16 @@ void Optimize::get_matrix_elements(const int maxorder,
     long irow;
     const auto natmin = symmetry->get_nat_prim();
     const auto natmin3 = 3 * natmin;
-    std::vector<std::vector<double>> u_multi, f_multi;
+    DataMatrix u_multi, f_multi;
 
-    if (u_in.size() != f_in.size()) {
+    if (u_in.rows() != f_in.rows()) {
         exit("get_matrix_elements",
              "The lengths of displacement array and force array are diferent.");
     }
 
-    const auto ndata_fit = u_in.size();
+    const auto ndata_fit = static_cast<size_t>(u_in.rows());
     const auto ncycle = ndata_fit * symmetry->get_ntran();
-    const auto nrows = ndata_fit * u_in[0].size();
+    const auto nrows = ndata_fit * static_cast<size_t>(u_in.cols());
     size_t ncols = 0;
     for (i = 0; i < maxorder; ++i) {
         ncols += fcs->get_nequiv()[i].size();
@@ -2078,7 +2733,7 @@ void Optimize::get_matrix_elements(const int maxorder,
                 iat = symmetry->get_map_p2s()[i][0];
                 for (j = 0; j < 3; ++j) {
                     im = 3 * i + j + natmin3 * irow;
-                    bvec[im] = f_multi[irow][3 * iat + j];
+                    bvec[im] = f_multi(irow, 3 * iat + j);
                 }
             }
 
@@ -2104,7 +2759,7 @@ void Optimize::get_matrix_elements(const int maxorder,
                         amat_tmp = 1.0;
                         for (j = 1; j < order + 2; ++j) {
                             ind[j] = fcs->get_fc_table()[order][mm].elems[j];
-                            amat_tmp *= u_multi[irow][fcs->get_fc_table()[order][mm].elems[j]];
+                            amat_tmp *= u_multi(irow, fcs->get_fc_table()[order][mm].elems[j]);
                         }
                         amat_orig_tmp[k][iparam] -= gamma(order + 2, ind) * fcs->get_fc_table()[order][mm].sign *
                                                     amat_tmp;
@@ -2135,34 +2790,170 @@ void Optimize::get_matrix_elements(const int maxorder,
         deallocate(ind);
         deallocate(amat_orig_tmp);
     }
-
-    u_multi.clear();
-    f_multi.clear();
 }
 
 
+void Optimize::generate_rows_algebraic_constraint(const int maxorder,
+                                                  const double *u_row,
+                                                  const double *f_row,
+                                                  const Symmetry *symmetry,
+                                                  const Fcs *fcs,
+                                                  const Constraint *constraint,
+                                                  int *ind,
+                                                  double **amat_orig_tmp,
+                                                  double **amat_mod_tmp,
+                                                  double *bvec_block,
+                                                  double *bvec_orig_block) const
+{
+    // Generate the 3*natmin rows of the sensing matrix (in the irreducible
+    // representation defined by the constraint information) and the
+    // corresponding entries of the r.h.s. vector for a single displacement
+    // pattern. The caller provides the work arrays so that this routine
+    // can be invoked from inside OpenMP parallel regions without
+    // repeated allocations.
+
+    size_t i, j;
+    int mm, order, iat, k;
+    size_t ishift, iparam;
+    size_t iold, inew;
+    double amat_tmp;
+
+    const auto natmin = symmetry->get_nat_prim();
+    const auto natmin3 = 3 * natmin;
+    size_t ncols = 0;
+    size_t ncols_new = 0;
+
+    for (i = 0; i < maxorder; ++i) {
+        ncols += fcs->get_nequiv()[i].size();
+        ncols_new += constraint->get_index_bimap(i).size();
+    }
+
+    // generate r.h.s vector B
+    for (i = 0; i < natmin; ++i) {
+        iat = symmetry->get_map_p2s()[i][0];
+        for (j = 0; j < 3; ++j) {
+            bvec_block[3 * i + j] = f_row[3 * iat + j];
+            bvec_orig_block[3 * i + j] = f_row[3 * iat + j];
+        }
+    }
+
+    for (i = 0; i < natmin3; ++i) {
+        for (j = 0; j < ncols; ++j) {
+            amat_orig_tmp[i][j] = 0.0;
+        }
+        for (j = 0; j < ncols_new; ++j) {
+            amat_mod_tmp[i][j] = 0.0;
+        }
+    }
+
+    // generate l.h.s. matrix A
+
+    iparam = 0;
+
+    for (order = 0; order < maxorder; ++order) {
+
+        mm = 0;
+
+        for (const auto &iter: fcs->get_nequiv()[order]) {
+            for (i = 0; i < iter; ++i) {
+                ind[0] = fcs->get_fc_table()[order][mm].elems[0];
+                k = inprim_index(ind[0], symmetry);
+
+                amat_tmp = 1.0;
+                for (j = 1; j < order + 2; ++j) {
+                    ind[j] = fcs->get_fc_table()[order][mm].elems[j];
+                    amat_tmp *= u_row[fcs->get_fc_table()[order][mm].elems[j]];
+                }
+                amat_orig_tmp[k][iparam] -= gamma(order + 2, ind)
+                                            * fcs->get_fc_table()[order][mm].sign * amat_tmp;
+                ++mm;
+            }
+            ++iparam;
+        }
+    }
+
+    // When the force constants are defined in the fractional coordinate,
+    // we need to multiply the basis_conversion_matrix to obtain atomic forces
+    // in the Cartesian coordinate.
+    if (fcs->get_forceconstant_basis() == "Lattice") {
+        apply_basis_converter_amat(natmin3,
+                                   ncols,
+                                   amat_orig_tmp,
+                                   fcs->get_basis_conversion_matrix());
+    }
+
+    // Convert the full matrix and vector into a smaller irreducible form
+    // by using constraint information.
+
+    ishift = 0;
+    iparam = 0;
+
+    for (order = 0; order < maxorder; ++order) {
+
+        for (i = 0; i < constraint->get_const_fix(order).size(); ++i) {
+
+            for (j = 0; j < natmin3; ++j) {
+                bvec_block[j] -= constraint->get_const_fix(order)[i].val_to_fix
+                                 * amat_orig_tmp[j][ishift +
+                                                    constraint->get_const_fix(order)[i].p_index_target];
+            }
+        }
+
+        for (const auto &it: constraint->get_index_bimap(order)) {
+            inew = it.left + iparam;
+            iold = it.right + ishift;
+
+            for (j = 0; j < natmin3; ++j) {
+                amat_mod_tmp[j][inew] = amat_orig_tmp[j][iold];
+            }
+        }
+
+        for (i = 0; i < constraint->get_const_relate(order).size(); ++i) {
+
+            iold = constraint->get_const_relate(order)[i].p_index_target + ishift;
+
+            for (j = 0; j < constraint->get_const_relate(order)[i].alpha.size(); ++j) {
+
+                // This part can issue an error when the constraint matrix is deviate from rref.
+                inew = constraint->get_index_bimap(order).right.at(
+                        constraint->get_const_relate(order)[i].p_index_orig[j]) +
+                       iparam;
+
+                for (k = 0; k < natmin3; ++k) {
+                    amat_mod_tmp[k][inew] -= amat_orig_tmp[k][iold]
+                                             * constraint->get_const_relate(order)[i].alpha[j];
+                }
+            }
+        }
+
+        ishift += fcs->get_nequiv()[order].size();
+        iparam += constraint->get_index_bimap(order).size();
+    }
+}
+
 void Optimize::get_matrix_elements_algebraic_constraint(const int maxorder,
                                                         std::vector<double> &amat,
                                                         std::vector<double> &bvec,
-                                                        const std::vector<std::vector<double>> &u_in,
-                                                        const std::vector<std::vector<double>> &f_in,
+                                                        const DataMatrix &u_in,
+                                                        const DataMatrix &f_in,
                                                         double &fnorm,
                                                         const Symmetry *symmetry,
                                                         const Fcs *fcs,
-                                                        const Constraint *constraint) const
+                                                        const Constraint *constraint,
+                                                        std::vector<double> *bvec_orig_out) const
 {
     size_t i, j;
     long irow;
 
-    if (u_in.size() != f_in.size()) {
+    if (u_in.rows() != f_in.rows()) {
         exit("get_matrix_elements",
              "The lengths of displacement array and force array are diferent.");
     }
 
-    const auto ndata_fit = u_in.size();
+    const auto ndata_fit = static_cast<size_t>(u_in.rows());
     const auto natmin = symmetry->get_nat_prim();
     const auto natmin3 = 3 * natmin;
-    const auto nrows = u_in.size() * u_in[0].size();
+    const auto nrows = static_cast<size_t>(u_in.rows() * u_in.cols());
     size_t ncols = 0;
     size_t ncols_new = 0;
 
@@ -2181,7 +2972,7 @@ void Optimize::get_matrix_elements_algebraic_constraint(const int maxorder,
     }
 
     std::vector<double> bvec_orig(nrows, 0.0);
-    std::vector<std::vector<double>> u_multi, f_multi;
+    DataMatrix u_multi, f_multi;
 
     data_multiplier(u_in, u_multi, symmetry);
     data_multiplier(f_in, f_multi, symmetry);
@@ -2196,12 +2987,7 @@ void Optimize::get_matrix_elements_algebraic_constraint(const int maxorder,
 #endif
     {
         int *ind;
-        int mm, order, iat, k;
-        size_t im;
         size_t idata;
-        size_t ishift, iparam;
-        size_t iold, inew;
-        double amat_tmp;
         double **amat_orig_tmp;
         double **amat_mod_tmp;
 
@@ -2214,138 +3000,252 @@ void Optimize::get_matrix_elements_algebraic_constraint(const int maxorder,
 #endif
         for (irow = 0; irow < ncycle; ++irow) {
 
-            // generate r.h.s vector B
-            for (i = 0; i < natmin; ++i) {
-                iat = symmetry->get_map_p2s()[i][0];
-                for (j = 0; j < 3; ++j) {
-                    im = 3 * i + j + natmin3 * irow;
-                    bvec[im] = f_multi[irow][3 * iat + j];
-                    bvec_orig[im] = f_multi[irow][3 * iat + j];
-                }
-            }
+            idata = natmin3 * irow;
+
+            generate_rows_algebraic_constraint(maxorder,
+                                               &u_multi(irow, 0),
+                                               &f_multi(irow, 0),
+                                               symmetry,
+                                               fcs,
+                                               constraint,
+                                               ind,
+                                               amat_orig_tmp,
+                                               amat_mod_tmp,
+                                               &bvec[idata],
+                                               &bvec_orig[idata]);
 
             for (i = 0; i < natmin3; ++i) {
-                for (j = 0; j < ncols; ++j) {
-                    amat_orig_tmp[i][j] = 0.0;
-                }
                 for (j = 0; j < ncols_new; ++j) {
-                    amat_mod_tmp[i][j] = 0.0;
+                    // Transpose here for later use of lapack without transpose
+                    amat[natmin3 * ncycle * j + i + idata] = amat_mod_tmp[i][j];
                 }
             }
+        }
 
-            // generate l.h.s. matrix A
+        deallocate(ind);
+        deallocate(amat_orig_tmp);
+        deallocate(amat_mod_tmp);
+    }
 
-            idata = natmin3 * irow;
-            iparam = 0;
+    fnorm = 0.0;
+    for (i = 0; i < bvec_orig.size(); ++i) {
+        fnorm += bvec_orig[i] * bvec_orig[i];
+    }
+    fnorm = std::sqrt(fnorm);
 
-            for (order = 0; order < maxorder; ++order) {
+    if (bvec_orig_out) *bvec_orig_out = bvec_orig;
+}
 
-                mm = 0;
+void Optimize::get_normal_equations_algebraic_constraint(const int maxorder,
+                                                         Eigen::MatrixXd &AtA,
+                                                         Eigen::VectorXd &Atb,
+                                                         const DataMatrix &u_in,
+                                                         const DataMatrix &f_in,
+                                                         double &fnorm2,
+                                                         double &bnorm2,
+                                                         const Symmetry *symmetry,
+                                                         const Fcs *fcs,
+                                                         const Constraint *constraint,
+                                                         const int verbosity,
+                                                         const size_t istart_data,
+                                                         const bool initialize) const
+{
+    // Accumulate the normal equations AtA = A^{T}A and Atb = A^{T}b of the
+    // least-squares problem without ever storing the full sensing matrix A.
+    // The training structures are processed in blocks; each block of rows is
+    // regenerated on the fly from u_in/f_in, folded into AtA and Atb, and
+    // discarded. The peak memory is therefore N_new^2 for AtA plus a single
+    // row block, independent of the number of training structures.
+    // When initialize is false, the snapshots starting at istart_data are
+    // rank-updated into the existing AtA, Atb, fnorm2, and bnorm2, which is
+    // how appended training data is incorporated without a refit from
+    // scratch.
 
-                for (const auto &iter: fcs->get_nequiv()[order]) {
-                    for (i = 0; i < iter; ++i) {
-                        ind[0] = fcs->get_fc_table()[order][mm].elems[0];
-                        k = inprim_index(ind[0], symmetry);
+    size_t i, j;
+    long irow;
 
-                        amat_tmp = 1.0;
-                        for (j = 1; j < order + 2; ++j) {
-                            ind[j] = fcs->get_fc_table()[order][mm].elems[j];
-                            amat_tmp *= u_multi[irow][fcs->get_fc_table()[order][mm].elems[j]];
-                        }
-                        amat_orig_tmp[k][iparam] -= gamma(order + 2, ind)
-                                                    * fcs->get_fc_table()[order][mm].sign * amat_tmp;
-                        ++mm;
-                    }
-                    ++iparam;
-                }
-            }
+    if (u_in.rows() != f_in.rows()) {
+        exit("get_normal_equations_algebraic_constraint",
+             "The lengths of displacement array and force array are diferent.");
+    }
 
-            // When the force constants are defined in the fractional coordinate,
-            // we need to multiply the basis_conversion_matrix to obtain atomic forces
-            // in the Cartesian coordinate.
-            if (fcs->get_forceconstant_basis() == "Lattice") {
-                apply_basis_converter_amat(natmin3,
-                                           ncols,
-                                           amat_orig_tmp,
-                                           fcs->get_basis_conversion_matrix());
-            }
+    const auto ndata_fit = static_cast<size_t>(u_in.rows());
+    const auto natmin3 = 3 * symmetry->get_nat_prim();
+    const auto ntran = symmetry->get_ntran();
+    size_t ncols = 0;
+    size_t ncols_new = 0;
 
-            // Convert the full matrix and vector into a smaller irreducible form
-            // by using constraint information.
+    for (i = 0; i < maxorder; ++i) {
+        ncols += fcs->get_nequiv()[i].size();
+        ncols_new += constraint->get_index_bimap(i).size();
+    }
 
-            ishift = 0;
-            iparam = 0;
+    if (initialize) {
+        AtA.setZero(ncols_new, ncols_new);
+        Atb.setZero(ncols_new);
+        fnorm2 = 0.0;
+        bnorm2 = 0.0;
+    } else if (AtA.rows() != ncols_new) {
+        exit("get_normal_equations_algebraic_constraint",
+             "The cached normal equations do not match the current model.");
+    }
 
-            for (order = 0; order < maxorder; ++order) {
+    // Choose the block size so that a single row block stays around 1 GiB
+    // regardless of the training-set size.
+    const auto nrows_per_structure = natmin3 * ntran;
+    auto nstruct_per_block = (static_cast<size_t>(1) << 30)
+                             / (sizeof(double) * ncols_new * nrows_per_structure);
+    if (nstruct_per_block < 1) nstruct_per_block = 1;
+    if (nstruct_per_block > ndata_fit) nstruct_per_block = ndata_fit;
 
-                for (i = 0; i < constraint->get_const_fix(order).size(); ++i) {
+    if (verbosity > 0) {
+        std::cout << "  Accumulating normal equations in blocks of "
+                  << nstruct_per_block << " configurations ..." << std::endl;
+    }
 
-                    for (j = 0; j < natmin3; ++j) {
-                        bvec[j + idata] -= constraint->get_const_fix(order)[i].val_to_fix
-                                           * amat_orig_tmp[j][ishift +
-                                                              constraint->get_const_fix(order)[i].p_index_target];
-                    }
-                }
+    Eigen::MatrixXd amat_block;
+    Eigen::VectorXd bvec_block;
+    DataMatrix u_chunk, f_chunk, u_multi, f_multi;
 
-                for (const auto &it: constraint->get_index_bimap(order)) {
-                    inew = it.left + iparam;
-                    iold = it.right + ishift;
+    for (size_t istart = istart_data; istart < ndata_fit; istart += nstruct_per_block) {
 
-                    for (j = 0; j < natmin3; ++j) {
-                        amat_mod_tmp[j][inew] = amat_orig_tmp[j][iold];
-                    }
-                }
+        const auto iend = std::min(istart + nstruct_per_block, ndata_fit);
 
-                for (i = 0; i < constraint->get_const_relate(order).size(); ++i) {
+        u_chunk = u_in.middleRows(istart, iend - istart);
+        f_chunk = f_in.middleRows(istart, iend - istart);
 
-                    iold = constraint->get_const_relate(order)[i].p_index_target + ishift;
+        data_multiplier(u_chunk, u_multi, symmetry);
+        data_multiplier(f_chunk, f_multi, symmetry);
 
-                    for (j = 0; j < constraint->get_const_relate(order)[i].alpha.size(); ++j) {
+        if (fcs->get_forceconstant_basis() == "Lattice") {
+            apply_basis_converter(u_multi,
+                                  fcs->get_basis_conversion_matrix());
+        }
 
-                        // This part can issue an error when the constraint matrix is deviate from rref.
-                        inew = constraint->get_index_bimap(order).right.at(
-                                constraint->get_const_relate(order)[i].p_index_orig[j]) +
-                               iparam;
+        const long ncycle = (iend - istart) * ntran;
 
-                        for (k = 0; k < natmin3; ++k) {
-                            amat_mod_tmp[k][inew] -= amat_orig_tmp[k][iold]
-                                                     * constraint->get_const_relate(order)[i].alpha[j];
-                        }
-                    }
-                }
+        amat_block.setZero(natmin3 * ncycle, ncols_new);
+        bvec_block.setZero(natmin3 * ncycle);
+        std::vector<double> bvec_orig_block(natmin3 * ncycle, 0.0);
 
-                ishift += fcs->get_nequiv()[order].size();
-                iparam += constraint->get_index_bimap(order).size();
-            }
+#ifdef _OPENMP
+#pragma omp parallel private(irow, i, j)
+#endif
+        {
+            int *ind;
+            size_t idata;
+            double **amat_orig_tmp;
+            double **amat_mod_tmp;
 
-            for (i = 0; i < natmin3; ++i) {
-                for (j = 0; j < ncols_new; ++j) {
-                    // Transpose here for later use of lapack without transpose
-                    amat[natmin3 * ncycle * j + i + idata] = amat_mod_tmp[i][j];
+            allocate(ind, maxorder + 1);
+            allocate(amat_orig_tmp, natmin3, ncols);
+            allocate(amat_mod_tmp, natmin3, ncols_new);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (irow = 0; irow < ncycle; ++irow) {
+
+                idata = natmin3 * irow;
+
+                generate_rows_algebraic_constraint(maxorder,
+                                                   &u_multi(irow, 0),
+                                                   &f_multi(irow, 0),
+                                                   symmetry,
+                                                   fcs,
+                                                   constraint,
+                                                   ind,
+                                                   amat_orig_tmp,
+                                                   amat_mod_tmp,
+                                                   bvec_block.data() + idata,
+                                                   &bvec_orig_block[idata]);
+
+                for (i = 0; i < natmin3; ++i) {
+                    for (j = 0; j < ncols_new; ++j) {
+                        amat_block(idata + i, j) = amat_mod_tmp[i][j];
+                    }
                 }
             }
+
+            deallocate(ind);
+            deallocate(amat_orig_tmp);
+            deallocate(amat_mod_tmp);
         }
 
-        deallocate(ind);
-        deallocate(amat_orig_tmp);
-        deallocate(amat_mod_tmp);
+        AtA.selfadjointView<Eigen::Lower>().rankUpdate(amat_block.transpose());
+        Atb.noalias() += amat_block.transpose() * bvec_block;
+        bnorm2 += bvec_block.squaredNorm();
+
+        for (i = 0; i < bvec_orig_block.size(); ++i) {
+            fnorm2 += bvec_orig_block[i] * bvec_orig_block[i];
+        }
     }
 
-    fnorm = 0.0;
-    for (i = 0; i < bvec_orig.size(); ++i) {
-        fnorm += bvec_orig[i] * bvec_orig[i];
+    AtA = AtA.selfadjointView<Eigen::Lower>();
+}
+
+int Optimize::fit_normal_equations(const size_t N,
+                                   const Eigen::MatrixXd &AtA,
+                                   const Eigen::VectorXd &Atb,
+                                   std::vector<double> &param_out,
+                                   const double fnorm,
+                                   const double bnorm2,
+                                   const int maxorder,
+                                   const Fcs *fcs,
+                                   const Constraint *constraint,
+                                   const int verbosity) const
+{
+    size_t i;
+
+    if (verbosity > 0) {
+        std::cout << "  Entering fitting routine: LDLT of the normal equations" << std::endl;
+        std::cout << "  with constraints considered algebraically." << std::endl;
+    }
+
+    if (verbosity > 0) std::cout << "  LDLT has started ... ";
+
+    Eigen::LDLT<Eigen::MatrixXd> ldlt(AtA);
+
+    if (ldlt.info() != Eigen::Success) {
+        std::cerr << "  LDLT decomposition failed." << std::endl;
+        return 1;
+    }
+
+    const Eigen::VectorXd x = ldlt.solve(Atb);
+
+    if (verbosity > 0) std::cout << "finished !" << std::endl;
+
+    if (verbosity > 0) {
+        // The residual sum of squares follows from the normal equations as
+        // |Ax - b|^2 = |b|^2 - 2 x.A^{T}b + x.A^{T}Ax without access to A.
+        auto f_residual = bnorm2 - 2.0 * x.dot(Atb) + x.dot(AtA * x);
+        if (f_residual < 0.0) f_residual = 0.0;
+        std::cout << std::endl;
+        std::cout << "  Residual sum of squares for the solution: "
+                  << std::sqrt(f_residual) << std::endl;
+        std::cout << "  Fitting error (%) : "
+                  << std::sqrt(f_residual / (fnorm * fnorm)) * 100.0 << std::endl;
     }
-    fnorm = std::sqrt(fnorm);
 
-    u_multi.clear();
-    f_multi.clear();
+    std::vector<double> param_irred(N, 0.0);
+    for (i = 0; i < N; ++i) param_irred[i] = x(i);
+
+    // Recover reducible set of force constants
+
+    recover_original_forceconstants(maxorder,
+                                    param_irred,
+                                    param_out,
+                                    fcs->get_nequiv(),
+                                    constraint);
+
+    return 0;
 }
 
 void Optimize::get_matrix_elements_in_sparse_form(const int maxorder,
                                                   SpMat &sp_amat,
                                                   Eigen::VectorXd &sp_bvec,
-                                                  const std::vector<std::vector<double>> &u_in,
-                                                  const std::vector<std::vector<double>> &f_in,
+                                                  const DataMatrix &u_in,
+                                                  const DataMatrix &f_in,
                                                   double &fnorm,
                                                   const Symmetry *symmetry,
                                                   const Fcs *fcs,
@@ -2354,17 +3254,16 @@ void Optimize::get_matrix_elements_in_sparse_form(const int maxorder,
     size_t i, j;
     long irow;
     typedef Eigen::Triplet<double, size_t> T;
-    std::vector<T> nonzero_entries;
 
-    if (u_in.size() != f_in.size()) {
+    if (u_in.rows() != f_in.rows()) {
         exit("get_matrix_elements",
              "The lengths of displacement array and force array are diferent.");
     }
 
-    const auto ndata_fit = u_in.size();
+    const auto ndata_fit = static_cast<size_t>(u_in.rows());
     const auto natmin = symmetry->get_nat_prim();
     const auto natmin3 = 3 * natmin;
-    const auto nrows = u_in.size() * u_in[0].size();
+    const auto nrows = static_cast<size_t>(u_in.rows() * u_in.cols());
 
     size_t ncols = 0;
     size_t ncols_new = 0;
@@ -2377,7 +3276,7 @@ void Optimize::get_matrix_elements_in_sparse_form(const int maxorder,
     const auto ncycle = ndata_fit * symmetry->get_ntran();
 
     std::vector<double> bvec_orig(nrows, 0.0);
-    std::vector<std::vector<double>> u_multi, f_multi;
+    DataMatrix u_multi, f_multi;
 
     data_multiplier(u_in, u_multi, symmetry);
     data_multiplier(f_in, f_multi, symmetry);
@@ -2387,152 +3286,120 @@ void Optimize::get_matrix_elements_in_sparse_form(const int maxorder,
                               fcs->get_basis_conversion_matrix());
     }
 
+    // The nonzero entries are collected in per-thread triplet lists and
+    // scattered directly into the compressed-column storage afterwards.
+    // Since the rows are distributed in contiguous ascending chunks
+    // (schedule(static)) and each thread visits its rows in order, the
+    // entries of each column are already sorted when the thread lists are
+    // merged in thread order, and no global sort (setFromTriplets) is needed.
+
+    const int nthreads = omp_get_max_threads();
+    std::vector<std::vector<T>> nonzero_thread(nthreads);
+    std::vector<std::vector<size_t>> colcount_thread(nthreads);
+
 #ifdef _OPENMP
 #pragma omp parallel private(irow, i, j)
 #endif
     {
         int *ind;
-        int mm, order, iat, k;
-        size_t im, iparam;
         size_t idata;
-        size_t ishift;
-        size_t iold, inew;
-        double amat_tmp;
         double **amat_orig_tmp;
         double **amat_mod_tmp;
 
-        std::vector<T> nonzero_omp;
+        const int ithread = omp_get_thread_num();
+        auto &nonzero_omp = nonzero_thread[ithread];
+        std::vector<size_t> colcount(ncols_new, 0);
+        auto reserved = false;
 
         allocate(ind, maxorder + 1);
         allocate(amat_orig_tmp, natmin3, ncols);
         allocate(amat_mod_tmp, natmin3, ncols_new);
 
 #ifdef _OPENMP
-#pragma omp for
+#pragma omp for schedule(static)
 #endif
         for (irow = 0; irow < ncycle; ++irow) {
 
-            // generate r.h.s vector B
-            for (i = 0; i < natmin; ++i) {
-                iat = symmetry->get_map_p2s()[i][0];
-                for (j = 0; j < 3; ++j) {
-                    im = 3 * i + j + natmin3 * irow;
-                    sp_bvec(im) = f_multi[irow][3 * iat + j];
-                    bvec_orig[im] = f_multi[irow][3 * iat + j];
-                }
-            }
-
-            for (i = 0; i < natmin3; ++i) {
-                for (j = 0; j < ncols; ++j) {
-                    amat_orig_tmp[i][j] = 0.0;
-                }
-                for (j = 0; j < ncols_new; ++j) {
-                    amat_mod_tmp[i][j] = 0.0;
-                }
-            }
-
-            // generate l.h.s. matrix A
-
             idata = natmin3 * irow;
-            iparam = 0;
-
-            for (order = 0; order < maxorder; ++order) {
-
-                mm = 0;
 
-                for (const auto &iter: fcs->get_nequiv()[order]) {
-                    for (i = 0; i < iter; ++i) {
-                        ind[0] = fcs->get_fc_table()[order][mm].elems[0];
-                        k = inprim_index(ind[0], symmetry);
+            generate_rows_algebraic_constraint(maxorder,
+                                               &u_multi(irow, 0),
+                                               &f_multi(irow, 0),
+                                               symmetry,
+                                               fcs,
+                                               constraint,
+                                               ind,
+                                               amat_orig_tmp,
+                                               amat_mod_tmp,
+                                               sp_bvec.data() + idata,
+                                               &bvec_orig[idata]);
 
-                        amat_tmp = 1.0;
-                        for (j = 1; j < order + 2; ++j) {
-                            ind[j] = fcs->get_fc_table()[order][mm].elems[j];
-                            amat_tmp *= u_multi[irow][fcs->get_fc_table()[order][mm].elems[j]];
-                        }
-                        amat_orig_tmp[k][iparam] -= gamma(order + 2, ind)
-                                                    * fcs->get_fc_table()[order][mm].sign * amat_tmp;
-                        ++mm;
+            for (i = 0; i < natmin3; ++i) {
+                for (j = 0; j < ncols_new; ++j) {
+                    if (std::abs(amat_mod_tmp[i][j]) > eps) {
+                        nonzero_omp.emplace_back(T(idata + i, j, amat_mod_tmp[i][j]));
+                        ++colcount[j];
                     }
-                    ++iparam;
                 }
             }
 
-            // When the force constants are defined in the fractional coordinate,
-            // we need to multiply the basis_conversion_matrix to obtain atomic forces
-            // in the Cartesian coordinate.
-            if (fcs->get_forceconstant_basis() == "Lattice") {
-                apply_basis_converter_amat(natmin3,
-                                           ncols,
-                                           amat_orig_tmp,
-                                           fcs->get_basis_conversion_matrix());
+            if (!reserved) {
+                // Estimate the capacity from the density of the first
+                // processed block, assuming similar sparsity across snapshots.
+                nonzero_omp.reserve(nonzero_omp.size()
+                                    * (ncycle / nthreads + 1) * 5 / 4);
+                reserved = true;
             }
+        }
 
-            // Convert the full matrix and vector into a smaller irreducible form
-            // by using constraint information.
-
-            ishift = 0;
-            iparam = 0;
-
-            for (order = 0; order < maxorder; ++order) {
-
-                for (i = 0; i < constraint->get_const_fix(order).size(); ++i) {
-
-                    for (j = 0; j < natmin3; ++j) {
-                        sp_bvec(j + idata) -= constraint->get_const_fix(order)[i].val_to_fix
-                                              * amat_orig_tmp[j][ishift +
-                                                                 constraint->get_const_fix(order)[i].p_index_target];
-                    }
-                }
-
-                for (const auto &it: constraint->get_index_bimap(order)) {
-                    inew = it.left + iparam;
-                    iold = it.right + ishift;
+        deallocate(ind);
+        deallocate(amat_orig_tmp);
+        deallocate(amat_mod_tmp);
 
-                    for (j = 0; j < natmin3; ++j) {
-                        amat_mod_tmp[j][inew] = amat_orig_tmp[j][iold];
-                    }
-                }
+        colcount_thread[ithread] = std::move(colcount);
+    }
 
-                for (i = 0; i < constraint->get_const_relate(order).size(); ++i) {
+    // Exclusive prefix sum over (column, thread) pairs gives each thread a
+    // disjoint destination range in every column of the compressed storage.
 
-                    iold = constraint->get_const_relate(order)[i].p_index_target + ishift;
+    size_t nnz = 0;
+    std::vector<size_t> outer_index(ncols_new + 1);
+    std::vector<std::vector<size_t>> offset_thread(nthreads);
 
-                    for (j = 0; j < constraint->get_const_relate(order)[i].alpha.size(); ++j) {
+    for (int t = 0; t < nthreads; ++t) {
+        if (colcount_thread[t].empty()) colcount_thread[t].resize(ncols_new, 0);
+        offset_thread[t].resize(ncols_new);
+    }
 
-                        inew = constraint->get_index_bimap(order).right.at(
-                                constraint->get_const_relate(order)[i].p_index_orig[j]) +
-                               iparam;
+    for (j = 0; j < ncols_new; ++j) {
+        outer_index[j] = nnz;
+        for (int t = 0; t < nthreads; ++t) {
+            offset_thread[t][j] = nnz;
+            nnz += colcount_thread[t][j];
+        }
+    }
+    outer_index[ncols_new] = nnz;
 
-                        for (k = 0; k < natmin3; ++k) {
-                            amat_mod_tmp[k][inew] -= amat_orig_tmp[k][iold]
-                                                     * constraint->get_const_relate(order)[i].alpha[j];
-                        }
-                    }
-                }
+    sp_amat.resizeNonZeros(nnz);
 
-                ishift += fcs->get_nequiv()[order].size();
-                iparam += constraint->get_index_bimap(order).size();
-            }
+    auto *outer_ptr = sp_amat.outerIndexPtr();
+    for (j = 0; j <= ncols_new; ++j) {
+        outer_ptr[j] = outer_index[j];
+    }
 
-            for (i = 0; i < natmin3; ++i) {
-                for (j = 0; j < ncols_new; ++j) {
-                    if (std::abs(amat_mod_tmp[i][j]) > eps) {
-                        nonzero_omp.emplace_back(T(idata + i, j, amat_mod_tmp[i][j]));
-                    }
-                }
-            }
-        }
+    auto *inner_ptr = sp_amat.innerIndexPtr();
+    auto *value_ptr = sp_amat.valuePtr();
 
-        deallocate(ind);
-        deallocate(amat_orig_tmp);
-        deallocate(amat_mod_tmp);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int t = 0; t < nthreads; ++t) {
+        auto &offsets = offset_thread[t];
 
-#pragma omp critical
-        {
-            for (const auto &it: nonzero_omp) {
-                nonzero_entries.emplace_back(it);
-            }
+        for (const auto &it: nonzero_thread[t]) {
+            const auto ipos = offsets[it.col()]++;
+            inner_ptr[ipos] = it.row();
+            value_ptr[ipos] = it.value();
         }
     }
 
@@ -2541,8 +3408,6 @@ void Optimize::get_matrix_elements_in_sparse_form(const int maxorder,
         fnorm += bvec_orig[i] * bvec_orig[i];
     }
     fnorm = std::sqrt(fnorm);
-    sp_amat.setFromTriplets(nonzero_entries.begin(), nonzero_entries.end());
-    sp_amat.makeCompressed();
 }
 
 
@@ -2596,24 +3461,24 @@ void Optimize::recover_original_forceconstants(const int maxorder,
 }
 
 
-void Optimize::data_multiplier(const std::vector<std::vector<double>> &data_in,
-                               std::vector<std::vector<double>> &data_out,
+void Optimize::data_multiplier(const DataMatrix &data_in,
+                               DataMatrix &data_out,
                                const Symmetry *symmetry) const
 {
     const auto nat = symmetry->get_nat_prim() * symmetry->get_ntran();
-    const auto ndata_used = data_in.size();
+    const auto ndata_used = data_in.rows();
     const auto ntran = symmetry->get_ntran();
 
-    data_out.resize(ntran * ndata_used, std::vector<double>(3 * nat));
+    data_out.resize(ntran * ndata_used, 3 * nat);
 
     auto idata = 0;
-    for (auto i = 0; i < ndata_used; ++i) {
+    for (Eigen::Index i = 0; i < ndata_used; ++i) {
 
-        for (auto itran = 0; itran < symmetry->get_ntran(); ++itran) {
-            for (auto j = 0; j < nat; ++j) {
+        for (size_t itran = 0; itran < ntran; ++itran) {
+            for (size_t j = 0; j < nat; ++j) {
                 const auto n_mapped = symmetry->get_map_sym()[j][symmetry->get_symnum_tran()[itran]];
                 for (auto k = 0; k < 3; ++k) {
-                    data_out[idata][3 * n_mapped + k] = data_in[i][3 * j + k];
+                    data_out(idata, 3 * n_mapped + k) = data_in(i, 3 * j + k);
                 }
             }
             ++idata;
@@ -2925,20 +3790,35 @@ void Optimize::coordinate_descent(const int M,
                                   Eigen::VectorXd &grad,
                                   const double fnorm,
                                   const Eigen::VectorXd &scale_beta,
-                                  const int verbosity) const
+                                  const int verbosity,
+                                  const std::vector<int> *screened_cols) const
 {
-    int i, j;
+    int i;
     double diff{0.0};
-    Eigen::VectorXd beta(N), delta(N);
-    Eigen::VectorXd res(N);
+    Eigen::VectorXd beta(N);
+    Eigen::VectorXd res;
     bool do_print_log;
 
+    // When the caller could not afford the N x N Gram cache (Prod of size
+    // zero), the gradient entries are evaluated from a maintained residual
+    // vector instead: every coordinate visit then costs O(M) instead of
+    // O(1), but the memory stays O(M + N), which is what makes runs with
+    // 10^5+ columns possible at all.
+    const auto use_gram = Prod.size() > 0;
+
     if (warm_start) {
         for (i = 0; i < N; ++i) beta(i) = x(i);
     } else {
         for (i = 0; i < N; ++i) beta(i) = 0.0;
         grad = grad0;
     }
+    if (!use_gram) {
+        if (warm_start) {
+            res = b - A * beta;
+        } else {
+            res = b;
+        }
+    }
 
     if (verbosity > 1) {
         std::cout << "-----------------------------------------------------------------" << std::endl;
@@ -2948,115 +3828,116 @@ void Optimize::coordinate_descent(const int M,
     const auto Minv = 1.0 / static_cast<double>(M);
     const auto alphlambda = alpha * optcontrol.l1_ratio;
 
-    auto iloop = 0;
+    Eigen::VectorXd inv_scale_beta(N);
+    if (!optcontrol.standardize) {
+        for (i = 0; i < N; ++i) inv_scale_beta(i) = 1.0 / scale_beta(i);
+    }
 
-    if (optcontrol.standardize) {
-        while (iloop < optcontrol.maxnum_iteration) {
-            do_print_log = !((iloop + 1) % optcontrol.output_frequency) && (verbosity > 1);
+    // Between two full passes, the sweeps visit only the active set
+    // (coefficients currently nonzero). Convergence is declared only when
+    // a full pass itself no longer moves the solution. A full pass covers
+    // all N columns, or only the screened subset when the caller provides
+    // one (strong-rule screening in solution_path); the caller is then
+    // responsible for the KKT check of the columns left out.
+    std::vector<int> active_list;
+    active_list.reserve(N);
 
-            if (do_print_log) {
-                std::cout << "   Coordinate Descent : " << std::setw(5) << iloop + 1 << std::endl;
-            }
-            delta = beta;
-            for (i = 0; i < N; ++i) {
-                beta(i) = shrink(Minv * grad(i) + beta(i), alphlambda);
-                delta(i) -= beta(i);
-                if (std::abs(delta(i)) > 0.0) {
-                    if (!has_prod[i]) {
-#pragma omp parallel for
-                        for (j = 0; j < N; ++j) {
-                            Prod(j, i) = A.col(j).dot(A.col(i));
-                        }
-                        has_prod[i] = true;
-                    }
-                    grad = grad + Prod.col(i) * delta(i);
-                }
-            }
-            ++iloop;
-            diff = 0.0;
-#pragma omp parallel for reduction(+:diff)
-            for (i = 0; i < N; ++i) {
-                diff += delta(i) * delta(i);
-            }
-            diff = std::sqrt(diff / static_cast<double>(N));
-            //diff = std::sqrt(delta.dot(delta) / static_cast<double>(N));
+    auto iloop = 0;
+    auto full_sweep = true;
 
-            if (diff < optcontrol.tolerance_iteration) break;
+    while (iloop < optcontrol.maxnum_iteration) {
+        do_print_log = !((iloop + 1) % optcontrol.output_frequency) && (verbosity > 1);
 
-            if (do_print_log) {
-                std::cout << "    1: ||u_{k}-u_{k-1}||_2     = " << std::setw(15) << diff
-                          << std::setw(15) << diff * std::sqrt(static_cast<double>(N) / beta.dot(beta)) << std::endl;
-                auto tmp = 0.0;
-#ifdef _OPENMP
-#pragma omp parallel for reduction(+:tmp)
-#endif
-                for (i = 0; i < N; ++i) {
-                    tmp += std::abs(beta(i));
-                }
-                std::cout << "    2: ||u_{k}||_1             = " << std::setw(15) << tmp << std::endl;
-                res = A * beta - b;
-                tmp = res.dot(res);
-                std::cout << "    3: ||Au_{k}-f||_2          = " << std::setw(15) << std::sqrt(tmp)
-                          << std::setw(15) << std::sqrt(tmp / (fnorm * fnorm)) << std::endl;
-                std::cout << std::endl;
-            }
+        if (do_print_log) {
+            std::cout << "   Coordinate Descent : " << std::setw(5) << iloop + 1 << std::endl;
         }
-    } else {
-        // Non-standardized version. Needs additional operations
 
-        Eigen::VectorXd inv_scale_beta(N);
+        auto sumsq = 0.0;
+        const auto nfull = screened_cols ? static_cast<int>(screened_cols->size()) : N;
+        const auto nsweep = full_sweep ? nfull : static_cast<int>(active_list.size());
 
-        for (i = 0; i < N; ++i) inv_scale_beta(i) = 1.0 / scale_beta(i);
+        for (auto ii = 0; ii < nsweep; ++ii) {
+            i = full_sweep ? (screened_cols ? (*screened_cols)[ii] : ii) : active_list[ii];
 
-        while (iloop < optcontrol.maxnum_iteration) {
-            do_print_log = !((iloop + 1) % optcontrol.output_frequency) && (verbosity > 1);
+            double gval;
+            if (use_gram) {
+                gval = grad(i);
+            } else {
+                const double *col = A.col(i).data();
+                gval = 0.0;
+#pragma omp parallel for reduction(+:gval)
+                for (auto j = 0; j < M; ++j) {
+                    gval += col[j] * res(j);
+                }
+            }
 
-            if (do_print_log) {
-                std::cout << "   Coordinate Descent : " << std::setw(5) << iloop + 1 << std::endl;
+            double beta_new;
+            if (optcontrol.standardize) {
+                beta_new = shrink(Minv * gval + beta(i), alphlambda);
+            } else {
+                beta_new = shrink(Minv * gval + beta(i) * inv_scale_beta(i), alphlambda) * scale_beta(i);
             }
-            delta = beta;
-            for (i = 0; i < N; ++i) {
-                beta(i) = shrink(Minv * grad(i) + beta(i) * inv_scale_beta(i), alphlambda) * scale_beta(i);
-                delta(i) -= beta(i);
-                if (std::abs(delta(i)) > 0.0) {
+            const auto dtmp = beta(i) - beta_new;
+            beta(i) = beta_new;
+            sumsq += dtmp * dtmp;
+
+            if (std::abs(dtmp) > 0.0) {
+                if (use_gram) {
                     if (!has_prod[i]) {
 #pragma omp parallel for
-                        for (j = 0; j < N; ++j) {
+                        for (auto j = 0; j < N; ++j) {
                             Prod(j, i) = A.col(j).dot(A.col(i));
                         }
                         has_prod[i] = true;
                     }
-                    grad = grad + Prod.col(i) * delta(i);
+#pragma omp parallel for
+                    for (auto j = 0; j < N; ++j) {
+                        grad(j) += Prod(j, i) * dtmp;
+                    }
+                } else {
+                    const double *col = A.col(i).data();
+#pragma omp parallel for
+                    for (auto j = 0; j < M; ++j) {
+                        res(j) += col[j] * dtmp;
+                    }
                 }
             }
-            ++iloop;
-            diff = 0.0;
-#pragma omp parallel for reduction(+:diff)
+        }
+
+        ++iloop;
+        diff = std::sqrt(sumsq / static_cast<double>(N));
+
+        const auto sweep_was_full = full_sweep;
+        if (sweep_was_full) {
+            active_list.clear();
             for (i = 0; i < N; ++i) {
-                diff += delta(i) * delta(i);
+                if (beta(i) != 0.0) active_list.push_back(i);
             }
-            diff = std::sqrt(diff / static_cast<double>(N));
-            //diff = std::sqrt(delta.dot(delta) / static_cast<double>(N));
+        }
 
-            if (diff < optcontrol.tolerance_iteration) break;
+        if (diff < optcontrol.tolerance_iteration) {
+            if (sweep_was_full) break;
+            full_sweep = true;
+        } else {
+            full_sweep = false;
+        }
 
-            if (do_print_log) {
-                std::cout << "    1: ||u_{k}-u_{k-1}||_2     = " << std::setw(15) << diff
-                          << std::setw(15) << diff * std::sqrt(static_cast<double>(N) / beta.dot(beta)) << std::endl;
-                auto tmp = 0.0;
+        if (do_print_log) {
+            std::cout << "    1: ||u_{k}-u_{k-1}||_2     = " << std::setw(15) << diff
+                      << std::setw(15) << diff * std::sqrt(static_cast<double>(N) / beta.dot(beta)) << std::endl;
+            auto tmp = 0.0;
 #ifdef _OPENMP
 #pragma omp parallel for reduction(+:tmp)
 #endif
-                for (i = 0; i < N; ++i) {
-                    tmp += std::abs(beta(i));
-                }
-                std::cout << "    2: ||u_{k}||_1             = " << std::setw(15) << tmp << std::endl;
-                res = A * beta - b;
-                tmp = res.dot(res);
-                std::cout << "    3: ||Au_{k}-f||_2          = " << std::setw(15) << std::sqrt(tmp)
-                          << std::setw(15) << std::sqrt(tmp / (fnorm * fnorm)) << std::endl;
-                std::cout << std::endl;
+            for (i = 0; i < N; ++i) {
+                tmp += std::abs(beta(i));
             }
+            std::cout << "    2: ||u_{k}||_1             = " << std::setw(15) << tmp << std::endl;
+            Eigen::VectorXd resid_tmp = A * beta - b;
+            tmp = resid_tmp.dot(resid_tmp);
+            std::cout << "    3: ||Au_{k}-f||_2          = " << std::setw(15) << std::sqrt(tmp)
+                      << std::setw(15) << std::sqrt(tmp / (fnorm * fnorm)) << std::endl;
+            std::cout << std::endl;
         }
     }
 
@@ -3083,8 +3964,8 @@ void Optimize::coordinate_descent(const int M,
             tmp += std::abs(beta(i));
         }
         std::cout << "    2': ||u_{k}||_1             = " << std::setw(15) << tmp << std::endl;
-        res = A * beta - b;
-        tmp = res.dot(res);
+        Eigen::VectorXd resid_tmp = A * beta - b;
+        tmp = resid_tmp.dot(resid_tmp);
         std::cout << "    3': ||Au_{k}-f||_2          = " << std::setw(15) << std::sqrt(tmp)
                   << std::setw(15) << std::sqrt(tmp / (fnorm * fnorm)) << std::endl;
         std::cout << std::endl;
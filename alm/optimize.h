@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <fstream>
 #include <vector>
 #include "files.h"
 #include "constraint.h"
@@ -21,6 +22,10 @@
 
 using SpMat = Eigen::SparseMatrix<double, Eigen::ColMajor>;
 
+// Row-major storage for displacement and force datasets: one structure per
+// row, all rows contiguous in a single buffer.
+using DataMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
 
 namespace ALM_NS {
 class OptimizerControl {
@@ -29,6 +34,13 @@ public:
     int linear_model;         // 1 : least-squares, 2 : elastic net, 3 : adaptive lasso (experimental)
     int use_sparse_solver;    // 0: No, 1: Yes
     std::string sparsesolver; // Method name of Eigen sparse solver
+    int stream_sensing_matrix; // 0: No, 1: accumulate the normal equations by streaming
+    // row blocks of the sensing matrix instead of storing the full matrix
+    int use_sketch_solver; // 0: No, 1: replace the dense SVD by a randomized
+    // sketch-preconditioned LSQR (fast for M >> N)
+    int validation_report; // 0: No, 1: after fitting, recompute the forces of the
+    // training (and validation) snapshots from the fitted model and report
+    // the error distributions over snapshots and atoms
     int maxnum_iteration;
     double tolerance_iteration;
     int output_frequency;
@@ -59,6 +71,9 @@ public:
         linear_model = 1;
         use_sparse_solver = 0;
         sparsesolver = "SimplicialLDLT";
+        stream_sensing_matrix = 0;
+        use_sketch_solver = 0;
+        validation_report = 0;
         maxnum_iteration = 10000;
         tolerance_iteration = 1.0e-8;
         output_frequency = 1000;
@@ -105,6 +120,16 @@ public:
 
     void set_f_train(const std::vector<std::vector<double>> &f_train_in);
 
+    void append_training_data(const std::vector<std::vector<double>> &u_in,
+                              const std::vector<std::vector<double>> &f_in);
+
+    int fit_incremental(const int maxorder,
+                        const int output_maxorder,
+                        const Symmetry *symmetry,
+                        Fcs *fcs,
+                        const Constraint *constraint,
+                        const int verbosity);
+
     void set_validation_data(const std::vector<std::vector<double>> &u_validation_in,
                              const std::vector<std::vector<double>> &f_validation_in);
 
@@ -112,17 +137,22 @@ public:
 
     std::vector<std::vector<double>> get_f_train() const;
 
+    const DataMatrix &get_u_train_matrix() const;
+
+    const DataMatrix &get_f_train_matrix() const;
+
     size_t get_number_of_data() const;
 
     void get_matrix_elements_algebraic_constraint(const int maxorder,
                                                   std::vector<double> &amat,
                                                   std::vector<double> &bvec,
-                                                  const std::vector<std::vector<double>> &u_in,
-                                                  const std::vector<std::vector<double>> &f_in,
+                                                  const DataMatrix &u_in,
+                                                  const DataMatrix &f_in,
                                                   double &fnorm,
                                                   const Symmetry *symmetry,
                                                   const Fcs *fcs,
-                                                  const Constraint *constraint) const;
+                                                  const Constraint *constraint,
+                                                  std::vector<double> *bvec_orig_out = nullptr) const;
 
     void set_fcs_values(const int maxorder,
                         double *fc_in,
@@ -144,19 +174,54 @@ private:
     double *params;
     double cv_l1_alpha;  // stores alpha at minimum CV
 
-    std::vector<std::vector<double>> u_train, f_train;
-    std::vector<std::vector<double>> u_validation, f_validation;
+    DataMatrix u_train, f_train;
+    DataMatrix u_validation, f_validation;
 
     OptimizerControl optcontrol;
 
+    // Cached normal equations of the least-squares path, rank-updated by
+    // fit_incremental when training data is appended. ndata_in_cache is the
+    // number of leading u_train entries already folded into the cache.
+    Eigen::MatrixXd AtA_cache;
+    Eigen::VectorXd Atb_cache;
+    double fnorm2_cache;
+    double bnorm2_cache;
+    size_t ndata_in_cache;
+
+    // Coefficients of the previous elastic-net fit, used to warm-start the
+    // coordinate descent on retraining. Mutable because the solution-storing
+    // solver entry points are const.
+    mutable Eigen::VectorXd coef_prev_enet;
+
     void set_default_variables();
 
+    void reset_normal_equation_cache();
+
     void deallocate_variables();
 
-    void data_multiplier(const std::vector<std::vector<double>> &,
-                         std::vector<std::vector<double>> &,
+    void copy_dataset_to_matrix(const std::vector<std::vector<double>> &data_in,
+                                DataMatrix &mat_out) const;
+
+    void data_multiplier(const DataMatrix &,
+                         DataMatrix &,
                          const Symmetry *) const;
 
+    void run_force_validation(const int maxorder,
+                              const std::string &file_prefix,
+                              const Symmetry *symmetry,
+                              const Fcs *fcs,
+                              const int verbosity,
+                              Timer *timer) const;
+
+    void validate_dataset(const int maxorder,
+                          const DataMatrix &u_in,
+                          const DataMatrix &f_in,
+                          const Symmetry *symmetry,
+                          const Fcs *fcs,
+                          const std::string &label,
+                          std::ofstream &ofs,
+                          const int verbosity) const;
+
     int inprim_index(const int,
                      const Symmetry *) const;
 
@@ -271,7 +336,7 @@ private:
     double get_estimated_max_alpha(const Eigen::MatrixXd &Amat,
                                    const Eigen::VectorXd &bvec) const;
 
-    void apply_scaler_displacement(std::vector<std::vector<double>> &u_inout,
+    void apply_scaler_displacement(DataMatrix &u_inout,
                                    const double normalization_factor,
                                    const bool scale_back = false) const;
 
@@ -291,7 +356,7 @@ private:
     void finalize_scalers(const int maxorder,
                           Constraint *constraint);
 
-    void apply_basis_converter(std::vector<std::vector<double>> &u_multi,
+    void apply_basis_converter(DataMatrix &u_multi,
                                Eigen::Matrix3d cmat) const;
 
     void apply_basis_converter_amat(const int natmin3,
@@ -299,6 +364,13 @@ private:
                                     double **amat_orig_tmp,
                                     Eigen::Matrix3d cmat) const;
 
+    int solve_sketched_lsqr(const size_t M,
+                            const size_t N,
+                            const double *amat,
+                            const double *bvec,
+                            std::vector<double> &x_out,
+                            const int verbosity) const;
+
     int fit_without_constraints(const size_t N,
                                 const size_t M,
                                 double *amat,
@@ -331,16 +403,53 @@ private:
     void get_matrix_elements(const int maxorder,
                              std::vector<double> &amat,
                              std::vector<double> &bvec,
-                             const std::vector<std::vector<double>> &u_in,
-                             const std::vector<std::vector<double>> &f_in,
+                             const DataMatrix &u_in,
+                             const DataMatrix &f_in,
                              const Symmetry *,
                              const Fcs *) const;
 
+    void generate_rows_algebraic_constraint(const int maxorder,
+                                            const double *u_row,
+                                            const double *f_row,
+                                            const Symmetry *symmetry,
+                                            const Fcs *fcs,
+                                            const Constraint *constraint,
+                                            int *ind,
+                                            double **amat_orig_tmp,
+                                            double **amat_mod_tmp,
+                                            double *bvec_block,
+                                            double *bvec_orig_block) const;
+
+    void get_normal_equations_algebraic_constraint(const int maxorder,
+                                                   Eigen::MatrixXd &AtA,
+                                                   Eigen::VectorXd &Atb,
+                                                   const DataMatrix &u_in,
+                                                   const DataMatrix &f_in,
+                                                   double &fnorm2,
+                                                   double &bnorm2,
+                                                   const Symmetry *symmetry,
+                                                   const Fcs *fcs,
+                                                   const Constraint *constraint,
+                                                   const int verbosity,
+                                                   const size_t istart_data = 0,
+                                                   const bool initialize = true) const;
+
+    int fit_normal_equations(const size_t N,
+                             const Eigen::MatrixXd &AtA,
+                             const Eigen::VectorXd &Atb,
+                             std::vector<double> &param_out,
+                             const double fnorm,
+                             const double bnorm2,
+                             const int maxorder,
+                             const Fcs *fcs,
+                             const Constraint *constraint,
+                             const int verbosity) const;
+
     void get_matrix_elements_in_sparse_form(const int maxorder,
                                             SpMat &sp_amat,
                                             Eigen::VectorXd &sp_bvec,
-                                            const std::vector<std::vector<double>> &u_in,
-                                            const std::vector<std::vector<double>> &f_in,
+                                            const DataMatrix &u_in,
+                                            const DataMatrix &f_in,
                                             double &fnorm,
                                             const Symmetry *symmetry,
                                             const Fcs *fcs,
@@ -372,6 +481,11 @@ private:
     double gamma(const int,
                  const int *) const;
 
+    // Largest number of columns for which the N x N Gram cache of the
+    // coordinate descent is allocated (16384^2 doubles = 2 GiB). Beyond
+    // this, the solver maintains residual vectors instead.
+    static const size_t nmax_gram_cache = 16384;
+
     void coordinate_descent(const int M,
                             const int N,
                             const double alpha,
@@ -385,7 +499,8 @@ private:
                             Eigen::VectorXd &grad,
                             const double fnorm,
                             const Eigen::VectorXd &scale_beta,
-                            const int verbosity) const;
+                            const int verbosity,
+                            const std::vector<int> *screened_cols = nullptr) const;
 
     void solution_path(const int maxorder,
                        Eigen::MatrixXd &A,
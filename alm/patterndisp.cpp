@@ -21,6 +21,7 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include "mathfunctions.h"
 #include "constraint.h"
 #include <map>
+#include <random>
 #include <boost/bimap.hpp>
 
 using namespace ALM_NS;
@@ -157,11 +158,31 @@ void Displace::gen_displacement_pattern(const Cluster *cluster,
 
     for (order = 0; order < maxorder; ++order) {
 
-        size_t m = 0;
+        // Offsets of the representative element of each orbit in fc_table,
+        // so that the orbits can be visited in any order by the threads
+        // below instead of through a running index.
+        const auto norbit = nequiv[order].size();
+        std::vector<size_t> orbit_offset(norbit + 1, 0);
+        for (size_t i = 0; i < norbit; ++i) {
+            orbit_offset[i + 1] = orbit_offset[i] + nequiv[order][i];
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel private(group_tmp)
+#endif
+        {
+            // Per-thread pattern sets; orbits whose reduced index group has
+            // already been produced by this thread short-circuit at the
+            // insertion. The thread sets are merged below, where the set
+            // ordering removes the duplicates found by different threads.
+            std::set<DispAtomSet> dispset_thread;
 
-        for (size_t i = 0; i < nequiv[order].size(); ++i) {
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+            for (long long i = 0; i < static_cast<long long>(norbit); ++i) {
 
-            if (include_set[order].find(i) != include_set[order].end()) {
+                if (include_set[order].find(i) == include_set[order].end()) continue;
 
                 group_tmp.clear();
 
@@ -169,17 +190,19 @@ void Displace::gen_displacement_pattern(const Cluster *cluster,
                 // Here, duplicate entries will be removed.
                 // For example, (iij) will be reduced to (ij).
                 for (auto j = 0; j < order + 1; ++j) {
-                    group_tmp.push_back(fc_table[order][m].elems[j]);
+                    group_tmp.push_back(fc_table[order][orbit_offset[i]].elems[j]);
                 }
                 group_tmp.erase(std::unique(group_tmp.begin(), group_tmp.end()),
                                 group_tmp.end());
 
                 // Avoid equivalent entries using set.
-                dispset[order].insert(DispAtomSet(group_tmp));
-
+                dispset_thread.insert(DispAtomSet(group_tmp));
             }
 
-            m += nequiv[order][i];
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            dispset[order].insert(dispset_thread.begin(), dispset_thread.end());
         }
     }
     deallocate(include_set);
@@ -194,12 +217,26 @@ void Displace::gen_displacement_pattern(const Cluster *cluster,
                          symmetry,
                          dispset, preferred_basis);
 
+    if (nrandom > 0) {
+        for (order = 0; order < maxorder; ++order) {
+            if (pattern_all[order].size() > static_cast<size_t>(nrandom)) {
+                generate_random_patterns(order, dispset[order]);
+            }
+        }
+    }
+
     deallocate(dispset);
 
     if (verbosity > 0) {
         std::cout << " done!" << std::endl;
         std::cout << std::endl;
 
+        if (nrandom > 0) {
+            std::cout << "  NRANDOM = " << nrandom << ": Orders exceeding the budget use" << std::endl;
+            std::cout << "  randomized multi-atom patterns (RANDOM_SEED = "
+                      << random_seed << ")." << std::endl << std::endl;
+        }
+
         for (order = 0; order < maxorder; ++order) {
             std::cout << "  Number of disp. patterns for " << std::setw(9)
                       << cluster->get_ordername(order) << " : "
@@ -214,6 +251,13 @@ void Displace::set_trim_dispsign_for_evenfunc(const bool trim_dispsign_for_evenf
     trim_dispsign_for_evenfunc = trim_dispsign_for_evenfunc_in;
 }
 
+void Displace::set_random_pattern_params(const int nrandom_in,
+                                         const int random_seed_in)
+{
+    nrandom = nrandom_in;
+    random_seed = random_seed_in;
+}
+
 std::string Displace::get_disp_basis() const
 {
     return disp_basis;
@@ -233,6 +277,8 @@ void Displace::set_default_variables()
 {
     trim_dispsign_for_evenfunc = true;
     disp_basis = "CART";
+    nrandom = 0;
+    random_seed = 0;
     pattern_all = nullptr;
 }
 
@@ -248,14 +294,9 @@ void Displace::generate_pattern_all(const int maxorder,
                                     const std::set<DispAtomSet> *dispset_in,
                                     const std::string preferred_basis) const
 {
-    size_t i, j;
     int order;
-    double disp_tmp[3];
-
-    std::vector<int> atoms, vec_tmp, nums;
-    std::vector<double> directions, directions_copy;
-    std::vector<std::vector<int>> *sign_prod, sign_reduced;
-
+    std::vector<int> vec_tmp;
+    std::vector<std::vector<int>> *sign_prod;
 
     allocate(sign_prod, maxorder);
 
@@ -268,23 +309,44 @@ void Displace::generate_pattern_all(const int maxorder,
 
         pattern_all[order].clear();
 
+        // The entries of the pattern set are mutually independent, and the
+        // symmetry search of find_unique_sign_pairs dominates the cost of
+        // SUGGEST at high orders. Distribute the entries over the threads
+        // and splice the per-entry patterns back in the deterministic set
+        // order afterwards.
+        std::vector<const DispAtomSet *> entries;
+        entries.reserve(dispset_in[order].size());
         for (auto it = dispset_in[order].begin(); it != dispset_in[order].end(); ++it) {
+            entries.push_back(&(*it));
+        }
+
+        const auto nentry = entries.size();
+        std::vector<std::vector<AtomWithDirection>> patterns_of_entry(nentry);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (long long ientry = 0; ientry < static_cast<long long>(nentry); ++ientry) {
 
-            atoms.clear();
-            directions.clear();
-            nums.clear();
+            size_t i, j;
+            double disp_tmp[3];
+            std::vector<int> atoms, nums;
+            std::vector<double> directions, directions_copy;
+            std::vector<std::vector<int>> sign_reduced;
 
-            for (i = 0; i < (*it).atomset.size(); ++i) {
+            const auto &atomset = entries[ientry]->atomset;
 
-                auto atom_tmp = (*it).atomset[i] / 3;
+            for (i = 0; i < atomset.size(); ++i) {
 
-                nums.push_back((*it).atomset[i]);
+                auto atom_tmp = atomset[i] / 3;
+
+                nums.push_back(atomset[i]);
                 atoms.push_back(atom_tmp);
 
                 for (j = 0; j < 3; ++j) {
                     disp_tmp[j] = 0.0;
                 }
-                disp_tmp[(*it).atomset[i] % 3] = 1.0;
+                disp_tmp[atomset[i] % 3] = 1.0;
 
                 for (j = 0; j < 3; ++j) directions.push_back(disp_tmp[j]);
             }
@@ -327,7 +389,13 @@ void Displace::generate_pattern_all(const int maxorder,
                         directions.push_back(disp_tmp[j]);
                     }
                 }
-                pattern_all[order].emplace_back(atoms, directions);
+                patterns_of_entry[ientry].emplace_back(atoms, directions);
+            }
+        }
+
+        for (auto &patterns: patterns_of_entry) {
+            for (auto &pattern: patterns) {
+                pattern_all[order].push_back(std::move(pattern));
             }
         }
     }
@@ -335,6 +403,57 @@ void Displace::generate_pattern_all(const int maxorder,
     deallocate(sign_prod);
 }
 
+void Displace::generate_random_patterns(const int order,
+                                        const std::set<DispAtomSet> &dispset_in) const
+{
+    // Replace the full irreducible pattern set of this order by 'nrandom'
+    // patterns in which every atom appearing in a cluster with free
+    // parameters is displaced along a random direction simultaneously.
+    // Each such snapshot excites all orbits at once with mutually
+    // incoherent sensing-matrix rows, so a sparse (elastic-net) fit can
+    // recover the model from far fewer force calculations than the
+    // one-cluster-at-a-time patterns.
+
+    std::set<int> atoms_involved;
+    for (const auto &it: dispset_in) {
+        for (const auto &ind: it.atomset) {
+            atoms_involved.insert(ind / 3);
+        }
+    }
+
+    const std::vector<int> atoms(atoms_involved.begin(), atoms_involved.end());
+
+    std::mt19937 rng(static_cast<unsigned int>(random_seed) + order);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+
+    pattern_all[order].clear();
+
+    std::vector<double> directions;
+    double disp_tmp[3];
+
+    for (auto ipat = 0; ipat < nrandom; ++ipat) {
+
+        directions.clear();
+
+        for (size_t i = 0; i < atoms.size(); ++i) {
+
+            // Normalized Gaussian vector: uniform direction on the sphere.
+            auto norm = 0.0;
+            while (norm < eps8) {
+                norm = 0.0;
+                for (auto j = 0; j < 3; ++j) {
+                    disp_tmp[j] = gauss(rng);
+                    norm += disp_tmp[j] * disp_tmp[j];
+                }
+            }
+            norm = std::sqrt(norm);
+            for (auto j = 0; j < 3; ++j) directions.push_back(disp_tmp[j] / norm);
+        }
+
+        pattern_all[order].emplace_back(atoms, directions);
+    }
+}
+
 void Displace::generate_signvecs(const int N,
                                  std::vector<std::vector<int>> &sign,
                                  std::vector<int> vec) const
@@ -131,11 +131,19 @@ public:
 
     void set_disp_basis(const std::string);
 
+    void set_random_pattern_params(const int nrandom_in,
+                                   const int random_seed_in);
+
     const std::vector<AtomWithDirection> &get_pattern_all(const int) const;
 
 private:
     bool trim_dispsign_for_evenfunc;
     std::string disp_basis;
+    // Budget for randomized multi-atom patterns (NRANDOM). When positive,
+    // orders whose full irreducible pattern set exceeds the budget emit
+    // nrandom patterns with random directions instead.
+    int nrandom;
+    int random_seed;
     std::vector<AtomWithDirection> *pattern_all;
 
     std::vector<DispDirectionHarmonic> disp_harm, disp_harm_best;
@@ -151,6 +159,9 @@ private:
                               const std::set<DispAtomSet> *dispset_in,
                               const std::string preferred_basis) const;
 
+    void generate_random_patterns(const int order,
+                                  const std::set<DispAtomSet> &dispset_in) const;
+
     void generate_signvecs(const int,
                            std::vector<std::vector<int>> &,
                            std::vector<int>) const;
@@ -3,6 +3,7 @@
 #include <cmath>
 #include <vector>
 #include <map>
+#include <utility>
 #include <algorithm>
 
 
@@ -42,7 +43,6 @@ void rref(const size_t nrows,
         if (std::abs(mat[pivot][icol]) > tolerance) ++nrank;
 
         if (pivot != irow) {
-            //#pragma omp parallel for private(tmp)
             for (jcol = icol; jcol < ncols; ++jcol) {
                 tmp = mat[pivot][jcol];
                 mat[pivot][jcol] = mat[irow][jcol];
@@ -52,18 +52,20 @@ void rref(const size_t nrows,
 
         tmp = mat[irow][icol];
         tmp = 1.0 / tmp;
-        //#pragma omp parallel for
         for (jcol = icol; jcol < ncols; ++jcol) {
             mat[irow][jcol] *= tmp;
         }
 
-        for (auto jrow = 0; jrow < nrows; ++jrow) {
+        // The row updates are independent of each other.
+#ifdef _OPENMP
+#pragma omp parallel for private(jcol)
+#endif
+        for (long jrow = 0; jrow < nrows; ++jrow) {
             if (jrow == irow) continue;
 
-            tmp = mat[jrow][icol];
-            //#pragma omp parallel for
+            const auto scale = mat[jrow][icol];
             for (jcol = icol; jcol < ncols; ++jcol) {
-                mat[jrow][jcol] -= tmp * mat[irow][jcol];
+                mat[jrow][jcol] -= scale * mat[irow][jcol];
             }
         }
     }
@@ -118,12 +120,15 @@ void rref(std::vector<std::vector<double>> &mat,
             mat[irow][jcol] *= tmp;
         }
 
-        for (size_t jrow = 0; jrow < nrows; ++jrow) {
+#ifdef _OPENMP
+#pragma omp parallel for private(jcol)
+#endif
+        for (long jrow = 0; jrow < nrows; ++jrow) {
             if (jrow == irow) continue;
 
-            tmp = mat[jrow][icol];
+            const auto scale = mat[jrow][icol];
             for (jcol = icol; jcol < ncols; ++jcol) {
-                mat[jrow][jcol] -= tmp * mat[irow][jcol];
+                mat[jrow][jcol] -= scale * mat[irow][jcol];
             }
         }
     }
@@ -133,6 +138,91 @@ void rref(std::vector<std::vector<double>> &mat,
 }
 
 
+namespace {
+
+// A constraint row as a column-sorted list of (column, value) pairs.
+// The merge-based elimination below streams two such rows once instead of
+// performing one hash lookup per pivot-row element.
+using SparseRow = std::vector<std::pair<size_t, double>>;
+
+// row_j -= factor * row_p restricted to columns >= icol, dropping elements
+// smaller than zero_criterion. The pivot column icol itself is removed
+// explicitly, matching the explicit erase of the original implementation.
+// Columns that appear in row_j for the first time are appended to
+// added_cols so that the caller can keep its inverted index up to date.
+void eliminate_row(SparseRow &row_j,
+                   const SparseRow &row_p,
+                   const double factor,
+                   const size_t icol,
+                   const double zero_criterion,
+                   std::vector<size_t> &added_cols)
+{
+    SparseRow result;
+    result.reserve(row_j.size() + row_p.size());
+
+    size_t ia = 0, ib = 0;
+    const auto na = row_j.size();
+    const auto nb = row_p.size();
+
+    while (ia < na && row_j[ia].first < icol) {
+        result.emplace_back(row_j[ia]);
+        ++ia;
+    }
+    while (ib < nb && row_p[ib].first < icol) ++ib;
+
+    while (ia < na && ib < nb) {
+        if (row_j[ia].first == row_p[ib].first) {
+            const auto val = row_j[ia].second - factor * row_p[ib].second;
+            if (std::abs(val) >= zero_criterion && row_j[ia].first != icol) {
+                result.emplace_back(row_j[ia].first, val);
+            }
+            ++ia;
+            ++ib;
+        } else if (row_j[ia].first < row_p[ib].first) {
+            result.emplace_back(row_j[ia]);
+            ++ia;
+        } else {
+            const auto val = -factor * row_p[ib].second;
+            if (std::abs(val) >= zero_criterion && row_p[ib].first != icol) {
+                result.emplace_back(row_p[ib].first, val);
+                added_cols.push_back(row_p[ib].first);
+            }
+            ++ib;
+        }
+    }
+    while (ia < na) {
+        result.emplace_back(row_j[ia]);
+        ++ia;
+    }
+    while (ib < nb) {
+        const auto val = -factor * row_p[ib].second;
+        if (std::abs(val) >= zero_criterion && row_p[ib].first != icol) {
+            result.emplace_back(row_p[ib].first, val);
+            added_cols.push_back(row_p[ib].first);
+        }
+        ++ib;
+    }
+
+    row_j.swap(result);
+}
+
+// Binary search for a column index in a sorted row.
+inline SparseRow::iterator find_column(SparseRow &row,
+                                       const size_t icol)
+{
+    const auto it = std::lower_bound(row.begin(), row.end(),
+                                     std::make_pair(icol, 0.0),
+                                     [](const std::pair<size_t, double> &a,
+                                        const std::pair<size_t, double> &b) {
+                                         return a.first < b.first;
+                                     });
+    if (it != row.end() && it->first == icol) return it;
+    return row.end();
+}
+
+} // namespace
+
+
 void rref_sparse(const size_t ncols,
                  ConstraintSparseForm &sp_constraint,
                  const double tolerance)
@@ -141,109 +231,167 @@ void rref_sparse(const size_t ncols,
     // The loss of numerical digits can lead to instability.
     // Column ordering may improve the stability, but I'm not sure.
     // Smaller tolerance is preferable.
+    //
+    // The rows are converted to column-sorted arrays once; the pivot row
+    // for each step is the first remaining row whose leading element (the
+    // first one at least as large as the tolerance) sits in the smallest
+    // column, exactly as in the original column-by-column scan, and the
+    // independent row eliminations run in parallel. An inverted index
+    // mapping each column to the rows that may contain it restricts every
+    // elimination step to the rows actually holding the pivot column.
 
     const auto nrows = sp_constraint.size();
-    size_t jrow;
-    double scaling_factor;
-    double division_factor;
 
     // This parameter controls the stability and performance.
     // Smaller value is more stable but little more costly.
     //    double zero_criterion = tolerance * 1.0e-3;
     const auto zero_criterion = eps15;
 
+    std::vector<SparseRow> rows(nrows);
+
+    for (size_t irow = 0; irow < nrows; ++irow) {
+        rows[irow].reserve(sp_constraint[irow].size());
+        for (const auto &it: sp_constraint[irow]) {
+            rows[irow].emplace_back(it.first, it.second);
+        }
+        std::sort(rows[irow].begin(), rows[irow].end());
+    }
+
+    // Inverted index: for every column, the rows that may contain it.
+    // Entries may become stale when an element is dropped during the
+    // elimination; the binary search below filters those out.
+
+    std::vector<std::vector<size_t>> rows_with_column(ncols);
+
+    for (size_t irow = 0; irow < nrows; ++irow) {
+        for (const auto &elem: rows[irow]) {
+            rows_with_column[elem.first].push_back(irow);
+        }
+    }
+
+    std::vector<size_t> candidates;
+    std::vector<std::pair<size_t, size_t>> fill_in;
+
     size_t nrank = 0;
-    size_t icol = 0;
-    MapConstraintElement::iterator it_other;
-    MapConstraintElement::iterator it_elem;
 
     for (size_t irow = 0; irow < nrows; ++irow) {
 
-        auto pivot = irow;
+        // Locate the pivot: the smallest leading column among the remaining
+        // rows, ties broken by the lowest row index. Elements below the
+        // tolerance are skipped but kept in the rows, as before.
 
-        while (true) {
-            it_elem = sp_constraint[pivot].find(icol);
-            if (it_elem != sp_constraint[pivot].end()) {
-                if (std::abs(it_elem->second) >= tolerance) {
+        auto icol = ncols;
+        auto pivot = nrows;
+
+        for (size_t jrow = irow; jrow < nrows; ++jrow) {
+            for (const auto &elem: rows[jrow]) {
+                if (elem.first >= icol) break;
+                if (std::abs(elem.second) >= tolerance) {
+                    icol = elem.first;
+                    pivot = jrow;
                     break;
                 }
             }
-
-            ++pivot;
-            if (pivot == nrows) {
-                pivot = irow;
-                ++icol;
-
-                if (icol == ncols) break;
-            }
         }
 
-        if (icol == ncols) break;
+        if (pivot == nrows) break;
 
-        if (std::abs(it_elem->second) >= tolerance) ++nrank;
+        ++nrank;
 
         if (pivot != irow) {
-            std::iter_swap(sp_constraint.begin() + irow,
-                           sp_constraint.begin() + pivot);
+            rows[pivot].swap(rows[irow]);
+            // The swap moves the elements to different storage slots;
+            // register both slots again so that the index keeps covering them.
+            for (const auto &elem: rows[irow]) {
+                rows_with_column[elem.first].push_back(irow);
+            }
+            for (const auto &elem: rows[pivot]) {
+                rows_with_column[elem.first].push_back(pivot);
+            }
         }
 
-        division_factor = 1.0 / it_elem->second;
-        for (auto &it: sp_constraint[irow]) {
-            it.second *= division_factor;
+        const auto it_pivot = find_column(rows[irow], icol);
+        const auto division_factor = 1.0 / it_pivot->second;
+        for (auto &elem: rows[irow]) {
+            elem.second *= division_factor;
         }
 
-        for (jrow = 0; jrow < nrows; ++jrow) {
-            if (jrow == irow) continue;
+        const auto &row_pivot = rows[irow];
 
-            it_elem = sp_constraint[jrow].find(icol);
-            if (it_elem == sp_constraint[jrow].end()) continue;
-            scaling_factor = it_elem->second;
+        // Only the rows registered for the pivot column need elimination.
+        // The registrations can hold duplicates, which must be removed here
+        // since two threads must not touch the same row concurrently.
 
-            // Subtract irow elements from jrow
-            for (const auto &it_now: sp_constraint[irow]) {
-                // This part might be accelerated by using std::map::lower_bound
-                // when the datatype of sp_constraint[irow] is std::map.
-                if (it_now.first < icol) {
-                    continue;
-                }
-                it_other = sp_constraint[jrow].find(it_now.first);
-                if (it_other != sp_constraint[jrow].end()) {
-                    it_other->second -= scaling_factor * it_now.second;
-                    // Delete zero elements and remove from map. 
-                    // A smaller threshould is used for better stability.
-                    if (std::abs(it_other->second) < zero_criterion) {
-                        sp_constraint[jrow].erase(it_other);
-                    }
-                } else {
-                    sp_constraint[jrow][it_now.first] = -scaling_factor * it_now.second;
+        candidates = rows_with_column[icol];
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+
+        // After this step, the pivot column survives only in the pivot row,
+        // which is excluded from all later pivot searches.
+        rows_with_column[icol].clear();
+
+        fill_in.clear();
+
+        const auto ncandidates = static_cast<long>(candidates.size());
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            std::vector<std::pair<size_t, size_t>> fill_in_local;
+            std::vector<size_t> added_cols;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 8) nowait
+#endif
+            for (long jj = 0; jj < ncandidates; ++jj) {
+                const auto jrow = candidates[jj];
+                if (jrow == static_cast<size_t>(irow)) continue;
+
+                const auto it_elem = find_column(rows[jrow], icol);
+                if (it_elem == rows[jrow].end()) continue;
+
+                added_cols.clear();
+                eliminate_row(rows[jrow], row_pivot,
+                              it_elem->second, icol, zero_criterion,
+                              added_cols);
+
+                for (const auto &col: added_cols) {
+                    fill_in_local.emplace_back(col, jrow);
                 }
             }
-            // Make sure to erase the icol element from the target row if it exists.
-            // When the original pivot element is large, the element after subtraction can sometimes be 
-            // larger than the tolerance value because of the loss of significant digis.
-            it_other = sp_constraint[jrow].find(icol);
-            if (it_other != sp_constraint[jrow].end()) {
-                sp_constraint[jrow].erase(it_other);
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            {
+                fill_in.insert(fill_in.end(),
+                               fill_in_local.begin(), fill_in_local.end());
             }
         }
+
+        for (const auto &it: fill_in) {
+            rows_with_column[it.first].push_back(it.second);
+        }
     }
 
-    // Erase all elements smaller than the tolerance value
-    for (jrow = 0; jrow < nrows; ++jrow) {
-        auto it_other = sp_constraint[jrow].begin();
-        while (it_other != sp_constraint[jrow].end()) {
-            if (std::abs(it_other->second) <= tolerance) {
-                sp_constraint[jrow].erase(it_other++);
-            } else {
-                ++it_other;
+    // Erase all elements smaller than the tolerance value and rebuild the
+    // map representation, dropping rows that became empty.
+
+    sp_constraint.clear();
+    sp_constraint.reserve(nrank);
+
+    for (size_t jrow = 0; jrow < nrows; ++jrow) {
+        MapConstraintElement row_out;
+        for (const auto &elem: rows[jrow]) {
+            if (std::abs(elem.second) > tolerance) {
+                row_out.emplace(elem.first, elem.second);
             }
         }
+        if (!row_out.empty()) {
+            sp_constraint.emplace_back(std::move(row_out));
+        }
     }
-
-    // Remove emptry entries from the sp_constraint vector
-    sp_constraint.erase(std::remove_if(sp_constraint.begin(),
-                                       sp_constraint.end(),
-                                       [](const MapConstraintElement &obj) { return obj.empty(); }),
-                        sp_constraint.end());
     sp_constraint.shrink_to_fit();
 }
@@ -58,6 +58,16 @@ void Symmetry::set_print_symmetry(const int printsymmetry_in)
     printsymmetry = printsymmetry_in;
 }
 
+int Symmetry::get_use_symmetry_cache() const
+{
+    return use_symmetry_cache;
+}
+
+void Symmetry::set_use_symmetry_cache(const int use_symmetry_cache_in)
+{
+    use_symmetry_cache = use_symmetry_cache_in;
+}
+
 const std::vector<Maps> &Symmetry::get_map_s2p() const
 {
     return map_s2p;
@@ -150,6 +160,7 @@ void Symmetry::init(const System *system,
 void Symmetry::set_default_variables()
 {
     file_sym = "SYMM_INFO";
+    file_sym_cache = "SYMM_CACHE";
 
     // Default values
     nsym = 0;
@@ -158,6 +169,7 @@ void Symmetry::set_default_variables()
     nat_prim = 0;
     tolerance = 1e-3;
     use_internal_symm_finder = false;
+    use_symmetry_cache = 0;
 }
 
 void Symmetry::deallocate_variables() {}
@@ -180,23 +192,42 @@ void Symmetry::setup_symmetry_operation(const Cell &cell,
         }
     }
 
-    if (use_internal_symm_finder) {
-        // SymmData is written.
-        findsym_alm(cell, is_periodic, atomtype_group, spin);
-    } else {
-        std::string spgsymbol;
-        // SymmData is written.
-        const auto spgnum = findsym_spglib(cell, atomtype_group, spin, spgsymbol);
+    uint64_t cell_hash = 0;
+    auto loaded_from_cache = false;
 
-        if (verbosity > 0) {
-            std::cout << "  Space group: " << spgsymbol << " (" << std::setw(3) << spgnum << ")" << std::endl;
+    if (use_symmetry_cache) {
+        cell_hash = hash_cell(cell, spin);
+        loaded_from_cache = load_symmetry_cache(cell_hash);
+
+        if (loaded_from_cache && verbosity > 0) {
+            std::cout << "  SYMCACHE = 1: Symmetry operations restored from the "
+                      << file_sym_cache << " file." << std::endl;
         }
+    }
+
+    if (!loaded_from_cache) {
+
+        if (use_internal_symm_finder) {
+            // SymmData is written.
+            findsym_alm(cell, is_periodic, atomtype_group, spin);
+        } else {
+            std::string spgsymbol;
+            // SymmData is written.
+            const auto spgnum = findsym_spglib(cell, atomtype_group, spin, spgsymbol);
+
+            if (verbosity > 0) {
+                std::cout << "  Space group: " << spgsymbol << " (" << std::setw(3) << spgnum << ")" << std::endl;
+            }
 
+        }
+
+        // The order in SymmData changes for each run because it was generated
+        // with OpenMP. Therefore, we sort the list here to have the same result.
+        std::sort(SymmData.begin() + 1, SymmData.end());
+
+        if (use_symmetry_cache) save_symmetry_cache(cell_hash);
     }
 
-    // The order in SymmData changes for each run because it was generated
-    // with OpenMP. Therefore, we sort the list here to have the same result.
-    std::sort(SymmData.begin() + 1, SymmData.end());
     nsym = SymmData.size();
 
     if (printsymmetry) {
@@ -243,6 +274,118 @@ void Symmetry::setup_symmetry_operation(const Cell &cell,
     }
 }
 
+uint64_t Symmetry::hash_cell(const Cell &cell,
+                             const Spin &spin) const
+{
+    // FNV-1a hash over the raw bytes of the quantities that determine
+    // the symmetry operations. Identical input files produce bitwise
+    // identical structures, which is the use case of the cache.
+
+    auto hash = 14695981039346656037ULL;
+
+    auto mix_bytes = [&hash](const void *ptr, const size_t nbytes) {
+        const auto *p = static_cast<const unsigned char *>(ptr);
+        for (size_t ib = 0; ib < nbytes; ++ib) {
+            hash ^= static_cast<uint64_t>(p[ib]);
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix_bytes(&cell.lattice_vector[0][0], 9 * sizeof(double));
+
+    const auto nat_tmp = static_cast<uint64_t>(cell.number_of_atoms);
+    mix_bytes(&nat_tmp, sizeof(nat_tmp));
+
+    for (const auto &kd: cell.kind) {
+        mix_bytes(&kd, sizeof(kd));
+    }
+    for (const auto &xf: cell.x_fractional) {
+        mix_bytes(&xf[0], 3 * sizeof(double));
+    }
+
+    mix_bytes(&tolerance, sizeof(tolerance));
+    mix_bytes(&spin.lspin, sizeof(spin.lspin));
+    mix_bytes(&spin.noncollinear, sizeof(spin.noncollinear));
+    mix_bytes(&spin.time_reversal_symm, sizeof(spin.time_reversal_symm));
+
+    if (spin.lspin) {
+        for (const auto &mag: spin.magmom) {
+            mix_bytes(&mag[0], 3 * sizeof(double));
+        }
+    }
+
+    return hash;
+}
+
+bool Symmetry::load_symmetry_cache(const uint64_t cell_hash)
+{
+    std::ifstream ifs(file_sym_cache.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs) return false;
+
+    char magic[8];
+    ifs.read(magic, 8);
+    if (!ifs || std::string(magic, 8) != "ALMSYMC1") return false;
+
+    uint64_t hash_stored, nsym_stored;
+    ifs.read(reinterpret_cast<char *>(&hash_stored), sizeof(hash_stored));
+    ifs.read(reinterpret_cast<char *>(&nsym_stored), sizeof(nsym_stored));
+    if (!ifs || hash_stored != cell_hash || nsym_stored == 0) return false;
+
+    SymmData.clear();
+    SymmData.reserve(nsym_stored);
+
+    int rot[3][3];
+    double tran[3], rot_cart[3][3];
+    unsigned char flags[3];
+
+    for (uint64_t i = 0; i < nsym_stored; ++i) {
+        ifs.read(reinterpret_cast<char *>(&rot[0][0]), 9 * sizeof(int));
+        ifs.read(reinterpret_cast<char *>(&tran[0]), 3 * sizeof(double));
+        ifs.read(reinterpret_cast<char *>(&rot_cart[0][0]), 9 * sizeof(double));
+        ifs.read(reinterpret_cast<char *>(&flags[0]), 3);
+
+        if (!ifs) {
+            SymmData.clear();
+            return false;
+        }
+
+        SymmData.emplace_back(rot, tran, rot_cart,
+                              flags[0] != 0,
+                              flags[1] != 0,
+                              flags[2] != 0);
+    }
+
+    return true;
+}
+
+void Symmetry::save_symmetry_cache(const uint64_t cell_hash) const
+{
+    std::ofstream ofs(file_sym_cache.c_str(),
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        warn("save_symmetry_cache",
+             "Cannot create the symmetry cache file. The cache is skipped.");
+        return;
+    }
+
+    ofs.write("ALMSYMC1", 8);
+    ofs.write(reinterpret_cast<const char *>(&cell_hash), sizeof(cell_hash));
+    const auto nsym_tmp = static_cast<uint64_t>(SymmData.size());
+    ofs.write(reinterpret_cast<const char *>(&nsym_tmp), sizeof(nsym_tmp));
+
+    unsigned char flags[3];
+
+    for (const auto &symm: SymmData) {
+        ofs.write(reinterpret_cast<const char *>(&symm.rotation[0][0]), 9 * sizeof(int));
+        ofs.write(reinterpret_cast<const char *>(&symm.tran[0]), 3 * sizeof(double));
+        ofs.write(reinterpret_cast<const char *>(&symm.rotation_cart[0][0]), 9 * sizeof(double));
+        flags[0] = symm.compatible_with_lattice ? 1 : 0;
+        flags[1] = symm.compatible_with_cartesian ? 1 : 0;
+        flags[2] = symm.is_translation ? 1 : 0;
+        ofs.write(reinterpret_cast<const char *>(&flags[0]), 3);
+    }
+}
+
 void Symmetry::findsym_alm(const Cell &cell,
                            const int is_periodic[3],
                            const std::vector<std::vector<unsigned int>> &atomtype_group,
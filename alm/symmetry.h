@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "system.h"
@@ -115,6 +116,10 @@ public:
 
     void set_print_symmetry(const int);
 
+    int get_use_symmetry_cache() const;
+
+    void set_use_symmetry_cache(const int);
+
     const std::vector<Maps> &get_map_s2p() const;
 
     const std::vector<std::vector<int>> &get_map_p2s() const;
@@ -142,6 +147,7 @@ private:
     double tolerance;
     bool use_internal_symm_finder;
     int printsymmetry;
+    int use_symmetry_cache;
 
     void set_default_variables();
 
@@ -200,6 +206,17 @@ private:
                                double **x_prim,
                                const double symprec) const;
 
+    // Binary cache of the detected symmetry operations, keyed by a hash
+    // of the cell so that repeated runs on the identical supercell skip
+    // the detection stage (SYMCACHE = 1).
+    uint64_t hash_cell(const Cell &,
+                       const Spin &) const;
+
+    bool load_symmetry_cache(const uint64_t cell_hash);
+
+    void save_symmetry_cache(const uint64_t cell_hash) const;
+
     std::string file_sym;
+    std::string file_sym_cache;
 };
 }
@@ -21,6 +21,8 @@
 #include "system.h"
 #include "timer.h"
 #include "version.h"
+#include "fcs_binary.h"
+#include <cstdint>
 #include <iostream>
 #include <fstream>
 #include <map>
@@ -33,6 +35,7 @@ using namespace ALM_NS;
 Writer::Writer() : output_maxorder(5)
 {
     save_format_flags["alamode"] = 1;
+    save_format_flags["binary"] = 0;
     save_format_flags["shengbte"] = 0;
     save_format_flags["qefc"] = 0;
     save_format_flags["hessian"] = 0;
@@ -77,6 +80,7 @@ void Writer::write_input_vars(const System *system,
     std::cout << "  MAGMOM = " << system->get_str_magmom() << '\n';
     std::cout << "  FCS_ALAMODE = " << save_format_flags.at("alamode") << ';';
     std::cout << "  NMAXSAVE = " << get_output_maxorder() << '\n';
+    std::cout << "  FCS_BINARY = " << save_format_flags.at("binary") << '\n';
     std::cout << "  FC3_SHENGBTE = " << save_format_flags.at("shengbte") << '\n';
     std::cout << "  FC2_QEFC = " << save_format_flags.at("qefc") << '\n';
     std::cout << "  HESSIAN = " << save_format_flags.at("hessian") << '\n';
@@ -171,6 +175,20 @@ void Writer::save_fcs_with_specific_format(const std::string fcs_format,
                                    fname_save,
                                    verbosity);
 
+    } else if (fcs_format == "binary") {
+        auto fname_save = get_filename_fcs();
+        if (fname_save.empty()) {
+            fname_save = files->get_prefix() + ".fcsbin";
+        }
+
+        save_fcs_alamode_binary(system,
+                                symmetry,
+                                cluster,
+                                fcs,
+                                constraint,
+                                fname_save,
+                                verbosity);
+
     } else if (fcs_format == "shengbte") {
 
         if (cluster->get_maxorder() > 1) {
@@ -784,6 +802,163 @@ void Writer::save_fcs_alamode_oldformat(const System *system,
     }
 }
 
+void Writer::get_fcs_arrays(const System *system,
+                            const Symmetry *symmetry,
+                            const Cluster *cluster,
+                            const Fcs *fcs,
+                            FcsArrays &arrays) const
+{
+    // Collect the force constants into the in-memory container shared with
+    // ANPHON (fcs_binary.h). The records are the same (pairs, value)
+    // tuples as the HARMONIC/ANHARMn sections of the XML format, stored as
+    // flat arrays. The container is written verbatim to the *.fcsbin file
+    // by save_fcs_alamode_binary, and can also be handed directly to
+    // Fcs_phonon::set_fcs_from_arrays by a driver running both codes in
+    // one process, skipping the file round-trip entirely.
+
+    size_t j, k;
+    int *pair_tmp;
+    std::vector<int> atom_tmp;
+    std::vector<std::vector<int>> cell_dummy;
+    std::set<InteractionCluster>::iterator iter_cluster;
+
+    auto norder = cluster->get_maxorder();
+    if (norder > get_output_maxorder()) norder = get_output_maxorder();
+
+    arrays.values.clear();
+    arrays.indices.clear();
+    arrays.values.resize(norder);
+    arrays.indices.resize(norder);
+
+    auto &values = arrays.values;
+    auto &indices = arrays.indices;
+
+    allocate(pair_tmp, cluster->get_maxorder() + 1);
+
+    for (auto order = 0; order < norder; ++order) {
+
+        auto fc_cart = fcs->get_fc_cart()[order];
+        std::sort(fc_cart.begin(), fc_cart.end());
+
+        for (const auto &it: fc_cart) {
+
+            // As in the XML format, anharmonic force constants are saved
+            // only when the last (order + 1) elements are sorted in
+            // ascending order.
+
+            if (order > 0 && !it.is_ascending_order) continue;
+
+            for (k = 0; k < order + 2; ++k) {
+                pair_tmp[k] = it.atoms[k];
+            }
+            j = symmetry->get_map_s2p()[pair_tmp[0]].atom_num;
+
+            atom_tmp.clear();
+            for (k = 1; k < order + 2; ++k) {
+                atom_tmp.push_back(pair_tmp[k]);
+            }
+            std::sort(atom_tmp.begin(), atom_tmp.end());
+
+            iter_cluster = cluster->get_interaction_cluster(order, j).find(
+                    InteractionCluster(atom_tmp, cell_dummy));
+
+            if (iter_cluster == cluster->get_interaction_cluster(order, j).end()) {
+                exit("save_fcs_alamode_binary", "This cannot happen.");
+            }
+            const auto multiplicity = (*iter_cluster).cell.size();
+
+            for (size_t imult = 0; imult < multiplicity; ++imult) {
+                auto cell_now = (*iter_cluster).cell[imult];
+
+                values[order].push_back(it.fc_value / static_cast<double>(multiplicity));
+
+                indices[order].push_back(j + 1);
+                indices[order].push_back(it.coords[0] + 1);
+                indices[order].push_back(0);
+                for (k = 1; k < order + 2; ++k) {
+                    indices[order].push_back(pair_tmp[k] + 1);
+                    indices[order].push_back(it.coords[k] + 1);
+                    indices[order].push_back(cell_now[k - 1] + 1);
+                }
+            }
+        }
+    }
+    deallocate(pair_tmp);
+}
+
+void Writer::save_fcs_alamode_binary(const System *system,
+                                     const Symmetry *symmetry,
+                                     const Cluster *cluster,
+                                     const Fcs *fcs,
+                                     const Constraint *constraint,
+                                     const std::string fname_fcs,
+                                     const int verbosity) const
+{
+    // Save the force constants in the native binary container described in
+    // fcs_binary.h. The records make the file several times smaller than
+    // the XML format and let ANPHON load each table with a single bulk
+    // read instead of parsing text. The header also records whether the
+    // translational sum rules were imposed (ICONST > 0) together with a
+    // checksum per table, so that ANPHON can skip re-examining the
+    // translational invariance of an unmodified file.
+
+    FcsArrays arrays;
+    get_fcs_arrays(system, symmetry, cluster, fcs, arrays);
+
+    const auto &values = arrays.values;
+    const auto &indices = arrays.indices;
+    const int norder = values.size();
+
+    std::vector<FcsBinaryTableInfo> table_info(norder);
+    std::vector<std::uint64_t> checksum(norder);
+    std::uint64_t offset = sizeof(fcs_binary_magic) + 4 * sizeof(std::uint32_t)
+                           + norder * (sizeof(FcsBinaryTableInfo) + sizeof(std::uint64_t));
+    for (auto order = 0; order < norder; ++order) {
+        table_info[order].nelem = values[order].size();
+        table_info[order].offset = offset;
+        offset += values[order].size() * sizeof(double)
+                  + indices[order].size() * sizeof(std::uint32_t);
+
+        auto chk = fcs_binary_checksum(values[order].data(),
+                                       values[order].size() * sizeof(double));
+        checksum[order] = fcs_binary_checksum(indices[order].data(),
+                                              indices[order].size() * sizeof(std::uint32_t),
+                                              chk);
+    }
+
+    std::ofstream ofs_fcs(fname_fcs.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs_fcs) {
+        exit("save_fcs_alamode_binary", "cannot open fcsbin file");
+    }
+
+    const auto version = fcs_binary_version;
+    const auto norder_out = static_cast<std::uint32_t>(norder);
+    const std::uint32_t asr_imposed = constraint->get_constraint_mode() != 0 ? 1 : 0;
+    const std::uint32_t reserved = 0;
+    ofs_fcs.write(fcs_binary_magic, sizeof(fcs_binary_magic));
+    ofs_fcs.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    ofs_fcs.write(reinterpret_cast<const char *>(&norder_out), sizeof(norder_out));
+    ofs_fcs.write(reinterpret_cast<const char *>(&asr_imposed), sizeof(asr_imposed));
+    ofs_fcs.write(reinterpret_cast<const char *>(&reserved), sizeof(reserved));
+    ofs_fcs.write(reinterpret_cast<const char *>(&table_info[0]),
+                  norder * sizeof(FcsBinaryTableInfo));
+    ofs_fcs.write(reinterpret_cast<const char *>(&checksum[0]),
+                  norder * sizeof(std::uint64_t));
+
+    for (auto order = 0; order < norder; ++order) {
+        if (values[order].empty()) continue;
+        ofs_fcs.write(reinterpret_cast<const char *>(&values[order][0]),
+                      values[order].size() * sizeof(double));
+        ofs_fcs.write(reinterpret_cast<const char *>(&indices[order][0]),
+                      indices[order].size() * sizeof(std::uint32_t));
+    }
+    ofs_fcs.close();
+
+    if (verbosity > 0) {
+        std::cout << " Binary input data for the phonon code ANPHON : " << fname_fcs << std::endl;
+    }
+}
+
 void Writer::write_hessian(const System *system,
                            const Symmetry *symmetry,
                            const Fcs *fcs,
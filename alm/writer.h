@@ -21,6 +21,7 @@
 #include "constraint.h"
 #include "optimize.h"
 #include "files.h"
+#include "fcs_binary.h"
 
 
 namespace ALM_NS {
@@ -98,6 +99,12 @@ public:
                                        const Files *files,
                                        const int verbosity) const;
 
+    void get_fcs_arrays(const System *system,
+                        const Symmetry *symmetry,
+                        const Cluster *cluster,
+                        const Fcs *fcs,
+                        FcsArrays &arrays) const;
+
     void set_fcs_save_flag(const std::string key_str, const int val);
 
     int get_fcs_save_flag(const std::string key_str);
@@ -128,6 +135,14 @@ private:
                                     const std::string fname_fcs,
                                     const int verbosity) const;
 
+    void save_fcs_alamode_binary(const System *system,
+                                 const Symmetry *symmetry,
+                                 const Cluster *cluster,
+                                 const Fcs *fcs,
+                                 const Constraint *constraint,
+                                 const std::string fname_fcs,
+                                 const int verbosity) const;
+
     void write_hessian(const System *system,
                        const Symmetry *symmetry,
                        const Fcs *fcs,
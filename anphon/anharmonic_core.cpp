@@ -20,8 +20,10 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include "memory.h"
 #include "mode_analysis.h"
 #include "phonon_dos.h"
+#include "phonon_velocity.h"
 #include "system.h"
 #include "thermodynamics.h"
+#include "timer.h"
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
 #include <vector>
@@ -50,8 +52,7 @@ void AnharmonicCore::set_default_variables()
     use_tuned_ver = true;
     use_triplet_symmetry = true;
     use_quartet_symmetry = true;
-    relvec_v3 = nullptr;
-    relvec_v4 = nullptr;
+    mixed_precision = false;
     invmass_v3 = nullptr;
     invmass_v4 = nullptr;
     evec_index_v3 = nullptr;
@@ -61,16 +62,11 @@ void AnharmonicCore::set_default_variables()
     phi3_reciprocal = nullptr;
     phi4_reciprocal = nullptr;
     phase_storage_dos = nullptr;
+    phvel_adaptive = nullptr;
 }
 
 void AnharmonicCore::deallocate_variables()
 {
-    if (relvec_v3) {
-        deallocate(relvec_v3);
-    }
-    if (relvec_v4) {
-        deallocate(relvec_v4);
-    }
     if (invmass_v3) {
         deallocate(invmass_v3);
     }
@@ -96,6 +92,44 @@ void AnharmonicCore::deallocate_variables()
         deallocate(phi4_reciprocal);
     }
     if (phase_storage_dos) delete phase_storage_dos;
+    if (phvel_adaptive) deallocate(phvel_adaptive);
+    if (damp_v3_ws) deallocate(damp_v3_ws);
+    if (damp_delta_ws) deallocate(damp_delta_ws);
+    if (damp_ks_ws) deallocate(damp_ks_ws);
+    if (damp_v3batch_ws) deallocate(damp_v3batch_ws);
+    if (damp_kmap_ws) deallocate(damp_kmap_ws);
+}
+
+void AnharmonicCore::ensure_damping_workspace(const size_t npair,
+                                              const size_t ns2,
+                                              const size_t nk_in)
+{
+    // The band count is fixed within a run, so only the triplet-list
+    // length and (for the tetrahedron path) the mesh size can grow.
+
+    if (npair > damp_npair_ws || ns2 != damp_ns2_ws) {
+        if (damp_v3_ws) deallocate(damp_v3_ws);
+        if (damp_delta_ws) deallocate(damp_delta_ws);
+        const auto npair_new = std::max(npair, damp_npair_ws);
+        allocate(damp_v3_ws, npair_new, ns2);
+        allocate(damp_delta_ws, npair_new, ns2, 2);
+        damp_npair_ws = npair_new;
+    }
+
+    if (ns2 != damp_ns2_ws) {
+        if (damp_ks_ws) deallocate(damp_ks_ws);
+        if (damp_v3batch_ws) deallocate(damp_v3batch_ws);
+        allocate(damp_ks_ws, ns2, 3);
+        allocate(damp_v3batch_ws, ns2);
+        damp_ns2_ws = ns2;
+    }
+
+    if (nk_in > damp_nk_ws) {
+        if (damp_kmap_ws) deallocate(damp_kmap_ws);
+        allocate(damp_kmap_ws, nk_in);
+        for (size_t i = 0; i < nk_in; ++i) damp_kmap_ws[i] = i;
+        damp_nk_ws = nk_in;
+    }
 }
 
 void AnharmonicCore::setup()
@@ -103,13 +137,39 @@ void AnharmonicCore::setup()
     sym_permutation = true;
     use_tuned_ver = true;
     MPI_Bcast(&use_tuned_ver, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&mixed_precision, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
 
-    if (fcs_phonon->maxorder >= 2) setup_cubic();
-    if (fcs_phonon->maxorder >= 3) setup_quartic();
+    // The cubic tables, the quartic tables, and the phase-factor storage
+    // are built from disjoint data, print nothing, and contain no MPI
+    // calls, so the three jobs can run concurrently. Sorting and grouping
+    // the quartic force constants dominates this part of the startup for
+    // large systems.
 
-    if (!mode_analysis->calc_fstate_k && dos->kmesh_dos) {
-        phase_storage_dos = new PhaseFactorStorage(dos->kmesh_dos->nk_i);
-        phase_storage_dos->create(use_tuned_ver);
+#ifdef _OPENMP
+#pragma omp parallel sections
+#endif
+    {
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        {
+            if (fcs_phonon->maxorder >= 2) setup_cubic();
+        }
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        {
+            if (fcs_phonon->maxorder >= 3) setup_quartic();
+        }
+#ifdef _OPENMP
+#pragma omp section
+#endif
+        {
+            if (!mode_analysis->calc_fstate_k && dos->kmesh_dos) {
+                phase_storage_dos = new PhaseFactorStorage(dos->kmesh_dos->nk_i);
+                phase_storage_dos->create(use_tuned_ver);
+            }
+        }
     }
 }
 
@@ -117,7 +177,7 @@ void AnharmonicCore::prepare_relative_vector(const std::vector<FcsArrayWithCell>
                                              const unsigned int N,
                                              const int number_of_groups,
                                              std::vector<double> *fcs_group,
-                                             std::vector<RelativeVector> *&vec_out) const
+                                             RelativeVectorSoA &vec_out) const
 {
     int i, j, k;
 
@@ -162,12 +222,22 @@ void AnharmonicCore::prepare_relative_vector(const std::vector<FcsArrayWithCell>
     cells.resize(N);
     atm_super.resize(N);
 
+    size_t nelems = 0;
+    for (auto igroup = 0; igroup < number_of_groups; ++igroup) {
+        nelems += fcs_group[igroup].size();
+    }
+    vec_out.set_size(number_of_groups, nelems);
+
+    const auto inv2pi = 1.0 / (2.0 * pi);
+
     unsigned int icount = 0;
 
     for (auto igroup = 0; igroup < number_of_groups; ++igroup) {
 
         unsigned int nsize_group = fcs_group[igroup].size();
 
+        vec_out.offset[igroup + 1] = vec_out.offset[igroup] + nsize_group;
+
         for (j = 0; j < nsize_group; ++j) {
 
             for (i = 0; i < N; ++i) {
@@ -185,10 +255,11 @@ void AnharmonicCore::prepare_relative_vector(const std::vector<FcsArrayWithCell>
                 rotvec(vecs[i], vecs[i], mat_convert);
             }
 
-            if (N == 3) {
-                vec_out[igroup].emplace_back(vecs[0], vecs[1]);
-            } else if (N == 4) {
-                vec_out[igroup].emplace_back(vecs[0], vecs[1], vecs[2]);
+            for (i = 0; i < N - 1; ++i) {
+                for (k = 0; k < 3; ++k) {
+                    vec_out.comp[i][k][icount] = vecs[i][k];
+                    vec_out.lattice[i][k][icount] = nint(vecs[i][k] * inv2pi);
+                }
             }
             ++icount;
         }
@@ -321,6 +392,8 @@ std::complex<double> AnharmonicCore::V3(const unsigned int ks[3],
     auto ret_re = 0.0;
     auto ret_im = 0.0;
 
+    count_event(EVENT_V3);
+
     for (i = 0; i < 3; ++i) {
         kn[i] = ks[i] / ns;
         sn[i] = ks[i] % ns;
@@ -351,13 +424,17 @@ std::complex<double> AnharmonicCore::V3(const unsigned int ks[3],
         kindex_phi3_stored[0] = kn[1];
         kindex_phi3_stored[1] = kn[2];
     }
+    const std::complex<double> *evec1 = evec_in[kn[0]][sn[0]];
+    const std::complex<double> *evec2 = evec_in[kn[1]][sn[1]];
+    const std::complex<double> *evec3 = evec_in[kn[2]][sn[2]];
+
 #ifdef _OPENMP
 #pragma omp parallel for private(ret), reduction(+: ret_re, ret_im)
 #endif
     for (i = 0; i < ngroup_v3; ++i) {
-        ret = evec_in[kn[0]][sn[0]][evec_index_v3[i][0]]
-              * evec_in[kn[1]][sn[1]][evec_index_v3[i][1]]
-              * evec_in[kn[2]][sn[2]][evec_index_v3[i][2]]
+        ret = evec1[evec_index_v3[i][0]]
+              * evec2[evec_index_v3[i][1]]
+              * evec3[evec_index_v3[i][2]]
               * invmass_v3[i] * phi3_reciprocal[i];
         ret_re += ret.real();
         ret_im += ret.imag();
@@ -382,6 +459,8 @@ std::complex<double> AnharmonicCore::Phi3(const unsigned int ks[3],
     double ret_re = 0.0;
     double ret_im = 0.0;
 
+    count_event(EVENT_V3);
+
     for (i = 0; i < 3; ++i) {
         kn[i] = ks[i] / ns;
         sn[i] = ks[i] % ns;
@@ -396,13 +475,17 @@ std::complex<double> AnharmonicCore::Phi3(const unsigned int ks[3],
         kindex_phi3_stored[0] = kn[1];
         kindex_phi3_stored[1] = kn[2];
     }
+    const std::complex<double> *evec1 = evec_in[kn[0]][sn[0]];
+    const std::complex<double> *evec2 = evec_in[kn[1]][sn[1]];
+    const std::complex<double> *evec3 = evec_in[kn[2]][sn[2]];
+
 #ifdef _OPENMP
 #pragma omp parallel for private(ret), reduction(+: ret_re, ret_im)
 #endif
     for (i = 0; i < ngroup_v3; ++i) {
-        ret = evec_in[kn[0]][sn[0]][evec_index_v3[i][0]]
-              * evec_in[kn[1]][sn[1]][evec_index_v3[i][1]]
-              * evec_in[kn[2]][sn[2]][evec_index_v3[i][2]]
+        ret = evec1[evec_index_v3[i][0]]
+              * evec2[evec_index_v3[i][1]]
+              * evec3[evec_index_v3[i][2]]
               * invmass_v3[i] * phi3_reciprocal[i];
         ret_re += ret.real();
         ret_im += ret.imag();
@@ -411,35 +494,267 @@ std::complex<double> AnharmonicCore::Phi3(const unsigned int ks[3],
     return std::complex<double>(ret_re, ret_im);
 }
 
+TripletKey AnharmonicCore::canonicalize_triplet(const unsigned int ks[3]) const
+{
+    // Map a (k,s) triplet onto the representative of its orbit under
+    // permutation of the three slots. |V3| is strictly equal among the
+    // permutations of a triplet, so a single cache entry serves all of
+    // them. Time reversal (k -> -k) is deliberately not folded into the
+    // orbit: it maps |V3| onto itself only when evec(-k) is the complex
+    // conjugate of evec(k), a gauge the eigensolver does not enforce and
+    // which breaks down inside degenerate subspaces. With the stored
+    // eigenvectors the folding was measured to shift |V3|^2 sums by about
+    // 0.1% on the Si regression, comparable to the convergence thresholds
+    // it would be hidden under.
+
+    unsigned int arr[3] = {ks[0], ks[1], ks[2]};
+
+    if (sym_permutation) {
+        std::sort(arr, arr + 3);
+    }
+    return TripletKey(arr);
+}
+
+double AnharmonicCore::V3_norm_cached(const unsigned int ks[3],
+                                      const KpointMeshUniform *kmesh_in,
+                                      const double *const *eval_in,
+                                      const std::complex<double> *const *const *evec_in)
+{
+    // The cache is valid only for a single set of eigenvectors.
+    // Invalidate it automatically when the caller switches to another one
+    // (e.g. SCPH-renormalized eigenvectors at a different temperature).
+    if (v3norm_cache_evec_tag != static_cast<const void *>(evec_in)) {
+        v3norm_cache.clear();
+        v3norm_cache_evec_tag = static_cast<const void *>(evec_in);
+    }
+
+    const auto key = canonicalize_triplet(ks);
+
+    const auto it = v3norm_cache.find(key);
+    if (it != v3norm_cache.end()) return it->second;
+
+    const auto ret = std::norm(V3(ks,
+                                  kmesh_in->xk,
+                                  eval_in,
+                                  evec_in,
+                                  phase_storage_dos));
+
+    if (v3norm_cache.size() < v3norm_cache_maxsize) {
+        v3norm_cache.emplace(key, ret);
+    }
+    return ret;
+}
+
+void AnharmonicCore::clear_v3norm_cache()
+{
+    v3norm_cache.clear();
+    v3norm_cache_evec_tag = nullptr;
+}
+
+void AnharmonicCore::V3_batch(const unsigned int ntriplet,
+                              const unsigned int *const *ks_in,
+                              const double *const *xk_in,
+                              const double *const *eval_in,
+                              const std::complex<double> *const *const *evec_in,
+                              const PhaseFactorStorage *phase_storage_in,
+                              std::complex<double> *ret)
+{
+    // Batched version of V3 for a block of (k,s) triplets.
+    // The phase sum over the force-constant list and the band-independent
+    // prefactor invmass_v3[i] * phi3_reciprocal[i] are evaluated only when the
+    // k-point triple changes and reused for every band combination in the block.
+    // The remaining gather-multiply loop is kept in structure-of-arrays form
+    // so that the compiler can vectorize it over the force-constant groups.
+
+    int i;
+    unsigned int it;
+    const int ns = dynamical->neval;
+
+    double *phi_re, *phi_im;
+    allocate(phi_re, ngroup_v3);
+    allocate(phi_im, ngroup_v3);
+
+    int kn_stored[3] = {-1, -1, -1};
+
+    count_event_n(EVENT_V3, ntriplet);
+
+    for (it = 0; it < ntriplet; ++it) {
+
+        unsigned int kn[3], sn[3];
+        double omega[3];
+
+        for (i = 0; i < 3; ++i) {
+            kn[i] = ks_in[it][i] / ns;
+            sn[i] = ks_in[it][i] % ns;
+            omega[i] = eval_in[kn[i]][sn[i]];
+        }
+
+        // Return zero if any of the involving phonon has imaginary frequency
+        if (omega[0] < eps8 || omega[1] < eps8 || omega[2] < eps8) {
+            ret[it] = std::complex<double>(0.0, 0.0);
+            continue;
+        }
+
+        if (kn[0] != kn_stored[0] || kn[1] != kn_stored[1] || kn[2] != kn_stored[2]) {
+
+            if (kn[1] != kindex_phi3_stored[0] || kn[2] != kindex_phi3_stored[1]) {
+                calc_phi3_reciprocal(xk_in[kn[1]],
+                                     xk_in[kn[2]],
+                                     phase_storage_in,
+                                     phi3_reciprocal);
+                kindex_phi3_stored[0] = kn[1];
+                kindex_phi3_stored[1] = kn[2];
+            }
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+            for (i = 0; i < ngroup_v3; ++i) {
+                const auto prefactor = invmass_v3[i] * phi3_reciprocal[i];
+                phi_re[i] = prefactor.real();
+                phi_im[i] = prefactor.imag();
+            }
+
+            for (i = 0; i < 3; ++i) kn_stored[i] = kn[i];
+        }
+
+        const std::complex<double> *evec1 = evec_in[kn[0]][sn[0]];
+        const std::complex<double> *evec2 = evec_in[kn[1]][sn[1]];
+        const std::complex<double> *evec3 = evec_in[kn[2]][sn[2]];
+
+        auto ret_re = 0.0;
+        auto ret_im = 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel for simd reduction(+: ret_re, ret_im)
+#endif
+        for (i = 0; i < ngroup_v3; ++i) {
+            const auto evc = evec1[evec_index_v3[i][0]]
+                             * evec2[evec_index_v3[i][1]]
+                             * evec3[evec_index_v3[i][2]];
+            ret_re += evc.real() * phi_re[i] - evc.imag() * phi_im[i];
+            ret_im += evc.real() * phi_im[i] + evc.imag() * phi_re[i];
+        }
+
+        ret[it] = std::complex<double>(ret_re, ret_im)
+                  / std::sqrt(omega[0] * omega[1] * omega[2]);
+    }
+
+    deallocate(phi_re);
+    deallocate(phi_im);
+}
+
+void AnharmonicCore::V3_head_contracted(const unsigned int ks1,
+                                        const unsigned int ks2,
+                                        const double *const *xk_in,
+                                        const std::complex<double> *const *const *evec_in,
+                                        const PhaseFactorStorage *phase_storage_in,
+                                        std::complex<double> *ret_head)
+{
+    // Contract the two tail legs of V3 with fixed (k1, s1) and (k2, s2),
+    // leaving the polarization index of the first leg open. The caller
+    // obtains V3(k0 s0; k1 s1; k2 s2) for every head band s0 from one dot
+    // product of evec_in[k0][s0] with ret_head (length neval) and the
+    // 1/sqrt(omega0*omega1*omega2) normalization, so a sweep over all
+    // head bands costs O(ngroup + ns) instead of O(ns * ngroup).
+
+    int i;
+    const int ns = dynamical->neval;
+
+    const auto kn1 = ks1 / ns;
+    const auto sn1 = ks1 % ns;
+    const auto kn2 = ks2 / ns;
+    const auto sn2 = ks2 % ns;
+
+    if (kn1 != kindex_phi3_stored[0] || kn2 != kindex_phi3_stored[1]) {
+        calc_phi3_reciprocal(xk_in[kn1],
+                             xk_in[kn2],
+                             phase_storage_in,
+                             phi3_reciprocal);
+        kindex_phi3_stored[0] = kn1;
+        kindex_phi3_stored[1] = kn2;
+    }
+
+    for (i = 0; i < ns; ++i) ret_head[i] = std::complex<double>(0.0, 0.0);
+
+    const std::complex<double> *evec1 = evec_in[kn1][sn1];
+    const std::complex<double> *evec2 = evec_in[kn2][sn2];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<std::complex<double>> accum(ns, std::complex<double>(0.0, 0.0));
+
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+        for (i = 0; i < ngroup_v3; ++i) {
+            accum[evec_index_v3[i][0]] += evec1[evec_index_v3[i][1]]
+                                          * evec2[evec_index_v3[i][2]]
+                                          * invmass_v3[i] * phi3_reciprocal[i];
+        }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        for (int m = 0; m < ns; ++m) ret_head[m] += accum[m];
+    }
+}
+
 void AnharmonicCore::calc_phi3_reciprocal(const double *xk1,
                                           const double *xk2,
                                           const PhaseFactorStorage *phase_storage_in,
                                           std::complex<double> *ret)
 {
-    int i, j;
+    int i;
+    size_t j, js, je;
     double phase;
     std::complex<double> ret_in;
-    unsigned int nsize_group;
 
     const auto tune_type_now = phase_storage_in->get_tune_type();
 
+    // The relative vectors are stored in structure-of-arrays form; the
+    // inner loops below stream through the contiguous per-component arrays.
+    const double *rv1[3], *rv2[3];
+    const int *nv1[3], *nv2[3];
+
+    for (i = 0; i < 3; ++i) {
+        rv1[i] = relvec_v3.comp[0][i].data();
+        rv2[i] = relvec_v3.comp[1][i].data();
+        nv1[i] = relvec_v3.lattice[0][i].data();
+        nv2[i] = relvec_v3.lattice[1][i].data();
+    }
+
     if (tune_type_now == 1) {
 
-#pragma omp parallel for private(ret_in, nsize_group, j, phase)
-        for (i = 0; i < ngroup_v3; ++i) {
+        // The phase index of the tabulated exponentials is an integer
+        // combination of the integer lattice components of the relative
+        // vectors and the integer mesh coordinates of the k points, so the
+        // inner loop gathers the precomputed exponentials without any
+        // floating-point rounding.
 
-            ret_in = std::complex<double>(0.0, 0.0);
-            nsize_group = fcs_group_v3[i].size();
+        int m1[3], m2[3];
+        long phase_int;
+        phase_storage_in->get_mesh_index(xk1, m1);
+        phase_storage_in->get_mesh_index(xk2, m2);
 
-            for (j = 0; j < nsize_group; ++j) {
-                phase = relvec_v3[i][j].vecs[0][0] * xk1[0]
-                        + relvec_v3[i][j].vecs[0][1] * xk1[1]
-                        + relvec_v3[i][j].vecs[0][2] * xk1[2]
-                        + relvec_v3[i][j].vecs[1][0] * xk2[0]
-                        + relvec_v3[i][j].vecs[1][1] * xk2[1]
-                        + relvec_v3[i][j].vecs[1][2] * xk2[2];
+#pragma omp parallel for private(ret_in, j, js, je, phase_int)
+        for (i = 0; i < ngroup_v3; ++i) {
 
-                ret_in += fcs_group_v3[i][j] * phase_storage_in->get_exp_type1(phase);
+            ret_in = std::complex<double>(0.0, 0.0);
+            js = relvec_v3.offset[i];
+            je = relvec_v3.offset[i + 1];
+
+            for (j = js; j < je; ++j) {
+                phase_int = static_cast<long>(nv1[0][j]) * m1[0]
+                            + static_cast<long>(nv1[1][j]) * m1[1]
+                            + static_cast<long>(nv1[2][j]) * m1[2]
+                            + static_cast<long>(nv2[0][j]) * m2[0]
+                            + static_cast<long>(nv2[1][j]) * m2[1]
+                            + static_cast<long>(nv2[2][j]) * m2[2];
+
+                ret_in += fcs_group_v3[i][j - js] * phase_storage_in->get_exp_type1_int(phase_int);
             }
             ret[i] = ret_in;
         }
@@ -448,41 +763,69 @@ void AnharmonicCore::calc_phi3_reciprocal(const double *xk1,
 
         // Tuned version is used when nk1=nk2=nk3 doesn't hold.
 
-        double phase3[3];
+        int m1[3], m2[3];
+        int phase3_int[3];
+        phase_storage_in->get_mesh_index(xk1, m1);
+        phase_storage_in->get_mesh_index(xk2, m2);
+
+#pragma omp parallel for private(ret_in, j, js, je, phase3_int)
+        for (i = 0; i < ngroup_v3; ++i) {
+
+            ret_in = std::complex<double>(0.0, 0.0);
+            js = relvec_v3.offset[i];
+            je = relvec_v3.offset[i + 1];
+
+            for (j = js; j < je; ++j) {
+                for (auto ii = 0; ii < 3; ++ii) {
+                    phase3_int[ii] = nv1[ii][j] * m1[ii] + nv2[ii][j] * m2[ii];
+                }
+                ret_in += fcs_group_v3[i][j - js] * phase_storage_in->get_exp_type2_int(phase3_int);
+            }
+            ret[i] = ret_in;
+        }
+    } else if (tune_type_now == 3) {
+
+        // Factorized tables for meshes whose dense 3D table is too large.
 
-#pragma omp parallel for private(ret_in, nsize_group, j, phase3)
+        int m1[3], m2[3];
+        int phase3_int[3];
+        phase_storage_in->get_mesh_index(xk1, m1);
+        phase_storage_in->get_mesh_index(xk2, m2);
+
+#pragma omp parallel for private(ret_in, j, js, je, phase3_int)
         for (i = 0; i < ngroup_v3; ++i) {
 
             ret_in = std::complex<double>(0.0, 0.0);
-            nsize_group = fcs_group_v3[i].size();
+            js = relvec_v3.offset[i];
+            je = relvec_v3.offset[i + 1];
 
-            for (j = 0; j < nsize_group; ++j) {
+            for (j = js; j < je; ++j) {
                 for (auto ii = 0; ii < 3; ++ii) {
-                    phase3[ii]
-                            = relvec_v3[i][j].vecs[0][ii] * xk1[ii]
-                              + relvec_v3[i][j].vecs[1][ii] * xk2[ii];
+                    phase3_int[ii] = nv1[ii][j] * m1[ii] + nv2[ii][j] * m2[ii];
                 }
-                ret_in += fcs_group_v3[i][j] * phase_storage_in->get_exp_type2(phase3);
+                ret_in += fcs_group_v3[i][j - js] * phase_storage_in->get_exp_type3_int(phase3_int);
             }
             ret[i] = ret_in;
         }
     } else {
         // Original version
-#pragma omp parallel for private(ret_in, nsize_group, phase, j)
+        count_event(EVENT_PHASE_FALLBACK);
+#pragma omp parallel for private(ret_in, j, js, je, phase)
         for (i = 0; i < ngroup_v3; ++i) {
 
             ret_in = std::complex<double>(0.0, 0.0);
-            nsize_group = fcs_group_v3[i].size();
+            js = relvec_v3.offset[i];
+            je = relvec_v3.offset[i + 1];
 
-            for (j = 0; j < nsize_group; ++j) {
+            for (j = js; j < je; ++j) {
                 phase
-                        = relvec_v3[i][j].vecs[0][0] * xk1[0]
-                          + relvec_v3[i][j].vecs[0][1] * xk1[1]
-                          + relvec_v3[i][j].vecs[0][2] * xk1[2]
-                          + relvec_v3[i][j].vecs[1][0] * xk2[0]
-                          + relvec_v3[i][j].vecs[1][1] * xk2[1]
-                          + relvec_v3[i][j].vecs[1][2] * xk2[2];
-                ret_in += fcs_group_v3[i][j] * std::exp(im * phase);
+                        = rv1[0][j] * xk1[0]
+                          + rv1[1][j] * xk1[1]
+                          + rv1[2][j] * xk1[2]
+                          + rv2[0][j] * xk2[0]
+                          + rv2[1][j] * xk2[1]
+                          + rv2[2][j] * xk2[2];
+                ret_in += fcs_group_v3[i][j - js] * std::exp(im * phase);
             }
             ret[i] = ret_in;
         }
@@ -503,6 +846,8 @@ std::complex<double> AnharmonicCore::V4(const unsigned int ks[4],
     auto ret_im = 0.0;
     auto ret = std::complex<double>(0.0, 0.0);
 
+    count_event(EVENT_V4);
+
     for (i = 0; i < 4; ++i) {
         kn[i] = ks[i] / ns;
         sn[i] = ks[i] % ns;
@@ -526,14 +871,19 @@ std::complex<double> AnharmonicCore::V4(const unsigned int ks[4],
         kindex_phi4_stored[2] = kn[3];
     }
 
+    const std::complex<double> *evec1 = evec_in[kn[0]][sn[0]];
+    const std::complex<double> *evec2 = evec_in[kn[1]][sn[1]];
+    const std::complex<double> *evec3 = evec_in[kn[2]][sn[2]];
+    const std::complex<double> *evec4 = evec_in[kn[3]][sn[3]];
+
 #ifdef _OPENMP
 #pragma omp parallel for private(ret), reduction(+: ret_re, ret_im)
 #endif
     for (i = 0; i < ngroup_v4; ++i) {
-        ret = evec_in[kn[0]][sn[0]][evec_index_v4[i][0]]
-              * evec_in[kn[1]][sn[1]][evec_index_v4[i][1]]
-              * evec_in[kn[2]][sn[2]][evec_index_v4[i][2]]
-              * evec_in[kn[3]][sn[3]][evec_index_v4[i][3]]
+        ret = evec1[evec_index_v4[i][0]]
+              * evec2[evec_index_v4[i][1]]
+              * evec3[evec_index_v4[i][2]]
+              * evec4[evec_index_v4[i][3]]
               * invmass_v4[i] * phi4_reciprocal[i];
         ret_re += ret.real();
         ret_im += ret.imag();
@@ -557,6 +907,8 @@ std::complex<double> AnharmonicCore::Phi4(const unsigned int ks[4],
     double ret_im = 0.0;
     std::complex<double> ret = std::complex<double>(0.0, 0.0);
 
+    count_event(EVENT_V4);
+
     for (i = 0; i < 4; ++i) {
         kn[i] = ks[i] / ns;
         sn[i] = ks[i] % ns;
@@ -578,14 +930,19 @@ std::complex<double> AnharmonicCore::Phi4(const unsigned int ks[4],
         kindex_phi4_stored[2] = kn[3];
     }
 
+    const std::complex<double> *evec1 = evec_in[kn[0]][sn[0]];
+    const std::complex<double> *evec2 = evec_in[kn[1]][sn[1]];
+    const std::complex<double> *evec3 = evec_in[kn[2]][sn[2]];
+    const std::complex<double> *evec4 = evec_in[kn[3]][sn[3]];
+
 #ifdef _OPENMP
 #pragma omp parallel for private(ret), reduction(+: ret_re, ret_im)
 #endif
     for (i = 0; i < ngroup_v4; ++i) {
-        ret = evec_in[kn[0]][sn[0]][evec_index_v4[i][0]]
-              * evec_in[kn[1]][sn[1]][evec_index_v4[i][1]]
-              * evec_in[kn[2]][sn[2]][evec_index_v4[i][2]]
-              * evec_in[kn[3]][sn[3]][evec_index_v4[i][3]]
+        ret = evec1[evec_index_v4[i][0]]
+              * evec2[evec_index_v4[i][1]]
+              * evec3[evec_index_v4[i][2]]
+              * evec4[evec_index_v4[i][3]]
               * invmass_v4[i] * phi4_reciprocal[i];
         ret_re += ret.real();
         ret_im += ret.imag();
@@ -600,33 +957,52 @@ void AnharmonicCore::calc_phi4_reciprocal(const double *xk1,
                                           const PhaseFactorStorage *phase_storage_in,
                                           std::complex<double> *ret)
 {
-    int i, j;
+    int i;
+    size_t j, js, je;
     double phase;
     std::complex<double> ret_in;
-    unsigned int nsize_group;
 
     const auto tune_type_now = phase_storage_in->get_tune_type();
 
+    const double *rv1[3], *rv2[3], *rv3[3];
+    const int *nv1[3], *nv2[3], *nv3[3];
+
+    for (i = 0; i < 3; ++i) {
+        rv1[i] = relvec_v4.comp[0][i].data();
+        rv2[i] = relvec_v4.comp[1][i].data();
+        rv3[i] = relvec_v4.comp[2][i].data();
+        nv1[i] = relvec_v4.lattice[0][i].data();
+        nv2[i] = relvec_v4.lattice[1][i].data();
+        nv3[i] = relvec_v4.lattice[2][i].data();
+    }
+
     if (tune_type_now == 1) {
 
-#pragma omp parallel for private(ret_in, nsize_group, j, phase)
+        int m1[3], m2[3], m3[3];
+        long phase_int;
+        phase_storage_in->get_mesh_index(xk1, m1);
+        phase_storage_in->get_mesh_index(xk2, m2);
+        phase_storage_in->get_mesh_index(xk3, m3);
+
+#pragma omp parallel for private(ret_in, j, js, je, phase_int)
         for (i = 0; i < ngroup_v4; ++i) {
 
             ret_in = std::complex<double>(0.0, 0.0);
-            nsize_group = fcs_group_v4[i].size();
-
-            for (j = 0; j < nsize_group; ++j) {
-                phase = relvec_v4[i][j].vecs[0][0] * xk1[0]
-                        + relvec_v4[i][j].vecs[0][1] * xk1[1]
-                        + relvec_v4[i][j].vecs[0][2] * xk1[2]
-                        + relvec_v4[i][j].vecs[1][0] * xk2[0]
-                        + relvec_v4[i][j].vecs[1][1] * xk2[1]
-                        + relvec_v4[i][j].vecs[1][2] * xk2[2]
-                        + relvec_v4[i][j].vecs[2][0] * xk3[0]
-                        + relvec_v4[i][j].vecs[2][1] * xk3[1]
-                        + relvec_v4[i][j].vecs[2][2] * xk3[2];
-
-                ret_in += fcs_group_v4[i][j] * phase_storage_in->get_exp_type1(phase);
+            js = relvec_v4.offset[i];
+            je = relvec_v4.offset[i + 1];
+
+            for (j = js; j < je; ++j) {
+                phase_int = static_cast<long>(nv1[0][j]) * m1[0]
+                            + static_cast<long>(nv1[1][j]) * m1[1]
+                            + static_cast<long>(nv1[2][j]) * m1[2]
+                            + static_cast<long>(nv2[0][j]) * m2[0]
+                            + static_cast<long>(nv2[1][j]) * m2[1]
+                            + static_cast<long>(nv2[2][j]) * m2[2]
+                            + static_cast<long>(nv3[0][j]) * m3[0]
+                            + static_cast<long>(nv3[1][j]) * m3[1]
+                            + static_cast<long>(nv3[2][j]) * m3[2];
+
+                ret_in += fcs_group_v4[i][j - js] * phase_storage_in->get_exp_type1_int(phase_int);
             }
             ret[i] = ret_in;
         }
@@ -635,45 +1011,78 @@ void AnharmonicCore::calc_phi4_reciprocal(const double *xk1,
 
         // Tuned version is used when nk1=nk2=nk3 doesn't hold.
 
-        double phase3[3];
+        int m1[3], m2[3], m3[3];
+        int phase3_int[3];
+        phase_storage_in->get_mesh_index(xk1, m1);
+        phase_storage_in->get_mesh_index(xk2, m2);
+        phase_storage_in->get_mesh_index(xk3, m3);
+
+#pragma omp parallel for private(ret_in, j, js, je, phase3_int)
+        for (i = 0; i < ngroup_v4; ++i) {
+
+            ret_in = std::complex<double>(0.0, 0.0);
+            js = relvec_v4.offset[i];
+            je = relvec_v4.offset[i + 1];
+
+            for (j = js; j < je; ++j) {
+                for (auto ii = 0; ii < 3; ++ii) {
+                    phase3_int[ii] = nv1[ii][j] * m1[ii]
+                                     + nv2[ii][j] * m2[ii]
+                                     + nv3[ii][j] * m3[ii];
+                }
+                ret_in += fcs_group_v4[i][j - js] * phase_storage_in->get_exp_type2_int(phase3_int);
+            }
+            ret[i] = ret_in;
+        }
+    } else if (tune_type_now == 3) {
 
-#pragma omp parallel for private(ret_in, nsize_group, j, phase3)
+        // Factorized tables for meshes whose dense 3D table is too large.
+
+        int m1[3], m2[3], m3[3];
+        int phase3_int[3];
+        phase_storage_in->get_mesh_index(xk1, m1);
+        phase_storage_in->get_mesh_index(xk2, m2);
+        phase_storage_in->get_mesh_index(xk3, m3);
+
+#pragma omp parallel for private(ret_in, j, js, je, phase3_int)
         for (i = 0; i < ngroup_v4; ++i) {
 
             ret_in = std::complex<double>(0.0, 0.0);
-            nsize_group = fcs_group_v4[i].size();
+            js = relvec_v4.offset[i];
+            je = relvec_v4.offset[i + 1];
 
-            for (j = 0; j < nsize_group; ++j) {
+            for (j = js; j < je; ++j) {
                 for (auto ii = 0; ii < 3; ++ii) {
-                    phase3[ii]
-                            = relvec_v4[i][j].vecs[0][ii] * xk1[ii]
-                              + relvec_v4[i][j].vecs[1][ii] * xk2[ii]
-                              + relvec_v4[i][j].vecs[2][ii] * xk3[ii];
+                    phase3_int[ii] = nv1[ii][j] * m1[ii]
+                                     + nv2[ii][j] * m2[ii]
+                                     + nv3[ii][j] * m3[ii];
                 }
-                ret_in += fcs_group_v4[i][j] * phase_storage_in->get_exp_type2(phase3);
+                ret_in += fcs_group_v4[i][j - js] * phase_storage_in->get_exp_type3_int(phase3_int);
             }
             ret[i] = ret_in;
         }
     } else {
         // Original version
-#pragma omp parallel for private(ret_in, nsize_group, phase)
+        count_event(EVENT_PHASE_FALLBACK);
+#pragma omp parallel for private(ret_in, j, js, je, phase)
         for (i = 0; i < ngroup_v4; ++i) {
 
             ret_in = std::complex<double>(0.0, 0.0);
-            nsize_group = fcs_group_v4[i].size();
-
-            for (j = 0; j < nsize_group; ++j) {
-                phase = relvec_v4[i][j].vecs[0][0] * xk1[0]
-                        + relvec_v4[i][j].vecs[0][1] * xk1[1]
-                        + relvec_v4[i][j].vecs[0][2] * xk1[2]
-                        + relvec_v4[i][j].vecs[1][0] * xk2[0]
-                        + relvec_v4[i][j].vecs[1][1] * xk2[1]
-                        + relvec_v4[i][j].vecs[1][2] * xk2[2]
-                        + relvec_v4[i][j].vecs[2][0] * xk3[0]
-                        + relvec_v4[i][j].vecs[2][1] * xk3[1]
-                        + relvec_v4[i][j].vecs[2][2] * xk3[2];
-
-                ret_in += fcs_group_v4[i][j] * std::exp(im * phase);
+            js = relvec_v4.offset[i];
+            je = relvec_v4.offset[i + 1];
+
+            for (j = js; j < je; ++j) {
+                phase = rv1[0][j] * xk1[0]
+                        + rv1[1][j] * xk1[1]
+                        + rv1[2][j] * xk1[2]
+                        + rv2[0][j] * xk2[0]
+                        + rv2[1][j] * xk2[1]
+                        + rv2[2][j] * xk2[2]
+                        + rv3[0][j] * xk3[0]
+                        + rv3[1][j] * xk3[1]
+                        + rv3[2][j] * xk3[2];
+
+                ret_in += fcs_group_v4[i][j - js] * std::exp(im * phase);
             }
             ret[i] = ret_in;
         }
@@ -690,6 +1099,8 @@ std::complex<double> AnharmonicCore::V3_mode(int mode,
 {
     std::complex<double> ctmp = std::complex<double>(0.0, 0.0);
 
+    count_event(EVENT_V3);
+
     // Return zero if any of the involving phonon has imaginary frequency
     if (eval[0][mode] < eps8 || eval[1][is] < eps8 || eval[2][js] < eps8) return 0.0;
 
@@ -704,18 +1115,19 @@ std::complex<double> AnharmonicCore::V3_mode(int mode,
 
         auto ret_in = std::complex<double>(0.0, 0.0);
 
-        const int nsize_group = fcs_group_v3[i].size();
+        const auto js = relvec_v3.offset[i];
+        const auto je = relvec_v3.offset[i + 1];
 
-        for (auto j = 0; j < nsize_group; ++j) {
+        for (auto j = js; j < je; ++j) {
 
-            auto phase = relvec_v3[i][j].vecs[0][0] * xk2[0]
-                         + relvec_v3[i][j].vecs[0][1] * xk2[1]
-                         + relvec_v3[i][j].vecs[0][2] * xk2[2]
-                         + relvec_v3[i][j].vecs[1][0] * xk3[0]
-                         + relvec_v3[i][j].vecs[1][1] * xk3[1]
-                         + relvec_v3[i][j].vecs[1][2] * xk3[2];
+            auto phase = relvec_v3.comp[0][0][j] * xk2[0]
+                         + relvec_v3.comp[0][1][j] * xk2[1]
+                         + relvec_v3.comp[0][2][j] * xk2[2]
+                         + relvec_v3.comp[1][0][j] * xk3[0]
+                         + relvec_v3.comp[1][1][j] * xk3[1]
+                         + relvec_v3.comp[1][2][j] * xk3[2];
 
-            ret_in += fcs_group_v3[i][j] * std::exp(im * phase);
+            ret_in += fcs_group_v3[i][j - js] * std::exp(im * phase);
 
             ++ielem;
         }
@@ -725,6 +1137,50 @@ std::complex<double> AnharmonicCore::V3_mode(int mode,
     return ctmp / std::sqrt(eval[0][mode] * eval[1][is] * eval[2][js]);
 }
 
+void AnharmonicCore::prepare_adaptive_velocity(const KpointMeshUniform *kmesh_in)
+{
+    // Tabulate the group velocities of all modes of the given mesh, which
+    // set the broadening widths when ISMEAR = 2. The velocities are kept in
+    // atomic units so that the widths are directly comparable with the
+    // phonon frequencies.
+
+    if (phvel_adaptive && phvel_adaptive_mesh == kmesh_in) return;
+
+    if (phvel_adaptive) deallocate(phvel_adaptive);
+    allocate(phvel_adaptive, kmesh_in->nk, dynamical->neval, 3);
+
+    phonon_velocity->get_phonon_group_velocity_mesh(*kmesh_in,
+                                                    system->lavec_p,
+                                                    fcs_phonon->fc2_ext,
+                                                    false,
+                                                    phvel_adaptive);
+    phvel_adaptive_mesh = kmesh_in;
+}
+
+double AnharmonicCore::adaptive_sigma(const double *vel1,
+                                      const double *vel2,
+                                      const double sign,
+                                      const unsigned int nk_grid[3]) const
+{
+    // Broadening width estimated from the spread of the delta-function
+    // argument over one cell of the k mesh, following the prescription of
+    // J. Carrete et al., Comput. Phys. Commun. 185, 1747 (2014).
+
+    auto sum = 0.0;
+
+    for (auto j = 0; j < 3; ++j) {
+        auto dvb = 0.0;
+        for (auto i = 0; i < 3; ++i) {
+            dvb += (vel1[i] + sign * vel2[i]) * system->rlavec_p[j][i];
+        }
+        dvb /= static_cast<double>(nk_grid[j]);
+        sum += dvb * dvb;
+    }
+
+    // The floor avoids a vanishing width when the two velocities cancel.
+    return std::max(std::sqrt(sum / 6.0), eps8);
+}
+
 void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
                                            const double *temp_in,
                                            const double omega_in,
@@ -733,13 +1189,18 @@ void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
                                            const KpointMeshUniform *kmesh_in,
                                            const double *const *eval_in,
                                            const std::complex<double> *const *const *evec_in,
-                                           double *ret)
+                                           double *ret,
+                                           const PhaseFactorStorage *phase_storage_in)
 {
-    // This function returns the imaginary part of phonon self-energy 
+    // This function returns the imaginary part of phonon self-energy
     // for the given frequency omega_in.
     // Lorentzian or Gaussian smearing will be used.
     // This version employs the crystal symmetry to reduce the computational cost
 
+    const auto phase_storage = phase_storage_in ? phase_storage_in : phase_storage_dos;
+
+    if (integration->ismear == 2) prepare_adaptive_velocity(kmesh_in);
+
     const auto nk = kmesh_in->nk;
     const auto ns = dynamical->neval;
     const auto ns2 = ns * ns;
@@ -750,8 +1211,6 @@ void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
 
     int k1, k2;
 
-    double T_tmp;
-    double n1, n2;
     double omega_inner[2];
 
     double multi;
@@ -760,24 +1219,19 @@ void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
 
     double **v3_arr;
     double ***delta_arr;
-    double ret_tmp;
-
-    double f1, f2;
 
     const auto epsilon = integration->epsilon;
 
-    std::vector<KsListGroup> triplet;
-
-    kmesh_in->get_unique_triplet_k(ik_in,
-                                   symmetry->SymmList,
-                                   false,
-                                   false,
-                                   triplet);
+    const auto &triplet = kmesh_in->get_unique_triplet_k_cached(ik_in,
+                                                                symmetry->SymmList,
+                                                                false,
+                                                                false);
 
     const auto npair_uniq = triplet.size();
 
-    allocate(v3_arr, npair_uniq, ns * ns);
-    allocate(delta_arr, npair_uniq, ns * ns, 2);
+    ensure_damping_workspace(npair_uniq, ns2, 0);
+    v3_arr = damp_v3_ws;
+    delta_arr = damp_delta_ws;
 
     const auto knum = kmesh_in->kpoint_irred_all[ik_in][0].knum;
     const auto knum_minus = kmesh_in->kindex_minus_xk[knum];
@@ -814,11 +1268,42 @@ void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
                     delta_arr[ik][ns * is + js][1]
                             = delta_gauss(omega_in - omega_inner[0] + omega_inner[1], epsilon)
                               - delta_gauss(omega_in + omega_inner[0] - omega_inner[1], epsilon);
+                } else if (integration->ismear == 2) {
+                    // Adaptive Gaussian smearing: the width is set by the
+                    // variation of the delta-function argument over one mesh
+                    // cell. The arguments of delta_arr[][][0] vary with
+                    // v(k1) - v(k2) and those of delta_arr[][][1] with
+                    // v(k1) + v(k2), hence the two widths.
+                    const auto sigma0 = adaptive_sigma(phvel_adaptive[k1][is],
+                                                       phvel_adaptive[k2][js],
+                                                       -1.0,
+                                                       kmesh_in->nk_i);
+                    const auto sigma1 = adaptive_sigma(phvel_adaptive[k1][is],
+                                                       phvel_adaptive[k2][js],
+                                                       1.0,
+                                                       kmesh_in->nk_i);
+                    delta_arr[ik][ns * is + js][0]
+                            = delta_gauss(omega_in - omega_inner[0] - omega_inner[1], sigma0)
+                              - delta_gauss(omega_in + omega_inner[0] + omega_inner[1], sigma0);
+                    delta_arr[ik][ns * is + js][1]
+                            = delta_gauss(omega_in - omega_inner[0] + omega_inner[1], sigma1)
+                              - delta_gauss(omega_in + omega_inner[0] - omega_inner[1], sigma1);
                 }
             }
         }
     }
 
+    unsigned int **ks_batch = damp_ks_ws;
+    std::complex<double> *v3_batch = damp_v3batch_ws;
+    std::vector<int> ib_miss;
+
+    ib_miss.reserve(ns2);
+
+    if (v3norm_cache_evec_tag != static_cast<const void *>(evec_in)) {
+        v3norm_cache.clear();
+        v3norm_cache_evec_tag = static_cast<const void *>(evec_in);
+    }
+
     for (ik = 0; ik < npair_uniq; ++ik) {
 
         k1 = triplet[ik].group[0].ks[0];
@@ -826,6 +1311,11 @@ void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
 
         multi = static_cast<double>(triplet[ik].group.size());
 
+        // Elements already computed for a symmetry-equivalent triplet are
+        // served from the orbit cache; only the misses go through the
+        // batched evaluator.
+        ib_miss.clear();
+
         for (int ib = 0; ib < ns2; ++ib) {
             is = ib / ns;
             js = ib % ns;
@@ -834,59 +1324,173 @@ void AnharmonicCore::calc_damping_smearing(const unsigned int ntemp,
             arr[1] = ns * k1 + is;
             arr[2] = ns * k2 + js;
 
-            v3_arr[ik][ib] = std::norm(V3(arr,
-                                          kmesh_in->xk,
-                                          eval_in,
-                                          evec_in,
-                                          phase_storage_dos)) * multi;
+            const auto it_cache = v3norm_cache.find(canonicalize_triplet(arr));
+
+            if (it_cache != v3norm_cache.end()) {
+                v3_arr[ik][ib] = it_cache->second * multi;
+            } else {
+                const auto nmiss = ib_miss.size();
+                ks_batch[nmiss][0] = arr[0];
+                ks_batch[nmiss][1] = arr[1];
+                ks_batch[nmiss][2] = arr[2];
+                ib_miss.push_back(ib);
+            }
+        }
+
+        if (!ib_miss.empty()) {
+            V3_batch(ib_miss.size(),
+                     ks_batch,
+                     kmesh_in->xk,
+                     eval_in,
+                     evec_in,
+                     phase_storage,
+                     v3_batch);
+
+            for (unsigned int imiss = 0; imiss < ib_miss.size(); ++imiss) {
+                const auto v3norm = std::norm(v3_batch[imiss]);
+                v3_arr[ik][ib_miss[imiss]] = v3norm * multi;
+                if (v3norm_cache.size() < v3norm_cache_maxsize) {
+                    v3norm_cache.emplace(canonicalize_triplet(ks_batch[imiss]),
+                                         v3norm);
+                }
+            }
         }
     }
 
-    for (i = 0; i < ntemp; ++i) {
-        T_tmp = temp_in[i];
-        ret_tmp = 0.0;
+    // Accumulate with the temperature axis contiguous and innermost.
+    // The occupation factors depend only on (k, s, T), so they are
+    // tabulated once per triplet (2 ns ntemp evaluations) instead of being
+    // recomputed for every band pair, and the remaining per-pair work is a
+    // SIMD-friendly multiply-add over the temperature grid.
+
+    const auto nq_shift = thermodynamics->classical ? 0.0 : 1.0;
+
 #ifdef _OPENMP
-#pragma omp parallel for private(k1, k2, is, js, omega_inner, n1, n2, f1, f2), reduction(+:ret_tmp)
+#pragma omp parallel private(ik, is, js, k1, k2, i)
+#endif
+    {
+        double **ftab1, **ftab2;
+        const double **f1row, **f2row;
+        double *ret_loc;
+        float **ftab1_mp = nullptr;
+        float **ftab2_mp = nullptr;
+
+        allocate(ftab1, ns, ntemp);
+        allocate(ftab2, ns, ntemp);
+        allocate(f1row, ns);
+        allocate(f2row, ns);
+        allocate(ret_loc, ntemp);
+        if (mixed_precision) {
+            allocate(ftab1_mp, ns, ntemp);
+            allocate(ftab2_mp, ns, ntemp);
+        }
+
+        for (i = 0; i < ntemp; ++i) ret_loc[i] = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for
 #endif
         for (ik = 0; ik < npair_uniq; ++ik) {
 
             k1 = triplet[ik].group[0].ks[0];
             k2 = triplet[ik].group[0].ks[1];
 
+            // Serve the occupation factors from the process-wide table when
+            // it covers the requested grid; tabulate locally otherwise.
             for (is = 0; is < ns; ++is) {
+                f1row[is] = thermodynamics->occupation_row(k1, is, ntemp, temp_in, eval_in);
+                if (!f1row[is]) {
+                    if (thermodynamics->classical) {
+                        thermodynamics->fC_grid(eval_in[k1][is], ntemp, temp_in, ftab1[is]);
+                    } else {
+                        thermodynamics->fB_grid(eval_in[k1][is], ntemp, temp_in, ftab1[is]);
+                    }
+                    f1row[is] = ftab1[is];
+                }
+                f2row[is] = thermodynamics->occupation_row(k2, is, ntemp, temp_in, eval_in);
+                if (!f2row[is]) {
+                    if (thermodynamics->classical) {
+                        thermodynamics->fC_grid(eval_in[k2][is], ntemp, temp_in, ftab2[is]);
+                    } else {
+                        thermodynamics->fB_grid(eval_in[k2][is], ntemp, temp_in, ftab2[is]);
+                    }
+                    f2row[is] = ftab2[is];
+                }
+            }
 
-                omega_inner[0] = eval_in[k1][is];
+            if (mixed_precision) {
 
-                for (js = 0; js < ns; ++js) {
+                // Single-precision copies of the occupation rows, converted
+                // once per triplet and reused for the ns^2 band pairs. The
+                // occupation-delta combination is evaluated in float and
+                // only the |V3|^2-weighted result enters the double sum.
+                const auto nq_shift_mp = static_cast<float>(nq_shift);
 
-                    omega_inner[1] = eval_in[k2][js];
+                for (is = 0; is < ns; ++is) {
+                    for (i = 0; i < ntemp; ++i) {
+                        ftab1_mp[is][i] = static_cast<float>(f1row[is][i]);
+                        ftab2_mp[is][i] = static_cast<float>(f2row[is][i]);
+                    }
+                }
 
-                    if (thermodynamics->classical) {
-                        f1 = thermodynamics->fC(omega_inner[0], T_tmp);
-                        f2 = thermodynamics->fC(omega_inner[1], T_tmp);
+                for (is = 0; is < ns; ++is) {
+                    for (js = 0; js < ns; ++js) {
 
-                        n1 = f1 + f2;
-                        n2 = f1 - f2;
-                    } else {
-                        f1 = thermodynamics->fB(omega_inner[0], T_tmp);
-                        f2 = thermodynamics->fB(omega_inner[1], T_tmp);
+                        const auto v3_tmp = v3_arr[ik][ns * is + js];
+                        const auto d0 = static_cast<float>(delta_arr[ik][ns * is + js][0]);
+                        const auto d1 = static_cast<float>(delta_arr[ik][ns * is + js][1]);
+                        const float *f1_tmp = ftab1_mp[is];
+                        const float *f2_tmp = ftab2_mp[js];
 
-                        n1 = f1 + f2 + 1.0;
-                        n2 = f1 - f2;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                        for (i = 0; i < ntemp; ++i) {
+                            const float wtmp = (f1_tmp[i] + f2_tmp[i] + nq_shift_mp) * d0
+                                               - (f1_tmp[i] - f2_tmp[i]) * d1;
+                            ret_loc[i] += v3_tmp * static_cast<double>(wtmp);
+                        }
                     }
+                }
 
-                    ret_tmp += v3_arr[ik][ns * is + js]
-                               * (n1 * delta_arr[ik][ns * is + js][0]
-                                  - n2 * delta_arr[ik][ns * is + js][1]);
+            } else {
+
+                for (is = 0; is < ns; ++is) {
+                    for (js = 0; js < ns; ++js) {
+
+                        const auto v3_tmp = v3_arr[ik][ns * is + js];
+                        const auto d0 = delta_arr[ik][ns * is + js][0];
+                        const auto d1 = delta_arr[ik][ns * is + js][1];
+                        const double *f1_tmp = f1row[is];
+                        const double *f2_tmp = f2row[js];
+
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                        for (i = 0; i < ntemp; ++i) {
+                            ret_loc[i] += v3_tmp * ((f1_tmp[i] + f2_tmp[i] + nq_shift) * d0
+                                                    - (f1_tmp[i] - f2_tmp[i]) * d1);
+                        }
+                    }
                 }
             }
         }
-        ret[i] = ret_tmp;
-    }
 
-    deallocate(v3_arr);
-    deallocate(delta_arr);
-    triplet.clear();
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        {
+            for (i = 0; i < ntemp; ++i) ret[i] += ret_loc[i];
+        }
+
+        deallocate(ftab1);
+        deallocate(ftab2);
+        deallocate(f1row);
+        deallocate(f2row);
+        deallocate(ret_loc);
+        if (ftab1_mp) deallocate(ftab1_mp);
+        if (ftab2_mp) deallocate(ftab2_mp);
+    }
 
     for (i = 0; i < ntemp; ++i) ret[i] *= pi * std::pow(0.5, 4) / static_cast<double>(nk);
 }
@@ -934,35 +1538,31 @@ void AnharmonicCore::calc_damping_tetrahedron(const unsigned int ntemp,
     double **v3_arr;
     double ***delta_arr;
 
-    std::vector<KsListGroup> triplet;
-
     for (i = 0; i < ntemp; ++i) ret[i] = 0.0;
 
-    kmesh_in->get_unique_triplet_k(ik_in,
-                                   symmetry->SymmList,
-                                   use_triplet_symmetry,
-                                   sym_permutation,
-                                   triplet);
+    const auto &triplet = kmesh_in->get_unique_triplet_k_cached(ik_in,
+                                                                symmetry->SymmList,
+                                                                use_triplet_symmetry,
+                                                                sym_permutation);
 
     const auto npair_uniq = triplet.size();
 
-    allocate(v3_arr, npair_uniq, ns2);
-    allocate(delta_arr, npair_uniq, ns2, 2);
+    ensure_damping_workspace(npair_uniq, ns2, nk);
+    v3_arr = damp_v3_ws;
+    delta_arr = damp_delta_ws;
 
     const auto knum = kmesh_in->kpoint_irred_all[ik_in][0].knum;
     const auto knum_minus = kmesh_in->kindex_minus_xk[knum];
     const auto xk = kmesh_in->xk;
 
-    allocate(kmap_identity, nk);
-
-    for (i = 0; i < nk; ++i) kmap_identity[i] = i;
+    kmap_identity = damp_kmap_ws;
 
 #ifdef _OPENMP
 #pragma omp parallel private(is, js, k1, k2, xk_tmp, energy_tmp, i, weight_tetra, ik, jk, arr)
 #endif
     {
-        allocate(energy_tmp, 3, nk);
-        allocate(weight_tetra, 3, nk);
+        scratch_allocate(energy_tmp, 3, nk);
+        scratch_allocate(weight_tetra, 3, nk);
 
 #ifdef _OPENMP
 #pragma omp for
@@ -999,8 +1599,7 @@ void AnharmonicCore::calc_damping_tetrahedron(const unsigned int ntemp,
             }
         }
 
-        deallocate(energy_tmp);
-        deallocate(weight_tetra);
+        scratch_reset();
     }
 
     for (ik = 0; ik < npair_uniq; ++ik) {
@@ -1020,11 +1619,10 @@ void AnharmonicCore::calc_damping_tetrahedron(const unsigned int ntemp,
                 arr[1] = ns * k1 + is;
                 arr[2] = ns * k2 + js;
 
-                v3_arr[ik][ib] = std::norm(V3(arr,
-                                              kmesh_in->xk,
-                                              eval_in,
-                                              evec_in,
-                                              phase_storage_dos)) * multi;
+                v3_arr[ik][ib] = V3_norm_cached(arr,
+                                                kmesh_in,
+                                                eval_in,
+                                                evec_in) * multi;
 
             } else {
                 v3_arr[ik][ib] = 0.0;
@@ -1074,10 +1672,6 @@ void AnharmonicCore::calc_damping_tetrahedron(const unsigned int ntemp,
         ret[i] = ret_tmp;
     }
 
-    deallocate(v3_arr);
-    deallocate(delta_arr);
-    deallocate(kmap_identity);
-
     for (i = 0; i < ntemp; ++i) ret[i] *= pi * std::pow(0.5, 4);
 }
 
@@ -1095,7 +1689,6 @@ void AnharmonicCore::setup_cubic()
 
     allocate(invmass_v3, ngroup_v3);
     allocate(evec_index_v3, ngroup_v3, 3);
-    allocate(relvec_v3, ngroup_v3);
     allocate(phi3_reciprocal, ngroup_v3);
 
     prepare_relative_vector(fcs_phonon->force_constant_with_cell[1],
@@ -1136,7 +1729,6 @@ void AnharmonicCore::setup_quartic()
 
     allocate(invmass_v4, ngroup_v4);
     allocate(evec_index_v4, ngroup_v4, 4);
-    allocate(relvec_v4, ngroup_v4);
     allocate(phi4_reciprocal, ngroup_v4);
 
     prepare_relative_vector(fcs_phonon->force_constant_with_cell[2],
@@ -1201,6 +1793,20 @@ void PhaseFactorStorage::create(const bool use_tuned_ver,
         // Force using tune_type == 2 version
         if (switch_to_type2) tune_type = 2;
 
+        // The dense 3D table of the type2 version grows with the product of
+        // the three mesh dimensions. When it would become prohibitively
+        // large, fall back to the factorized per-direction tables (type3),
+        // which cover arbitrary commensurate meshes with O(nk) storage.
+        const long max_entries_type2 = 1L << 24;
+
+        if (tune_type == 2) {
+            const auto nentries
+                    = static_cast<long>(2 * nk_grid[0] - 1)
+                      * static_cast<long>(2 * nk_grid[1] - 1)
+                      * static_cast<long>(2 * nk_grid[2] - 1);
+            if (nentries > max_entries_type2) tune_type = 3;
+        }
+
         int ii, jj, kk;
 
         if (tune_type == 1) {
@@ -1246,6 +1852,19 @@ void PhaseFactorStorage::create(const bool use_tuned_ver,
                     }
                 }
             }
+
+        } else if (tune_type == 3) {
+
+            double phase;
+
+            for (auto i = 0; i < 3; ++i) {
+                const auto inv_dnk_i = 1.0 / dnk[i];
+                allocate(exp_phase1d[i], 2 * nk_grid[i] - 1);
+                for (ii = 0; ii < 2 * nk_grid[i] - 1; ++ii) {
+                    phase = static_cast<double>(ii - nk_grid[i] + 1) * inv_dnk_i;
+                    exp_phase1d[i][ii] = std::exp(im * phase);
+                }
+            }
         }
     } else {
         tune_type = 0;
@@ -1272,7 +1891,40 @@ std::complex<double> PhaseFactorStorage::get_exp_type2(const double *phase3_in)
     return exp_phase3[loc[0]][loc[1]][loc[2]];
 }
 
-void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
+std::complex<double> PhaseFactorStorage::get_exp_type1_int(const long phase_in) const
+{
+    const int iloc = static_cast<int>(phase_in % nk_represent) + nk_represent - 1;
+    return exp_phase[iloc];
+}
+
+std::complex<double> PhaseFactorStorage::get_exp_type2_int(const int *phase3_in) const
+{
+    int loc[3];
+    for (auto i = 0; i < 3; ++i) {
+        loc[i] = phase3_in[i] % nk_grid[i] + nk_grid[i] - 1;
+    }
+    return exp_phase3[loc[0]][loc[1]][loc[2]];
+}
+
+std::complex<double> PhaseFactorStorage::get_exp_type3_int(const int *phase3_in) const
+{
+    int loc[3];
+    for (auto i = 0; i < 3; ++i) {
+        loc[i] = phase3_in[i] % nk_grid[i] + nk_grid[i] - 1;
+    }
+    return exp_phase1d[0][loc[0]] * exp_phase1d[1][loc[1]] * exp_phase1d[2][loc[2]];
+}
+
+void PhaseFactorStorage::get_mesh_index(const double *xk_in,
+                                        int *index_out) const
+{
+    for (auto i = 0; i < 3; ++i) {
+        index_out[i] = nint(xk_in[i] * static_cast<double>(nk_grid[i]));
+    }
+}
+
+void AnharmonicCore::calc_self3omega_tetrahedron(const unsigned int ntemp,
+                                                 const double *temp_in,
                                                  const KpointMeshUniform *kmesh_in,
                                                  const double *const *eval_in,
                                                  const std::complex<double> *const *const *evec_in,
@@ -1280,13 +1932,16 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
                                                  const unsigned int snum,
                                                  const unsigned int nomega,
                                                  const double *omega,
-                                                 double *ret)
+                                                 double **ret)
 {
     // This function returns the imaginary part of phonon self-energy 
     // for the given frequency range of omega, phonon frequency (eval) and phonon eigenvectors (evec).
     // The tetrahedron method will be used.
     // This version employs the crystal symmetry to reduce the computational cost
     // In addition, both MPI and OpenMP parallelization are used in a hybrid way inside this function.
+    // All temperatures are evaluated in one pass: the |V3|^2 matrix
+    // elements and the tetrahedron weights do not depend on temperature,
+    // so only the occupation factors are recomputed per point.
 
     const auto nk = kmesh_in->nk;
     const int ns = dynamical->neval;
@@ -1310,18 +1965,17 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
     double **weight_tetra;
     double **v3_arr, *v3_arr_loc;
     double *ret_private;
+    int itemp;
 
-    std::vector<KsListGroup> triplet;
     std::vector<int> vk_l;
 
     const int knum = kmesh_in->kpoint_irred_all[ik_in][0].knum;
     const int knum_minus = kmesh_in->kindex_minus_xk[knum];
 
-    kmesh_in->get_unique_triplet_k(ik_in,
-                                   symmetry->SymmList,
-                                   false,
-                                   false,
-                                   triplet);
+    const auto &triplet = kmesh_in->get_unique_triplet_k_cached(ik_in,
+                                                                symmetry->SymmList,
+                                                                false,
+                                                                false);
 
     const auto npair_uniq = triplet.size();
 
@@ -1334,7 +1988,9 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
 
     for (i = 0; i < nk; ++i) kmap_identity[i] = i;
 
-    for (iomega = 0; iomega < nomega; ++iomega) ret[iomega] = 0.0;
+    for (itemp = 0; itemp < ntemp; ++itemp) {
+        for (iomega = 0; iomega < nomega; ++iomega) ret[itemp][iomega] = 0.0;
+    }
 
     for (ik = 0; ik < npair_uniq; ++ik) {
         kpairs[ik][0] = triplet[ik].group[0].ks[0];
@@ -1400,12 +2056,18 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
 
 #ifdef _OPENMP
 #pragma omp parallel private(is, js, k1, k2, energy_tmp, i, \
-                             iomega, weight_tetra, ik, \
+                             iomega, weight_tetra, ik, itemp, \
                              omega_inner, f1, f2, n1, n2)
 #endif
         {
-            allocate(energy_tmp, 2, nk);
-            allocate(weight_tetra, 2, nk);
+            scratch_allocate(energy_tmp, 2, nk);
+            scratch_allocate(weight_tetra, 2, nk);
+
+            // The corner sort of the tetrahedra depends only on the energy
+            // arrays, so it is done once per band pair and reused for all
+            // nomega reference energies below.
+            TetraSortedEnergies sorted_tetra[2];
+
 #ifdef _OPENMP
             const int nthreads = omp_get_num_threads();
             const int ithread = omp_get_thread_num();
@@ -1418,8 +2080,8 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
 #pragma omp single
 #endif
             {
-                allocate(ret_private, nthreads * nomega);
-                for (i = 0; i < nthreads * nomega; ++i) ret_private[i] = 0.0;
+                allocate(ret_private, nthreads * ntemp * nomega);
+                for (i = 0; i < nthreads * ntemp * nomega; ++i) ret_private[i] = 0.0;
             }
 #ifdef _OPENMP
 #pragma omp for
@@ -1436,13 +2098,18 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
                     energy_tmp[0][ik] = eval_in[k1][is] + eval_in[k2][js];
                     energy_tmp[1][ik] = eval_in[k1][is] - eval_in[k2][js];
                 }
+                for (i = 0; i < 2; ++i) {
+                    integration->prepare_sorted_tetrahedra(kmap_identity,
+                                                           energy_tmp[i],
+                                                           dos->tetra_nodes_dos->get_ntetra(),
+                                                           dos->tetra_nodes_dos->get_tetras(),
+                                                           sorted_tetra[i]);
+                }
                 for (iomega = 0; iomega < nomega; ++iomega) {
                     for (i = 0; i < 2; ++i) {
-                        integration->calc_weight_tetrahedron(nk, kmap_identity,
-                                                             energy_tmp[i], omega[iomega],
-                                                             dos->tetra_nodes_dos->get_ntetra(),
-                                                             dos->tetra_nodes_dos->get_tetras(),
-                                                             weight_tetra[i]);
+                        integration->calc_weight_tetrahedron_sorted(nk, sorted_tetra[i],
+                                                                    omega[iomega],
+                                                                    weight_tetra[i]);
                     }
 
                     for (ik = 0; ik < nk; ++ik) {
@@ -1451,21 +2118,30 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
 
                         omega_inner[0] = eval_in[k1][is];
                         omega_inner[1] = eval_in[k2][js];
-                        if (thermodynamics->classical) {
-                            f1 = thermodynamics->fC(omega_inner[0], Temp);
-                            f2 = thermodynamics->fC(omega_inner[1], Temp);
-                            n1 = f1 + f2;
-                            n2 = f1 - f2;
-                        } else {
-                            f1 = thermodynamics->fB(omega_inner[0], Temp);
-                            f2 = thermodynamics->fB(omega_inner[1], Temp);
-                            n1 = f1 + f2 + 1.0;
-                            n2 = f1 - f2;
-                        }
 
-                        //#pragma omp critical
-                        ret_private[nomega * ithread + iomega]
-                                += v3_arr[ik][ib] * (n1 * weight_tetra[0][ik] - 2.0 * n2 * weight_tetra[1][ik]);
+                        const auto vw0 = v3_arr[ik][ib] * weight_tetra[0][ik];
+                        const auto vw1 = 2.0 * v3_arr[ik][ib] * weight_tetra[1][ik];
+
+                        // Most tetrahedron weights are exactly zero outside
+                        // the energy window; skip the temperature loop there.
+                        if (vw0 == 0.0 && vw1 == 0.0) continue;
+
+                        for (itemp = 0; itemp < ntemp; ++itemp) {
+                            if (thermodynamics->classical) {
+                                f1 = thermodynamics->fC(omega_inner[0], temp_in[itemp]);
+                                f2 = thermodynamics->fC(omega_inner[1], temp_in[itemp]);
+                                n1 = f1 + f2;
+                                n2 = f1 - f2;
+                            } else {
+                                f1 = thermodynamics->fB(omega_inner[0], temp_in[itemp]);
+                                f2 = thermodynamics->fB(omega_inner[1], temp_in[itemp]);
+                                n1 = f1 + f2 + 1.0;
+                                n2 = f1 - f2;
+                            }
+
+                            ret_private[(ntemp * ithread + itemp) * nomega + iomega]
+                                    += n1 * vw0 - n2 * vw1;
+                        }
                     }
                 }
             }
@@ -1474,17 +2150,20 @@ void AnharmonicCore::calc_self3omega_tetrahedron(const double Temp,
 #endif
             for (iomega = 0; iomega < nomega; ++iomega) {
                 for (int t = 0; t < nthreads; t++) {
-                    ret[iomega] += ret_private[nomega * t + iomega];
+                    for (itemp = 0; itemp < ntemp; ++itemp) {
+                        ret[itemp][iomega] += ret_private[(ntemp * t + itemp) * nomega + iomega];
+                    }
                 }
             }
-            deallocate(energy_tmp);
-            deallocate(weight_tetra);
+            scratch_reset();
         }
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for private(iomega)
 #endif
-        for (iomega = 0; iomega < nomega; ++iomega) {
-            ret[iomega] *= pi * std::pow(0.5, 4);
+        for (itemp = 0; itemp < ntemp; ++itemp) {
+            for (iomega = 0; iomega < nomega; ++iomega) {
+                ret[itemp][iomega] *= pi * std::pow(0.5, 4);
+            }
         }
         deallocate(ret_private);
     }
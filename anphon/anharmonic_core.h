@@ -12,38 +12,66 @@ or http://opensource.org/licenses/mit-license.php for information.
 
 #include "pointers.h"
 #include <complex>
+#include <unordered_map>
 #include <vector>
 #include "fcs_phonon.h"
 #include "kpoint.h"
 
 namespace PHON_NS {
 
-class RelativeVector {
+class TripletKey {
 public:
-    double vecs[3][3];
+    unsigned int ks[3];
 
-    RelativeVector();
+    TripletKey() {};
 
-    // Constructor for cubic term
-    RelativeVector(const double vec1[3],
-                   const double vec2[3])
+    TripletKey(const unsigned int ks_in[3])
     {
-        for (int i = 0; i < 3; ++i) {
-            vecs[0][i] = vec1[i];
-            vecs[1][i] = vec2[i];
-            vecs[2][i] = 0.0;
-        }
+        for (int i = 0; i < 3; ++i) ks[i] = ks_in[i];
+    }
+
+    bool operator==(const TripletKey &obj) const
+    {
+        return ks[0] == obj.ks[0] && ks[1] == obj.ks[1] && ks[2] == obj.ks[2];
     }
+};
 
-    // Constructor for quartic term
-    RelativeVector(const double vec1[3],
-                   const double vec2[3],
-                   const double vec3[3])
+struct TripletKeyHash {
+    std::size_t operator()(const TripletKey &key) const
     {
-        for (int i = 0; i < 3; ++i) {
-            vecs[0][i] = vec1[i];
-            vecs[1][i] = vec2[i];
-            vecs[2][i] = vec3[i];
+        std::size_t seed = key.ks[0];
+        seed ^= key.ks[1] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= key.ks[2] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+class RelativeVectorSoA {
+public:
+    // Structure-of-arrays storage of the relative vectors entering the
+    // V3/V4 phase factors. The vectors of all force-constant groups are
+    // packed into contiguous per-component arrays so that the phase
+    // evaluation streams through memory instead of striding over
+    // array-of-structures elements. Group igroup occupies the index range
+    // [offset[igroup], offset[igroup + 1]).
+    //
+    // The relative vectors are primitive lattice translations multiplied
+    // by 2pi; their integer components are stored as well so that the
+    // index of the tabulated complex exponentials can be obtained with
+    // integer arithmetic from the integer mesh coordinates of the k points.
+    std::vector<size_t> offset;
+    std::vector<double> comp[3][3]; // comp[ivec][icrd][ielem]
+    std::vector<int> lattice[3][3]; // comp[ivec][icrd][ielem] / 2pi rounded to integer
+
+    void set_size(const size_t ngroups,
+                  const size_t nelems)
+    {
+        offset.assign(ngroups + 1, 0);
+        for (auto i = 0; i < 3; ++i) {
+            for (auto j = 0; j < 3; ++j) {
+                comp[i][j].assign(nelems, 0.0);
+                lattice[i][j].assign(nelems, 0);
+            }
         }
     }
 };
@@ -60,12 +88,18 @@ public:
 
         if (exp_phase) deallocate(exp_phase);
         if (exp_phase3) deallocate(exp_phase3);
+        for (auto i = 0; i < 3; ++i) {
+            if (exp_phase1d[i]) deallocate(exp_phase1d[i]);
+        }
     };
 
     ~PhaseFactorStorage()
     {
         if (exp_phase) deallocate(exp_phase);
         if (exp_phase3) deallocate(exp_phase3);
+        for (auto i = 0; i < 3; ++i) {
+            if (exp_phase1d[i]) deallocate(exp_phase1d[i]);
+        }
     };
 
     void create(const bool use_tuned_ver,
@@ -77,6 +111,21 @@ public:
 
     std::complex<double> get_exp_type2(const double phase3_in[3]) const;
 
+    // Integer-index variants used with the precomputed lattice components
+    // of the relative vectors. The arguments must equal the nint() of the
+    // phase angles multiplied by dnk_represent (type1) or dnk (type2).
+    std::complex<double> get_exp_type1_int(const long phase_in) const;
+
+    std::complex<double> get_exp_type2_int(const int phase3_in[3]) const;
+
+    // Factorized variant for meshes whose dense 3D table would be too
+    // large: the exponential is assembled from three per-direction tables.
+    std::complex<double> get_exp_type3_int(const int phase3_in[3]) const;
+
+    // Integer mesh coordinates nint(xk * nk_grid) of a k point on the mesh.
+    void get_mesh_index(const double *xk_in,
+                        int *index_out) const;
+
 private:
     int nk_represent, nk_grid[3]; // This type must NOT be changed to unsigned int
     // because these variables are used as a divisor of modulo.
@@ -86,6 +135,7 @@ private:
     double dnk[3];
     std::complex<double> *exp_phase = nullptr;
     std::complex<double> ***exp_phase3 = nullptr;
+    std::complex<double> *exp_phase1d[3] = {nullptr, nullptr, nullptr};
 };
 
 class AnharmonicCore : protected Pointers {
@@ -96,6 +146,8 @@ public:
 
     void setup();
 
+    // When phase_storage_in is null, the storage tuned for the dos mesh is
+    // used; pass a dedicated storage when kmesh_in is a different mesh.
     void calc_damping_smearing(const unsigned int ntemp,
                                const double *temp_in,
                                const double omega_in,
@@ -104,7 +156,8 @@ public:
                                const KpointMeshUniform *kmesh_in,
                                const double *const *eval_in,
                                const std::complex<double> *const *const *evec_in,
-                               double *ret);
+                               double *ret,
+                               const PhaseFactorStorage *phase_storage_in = nullptr);
 
     void calc_damping_tetrahedron(const unsigned int ntemp,
                                   const double *temp_in,
@@ -121,6 +174,12 @@ public:
     bool use_triplet_symmetry;
     bool use_quartet_symmetry;
 
+    // Opt-in mixed-precision accumulation of the linewidth sums: the
+    // occupation and delta factors are combined in single precision and
+    // the per-temperature gamma sums accumulated in double. Halves the
+    // bytes streamed through the dominant loop of calc_damping_smearing.
+    bool mixed_precision;
+
     std::complex<double> V3(const unsigned int [3]);
 
     std::complex<double> V4(const unsigned int [4]);
@@ -140,6 +199,28 @@ public:
                             const std::complex<double> *const *const *evec_in,
                             const PhaseFactorStorage *phase_storage_in);
 
+    double V3_norm_cached(const unsigned int ks[3],
+                          const KpointMeshUniform *kmesh_in,
+                          const double *const *eval_in,
+                          const std::complex<double> *const *const *evec_in);
+
+    void clear_v3norm_cache();
+
+    void V3_batch(const unsigned int ntriplet,
+                  const unsigned int *const *ks_in,
+                  const double *const *xk_in,
+                  const double *const *eval_in,
+                  const std::complex<double> *const *const *evec_in,
+                  const PhaseFactorStorage *phase_storage_in,
+                  std::complex<double> *ret);
+
+    void V3_head_contracted(const unsigned int ks1,
+                            const unsigned int ks2,
+                            const double *const *xk_in,
+                            const std::complex<double> *const *const *evec_in,
+                            const PhaseFactorStorage *phase_storage_in,
+                            std::complex<double> *ret_head);
+
     std::complex<double> V4(const unsigned int ks[4],
                             const double *const *xk_in,
                             const double *const *eval_in,
@@ -170,14 +251,15 @@ public:
                                  unsigned int,
                                  int,
                                  std::vector<double> *,
-                                 std::vector<RelativeVector> *&) const;
+                                 RelativeVectorSoA &) const;
 
     void prepare_group_of_force_constants(const std::vector<FcsArrayWithCell> &,
                                           unsigned int,
                                           int &,
                                           std::vector<double> *&) const;
 
-    void calc_self3omega_tetrahedron(const double Temp,
+    void calc_self3omega_tetrahedron(const unsigned int ntemp,
+                                     const double *temp_in,
                                      const KpointMeshUniform *kmesh_in,
                                      const double *const *eval,
                                      const std::complex<double> *const *const *evec,
@@ -185,7 +267,7 @@ public:
                                      const unsigned int snum,
                                      const unsigned int nomega,
                                      const double *omega,
-                                     double *ret);
+                                     double **ret);
 
     void calc_phi3_reciprocal(const double *xk1,
                               const double *xk2,
@@ -221,15 +303,53 @@ private:
     std::vector<double> *fcs_group_v3;
     std::vector<double> *fcs_group_v4;
     std::complex<double> *phi3_reciprocal, *phi4_reciprocal;
-    std::vector<RelativeVector> *relvec_v3, *relvec_v4;
+    RelativeVectorSoA relvec_v3, relvec_v4;
 
     PhaseFactorStorage *phase_storage_dos;
 
+    // Group velocities on the full mesh, used by the adaptive smearing
+    // (ISMEAR = 2). The table is rebuilt when a different mesh is given.
+    double ***phvel_adaptive;
+    const KpointMeshUniform *phvel_adaptive_mesh = nullptr;
+
+    // Per-mode workspaces of calc_damping_smearing/tetrahedron, grown to
+    // the largest triplet list encountered and reused across the mode
+    // loop, so the steady state of a conductivity run performs no heap
+    // allocations in these routines.
+    double **damp_v3_ws = nullptr;
+    double ***damp_delta_ws = nullptr;
+    unsigned int **damp_ks_ws = nullptr;
+    std::complex<double> *damp_v3batch_ws = nullptr;
+    unsigned int *damp_kmap_ws = nullptr;
+    size_t damp_npair_ws = 0;
+    size_t damp_ns2_ws = 0;
+    size_t damp_nk_ws = 0;
+
+    void ensure_damping_workspace(const size_t npair,
+                                  const size_t ns2,
+                                  const size_t nk_in);
+
+    void prepare_adaptive_velocity(const KpointMeshUniform *kmesh_in);
+
+    double adaptive_sigma(const double *vel1,
+                          const double *vel2,
+                          const double sign,
+                          const unsigned int nk_grid[3]) const;
+
     bool sym_permutation;
 
     int kindex_phi3_stored[2] = {-1, -1};
     int kindex_phi4_stored[3] = {-1, -1, -1};
 
+    // Cache of |V3|^2 over symmetry orbits of (k,s) triplets.
+    // Only the gauge-invariant norm is stored, which is strictly equal among
+    // triplets related by permutation of the three slots.
+    std::unordered_map<TripletKey, double, TripletKeyHash> v3norm_cache;
+    const void *v3norm_cache_evec_tag = nullptr;
+    std::size_t v3norm_cache_maxsize = 1u << 22;
+
+    TripletKey canonicalize_triplet(const unsigned int ks[3]) const;
+
     void setup_cubic();
 
     void setup_quartic();
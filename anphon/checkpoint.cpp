@@ -0,0 +1,46 @@
+/*
+ checkpoint.cpp
+
+ Copyright (c) 2014-2021 Terumasa Tadano
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "mpi_common.h"
+#include "checkpoint.h"
+#include <csignal>
+
+namespace {
+volatile std::sig_atomic_t stop_flag = 0;
+
+void handle_stop_signal(int)
+{
+    stop_flag = 1;
+}
+}
+
+using namespace PHON_NS;
+
+void checkpoint::install_signal_handler()
+{
+    std::signal(SIGTERM, handle_stop_signal);
+    std::signal(SIGINT, handle_stop_signal);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, handle_stop_signal);
+#endif
+}
+
+bool checkpoint::stop_requested()
+{
+    return stop_flag != 0;
+}
+
+bool checkpoint::stop_requested_any(MPI_Comm comm)
+{
+    int flag_local = stop_flag ? 1 : 0;
+    int flag_global = 0;
+    MPI_Allreduce(&flag_local, &flag_global, 1, MPI_INT, MPI_LOR, comm);
+    return flag_global != 0;
+}
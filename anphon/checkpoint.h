@@ -0,0 +1,40 @@
+/*
+ checkpoint.h
+
+ Copyright (c) 2014-2021 Terumasa Tadano
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#pragma once
+
+#ifdef _WIN32
+#include <mpi.h>
+#else
+
+#include "mpi.h"
+
+#endif
+
+namespace PHON_NS {
+namespace checkpoint {
+// Cooperative stop requests for long-running stages. The signal handler
+// only raises a flag; stages that keep incremental checkpoints (the SCPH
+// temperature loop, the mode-analysis mode loop) poll the flag between
+// work items and terminate after the last finished item has been written
+// to disk, so a preempted job can be resumed from that point.
+
+void install_signal_handler();
+
+// Whether a stop signal (SIGTERM, SIGINT or SIGUSR1) was received on
+// this rank. Safe to call anywhere.
+bool stop_requested();
+
+// Whether a stop signal was received on any rank of comm. Collective:
+// every rank of comm must call it at the same point. Use this inside
+// loops that all ranks execute together.
+bool stop_requested_any(MPI_Comm comm);
+}
+}
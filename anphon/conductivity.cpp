@@ -21,13 +21,17 @@
 #include "memory.h"
 #include "phonon_dos.h"
 #include "thermodynamics.h"
+#include "timer.h"
 #include "phonon_velocity.h"
 #include "anharmonic_core.h"
+#include "ewald.h"
 #include "system.h"
 #include "write_phonons.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <map>
 #include <vector>
 
 using namespace PHON_NS;
@@ -54,7 +58,11 @@ void Conductivity::set_default_variables()
     vel = nullptr;
     velmat = nullptr;
     calc_coherent = 0;
+    calc_iterative = 0;
+    kc_window = 0.0;
+    for (auto i = 0; i < 3; ++i) nk_coarse[i] = 0;
     file_coherent_elems = "";
+    restart_extend = false;
 }
 
 void Conductivity::deallocate_variables()
@@ -85,6 +93,8 @@ void Conductivity::deallocate_variables()
 void Conductivity::setup_kappa()
 {
     MPI_Bcast(&calc_coherent, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&calc_iterative, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&nk_coarse[0], 3, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
 
     unsigned int i, j, k;
 
@@ -102,22 +112,32 @@ void Conductivity::setup_kappa()
     const auto nks_each_thread = nks_total / mympi->nprocs;
     const auto nrem = nks_total - nks_each_thread * mympi->nprocs;
 
-    if (nrem > 0) {
-        allocate(damping3, (nks_each_thread + 1) * mympi->nprocs, ntemp);
-    } else {
-        allocate(damping3, nks_total, ntemp);
+    // The full (nk_irred * ns, ntemp) self-energy array is consumed only
+    // on the master rank (restart bookkeeping, degeneracy averaging and
+    // the kappa assembly); the workers communicate through per-mode
+    // buffers, so the array is not replicated on them. For dense
+    // temperature grids this is the dominant memory item per node.
+    if (mympi->my_rank == 0) {
+        if (nrem > 0) {
+            allocate_first_touch(damping3, (nks_each_thread + 1) * mympi->nprocs, ntemp);
+        } else {
+            allocate_first_touch(damping3, nks_total, ntemp);
+        }
     }
 
     const auto factor = Bohr_in_Angstrom * 1.0e-10 / time_ry;
 
-    if (mympi->my_rank == 0) {
+    // The iterative BTE solver needs the group velocities on the full mesh
+    // on every rank, so keep the full array in that case.
+    if (mympi->my_rank == 0 || calc_iterative) {
         allocate(vel, nk, ns, 3);
-        if (calc_coherent) {
-            allocate(velmat, nk, ns, ns, 3);
-        }
     } else {
         allocate(vel, 1, 1, 1);
-        if (calc_coherent) {
+    }
+    if (calc_coherent) {
+        if (mympi->my_rank == 0) {
+            allocate(velmat, nk, ns, ns, 3);
+        } else {
             allocate(velmat, 1, 1, 1, 3);
         }
     }
@@ -133,6 +153,9 @@ void Conductivity::setup_kappa()
             }
         }
     }
+    if (calc_iterative) {
+        MPI_Bcast(&vel[0][0][0], nk * ns * 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
 
     if (calc_coherent) {
         phonon_velocity->calc_phonon_velmat_mesh(velmat);
@@ -150,6 +173,273 @@ void Conductivity::setup_kappa()
     }
 }
 
+std::streamoff Conductivity::binary_record_offset(const unsigned int iks) const
+{
+    const std::streamoff header_size = 8 + sizeof(int)
+                                       + 3 * sizeof(unsigned int) + 2 * sizeof(double);
+    const std::streamoff record_size = 1 + static_cast<std::streamoff>(ntemp) * sizeof(double);
+    return header_size + static_cast<std::streamoff>(iks) * record_size;
+}
+
+bool Conductivity::load_restart_binary()
+{
+    // Resume from the record-indexed binary restart file.
+    // Returns false when the file is absent or does not match the current
+    // mesh and temperature grid, in which case the caller falls back to
+    // parsing the legacy text .result file.
+
+    std::ifstream ifs(file_result_bin.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs) return false;
+
+    char magic[8];
+    int version;
+    unsigned int nk_irred_tmp, ns_tmp, ntemp_tmp;
+    double tmin_tmp, tmax_tmp;
+
+    ifs.read(magic, 8);
+    ifs.read(reinterpret_cast<char *>(&version), sizeof(int));
+    ifs.read(reinterpret_cast<char *>(&nk_irred_tmp), sizeof(unsigned int));
+    ifs.read(reinterpret_cast<char *>(&ns_tmp), sizeof(unsigned int));
+    ifs.read(reinterpret_cast<char *>(&ntemp_tmp), sizeof(unsigned int));
+    ifs.read(reinterpret_cast<char *>(&tmin_tmp), sizeof(double));
+    ifs.read(reinterpret_cast<char *>(&tmax_tmp), sizeof(double));
+
+    if (!ifs) return false;
+    if (!std::equal(magic, magic + 8, "ALMGAMMA")) return false;
+    if (version != 1) return false;
+    if (nk_irred_tmp != dos->kmesh_dos->nk_irred
+        || ns_tmp != ns || ntemp_tmp != ntemp)
+        return false;
+    if (std::abs(tmin_tmp - temperature[0]) > eps8
+        || std::abs(tmax_tmp - temperature[ntemp - 1]) > eps8)
+        return false;
+
+    const auto nks_total = dos->kmesh_dos->nk_irred * ns;
+    char done;
+
+    for (unsigned int iks = 0; iks < nks_total; ++iks) {
+        ifs.seekg(binary_record_offset(iks));
+        ifs.read(&done, 1);
+        if (!ifs) {
+            vks_done.clear();
+            return false;
+        }
+        if (done) {
+            ifs.read(reinterpret_cast<char *>(damping3[iks]),
+                     ntemp * sizeof(double));
+            if (!ifs) {
+                vks_done.clear();
+                return false;
+            }
+            vks_done.push_back(iks);
+        }
+    }
+    ifs.close();
+
+    fs_result_bin.open(file_result_bin.c_str(),
+                       std::ios::in | std::ios::out | std::ios::binary);
+
+    std::cout << "               Resumed from binary restart file "
+              << file_result_bin << std::endl;
+
+    return true;
+}
+
+bool Conductivity::load_restart_binary_extend()
+{
+    // Incremental extension of a finished run. The |V3|^2 and delta-weight
+    // part of the self-energy is temperature independent, so when the user
+    // only changes the temperature grid there is no need to redo the full
+    // triplet sweep at the temperatures that were already computed: reuse
+    // the stored gamma values there and evaluate the Bose-factor sums only
+    // at the uncovered points. Requires a matching k mesh and a restart
+    // file in which every irreducible mode is done; anything else falls
+    // back to the legacy path.
+
+    if (nk_coarse[0] * nk_coarse[1] * nk_coarse[2] > 0) return false;
+
+    std::ifstream ifs(file_result_bin.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs) return false;
+
+    char magic[8];
+    int version;
+    unsigned int nk_irred_tmp, ns_tmp, ntemp_old;
+    double tmin_old, tmax_old;
+
+    ifs.read(magic, 8);
+    ifs.read(reinterpret_cast<char *>(&version), sizeof(int));
+    ifs.read(reinterpret_cast<char *>(&nk_irred_tmp), sizeof(unsigned int));
+    ifs.read(reinterpret_cast<char *>(&ns_tmp), sizeof(unsigned int));
+    ifs.read(reinterpret_cast<char *>(&ntemp_old), sizeof(unsigned int));
+    ifs.read(reinterpret_cast<char *>(&tmin_old), sizeof(double));
+    ifs.read(reinterpret_cast<char *>(&tmax_old), sizeof(double));
+
+    if (!ifs) return false;
+    if (!std::equal(magic, magic + 8, "ALMGAMMA")) return false;
+    if (version != 1) return false;
+    if (nk_irred_tmp != dos->kmesh_dos->nk_irred || ns_tmp != ns) return false;
+    if (ntemp_old < 1) return false;
+
+    // Same grid means load_restart_binary already failed on a damaged
+    // record; do not retry here.
+    if (ntemp_old == ntemp
+        && std::abs(tmin_old - temperature[0]) < eps8
+        && std::abs(tmax_old - temperature[ntemp - 1]) < eps8)
+        return false;
+
+    // The stored grid is uniform by construction.
+    const auto dT_old = (ntemp_old > 1)
+                        ? (tmax_old - tmin_old) / static_cast<double>(ntemp_old - 1)
+                        : 0.0;
+
+    std::vector<int> map_old(ntemp, -1);
+    unsigned int iT;
+
+    for (iT = 0; iT < ntemp; ++iT) {
+        for (unsigned int j = 0; j < ntemp_old; ++j) {
+            if (std::abs(temperature[iT]
+                         - (tmin_old + static_cast<double>(j) * dT_old)) < eps6) {
+                map_old[iT] = j;
+                break;
+            }
+        }
+    }
+
+    itemp_eval.clear();
+    temperature_eval.clear();
+
+    for (iT = 0; iT < ntemp; ++iT) {
+        if (map_old[iT] < 0) {
+            itemp_eval.push_back(iT);
+            temperature_eval.push_back(temperature[iT]);
+        }
+    }
+
+    // No overlap at all: nothing can be reused.
+    if (itemp_eval.size() == ntemp) {
+        itemp_eval.clear();
+        temperature_eval.clear();
+        return false;
+    }
+
+    const std::streamoff header_size = 8 + sizeof(int)
+                                       + 3 * sizeof(unsigned int) + 2 * sizeof(double);
+    const std::streamoff record_old = 1 + static_cast<std::streamoff>(ntemp_old) * sizeof(double);
+
+    const auto nks_total = dos->kmesh_dos->nk_irred * ns;
+    std::vector<double> buf(ntemp_old);
+    char done;
+
+    for (unsigned int iks = 0; iks < nks_total; ++iks) {
+        ifs.seekg(header_size + static_cast<std::streamoff>(iks) * record_old);
+        ifs.read(&done, 1);
+        if (!ifs || !done) {
+            itemp_eval.clear();
+            temperature_eval.clear();
+            return false;
+        }
+        ifs.read(reinterpret_cast<char *>(&buf[0]), ntemp_old * sizeof(double));
+        if (!ifs) {
+            itemp_eval.clear();
+            temperature_eval.clear();
+            return false;
+        }
+        for (iT = 0; iT < ntemp; ++iT) {
+            damping3[iks][iT] = (map_old[iT] >= 0) ? buf[map_old[iT]] : 0.0;
+        }
+    }
+    ifs.close();
+
+    std::cout << "               The binary restart file covers a different temperature grid ("
+              << ntemp_old << " points, " << tmin_old << "--" << tmax_old << " K)" << std::endl;
+    std::cout << "               and all modes are finished there. "
+              << ntemp - itemp_eval.size() << " of " << ntemp
+              << " temperature points are reused;" << std::endl;
+    std::cout << "               only the remaining " << itemp_eval.size()
+              << " points will be computed." << std::endl;
+
+    if (itemp_eval.empty()) {
+        // The new grid is a subset of the old one: every mode is complete.
+        for (unsigned int iks = 0; iks < nks_total; ++iks) vks_done.push_back(iks);
+        init_restart_binary(true);
+        return true;
+    }
+
+    // Every mode is re-listed as a job (it still lacks the new points), so
+    // the file is rewritten on the current grid with no record done. If the
+    // extension run is interrupted, the completed modes resume normally and
+    // the rest fall back to a full recomputation.
+    restart_extend = true;
+    init_restart_binary(false);
+
+    return true;
+}
+
+void Conductivity::init_restart_binary(const bool fill_from_damping3)
+{
+    // Create the binary restart file with one fixed-size record per
+    // irreducible mode. When fill_from_damping3 is set, the records of the
+    // modes already parsed from the legacy text .result file are written
+    // out as done, which converts an old-format restart in one pass.
+
+    fs_result_bin.open(file_result_bin.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!fs_result_bin) {
+        exit("init_restart_binary",
+             "Could not create the binary restart file");
+    }
+
+    const int version = 1;
+    const auto nk_irred_tmp = dos->kmesh_dos->nk_irred;
+    const auto tmin_tmp = temperature[0];
+    const auto tmax_tmp = temperature[ntemp - 1];
+
+    fs_result_bin.write("ALMGAMMA", 8);
+    fs_result_bin.write(reinterpret_cast<const char *>(&version), sizeof(int));
+    fs_result_bin.write(reinterpret_cast<const char *>(&nk_irred_tmp), sizeof(unsigned int));
+    fs_result_bin.write(reinterpret_cast<const char *>(&ns), sizeof(unsigned int));
+    fs_result_bin.write(reinterpret_cast<const char *>(&ntemp), sizeof(unsigned int));
+    fs_result_bin.write(reinterpret_cast<const char *>(&tmin_tmp), sizeof(double));
+    fs_result_bin.write(reinterpret_cast<const char *>(&tmax_tmp), sizeof(double));
+
+    const auto nks_total = dos->kmesh_dos->nk_irred * ns;
+    std::vector<char> done(nks_total, 0);
+    std::vector<double> zeros(ntemp, 0.0);
+
+    if (fill_from_damping3) {
+        for (const auto &it: vks_done) done[it] = 1;
+    }
+
+    for (unsigned int iks = 0; iks < nks_total; ++iks) {
+        fs_result_bin.write(&done[iks], 1);
+        if (done[iks]) {
+            fs_result_bin.write(reinterpret_cast<const char *>(damping3[iks]),
+                                ntemp * sizeof(double));
+        } else {
+            fs_result_bin.write(reinterpret_cast<const char *>(&zeros[0]),
+                                ntemp * sizeof(double));
+        }
+    }
+    fs_result_bin.flush();
+    fs_result_bin.close();
+    fs_result_bin.open(file_result_bin.c_str(),
+                       std::ios::in | std::ios::out | std::ios::binary);
+}
+
+void Conductivity::write_result_gamma_binary(const unsigned int iks_g,
+                                             const double *damp_in) const
+{
+    if (!fs_result_bin.is_open()) return;
+
+    const char done = 1;
+
+    fs_result_bin.seekp(binary_record_offset(iks_g));
+    fs_result_bin.write(&done, 1);
+    fs_result_bin.write(reinterpret_cast<const char *>(damp_in),
+                        ntemp * sizeof(double));
+    fs_result_bin.flush();
+}
+
 void Conductivity::prepare_restart()
 {
     // Write phonon frequency to result file
@@ -162,10 +452,10 @@ void Conductivity::prepare_restart()
 
     double vel_dummy[3];
 
-    nshift_restart = 0;
-
     vks_done.clear();
 
+    file_result_bin = input->job_title + ".result.bin";
+
     if (mympi->my_rank == 0) {
 
         if (!phon->restart_flag) {
@@ -186,7 +476,12 @@ void Conductivity::prepare_restart()
             writes->fs_result << "##END Phonon Frequency" << std::endl << std::endl;
             writes->fs_result << "##Phonon Relaxation Time" << std::endl;
 
-        } else {
+            init_restart_binary(false);
+
+        } else if (!load_restart_binary() && !load_restart_binary_extend()) {
+
+            // Legacy path: parse the text .result file once, then convert it
+            // to the binary record format so the next resume is fast.
 
             while (writes->fs_result >> line_tmp) {
 
@@ -208,19 +503,37 @@ void Conductivity::prepare_restart()
                     vks_done.push_back(nks_tmp);
                 }
             }
+
+            init_restart_binary(true);
         }
 
         writes->fs_result.close();
         writes->fs_result.open(writes->file_result.c_str(), std::ios::app | std::ios::out);
     }
 
+    // Share the temperature-extension state: the workers need to know
+    // which temperature points to evaluate.
+
+    int n_eval = 0;
+    if (mympi->my_rank == 0 && restart_extend) {
+        n_eval = itemp_eval.size();
+    }
+    MPI_Bcast(&n_eval, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (n_eval > 0) {
+        restart_extend = true;
+        itemp_eval.resize(n_eval);
+        temperature_eval.resize(n_eval);
+        MPI_Bcast(&itemp_eval[0], n_eval, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&temperature_eval[0], n_eval, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
+
     // Add vks_done list here
 
     if (mympi->my_rank == 0) {
         nks_done = vks_done.size();
     }
     MPI_Bcast(&nks_done, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    nshift_restart = nks_done;
 
     if (nks_done > 0) {
         allocate(arr_done, nks_done);
@@ -252,6 +565,199 @@ void Conductivity::prepare_restart()
 }
 
 void Conductivity::calc_anharmonic_imagself()
+{
+    if (nk_coarse[0] * nk_coarse[1] * nk_coarse[2] > 0) {
+        calc_anharmonic_imagself_coarse();
+        return;
+    }
+
+    // The per-mode cost varies strongly over the irreducible modes
+    // (acoustic modes near Gamma have many more triplets inside the
+    // smearing window), so a static distribution leaves ranks idle at the
+    // tail. Use dynamic self-scheduling when there are enough ranks to
+    // dedicate one to bookkeeping; otherwise fall back to the static
+    // round-robin distribution.
+
+    if (mympi->nprocs > 2) {
+        calc_anharmonic_imagself_dynamic();
+    } else {
+        calc_anharmonic_imagself_static();
+    }
+}
+
+void Conductivity::calc_damping_mode(const int iks,
+                                     double *damping_out) const
+{
+    timer->start_clock("calc_damping_mode");
+
+    const auto knum = dos->kmesh_dos->kpoint_irred_all[iks / ns][0].knum;
+    const auto snum = iks % ns;
+
+    const auto omega = dos->dymat_dos->get_eigenvalues()[knum][snum];
+
+    // In extension mode only the temperature points absent from the old
+    // grid are evaluated; damping_out then holds that compact subset.
+    const auto ntemp_run = restart_extend
+                           ? static_cast<unsigned int>(itemp_eval.size()) : ntemp;
+    const double *temp_run = restart_extend ? &temperature_eval[0] : temperature;
+
+    if (integration->ismear == 0 || integration->ismear == 1 || integration->ismear == 2) {
+        anharmonic_core->calc_damping_smearing(ntemp_run,
+                                               temp_run,
+                                               omega,
+                                               iks / ns,
+                                               snum,
+                                               dos->kmesh_dos,
+                                               dos->dymat_dos->get_eigenvalues(),
+                                               dos->dymat_dos->get_eigenvectors(),
+                                               damping_out);
+    } else if (integration->ismear == -1) {
+        anharmonic_core->calc_damping_tetrahedron(ntemp_run,
+                                                  temp_run,
+                                                  omega,
+                                                  iks / ns,
+                                                  snum,
+                                                  dos->kmesh_dos,
+                                                  dos->dymat_dos->get_eigenvalues(),
+                                                  dos->dymat_dos->get_eigenvectors(),
+                                                  damping_out);
+    }
+
+    timer->stop_clock("calc_damping_mode");
+}
+
+void Conductivity::calc_anharmonic_imagself_dynamic()
+{
+    // Master/worker self-scheduling over the remaining irreducible modes.
+    // Rank 0 hands out one mode at a time and collects the results in
+    // arrival order, so ranks that finish early immediately pull the next
+    // mode instead of waiting at a collective gather. The #GAMMA_EACH
+    // blocks of the restart file are self-describing, hence out-of-order
+    // writes are harmless for prepare_restart.
+
+    constexpr int tag_task = 1001;
+    constexpr int tag_result = 1002;
+
+    unsigned int j;
+
+    std::vector<int> mode_list(vks_job.begin(), vks_job.end());
+    const int nmode = mode_list.size();
+
+    // Dispatch the expensive modes first. Each remaining (k, s) left over
+    // by the restart bookkeeping is weighed by the triplet-list length of
+    // its irreducible k point, the dominant cost factor of
+    // calc_damping_mode, and the task list is sorted in descending order
+    // of that weight. The tail of the run then consists of the cheap
+    // modes, which shrinks the straggler window of resumed jobs. The
+    // master decides the order and broadcasts it, since every rank
+    // indexes the same list by task position.
+    if (nmode > 1) {
+        if (mympi->my_rank == 0) {
+            std::map<int, std::size_t> weight_of_k;
+            std::vector<KsListGroup> triplet_tmp;
+
+            for (const auto &iks: mode_list) {
+                const auto ik = iks / static_cast<int>(ns);
+                if (weight_of_k.find(ik) == weight_of_k.end()) {
+                    dos->kmesh_dos->get_unique_triplet_k(ik,
+                                                         symmetry->SymmList,
+                                                         false,
+                                                         false,
+                                                         triplet_tmp);
+                    weight_of_k[ik] = triplet_tmp.size();
+                }
+            }
+            const auto ns_int = static_cast<int>(ns);
+            std::stable_sort(mode_list.begin(), mode_list.end(),
+                             [&weight_of_k, ns_int](const int a, const int b) {
+                                 return weight_of_k[a / ns_int] > weight_of_k[b / ns_int];
+                             });
+        }
+        MPI_Bcast(&mode_list[0], nmode, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+
+    // In extension mode the workers only return the uncovered temperature
+    // points; the reused ones are already in damping3 on the master.
+    const auto ngamma = restart_extend
+                        ? static_cast<unsigned int>(itemp_eval.size()) : ntemp;
+
+    double *damping3_loc;
+    allocate(damping3_loc, ngamma);
+
+    if (mympi->my_rank == 0) {
+
+        std::cout << std::endl;
+        std::cout << " Start calculating anharmonic phonon self-energies ... " << std::endl;
+        std::cout << " Total Number of phonon modes to be calculated : " << nmode << std::endl;
+        std::cout << " Modes are distributed dynamically to " << mympi->nprocs - 1
+                  << " worker ranks." << std::endl;
+        std::cout << std::endl << std::flush;
+
+        auto itask = 0;
+        auto ndone = 0;
+        auto nworker = static_cast<int>(mympi->nprocs) - 1;
+        int pos;
+        MPI_Status status;
+
+        while (nworker > 0) {
+
+            MPI_Recv(&pos, 1, MPI_INT, MPI_ANY_SOURCE, tag_result,
+                     MPI_COMM_WORLD, &status);
+            const auto src = status.MPI_SOURCE;
+
+            if (pos >= 0) {
+                MPI_Recv(&damping3_loc[0], ngamma, MPI_DOUBLE, src, tag_result,
+                         MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+                // damping3 is indexed by the global mode id (the done rows
+                // are preloaded at their global-id rows), and the sorted
+                // task list no longer follows the id order, so the result
+                // of task pos belongs to row mode_list[pos].
+                const auto irow = mode_list[pos];
+                if (restart_extend) {
+                    for (j = 0; j < ngamma; ++j) damping3[irow][itemp_eval[j]] = damping3_loc[j];
+                } else {
+                    for (j = 0; j < ntemp; ++j) damping3[irow][j] = damping3_loc[j];
+                }
+                write_result_gamma_each(irow, vel, damping3[irow]);
+
+                ++ndone;
+                std::cout << " MODE " << std::setw(5) << ndone << " done." << std::endl << std::flush;
+            }
+
+            if (itask < nmode) {
+                MPI_Send(&itask, 1, MPI_INT, src, tag_task, MPI_COMM_WORLD);
+                ++itask;
+            } else {
+                const auto stop_signal = -1;
+                MPI_Send(&stop_signal, 1, MPI_INT, src, tag_task, MPI_COMM_WORLD);
+                --nworker;
+            }
+        }
+
+    } else {
+
+        int pos = -1;
+        MPI_Send(&pos, 1, MPI_INT, 0, tag_result, MPI_COMM_WORLD);
+
+        while (true) {
+            MPI_Recv(&pos, 1, MPI_INT, 0, tag_task,
+                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            if (pos < 0) break;
+
+            calc_damping_mode(mode_list[pos], damping3_loc);
+
+            MPI_Send(&pos, 1, MPI_INT, 0, tag_result, MPI_COMM_WORLD);
+            MPI_Send(&damping3_loc[0], ngamma, MPI_DOUBLE, 0, tag_result, MPI_COMM_WORLD);
+        }
+    }
+
+    deallocate(damping3_loc);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void Conductivity::calc_anharmonic_imagself_static()
 {
     unsigned int i;
     unsigned int *nks_thread = nullptr;
@@ -305,98 +811,333 @@ void Conductivity::calc_anharmonic_imagself()
         vks_l.push_back(-1);
     }
 
-    allocate(damping3_loc, ntemp);
+    // Double-buffered pipeline: the gather of chunk i is posted with
+    // MPI_Igather and completed only right before the gather of chunk i+1
+    // is posted, so every rank starts computing the next chunk while the
+    // previous one is still in flight and while rank 0 writes its restart
+    // blocks. Without this, all ranks stall at the collective whenever
+    // rank 0 is busy with the .result file.
+
+    // In extension mode the gather carries only the uncovered temperature
+    // points, which are then scattered into the preloaded damping3 rows.
+    const auto ngamma = restart_extend
+                        ? static_cast<unsigned int>(itemp_eval.size()) : ntemp;
+
+    // After a resume the remaining modes are not a contiguous block of
+    // damping3 rows (an interrupted dynamic run leaves holes in the done
+    // set), so the gathered chunks are scattered into the rows of the
+    // actual mode ids instead of being stored at a prefix offset. The
+    // mode computed by rank ir in chunk ic is element ic * nprocs + ir of
+    // the sorted remaining-mode list, matching the round-robin split of
+    // vks_l above.
+    std::vector<int> vks_g;
+    if (mympi->my_rank == 0) {
+        vks_g.assign(vks_job.begin(), vks_job.end());
+    }
+
+    double **damping3_buf;
+    double **gather_buf = nullptr;
+    allocate(damping3_buf, 2, ngamma);
+    if (mympi->my_rank == 0) {
+        // The receive buffer is only read at the root; the workers do not
+        // hold the full damping3 array.
+        allocate(gather_buf, 2, ngamma * mympi->nprocs);
+    }
+
+    MPI_Request req_gather;
+
+    auto store_chunk = [&](const unsigned int ic) {
+        const double *chunk = gather_buf[ic % 2];
+        for (unsigned int ir = 0; ir < mympi->nprocs; ++ir) {
+            const auto idx = ic * mympi->nprocs + ir;
+            if (idx >= vks_g.size()) break;
+            const auto iks_g = vks_g[idx];
+            if (restart_extend) {
+                for (unsigned int j = 0; j < ngamma; ++j) {
+                    damping3[iks_g][itemp_eval[j]] = chunk[ir * ngamma + j];
+                }
+            } else {
+                for (unsigned int j = 0; j < ngamma; ++j) {
+                    damping3[iks_g][j] = chunk[ir * ngamma + j];
+                }
+            }
+            write_result_gamma_each(iks_g, vel, damping3[iks_g]);
+        }
+    };
 
     for (i = 0; i < nk_tmp; ++i) {
 
         const auto iks = vks_l[i];
+        damping3_loc = damping3_buf[i % 2];
 
         if (iks == -1) {
 
-            for (unsigned int j = 0; j < ntemp; ++j) damping3_loc[j] = eps; // do nothing
+            for (unsigned int j = 0; j < ngamma; ++j) damping3_loc[j] = eps; // do nothing
 
         } else {
+            calc_damping_mode(iks, damping3_loc);
+        }
+
+        if (i > 0) {
+            // The wait time of this region is a direct measure of the
+            // load imbalance between the ranks.
+            timer->start_clock("collect_selfenergy");
+            MPI_Wait(&req_gather, MPI_STATUS_IGNORE);
+
+            if (mympi->my_rank == 0) {
+                store_chunk(i - 1);
+                std::cout << " MODE " << std::setw(5) << i << " done." << std::endl << std::flush;
+            }
+            timer->stop_clock("collect_selfenergy");
+        }
+
+        MPI_Igather(&damping3_loc[0], ngamma, MPI_DOUBLE,
+                    mympi->my_rank == 0 ? gather_buf[i % 2] : nullptr, ngamma,
+                    MPI_DOUBLE, 0, MPI_COMM_WORLD, &req_gather);
+    }
 
-            const auto knum = dos->kmesh_dos->kpoint_irred_all[iks / ns][0].knum;
-            const auto snum = iks % ns;
-
-            const auto omega = dos->dymat_dos->get_eigenvalues()[knum][snum];
-
-            if (integration->ismear == 0 || integration->ismear == 1) {
-                anharmonic_core->calc_damping_smearing(ntemp,
-                                                       temperature,
-                                                       omega,
-                                                       iks / ns,
-                                                       snum,
-                                                       dos->kmesh_dos,
-                                                       dos->dymat_dos->get_eigenvalues(),
-                                                       dos->dymat_dos->get_eigenvectors(),
-                                                       damping3_loc);
-            } else if (integration->ismear == -1) {
-                anharmonic_core->calc_damping_tetrahedron(ntemp,
-                                                          temperature,
-                                                          omega,
-                                                          iks / ns,
-                                                          snum,
-                                                          dos->kmesh_dos,
-                                                          dos->dymat_dos->get_eigenvalues(),
-                                                          dos->dymat_dos->get_eigenvectors(),
-                                                          damping3_loc);
-            }
-        }
-
-        MPI_Gather(&damping3_loc[0], ntemp, MPI_DOUBLE,
-                   damping3[nshift_restart + i * mympi->nprocs], ntemp,
-                   MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (nk_tmp > 0) {
+        timer->start_clock("collect_selfenergy");
+        MPI_Wait(&req_gather, MPI_STATUS_IGNORE);
 
         if (mympi->my_rank == 0) {
-            write_result_gamma(i, nshift_restart, vel, damping3);
-            std::cout << " MODE " << std::setw(5) << i + 1 << " done." << std::endl << std::flush;
+            store_chunk(nk_tmp - 1);
+            std::cout << " MODE " << std::setw(5) << nk_tmp << " done." << std::endl << std::flush;
         }
+        timer->stop_clock("collect_selfenergy");
     }
-    deallocate(damping3_loc);
+
+    deallocate(damping3_buf);
+    if (gather_buf) deallocate(gather_buf);
 }
 
-void Conductivity::write_result_gamma(const unsigned int ik,
-                                      const unsigned int nshift,
-                                      double ***vel_in,
-                                      double **damp_in) const
+void Conductivity::calc_anharmonic_imagself_coarse()
 {
-    const unsigned int np = mympi->nprocs;
-    unsigned int k;
+    // Fast screening mode (KMESH_COARSE): the anharmonic self-energies are
+    // evaluated only on the irreducible points of a coarse uniform mesh,
+    // and log(gamma) is interpolated trilinearly onto the irreducible
+    // modes of the fine mesh used for the velocities and heat capacities.
+    // The logarithm keeps the interpolated linewidths positive and follows
+    // the strong variation of gamma near the zone center much better than
+    // a linear interpolation does.
+
+    unsigned int i;
+    unsigned int is, js;
+
+    if (integration->ismear == -1) {
+        exit("calc_anharmonic_imagself_coarse",
+             "KMESH_COARSE requires smearing. Please set ISMEAR = 0, 1 or 2.");
+    }
+
+    const auto kmesh_c = new KpointMeshUniform(nk_coarse);
+    kmesh_c->setup(symmetry->SymmList,
+                   system->rlavec_p,
+                   symmetry->time_reversal_sym);
+
+    const auto nk_c = kmesh_c->nk;
+    const auto nks_c = kmesh_c->nk_irred * ns;
+
+    if (mympi->my_rank == 0) {
+        std::cout << std::endl;
+        std::cout << " KMESH_COARSE: self-energies are computed on the coarse grid" << std::endl;
+        std::cout << "  nk1:" << std::setw(5) << nk_coarse[0];
+        std::cout << "  nk2:" << std::setw(5) << nk_coarse[1];
+        std::cout << "  nk3:" << std::setw(5) << nk_coarse[2] << std::endl;
+        std::cout << "  Number of irreducible k points : " << kmesh_c->nk_irred << std::endl;
+        std::cout << "  and log(gamma) is interpolated onto the fine mesh." << std::endl;
+        std::cout << "  The results should be checked against a full calculation." << std::endl;
+        std::cout << std::endl << std::flush;
+    }
+
+    // Harmonic solution on the coarse grid.
+
+    double **eval_c;
+    std::complex<double> ***evec_c;
+
+    allocate(eval_c, nk_c, ns);
+    allocate(evec_c, nk_c, ns, ns);
+
+    dynamical->get_eigenvalues_dymat(nk_c,
+                                     kmesh_c->xk,
+                                     kmesh_c->kvec_na,
+                                     fcs_phonon->fc2_ext,
+                                     ewald->fc2_without_dipole,
+                                     true,
+                                     eval_c,
+                                     evec_c);
+
+    // Phase factors tuned for the coarse grid.
+
+    PhaseFactorStorage phase_storage_c(kmesh_c->nk_i);
+    phase_storage_c.create(anharmonic_core->use_tuned_ver);
+
+    // Self-energies of the coarse irreducible modes, distributed
+    // round-robin over the MPI ranks and replicated afterwards.
+
+    double **gamma_c_loc, **gamma_c_irred;
+    allocate(gamma_c_loc, nks_c, ntemp);
+    allocate(gamma_c_irred, nks_c, ntemp);
+
+    for (i = 0; i < nks_c; ++i) {
+        for (js = 0; js < ntemp; ++js) gamma_c_loc[i][js] = 0.0;
+    }
+
+    for (i = mympi->my_rank; i < nks_c; i += mympi->nprocs) {
+        const auto ik_irred = i / ns;
+        const auto snum = i % ns;
+        const auto knum = kmesh_c->kpoint_irred_all[ik_irred][0].knum;
+
+        anharmonic_core->calc_damping_smearing(ntemp,
+                                               temperature,
+                                               eval_c[knum][snum],
+                                               ik_irred,
+                                               snum,
+                                               kmesh_c,
+                                               eval_c,
+                                               evec_c,
+                                               gamma_c_loc[i],
+                                               &phase_storage_c);
+    }
+
+    MPI_Allreduce(&gamma_c_loc[0][0], &gamma_c_irred[0][0],
+                  nks_c * ntemp, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    deallocate(gamma_c_loc);
+
+    // Expand to the full coarse mesh so that the interpolation can address
+    // the eight corners of any fine k point directly.
+
+    double ***gamma_c;
+    allocate(gamma_c, nk_c, ns, ntemp);
+
+    for (i = 0; i < nk_c; ++i) {
+        const auto ik_irred = kmesh_c->kmap_to_irreducible[i];
+        for (is = 0; is < ns; ++is) {
+            for (js = 0; js < ntemp; ++js) {
+                gamma_c[i][is][js] = gamma_c_irred[ik_irred * ns + is][js];
+            }
+        }
+    }
+    deallocate(gamma_c_irred);
+
+    if (mympi->my_rank == 0) interpolate_gamma_coarse(kmesh_c, gamma_c);
+
+    // Keep the .result file usable for downstream analyses: the modes that
+    // the restart logic scheduled for this run are recorded as done.
+
+    if (mympi->my_rank == 0) {
+        for (const auto &it: vks_job) {
+            write_result_gamma_each(it, vel, damping3[it]);
+        }
+    }
+
+    deallocate(gamma_c);
+    deallocate(eval_c);
+    deallocate(evec_c);
+    delete kmesh_c;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+void Conductivity::interpolate_gamma_coarse(const KpointMeshUniform *kmesh_c,
+                                            const double *const *const *gamma_c)
+{
+    // Trilinear interpolation of log(gamma) from the full coarse mesh onto
+    // the irreducible modes of the fine mesh. Both meshes are
+    // Gamma-centered and periodic, so the corner indices wrap around.
 
-    for (unsigned int j = 0; j < np; ++j) {
+    constexpr double gamma_floor = 1.0e-100;
 
-        const auto iks_g = ik * np + j + nshift;
+    const auto eval_f = dos->dymat_dos->get_eigenvalues();
 
-        if (iks_g >= dos->kmesh_dos->nk_irred * ns) break;
+    int iloc[3][2];
+    double frac[3];
 
-        writes->fs_result << "#GAMMA_EACH" << std::endl;
-        writes->fs_result << iks_g / ns + 1 << " " << iks_g % ns + 1 << std::endl;
+    for (unsigned int ik = 0; ik < dos->kmesh_dos->nk_irred; ++ik) {
 
-        const auto nk_equiv = dos->kmesh_dos->kpoint_irred_all[iks_g / ns].size();
+        const auto knum = dos->kmesh_dos->kpoint_irred_all[ik][0].knum;
 
-        writes->fs_result << nk_equiv << std::endl;
-        for (k = 0; k < nk_equiv; ++k) {
-            const auto ktmp = dos->kmesh_dos->kpoint_irred_all[iks_g / ns][k].knum;
-            writes->fs_result << std::setw(15) << vel_in[ktmp][iks_g % ns][0];
-            writes->fs_result << std::setw(15) << vel_in[ktmp][iks_g % ns][1];
-            writes->fs_result << std::setw(15) << vel_in[ktmp][iks_g % ns][2] << std::endl;
+        for (auto i = 0; i < 3; ++i) {
+            auto xtmp = dos->kmesh_dos->xk[knum][i];
+            xtmp -= std::floor(xtmp);
+            const auto t = xtmp * static_cast<double>(kmesh_c->nk_i[i]);
+            iloc[i][0] = static_cast<int>(t) % kmesh_c->nk_i[i];
+            iloc[i][1] = (iloc[i][0] + 1) % kmesh_c->nk_i[i];
+            frac[i] = t - std::floor(t);
         }
 
-        for (k = 0; k < ntemp; ++k) {
-            writes->fs_result << std::setw(15)
-                              << damp_in[iks_g][k] * Hz_to_kayser / time_ry << std::endl;
+        for (unsigned int is = 0; is < ns; ++is) {
+
+            // Modes excluded from the calculation on the fine mesh
+            // (e.g. acoustic modes at Gamma) stay at zero.
+            if (eval_f[knum][is] < eps8) {
+                for (unsigned int itemp = 0; itemp < ntemp; ++itemp) {
+                    damping3[ik * ns + is][itemp] = 0.0;
+                }
+                continue;
+            }
+
+            for (unsigned int itemp = 0; itemp < ntemp; ++itemp) {
+
+                auto log_gamma = 0.0;
+
+                for (auto ix = 0; ix < 2; ++ix) {
+                    for (auto iy = 0; iy < 2; ++iy) {
+                        for (auto iz = 0; iz < 2; ++iz) {
+                            const auto weight = (ix ? frac[0] : 1.0 - frac[0])
+                                                * (iy ? frac[1] : 1.0 - frac[1])
+                                                * (iz ? frac[2] : 1.0 - frac[2]);
+                            const auto knum_c = iloc[2][iz]
+                                                + kmesh_c->nk_i[2] * iloc[1][iy]
+                                                + kmesh_c->nk_i[1] * kmesh_c->nk_i[2] * iloc[0][ix];
+                            log_gamma += weight
+                                         * std::log(std::max(gamma_c[knum_c][is][itemp],
+                                                             gamma_floor));
+                        }
+                    }
+                }
+                damping3[ik * ns + is][itemp] = std::exp(log_gamma);
+            }
         }
-        writes->fs_result << "#END GAMMA_EACH" << std::endl;
     }
 }
 
+void Conductivity::write_result_gamma_each(const unsigned int iks_g,
+                                           double ***vel_in,
+                                           const double *damp_in) const
+{
+    // Write the #GAMMA_EACH restart block of a single mode.
+
+    unsigned int k;
+
+    writes->fs_result << "#GAMMA_EACH" << std::endl;
+    writes->fs_result << iks_g / ns + 1 << " " << iks_g % ns + 1 << std::endl;
+
+    const auto nk_equiv = dos->kmesh_dos->kpoint_irred_all[iks_g / ns].size();
+
+    writes->fs_result << nk_equiv << std::endl;
+    for (k = 0; k < nk_equiv; ++k) {
+        const auto ktmp = dos->kmesh_dos->kpoint_irred_all[iks_g / ns][k].knum;
+        writes->fs_result << std::setw(15) << vel_in[ktmp][iks_g % ns][0];
+        writes->fs_result << std::setw(15) << vel_in[ktmp][iks_g % ns][1];
+        writes->fs_result << std::setw(15) << vel_in[ktmp][iks_g % ns][2] << std::endl;
+    }
+
+    for (k = 0; k < ntemp; ++k) {
+        writes->fs_result << std::setw(15)
+                          << damp_in[k] * Hz_to_kayser / time_ry << std::endl;
+    }
+    writes->fs_result << "#END GAMMA_EACH" << std::endl;
+
+    write_result_gamma_binary(iks_g, damp_in);
+}
+
 void Conductivity::compute_kappa()
 {
     unsigned int i;
     unsigned int iks;
 
+    double **gamma_total = nullptr;
+
     if (mympi->my_rank == 0) {
 
         std::string file_kl;
@@ -404,7 +1145,6 @@ void Conductivity::compute_kappa()
         double damp_tmp;
 
         double **lifetime;
-        double **gamma_total;
 
         allocate(lifetime, dos->kmesh_dos->nk_irred * ns, ntemp);
         allocate(gamma_total, dos->kmesh_dos->nk_irred * ns, ntemp);
@@ -412,7 +1152,7 @@ void Conductivity::compute_kappa()
         average_self_energy_at_degenerate_point(dos->kmesh_dos->nk_irred * ns,
                                                 ntemp,
                                                 dos->kmesh_dos,
-                                                dos->dymat_dos->get_eigenvalues(),
+                                                dos->dymat_dos,
                                                 damping3);
 
         if (isotope->include_isotope) {
@@ -478,160 +1218,701 @@ void Conductivity::compute_kappa()
                                    gamma_total,
                                    kappa_coherent);
         }
+    }
+
+    if (calc_iterative) {
+        // Refine the RTA solution by iterating the linearized BTE.
+        // This part runs on all ranks; the converged kappa replaces the
+        // RTA values computed above. The frequency-resolved and coherent
+        // contributions remain at the RTA level.
+        if (mympi->my_rank != 0) {
+            allocate(gamma_total, dos->kmesh_dos->nk_irred * ns, ntemp);
+            allocate(kappa, ntemp, 3, 3);
+        }
+        MPI_Bcast(&gamma_total[0][0], dos->kmesh_dos->nk_irred * ns * ntemp,
+                  MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
-        deallocate(gamma_total);
+        compute_kappa_iterative(gamma_total);
     }
+
+    if (gamma_total) deallocate(gamma_total);
 }
 
-void Conductivity::average_self_energy_at_degenerate_point(const int n,
-                                                           const int m,
-                                                           const KpointMeshUniform *kmesh_in,
-                                                           const double *const *eval_in,
-                                                           double **damping) const
+void Conductivity::calc_collision_elements(const unsigned int iks,
+                                           std::vector<ThreePhononElement> &elems) const
 {
-    int j, k, l;
-    const auto nkr = kmesh_in->nk_irred;
-
-    double *eval_tmp;
-    const auto tol_omega = 1.0e-7; // Approximately equal to 0.01 cm^{-1}
+    // Build the sparse three-phonon collision operator row of the
+    // irreducible mode iks = ik * ns + is. The loop runs over the full k2
+    // mesh (k3 is fixed by momentum conservation), because the in-scattering
+    // term of the linearized BTE is a vector sum and must not be folded by
+    // the small group of k1. The squared matrix elements are served from
+    // the gauge-invariant |V3|^2 orbit cache, which the preceding
+    // self-energy calculation has already populated for most triplets.
 
-    std::vector<int> degeneracy_at_k;
+    const auto kmesh = dos->kmesh_dos;
+    const auto eval = dos->dymat_dos->get_eigenvalues();
+    const auto evec = dos->dymat_dos->get_eigenvectors();
 
-    allocate(eval_tmp, ns);
+    const auto knum = kmesh->kpoint_irred_all[iks / ns][0].knum;
+    const auto knum_minus = kmesh->kindex_minus_xk[knum];
+    const auto snum = iks % ns;
+    const auto omega1 = eval[knum][snum];
 
-    double *damping_sum;
-
-    allocate(damping_sum, m);
+    const auto epsilon = integration->epsilon;
 
-    for (auto i = 0; i < nkr; ++i) {
-        const auto ik = kmesh_in->kpoint_irred_all[i][0].knum;
+    // Discard pairs whose delta functions are negligible relative to the
+    // peak height 1/(epsilon sqrt(pi)).
+    const auto delta_cutoff = 1.0e-6 / epsilon;
 
-        for (j = 0; j < ns; ++j) eval_tmp[j] = eval_in[ik][j];
+    unsigned int arr[3];
+    double xk_tmp[3];
 
-        degeneracy_at_k.clear();
+    elems.clear();
 
-        auto omega_prev = eval_tmp[0];
-        auto ideg = 1;
+    if (omega1 < eps8) return;
 
-        for (j = 1; j < ns; ++j) {
-            const auto omega_now = eval_tmp[j];
+    for (unsigned int k2 = 0; k2 < nk; ++k2) {
 
-            if (std::abs(omega_now - omega_prev) < tol_omega) {
-                ++ideg;
-            } else {
-                degeneracy_at_k.push_back(ideg);
-                ideg = 1;
-                omega_prev = omega_now;
-            }
+        for (auto i = 0; i < 3; ++i) {
+            xk_tmp[i] = kmesh->xk[knum][i] - kmesh->xk[k2][i];
         }
-        degeneracy_at_k.push_back(ideg);
+        const auto k3 = kmesh->get_knum(xk_tmp);
+        if (k3 < 0) continue;
 
-        int is = 0;
-        for (j = 0; j < degeneracy_at_k.size(); ++j) {
-            ideg = degeneracy_at_k[j];
+        for (unsigned int s2 = 0; s2 < ns; ++s2) {
+            const auto omega2 = eval[k2][s2];
+            if (omega2 < eps8) continue;
 
-            if (ideg > 1) {
+            for (unsigned int s3 = 0; s3 < ns; ++s3) {
+                const auto omega3 = eval[k3][s3];
+                if (omega3 < eps8) continue;
 
-                for (l = 0; l < m; ++l) damping_sum[l] = 0.0;
+                double delta_emit, delta_absorb;
 
-                for (k = is; k < is + ideg; ++k) {
-                    for (l = 0; l < m; ++l) {
-                        damping_sum[l] += damping[ns * i + k][l];
-                    }
+                if (integration->ismear == 0) {
+                    delta_emit = delta_lorentz(omega1 - omega2 - omega3, epsilon);
+                    delta_absorb = delta_lorentz(omega1 + omega2 - omega3, epsilon);
+                } else {
+                    // Gaussian smearing, also used as the fallback when the
+                    // self-energies were integrated with the tetrahedron
+                    // method (ismear = -1).
+                    delta_emit = delta_gauss(omega1 - omega2 - omega3, epsilon);
+                    delta_absorb = delta_gauss(omega1 + omega2 - omega3, epsilon);
                 }
 
-                for (k = is; k < is + ideg; ++k) {
-                    for (l = 0; l < m; ++l) {
-                        damping[ns * i + k][l] = damping_sum[l] / static_cast<double>(ideg);
-                    }
-                }
-            }
+                if (delta_emit < delta_cutoff && delta_absorb < delta_cutoff) continue;
 
-            is += ideg;
+                arr[0] = ns * knum_minus + snum;
+                arr[1] = ns * k2 + s2;
+                arr[2] = ns * static_cast<unsigned int>(k3) + s3;
+
+                const auto v3norm2 = anharmonic_core->V3_norm_cached(arr,
+                                                                     kmesh,
+                                                                     eval,
+                                                                     evec);
+
+                elems.emplace_back(k2, static_cast<unsigned int>(k3), s2, s3,
+                                   v3norm2, delta_emit, delta_absorb);
+            }
         }
     }
-    deallocate(damping_sum);
 }
 
-void Conductivity::compute_kappa_intraband(const KpointMeshUniform *kmesh_in,
-                                           const double *const *eval_in,
-                                           const double *const *lifetime,
-                                           double ***kappa_intra,
-                                           double ***kappa_spec_out) const
+void Conductivity::setup_kpoint_symmetry_rotations(double ***symrot_k) const
 {
-    int i, is, ik;
-    double ****kappa_mode;
+    // For every k point of the full mesh, store the Cartesian rotation
+    // matrix (with the time-reversal sign folded in) that maps the mean
+    // free displacement of the irreducible representative onto that point:
+    // F(S k0) = S_cart F(k0) and F(-S k0) = -S_cart F(k0).
+
+    const auto kmesh = dos->kmesh_dos;
+    const auto inv_tpi = 1.0 / (2.0 * pi);
+
+    double rot_tmp[3][3], rot_frac[3][3], rot_cart[3][3];
+
+    for (unsigned int ik = 0; ik < nk; ++ik) {
+        for (auto i = 0; i < 3; ++i) {
+            for (auto j = 0; j < 3; ++j) {
+                symrot_k[ik][i][j] = static_cast<double>(i == j);
+            }
+        }
+    }
+
+    for (unsigned int ik = 0; ik < kmesh->nk_irred; ++ik) {
+
+        const auto knum0 = kmesh->kpoint_irred_all[ik][0].knum;
+        const auto nk_equiv = kmesh->kpoint_irred_all[ik].size();
+
+        for (unsigned int ieq = 1; ieq < nk_equiv; ++ieq) {
+
+            const auto knum = kmesh->kpoint_irred_all[ik][ieq].knum;
+
+            auto found = false;
+            auto sign = 1.0;
+            int isym_found = -1;
+
+            for (unsigned int isym = 0; isym < symmetry->SymmList.size(); ++isym) {
+                if (kmesh->knum_sym(knum0, symmetry->SymmList[isym].rot) == knum) {
+                    isym_found = isym;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                // The point is reached only by a rotation followed by time
+                // reversal, under which F changes sign.
+                for (unsigned int isym = 0; isym < symmetry->SymmList.size(); ++isym) {
+                    if (kmesh->knum_sym(knum0, symmetry->SymmList[isym].rot)
+                        == kmesh->kindex_minus_xk[knum]) {
+                        isym_found = isym;
+                        sign = -1.0;
+                        found = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!found) {
+                warn("setup_kpoint_symmetry_rotations",
+                     "No symmetry operation connects a k point to its irreducible representative.");
+                continue;
+            }
+
+            for (auto i = 0; i < 3; ++i) {
+                for (auto j = 0; j < 3; ++j) {
+                    rot_frac[i][j] = static_cast<double>(symmetry->SymmList[isym_found].rot[i][j]);
+                }
+            }
+
+            // Cartesian rotation: S_cart = lavec_p * S * rlavec_p / (2 pi)
+            matmul3(rot_tmp, rot_frac, system->rlavec_p);
+            matmul3(rot_cart, system->lavec_p, rot_tmp);
+
+            for (auto i = 0; i < 3; ++i) {
+                for (auto j = 0; j < 3; ++j) {
+                    symrot_k[knum][i][j] = sign * rot_cart[i][j] * inv_tpi;
+                }
+            }
+        }
+    }
+}
+
+void Conductivity::compute_kappa_iterative(const double *const *gamma_total)
+{
+    // Solve the linearized BTE beyond the RTA by fixed-point iteration of
+    // the mean free displacements F (Omini-Sparavigna scheme). The sparse
+    // collision elements of the locally owned irreducible modes are built
+    // once; every cycle then evaluates the in-scattering term with the
+    // current F, which is propagated to the full mesh through the
+    // symmetry rotations, and the updated F is shared among the ranks.
+    // The diagonal (out-scattering) part is taken from gamma_total, so
+    // isotope scattering is included as a pure relaxation channel.
+
+    const auto kmesh = dos->kmesh_dos;
+    const auto eval = dos->dymat_dos->get_eigenvalues();
+    const auto nk_irred = kmesh->nk_irred;
+    const auto nks_total = nk_irred * ns;
+
     const auto factor_toSI = 1.0e+18 / (std::pow(Bohr_in_Angstrom, 3) * system->volume_p);
+    const auto common_factor = factor_toSI * 1.0e+12 * time_ry / static_cast<double>(nk);
+    const auto prefactor_gamma = pi * 0.25 / static_cast<double>(nk);
 
-    const auto nk_irred = kmesh_in->nk_irred;
-    allocate(kappa_mode, ntemp, 9, ns, nk_irred);
+    const auto max_cycle = 300;
+    const auto conv_tol = 1.0e-4;
 
-    for (i = 0; i < ntemp; ++i) {
-        for (unsigned int j = 0; j < 3; ++j) {
-            for (unsigned int k = 0; k < 3; ++k) {
+    unsigned int i, iks;
+    int j, k;
+
+    // Round-robin distribution over the irreducible modes, as in the
+    // static self-energy path.
+    std::vector<int> vks_iter;
+    unsigned int icount = 0;
+    for (iks = 0; iks < nks_total; ++iks) {
+        if (icount % mympi->nprocs == mympi->my_rank) {
+            vks_iter.push_back(iks);
+        }
+        ++icount;
+    }
+
+    if (mympi->my_rank == 0) {
+        std::cout << std::endl;
+        std::cout << " ITERATIVE_BTE = 1: Solving the linearized BTE iteratively." << std::endl;
+        std::cout << " Building the three-phonon collision elements ... " << std::flush;
+    }
+
+    std::vector<std::vector<ThreePhononElement>> collision(vks_iter.size());
+
+    unsigned long nelems_local = 0;
+    for (i = 0; i < vks_iter.size(); ++i) {
+        calc_collision_elements(vks_iter[i], collision[i]);
+        nelems_local += collision[i].size();
+    }
+
+    unsigned long nelems_total = 0;
+    MPI_Reduce(&nelems_local, &nelems_total, 1, MPI_UNSIGNED_LONG,
+               MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (mympi->my_rank == 0) {
+        std::cout << "done." << std::endl;
+        std::cout << " Number of stored collision elements : " << nelems_total << std::endl;
+        std::cout << " Memory used for the collision operator (MB) : "
+                  << memsize_in_MB(sizeof(ThreePhononElement), nelems_total) << std::endl;
+        std::cout << std::endl;
+    }
+
+    double ***symrot_k;
+    allocate(symrot_k, nk, 3, 3);
+    setup_kpoint_symmetry_rotations(symrot_k);
+
+    double **fvec, **fvec_new;
+    allocate(fvec, nks_total, 3);
+    allocate(fvec_new, nks_total, 3);
+
+    std::vector<double> tau(nks_total), occ(nk * ns);
+
+    for (unsigned int iT = 0; iT < ntemp; ++iT) {
+
+        const auto T = temperature[iT];
+
+        for (j = 0; j < 3; ++j) {
+            for (k = 0; k < 3; ++k) kappa[iT][j][k] = 0.0;
+        }
+        if (T < eps) continue;
+
+        // Occupation numbers on the full mesh, one table per temperature.
+        for (unsigned int ik = 0; ik < nk; ++ik) {
+            for (unsigned int is = 0; is < ns; ++is) {
+                const auto omega = eval[ik][is];
+                if (omega < eps8) {
+                    occ[ik * ns + is] = 0.0;
+                } else if (thermodynamics->classical) {
+                    occ[ik * ns + is] = thermodynamics->fC(omega, T);
+                } else {
+                    occ[ik * ns + is] = thermodynamics->fB(omega, T);
+                }
+            }
+        }
+
+        // RTA starting point: F = tau * v. Modes flagged with a huge
+        // gamma (imaginary frequencies, zero lifetime) stay at F = 0.
+        for (iks = 0; iks < nks_total; ++iks) {
+            const auto gamma = gamma_total[iks][iT];
+            if (gamma > 1.0e-100 && gamma < 1.0e+50) {
+                tau[iks] = 0.5 / gamma;
+            } else {
+                tau[iks] = 0.0;
+            }
+            const auto knum = kmesh->kpoint_irred_all[iks / ns][0].knum;
+            for (j = 0; j < 3; ++j) {
+                fvec[iks][j] = tau[iks] * vel[knum][iks % ns][j];
+            }
+        }
+
+        auto kappa_old = 0.0;
+        auto converged = false;
+        int icycle;
+
+        for (icycle = 0; icycle <= max_cycle; ++icycle) {
+
+            if (icycle > 0) {
+
+                for (iks = 0; iks < nks_total; ++iks) {
+                    for (j = 0; j < 3; ++j) fvec_new[iks][j] = 0.0;
+                }
 
-                if (temperature[i] < eps) {
-                    // Set kappa as zero when T = 0.
-                    for (is = 0; is < ns; ++is) {
-                        for (ik = 0; ik < nk_irred; ++ik) {
-                            kappa_mode[i][3 * j + k][is][ik] = 0.0;
+                for (i = 0; i < vks_iter.size(); ++i) {
+
+                    iks = vks_iter[i];
+                    if (tau[iks] == 0.0) continue;
+
+                    const auto knum = kmesh->kpoint_irred_all[iks / ns][0].knum;
+                    const auto snum = iks % ns;
+                    const auto omega1 = eval[knum][snum];
+
+                    const auto &elems = collision[i];
+                    const int nelem = elems.size();
+
+                    auto dx = 0.0;
+                    auto dy = 0.0;
+                    auto dz = 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+: dx, dy, dz)
+#endif
+                    for (int ielem = 0; ielem < nelem; ++ielem) {
+
+                        const auto &el = elems[ielem];
+
+                        const auto n2 = occ[el.k2 * ns + el.s2];
+                        const auto n3 = occ[el.k3 * ns + el.s3];
+
+                        const auto gamma_plus = prefactor_gamma * el.v3norm2
+                                                * (n2 - n3) * el.delta_absorb;
+                        const auto gamma_minus = prefactor_gamma * el.v3norm2
+                                                 * (n2 + n3 + 1.0) * el.delta_emit;
+
+                        const auto xi2 = eval[el.k2][el.s2] / omega1;
+                        const auto xi3 = eval[el.k3][el.s3] / omega1;
+
+                        const auto iks2 = kmesh->kmap_to_irreducible[el.k2] * ns + el.s2;
+                        const auto iks3 = kmesh->kmap_to_irreducible[el.k3] * ns + el.s3;
+
+                        for (auto mu = 0; mu < 3; ++mu) {
+                            const auto f2 = symrot_k[el.k2][mu][0] * fvec[iks2][0]
+                                            + symrot_k[el.k2][mu][1] * fvec[iks2][1]
+                                            + symrot_k[el.k2][mu][2] * fvec[iks2][2];
+                            const auto f3 = symrot_k[el.k3][mu][0] * fvec[iks3][0]
+                                            + symrot_k[el.k3][mu][1] * fvec[iks3][1]
+                                            + symrot_k[el.k3][mu][2] * fvec[iks3][2];
+
+                            const auto dval = gamma_plus * (xi3 * f3 - xi2 * f2)
+                                              + 0.5 * gamma_minus * (xi2 * f2 + xi3 * f3);
+
+                            if (mu == 0) dx += dval;
+                            else if (mu == 1) dy += dval;
+                            else dz += dval;
                         }
                     }
-                } else {
-                    for (is = 0; is < ns; ++is) {
-                        for (ik = 0; ik < nk_irred; ++ik) {
-                            const auto knum = kmesh_in->kpoint_irred_all[ik][0].knum;
-                            const auto omega = eval_in[knum][is];
-                            auto vv_tmp = 0.0;
-                            const auto nk_equiv = kmesh_in->kpoint_irred_all[ik].size();
 
-                            // Accumulate group velocity (diad product) for the reducible k points
-                            for (auto ieq = 0; ieq < nk_equiv; ++ieq) {
-                                const auto ktmp = kmesh_in->kpoint_irred_all[ik][ieq].knum;
-                                vv_tmp += vel[ktmp][is][j] * vel[ktmp][is][k];
-                            }
+                    fvec_new[iks][0] = tau[iks] * (vel[knum][snum][0] + dx);
+                    fvec_new[iks][1] = tau[iks] * (vel[knum][snum][1] + dy);
+                    fvec_new[iks][2] = tau[iks] * (vel[knum][snum][2] + dz);
+                }
 
-                            if (thermodynamics->classical) {
-                                kappa_mode[i][3 * j + k][is][ik]
-                                        = thermodynamics->Cv_classical(omega, temperature[i])
-                                          * vv_tmp * lifetime[ns * ik + is][i];
-                            } else {
-                                kappa_mode[i][3 * j + k][is][ik]
-                                        = thermodynamics->Cv(omega, temperature[i])
-                                          * vv_tmp * lifetime[ns * ik + is][i];
-                            }
+                MPI_Allreduce(&fvec_new[0][0], &fvec[0][0], nks_total * 3,
+                              MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            }
+
+            // kappa with the current F; every rank evaluates the same sum.
+            for (j = 0; j < 3; ++j) {
+                for (k = 0; k < 3; ++k) kappa[iT][j][k] = 0.0;
+            }
 
-                            // Convert to SI unit
-                            kappa_mode[i][3 * j + k][is][ik] *= factor_toSI;
+            for (iks = 0; iks < nks_total; ++iks) {
+                const auto knum0 = kmesh->kpoint_irred_all[iks / ns][0].knum;
+                const auto snum = iks % ns;
+                const auto omega = eval[knum0][snum];
+                if (omega < eps8) continue;
+
+                const auto cv = thermodynamics->classical
+                                ? thermodynamics->Cv_classical(omega, T)
+                                : thermodynamics->Cv(omega, T);
+
+                const auto nk_equiv = kmesh->kpoint_irred_all[iks / ns].size();
 
+                for (unsigned int ieq = 0; ieq < nk_equiv; ++ieq) {
+                    const auto ktmp = kmesh->kpoint_irred_all[iks / ns][ieq].knum;
+
+                    double frot[3];
+                    for (j = 0; j < 3; ++j) {
+                        frot[j] = symrot_k[ktmp][j][0] * fvec[iks][0]
+                                  + symrot_k[ktmp][j][1] * fvec[iks][1]
+                                  + symrot_k[ktmp][j][2] * fvec[iks][2];
+                    }
+                    for (j = 0; j < 3; ++j) {
+                        for (k = 0; k < 3; ++k) {
+                            kappa[iT][j][k] += cv * vel[ktmp][snum][j] * frot[k];
                         }
                     }
                 }
+            }
+
+            for (j = 0; j < 3; ++j) {
+                for (k = 0; k < 3; ++k) kappa[iT][j][k] *= common_factor;
+            }
+
+            const auto kappa_trace = (kappa[iT][0][0] + kappa[iT][1][1]
+                                      + kappa[iT][2][2]) / 3.0;
+
+            if (icycle > 0
+                && std::abs(kappa_trace - kappa_old) < conv_tol * std::abs(kappa_old)) {
+                converged = true;
+                break;
+            }
+            kappa_old = kappa_trace;
+        }
+
+        if (mympi->my_rank == 0) {
+            std::cout << " Temperature " << std::setw(9) << T << " [K] :";
+            if (converged) {
+                std::cout << " BTE converged in " << std::setw(4) << icycle
+                          << " iterations.";
+            } else {
+                std::cout << " BTE NOT converged within " << max_cycle
+                          << " iterations.";
+                warn("compute_kappa_iterative",
+                     "Iterative BTE did not converge. The last iterate is used.");
+            }
+            std::cout << " kappa_avg = " << std::setw(12)
+                      << (kappa[iT][0][0] + kappa[iT][1][1] + kappa[iT][2][2]) / 3.0
+                      << " [W/mK]" << std::endl;
+        }
+    }
+
+    deallocate(fvec);
+    deallocate(fvec_new);
+    deallocate(symrot_k);
+}
+
+void Conductivity::average_self_energy_at_degenerate_point(const int n,
+                                                           const int m,
+                                                           const KpointMeshUniform *kmesh_in,
+                                                           const DymatEigenValue *dymat_in,
+                                                           double **damping) const
+{
+    int j, k, l;
+    const auto nkr = kmesh_in->nk_irred;
+
+    double *damping_sum;
+
+    allocate(damping_sum, m);
+
+    for (auto i = 0; i < nkr; ++i) {
+        const auto ik = kmesh_in->kpoint_irred_all[i][0].knum;
+
+        // The group structure is detected once per stored spectrum and
+        // shared with the other consumers of the mesh eigenvalues.
+        const auto &degeneracy_at_k = dymat_in->get_degeneracy(ik);
+
+        int is = 0;
+        for (j = 0; j < degeneracy_at_k.size(); ++j) {
+            auto ideg = degeneracy_at_k[j];
 
-                kappa_intra[i][j][k] = 0.0;
+            if (ideg > 1) {
 
-                for (is = 0; is < ns; ++is) {
-                    for (ik = 0; ik < nk_irred; ++ik) {
-                        kappa_intra[i][j][k] += kappa_mode[i][3 * j + k][is][ik];
+                for (l = 0; l < m; ++l) damping_sum[l] = 0.0;
+
+                for (k = is; k < is + ideg; ++k) {
+                    for (l = 0; l < m; ++l) {
+                        damping_sum[l] += damping[ns * i + k][l];
                     }
                 }
 
-                kappa_intra[i][j][k] /= static_cast<double>(nk);
+                for (k = is; k < is + ideg; ++k) {
+                    for (l = 0; l < m; ++l) {
+                        damping[ns * i + k][l] = damping_sum[l] / static_cast<double>(ideg);
+                    }
+                }
             }
+
+            is += ideg;
         }
     }
+    deallocate(damping_sum);
+}
+
+void Conductivity::compute_kappa_intraband(const KpointMeshUniform *kmesh_in,
+                                           const double *const *eval_in,
+                                           const double *const *lifetime,
+                                           double ***kappa_intra,
+                                           double ***kappa_spec_out) const
+{
+    int i, is, ik;
+    const auto factor_toSI = 1.0e+18 / (std::pow(Bohr_in_Angstrom, 3) * system->volume_p);
+
+    const auto nk_irred = kmesh_in->nk_irred;
+
+    const int nmode = ns * nk_irred;
+
+    // 3x3 velocity outer products of each irreducible mode, accumulated
+    // over the star of the k point once instead of once per temperature
+    // and tensor component. The mode index im = is * nk_irred + ik, so
+    // the temperature loop below reduces to flat elementwise products.
+
+    double **vv_mode;
+    allocate(vv_mode, 9, nmode);
+
+#ifdef _OPENMP
+#pragma omp parallel for private(is, ik)
+#endif
+    for (int im = 0; im < nmode; ++im) {
+        is = im / nk_irred;
+        ik = im % nk_irred;
+
+        double vv_tmp[9];
+        for (auto jk = 0; jk < 9; ++jk) vv_tmp[jk] = 0.0;
+
+        const auto nk_equiv = kmesh_in->kpoint_irred_all[ik].size();
+        for (auto ieq = 0; ieq < nk_equiv; ++ieq) {
+            const auto ktmp = kmesh_in->kpoint_irred_all[ik][ieq].knum;
+            for (unsigned int j = 0; j < 3; ++j) {
+                for (unsigned int k = 0; k < 3; ++k) {
+                    vv_tmp[3 * j + k] += vel[ktmp][is][j] * vel[ktmp][is][k];
+                }
+            }
+        }
+        for (auto jk = 0; jk < 9; ++jk) vv_mode[jk][im] = vv_tmp[jk];
+    }
+
+    // Sparse, temperature-independent spectral weights of each mode:
+    // the (energy bin, delta weight) pairs with non-negligible weight.
+    // Building them once here lets the temperature loop bin each mode
+    // contribution into the kappa spectrum as it is computed, instead of
+    // re-walking all modes per energy bin in a second pass afterwards.
+    std::vector<std::vector<std::pair<int, double>>> bins_of_mode;
+
+    if (calc_kappa_spec && kappa_spec_out) {
+
+        std::cout << std::endl;
+        std::cout << " KAPPA_SPEC = 1 : Calculating thermal conductivity spectra ... ";
+
+        bins_of_mode.resize(nmode);
+
+        unsigned int *kmap_identity;
+        double **eval_kayser;
+        allocate(kmap_identity, nk);
+        allocate(eval_kayser, ns, nk);
+
+        for (i = 0; i < nk; ++i) kmap_identity[i] = i;
+        for (i = 0; i < nk; ++i) {
+            for (is = 0; is < ns; ++is) {
+                eval_kayser[is][i] = writes->in_kayser(eval_in[i][is]);
+            }
+        }
+
+        // Smearing weights never vanish exactly; drop entries below
+        // 1e-10 of the peak height so the lists stay short. Tetrahedron
+        // weights are exactly zero outside the containing tetrahedra.
+        const auto epsilon_kayser = integration->epsilon * Hz_to_kayser / time_ry;
+        const auto w_cutoff = 1.0e-10 / (epsilon_kayser * static_cast<double>(nk));
+
+        struct SpecEntry {
+            int im, ie;
+            double w;
+        };
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            double *weight;
+            allocate(weight, nk);
+            std::vector<SpecEntry> entries_loc;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int ie = 0; ie < dos->n_energy; ++ie) {
+                for (int js = 0; js < ns; ++js) {
+                    if (integration->ismear == -1) {
+                        integration->calc_weight_tetrahedron(nk, kmap_identity,
+                                                             eval_kayser[js], dos->energy_dos[ie],
+                                                             dos->tetra_nodes_dos->get_ntetra(),
+                                                             dos->tetra_nodes_dos->get_tetras(),
+                                                             weight);
+                    } else {
+                        integration->calc_weight_smearing(nk, nk, kmap_identity,
+                                                          eval_kayser[js], dos->energy_dos[ie],
+                                                          integration->ismear, weight);
+                    }
+                    for (int jk = 0; jk < nk_irred; ++jk) {
+                        const auto knum = kmesh_in->kpoint_irred_all[jk][0].knum;
+                        const auto wtmp = weight[knum];
+                        if (integration->ismear == -1 ? (wtmp == 0.0)
+                                                      : (std::abs(wtmp) < w_cutoff))
+                            continue;
+                        entries_loc.push_back(SpecEntry{js * static_cast<int>(nk_irred) + jk, ie, wtmp});
+                    }
+                }
+            }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+            {
+                for (const auto &e: entries_loc) {
+                    bins_of_mode[e.im].emplace_back(e.ie, e.w);
+                }
+            }
+            deallocate(weight);
+        }
+
+        deallocate(kmap_identity);
+        deallocate(eval_kayser);
+
+        for (int ie = 0; ie < dos->n_energy; ++ie) {
+            for (i = 0; i < ntemp; ++i) {
+                for (auto k = 0; k < 3; ++k) kappa_spec_out[ie][i][k] = 0.0;
+            }
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel private(i, is, ik)
+#endif
+    {
+        double *w;
+        allocate(w, nmode);
+
+        // schedule(static): consecutive temperatures per thread, so the
+        // strided lifetime[mode][i] reads reuse their cache lines.
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (i = 0; i < ntemp; ++i) {
+
+            if (temperature[i] < eps) {
+                // Set kappa as zero when T = 0.
+                for (auto jk = 0; jk < 9; ++jk) {
+                    kappa_intra[i][jk / 3][jk % 3] = 0.0;
+                }
+                continue;
+            }
+
+            // Mode-resolved weight Cv * tau, evaluated once per mode
+            // instead of once per tensor component.
+            for (int im = 0; im < nmode; ++im) {
+                is = im / nk_irred;
+                ik = im % nk_irred;
+                const auto knum = kmesh_in->kpoint_irred_all[ik][0].knum;
+                const auto omega = eval_in[knum][is];
+
+                if (thermodynamics->classical) {
+                    w[im] = thermodynamics->Cv_classical(omega, temperature[i])
+                            * lifetime[ns * ik + is][i] * factor_toSI;
+                } else {
+                    w[im] = thermodynamics->Cv(omega, temperature[i])
+                            * lifetime[ns * ik + is][i] * factor_toSI;
+                }
+            }
+
+            for (auto jk = 0; jk < 9; ++jk) {
+                const double *vvp = vv_mode[jk];
+                auto ksum = 0.0;
+
+#ifdef _OPENMP
+#pragma omp simd reduction(+:ksum)
+#endif
+                for (int im = 0; im < nmode; ++im) {
+                    ksum += w[im] * vvp[im];
+                }
+                kappa_intra[i][jk / 3][jk % 3] = ksum / static_cast<double>(nk);
+            }
+
+            // Fused spectral accumulation: each thread owns distinct
+            // temperatures i, so the histogram writes are race free.
+            if (calc_kappa_spec && kappa_spec_out) {
+                for (int im = 0; im < nmode; ++im) {
+                    const auto wim = w[im];
+                    if (wim == 0.0) continue;
+                    for (const auto &e: bins_of_mode[im]) {
+                        const auto ws = wim * e.second;
+                        kappa_spec_out[e.first][i][0] += ws * vv_mode[0][im];
+                        kappa_spec_out[e.first][i][1] += ws * vv_mode[4][im];
+                        kappa_spec_out[e.first][i][2] += ws * vv_mode[8][im];
+                    }
+                }
+            }
+        }
 
-    if (calc_kappa_spec) {
-        //allocate(kappa_spec_out, dos->n_energy, ntemp, 3);
-        compute_frequency_resolved_kappa(ntemp,
-                                         integration->ismear,
-                                         dos->kmesh_dos,
-                                         dos->dymat_dos->get_eigenvalues(),
-                                         kappa_mode,
-                                         kappa_spec_out);
+        deallocate(w);
     }
 
-    deallocate(kappa_mode);
+    deallocate(vv_mode);
+
+    if (calc_kappa_spec && kappa_spec_out) {
+        std::cout << " done!" << std::endl;
+    }
 }
 
 void Conductivity::compute_kappa_coherent(const KpointMeshUniform *kmesh_in,
@@ -647,11 +1928,74 @@ void Conductivity::compute_kappa_coherent(const KpointMeshUniform *kmesh_in,
     const auto common_factor_output = factor_toSI * 1.0e+12 * time_ry;
     const int ns2 = ns * ns;
     const auto czero = std::complex<double>(0.0, 0.0);
-    std::vector<std::complex<double>> kappa_tmp(ns2, czero);
     std::complex<double> **kappa_save = nullptr;
 
     const auto nk_irred = kmesh_in->nk_irred;
 
+    // Banded truncation of the band-pair sum. Only near-degenerate pairs
+    // contribute through the Lorentzian factor, so when KC_WINDOW > 0 a
+    // pair is kept only if |omega_s - omega_s'| does not exceed
+    // kc_window * (Gamma_s + Gamma_s'). The linewidths are maximized over
+    // the temperature grid so that the band is temperature independent,
+    // and the window is widened to the largest linewidth of each k point,
+    // which keeps the retained js range contiguous (the bands are sorted
+    // in frequency). This is a superset of the exact window: pairs are
+    // only ever added, never dropped.
+    int *band_lo, *band_hi;
+    allocate(band_lo, nk_irred * ns);
+    allocate(band_hi, nk_irred * ns);
+
+    if (kc_window > 0.0) {
+
+        double *gmax;
+        allocate(gmax, nk_irred * ns);
+
+        for (ib = 0; ib < nk_irred * ns; ++ib) {
+            auto gtmp = 0.0;
+            for (auto i = 0; i < ntemp; ++i) {
+                // Skip the 1e+100 sentinel of imaginary modes: their
+                // Lorentzian is vanishingly small anyway.
+                if (gamma_total[ib][i] < 1.0e+50) {
+                    gtmp = std::max(gtmp, gamma_total[ib][i]);
+                }
+            }
+            gmax[ib] = gtmp;
+        }
+
+        long npair_kept = 0;
+
+        for (auto ik = 0; ik < nk_irred; ++ik) {
+            const auto knum = kmesh_in->kpoint_irred_all[ik][0].knum;
+            auto gmax_k = 0.0;
+            for (auto is = 0; is < ns; ++is) {
+                gmax_k = std::max(gmax_k, gmax[ik * ns + is]);
+            }
+            for (auto is = 0; is < ns; ++is) {
+                const auto thr = kc_window * (gmax[ik * ns + is] + gmax_k);
+                const auto omega1 = eval_in[knum][is];
+                auto lo = is;
+                auto hi = is;
+                while (lo > 0 && std::abs(eval_in[knum][lo - 1] - omega1) <= thr) --lo;
+                while (hi < ns - 1 && std::abs(eval_in[knum][hi + 1] - omega1) <= thr) ++hi;
+                band_lo[ik * ns + is] = lo;
+                band_hi[ik * ns + is] = hi;
+                npair_kept += hi - lo;
+            }
+        }
+        deallocate(gmax);
+
+        std::cout << std::endl;
+        std::cout << " KC_WINDOW = " << kc_window << " : "
+                  << npair_kept << " of " << static_cast<long>(nk_irred) * ns * (ns - 1)
+                  << " band pairs retained in the coherent term." << std::endl;
+
+    } else {
+        for (ib = 0; ib < nk_irred * ns; ++ib) {
+            band_lo[ib] = 0;
+            band_hi[ib] = ns - 1;
+        }
+    }
+
     std::ofstream ofs;
     if (calc_coherent == 2) {
         ofs.open(file_coherent_elems.c_str(), std::ios::out);
@@ -668,52 +2012,82 @@ void Conductivity::compute_kappa_coherent(const KpointMeshUniform *kmesh_in,
                 kappa_coherent_out[i][j][k] = 0.0;
 
                 if (temperature[i] > eps) {
-#pragma omp parallel for
-                    for (ib = 0; ib < ns2; ++ib) {
-                        kappa_tmp[ib] = czero;
-                        const int is = ib / ns;
-                        const int js = ib % ns;
 
-                        if (js == is) continue; // skip the diagonal component
+                    if (calc_coherent == 2 && j == k) {
+                        // The banded loop below leaves the truncated pairs
+                        // untouched, so reset the element table first.
+                        for (ib = 0; ib < ns2; ++ib) {
+                            for (auto ik = 0; ik < nk_irred; ++ik) {
+                                kappa_save[ib][ik] = czero;
+                            }
+                        }
+                    }
 
+                    auto ksum = czero;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+                    {
+                        auto ksum_loc = czero;
+
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
                         for (auto ik = 0; ik < nk_irred; ++ik) {
                             const auto knum = kmesh_in->kpoint_irred_all[ik][0].knum;
-                            const auto omega1 = eval_in[knum][is];
-                            const auto omega2 = eval_in[knum][js];
-
-                            if (omega1 < eps8 || omega2 < eps8) continue;
-                            auto vv_tmp = czero;
                             const auto nk_equiv = kmesh_in->kpoint_irred_all[ik].size();
 
-                            // Accumulate group velocity (diad product) for the reducible k points
-                            for (auto ieq = 0; ieq < nk_equiv; ++ieq) {
-                                const auto ktmp = kmesh_in->kpoint_irred_all[ik][ieq].knum;
-                                vv_tmp += velmat[ktmp][is][js][j] * velmat[ktmp][js][is][k];
-                            }
-                            auto kcelem_tmp = 2.0 * (omega1 * omega2) / (omega1 + omega2)
-                                              * (thermodynamics->Cv(omega1, temperature[i]) / omega1
-                                                 + thermodynamics->Cv(omega2, temperature[i]) / omega2)
-                                              * 2.0 * (gamma_total[ik * ns + is][i] + gamma_total[ik * ns + js][i])
-                                              / (4.0 * std::pow(omega1 - omega2, 2.0)
-                                                 + 4.0 * std::pow(gamma_total[ik * ns + is][i]
-                                                                  + gamma_total[ik * ns + js][i], 2.0))
-                                              * vv_tmp;
-                            kappa_tmp[ib] += kcelem_tmp;
-
-                            if (calc_coherent == 2 && j == k) {
-                                kappa_save[ib][ik] = kcelem_tmp * common_factor_output;
+                            for (int is = 0; is < ns; ++is) {
+                                const auto omega1 = eval_in[knum][is];
+                                if (omega1 < eps8) continue;
+
+                                for (auto js = band_lo[ik * ns + is];
+                                     js <= band_hi[ik * ns + is]; ++js) {
+
+                                    if (js == is) continue; // skip the diagonal component
+
+                                    const auto omega2 = eval_in[knum][js];
+                                    if (omega2 < eps8) continue;
+
+                                    auto vv_tmp = czero;
+
+                                    // Accumulate group velocity (diad product) for the reducible k points
+                                    for (auto ieq = 0; ieq < nk_equiv; ++ieq) {
+                                        const auto ktmp = kmesh_in->kpoint_irred_all[ik][ieq].knum;
+                                        vv_tmp += velmat[ktmp][is][js][j] * velmat[ktmp][js][is][k];
+                                    }
+                                    auto kcelem_tmp = 2.0 * (omega1 * omega2) / (omega1 + omega2)
+                                                      * (thermodynamics->Cv(omega1, temperature[i]) / omega1
+                                                         + thermodynamics->Cv(omega2, temperature[i]) / omega2)
+                                                      * 2.0 * (gamma_total[ik * ns + is][i] + gamma_total[ik * ns + js][i])
+                                                      / (4.0 * std::pow(omega1 - omega2, 2.0)
+                                                         + 4.0 * std::pow(gamma_total[ik * ns + is][i]
+                                                                          + gamma_total[ik * ns + js][i], 2.0))
+                                                      * vv_tmp;
+                                    ksum_loc += kcelem_tmp;
+
+                                    if (calc_coherent == 2 && j == k) {
+                                        kappa_save[is * ns + js][ik] = kcelem_tmp * common_factor_output;
+                                    }
+                                }
                             }
-                        }
-                    } // end OpenMP parallelization over ib
+                        } // end OpenMP parallelization over ik
 
-                    for (ib = 0; ib < ns2; ++ib) {
-                        if (std::abs(kappa_tmp[ib].imag()) > eps10) {
-                            warn("compute_kappa_coherent",
-                                 "The kappa_coherent_out has imaginary component.");
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                        {
+                            ksum += ksum_loc;
                         }
-                        kappa_coherent_out[i][j][k] += kappa_tmp[ib].real();
                     }
 
+                    if (std::abs(ksum.imag()) > eps10) {
+                        warn("compute_kappa_coherent",
+                             "The kappa_coherent_out has imaginary component.");
+                    }
+                    kappa_coherent_out[i][j][k] = ksum.real();
+
                     if (calc_coherent == 2 && j == k) {
                         for (ib = 0; ib < ns2; ++ib) {
 
@@ -746,85 +2120,12 @@ void Conductivity::compute_kappa_coherent(const KpointMeshUniform *kmesh_in,
         }
     }
 
+    deallocate(band_lo);
+    deallocate(band_hi);
+
     if (calc_coherent == 2) {
         ofs.close();
         deallocate(kappa_save);
     }
 }
 
-void Conductivity::compute_frequency_resolved_kappa(const int ntemp,
-                                                    const int smearing_method,
-                                                    const KpointMeshUniform *kmesh_in,
-                                                    const double *const *eval_in,
-                                                    const double *const *const *const *kappa_mode,
-                                                    double ***kappa_spec_out) const
-{
-    int i, j;
-    unsigned int *kmap_identity;
-    double **eval;
-
-    std::cout << std::endl;
-    std::cout << " KAPPA_SPEC = 1 : Calculating thermal conductivity spectra ... ";
-
-    allocate(kmap_identity, nk);
-    allocate(eval, ns, nk);
-
-    for (i = 0; i < nk; ++i) kmap_identity[i] = i;
-
-    for (i = 0; i < nk; ++i) {
-        for (j = 0; j < ns; ++j) {
-            eval[j][i] = writes->in_kayser(eval_in[i][j]);
-        }
-    }
-
-#ifdef _OPENMP
-#pragma omp parallel private (j)
-#endif
-    {
-        int k;
-        int knum;
-        double *weight;
-        allocate(weight, nk);
-
-#ifdef _OPENMP
-#pragma omp for
-#endif
-        for (i = 0; i < dos->n_energy; ++i) {
-
-            for (j = 0; j < ntemp; ++j) {
-                for (k = 0; k < 3; ++k) {
-                    kappa_spec_out[i][j][k] = 0.0;
-                }
-            }
-
-            for (int is = 0; is < ns; ++is) {
-                if (smearing_method == -1) {
-                    integration->calc_weight_tetrahedron(nk, kmap_identity,
-                                                         eval[is], dos->energy_dos[i],
-                                                         dos->tetra_nodes_dos->get_ntetra(),
-                                                         dos->tetra_nodes_dos->get_tetras(),
-                                                         weight);
-                } else {
-                    integration->calc_weight_smearing(nk, nk, kmap_identity,
-                                                      eval[is], dos->energy_dos[i],
-                                                      smearing_method, weight);
-                }
-
-                for (j = 0; j < ntemp; ++j) {
-                    for (k = 0; k < 3; ++k) {
-                        for (int ik = 0; ik < kmesh_in->nk_irred; ++ik) {
-                            knum = kmesh_in->kpoint_irred_all[ik][0].knum;
-                            kappa_spec_out[i][j][k] += kappa_mode[j][3 * k + k][is][ik] * weight[knum];
-                        }
-                    }
-                }
-            }
-        }
-        deallocate(weight);
-    }
-
-    deallocate(kmap_identity);
-    deallocate(eval);
-
-    std::cout << " done!" << std::endl;
-}
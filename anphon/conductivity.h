@@ -12,11 +12,44 @@
 
 #include "pointers.h"
 #include "kpoint.h"
+#include <fstream>
+#include <string>
 #include <vector>
 #include <set>
 #include <complex>
 
 namespace PHON_NS {
+
+class DymatEigenValue;
+
+// One entry of the three-phonon collision operator of an irreducible mode
+// (k1, s1): the squared matrix element and the two energy-conserving delta
+// functions of the partner pair (k2, s2), (k3, s3) with -k1 + k2 + k3 = G.
+// Only pairs inside the smearing window are stored, so the operator is
+// sparse. Temperature enters through the occupation factors, which are
+// applied at iteration time, hence one store serves all temperatures.
+class ThreePhononElement {
+public:
+    unsigned int k2, k3;
+    unsigned int s2, s3;
+    double v3norm2;      // |V3(-k1 s1, k2 s2, k3 s3)|^2
+    double delta_emit;   // delta(omega1 - omega2 - omega3)
+    double delta_absorb; // delta(omega1 + omega2 - omega3)
+
+    ThreePhononElement() {};
+
+    ThreePhononElement(const unsigned int k2_in,
+                       const unsigned int k3_in,
+                       const unsigned int s2_in,
+                       const unsigned int s3_in,
+                       const double v3norm2_in,
+                       const double delta_emit_in,
+                       const double delta_absorb_in)
+            : k2(k2_in), k3(k3_in), s2(s2_in), s3(s3_in),
+              v3norm2(v3norm2_in), delta_emit(delta_emit_in),
+              delta_absorb(delta_absorb_in) {};
+};
+
 class Conductivity : protected Pointers {
 public:
     Conductivity(class PHON *);
@@ -39,6 +72,20 @@ public:
     double ***kappa_coherent;
     double *temperature;
     int calc_coherent;
+    int calc_iterative;
+
+    // Band-pair window of the coherent term: a pair (s, s') is evaluated
+    // only when |omega_s - omega_s'| <= kc_window * (Gamma_s + Gamma_s'),
+    // with the linewidths maximized over the temperature grid. 0 disables
+    // the truncation and the full ns^2 sum is taken.
+    double kc_window;
+    unsigned int nk_coarse[3];
+
+    // Group velocities on the full mesh in m/s (valid on the master rank).
+    const double *const *const *get_group_velocity_mesh() const
+    {
+        return vel;
+    }
 
 private:
     void set_default_variables();
@@ -48,29 +95,73 @@ private:
     double ***vel;
     std::complex<double> ****velmat;
     unsigned int nk, ns;
-    int nshift_restart;
     std::vector<int> vks_l, vks_done;
     std::set<int> vks_job;
     std::string file_coherent_elems;
 
-    void write_result_gamma(unsigned int,
-                            unsigned int,
-                            double ***,
-                            double **) const;
+    // Binary record-indexed restart file. Each irreducible mode owns a
+    // fixed-size record (1-byte done flag + ntemp gamma values) addressable
+    // by iks = ik * ns + is, so resuming is a bulk read instead of a
+    // line-by-line parse of the text .result file.
+    std::string file_result_bin;
+    mutable std::fstream fs_result_bin;
+
+    std::streamoff binary_record_offset(unsigned int iks) const;
+
+    bool load_restart_binary();
+
+    // Temperature-grid extension of a finished run: when the restart file
+    // covers a different temperature grid but the k mesh matches and every
+    // mode is done, the stored gamma values are reused at the overlapping
+    // temperature points and only the uncovered points (itemp_eval) are
+    // evaluated, skipping the triplet sweep for the reused ones.
+    bool load_restart_binary_extend();
+
+    bool restart_extend;
+    std::vector<unsigned int> itemp_eval;
+    std::vector<double> temperature_eval;
+
+    void init_restart_binary(bool fill_from_damping3);
+
+    void write_result_gamma_binary(unsigned int iks_g,
+                                   const double *damp_in) const;
+
+    void calc_anharmonic_imagself_static();
+
+    void calc_anharmonic_imagself_dynamic();
+
+    void calc_damping_mode(int iks,
+                           double *damping_out) const;
+
+    // Coarse-mesh screening path: linewidths are evaluated on the
+    // KMESH_COARSE grid only and log(gamma) is interpolated trilinearly
+    // onto the irreducible modes of the fine mesh.
+    void calc_anharmonic_imagself_coarse();
+
+    void interpolate_gamma_coarse(const KpointMeshUniform *kmesh_c,
+                                  const double *const *const *gamma_c);
+
+    // Iterative (full) solution of the linearized BTE. The collision
+    // elements of the locally owned irreducible modes are built once and
+    // the mean free displacements F are iterated to self-consistency,
+    // starting from the RTA solution.
+    void compute_kappa_iterative(const double *const *gamma_total);
+
+    void calc_collision_elements(unsigned int iks,
+                                 std::vector<ThreePhononElement> &elems) const;
+
+    void setup_kpoint_symmetry_rotations(double ***symrot_k) const;
+
+    void write_result_gamma_each(unsigned int iks_g,
+                                 double ***vel_in,
+                                 const double *damp_in) const;
 
     void average_self_energy_at_degenerate_point(const int n,
                                                  const int m,
                                                  const KpointMeshUniform *kmesh_in,
-                                                 const double *const *eval_in,
+                                                 const DymatEigenValue *dymat_in,
                                                  double **damping) const;
 
-    void compute_frequency_resolved_kappa(const int ntemp,
-                                          const int smearing_method,
-                                          const KpointMeshUniform *kmesh_in,
-                                          const double *const *eval_in,
-                                          const double *const *const *const *kappa_mode,
-                                          double ***kappa_spec_out) const;
-
     void compute_kappa_intraband(const KpointMeshUniform *kmesh_in,
                                  const double *const *eval_in,
                                  const double *const *lifetime,
@@ -25,6 +25,7 @@
 #include <iomanip>
 #include <vector>
 #include <complex>
+#include <omp.h>
 
 using namespace PHON_NS;
 
@@ -219,24 +220,90 @@ void Dielec::compute_dielectric_function(const unsigned int nomega_in,
         }
     }
 
-    auto freq_conv_factor = time_ry * time_ry / (Hz_to_kayser * Hz_to_kayser);
-    auto factor = 8.0 * pi / system->volume_p;
-    double w2_tmp;
+    const auto freq_conv_factor = time_ry * time_ry / (Hz_to_kayser * Hz_to_kayser);
+    const auto factor = 8.0 * pi / system->volume_p;
+
+    double *w2_grid;
+    allocate(w2_grid, nomega_in);
     for (auto iomega = 0; iomega < nomega_in; ++iomega) {
-        w2_tmp = omega_grid_in[iomega] * omega_grid_in[iomega] * freq_conv_factor;
+        w2_grid[iomega] = omega_grid_in[iomega] * omega_grid_in[iomega] * freq_conv_factor;
+    }
 
-        for (auto i = 0; i < 3; ++i) {
-            for (auto j = 0; j < 3; ++j) {
-                dielec_out[iomega][i][j] = 0.0;
+    // The numerator s_born is frequency independent, so the mode loop is
+    // the outermost one: each mode performs a single division per frequency
+    // point followed by a rank-1 update of the 3x3 tensor over the whole
+    // frequency grid. The modes are distributed over OpenMP threads with
+    // per-thread accumulators reduced at the end.
+    double *acc_private = nullptr;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+#ifdef _OPENMP
+        const int nthreads = omp_get_num_threads();
+        const int ithread = omp_get_thread_num();
+#else
+        const int nthreads = 1;
+        const int ithread = 0;
+#endif
+
+#ifdef _OPENMP
+#pragma omp single
+#endif
+        {
+            allocate(acc_private, static_cast<size_t>(nthreads) * 9 * nomega_in);
+            for (size_t i = 0; i < static_cast<size_t>(nthreads) * 9 * nomega_in; ++i) {
+                acc_private[i] = 0.0;
+            }
+        }
 
-                for (auto is = 3; is < ns; ++is) {
-                    dielec_out[iomega][i][j] += s_born[i][j][is] / (eval_in[is] - w2_tmp);
+        double *inv_denom;
+        allocate(inv_denom, nomega_in);
+
+        auto acc = acc_private + static_cast<size_t>(ithread) * 9 * nomega_in;
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (int is = 3; is < ns; ++is) {
+
+            const auto eval_is = eval_in[is];
+            for (auto iomega = 0; iomega < nomega_in; ++iomega) {
+                inv_denom[iomega] = 1.0 / (eval_is - w2_grid[iomega]);
+            }
+
+            for (auto i = 0; i < 3; ++i) {
+                for (auto j = 0; j < 3; ++j) {
+                    const auto sij = s_born[i][j][is];
+                    auto acc_ij = acc + (3 * i + j) * nomega_in;
+                    for (auto iomega = 0; iomega < nomega_in; ++iomega) {
+                        acc_ij[iomega] += sij * inv_denom[iomega];
+                    }
+                }
+            }
+        }
+        deallocate(inv_denom);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (auto iomega = 0; iomega < nomega_in; ++iomega) {
+            for (auto i = 0; i < 3; ++i) {
+                for (auto j = 0; j < 3; ++j) {
+                    auto sum_tmp = 0.0;
+                    for (int it = 0; it < nthreads; ++it) {
+                        sum_tmp += acc_private[(static_cast<size_t>(it) * 9
+                                                + 3 * i + j) * nomega_in + iomega];
+                    }
+                    dielec_out[iomega][i][j] = factor * sum_tmp;
                 }
-                dielec_out[iomega][i][j] *= factor;
             }
         }
     }
 
+    deallocate(acc_private);
+    deallocate(w2_grid);
     deallocate(zstar_u);
     deallocate(s_born);
 }
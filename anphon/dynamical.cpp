@@ -21,7 +21,11 @@
 #include "symmetry_core.h"
 #include "mathfunctions.h"
 #include "fcs_phonon.h"
+#include "parsephon.h"
+#include "phonon_velocity.h"
 #include "write_phonons.h"
+#include "gruneisen.h"
+#include "thermodynamics.h"
 #include <complex>
 #include <vector>
 #include <iostream>
@@ -57,6 +61,7 @@ void Dynamical::set_default_variables()
     na_sigma = 0.0;
     file_born = "";
     UPLO = 'U';
+    batchsize_eval = 64;
 
     index_bconnect = nullptr;
     borncharge = nullptr;
@@ -104,6 +109,7 @@ void DymatEigenValue::set_eigenvalues(const unsigned int n,
                 eval[i][j] = eval_in[i][j];
             }
         }
+        degeneracy_map.clear();
     } else {
         exit("set_eigenvalues", "the number of kpoint is larger than the one"
                                 "used in the constructor.");
@@ -121,13 +127,18 @@ void DymatEigenValue::set_eigenvectors(const unsigned int n,
         exit("set_eigenvectors", "the number of kpoint is larger than "
                                  "the one used in the constructor.");
     }
-    for (unsigned int i = 0; i < n; ++i) {
-        for (unsigned int j = 0; j < ns; ++j) {
-            for (unsigned int k = 0; k < ns; ++k) {
-                evec[i][j][k] = evec_in[i][j][k];
+    // When the storage lives in a shared window, only the first rank of
+    // each node writes; the others see the data after the synchronization.
+    if (win_evec == MPI_WIN_NULL || my_rank_shared == 0) {
+        for (unsigned int i = 0; i < n; ++i) {
+            for (unsigned int j = 0; j < ns; ++j) {
+                for (unsigned int k = 0; k < ns; ++k) {
+                    evec[i][j][k] = evec_in[i][j][k];
+                }
             }
         }
     }
+    if (win_evec != MPI_WIN_NULL) sync_shared_storage();
 }
 
 void DymatEigenValue::set_eigenvals_and_eigenvecs(const unsigned int n,
@@ -145,11 +156,83 @@ double **DymatEigenValue::get_eigenvalues() const
     return this->eval;
 }
 
+void DymatEigenValue::create_shared_storage()
+{
+    // One copy of the eigenvectors per node: the first rank of each node
+    // allocates the whole array inside an MPI-3 shared memory window and
+    // the other ranks map it through MPI_Win_shared_query. The window is
+    // kept inside a passive access epoch for its whole lifetime, so the
+    // readers access the data with plain loads.
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                        MPI_INFO_NULL, &comm_shared);
+    MPI_Comm_rank(comm_shared, &my_rank_shared);
+
+    const auto nelems = static_cast<MPI_Aint>(nk) * ns * ns;
+    const MPI_Aint size_local
+            = (my_rank_shared == 0) ? nelems * sizeof(std::complex<double>) : 0;
+
+    std::complex<double> *baseptr = nullptr;
+
+    MPI_Win_allocate_shared(size_local, sizeof(std::complex<double>),
+                            MPI_INFO_NULL, comm_shared, &baseptr, &win_evec);
+
+    if (my_rank_shared != 0) {
+        MPI_Aint size_tmp;
+        int disp_unit;
+        MPI_Win_shared_query(win_evec, 0, &size_tmp, &disp_unit, &baseptr);
+    }
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win_evec);
+
+    // Build the usual pointer tree on top of the shared buffer so that the
+    // users of get_eigenvectors() need not know about the window.
+    evec = new std::complex<double> **[nk];
+    evec[0] = new std::complex<double> *[static_cast<std::size_t>(nk) * ns];
+    for (unsigned int i = 0; i < nk; ++i) {
+        evec[i] = evec[0] + static_cast<std::size_t>(i) * ns;
+        for (unsigned int j = 0; j < ns; ++j) {
+            evec[i][j] = baseptr + (static_cast<std::size_t>(i) * ns + j) * ns;
+        }
+    }
+}
+
+void DymatEigenValue::free_shared_storage()
+{
+    delete[] evec[0];
+    delete[] evec;
+    evec = nullptr;
+
+    MPI_Win_unlock_all(win_evec);
+    MPI_Win_free(&win_evec);
+    MPI_Comm_free(&comm_shared);
+}
+
+void DymatEigenValue::sync_shared_storage() const
+{
+    // Make the writes of the node leader visible to the other ranks.
+    MPI_Win_sync(win_evec);
+    MPI_Barrier(comm_shared);
+    MPI_Win_sync(win_evec);
+}
+
 std::complex<double> ***DymatEigenValue::get_eigenvectors() const
 {
     return this->evec;
 }
 
+const std::vector<int> &DymatEigenValue::get_degeneracy(const unsigned int ik) const
+{
+    if (degeneracy_map.empty()) {
+        const auto tol_omega = 1.0e-7; // Approximately equal to 0.01 cm^{-1}
+        degeneracy_map.resize(nk);
+        for (unsigned int i = 0; i < nk; ++i) {
+            Dynamical::detect_degeneracy(eval[i], ns, tol_omega, degeneracy_map[i]);
+        }
+    }
+    return degeneracy_map[ik];
+}
+
 void Dynamical::setup_dynamical()
 {
     neval = 3 * system->natmin;
@@ -219,6 +302,22 @@ void Dynamical::setup_dynamical()
     MPI_Bcast(&eigenvectors, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&nonanalytic, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
     MPI_Bcast(&band_connection, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&eval_server, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+
+    // Populate the eigenvector requirement registry of the dense mesh.
+    // RTA and SCPH always consume the mesh eigenvectors through the
+    // anharmonic kernels; in MODE = phonons they are needed only when
+    // one of the requested outputs reads them. Dos registers its own
+    // flags in Dos::setup(); Gruneisen initializes only after the
+    // diagonalization, so its requirement is registered here.
+    if (phon->mode != "PHONONS") require_mesh_eigenvectors();
+    if (print_eigenvectors || participation_ratio
+        || !projection_directions.empty()) {
+        require_mesh_eigenvectors();
+    }
+    if (writes->uses_mesh_eigenvectors()) require_mesh_eigenvectors();
+    if (gruneisen->print_gruneisen || gruneisen->print_newfcs) require_mesh_eigenvectors();
+    if (thermodynamics->calc_FE_bubble) require_mesh_eigenvectors();
 
     if (kpoint->kpoint_bs) {
         dymat_band = new DymatEigenValue(eigenvectors,
@@ -264,6 +363,12 @@ void Dynamical::setup_dynamical()
         prepare_mindist_list(mindist_list);
     }
 
+    // Hoist the k-independent part of the harmonic force constants out of
+    // the per-k dynamical-matrix assembly.
+    if (!fcs_phonon->fc2_ext.empty()) {
+        prepare_fc2_table(fcs_phonon->fc2_ext);
+    }
+
     if (mympi->my_rank == 0) {
         std::cout << std::endl;
         std::cout << " -----------------------------------------------------------------"
@@ -276,21 +381,31 @@ void Dynamical::prepare_mindist_list(std::vector<int> **mindist_out) const
     unsigned int i, j;
     const unsigned int nneib = 27;
 
-    double ***xcrd;
+    double **xcart;
+    double **xshift;
+    double dist_cell[nneib];
 
     const auto nat = system->nat;
     const auto natmin = system->natmin;
 
-    std::vector<DistWithCell> **distall;
+    // Distances are taken between the cell-0 Cartesian coordinates and a
+    // precomputed table of the 27 lattice-translation vectors, so only the
+    // nat coordinates are kept in memory instead of all 27 periodic
+    // images, and the per-pair sorted distance list is replaced by a
+    // direct scan for the minimum-distance images.
 
-    allocate(distall, natmin, nat);
-    allocate(xcrd, nneib, nat, 3);
+    allocate(xcart, nat, 3);
+    allocate(xshift, nneib, 3);
 
     for (i = 0; i < nat; ++i) {
         for (j = 0; j < 3; ++j) {
-            xcrd[0][i][j] = system->xr_s[i][j];
+            xcart[i][j] = system->xr_s[i][j];
         }
+        rotvec(xcart[i], xcart[i], system->lavec_s);
     }
+
+    for (j = 0; j < 3; ++j) xshift[0][j] = 0.0;
+
     auto icell = 0;
     for (auto isize = -1; isize <= 1; ++isize) {
         for (auto jsize = -1; jsize <= 1; ++jsize) {
@@ -299,51 +414,50 @@ void Dynamical::prepare_mindist_list(std::vector<int> **mindist_out) const
                 if (isize == 0 && jsize == 0 && ksize == 0) continue;
 
                 ++icell;
-                for (i = 0; i < nat; ++i) {
-                    xcrd[icell][i][0] = system->xr_s[i][0] + static_cast<double>(isize);
-                    xcrd[icell][i][1] = system->xr_s[i][1] + static_cast<double>(jsize);
-                    xcrd[icell][i][2] = system->xr_s[i][2] + static_cast<double>(ksize);
-                }
+                xshift[icell][0] = static_cast<double>(isize);
+                xshift[icell][1] = static_cast<double>(jsize);
+                xshift[icell][2] = static_cast<double>(ksize);
+                rotvec(xshift[icell], xshift[icell], system->lavec_s);
             }
         }
     }
 
-    for (icell = 0; icell < nneib; ++icell) {
-        for (i = 0; i < nat; ++i) {
-            rotvec(xcrd[icell][i], xcrd[icell][i], system->lavec_s);
-        }
-    }
+    // Construct pairs of minimum distance.
 
     for (i = 0; i < natmin; ++i) {
         const auto iat = system->map_p2s[i][0];
         for (j = 0; j < nat; ++j) {
-            distall[i][j].clear();
-            for (icell = 0; icell < nneib; ++icell) {
 
-                double dist_tmp = distance(xcrd[0][iat], xcrd[icell][j]);
-                distall[i][j].emplace_back(icell, dist_tmp);
+            const auto dx0 = xcart[iat][0] - xcart[j][0];
+            const auto dy0 = xcart[iat][1] - xcart[j][1];
+            const auto dz0 = xcart[iat][2] - xcart[j][2];
+
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (unsigned int ic = 0; ic < nneib; ++ic) {
+                const auto dx = dx0 - xshift[ic][0];
+                const auto dy = dy0 - xshift[ic][1];
+                const auto dz = dz0 - xshift[ic][2];
+                dist_cell[ic] = std::sqrt(dx * dx + dy * dy + dz * dz);
             }
-            std::sort(distall[i][j].begin(), distall[i][j].end());
-        }
-    }
 
-    // Construct pairs of minimum distance.
+            auto dist_min = dist_cell[0];
+            for (unsigned int ic = 1; ic < nneib; ++ic) {
+                dist_min = std::min(dist_min, dist_cell[ic]);
+            }
 
-    for (i = 0; i < natmin; ++i) {
-        for (j = 0; j < nat; ++j) {
             mindist_out[i][j].clear();
-
-            const auto dist_min = distall[i][j][0].dist;
-            for (auto it = distall[i][j].begin(); it != distall[i][j].end(); ++it) {
-                if (std::abs((*it).dist - dist_min) < 1.0e-3) {
-                    mindist_out[i][j].push_back((*it).cell);
+            for (unsigned int ic = 0; ic < nneib; ++ic) {
+                if (dist_cell[ic] < dist_min + 1.0e-3) {
+                    mindist_out[i][j].push_back(static_cast<int>(ic));
                 }
             }
         }
     }
 
-    deallocate(distall);
-    deallocate(xcrd);
+    deallocate(xcart);
+    deallocate(xshift);
 }
 
 double Dynamical::distance(double *x1,
@@ -354,19 +468,16 @@ double Dynamical::distance(double *x1,
                      + std::pow(x1[2] - x2[2], 2));
 }
 
-void Dynamical::eval_k(const double *xk_in,
-                       const double *kvec_in,
-                       const std::vector<FcsClassExtent> &fc2_ext,
-                       double *eval_out,
-                       std::complex<double> **evec_out,
-                       const bool require_evec) const
+void Dynamical::assemble_dymat_k(const double *xk_in,
+                                 const double *kvec_in,
+                                 const std::vector<FcsClassExtent> &fc2_ext,
+                                 std::complex<double> **dymat_k) const
 {
-    // Calculate phonon energy for the specific k-point given in fractional basis
+    // Assemble the dynamical matrix at the given k point, including the
+    // non-analytic correction (except for the Ewald scheme, which is
+    // handled by eval_k_ewald).
 
     unsigned int i, j;
-    std::complex<double> **dymat_k;
-
-    allocate(dymat_k, neval, neval);
 
     calc_analytic_k(xk_in, fc2_ext, dymat_k);
 
@@ -405,6 +516,23 @@ void Dynamical::eval_k(const double *xk_in,
             }
         }
     }
+}
+
+void Dynamical::eval_k(const double *xk_in,
+                       const double *kvec_in,
+                       const std::vector<FcsClassExtent> &fc2_ext,
+                       double *eval_out,
+                       std::complex<double> **evec_out,
+                       const bool require_evec) const
+{
+    // Calculate phonon energy for the specific k-point given in fractional basis
+
+    unsigned int i, j;
+    std::complex<double> **dymat_k;
+
+    allocate(dymat_k, neval, neval);
+
+    assemble_dymat_k(xk_in, kvec_in, fc2_ext, dymat_k);
 
     char JOBZ;
     int INFO;
@@ -436,6 +564,7 @@ void Dynamical::eval_k(const double *xk_in,
     }
 
     // Perform diagonalization
+    count_event(EVENT_ZHEEV);
     zheev_(&JOBZ, &UPLO, &n, amat, &n, eval_out, WORK, &LWORK, RWORK, &INFO);
 
     if (eigenvectors && require_evec) {
@@ -539,6 +668,7 @@ void Dynamical::eval_k_ewald(const double *xk_in,
     }
 
     // Perform diagonalization
+    count_event(EVENT_ZHEEV);
     zheev_(&JOBZ, &UPLO, &n, amat, &n, eval_out, WORK, &LWORK, RWORK, &INFO);
 
     if (eigenvectors && require_evec) {
@@ -571,6 +701,26 @@ void Dynamical::calc_analytic_k(const double *xk_in,
         }
     }
 
+    // Fast path for lists registered with prepare_fc2_table: only the dot
+    // product and the complex exponential depend on the k point. The
+    // owner's generation stamp guards against a list rebuilt since
+    // registration.
+
+    const auto it_table = analytic_k_table.find(&fc2_in);
+    unsigned long generation_now;
+
+    if (it_table != analytic_k_table.end()
+        && lookup_fc2_generation(fc2_in, generation_now)
+        && it_table->second.generation == generation_now
+        && it_table->second.entries.size() == fc2_in.size()) {
+
+        for (const auto &it: it_table->second.entries) {
+            const auto phase = it.vec[0] * xk_in[0] + it.vec[1] * xk_in[1] + it.vec[2] * xk_in[2];
+            dymat_out[it.row][it.col] += it.val * std::exp(im * phase);
+        }
+        return;
+    }
+
     for (const auto &it: fc2_in) {
 
         const auto atm1_p = it.atm1;
@@ -597,27 +747,86 @@ void Dynamical::calc_analytic_k(const double *xk_in,
     }
 }
 
-void Dynamical::calc_nonanalytic_k(const double *xk_in,
-                                   const double *kvec_na_in,
-                                   std::complex<double> **dymat_na_out) const
+bool Dynamical::lookup_fc2_generation(const std::vector<FcsClassExtent> &fc2_in,
+                                      unsigned long &generation_out) const
 {
-    // Calculate the non-analytic part of dynamical matrices
-    // by Parlinski's method.
+    if (&fc2_in == &fcs_phonon->fc2_ext) {
+        generation_out = fcs_phonon->fc2_ext_generation;
+        return true;
+    }
+    if (ewald && &fc2_in == &ewald->fc2_without_dipole) {
+        generation_out = ewald->fc2_without_dipole_generation;
+        return true;
+    }
+    return false;
+}
+
+void Dynamical::prepare_fc2_table(const std::vector<FcsClassExtent> &fc2_in)
+{
+    unsigned long generation_now;
+
+    if (!lookup_fc2_generation(fc2_in, generation_now)) {
+        // No owner to report a rebuild of this list; without that signal
+        // the cached entries cannot be trusted, so the list stays on the
+        // direct path.
+        analytic_k_table.erase(&fc2_in);
+        return;
+    }
+
+    auto &table = analytic_k_table[&fc2_in];
+
+    table.generation = generation_now;
+    table.entries.clear();
+    table.entries.reserve(fc2_in.size());
+
+    double vec[3];
+    AnalyticKEntry entry;
+
+    for (const auto &it: fc2_in) {
+
+        const auto atm1_s = system->map_p2s[it.atm1][0];
+        const auto atm2_p = system->map_s2p[it.atm2].atom_num;
 
+        for (auto i = 0; i < 3; ++i) {
+            vec[i] = system->xr_s[it.atm2][i] + xshift_s[it.cell_s][i]
+                     - system->xr_s[system->map_p2s[atm2_p][0]][i];
+        }
+
+        rotvec(vec, vec, system->lavec_s);
+        rotvec(vec, vec, system->rlavec_p);
+
+        entry.row = 3 * it.atm1 + it.xyz1;
+        entry.col = 3 * atm2_p + it.xyz2;
+        for (auto i = 0; i < 3; ++i) entry.vec[i] = vec[i];
+        entry.val = it.fcs_val / std::sqrt(system->mass[atm1_s] * system->mass[it.atm2]);
+
+        table.entries.push_back(entry);
+    }
+}
+
+const double *Dynamical::get_nonanalytic_numerator(const double *kvec_na_in) const
+{
     unsigned int i, j;
     unsigned int iat, jat;
     const auto natmin = system->natmin;
     double kepsilon[3];
     double kz1[3], kz2[3];
     double born_tmp[3][3];
-    double xk_tmp[3], xdiff[3];
 
-    for (i = 0; i < neval; ++i) {
-        for (j = 0; j < neval; ++j) {
-            dymat_na_out[i][j] = std::complex<double>(0.0, 0.0);
-        }
+    long key[3];
+    for (i = 0; i < 3; ++i) {
+        key[i] = std::lround(kvec_na_in[i] * 1.0e+9);
+    }
+
+    if (na_direction_cache_valid
+        && key[0] == na_direction_key[0]
+        && key[1] == na_direction_key[1]
+        && key[2] == na_direction_key[2]) {
+        return na_direction_cache.data();
     }
 
+    na_direction_cache.assign(static_cast<size_t>(neval) * neval, 0.0);
+
     rotvec(kepsilon, kvec_na_in, dielec);
     const auto denom = kvec_na_in[0] * kepsilon[0]
                        + kvec_na_in[1] * kepsilon[1]
@@ -650,7 +859,7 @@ void Dynamical::calc_nonanalytic_k(const double *xk_in,
                 for (i = 0; i < 3; ++i) {
                     for (j = 0; j < 3; ++j) {
 
-                        dymat_na_out[3 * iat + i][3 * jat + j]
+                        na_direction_cache[(3 * iat + i) * neval + 3 * jat + j]
                                 = kz1[i] * kz2[j] / (denom * std::sqrt(system->mass[atm_p1] * system->mass[atm_p2]));
 
                     }
@@ -658,6 +867,33 @@ void Dynamical::calc_nonanalytic_k(const double *xk_in,
             }
         }
     }
+
+    for (i = 0; i < 3; ++i) na_direction_key[i] = key[i];
+    na_direction_cache_valid = true;
+
+    return na_direction_cache.data();
+}
+
+void Dynamical::calc_nonanalytic_k(const double *xk_in,
+                                   const double *kvec_na_in,
+                                   std::complex<double> **dymat_na_out) const
+{
+    // Calculate the non-analytic part of dynamical matrices
+    // by Parlinski's method.
+
+    unsigned int i, j;
+    unsigned int iat, jat;
+    const auto natmin = system->natmin;
+    double xk_tmp[3], xdiff[3];
+
+    const auto numerator = get_nonanalytic_numerator(kvec_na_in);
+
+    for (i = 0; i < neval; ++i) {
+        for (j = 0; j < neval; ++j) {
+            dymat_na_out[i][j] = numerator[i * neval + j];
+        }
+    }
+
     // Move input xk back to the -0.5 <= xk < 0.5 range to
     // make the phonon dispersion periodic in the reciprocal lattice.
     for (i = 0; i < 3; ++i) {
@@ -709,8 +945,6 @@ void Dynamical::calc_nonanalytic_k2(const double *xk_in,
     unsigned int i, j;
     unsigned int natmin = system->natmin;
     double kepsilon[3];
-    double kz1[3], kz2[3];
-    double born_tmp[3][3];
     double vec[3];
 
     for (i = 0; i < neval; ++i) {
@@ -726,28 +960,13 @@ void Dynamical::calc_nonanalytic_k2(const double *xk_in,
 
     if (denom > eps) {
 
-        for (unsigned int iat = 0; iat < natmin; ++iat) {
-            unsigned int atm_p1 = system->map_p2s[iat][0];
+        const auto numerator = get_nonanalytic_numerator(kvec_na_in);
 
-            for (i = 0; i < 3; ++i) {
-                for (j = 0; j < 3; ++j) {
-                    born_tmp[i][j] = borncharge[iat][i][j];
-                }
-            }
-
-            rotvec(kz1, kvec_na_in, born_tmp, 'T');
+        for (unsigned int iat = 0; iat < natmin; ++iat) {
 
             for (unsigned int jat = 0; jat < natmin; ++jat) {
                 unsigned int atm_p2 = system->map_p2s[jat][0];
 
-                for (i = 0; i < 3; ++i) {
-                    for (j = 0; j < 3; ++j) {
-                        born_tmp[i][j] = borncharge[jat][i][j];
-                    }
-                }
-
-                rotvec(kz2, kvec_na_in, born_tmp, 'T');
-
                 std::complex<double> exp_phase = std::complex<double>(0.0, 0.0);
 
                 for (i = 0; i < system->ntran; ++i) {
@@ -779,8 +998,7 @@ void Dynamical::calc_nonanalytic_k2(const double *xk_in,
                 for (i = 0; i < 3; ++i) {
                     for (j = 0; j < 3; ++j) {
                         dymat_na_out[3 * iat + i][3 * jat + j]
-                                = kz1[i] * kz2[j] / (denom * std::sqrt(system->mass[atm_p1] * system->mass[atm_p2]))
-                                  * exp_phase;
+                                = numerator[(3 * iat + i) * neval + 3 * jat + j] * exp_phase;
                     }
                 }
             }
@@ -796,6 +1014,16 @@ void Dynamical::calc_nonanalytic_k2(const double *xk_in,
     }
 }
 
+void Dynamical::require_mesh_eigenvectors()
+{
+    evec_needed_mesh = true;
+}
+
+bool Dynamical::mesh_eigenvectors_required() const
+{
+    return evec_needed_mesh;
+}
+
 void Dynamical::diagonalize_dynamical_all()
 {
     unsigned int nk;
@@ -896,7 +1124,7 @@ void Dynamical::diagonalize_dynamical_all()
     if (dos->kmesh_dos) {
         nk = dos->kmesh_dos->nk;
         allocate(eval_tmp, nk, neval);
-        if (eigenvectors) {
+        if (evec_needed_mesh) {
             allocate(evec_tmp, nk, neval, neval);
         } else {
             allocate(evec_tmp, nk, 1, 1);
@@ -906,7 +1134,7 @@ void Dynamical::diagonalize_dynamical_all()
                               dos->kmesh_dos->kvec_na,
                               fcs_phonon->fc2_ext,
                               ewald->fc2_without_dipole,
-                              eigenvectors,
+                              evec_needed_mesh,
                               eval_tmp,
                               evec_tmp);
 
@@ -950,6 +1178,155 @@ void Dynamical::diagonalize_dynamical_all()
     }
 }
 
+void Dynamical::run_eval_server()
+{
+    // Streamed evaluation service for workflows that issue many small
+    // eval_k queries against one force-constant set. The expensive setup
+    // (XML load, symmetry, mindist tables) has already been paid in
+    // setup_base; here batches of k points are read from standard input
+    // and answered until the stream ends, instead of relaunching anphon
+    // per query.
+    //
+    // Protocol, per batch: rank 0 reads an integer n followed by 3n
+    // fractional coordinates (text, whitespace separated); n <= 0 or EOF
+    // ends the session. The reply is appended to PREFIX.evalk as n binary
+    // records of (3 + 4*neval) doubles: the k point as given, the neval
+    // phonon frequencies in cm^-1, and the neval Cartesian group
+    // velocities (x, y, z per band) in m/s. After each batch the file is
+    // flushed and "OK n" is printed to standard output as the
+    // acknowledgment the client should wait for.
+
+    const auto ns = neval;
+    const auto Ry_to_SI_vel = Bohr_in_Angstrom * 1.0e-10 / time_ry;
+
+    std::ofstream ofs_bin;
+
+    if (mympi->my_rank == 0) {
+        const auto file_evalk = input->job_title + ".evalk";
+        ofs_bin.open(file_evalk.c_str(), std::ios::out | std::ios::binary);
+        if (!ofs_bin) {
+            exit("run_eval_server", "cannot open file PREFIX.evalk");
+        }
+
+        std::cout << std::endl;
+        std::cout << " EVALK_SERVER = 1: entering the streamed evaluation mode." << std::endl;
+        std::cout << " Reading k-point batches from standard input;" << std::endl;
+        std::cout << " binary records are appended to " << file_evalk << "." << std::endl;
+        std::cout << std::endl;
+    }
+
+    double **xk_batch = nullptr;
+    double **kvec_batch = nullptr;
+    double **eval_batch = nullptr;
+    std::complex<double> ***evec_dummy = nullptr;
+    double **vel;
+    unsigned int nbatch_max = 0;
+
+    allocate(vel, ns, 3);
+
+    for (;;) {
+
+        int nbatch = 0;
+
+        if (mympi->my_rank == 0) {
+            if (!(std::cin >> nbatch)) nbatch = 0;
+        }
+        MPI_Bcast(&nbatch, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+        if (nbatch <= 0) break;
+
+        if (static_cast<unsigned int>(nbatch) > nbatch_max) {
+            if (xk_batch) {
+                deallocate(xk_batch);
+                deallocate(kvec_batch);
+                deallocate(eval_batch);
+                deallocate(evec_dummy);
+            }
+            nbatch_max = nbatch;
+            allocate(xk_batch, nbatch_max, 3);
+            allocate(kvec_batch, nbatch_max, 3);
+            allocate(eval_batch, nbatch_max, ns);
+            allocate(evec_dummy, nbatch_max, 1, 1);
+        }
+
+        if (mympi->my_rank == 0) {
+            for (auto ik = 0; ik < nbatch; ++ik) {
+                for (auto j = 0; j < 3; ++j) {
+                    if (!(std::cin >> xk_batch[ik][j])) {
+                        exit("run_eval_server",
+                             "unexpected end of the k-point stream.");
+                    }
+                }
+            }
+        }
+        MPI_Bcast(&xk_batch[0][0], 3 * nbatch, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+        for (auto ik = 0; ik < nbatch; ++ik) {
+            for (auto j = 0; j < 3; ++j) kvec_batch[ik][j] = xk_batch[ik][j];
+            rotvec(&kvec_batch[ik][0], &kvec_batch[ik][0], system->rlavec_p, 'T');
+            const auto norm = kvec_batch[ik][0] * kvec_batch[ik][0]
+                              + kvec_batch[ik][1] * kvec_batch[ik][1]
+                              + kvec_batch[ik][2] * kvec_batch[ik][2];
+            if (norm > eps) {
+                for (auto j = 0; j < 3; ++j) kvec_batch[ik][j] /= std::sqrt(norm);
+            }
+        }
+
+        get_eigenvalues_dymat(nbatch,
+                              xk_batch,
+                              kvec_batch,
+                              fcs_phonon->fc2_ext,
+                              ewald->fc2_without_dipole,
+                              false,
+                              eval_batch,
+                              evec_dummy);
+
+        if (mympi->my_rank == 0) {
+
+            for (auto ik = 0; ik < nbatch; ++ik) {
+
+                phonon_velocity->phonon_vel_k_analytic(&xk_batch[ik][0], vel);
+
+                ofs_bin.write(reinterpret_cast<const char *>(&xk_batch[ik][0]),
+                              3 * sizeof(double));
+
+                for (auto is = 0; is < ns; ++is) {
+                    const auto omega_tmp = writes->in_kayser(eval_batch[ik][is]);
+                    ofs_bin.write(reinterpret_cast<const char *>(&omega_tmp),
+                                  sizeof(double));
+                }
+
+                for (auto is = 0; is < ns; ++is) {
+                    rotvec(vel[is], vel[is], system->lavec_p);
+                    for (auto j = 0; j < 3; ++j) {
+                        const auto vel_tmp = vel[is][j] * Ry_to_SI_vel / (2.0 * pi);
+                        ofs_bin.write(reinterpret_cast<const char *>(&vel_tmp),
+                                      sizeof(double));
+                    }
+                }
+            }
+
+            ofs_bin.flush();
+            std::cout << "OK " << nbatch << std::endl;
+        }
+    }
+
+    deallocate(vel);
+    if (xk_batch) {
+        deallocate(xk_batch);
+        deallocate(kvec_batch);
+        deallocate(eval_batch);
+        deallocate(evec_dummy);
+    }
+
+    if (mympi->my_rank == 0) {
+        ofs_bin.close();
+        std::cout << std::endl
+                  << " End of the k-point stream. Leaving the evaluation mode."
+                  << std::endl;
+    }
+}
+
 void Dynamical::get_eigenvalues_dymat(const unsigned int nk_in,
                                       const double *const *xk_in,
                                       const double *const *kvec_na_in,
@@ -964,30 +1341,116 @@ void Dynamical::get_eigenvalues_dymat(const unsigned int nk_in,
              "The number of k points must be larger than 0.");
     }
 
-    // Calculate phonon eigenvalues and eigenvectors for all k-points
+    if (nonanalytic == 3) {
+        // The Ewald correction assembles its own lattice sums per k point;
+        // keep the original one-point-at-a-time path here.
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-    for (int ik = 0; ik < nk_in; ++ik) {
-        if (nonanalytic == 3) {
+        for (int ik = 0; ik < nk_in; ++ik) {
             eval_k_ewald(&xk_in[ik][0],
                          &kvec_na_in[ik][0],
                          fc2_without_dipole_in,
                          eval_ret[ik],
                          evec_ret[ik],
                          require_evec);
+            // Phonon energy is the square-root of the eigenvalue
+            for (unsigned int is = 0; is < neval; ++is) {
+                eval_ret[ik][is] = freq(eval_ret[ik][is]);
+            }
+        }
+        return;
+    }
+
+    // Batched evaluation: the dynamical matrices of batchsize_eval k
+    // points are assembled back to back in one contiguous buffer and then
+    // handed to the eigensolver, with the scratch arrays allocated once
+    // per thread. This removes the per-k-point allocations of eval_k and
+    // keeps the solver working on a warm block of memory.
+
+    const int nblk = static_cast<int>(std::max(1u, batchsize_eval));
+    const int nk_tot = static_cast<int>(nk_in);
+    const int nblock_tot = (nk_tot + nblk - 1) / nblk;
+    const auto ns2 = neval * neval;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        unsigned int i, j, m;
+        int n = neval;
+        int LWORK = (2 * neval - 1) * 10;
+        int INFO;
+        char JOBZ;
+
+        std::complex<double> **dymat_k;
+        std::complex<double> *amat_batch, *WORK;
+        double *RWORK;
+
+        allocate(dymat_k, neval, neval);
+        allocate(amat_batch, nblk * ns2);
+        allocate(WORK, LWORK);
+        allocate(RWORK, 3 * neval - 2);
+
+        if (require_evec) {
+            JOBZ = 'V';
         } else {
-            eval_k(&xk_in[ik][0],
-                   &kvec_na_in[ik][0],
-                   fc2_ext_in,
-                   eval_ret[ik],
-                   evec_ret[ik],
-                   require_evec);
+            JOBZ = 'N';
         }
-        // Phonon energy is the square-root of the eigenvalue
-        for (unsigned int is = 0; is < neval; ++is) {
-            eval_ret[ik][is] = freq(eval_ret[ik][is]);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int iblk = 0; iblk < nblock_tot; ++iblk) {
+
+            const auto ik_begin = iblk * nblk;
+            const auto ik_end = std::min(ik_begin + nblk, nk_tot);
+
+            for (auto ik = ik_begin; ik < ik_end; ++ik) {
+                assemble_dymat_k(&xk_in[ik][0],
+                                 &kvec_na_in[ik][0],
+                                 fc2_ext_in,
+                                 dymat_k);
+
+                auto *amat = amat_batch + (ik - ik_begin) * ns2;
+                m = 0;
+                for (j = 0; j < neval; ++j) {
+                    for (i = 0; i < neval; ++i) {
+                        amat[m++] = dymat_k[i][j];
+                    }
+                }
+            }
+
+            for (auto ik = ik_begin; ik < ik_end; ++ik) {
+
+                auto *amat = amat_batch + (ik - ik_begin) * ns2;
+
+                count_event(EVENT_ZHEEV);
+                zheev_(&JOBZ, &UPLO, &n, amat, &n, eval_ret[ik],
+                       WORK, &LWORK, RWORK, &INFO);
+
+                if (eigenvectors && require_evec) {
+                    m = 0;
+                    // Transpose so that evec_ret[ik][i] is the eigenvector
+                    // of the i-th mode, as in eval_k.
+                    for (j = 0; j < neval; ++j) {
+                        for (i = 0; i < neval; ++i) {
+                            evec_ret[ik][j][i] = amat[m++];
+                        }
+                    }
+                }
+
+                // Phonon energy is the square-root of the eigenvalue
+                for (i = 0; i < neval; ++i) {
+                    eval_ret[ik][i] = freq(eval_ret[ik][i]);
+                }
+            }
         }
+
+        deallocate(dymat_k);
+        deallocate(amat_batch);
+        deallocate(WORK);
+        deallocate(RWORK);
     }
 }
 
@@ -1050,6 +1513,30 @@ void Dynamical::modify_eigenvectors() const
     //}
 }
 
+void Dynamical::detect_degeneracy(const double *eval_in,
+                                  const unsigned int ns_in,
+                                  const double tol,
+                                  std::vector<int> &degeneracy_out)
+{
+    degeneracy_out.clear();
+
+    auto omega_prev = eval_in[0];
+    auto ideg = 1;
+
+    for (unsigned int i = 1; i < ns_in; ++i) {
+        const auto omega_now = eval_in[i];
+
+        if (std::abs(omega_now - omega_prev) < tol) {
+            ++ideg;
+        } else {
+            degeneracy_out.push_back(ideg);
+            ideg = 1;
+            omega_prev = omega_now;
+        }
+    }
+    degeneracy_out.push_back(ideg);
+}
+
 void Dynamical::project_degenerate_eigenvectors(const double lavec_p[3][3],
                                                 const std::vector<FcsClassExtent> &fc2_ext_in,
                                                 double *xk_in,
@@ -1062,24 +1549,29 @@ void Dynamical::project_degenerate_eigenvectors(const double lavec_p[3][3],
     //
     // The projector is given in the real space Cartesian coordinate.
     // Let's transform the basis into the crystal coordinate and normalize the norm to unity.
+    // The transformed set depends only on the input directions and the
+    // lattice, so it is built once and reused for every k point.
     //
-    std::vector<std::vector<double>> directions;
-    std::vector<double> vec(3);
-    for (const auto &it: project_directions) {
-        for (i = 0; i < 3; ++i) {
-            vec[i] = it[i];
-        }
-        rotvec(&vec[0], &vec[0], lavec_p, 'T');
+    if (projection_directions_normalized.size() != project_directions.size()) {
+        projection_directions_normalized.clear();
+        std::vector<double> vec(3);
+        for (const auto &it: project_directions) {
+            for (i = 0; i < 3; ++i) {
+                vec[i] = it[i];
+            }
+            rotvec(&vec[0], &vec[0], lavec_p, 'T');
 
-        auto norm = 0.0;
-        for (i = 0; i < 3; ++i) {
-            norm += vec[i] * vec[i];
-        }
-        norm = std::sqrt(norm);
-        for (i = 0; i < 3; ++i) vec[i] = vec[i] / norm;
+            auto norm = 0.0;
+            for (i = 0; i < 3; ++i) {
+                norm += vec[i] * vec[i];
+            }
+            norm = std::sqrt(norm);
+            for (i = 0; i < 3; ++i) vec[i] = vec[i] / norm;
 
-        directions.push_back(vec);
+            projection_directions_normalized.push_back(vec);
+        }
     }
+    const auto &directions = projection_directions_normalized;
 
     //
     // Diagonalize dymat at xk_in and get degeneracy information.
@@ -1122,23 +1614,7 @@ void Dynamical::project_degenerate_eigenvectors(const double lavec_p[3][3],
     const double tol_omega = 1.0e-14; // Approximately equal to (0.01 cm^{-1})^2
 
     std::vector<int> degeneracy_at_k;
-
-    degeneracy_at_k.clear();
-    double omega_prev = eval_orig[0];
-    int ideg = 1;
-
-    for (j = 1; j < ns; ++j) {
-        double omega_now = eval_orig[j];
-
-        if (std::abs(omega_now - omega_prev) < tol_omega) {
-            ++ideg;
-        } else {
-            degeneracy_at_k.push_back(ideg);
-            ideg = 1;
-            omega_prev = omega_now;
-        }
-    }
-    degeneracy_at_k.push_back(ideg);
+    detect_degeneracy(eval_orig.data(), static_cast<unsigned int>(ns), tol_omega, degeneracy_at_k);
 
     const auto ndirec = directions.size();
 
@@ -1562,12 +2038,23 @@ void Dynamical::calc_participation_ratio_all(const unsigned int nk_in,
     const auto ns = dynamical->neval;
     const auto natmin = system->natmin;
 
-    double *atomic_pr;
+    // The (k, band) evaluations are independent; distribute them over
+    // OpenMP threads with per-thread scratch for the atomic ratios.
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double *atomic_pr;
+        allocate(atomic_pr, natmin);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (long ib = 0; ib < static_cast<long>(nk_in) * ns; ++ib) {
 
-    allocate(atomic_pr, natmin);
+            const auto ik = ib / ns;
+            const auto is = ib % ns;
 
-    for (auto ik = 0; ik < nk_in; ++ik) {
-        for (auto is = 0; is < ns; ++is) {
             calc_atomic_participation_ratio(evec_in[ik][is], atomic_pr);
 
             auto sum = 0.0;
@@ -1579,9 +2066,48 @@ void Dynamical::calc_participation_ratio_all(const unsigned int nk_in,
 
             ret[ik][is] = sum * sum;
         }
+        deallocate(atomic_pr);
     }
+}
+
+void Dynamical::calc_participation_ratio_irred(const KpointMeshUniform *kmesh_in,
+                                               const std::complex<double> *const *const *evec_in,
+                                               double **ret,
+                                               double ***ret_all) const
+{
+    const auto ns = neval;
+    const auto natmin = system->natmin;
+    const auto nk_irred = kmesh_in->nk_irred;
 
-    deallocate(atomic_pr);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        double *atomic_pr;
+        allocate(atomic_pr, natmin);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for (long ib = 0; ib < static_cast<long>(nk_irred) * ns; ++ib) {
+
+            const auto ik = ib / ns;
+            const auto is = ib % ns;
+            const auto knum = kmesh_in->kpoint_irred_all[ik][0].knum;
+
+            calc_atomic_participation_ratio(evec_in[knum][is], atomic_pr);
+
+            auto sum = 0.0;
+
+            for (auto iat = 0; iat < natmin; ++iat) {
+                sum += atomic_pr[iat];
+                ret_all[ik][is][iat] = atomic_pr[iat];
+            }
+
+            ret[ik][is] = sum * sum;
+        }
+        deallocate(atomic_pr);
+    }
 }
 
 void Dynamical::calc_atomic_participation_ratio(const std::complex<double> *evec_in,
@@ -1614,11 +2140,16 @@ void Dynamical::connect_band_by_eigen_similarity(const unsigned int nk_in,
     const auto ns = neval;
     std::vector<int> index;
     std::complex<double> **evec_tmp;
+    std::complex<double> *overlap;
     std::vector<std::vector<double>> abs_similarity;
-    std::complex<double> dprod;
     std::vector<int> found;
 
+    int ns_int = static_cast<int>(ns);
+    auto alpha = std::complex<double>(1.0, 0.0);
+    auto beta = std::complex<double>(0.0, 0.0);
+
     allocate(evec_tmp, ns, ns);
+    allocate(overlap, ns * ns);
 
     for (ik = 0; ik < nk_in; ++ik) {
         for (is = 0; is < ns; ++is) {
@@ -1648,16 +2179,17 @@ void Dynamical::connect_band_by_eigen_similarity(const unsigned int nk_in,
                 }
             }
         } else {
-#ifdef _OPENMP
-#pragma omp parallel for private(js, dprod)
-#endif
+            // Overlap matrix <e_is(k)|e_js(k-1)> of the whole band pair in
+            // one ZGEMM call. The eigenvectors are stored row-wise in
+            // contiguous ns x ns blocks, which BLAS sees as column-major
+            // matrices with the component index running fastest.
+            zgemm_("C", "N", &ns_int, &ns_int, &ns_int, &alpha,
+                   &evec[ik][0][0], &ns_int, &evec_tmp[0][0], &ns_int,
+                   &beta, overlap, &ns_int);
+
             for (is = 0; is < ns; ++is) {
                 for (js = 0; js < ns; ++js) {
-                    dprod = std::complex<double>(0.0, 0.0);
-                    for (int ks = 0; ks < ns; ++ks) {
-                        dprod += std::conj(evec[ik][is][ks]) * evec_tmp[js][ks];
-                    }
-                    abs_similarity[is][js] = std::abs(dprod);
+                    abs_similarity[is][js] = std::abs(overlap[is + ns * js]);
                 }
             }
         }
@@ -1690,6 +2222,7 @@ void Dynamical::connect_band_by_eigen_similarity(const unsigned int nk_in,
 
     }
     deallocate(evec_tmp);
+    deallocate(overlap);
 }
 
 void Dynamical::detect_imaginary_branches(const KpointMeshUniform &kmesh_in,
@@ -10,10 +10,19 @@
 
 #pragma once
 
+#ifdef _WIN32
+#include <mpi.h>
+#else
+
+#include "mpi.h"
+
+#endif
+
 #include "pointers.h"
 #include "fcs_phonon.h"
 #include "kpoint.h"
 #include "memory.h"
+#include <map>
 #include <vector>
 #include <complex>
 #include <string>
@@ -42,26 +51,48 @@ public:
     DymatEigenValue() : nk(0), ns(0), eval(nullptr), evec(nullptr),
                         is_stored_eigvec(true), is_irreducible_only(false) {};
 
+    // When window_shared_ is set, the eigenvector array is placed in an
+    // MPI-3 shared memory window, so the ranks of one node share a single
+    // copy instead of holding one copy each. The constructor is then
+    // collective over MPI_COMM_WORLD.
+    //
+    // The node-shared window is as far as the storage can be distributed
+    // with the current consumers: the self-energy and conductivity loops
+    // index the stored array at k, k', and -k-k' of every triplet from
+    // inside tight OpenMP regions, i.e. random access over the whole mesh
+    // per mode. Splitting the mesh across nodes would turn each of those
+    // reads into a one-sided fetch in the innermost loop; until the
+    // triplet loops are restructured around k-blocks, a cross-node
+    // distribution is not implementable here.
     DymatEigenValue(const bool stored_eigvec_,
                     const bool store_irreducible_only_,
                     const unsigned int nk_in,
-                    const unsigned int ns_in) : nk(nk_in), ns(ns_in),
-                                                is_stored_eigvec(stored_eigvec_),
-                                                is_irreducible_only(store_irreducible_only_)
+                    const unsigned int ns_in,
+                    const bool window_shared_ = false) : nk(nk_in), ns(ns_in),
+                                                         is_stored_eigvec(stored_eigvec_),
+                                                         is_irreducible_only(store_irreducible_only_)
     {
         if (eval) deallocate(eval);
         if (evec) deallocate(evec);
 
         allocate(eval, nk_in, ns_in);
         if (is_stored_eigvec) {
-            allocate(evec, nk_in, ns_in, ns_in);
+            if (window_shared_) {
+                create_shared_storage();
+            } else {
+                allocate_first_touch(evec, nk_in, ns_in, ns_in);
+            }
         }
     };
 
     ~DymatEigenValue()
     {
         if (eval) deallocate(eval);
-        if (evec) deallocate(evec);
+        if (win_evec != MPI_WIN_NULL) {
+            free_shared_storage();
+        } else if (evec) {
+            deallocate(evec);
+        }
     };
 
     void set_eigenvalues(const unsigned int n,
@@ -78,12 +109,31 @@ public:
 
     std::complex<double> ***get_eigenvectors() const;
 
+    // Compact degeneracy map of a stored k point: the sizes of the groups
+    // of consecutive eigenvalues equal within tolerance, in band order.
+    // The map of the whole mesh is built once on first access and shared
+    // by every consumer of the stored spectrum; it is discarded whenever
+    // new eigenvalues are stored.
+    const std::vector<int> &get_degeneracy(const unsigned int ik) const;
+
 private:
     unsigned int nk, ns;
     double **eval = nullptr;
     std::complex<double> ***evec = nullptr;
     bool is_stored_eigvec = true;
     bool is_irreducible_only = false;
+
+    mutable std::vector<std::vector<int>> degeneracy_map;
+
+    MPI_Comm comm_shared = MPI_COMM_NULL;
+    MPI_Win win_evec = MPI_WIN_NULL;
+    int my_rank_shared = 0;
+
+    void create_shared_storage();
+
+    void free_shared_storage();
+
+    void sync_shared_storage() const;
 };
 
 class Dynamical : protected Pointers {
@@ -93,6 +143,9 @@ public:
     ~Dynamical();
 
     unsigned int neval{};
+    // Number of dynamical matrices assembled contiguously per eigensolver
+    // block in get_eigenvalues_dymat.
+    unsigned int batchsize_eval{};
     bool eigenvectors{};
     bool print_eigenvectors{};
     unsigned int symmetrize_borncharge{};
@@ -113,8 +166,26 @@ public:
 
     void diagonalize_dynamical_all();
 
+    // When true (EVALK_SERVER tag), MODE = phonons turns into a streamed
+    // evaluation service after the setup: batches of arbitrary k points
+    // are read from standard input and answered with eigenvalues and
+    // group velocities in binary until the stream ends, so the one-time
+    // cost of loading the force constants is amortized over the session.
+    bool eval_server{};
+
+    void run_eval_server();
+
     void setup_dynamical();
 
+    // Registry of the eigenvector requirement on the dense (DOS) k mesh.
+    // Modules consuming the stored mesh eigenvectors register during
+    // setup; when nobody does, the mesh is diagonalized with
+    // zheev_('N', ...), which is considerably faster and skips the
+    // ns x ns storage per k point.
+    void require_mesh_eigenvectors();
+
+    bool mesh_eigenvectors_required() const;
+
     void setup_dielectric(const unsigned int verbosity = 1);
 
     void eval_k(const double *,
@@ -142,14 +213,39 @@ public:
                                       double **ret,
                                       double ***ret_all) const;
 
+    // Variant evaluated only at the representative k point of each
+    // irreducible class; ret and ret_all are sized by nk_irred instead
+    // of the full mesh.
+    void calc_participation_ratio_irred(const KpointMeshUniform *kmesh_in,
+                                        const std::complex<double> *const *const *evec_in,
+                                        double **ret,
+                                        double ***ret_all) const;
+
     void calc_analytic_k(const double *,
                          const std::vector<FcsClassExtent> &,
                          std::complex<double> **) const;
 
+    // Precompute the k-independent part of every entry of fc2_in (row and
+    // column in the dynamical matrix, the phase vector, and the
+    // mass-normalized value), so calc_analytic_k reduces to one dot
+    // product and complex exponential per entry. The table is read-only
+    // after registration and therefore safe to use from threaded k loops.
+    // Only lists with a generation-stamped owner (see
+    // lookup_fc2_generation) are registered; others keep the direct path.
+    void prepare_fc2_table(const std::vector<FcsClassExtent> &fc2_in);
+
     void calc_nonanalytic_k(const double *,
                             const double *,
                             std::complex<double> **) const;
 
+    // Direction-dependent numerator (Z q)(Z q)^T / (q.eps.q sqrt(m_i m_j))
+    // of the nonanalytic correction, cached under the quantized unit
+    // direction q-hat. Band paths and interpolation loops evaluate long
+    // runs of k points sharing a few directions, so the Born-charge outer
+    // products are rebuilt only when the direction changes. Not thread
+    // safe; call outside OpenMP parallel regions.
+    const double *get_nonanalytic_numerator(const double *kvec_na_in) const;
+
     void calc_nonanalytic_k2(const double *,
                              const double *,
                              std::complex<double> **) const;
@@ -160,11 +256,65 @@ public:
                                          const std::vector<std::vector<double>> &project_directions,
                                          std::complex<double> **evec_out) const;
 
+    // Group sizes of consecutive eigenvalues equal within tol, in band
+    // order. Shared detection kernel of the degeneracy bookkeeping in
+    // the group-velocity, SCPH and self-energy averaging paths.
+    static void detect_degeneracy(const double *eval_in,
+                                  const unsigned int ns_in,
+                                  const double tol,
+                                  std::vector<int> &degeneracy_out);
+
     std::vector<std::vector<double>> get_projection_directions() const;
 
     void set_projection_directions(const std::vector<std::vector<double>> projections_in);
 
+    void get_eigenvalues_dymat(const unsigned int nk_in,
+                               const double *const *xk_in,
+                               const double *const *kvec_na_in,
+                               const std::vector<FcsClassExtent> &fc2_ext_in,
+                               const std::vector<FcsClassExtent> &fc2_without_dipole_in,
+                               const bool require_evec,
+                               double **eval_ret,
+                               std::complex<double> ***evec_ret);
+
 private:
+    bool evec_needed_mesh = false;
+
+    // Projection directions transformed into the crystal coordinate and
+    // normalized, built once by project_degenerate_eigenvectors and
+    // reused for every k point.
+    mutable std::vector<std::vector<double>> projection_directions_normalized;
+
+    // Storage of get_nonanalytic_numerator(): the numerator matrix of the
+    // last queried direction and its quantized key.
+    mutable std::vector<double> na_direction_cache;
+    mutable long na_direction_key[3] = {0, 0, 0};
+    mutable bool na_direction_cache_valid = false;
+
+    struct AnalyticKEntry {
+        int row, col;
+        double vec[3];
+        double val;
+    };
+
+    struct AnalyticKTable {
+        unsigned long generation = 0;
+        std::vector<AnalyticKEntry> entries;
+    };
+
+    // Tables registered by prepare_fc2_table, keyed by the owning list.
+    // A table is served only while the owner's generation stamp still
+    // equals the one recorded at registration, so a list rebuilt in place
+    // (or a new list reusing the address of a dead one) drops back to the
+    // direct path instead of being read from stale entries.
+    std::map<const std::vector<FcsClassExtent> *, AnalyticKTable> analytic_k_table;
+
+    // Current generation stamp of the known FC2 lists (fcs_phonon->fc2_ext
+    // and ewald->fc2_without_dipole). Returns false for a list without a
+    // stamped owner; such lists are never served from the table.
+    bool lookup_fc2_generation(const std::vector<FcsClassExtent> &fc2_in,
+                               unsigned long &generation_out) const;
+
     void set_default_variables();
 
     void deallocate_variables();
@@ -174,6 +324,11 @@ private:
 
     void prepare_mindist_list(std::vector<int> **) const;
 
+    void assemble_dymat_k(const double *xk_in,
+                          const double *kvec_in,
+                          const std::vector<FcsClassExtent> &fc2_ext,
+                          std::complex<double> **dymat_k) const;
+
     void calc_atomic_participation_ratio(const std::complex<double> *evec_in,
                                          double *ret) const;
 
@@ -187,15 +342,6 @@ private:
     void detect_imaginary_branches(const KpointMeshUniform &kmesh_in,
                                    double **eval_in);
 
-    void get_eigenvalues_dymat(const unsigned int nk_in,
-                               const double *const *xk_in,
-                               const double *const *kvec_na_in,
-                               const std::vector<FcsClassExtent> &fc2_ext_in,
-                               const std::vector<FcsClassExtent> &fc2_without_dipole_in,
-                               const bool require_evec,
-                               double **eval_ret,
-                               std::complex<double> ***evec_ret);
-
     std::vector<std::vector<double>> projection_directions;
 
     int transform_eigenvectors(double *xk_in,
@@ -19,6 +19,7 @@
 #include "memory.h"
 #include "parsephon.h"
 #include "system.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -49,6 +50,7 @@ void Ewald::set_default_variables()
     Born_charge = nullptr;
     distall_ewald = nullptr;
     force_permutation_sym = true;
+    fc2_without_dipole_generation = 0;
 }
 
 void Ewald::deallocate_variables()
@@ -89,7 +91,12 @@ void Ewald::init()
 
         prepare_Ewald(dynamical->dielec);
         prepare_G();
+        prepare_longrange_cache();
         compute_ewald_fcs();
+
+        // The dipole-free list is consumed by calc_analytic_k at every
+        // interpolated k point, so register it for the precomputed path.
+        dynamical->prepare_fc2_table(fc2_without_dipole);
     }
 }
 
@@ -292,67 +299,88 @@ void Ewald::get_pairs_of_minimum_distance(const int nat,
                                           const int nsize[3],
                                           double **xf) const
 {
-    // Get pairs and multiplicities
+    // Get pairs and multiplicities.
+    //
+    // The distances are evaluated from the cell-0 Cartesian coordinates
+    // and a precomputed table of lattice-translation vectors instead of
+    // materializing every atom in every image cell, which kept an
+    // O(nat * ncell) coordinate array alive. Only the minimum-distance
+    // images of each pair are stored in distall_ewald; the consumers
+    // (compute_ewald_fcs and the reciprocal-space sums) never read past
+    // the first multiplicity entries of the old sorted list.
 
-    int icell = 0;
-    int iat, jat;
-    double dist_tmp;
-    double ***xcrd; // fractional coordinate
+    int iat;
+    double **xcart;
+    double **xshift;
 
-    int ncell = (2 * nsize[0] + 1) * (2 * nsize[1] + 1) * (2 * nsize[2] + 1);
+    const int ncell = (2 * nsize[0] + 1) * (2 * nsize[1] + 1) * (2 * nsize[2] + 1);
 
-    allocate(xcrd, ncell, nat, 3);
+    allocate(xcart, nat, 3);
+    allocate(xshift, ncell, 3);
 
     for (iat = 0; iat < nat; ++iat) {
         for (int icrd = 0; icrd < 3; ++icrd) {
-            xcrd[0][iat][icrd] = xf[iat][icrd];
+            xcart[iat][icrd] = xf[iat][icrd];
         }
-        rotvec(xcrd[0][iat], xcrd[0][iat], system->lavec_s);
+        rotvec(xcart[iat], xcart[iat], system->lavec_s);
     }
 
+    for (int icrd = 0; icrd < 3; ++icrd) xshift[0][icrd] = 0.0;
+
+    int icell = 0;
     for (int isize = -nsize[0]; isize <= nsize[0]; ++isize) {
         for (int jsize = -nsize[1]; jsize <= nsize[1]; ++jsize) {
             for (int ksize = -nsize[2]; ksize <= nsize[2]; ++ksize) {
                 if (isize == 0 && jsize == 0 && ksize == 0) continue;
                 ++icell;
-                for (iat = 0; iat < nat; ++iat) {
-                    xcrd[icell][iat][0] = xf[iat][0] + static_cast<double>(isize);
-                    xcrd[icell][iat][1] = xf[iat][1] + static_cast<double>(jsize);
-                    xcrd[icell][iat][2] = xf[iat][2] + static_cast<double>(ksize);
-                    rotvec(xcrd[icell][iat], xcrd[icell][iat], system->lavec_s);
-                }
-
+                xshift[icell][0] = static_cast<double>(isize);
+                xshift[icell][1] = static_cast<double>(jsize);
+                xshift[icell][2] = static_cast<double>(ksize);
+                rotvec(xshift[icell], xshift[icell], system->lavec_s);
             }
         }
     }
 
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
     for (iat = 0; iat < nat; ++iat) {
-        for (jat = 0; jat < nat; ++jat) {
-            for (icell = 0; icell < ncell; ++icell) {
-                dist_tmp = std::sqrt(std::pow(xcrd[0][iat][0] - xcrd[icell][jat][0], 2.0)
-                                     + std::pow(xcrd[0][iat][1] - xcrd[icell][jat][1], 2.0)
-                                     + std::pow(xcrd[0][iat][2] - xcrd[icell][jat][2], 2.0));
+        std::vector<double> dist_cell(ncell);
 
-                distall_ewald[iat][jat].emplace_back(icell, dist_tmp);
-            }
-            std::sort(distall_ewald[iat][jat].begin(), distall_ewald[iat][jat].end());
-        }
-    }
-    double dist_hold = -1.0;
-    for (iat = 0; iat < nat; ++iat) {
-        for (jat = 0; jat < nat; ++jat) {
-            multiplicity[iat][jat] = 0;
+        for (int jat = 0; jat < nat; ++jat) {
+
+            const auto dx0 = xcart[iat][0] - xcart[jat][0];
+            const auto dy0 = xcart[iat][1] - xcart[jat][1];
+            const auto dz0 = xcart[iat][2] - xcart[jat][2];
+
+            auto dist_min = 0.0;
 
-            for (auto it = distall_ewald[iat][jat].begin();
-                 it != distall_ewald[iat][jat].end(); ++it) {
-                if (it == distall_ewald[iat][jat].begin()) dist_hold = (*it).dist;
-                dist_tmp = (*it).dist;
-                if (std::abs(dist_tmp - dist_hold) < 1.0e-3) multiplicity[iat][jat] += 1;
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+            for (int ic = 0; ic < ncell; ++ic) {
+                const auto dx = dx0 - xshift[ic][0];
+                const auto dy = dy0 - xshift[ic][1];
+                const auto dz = dz0 - xshift[ic][2];
+                dist_cell[ic] = std::sqrt(dx * dx + dy * dy + dz * dz);
+            }
+            dist_min = dist_cell[0];
+            for (int ic = 1; ic < ncell; ++ic) {
+                dist_min = std::min(dist_min, dist_cell[ic]);
             }
 
+            distall_ewald[iat][jat].clear();
+            for (int ic = 0; ic < ncell; ++ic) {
+                if (dist_cell[ic] < dist_min + 1.0e-3) {
+                    distall_ewald[iat][jat].emplace_back(ic, dist_cell[ic]);
+                }
+            }
+            multiplicity[iat][jat] = static_cast<int>(distall_ewald[iat][jat].size());
         }
     }
-    deallocate(xcrd);
+
+    deallocate(xcart);
+    deallocate(xshift);
 }
 
 void Ewald::compute_ewald_fcs()
@@ -441,6 +469,8 @@ void Ewald::compute_ewald_fcs()
         }
     }
 
+    ++fc2_without_dipole_generation;
+
     if (mympi->my_rank == 0) {
         if (print_fc2_ewald) {
 
@@ -578,6 +608,8 @@ void Ewald::compute_ewald_fcs2()
         }
     }
 
+    ++fc2_without_dipole_generation;
+
     if (mympi->my_rank == 0) {
         if (print_fc2_ewald) {
 
@@ -899,14 +931,10 @@ void Ewald::add_longrange_matrix(const double *xk_in,
                                  const double *kvec_in,
                                  std::complex<double> **dymat_k_out)
 {
-    int icrd, jcrd, iat, jat;
-    int natmin = system->natmin;
-    int neval = 3 * system->natmin;
+    const int natmin = system->natmin;
+    const int neval = 3 * system->natmin;
     double xk[3];
-    std::complex<double> **dymat_tmp_l, **dymat_tmp_g;
-
-    allocate(dymat_tmp_l, 3, 3);
-    allocate(dymat_tmp_g, 3, 3);
+    const std::complex<double> im(0.0, 1.0);
 
     // Move input xk back to the -0.5 <= xk < 0.5 range to avoid zero division.
     // Also, this is necessary to make the phonon dispersion periodic in the reciprocal lattice.
@@ -922,134 +950,141 @@ void Ewald::add_longrange_matrix(const double *xk_in,
         }
     }
 
-    for (iat = 0; iat < natmin; ++iat) {
-        for (jat = 0; jat < natmin; ++jat) {
-            calc_short_term_dynamical_matrix(iat, jat, xk, dymat_tmp_l);
-            calc_long_term_dynamical_matrix(iat, jat, xk, kvec_in, dymat_tmp_g);
+    // The k-independent parts were prepared once in init(); the work left
+    // per k point is the phase factors of the real-space terms and the
+    // k-dependent reciprocal sum. The atom pairs are independent.
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int ipair = 0; ipair < natmin * natmin; ++ipair) {
+
+        const int iat = ipair / natmin;
+        const int jat = ipair % natmin;
+        int icrd, jcrd;
+
+        std::complex<double> mat_tmp[3][3];
+
+        for (icrd = 0; icrd < 3; ++icrd) {
+            for (jcrd = 0; jcrd < 3; ++jcrd) {
+                mat_tmp[icrd][jcrd] = dymat_const[9 * ipair + 3 * icrd + jcrd];
+            }
+        }
+
+        for (const auto &term: shortreal_terms[ipair]) {
+            const auto phase = xk[0] * term.trans[0]
+                               + xk[1] * term.trans[1]
+                               + xk[2] * term.trans[2];
+            const auto exp_phase = std::exp(im * phase);
+
             for (icrd = 0; icrd < 3; ++icrd) {
                 for (jcrd = 0; jcrd < 3; ++jcrd) {
-                    dymat_k_out[3 * iat + icrd][3 * jat + jcrd] = dymat_tmp_l[icrd][jcrd]
-                                                                  + dymat_tmp_g[icrd][jcrd];
+                    mat_tmp[icrd][jcrd] -= term.func[icrd][jcrd] * exp_phase;
                 }
             }
+        }
+
+        calc_long_term_dynamical_matrix(iat, jat, xk, kvec_in, mat_tmp);
 
+        for (icrd = 0; icrd < 3; ++icrd) {
+            for (jcrd = 0; jcrd < 3; ++jcrd) {
+                dymat_k_out[3 * iat + icrd][3 * jat + jcrd] = mat_tmp[icrd][jcrd];
+            }
         }
     }
-    deallocate(dymat_tmp_l);
-    deallocate(dymat_tmp_g);
 }
 
-void Ewald::calc_short_term_dynamical_matrix(const int iat,
-                                             const int jat,
-                                             double *xk_in,
-                                             std::complex<double> **mat_out)
+void Ewald::prepare_longrange_cache()
 {
-    // Real lattice sum part for a dynamical matrix
-    // iat : atom index in the primitive cell
-    // jat : atom index in the primitive cell
+    // The real-space sum of the Ewald dynamical matrix depends on k only
+    // through the phase factors exp(i k.T) of the lattice translations,
+    // and the self (iat == jat) part of the reciprocal sum not at all.
+    // Both are evaluated here once; add_longrange_matrix then applies the
+    // phases and the k-dependent reciprocal terms only.
 
-    int i;
-    int icrd, jcrd, kat;
-    int atm_s3;
+    int i, icrd, jcrd, acrd, bcrd, kat;
     int icell, jcell, kcell;
-    double xnorm, phase;
-    double x_tmp[3], trans[3];
-    std::complex<double> im(0.0, 1.0);
+    double xnorm;
+    double x_tmp[3], trans[3], vecl[3], g[3], g_tmp[3];
     std::vector<std::vector<double>> func_L(3, std::vector<double>(3, 0.0));
+    double func_sym[3][3];
+    const std::complex<double> im(0.0, 1.0);
 
-    // Substitute quantities into variables
-    int atm_s1 = system->map_p2s[iat][0];
-    int atm_s2 = system->map_p2s[jat][0];
+    const int natmin = system->natmin;
 
-    for (i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
-            mat_out[i][j] = std::complex<double>(0.0, 0.0);
-        }
-    }
+    dymat_const.assign(static_cast<size_t>(natmin) * natmin * 9,
+                       std::complex<double>(0.0, 0.0));
+    shortreal_terms.assign(static_cast<size_t>(natmin) * natmin,
+                           std::vector<PhasedRealTerm>());
 
-    if (iat == jat) {
-        // k = k'
+    gvec_flat.clear();
+    gvec_flat.reserve(3 * G_vector.size());
+    for (const auto &it: G_vector) {
+        for (i = 0; i < 3; ++i) gvec_flat.push_back(it.vec[i]);
+    }
 
-        for (icell = -nl[0]; icell <= nl[0]; ++icell) {
-            for (jcell = -nl[1]; jcell <= nl[1]; ++jcell) {
-                for (kcell = -nl[2]; kcell <= nl[2]; ++kcell) {
+    for (int iat = 0; iat < natmin; ++iat) {
+        for (int jat = 0; jat < natmin; ++jat) {
 
-                    trans[0] = static_cast<double>(icell);
-                    trans[1] = static_cast<double>(jcell);
-                    trans[2] = static_cast<double>(kcell);
-                    rotvec(trans, trans, system->lavec_p);
+            const auto ipair = iat * natmin + jat;
 
-                    // Lattice vector = 0
-                    if (icell == 0 && jcell == 0 && kcell == 0) {
+            const int atm_s1 = system->map_p2s[iat][0];
+            const int atm_s2 = system->map_p2s[jat][0];
+            const auto invsqrt_mass
+                    = 1.0 / std::sqrt(system->mass[atm_s1] * system->mass[atm_s2]);
 
-                        for (kat = 0; kat < system->natmin; ++kat) {
-                            if (kat == iat) continue;
+            for (icell = -nl[0]; icell <= nl[0]; ++icell) {
+                for (jcell = -nl[1]; jcell <= nl[1]; ++jcell) {
+                    for (kcell = -nl[2]; kcell <= nl[2]; ++kcell) {
 
-                            atm_s3 = system->map_p2s[kat][0];
-                            for (i = 0; i < 3; ++i) {
-                                x_tmp[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s3][i];
-                            }
-                            rotvec(x_tmp, x_tmp, system->lavec_s);
-                            xnorm = std::sqrt(x_tmp[0] * x_tmp[0]
-                                              + x_tmp[1] * x_tmp[1]
-                                              + x_tmp[2] * x_tmp[2]);
+                        trans[0] = static_cast<double>(icell);
+                        trans[1] = static_cast<double>(jcell);
+                        trans[2] = static_cast<double>(kcell);
+                        rotvec(trans, trans, system->lavec_p);
 
-                            if (xnorm < Lmax) {
-                                calc_realspace_sum(atm_s1, atm_s3, x_tmp, lambda, func_L);
+                        const auto is_center = (icell == 0 && jcell == 0 && kcell == 0);
 
-                                if (force_permutation_sym) {
-                                    for (icrd = 0; icrd < 3; ++icrd) {
-                                        for (jcrd = 0; jcrd < 3; ++jcrd) {
-                                            mat_out[icrd][jcrd] += 0.5 * (func_L[icrd][jcrd]
-                                                                          + func_L[jcrd][icrd]);
-                                        }
-                                    }
-                                } else {
-                                    for (icrd = 0; icrd < 3; ++icrd) {
-                                        for (jcrd = 0; jcrd < 3; ++jcrd) {
-                                            mat_out[icrd][jcrd] += func_L[icrd][jcrd];
-                                        }
-                                    }
-                                }
-                            }
-                        }
+                        if (iat == jat) {
 
-                    } else {
+                            // Unphased self terms: sum over the third atom.
 
-                        for (kat = 0; kat < system->natmin; ++kat) {
-                            atm_s3 = system->map_p2s[kat][0];
-                            for (i = 0; i < 3; ++i) {
-                                x_tmp[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s3][i];
-                            }
-                            rotvec(x_tmp, x_tmp, system->lavec_s);
-                            for (i = 0; i < 3; ++i) {
-                                x_tmp[i] -= trans[i];
-                            }
-                            xnorm = std::sqrt(x_tmp[0] * x_tmp[0]
-                                              + x_tmp[1] * x_tmp[1]
-                                              + x_tmp[2] * x_tmp[2]);
+                            for (kat = 0; kat < natmin; ++kat) {
+                                if (is_center && kat == iat) continue;
 
-                            if (xnorm < Lmax) {
+                                const int atm_s3 = system->map_p2s[kat][0];
+                                for (i = 0; i < 3; ++i) {
+                                    x_tmp[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s3][i];
+                                }
+                                rotvec(x_tmp, x_tmp, system->lavec_s);
+                                for (i = 0; i < 3; ++i) {
+                                    x_tmp[i] -= trans[i];
+                                }
+                                xnorm = std::sqrt(x_tmp[0] * x_tmp[0]
+                                                  + x_tmp[1] * x_tmp[1]
+                                                  + x_tmp[2] * x_tmp[2]);
 
-                                calc_realspace_sum(atm_s1, atm_s3, x_tmp, lambda, func_L);
+                                if (xnorm < Lmax) {
+                                    calc_realspace_sum(atm_s1, atm_s3, x_tmp, lambda, func_L);
 
-                                if (force_permutation_sym) {
                                     for (icrd = 0; icrd < 3; ++icrd) {
                                         for (jcrd = 0; jcrd < 3; ++jcrd) {
-                                            mat_out[icrd][jcrd] += 0.5 * (func_L[icrd][jcrd]
-                                                                          + func_L[jcrd][icrd]);
-                                        }
-                                    }
-                                } else {
-                                    for (icrd = 0; icrd < 3; ++icrd) {
-                                        for (jcrd = 0; jcrd < 3; ++jcrd) {
-                                            mat_out[icrd][jcrd] += func_L[icrd][jcrd];
+                                            if (force_permutation_sym) {
+                                                func_sym[icrd][jcrd] = 0.5 * (func_L[icrd][jcrd]
+                                                                              + func_L[jcrd][icrd]);
+                                            } else {
+                                                func_sym[icrd][jcrd] = func_L[icrd][jcrd];
+                                            }
+                                            dymat_const[9 * ipair + 3 * icrd + jcrd]
+                                                    += func_sym[icrd][jcrd] * invsqrt_mass;
                                         }
                                     }
                                 }
                             }
+
+                            if (is_center) continue;
                         }
 
+                        // Phased term between iat and jat.
+
                         for (i = 0; i < 3; ++i) {
                             x_tmp[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s2][i];
                         }
@@ -1063,63 +1098,74 @@ void Ewald::calc_short_term_dynamical_matrix(const int iat,
 
                         if (xnorm < Lmax) {
                             calc_realspace_sum(atm_s1, atm_s2, x_tmp, lambda, func_L);
-                            phase = xk_in[0] * trans[0] + xk_in[1] * trans[1] + xk_in[2] * trans[2];
-
-                            for (icrd = 0; icrd < 3; ++icrd) {
-                                for (jcrd = 0; jcrd < 3; ++jcrd) {
-                                    mat_out[icrd][jcrd] -= func_L[icrd][jcrd] * std::exp(im * phase);
+                            if (force_permutation_sym) {
+                                for (icrd = 0; icrd < 3; ++icrd) {
+                                    for (jcrd = 0; jcrd < 3; ++jcrd) {
+                                        func_L[icrd][jcrd] = 0.5 * (func_L[icrd][jcrd]
+                                                                    + func_L[jcrd][icrd]);
+                                        func_L[jcrd][icrd] = func_L[icrd][jcrd];
+                                    }
                                 }
                             }
+                            shortreal_terms[ipair].emplace_back(trans, func_L, invsqrt_mass);
                         }
                     }
                 }
             }
         }
+    }
 
-    } else {
+    // Self part of the reciprocal sum (independent of k).
 
-        for (icell = -nl[0]; icell <= nl[0]; ++icell) {
-            for (jcell = -nl[1]; jcell <= nl[1]; ++jcell) {
-                for (kcell = -nl[2]; kcell <= nl[2]; ++kcell) {
+    const auto inv_4lambda2 = 0.25 / (lambda * lambda);
+    const auto ng_vec = static_cast<int>(G_vector.size());
 
-                    trans[0] = static_cast<double>(icell);
-                    trans[1] = static_cast<double>(jcell);
-                    trans[2] = static_cast<double>(kcell);
-                    rotvec(trans, trans, system->lavec_p);
+    for (int iat = 0; iat < natmin; ++iat) {
 
-                    for (i = 0; i < 3; ++i) {
-                        x_tmp[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s2][i];
-                    }
-                    rotvec(x_tmp, x_tmp, system->lavec_s);
-                    for (i = 0; i < 3; ++i) {
-                        x_tmp[i] -= trans[i];
-                    }
-                    xnorm = std::sqrt(x_tmp[0] * x_tmp[0]
-                                      + x_tmp[1] * x_tmp[1]
-                                      + x_tmp[2] * x_tmp[2]);
+        const auto ipair = iat * natmin + iat;
+        const int atm_s1 = system->map_p2s[iat][0];
+        const auto factor_long = 4.0 * pi / (system->volume_p * system->mass[atm_s1]);
 
-                    if (xnorm < Lmax) {
-                        calc_realspace_sum(atm_s1, atm_s2, x_tmp, lambda, func_L);
-                        phase = xk_in[0] * trans[0] + xk_in[1] * trans[1] + xk_in[2] * trans[2];
+        for (int ig = 0; ig < ng_vec; ++ig) {
 
-                        for (icrd = 0; icrd < 3; ++icrd) {
-                            for (jcrd = 0; jcrd < 3; ++jcrd) {
-                                mat_out[icrd][jcrd] -= func_L[icrd][jcrd] * std::exp(im * phase);
+            for (i = 0; i < 3; ++i) g[i] = gvec_flat[3 * ig + i];
+
+            rotvec(g_tmp, g, epsilon);
+            const auto gd = g[0] * g_tmp[0] + g[1] * g_tmp[1] + g[2] * g_tmp[2];
+            const auto common = std::exp(-gd * inv_4lambda2) / gd;
+
+            for (kat = 0; kat < natmin; ++kat) {
+                const int atm_s3 = system->map_p2s[kat][0];
+
+                for (i = 0; i < 3; ++i) {
+                    vecl[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s3][i];
+                }
+                rotvec(vecl, vecl, system->lavec_s);
+                const auto phase_g1 = g[0] * vecl[0] + g[1] * vecl[1] + g[2] * vecl[2];
+                const auto exp_phase = std::exp(im * phase_g1);
+
+                for (icrd = 0; icrd < 3; ++icrd) {
+                    for (jcrd = 0; jcrd < 3; ++jcrd) {
+                        double tmp = 0.0;
+
+                        for (acrd = 0; acrd < 3; ++acrd) {
+                            for (bcrd = 0; bcrd < 3; ++bcrd) {
+                                if (force_permutation_sym) {
+                                    tmp += g[acrd] * g[bcrd]
+                                           * (Born_charge[iat][acrd][icrd] * Born_charge[kat][bcrd][jcrd]
+                                              + Born_charge[iat][acrd][jcrd] * Born_charge[kat][bcrd][icrd]);
+                                } else {
+                                    tmp += g[acrd] * g[bcrd] * 2.0
+                                           * (Born_charge[iat][acrd][icrd] * Born_charge[kat][bcrd][jcrd]);
+                                }
                             }
                         }
+                        dymat_const[9 * ipair + 3 * icrd + jcrd]
+                                -= tmp * common * exp_phase * factor_long;
                     }
                 }
             }
         }
-
-    }
-
-    const auto mi = system->mass[atm_s1];
-    const auto mj = system->mass[atm_s2];
-    for (icrd = 0; icrd < 3; ++icrd) {
-        for (jcrd = 0; jcrd < 3; ++jcrd) {
-            mat_out[icrd][jcrd] /= std::sqrt(mi * mj);
-        }
     }
 }
 
@@ -1127,34 +1173,34 @@ void Ewald::calc_long_term_dynamical_matrix(const int iat,
                                             const int jat,
                                             const double *xk_in,
                                             const double *kvec_in,
-                                            std::complex<double> **mat_out)
+                                            std::complex<double> (&mat_out)[3][3])
 {
-    // Reciprocal lattice sum part for a dynamical matrix
+    // k-dependent reciprocal lattice sum part for a dynamical matrix,
+    // accumulated into mat_out. The k-independent self part is prepared
+    // in prepare_longrange_cache().
 
-    int i, j;
+    int i;
     int icrd, jcrd, acrd, bcrd;
     double vec[3], e_kvec[3];
-    std::complex<double> im(0.0, 1.0);
+    const std::complex<double> im(0.0, 1.0);
     double tmp;
 
-    int atm_s1 = system->map_p2s[iat][0];
-    int atm_s2 = system->map_p2s[jat][0];
-    double mi = system->mass[atm_s1];
-    double mj = system->mass[atm_s2];
-    double vol_p = system->volume_p;
+    const int atm_s1 = system->map_p2s[iat][0];
+    const int atm_s2 = system->map_p2s[jat][0];
+    const double mi = system->mass[atm_s1];
+    const double mj = system->mass[atm_s2];
+    const double vol_p = system->volume_p;
+    const auto factor = 4.0 * pi / (vol_p * std::sqrt(mi * mj));
+    const auto inv_4lambda2 = 0.25 / (lambda * lambda);
+
     for (i = 0; i < 3; ++i) {
         vec[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s2][i];
     }
     rotvec(vec, vec, system->lavec_s);
-    double phase = xk_in[0] * vec[0] + xk_in[1] * vec[1] + xk_in[2] * vec[2];
+    const double phase = xk_in[0] * vec[0] + xk_in[1] * vec[1] + xk_in[2] * vec[2];
     rotvec(e_kvec, xk_in, epsilon);
 
-    for (i = 0; i < 3; ++i) {
-        for (j = 0; j < 3; ++j) {
-            mat_out[i][j] = std::complex<double>(0.0, 0.0);
-        }
-    }
-    double kd = xk_in[0] * e_kvec[0] + xk_in[1] * e_kvec[1] + xk_in[2] * e_kvec[2];
+    const double kd = xk_in[0] * e_kvec[0] + xk_in[1] * e_kvec[1] + xk_in[2] * e_kvec[2];
 
     std::complex<double> exp_phase = std::exp(im * phase);
 
@@ -1172,8 +1218,8 @@ void Ewald::calc_long_term_dynamical_matrix(const int iat,
                                * Born_charge[iat][acrd][icrd] * Born_charge[jat][bcrd][jcrd];
                     }
                 }
-                mat_out[icrd][jcrd] += 2.0 * tmp / kd * exp_phase
-                                       * std::exp(-0.25 * kd / std::pow(lambda, 2.0));
+                mat_out[icrd][jcrd] += factor * 2.0 * tmp / kd * exp_phase
+                                       * std::exp(-kd * inv_4lambda2);
             }
         }
 
@@ -1184,7 +1230,7 @@ void Ewald::calc_long_term_dynamical_matrix(const int iat,
         double kdirec[3], e_kdirec[3];
         for (i = 0; i < 3; ++i) kdirec[i] = kvec_in[i];
         rotvec(e_kdirec, kdirec, epsilon);
-        double norm = kdirec[0] * e_kdirec[0] + kdirec[1] * e_kdirec[1] + kdirec[2] * e_kdirec[2];
+        const double norm = kdirec[0] * e_kdirec[0] + kdirec[1] * e_kdirec[1] + kdirec[2] * e_kdirec[2];
 
         if (norm > eps) {
             for (icrd = 0; icrd < 3; ++icrd) {
@@ -1197,84 +1243,43 @@ void Ewald::calc_long_term_dynamical_matrix(const int iat,
                                    * Born_charge[iat][acrd][icrd] * Born_charge[jat][bcrd][jcrd];
                         }
                     }
-                    mat_out[icrd][jcrd] += 2.0 * tmp / norm * exp_phase;
+                    mat_out[icrd][jcrd] += factor * 2.0 * tmp / norm * exp_phase;
                 }
             }
         }
     }
 
-    double g[3], gk[3], vecl[3], g_tmp[3], gk_tmp[3];
-    double common;
-
-    for (auto &it: G_vector) {
-        for (int l = 0; l < 3; ++l) {
-            g[l] = it.vec[l];
-            gk[l] = g[l] + xk_in[l];
-        }
-
-        if (iat == jat) {
-
-            rotvec(g_tmp, g, epsilon);
-            double gd = g[0] * g_tmp[0] + g[1] * g_tmp[1] + g[2] * g_tmp[2];
-            common = std::exp(-0.25 * gd / std::pow(lambda, 2.0)) / gd;
+    double gk[3], gk_tmp[3];
+    double p_i[3], q_j[3];
+    const auto ng_vec = static_cast<int>(gvec_flat.size() / 3);
 
-            for (int kat = 0; kat < system->natmin; ++kat) {
-                int atm_s3 = system->map_p2s[kat][0];
+    for (int ig = 0; ig < ng_vec; ++ig) {
 
-                for (i = 0; i < 3; ++i) {
-                    vecl[i] = system->xr_s[atm_s1][i] - system->xr_s[atm_s3][i];
-                }
-                rotvec(vecl, vecl, system->lavec_s);
-                double phase_g1 = g[0] * vecl[0] + g[1] * vecl[1] + g[2] * vecl[2];
-                exp_phase = std::exp(im * phase_g1);
-
-                for (icrd = 0; icrd < 3; ++icrd) {
-                    for (jcrd = 0; jcrd < 3; ++jcrd) {
-                        tmp = 0.0;
-
-                        for (acrd = 0; acrd < 3; ++acrd) {
-                            for (bcrd = 0; bcrd < 3; ++bcrd) {
-                                if (force_permutation_sym) {
-                                    tmp += g[acrd] * g[bcrd]
-                                           * (Born_charge[iat][acrd][icrd] * Born_charge[kat][bcrd][jcrd]
-                                              + Born_charge[jat][acrd][jcrd] * Born_charge[kat][bcrd][icrd]);
-                                } else {
-                                    tmp += g[acrd] * g[bcrd] * 2.0
-                                           * (Born_charge[iat][acrd][icrd] * Born_charge[kat][bcrd][jcrd]);
-                                }
-                            }
-                        }
-                        mat_out[icrd][jcrd] -= tmp * common * exp_phase;
-                    }
-                }
-            }
+        for (int l = 0; l < 3; ++l) {
+            gk[l] = gvec_flat[3 * ig + l] + xk_in[l];
         }
 
         rotvec(gk_tmp, gk, epsilon);
-        double gkd = gk[0] * gk_tmp[0] + gk[1] * gk_tmp[1] + gk[2] * gk_tmp[2];
-        double phase_g2 = gk[0] * vec[0] + gk[1] * vec[1] + gk[2] * vec[2];
+        const double gkd = gk[0] * gk_tmp[0] + gk[1] * gk_tmp[1] + gk[2] * gk_tmp[2];
+        const double phase_g2 = gk[0] * vec[0] + gk[1] * vec[1] + gk[2] * vec[2];
 
-        common = 2.0 * std::exp(-0.25 * gkd / std::pow(lambda, 2.0)) / gkd;
+        const auto common = 2.0 * factor * std::exp(-gkd * inv_4lambda2) / gkd;
         exp_phase = std::exp(im * phase_g2);
 
+        // (gk Z_i)_icrd (gk Z_j)_jcrd factorizes the Born charge double sum.
         for (icrd = 0; icrd < 3; ++icrd) {
-            for (jcrd = 0; jcrd < 3; ++jcrd) {
-                tmp = 0.0;
-
-                for (acrd = 0; acrd < 3; ++acrd) {
-                    for (bcrd = 0; bcrd < 3; ++bcrd) {
-                        tmp += gk[acrd] * gk[bcrd]
-                               * Born_charge[iat][acrd][icrd] * Born_charge[jat][bcrd][jcrd];
-                    }
-                }
-                mat_out[icrd][jcrd] += tmp * common * exp_phase;
+            p_i[icrd] = 0.0;
+            q_j[icrd] = 0.0;
+            for (acrd = 0; acrd < 3; ++acrd) {
+                p_i[icrd] += gk[acrd] * Born_charge[iat][acrd][icrd];
+                q_j[icrd] += gk[acrd] * Born_charge[jat][acrd][icrd];
             }
         }
-    }
 
-    for (i = 0; i < 3; ++i) {
-        for (j = 0; j < 3; ++j) {
-            mat_out[i][j] *= 4.0 * pi / (vol_p * std::sqrt(mi * mj));
+        for (icrd = 0; icrd < 3; ++icrd) {
+            for (jcrd = 0; jcrd < 3; ++jcrd) {
+                mat_out[icrd][jcrd] += p_i[icrd] * q_j[jcrd] * common * exp_phase;
+            }
         }
     }
 }
@@ -32,6 +32,27 @@ public:
     };
 };
 
+class PhasedRealTerm {
+public:
+    // One real-space term of the short-range Ewald sum: the mass-scaled
+    // 3x3 interaction block and the lattice translation giving its phase
+    // factor exp(i k.T) at evaluation time.
+    double trans[3];
+    double func[3][3];
+
+    PhasedRealTerm(const double *trans_in,
+                   const std::vector<std::vector<double>> &func_in,
+                   const double scale)
+    {
+        for (unsigned int i = 0; i < 3; ++i) {
+            trans[i] = trans_in[i];
+            for (unsigned int j = 0; j < 3; ++j) {
+                func[i][j] = func_in[i][j] * scale;
+            }
+        }
+    };
+};
+
 class DistInfo {
 public:
     int cell;
@@ -68,6 +89,10 @@ public:
 
     std::vector<FcsClassExtent> fc2_without_dipole;
 
+    // Staleness stamp of fc2_without_dipole; see
+    // Fcs_phonon::fc2_ext_generation.
+    unsigned long fc2_without_dipole_generation;
+
     void init();
 
     void add_longrange_matrix(const double *,
@@ -120,16 +145,23 @@ private:
                                   int,
                                   double **);
 
-    void calc_short_term_dynamical_matrix(int,
-                                          int,
-                                          double *,
-                                          std::complex<double> **);
+    // k-independent parts of the long-range dynamical matrix, prepared
+    // once in init(): the unphased real- and reciprocal-space
+    // contributions of every atom pair (dymat_const, flattened 3x3
+    // blocks), the phased real-space terms with their translations, and
+    // the G vectors as one contiguous array.
+    std::vector<std::complex<double>> dymat_const;
+    std::vector<std::vector<PhasedRealTerm>> shortreal_terms;
+    std::vector<double> gvec_flat;
+
+    void prepare_longrange_cache();
 
+    // Accumulates the k-dependent reciprocal-space terms into mat_out.
     void calc_long_term_dynamical_matrix(const int iat,
                                          const int jat,
                                          const double *xk_in,
                                          const double *kvec_in,
-                                         std::complex<double> **mat_out);
+                                         std::complex<double> (&mat_out)[3][3]);
 
     void calc_realspace_sum(const int iat,
                             const int jat,
@@ -18,14 +18,15 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include "anharmonic_core.h"
 #include "system.h"
 #include "thermodynamics.h"
+#include "xml_stream_parser.h"
+#include "fcs_binary.h"
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/foreach.hpp>
-#include <boost/lexical_cast.hpp>
 
 using namespace PHON_NS;
 
@@ -44,7 +45,15 @@ void Fcs_phonon::set_default_variables()
     maxorder = 0;
     file_fcs = "";
     file_fc2 = "";
+    file_fcsbin = "";
     update_fc2 = false;
+    fc2_ext_generation = 0;
+    // Default true so that drivers filling the tables through
+    // set_fcs_from_arrays without going through setup() get the full
+    // decode; setup() narrows it per run.
+    require_fc2_with_cell = true;
+    force_asr_check = false;
+    asr_verified_file = false;
     force_constant_with_cell = nullptr;
 }
 
@@ -66,6 +75,9 @@ void Fcs_phonon::setup(std::string mode)
 
     MPI_Bcast(&anharmonic_core->quartic_mode, 1, MPI_INT, 0, MPI_COMM_WORLD);
     MPI_Bcast(&gruneisen->print_gruneisen, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+    // print_newfcs enters the maxorder decision below, so it must agree on
+    // all ranks already here (Gruneisen::setup broadcasts it again later).
+    MPI_Bcast(&gruneisen->print_newfcs, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&thermodynamics->calc_FE_bubble, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
 
     if (mode == "PHONONS") {
@@ -104,13 +116,25 @@ void Fcs_phonon::setup(std::string mode)
         anharmonic_core->quartic_mode = 1;
     }
 
+    // Only the NEWFCS writer reads the harmonic entries of
+    // force_constant_with_cell; the dynamical matrix works on fc2_ext.
+    require_fc2_with_cell = gruneisen->print_newfcs;
+
     allocate(force_constant_with_cell, maxorder);
 
     if (mympi->my_rank == 0) {
         double *maxdev;
 
-        load_fc2_xml();
-        load_fcs_xml();
+        if (file_fcsbin.empty()) {
+            load_fc2_xml();
+            load_fcs_xml();
+        } else {
+            // The binary container carries only the force-constant tables,
+            // so the harmonic terms of a separate FC2XML file are still
+            // read from the XML.
+            if (update_fc2) load_fc2_xml();
+            load_fcs_binary();
+        }
 
         for (i = 0; i < maxorder; ++i) {
             std::cout << "  Number of non-zero IFCs for " << i + 2 << " order: ";
@@ -122,8 +146,16 @@ void Fcs_phonon::setup(std::string mode)
         }
         std::cout << std::endl;
 
+        // When the binary container records that the translational sum
+        // rules were imposed at creation and its checksums match, only the
+        // harmonic part (which may come from a separate FC2XML file) is
+        // re-examined; the full check over all anharmonic tuples can be
+        // forced back on with ASR_CHECK = 1.
+        const auto norder_check
+                = (asr_verified_file && !force_asr_check) ? 1 : maxorder;
+
         allocate(maxdev, maxorder);
-        examine_translational_invariance(maxorder,
+        examine_translational_invariance(norder_check,
                                          system->nat_anharm,
                                          system->natmin,
                                          maxdev,
@@ -131,12 +163,24 @@ void Fcs_phonon::setup(std::string mode)
                                          force_constant_with_cell);
 
         std::cout << "  Maximum deviation from the translational invariance: " << std::endl;
-        for (i = 0; i < maxorder; ++i) {
+        for (i = 0; i < norder_check; ++i) {
             std::cout << "   Order " << i + 2 << " : " << std::setw(12)
                       << std::scientific << maxdev[i] << std::endl;
         }
+        if (norder_check < maxorder) {
+            std::cout << "   Higher orders were verified when the binary file was created." << std::endl;
+            std::cout << "   (Set ASR_CHECK = 1 to re-examine them.)" << std::endl;
+        }
         std::cout << std::endl;
         deallocate(maxdev);
+
+        // Trim the growth slack of the push_back-grown tables before the
+        // mesh arrays are allocated; right after loading, the slack can
+        // approach the size of the tables themselves.
+        fc2_ext.shrink_to_fit();
+        for (i = 0; i < maxorder; ++i) {
+            force_constant_with_cell[i].shrink_to_fit();
+        }
     }
 
     MPI_Bcast_fc2_ext();
@@ -145,71 +189,67 @@ void Fcs_phonon::setup(std::string mode)
 
 void Fcs_phonon::load_fc2_xml()
 {
-    using namespace boost::property_tree;
+    // The harmonic terms are read with the streaming scanner instead of a
+    // property_tree DOM load: the FCSXML file also carries the anharmonic
+    // sections, which can be orders of magnitude larger than the part
+    // needed here.
 
     unsigned int atm1, atm2, xyz1, xyz2, cell_s;
-    ptree pt;
     std::stringstream ss1, ss2;
     FcsClassExtent fcext_tmp;
 
-    if (update_fc2) {
-        try {
-            read_xml(file_fc2, pt);
-        }
-        catch (std::exception &e) {
+    const auto file_to_read = update_fc2 ? file_fc2 : file_fcs;
+
+    fc2_ext.clear();
+
+    const auto found
+            = stream_forceconstant_section(file_to_read, "HARMONIC",
+                                           [&](const std::vector<std::string> &pairs,
+                                               const double fcs_val) {
+                                               ss1.str("");
+                                               ss2.str("");
+                                               ss1.clear();
+                                               ss2.clear();
+
+                                               ss1 << pairs[0];
+                                               ss2 << pairs[1];
+
+                                               ss1 >> atm1 >> xyz1;
+                                               ss2 >> atm2 >> xyz2 >> cell_s;
+
+                                               fcext_tmp.atm1 = atm1 - 1;
+                                               fcext_tmp.xyz1 = xyz1 - 1;
+                                               fcext_tmp.atm2 = atm2 - 1;
+                                               fcext_tmp.xyz2 = xyz2 - 1;
+                                               fcext_tmp.cell_s = cell_s - 1;
+                                               fcext_tmp.fcs_val = fcs_val;
+
+                                               fc2_ext.push_back(fcext_tmp);
+                                           });
+
+    if (!found) {
+        if (update_fc2) {
             auto str_error = "Cannot open file FC2XML ( " + file_fc2 + " )";
             exit("load_fc2_xml", str_error.c_str());
-        }
-    } else {
-        try {
-            read_xml(file_fcs, pt);
-        }
-        catch (std::exception &e) {
+        } else {
             auto str_error = "Cannot open file FCSXML ( " + file_fcs + " )";
             exit("load_fc2_xml", str_error.c_str());
         }
     }
-
-    fc2_ext.clear();
-
-    BOOST_FOREACH (const ptree::value_type &child_, pt.get_child("Data.ForceConstants.HARMONIC")) {
-                    const auto &child = child_.second;
-                    const auto str_p1 = child.get<std::string>("<xmlattr>.pair1");
-                    const auto str_p2 = child.get<std::string>("<xmlattr>.pair2");
-
-                    ss1.str("");
-                    ss2.str("");
-                    ss1.clear();
-                    ss2.clear();
-
-                    ss1 << str_p1;
-                    ss2 << str_p2;
-
-                    ss1 >> atm1 >> xyz1;
-                    ss2 >> atm2 >> xyz2 >> cell_s;
-
-                    fcext_tmp.atm1 = atm1 - 1;
-                    fcext_tmp.xyz1 = xyz1 - 1;
-                    fcext_tmp.atm2 = atm2 - 1;
-                    fcext_tmp.xyz2 = xyz2 - 1;
-                    fcext_tmp.cell_s = cell_s - 1;
-                    fcext_tmp.fcs_val = boost::lexical_cast<double>(child.data());
-
-                    fc2_ext.push_back(fcext_tmp);
-                }
-    pt.clear();
 }
 
 void Fcs_phonon::load_fcs_xml() const
 {
-    using namespace boost::property_tree;
-    ptree pt;
+    // Stream the force-constant sections one element at a time instead of
+    // loading the whole document into a property_tree DOM, whose memory
+    // footprint and parse time are prohibitive for large anharmonic
+    // FCSXML files. The records are appended to the preallocated vectors
+    // as soon as each element is complete.
+
     std::string str_tag;
     unsigned int i;
     unsigned int atmn, xyz, cell_s;
 
-    std::vector<Triplet> tri_vec;
-
     std::stringstream ss;
 
     AtomCellSuper ivec_tmp{};
@@ -217,131 +257,353 @@ void Fcs_phonon::load_fcs_xml() const
 
     std::cout << "  Reading force constants from the XML file ... ";
 
-    try {
-        read_xml(file_fcs, pt);
-    }
-    catch (std::exception &e) {
-        auto str_error = "Cannot open file FCSXML ( " + fcs_phonon->file_fcs + " )";
-        exit("load_fcs_xml", str_error.c_str());
-    }
-
     for (unsigned int order = 0; order < maxorder; ++order) {
 
+        // The harmonic section was already streamed into fc2_ext by
+        // load_fc2_xml; the with-cell copy is needed only for NEWFCS,
+        // so the extra pass over the section is skipped otherwise.
+        if (order == 0 && !require_fc2_with_cell) continue;
+
         if (order == 0) {
-            str_tag = "Data.ForceConstants.HARMONIC";
+            str_tag = "HARMONIC";
         } else {
-            str_tag = "Data.ForceConstants.ANHARM" + std::to_string(order + 2);
+            str_tag = "ANHARM" + std::to_string(order + 2);
         }
 
-        auto child_ = pt.get_child_optional(str_tag);
+        const auto found
+                = stream_forceconstant_section(
+                        file_fcs, str_tag,
+                        [&](const std::vector<std::string> &pairs,
+                            const double fcs_val) {
+
+                            ivec_with_cell.clear();
+
+                            for (i = 0; i < order + 2; ++i) {
+                                ss.str("");
+                                ss.clear();
+                                ss << pairs[i];
+
+                                if (i == 0) {
+
+                                    ss >> atmn >> xyz;
+                                    if (update_fc2) {
+                                        ivec_tmp.index = 3 * system->map_p2s_anharm_orig[atmn - 1][0] + xyz - 1;
+                                    } else {
+                                        ivec_tmp.index = 3 * system->map_p2s_anharm[atmn - 1][0] + xyz - 1;
+                                    }
+                                    ivec_tmp.cell_s = 0;
+                                    ivec_tmp.tran = 0; // dummy
+                                    ivec_with_cell.push_back(ivec_tmp);
+                                } else {
+
+                                    ss >> atmn >> xyz >> cell_s;
+
+                                    ivec_tmp.index = 3 * (atmn - 1) + xyz - 1;
+                                    ivec_tmp.cell_s = cell_s - 1;
+                                    ivec_tmp.tran = 0; // dummy
+                                    ivec_with_cell.push_back(ivec_tmp);
+                                }
+                            }
+
+                            if (std::abs(fcs_val) > eps) {
+
+                                do {
+
+                                    ivec_copy.clear();
 
-        if (!child_) {
+                                    for (i = 0; i < ivec_with_cell.size(); ++i) {
+                                        atmn = ivec_with_cell[i].index / 3;
+                                        xyz = ivec_with_cell[i].index % 3;
+                                        ivec_tmp.index = 3 * system->map_s2p_anharm[atmn].atom_num + xyz;
+                                        ivec_tmp.cell_s = ivec_with_cell[i].cell_s;
+                                        ivec_tmp.tran = system->map_s2p_anharm[atmn].tran_num;
+                                        ivec_copy.push_back(ivec_tmp);
+                                    }
+
+                                    force_constant_with_cell[order].emplace_back(fcs_val, ivec_copy);
+
+                                } while (std::next_permutation(ivec_with_cell.begin() + 1, ivec_with_cell.end()));
+                            }
+                        });
+
+        if (!found) {
+            std::ifstream ifs_check(file_fcs.c_str());
+            if (!ifs_check) {
+                auto str_error = "Cannot open file FCSXML ( " + fcs_phonon->file_fcs + " )";
+                exit("load_fcs_xml", str_error.c_str());
+            }
             auto str_tmp = str_tag + " flag not found in the XML file";
             exit("load_fcs_xml", str_tmp.c_str());
         }
+    }
 
-        BOOST_FOREACH (const ptree::value_type &child_, pt.get_child(str_tag)) {
-                        const auto &child = child_.second;
+    std::cout << "done !" << std::endl;
+}
 
-                        auto fcs_val = boost::lexical_cast<double>(child.data());
+void Fcs_phonon::load_fcs_binary()
+{
+    // Load the force constants from the native binary container written by
+    // ALM (FCS_BINARY = 1). The records carry the same 1-based
+    // (atom, xyz, cell) tuples as the XML sections, but each table is read
+    // with one bulk read per array instead of being parsed from text,
+    // which makes loading large anharmonic files orders of magnitude
+    // faster. The layout is described in fcs_binary.h.
+
+    std::ifstream ifs(file_fcsbin.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs) {
+        auto str_error = "Cannot open file FCSBIN ( " + file_fcsbin + " )";
+        exit("load_fcs_binary", str_error.c_str());
+    }
 
-                        ivec_with_cell.clear();
+    std::cout << "  Reading force constants from the binary file ... ";
 
-                        for (i = 0; i < order + 2; ++i) {
-                            auto str_attr = "<xmlattr>.pair" + std::to_string(i + 1);
-                            auto str_pairs = child.get<std::string>(str_attr);
+    char magic[8];
+    std::uint32_t version, norder;
 
-                            ss.str("");
-                            ss.clear();
-                            ss << str_pairs;
+    ifs.read(magic, sizeof(magic));
+    if (!ifs || std::memcmp(magic, fcs_binary_magic, sizeof(magic)) != 0) {
+        exit("load_fcs_binary",
+             "The file given by the FCSBIN tag is not a binary force-constant file.");
+    }
+    ifs.read(reinterpret_cast<char *>(&version), sizeof(version));
+    ifs.read(reinterpret_cast<char *>(&norder), sizeof(norder));
+    if (version != 1 && version != fcs_binary_version) {
+        exit("load_fcs_binary",
+             "Unsupported version of the binary force-constant file.");
+    }
+    if (norder < maxorder) {
+        exit("load_fcs_binary",
+             "The binary file does not contain all the force constants required for this run.");
+    }
 
-                            if (i == 0) {
+    // Version 1 files lack the sum-rule flag and the table checksums;
+    // they are read normally but never qualify for skipping the
+    // translational-invariance check.
+    std::uint32_t asr_imposed = 0;
+    std::uint32_t reserved;
+    if (version >= 2) {
+        ifs.read(reinterpret_cast<char *>(&asr_imposed), sizeof(asr_imposed));
+        ifs.read(reinterpret_cast<char *>(&reserved), sizeof(reserved));
+    }
 
-                                ss >> atmn >> xyz;
-                                if (update_fc2) {
-                                    ivec_tmp.index = 3 * system->map_p2s_anharm_orig[atmn - 1][0] + xyz - 1;
-                                } else {
-                                    ivec_tmp.index = 3 * system->map_p2s_anharm[atmn - 1][0] + xyz - 1;
-                                }
-                                ivec_tmp.cell_s = 0;
-                                ivec_tmp.tran = 0; // dummy
-                                ivec_with_cell.push_back(ivec_tmp);
-                            } else {
+    std::vector<FcsBinaryTableInfo> table_info(norder);
+    ifs.read(reinterpret_cast<char *>(&table_info[0]),
+             norder * sizeof(FcsBinaryTableInfo));
 
-                                ss >> atmn >> xyz >> cell_s;
+    std::vector<std::uint64_t> checksum(norder, 0);
+    if (version >= 2) {
+        ifs.read(reinterpret_cast<char *>(&checksum[0]),
+                 norder * sizeof(std::uint64_t));
+    }
+    auto checksum_ok = version >= 2;
 
-                                ivec_tmp.index = 3 * (atmn - 1) + xyz - 1;
-                                ivec_tmp.cell_s = cell_s - 1;
-                                ivec_tmp.tran = 0; // dummy
-                                ivec_with_cell.push_back(ivec_tmp);
-                            }
+    FcsArrays arrays;
+    arrays.values.resize(maxorder);
+    arrays.indices.resize(maxorder);
 
-                        }
+    for (unsigned int order = 0; order < maxorder; ++order) {
 
-                        if (std::abs(fcs_val) > eps) {
+        const auto nelem = table_info[order].nelem;
+        const auto npair = order + 2;
 
-                            do {
+        // With a separate FC2XML, fc2_ext does not come from this file and
+        // the harmonic with-cell table is only needed for NEWFCS, so the
+        // harmonic records can be skipped entirely.
+        if (order == 0 && update_fc2 && !require_fc2_with_cell) continue;
 
-                                ivec_copy.clear();
+        arrays.values[order].resize(nelem);
+        arrays.indices[order].resize(nelem * npair * 3);
 
-                                for (i = 0; i < ivec_with_cell.size(); ++i) {
-                                    atmn = ivec_with_cell[i].index / 3;
-                                    xyz = ivec_with_cell[i].index % 3;
-                                    ivec_tmp.index = 3 * system->map_s2p_anharm[atmn].atom_num + xyz;
-                                    ivec_tmp.cell_s = ivec_with_cell[i].cell_s;
-                                    ivec_tmp.tran = system->map_s2p_anharm[atmn].tran_num;
-                                    ivec_copy.push_back(ivec_tmp);
-                                }
+        ifs.seekg(static_cast<std::streamoff>(table_info[order].offset));
+        if (nelem > 0) {
+            ifs.read(reinterpret_cast<char *>(&arrays.values[order][0]),
+                     nelem * sizeof(double));
+            ifs.read(reinterpret_cast<char *>(&arrays.indices[order][0]),
+                     arrays.indices[order].size() * sizeof(std::uint32_t));
+        }
+        if (!ifs) {
+            exit("load_fcs_binary",
+                 "Unexpected end of the binary force-constant file.");
+        }
+
+        if (checksum_ok) {
+            auto chk = fcs_binary_checksum(arrays.values[order].data(),
+                                           nelem * sizeof(double));
+            chk = fcs_binary_checksum(arrays.indices[order].data(),
+                                      arrays.indices[order].size() * sizeof(std::uint32_t),
+                                      chk);
+            if (chk != checksum[order]) {
+                warn("load_fcs_binary",
+                     "Checksum mismatch in the binary force-constant file. \n"
+                     " The translational invariance will be examined in full.");
+                checksum_ok = false;
+            }
+        }
+    }
 
-                                force_constant_with_cell[order].emplace_back(fcs_val, ivec_copy);
+    // Only an unmodified file whose sum rules were imposed at creation may
+    // skip the full translational-invariance check later in setup().
+    asr_verified_file = asr_imposed && checksum_ok;
 
-                            } while (std::next_permutation(ivec_with_cell.begin() + 1, ivec_with_cell.end()));
-                        }
+    set_fcs_from_arrays(arrays);
+
+    std::cout << "done !" << std::endl;
+}
+
+void Fcs_phonon::set_fcs_from_arrays(const FcsArrays &arrays)
+{
+    // Decode the (pairs, value) records of the shared container into
+    // fc2_ext and force_constant_with_cell. The records carry the same
+    // 1-based (atom, xyz, cell) tuples as the XML sections; the container
+    // comes either from the *.fcsbin file (load_fcs_binary) or directly
+    // from ALM::get_fcs_arrays when the fitting runs in the same process.
+
+    unsigned int i;
+    unsigned int atmn, xyz;
+
+    AtomCellSuper ivec_tmp{};
+    std::vector<AtomCellSuper> ivec_with_cell, ivec_copy;
+    FcsClassExtent fcext_tmp;
+
+    if (arrays.values.size() < maxorder) {
+        exit("set_fcs_from_arrays",
+             "The container does not hold all the force constants required for this run.");
+    }
+
+    ++fc2_ext_generation;
+
+    for (unsigned int order = 0; order < maxorder; ++order) {
+
+        const auto nelem = arrays.values[order].size();
+        const auto npair = order + 2;
+
+        for (std::size_t ielem = 0; ielem < nelem; ++ielem) {
+
+            const auto *ind = &arrays.indices[order][ielem * npair * 3];
+            const auto fcs_val = arrays.values[order][ielem];
+
+            if (order == 0 && !update_fc2) {
+                fcext_tmp.atm1 = ind[0] - 1;
+                fcext_tmp.xyz1 = ind[1] - 1;
+                fcext_tmp.atm2 = ind[3] - 1;
+                fcext_tmp.xyz2 = ind[4] - 1;
+                fcext_tmp.cell_s = ind[5] - 1;
+                fcext_tmp.fcs_val = fcs_val;
+                fc2_ext.push_back(fcext_tmp);
+            }
+
+            // The with-cell form of the harmonic order is only consumed by
+            // the NEWFCS writer; skip the permutation expansion otherwise.
+            if (order == 0 && !require_fc2_with_cell) continue;
+
+            ivec_with_cell.clear();
+
+            for (i = 0; i < npair; ++i) {
+                atmn = ind[3 * i];
+                xyz = ind[3 * i + 1];
+
+                if (i == 0) {
+                    if (update_fc2) {
+                        ivec_tmp.index = 3 * system->map_p2s_anharm_orig[atmn - 1][0] + xyz - 1;
+                    } else {
+                        ivec_tmp.index = 3 * system->map_p2s_anharm[atmn - 1][0] + xyz - 1;
                     }
+                    ivec_tmp.cell_s = 0;
+                } else {
+                    ivec_tmp.index = 3 * (atmn - 1) + xyz - 1;
+                    ivec_tmp.cell_s = ind[3 * i + 2] - 1;
+                }
+                ivec_tmp.tran = 0; // dummy
+                ivec_with_cell.push_back(ivec_tmp);
+            }
+
+            if (std::abs(fcs_val) > eps) {
+
+                do {
+
+                    ivec_copy.clear();
+
+                    for (i = 0; i < ivec_with_cell.size(); ++i) {
+                        atmn = ivec_with_cell[i].index / 3;
+                        xyz = ivec_with_cell[i].index % 3;
+                        ivec_tmp.index = 3 * system->map_s2p_anharm[atmn].atom_num + xyz;
+                        ivec_tmp.cell_s = ivec_with_cell[i].cell_s;
+                        ivec_tmp.tran = system->map_s2p_anharm[atmn].tran_num;
+                        ivec_copy.push_back(ivec_tmp);
+                    }
+
+                    force_constant_with_cell[order].emplace_back(fcs_val, ivec_copy);
+
+                } while (std::next_permutation(ivec_with_cell.begin() + 1, ivec_with_cell.end()));
+            }
+        }
     }
+}
 
-    std::cout << "done !" << std::endl;
+void Fcs_phonon::bcast_packed_buffer(char *buffer,
+                                     const size_t nbytes) const
+{
+    // MPI_Bcast takes an int count, so large packed buffers are broadcast
+    // in chunks of at most 1 GB.
+
+    const size_t chunk_max = 1073741824;
+
+    for (size_t offset = 0; offset < nbytes; offset += chunk_max) {
+        const auto count = static_cast<int>(std::min(chunk_max, nbytes - offset));
+        MPI_Bcast(buffer + offset, count, MPI_BYTE, 0, MPI_COMM_WORLD);
+    }
 }
 
 void Fcs_phonon::MPI_Bcast_fc2_ext()
 {
+    // The table is packed into one contiguous buffer (all values followed
+    // by all indices) and broadcast in a single call, instead of one
+    // broadcast per field array.
+
     unsigned int i;
-    double *fcs_tmp;
-    unsigned int **ind;
     FcsClassExtent fcext_tmp;
 
     auto nfcs = fc2_ext.size();
-    MPI_Bcast(&nfcs, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&nfcs, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+
+    ++fc2_ext_generation;
+
+    const auto nbytes = nfcs * (sizeof(double) + 5 * sizeof(unsigned int));
+
+    if (nbytes == 0) return;
 
-    allocate(fcs_tmp, nfcs);
-    allocate(ind, nfcs, 5);
+    char *buffer;
+    allocate(buffer, nbytes);
+
+    auto *fcs_tmp = reinterpret_cast<double *>(buffer);
+    auto *ind = reinterpret_cast<unsigned int *>(buffer + nfcs * sizeof(double));
 
     if (mympi->my_rank == 0) {
         for (i = 0; i < nfcs; ++i) {
             fcs_tmp[i] = fc2_ext[i].fcs_val;
-            ind[i][0] = fc2_ext[i].atm1;
-            ind[i][1] = fc2_ext[i].xyz1;
-            ind[i][2] = fc2_ext[i].atm2;
-            ind[i][3] = fc2_ext[i].xyz2;
-            ind[i][4] = fc2_ext[i].cell_s;
+            ind[5 * i] = fc2_ext[i].atm1;
+            ind[5 * i + 1] = fc2_ext[i].xyz1;
+            ind[5 * i + 2] = fc2_ext[i].atm2;
+            ind[5 * i + 3] = fc2_ext[i].xyz2;
+            ind[5 * i + 4] = fc2_ext[i].cell_s;
         }
     }
-    MPI_Bcast(&fcs_tmp[0], nfcs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    MPI_Bcast(&ind[0][0], nfcs * 5, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+
+    bcast_packed_buffer(buffer, nbytes);
 
     if (mympi->my_rank != 0) {
+        fc2_ext.reserve(nfcs);
         for (i = 0; i < nfcs; ++i) {
-            fcext_tmp.atm1 = ind[i][0];
-            fcext_tmp.xyz1 = ind[i][1];
-            fcext_tmp.atm2 = ind[i][2];
-            fcext_tmp.xyz2 = ind[i][3];
-            fcext_tmp.cell_s = ind[i][4];
+            fcext_tmp.atm1 = ind[5 * i];
+            fcext_tmp.xyz1 = ind[5 * i + 1];
+            fcext_tmp.atm2 = ind[5 * i + 2];
+            fcext_tmp.xyz2 = ind[5 * i + 3];
+            fcext_tmp.cell_s = ind[5 * i + 4];
             fcext_tmp.fcs_val = fcs_tmp[i];
             fc2_ext.push_back(fcext_tmp);
         }
     }
-    deallocate(fcs_tmp);
-    deallocate(ind);
+    deallocate(buffer);
 }
 
 void Fcs_phonon::examine_translational_invariance(const int n,
@@ -351,12 +613,10 @@ void Fcs_phonon::examine_translational_invariance(const int n,
                                                   std::vector<FcsClassExtent> &fc2,
                                                   std::vector<FcsArrayWithCell> *fcs) const
 {
-    int i, j, k, l, m;
+    int i, j, k, m;
 
     double dev;
     double **sum2;
-    double ***sum3;
-    double ****sum4;
 
     const auto force_asr = false;
     FcsClassExtent fc2_tmp;
@@ -420,132 +680,162 @@ void Fcs_phonon::examine_translational_invariance(const int n,
             }
             deallocate(sum2);
 
-        } else if (i == 1) {
-
-            allocate(sum3, 3 * natmin, 3 * nat, 3);
-
-            for (j = 0; j < 3 * natmin; ++j) {
-                for (k = 0; k < 3 * nat; ++k) {
-                    for (l = 0; l < 3; ++l) {
-                        sum3[j][k][l] = 0.0;
-                    }
-                }
-            }
+        } else {
 
-            for (const auto &it: fcs[i]) {
-                j = it.pairs[0].index;
-                k = 3 * (natmin * it.pairs[1].tran + it.pairs[1].index / 3) + it.pairs[1].index % 3;
-                l = it.pairs[2].index % 3;
-                sum3[j][k][l] += it.fcs_val;
+            // The anharmonic sums are reduced row by row, where a row is
+            // one (primitive atom, xyz) pair of the first index. The rows
+            // are independent, so they are distributed over threads; each
+            // thread reuses one compact per-row slab instead of the full
+            // dense (3 * natmin x 3 * nat x ...) array, and only the slab
+            // positions actually touched are scanned and reset, keeping
+            // the work proportional to the number of force constants.
+
+            const int nrow = 3 * natmin;
+            const size_t nslab = (i == 1)
+                                 ? 9 * static_cast<size_t>(nat)
+                                 : 27 * static_cast<size_t>(nat) * nat;
+
+            std::vector<std::vector<size_t>> elems_of_row(nrow);
+            for (size_t ielem = 0; ielem < fcs[i].size(); ++ielem) {
+                elems_of_row[fcs[i][ielem].pairs[0].index].push_back(ielem);
             }
-            for (j = 0; j < 3 * natmin; ++j) {
-                for (k = 0; k < 3 * nat; ++k) {
-                    for (l = 0; l < 3; ++l) {
-                        dev = std::abs(sum3[j][k][l]);
-                        if (ret[i] < dev) ret[i] = dev;
-                    }
-                }
-            }
-
-            deallocate(sum3);
 
-        } else if (i == 2) {
-
-            allocate(sum4, 3 * natmin, 3 * nat, 3 * nat, 3);
-
-            for (j = 0; j < 3 * natmin; ++j) {
-                for (k = 0; k < 3 * nat; ++k) {
-                    for (l = 0; l < 3 * nat; ++l) {
-                        for (m = 0; m < 3; ++m) {
-                            sum4[j][k][l][m] = 0.0;
+            auto dev_max = 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+            {
+                std::vector<double> slab(nslab, 0.0);
+                std::vector<size_t> touched;
+                auto dev_thread = 0.0;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+                for (int irow = 0; irow < nrow; ++irow) {
+                    touched.clear();
+
+                    for (const auto ielem: elems_of_row[irow]) {
+                        const auto &it = fcs[i][ielem];
+                        size_t ipos;
+
+                        if (i == 1) {
+                            const auto kk = 3 * (natmin * it.pairs[1].tran + it.pairs[1].index / 3)
+                                            + it.pairs[1].index % 3;
+                            ipos = 3 * static_cast<size_t>(kk) + it.pairs[2].index % 3;
+                        } else {
+                            const auto kk = 3 * system->map_p2s_anharm[it.pairs[1].index / 3][it.pairs[1].tran]
+                                            + it.pairs[1].index % 3;
+                            const auto ll = 3 * system->map_p2s_anharm[it.pairs[2].index / 3][it.pairs[2].tran]
+                                            + it.pairs[2].index % 3;
+                            ipos = (static_cast<size_t>(kk) * 3 * nat + ll) * 3
+                                   + it.pairs[3].index % 3;
                         }
+                        if (slab[ipos] == 0.0) touched.push_back(ipos);
+                        slab[ipos] += it.fcs_val;
                     }
-                }
-            }
-
-            for (const auto &it: fcs[i]) {
-                j = it.pairs[0].index;
-                k = 3 * system->map_p2s_anharm[it.pairs[1].index / 3][it.pairs[1].tran]
-                    + it.pairs[1].index % 3;
-                l = 3 * system->map_p2s_anharm[it.pairs[2].index / 3][it.pairs[2].tran]
-                    + it.pairs[2].index % 3;
-                m = it.pairs[3].index % 3;
 
-                sum4[j][k][l][m] += it.fcs_val;
-            }
-
-            for (j = 0; j < 3 * natmin; ++j) {
-                for (k = 0; k < 3 * nat; ++k) {
-                    for (l = 0; l < 3 * nat; ++l) {
-                        for (m = 0; m < 3; ++m) {
-                            dev = std::abs(sum4[j][k][l][m]);
-                            if (ret[i] < dev) ret[i] = dev;
-
-                        }
+                    for (const auto ipos: touched) {
+                        const auto dev_tmp = std::abs(slab[ipos]);
+                        if (dev_thread < dev_tmp) dev_thread = dev_tmp;
+                        slab[ipos] = 0.0;
                     }
                 }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                {
+                    if (dev_max < dev_thread) dev_max = dev_thread;
+                }
             }
 
-            deallocate(sum4);
-
+            ret[i] = dev_max;
         }
-
     }
 }
 
 void Fcs_phonon::MPI_Bcast_fcs_array(const unsigned int N) const
 {
-    int j, k;
-    double *fcs_tmp;
-    unsigned int ***ind;
+    // All orders are serialized into one contiguous buffer in SoA layout
+    // (the values of every order first, then the index triplets) and
+    // broadcast with a single call, instead of three broadcasts per order.
+
+    size_t j;
+    unsigned int i, k;
 
     AtomCellSuper ivec_tmp;
     std::vector<AtomCellSuper> ivec_array;
 
-    for (unsigned int i = 0; i < N; ++i) {
+    std::vector<size_t> len_all(N);
 
-        int len = force_constant_with_cell[i].size();
-        int nelem = i + 2;
+    if (mympi->my_rank == 0) {
+        for (i = 0; i < N; ++i) len_all[i] = force_constant_with_cell[i].size();
+    }
+    MPI_Bcast(&len_all[0], N, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
 
-        MPI_Bcast(&len, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    size_t len_total = 0;
+    size_t nind_total = 0;
 
-        allocate(fcs_tmp, len);
-        allocate(ind, len, nelem, 3);
+    for (i = 0; i < N; ++i) {
+        len_total += len_all[i];
+        nind_total += len_all[i] * 3 * (i + 2);
+    }
 
-        if (mympi->my_rank == 0) {
-            for (j = 0; j < len; ++j) {
-                fcs_tmp[j] = force_constant_with_cell[i][j].fcs_val;
+    const auto nbytes = len_total * sizeof(double) + nind_total * sizeof(unsigned int);
+
+    if (nbytes == 0) return;
+
+    char *buffer;
+    allocate(buffer, nbytes);
+
+    auto *fcs_tmp = reinterpret_cast<double *>(buffer);
+    auto *ind = reinterpret_cast<unsigned int *>(buffer + len_total * sizeof(double));
+
+    if (mympi->my_rank == 0) {
+        size_t ival = 0;
+        size_t iind = 0;
+        for (i = 0; i < N; ++i) {
+            const auto nelem = i + 2;
+            for (j = 0; j < len_all[i]; ++j) {
+                fcs_tmp[ival++] = force_constant_with_cell[i][j].fcs_val;
                 for (k = 0; k < nelem; ++k) {
-                    ind[j][k][0] = force_constant_with_cell[i][j].pairs[k].index;
-                    ind[j][k][1] = force_constant_with_cell[i][j].pairs[k].tran;
-                    ind[j][k][2] = force_constant_with_cell[i][j].pairs[k].cell_s;
+                    ind[iind++] = force_constant_with_cell[i][j].pairs[k].index;
+                    ind[iind++] = force_constant_with_cell[i][j].pairs[k].tran;
+                    ind[iind++] = force_constant_with_cell[i][j].pairs[k].cell_s;
                 }
             }
         }
+    }
+
+    bcast_packed_buffer(buffer, nbytes);
 
-        MPI_Bcast(&fcs_tmp[0], len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-        MPI_Bcast(&ind[0][0][0], 3 * nelem * len, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    if (mympi->my_rank > 0) {
+        size_t ival = 0;
+        size_t iind = 0;
+        for (i = 0; i < N; ++i) {
+            const auto nelem = i + 2;
 
-        if (mympi->my_rank > 0) {
             force_constant_with_cell[i].clear();
+            force_constant_with_cell[i].reserve(len_all[i]);
 
-            for (j = 0; j < len; ++j) {
+            for (j = 0; j < len_all[i]; ++j) {
 
                 ivec_array.clear();
 
                 for (k = 0; k < nelem; ++k) {
-                    ivec_tmp.index = ind[j][k][0];
-                    ivec_tmp.tran = ind[j][k][1];
-                    ivec_tmp.cell_s = ind[j][k][2];
+                    ivec_tmp.index = ind[iind];
+                    ivec_tmp.tran = ind[iind + 1];
+                    ivec_tmp.cell_s = ind[iind + 2];
+                    iind += 3;
 
                     ivec_array.push_back(ivec_tmp);
                 }
-                force_constant_with_cell[i].emplace_back(fcs_tmp[j],
+                force_constant_with_cell[i].emplace_back(fcs_tmp[ival++],
                                                          ivec_array);
             }
         }
-
-        deallocate(fcs_tmp);
-        deallocate(ind);
     }
+
+    deallocate(buffer);
 }
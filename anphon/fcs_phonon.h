@@ -11,6 +11,7 @@
 #pragma once
 
 #include "pointers.h"
+#include "fcs_binary.h"
 #include <string>
 #include <vector>
 #include <set>
@@ -133,18 +134,44 @@ public:
 
     void setup(std::string);
 
+    // Fill fc2_ext and force_constant_with_cell directly from the
+    // in-memory container exported by ALM::get_fcs_arrays, for drivers
+    // running the fitting and the phonon calculation in one process
+    // without the FCSXML (or *.fcsbin) round-trip.
+    void set_fcs_from_arrays(const FcsArrays &arrays);
+
     unsigned int maxorder;
-    std::string file_fcs, file_fc2;
+    std::string file_fcs, file_fc2, file_fcsbin;
 
     std::vector<FcsArrayWithCell> *force_constant_with_cell;
     std::vector<FcsClassExtent> fc2_ext;
 
+    // Bumped whenever fc2_ext is (re)filled. Consumers holding data
+    // derived from fc2_ext (Dynamical::prepare_fc2_table) record this
+    // stamp and compare it at every use, so a list rebuilt in place is
+    // detected instead of being served from a stale cache.
+    unsigned long fc2_ext_generation;
+
     bool update_fc2;
 
+    // When true (ASR_CHECK tag), the translational invariance is examined
+    // in full even if the binary force-constant file records that the sum
+    // rules were imposed when it was created.
+    bool force_asr_check;
+
 private:
     bool require_cubic;
     bool require_quartic;
 
+    // The harmonic with-cell table (force_constant_with_cell[0]) duplicates
+    // fc2_ext and is consumed only by the NEWFCS writer; every other run
+    // skips decoding and broadcasting it.
+    bool require_fc2_with_cell;
+
+    // Set by load_fcs_binary when the file records that the translational
+    // sum rules were imposed and all table checksums match.
+    bool asr_verified_file;
+
     void set_default_variables();
 
     void deallocate_variables();
@@ -153,6 +180,8 @@ private:
 
     void load_fcs_xml() const;
 
+    void load_fcs_binary();
+
     void examine_translational_invariance(int,
                                           unsigned int,
                                           unsigned int,
@@ -165,5 +194,8 @@ private:
     void MPI_Bcast_fcs_array(unsigned int) const;
 
     void MPI_Bcast_fc2_ext();
+
+    void bcast_packed_buffer(char *buffer,
+                             size_t nbytes) const;
 };
 }
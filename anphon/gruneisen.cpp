@@ -66,6 +66,10 @@ void Gruneisen::deallocate_variables()
     }
     delta_fc2.clear();
     delta_fc3.clear();
+    dfc2_index1.clear();
+    dfc2_index2.clear();
+    for (auto i = 0; i < 3; ++i) dfc2_relvec[i].clear();
+    dfc2_fcs.clear();
 }
 
 void Gruneisen::setup()
@@ -103,6 +107,8 @@ void Gruneisen::setup()
         prepare_delta_fcs(fcs_phonon->force_constant_with_cell[2], delta_fc3, 1);
     }
     if (print_gruneisen) {
+        prepare_dfc2_table();
+
         if (kpoint->kpoint_bs) {
             allocate(gruneisen_bs, kpoint->kpoint_bs->nk, dynamical->neval);
         }
@@ -129,49 +135,80 @@ void Gruneisen::setup()
 void Gruneisen::calc_gruneisen()
 {
     const auto ns = dynamical->neval;
-    std::complex<double> **dfc2_reciprocal;
-
-    allocate(dfc2_reciprocal, ns, ns);
 
     if (mympi->my_rank == 0) {
         std::cout << std::endl;
         std::cout << " GRUNEISEN = 1 : Calculating Gruneisen parameters ... ";
     }
 
+    // The k points are distributed over MPI ranks in a round-robin manner
+    // and over OpenMP threads within each rank; the partial results are
+    // gathered with MPI_Allreduce so that every rank holds the full table.
+
     if (kpoint->kpoint_bs) {
         const auto nk = kpoint->kpoint_bs->nk;
         const auto xk = kpoint->kpoint_bs->xk;
         const auto eval = dynamical->dymat_band->get_eigenvalues();
         const auto evec = dynamical->dymat_band->get_eigenvectors();
 
+        std::complex<double> **gruneisen_loc;
+        allocate(gruneisen_loc, nk, ns);
         for (auto ik = 0; ik < nk; ++ik) {
+            for (auto is = 0; is < ns; ++is) {
+                gruneisen_loc[ik][is] = std::complex<double>(0.0, 0.0);
+            }
+        }
 
-            calc_dfc2_reciprocal(dfc2_reciprocal, xk[ik]);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            std::complex<double> **dfc2_reciprocal;
+            allocate(dfc2_reciprocal, ns, ns);
 
-            for (auto is = 0; is < ns; ++is) {
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int ik = mympi->my_rank; ik < static_cast<int>(nk); ik += mympi->nprocs) {
+
+                calc_dfc2_reciprocal(dfc2_reciprocal, xk[ik]);
 
-                gruneisen_bs[ik][is] = std::complex<double>(0.0, 0.0);
+                for (unsigned int is = 0; is < ns; ++is) {
 
-                for (unsigned int i = 0; i < ns; ++i) {
-                    for (unsigned int j = 0; j < ns; ++j) {
-                        gruneisen_bs[ik][is] += std::conj(evec[ik][is][i])
-                                                * dfc2_reciprocal[i][j]
-                                                * evec[ik][is][j];
+                    auto g_tmp = std::complex<double>(0.0, 0.0);
+
+                    for (unsigned int i = 0; i < ns; ++i) {
+                        for (unsigned int j = 0; j < ns; ++j) {
+                            g_tmp += std::conj(evec[ik][is][i])
+                                     * dfc2_reciprocal[i][j]
+                                     * evec[ik][is][j];
+                        }
                     }
-                }
 
-                const auto gamma_imag = gruneisen_bs[ik][is].imag();
-                if (std::abs(gamma_imag) > eps10) {
-                    warn("calc_gruneisen", "Gruneisen parameter is not real");
-                }
+                    if (std::abs(g_tmp.imag()) > eps10) {
+                        warn("calc_gruneisen", "Gruneisen parameter is not real");
+                    }
 
-                if (std::abs(eval[ik][is]) < eps8) {
-                    gruneisen_bs[ik][is] = 0.0;
-                } else {
-                    gruneisen_bs[ik][is] /= -6.0 * std::pow(eval[ik][is], 2);
+                    if (std::abs(eval[ik][is]) < eps8) {
+                        gruneisen_loc[ik][is] = 0.0;
+                    } else {
+                        gruneisen_loc[ik][is] = g_tmp / (-6.0 * std::pow(eval[ik][is], 2));
+                    }
                 }
             }
+            deallocate(dfc2_reciprocal);
         }
+
+#ifdef MPI_CXX_DOUBLE_COMPLEX
+        MPI_Allreduce(&gruneisen_loc[0][0], &gruneisen_bs[0][0],
+                      static_cast<int>(nk * ns),
+                      MPI_CXX_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+#else
+        MPI_Allreduce(&gruneisen_loc[0][0], &gruneisen_bs[0][0],
+                      static_cast<int>(nk * ns),
+                      MPI_COMPLEX16, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        deallocate(gruneisen_loc);
     }
 
     if (dos->kmesh_dos) {
@@ -180,65 +217,92 @@ void Gruneisen::calc_gruneisen()
         const auto eval = dos->dymat_dos->get_eigenvalues();
         const auto evec = dos->dymat_dos->get_eigenvectors();
 
+        std::complex<double> **gruneisen_loc;
+        allocate(gruneisen_loc, nk, ns);
         for (auto ik = 0; ik < nk; ++ik) {
+            for (auto is = 0; is < ns; ++is) {
+                gruneisen_loc[ik][is] = std::complex<double>(0.0, 0.0);
+            }
+        }
 
-            calc_dfc2_reciprocal(dfc2_reciprocal, xk[ik]);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+            std::complex<double> **dfc2_reciprocal;
+            allocate(dfc2_reciprocal, ns, ns);
 
-            for (auto is = 0; is < ns; ++is) {
+#ifdef _OPENMP
+#pragma omp for
+#endif
+            for (int ik = mympi->my_rank; ik < static_cast<int>(nk); ik += mympi->nprocs) {
+
+                calc_dfc2_reciprocal(dfc2_reciprocal, xk[ik]);
+
+                for (unsigned int is = 0; is < ns; ++is) {
 
-                gruneisen_dos[ik][is] = std::complex<double>(0.0, 0.0);
+                    auto g_tmp = std::complex<double>(0.0, 0.0);
 
-                for (unsigned int i = 0; i < ns; ++i) {
-                    for (unsigned int j = 0; j < ns; ++j) {
-                        gruneisen_dos[ik][is] += std::conj(evec[ik][is][i])
-                                                 * dfc2_reciprocal[i][j]
-                                                 * evec[ik][is][j];
+                    for (unsigned int i = 0; i < ns; ++i) {
+                        for (unsigned int j = 0; j < ns; ++j) {
+                            g_tmp += std::conj(evec[ik][is][i])
+                                     * dfc2_reciprocal[i][j]
+                                     * evec[ik][is][j];
+                        }
                     }
-                }
 
-                const auto gamma_imag = gruneisen_dos[ik][is].imag();
-                if (std::abs(gamma_imag) > eps10) {
-                    warn("calc_gruneisen", "Gruneisen parameter is not real");
-                }
+                    if (std::abs(g_tmp.imag()) > eps10) {
+                        warn("calc_gruneisen", "Gruneisen parameter is not real");
+                    }
 
-                if (std::abs(eval[ik][is]) < eps8) {
-                    gruneisen_dos[ik][is] = 0.0;
-                } else {
-                    gruneisen_dos[ik][is] /= -6.0 * std::pow(eval[ik][is], 2);
+                    if (std::abs(eval[ik][is]) < eps8) {
+                        gruneisen_loc[ik][is] = 0.0;
+                    } else {
+                        gruneisen_loc[ik][is] = g_tmp / (-6.0 * std::pow(eval[ik][is], 2));
+                    }
                 }
             }
+            deallocate(dfc2_reciprocal);
         }
-    }
 
-    deallocate(dfc2_reciprocal);
+#ifdef MPI_CXX_DOUBLE_COMPLEX
+        MPI_Allreduce(&gruneisen_loc[0][0], &gruneisen_dos[0][0],
+                      static_cast<int>(nk * ns),
+                      MPI_CXX_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+#else
+        MPI_Allreduce(&gruneisen_loc[0][0], &gruneisen_dos[0][0],
+                      static_cast<int>(nk * ns),
+                      MPI_COMPLEX16, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        deallocate(gruneisen_loc);
+    }
 
     if (mympi->my_rank == 0) {
         std::cout << "done!" << std::endl;
     }
 }
 
-void Gruneisen::calc_dfc2_reciprocal(std::complex<double> **dphi2,
-                                     const double *xk_in)
+void Gruneisen::prepare_dfc2_table()
 {
     unsigned int i;
-    const auto ns = dynamical->neval;
-
     double vec[3];
 
-    const std::complex<double> im(0.0, 1.0);
+    const auto nelems = delta_fc2.size();
 
-    for (i = 0; i < ns; ++i) {
-        for (unsigned int j = 0; j < ns; ++j) {
-            dphi2[i][j] = std::complex<double>(0.0, 0.0);
-        }
-    }
+    dfc2_index1.clear();
+    dfc2_index2.clear();
+    for (i = 0; i < 3; ++i) dfc2_relvec[i].clear();
+    dfc2_fcs.clear();
+
+    dfc2_index1.reserve(nelems);
+    dfc2_index2.reserve(nelems);
+    for (i = 0; i < 3; ++i) dfc2_relvec[i].reserve(nelems);
+    dfc2_fcs.reserve(nelems);
 
     for (const auto &it: delta_fc2) {
 
         const auto atm1 = it.pairs[0].index / 3;
-        const auto xyz1 = it.pairs[0].index % 3;
         const auto atm2 = it.pairs[1].index / 3;
-        const auto xyz2 = it.pairs[1].index % 3;
 
         const auto tran = it.pairs[1].tran;
         const auto cell_s = it.pairs[1].cell_s;
@@ -254,12 +318,36 @@ void Gruneisen::calc_dfc2_reciprocal(std::complex<double> **dphi2,
         rotvec(vec, vec, system->lavec_s_anharm);
         rotvec(vec, vec, system->rlavec_p);
 
-        double phase = vec[0] * xk_in[0] + vec[1] * xk_in[1] + vec[2] * xk_in[2];
+        dfc2_index1.push_back(it.pairs[0].index);
+        dfc2_index2.push_back(it.pairs[1].index);
+        for (i = 0; i < 3; ++i) dfc2_relvec[i].push_back(vec[i]);
+        dfc2_fcs.push_back(it.fcs_val
+                           / std::sqrt(system->mass_anharm[atm1_s] * system->mass_anharm[atm2_s]));
+    }
+}
+
+void Gruneisen::calc_dfc2_reciprocal(std::complex<double> **dphi2,
+                                     const double *xk_in) const
+{
+    const auto ns = dynamical->neval;
+    const auto nelems = dfc2_fcs.size();
+
+    const std::complex<double> im(0.0, 1.0);
+
+    for (unsigned int i = 0; i < ns; ++i) {
+        for (unsigned int j = 0; j < ns; ++j) {
+            dphi2[i][j] = std::complex<double>(0.0, 0.0);
+        }
+    }
+
+    for (size_t ielem = 0; ielem < nelems; ++ielem) {
 
-        dphi2[3 * atm1 + xyz1][3 * atm2 + xyz2]
-                += it.fcs_val * std::exp(im * phase)
-                   / std::sqrt(system->mass_anharm[atm1_s] * system->mass_anharm[atm2_s]);
+        const auto phase = dfc2_relvec[0][ielem] * xk_in[0]
+                           + dfc2_relvec[1][ielem] * xk_in[1]
+                           + dfc2_relvec[2][ielem] * xk_in[2];
 
+        dphi2[dfc2_index1[ielem]][dfc2_index2[ielem]]
+                += dfc2_fcs[ielem] * std::exp(im * phase);
     }
 }
 
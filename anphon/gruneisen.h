@@ -119,8 +119,18 @@ private:
     // void impose_ASR_on_harmonic_IFC(std::vector<FcsArrayWithCell> &,
     //                    int);
 
+    // Structure-of-arrays copy of delta_fc2 used by calc_dfc2_reciprocal():
+    // dynamical-matrix indices, Cartesian relative vectors entering the
+    // phase factor, and mass-weighted force constants packed contiguously
+    // so that the per-k contraction streams through memory.
+    std::vector<int> dfc2_index1, dfc2_index2;
+    std::vector<double> dfc2_relvec[3];
+    std::vector<double> dfc2_fcs;
+
+    void prepare_dfc2_table();
+
     void calc_dfc2_reciprocal(std::complex<double> **,
-                              const double *);
+                              const double *) const;
 
     void write_new_fcsxml(const std::string &,
                           double);
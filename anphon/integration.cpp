@@ -15,6 +15,7 @@
 #include "mathfunctions.h"
 #include "memory.h"
 #include "system.h"
+#include "timer.h"
 #include <iomanip>
 #include <vector>
 #include <algorithm>
@@ -56,6 +57,10 @@ void Integration::setup_integration()
         } else if (ismear == 1) {
             std::cout << " ISMEAR = 1: Gaussian broadening with epsilon = "
                       << std::fixed << std::setprecision(2) << epsilon << " (cm^-1)" << std::endl;
+        } else if (ismear == 2) {
+            std::cout << " ISMEAR = 2: Adaptive Gaussian broadening." << std::endl;
+            std::cout << "             The width of each delta function is estimated" << std::endl;
+            std::cout << "             from the group velocities of the phonon modes." << std::endl;
         } else {
             exit("setup_relaxation", "Invalid ksum_mode");
         }
@@ -236,14 +241,30 @@ void Integration::calc_weight_tetrahedron(const unsigned int nk_irreducible,
                                           const unsigned int ntetra,
                                           const unsigned int *const *tetras,
                                           double *weight) const
+{
+    TetraSortedEnergies sorted_tmp;
+
+    prepare_sorted_tetrahedra(map_to_irreducible_k,
+                              energy,
+                              ntetra,
+                              tetras,
+                              sorted_tmp);
+
+    calc_weight_tetrahedron_sorted(nk_irreducible, sorted_tmp, e_ref, weight);
+}
+
+void Integration::prepare_sorted_tetrahedra(const unsigned int *map_to_irreducible_k,
+                                            const double *energy,
+                                            const unsigned int ntetra,
+                                            const unsigned int *const *tetras,
+                                            TetraSortedEnergies &sorted_out) const
 {
     int i;
 
-    double g;
     double e_tmp[4];
     int sort_arg[4], kindex[4];
 
-    for (i = 0; i < nk_irreducible; ++i) weight[i] = 0.0;
+    sorted_out.resize(ntetra);
 
     for (i = 0; i < ntetra; ++i) {
 
@@ -253,15 +274,50 @@ void Integration::calc_weight_tetrahedron(const unsigned int nk_irreducible,
         }
 
         insertion_sort(e_tmp, sort_arg, 4);
-        const auto e1 = e_tmp[0];
-        const auto e2 = e_tmp[1];
-        const auto e3 = e_tmp[2];
-        const auto e4 = e_tmp[3];
-
-        const auto k1 = kindex[sort_arg[0]];
-        const auto k2 = kindex[sort_arg[1]];
-        const auto k3 = kindex[sort_arg[2]];
-        const auto k4 = kindex[sort_arg[3]];
+
+        for (int j = 0; j < 4; ++j) {
+            sorted_out.e[j][i] = e_tmp[j];
+            sorted_out.kindex[j][i] = kindex[sort_arg[j]];
+        }
+    }
+}
+
+void Integration::calc_weight_tetrahedron_sorted(const unsigned int nk_irreducible,
+                                                 const TetraSortedEnergies &sorted_in,
+                                                 const double e_ref,
+                                                 double *weight) const
+{
+    int i;
+
+    double g;
+
+    count_event(EVENT_TETRAHEDRON);
+
+    const auto ntetra = static_cast<unsigned int>(sorted_in.e[0].size());
+
+    const double *e1_arr = sorted_in.e[0].data();
+    const double *e2_arr = sorted_in.e[1].data();
+    const double *e3_arr = sorted_in.e[2].data();
+    const double *e4_arr = sorted_in.e[3].data();
+
+    for (i = 0; i < nk_irreducible; ++i) weight[i] = 0.0;
+
+    for (i = 0; i < ntetra; ++i) {
+
+        const auto e1 = e1_arr[i];
+        const auto e4 = e4_arr[i];
+
+        // Most tetrahedra do not bracket the reference energy; reject them
+        // before touching the remaining corner data.
+        if (e_ref < e1 || e_ref >= e4) continue;
+
+        const auto e2 = e2_arr[i];
+        const auto e3 = e3_arr[i];
+
+        const auto k1 = sorted_in.kindex[0][i];
+        const auto k2 = sorted_in.kindex[1][i];
+        const auto k3 = sorted_in.kindex[2][i];
+        const auto k4 = sorted_in.kindex[3][i];
 
         auto I1 = 0.0;
         auto I2 = 0.0;
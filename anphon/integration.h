@@ -78,13 +78,32 @@ private:
     unsigned int **tetras;
 };
 
+class TetraSortedEnergies {
+public:
+    // Corner energies of all tetrahedra sorted in ascending order together
+    // with the irreducible k index of each sorted corner, stored as one
+    // contiguous array per corner rank. Prepared once per energy array and
+    // reused for every reference energy, which removes the per-query
+    // corner sort from the tetrahedron weight evaluation.
+    std::vector<double> e[4];
+    std::vector<int> kindex[4];
+
+    void resize(const unsigned int ntetra)
+    {
+        for (auto i = 0; i < 4; ++i) {
+            e[i].resize(ntetra);
+            kindex[i].resize(ntetra);
+        }
+    }
+};
+
 class Integration : protected Pointers {
 public:
     Integration(class PHON *);
 
     ~Integration();
 
-    int ismear; // ismear = -1: tetrahedron, ismear = 0: gaussian
+    int ismear; // ismear = -1: tetrahedron, 0: lorentzian, 1: gaussian, 2: adaptive gaussian
     double epsilon;
 
     void setup_integration();
@@ -103,6 +122,17 @@ public:
                                  const unsigned int *const *tetras,
                                  double *weight) const;
 
+    void prepare_sorted_tetrahedra(const unsigned int *map_to_irreducible_k,
+                                   const double *energy,
+                                   const unsigned int ntetra,
+                                   const unsigned int *const *tetras,
+                                   TetraSortedEnergies &sorted_out) const;
+
+    void calc_weight_tetrahedron_sorted(const unsigned int nk_irreducible,
+                                        const TetraSortedEnergies &sorted_in,
+                                        const double e_ref,
+                                        double *weight) const;
+
     void calc_weight_smearing(const unsigned int nk,
                               const unsigned int nk_irreducible,
                               const unsigned int *map_to_irreducible_k,
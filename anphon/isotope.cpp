@@ -104,89 +104,38 @@ void Isotope::calc_isotope_selfenergy(const unsigned int knum,
     const auto natmin = system->natmin;
     const auto epsilon = integration->epsilon;
 
-    ret = 0.0;
+    auto ret_sum = 0.0;
 
-    for (auto ik = 0; ik < nk; ++ik) {
-        for (auto is = 0; is < ns; ++is) {
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+: ret_sum)
+#endif
+    for (long ib = 0; ib < static_cast<long>(nk) * ns; ++ib) {
 
-            auto prod = 0.0;
+        const auto ik = ib / ns;
+        const auto is = ib % ns;
 
-            for (auto iat = 0; iat < natmin; ++iat) {
+        auto prod = 0.0;
 
-                auto dprod = std::complex<double>(0.0, 0.0);
-                for (auto icrd = 0; icrd < 3; ++icrd) {
-                    dprod += std::conj(evec_in[ik][is][3 * iat + icrd])
-                             * evec_in[knum][snum][3 * iat + icrd];
-                }
-                prod += isotope_factor[system->kd[system->map_p2s[iat][0]]] * std::norm(dprod);
-            }
+        for (auto iat = 0; iat < natmin; ++iat) {
 
-            const auto omega1 = eval_in[ik][is];
-
-            if (integration->ismear == 0) {
-                ret += omega1 * delta_lorentz(omega - omega1, epsilon) * prod;
-            } else {
-                ret += omega1 * delta_gauss(omega - omega1, epsilon) * prod;
+            auto dprod = std::complex<double>(0.0, 0.0);
+            for (auto icrd = 0; icrd < 3; ++icrd) {
+                dprod += std::conj(evec_in[ik][is][3 * iat + icrd])
+                         * evec_in[knum][snum][3 * iat + icrd];
             }
+            prod += isotope_factor[system->kd[system->map_p2s[iat][0]]] * std::norm(dprod);
         }
-    }
-
-    ret *= pi * omega * 0.25 / static_cast<double>(nk);
-}
-
-void Isotope::calc_isotope_selfenergy_tetra(const unsigned int knum,
-                                            const unsigned int snum,
-                                            const double omega,
-                                            const KpointMeshUniform *kmesh_in,
-                                            const double *const *eval_in,
-                                            const std::complex<double> *const *const *evec_in,
-                                            double &ret) const
-{
-    // Compute phonon selfenergy of phonon (knum, snum)
-    // due to phonon-isotope scatterings.
-    // This version employs the tetrahedron method.
-
-    int ik, is;
-    const auto nk = kmesh_in->nk;
-    const auto ns = dynamical->neval;
-    const auto natmin = system->natmin;
-
-    ret = 0.0;
-
-    double *eval;
-    double *weight;
 
-    allocate(eval, nk);
-    allocate(weight, nk);
+        const auto omega1 = eval_in[ik][is];
 
-    for (is = 0; is < ns; ++is) {
-        for (ik = 0; ik < nk; ++ik) {
-
-            auto prod = 0.0;
-
-            for (auto iat = 0; iat < natmin; ++iat) {
-
-                auto dprod = std::complex<double>(0.0, 0.0);
-                for (auto icrd = 0; icrd < 3; ++icrd) {
-                    dprod += std::conj(evec_in[ik][is][3 * iat + icrd])
-                             * evec_in[knum][snum][3 * iat + icrd];
-                }
-                prod += isotope_factor[system->kd[system->map_p2s[iat][0]]] * std::norm(dprod);
-            }
-
-            weight[ik] = prod * eval_in[ik][is];
-            eval[ik] = eval_in[ik][is];
+        if (integration->ismear == 0) {
+            ret_sum += omega1 * delta_lorentz(omega - omega1, epsilon) * prod;
+        } else {
+            ret_sum += omega1 * delta_gauss(omega - omega1, epsilon) * prod;
         }
-        ret += integration->do_tetrahedron(eval, weight,
-                                           dos->tetra_nodes_dos->get_ntetra(),
-                                           dos->tetra_nodes_dos->get_tetras(),
-                                           omega);
     }
 
-    ret *= pi * omega * 0.25;
-
-    deallocate(eval);
-    deallocate(weight);
+    ret = ret_sum * pi * omega * 0.25 / static_cast<double>(nk);
 }
 
 void Isotope::calc_isotope_selfenergy_all() const
@@ -213,19 +162,97 @@ void Isotope::calc_isotope_selfenergy_all() const
 
         for (i = 0; i < nks; ++i) gamma_loc[i] = 0.0;
 
-        for (i = mympi->my_rank; i < nks; i += mympi->nprocs) {
-            const auto knum = dos->kmesh_dos->kpoint_irred_all[i / ns][0].knum;
-            const auto snum = i % ns;
-            const auto omega = dos->dymat_dos->get_eigenvalues()[knum][snum];
-            if (integration->ismear == -1) {
-                calc_isotope_selfenergy_tetra(knum,
-                                              snum,
-                                              omega,
-                                              dos->kmesh_dos,
-                                              dos->dymat_dos->get_eigenvalues(),
-                                              dos->dymat_dos->get_eigenvectors(),
-                                              tmp);
-            } else {
+        if (integration->ismear == -1) {
+
+            // Tetrahedron method. The energies of one band are common to
+            // every target mode, so the tetrahedron corners are sorted
+            // once per band and reused for all targets of this rank; the
+            // targets then parallelize over OpenMP threads, and k points
+            // with exactly zero weight skip the eigenvector overlap.
+
+            const auto eval_in = dos->dymat_dos->get_eigenvalues();
+            const auto evec_in = dos->dymat_dos->get_eigenvectors();
+            const auto nk = dos->kmesh_dos->nk;
+            const auto natmin = system->natmin;
+
+            std::vector<int> targets;
+            for (i = mympi->my_rank; i < nks; i += mympi->nprocs) {
+                targets.push_back(i);
+            }
+            const auto ntargets = static_cast<long>(targets.size());
+
+            unsigned int *kmap_identity;
+            double *eval_band;
+            allocate(kmap_identity, nk);
+            allocate(eval_band, nk);
+            for (i = 0; i < nk; ++i) kmap_identity[i] = i;
+
+            TetraSortedEnergies sorted_tetra;
+
+            for (unsigned int is = 0; is < ns; ++is) {
+
+                for (i = 0; i < nk; ++i) eval_band[i] = eval_in[i][is];
+
+                integration->prepare_sorted_tetrahedra(kmap_identity,
+                                                       eval_band,
+                                                       dos->tetra_nodes_dos->get_ntetra(),
+                                                       dos->tetra_nodes_dos->get_tetras(),
+                                                       sorted_tetra);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+                {
+                    double *weight;
+                    allocate(weight, nk);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+                    for (long it = 0; it < ntargets; ++it) {
+
+                        const auto iks = targets[it];
+                        const auto knum = dos->kmesh_dos->kpoint_irred_all[iks / ns][0].knum;
+                        const auto snum = iks % ns;
+                        const auto omega = eval_in[knum][snum];
+
+                        integration->calc_weight_tetrahedron_sorted(nk,
+                                                                    sorted_tetra,
+                                                                    omega,
+                                                                    weight);
+
+                        auto ret_tmp = 0.0;
+
+                        for (auto ik = 0; ik < nk; ++ik) {
+
+                            if (weight[ik] == 0.0) continue;
+
+                            auto prod = 0.0;
+
+                            for (auto iat = 0; iat < natmin; ++iat) {
+
+                                auto dprod = std::complex<double>(0.0, 0.0);
+                                for (auto icrd = 0; icrd < 3; ++icrd) {
+                                    dprod += std::conj(evec_in[ik][is][3 * iat + icrd])
+                                             * evec_in[knum][snum][3 * iat + icrd];
+                                }
+                                prod += isotope_factor[system->kd[system->map_p2s[iat][0]]] * std::norm(dprod);
+                            }
+                            ret_tmp += weight[ik] * prod * eval_band[ik];
+                        }
+                        gamma_loc[iks] += pi * omega * 0.25 * ret_tmp;
+                    }
+                    deallocate(weight);
+                }
+            }
+            deallocate(kmap_identity);
+            deallocate(eval_band);
+
+        } else {
+            for (i = mympi->my_rank; i < nks; i += mympi->nprocs) {
+                const auto knum = dos->kmesh_dos->kpoint_irred_all[i / ns][0].knum;
+                const auto snum = i % ns;
+                const auto omega = dos->dymat_dos->get_eigenvalues()[knum][snum];
                 calc_isotope_selfenergy(knum,
                                         snum,
                                         omega,
@@ -233,8 +260,8 @@ void Isotope::calc_isotope_selfenergy_all() const
                                         dos->dymat_dos->get_eigenvalues(),
                                         dos->dymat_dos->get_eigenvectors(),
                                         tmp);
+                gamma_loc[i] = tmp;
             }
-            gamma_loc[i] = tmp;
         }
 
         MPI_Reduce(&gamma_loc[0], &gamma_tmp[0], nks,
@@ -42,14 +42,6 @@ private:
                                  const std::complex<double> *const *const *evec_in,
                                  double &ret) const;
 
-    void calc_isotope_selfenergy_tetra(const unsigned int knum,
-                                       const unsigned int snum,
-                                       const double omega,
-                                       const KpointMeshUniform *kmesh_in,
-                                       const double *const *eval_in,
-                                       const std::complex<double> *const *const *evec_in,
-                                       double &ret) const;
-
     void set_isotope_factor_from_database(const int,
                                           const std::string *,
                                           double *);
@@ -20,6 +20,9 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <set>
 #include <map>
 #include <algorithm>
@@ -44,6 +47,7 @@ void Kpoint::set_default_variables()
     kp_planes_tri = nullptr;
     kpoint_bs = nullptr;
     kpoint_general = nullptr;
+    file_kmesh_cache = "";
 }
 
 void Kpoint::deallocate_variables()
@@ -146,10 +150,13 @@ void Kpoint::kpoint_setups(const std::string mode)
                 }
             }
             MPI_Bcast(&nk_tmp[0], 3, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+            mympi->MPI_Bcast_string(file_kmesh_cache, 0, MPI_COMM_WORLD);
             dos->kmesh_dos = new KpointMeshUniform(nk_tmp);
             dos->kmesh_dos->setup(symmetry->SymmList,
                                   system->rlavec_p,
-                                  symmetry->time_reversal_sym);
+                                  symmetry->time_reversal_sym,
+                                  file_kmesh_cache,
+                                  mympi->my_rank == 0);
 
             if (mympi->my_rank == 0) {
                 std::cout << "  Gamma-centered uniform grid with the following mesh density: " << std::endl;
@@ -341,11 +348,29 @@ void Kpoint::setup_kpoint_band(const std::vector<KpointInp> &kpinfo,
 
 void KpointMeshUniform::setup(const std::vector<SymmetryOperation> &symmlist,
                               const double rlavec_p[3][3],
-                              const bool time_reversal_symmetry)
+                              const bool time_reversal_symmetry,
+                              const std::string &file_cache,
+                              const bool allow_write_cache)
 {
     const bool usesym = true;
 
-    gen_kmesh(symmlist, usesym, time_reversal_symmetry);
+    // The symmetry reduction of the mesh scales as nk * nsym and is
+    // recomputed identically on every restart of the same system, so the
+    // resulting tables can be cached in a binary sidecar file keyed by a
+    // hash of the symmetry operations, reciprocal lattice and mesh.
+    std::uint64_t cache_key = 0;
+    auto cache_loaded = false;
+
+    if (!file_cache.empty()) {
+        cache_key = mesh_cache_key(symmlist, rlavec_p, time_reversal_symmetry);
+        cache_loaded = load_mesh_cache(file_cache, cache_key);
+    }
+
+    if (cache_loaded) {
+        gen_kmesh_grid();
+    } else {
+        gen_kmesh(symmlist, usesym, time_reversal_symmetry);
+    }
 
     for (auto i = 0; i < nk; ++i) {
         for (auto j = 0; j < 3; ++j) kvec_na[i][j] = xk[i][j];
@@ -367,7 +392,7 @@ void KpointMeshUniform::setup(const std::vector<SymmetryOperation> &symmlist,
                 = static_cast<double>(kpoint_irred_all[i].size())
                   / static_cast<double>(nk);
     }
-    gen_nkminus();
+    if (!cache_loaded) gen_nkminus();
 
     kmap_to_irreducible.resize(nk);
     for (auto i = 0; i < nk_irred; ++i) {
@@ -376,8 +401,14 @@ void KpointMeshUniform::setup(const std::vector<SymmetryOperation> &symmlist,
         }
     }
     // Compute small group of every irreducible k points for later use
-    small_group_of_k.resize(nk_irred);
-    set_small_groups_k_irred(usesym, symmlist);
+    if (!cache_loaded) {
+        small_group_of_k.resize(nk_irred);
+        set_small_groups_k_irred(usesym, symmlist);
+
+        if (!file_cache.empty() && allow_write_cache) {
+            save_mesh_cache(file_cache, cache_key);
+        }
+    }
 }
 
 void KpointMeshUniform::gen_kmesh(const std::vector<SymmetryOperation> &symmlist,
@@ -416,22 +447,179 @@ void KpointMeshUniform::gen_kmesh(const std::vector<SymmetryOperation> &symmlist
     deallocate(xkr);
 }
 
+void KpointMeshUniform::gen_kmesh_grid()
+{
+    // Regenerate only the (wrapped) grid coordinates; used when the
+    // reduction tables come from the cache file.
+
+    for (unsigned int ix = 0; ix < nk_i[0]; ++ix) {
+        for (unsigned int iy = 0; iy < nk_i[1]; ++iy) {
+            for (unsigned int iz = 0; iz < nk_i[2]; ++iz) {
+                const auto ik = iz + iy * nk_i[2] + ix * nk_i[2] * nk_i[1];
+                xk[ik][0] = static_cast<double>(ix) / static_cast<double>(nk_i[0]);
+                xk[ik][1] = static_cast<double>(iy) / static_cast<double>(nk_i[1]);
+                xk[ik][2] = static_cast<double>(iz) / static_cast<double>(nk_i[2]);
+                for (unsigned int i = 0; i < 3; ++i) {
+                    xk[ik][i] -= static_cast<double>(nint(xk[ik][i]));
+                }
+            }
+        }
+    }
+}
+
+std::uint64_t KpointMeshUniform::mesh_cache_key(const std::vector<SymmetryOperation> &symmlist,
+                                                const double rlavec_p[3][3],
+                                                const bool time_reversal_symmetry) const
+{
+    // FNV-1a hash over everything the reduction tables depend on: the
+    // mesh, the time-reversal flag, the symmetry operations and the
+    // reciprocal lattice. A stale sidecar file of a different system or
+    // mesh therefore never matches.
+
+    std::uint64_t hash = 14695981039346656037ULL;
+
+    auto feed = [&hash](const void *data, const std::size_t nbytes) {
+        const auto *p = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < nbytes; ++i) {
+            hash ^= static_cast<std::uint64_t>(p[i]);
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    feed(&nk_i[0], sizeof(nk_i));
+    const std::uint32_t trs = time_reversal_symmetry ? 1 : 0;
+    feed(&trs, sizeof(trs));
+    const auto nsym = static_cast<std::uint32_t>(symmlist.size());
+    feed(&nsym, sizeof(nsym));
+    for (const auto &symm: symmlist) {
+        feed(&symm.rot[0][0], sizeof(symm.rot));
+        feed(&symm.tran[0], sizeof(symm.tran));
+    }
+    feed(&rlavec_p[0][0], 9 * sizeof(double));
+
+    return hash;
+}
+
+namespace {
+const char kmesh_cache_magic[8] = {'A', 'L', 'M', 'K', 'M', 'E', 'S', 'H'};
+const std::uint32_t kmesh_cache_version = 1;
+}
+
+bool KpointMeshUniform::load_mesh_cache(const std::string &file_cache,
+                                        const std::uint64_t key)
+{
+    std::ifstream ifs(file_cache.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs) return false;
+
+    char magic[8];
+    std::uint32_t version, nk_in, nk_irred_in, count;
+
+    ifs.read(magic, sizeof(magic));
+    if (!ifs || std::memcmp(magic, kmesh_cache_magic, sizeof(magic)) != 0) return false;
+    ifs.read(reinterpret_cast<char *>(&version), sizeof(version));
+    if (!ifs || version != kmesh_cache_version) return false;
+
+    std::uint64_t key_in;
+    ifs.read(reinterpret_cast<char *>(&key_in), sizeof(key_in));
+    if (!ifs || key_in != key) return false;
+
+    ifs.read(reinterpret_cast<char *>(&nk_in), sizeof(nk_in));
+    ifs.read(reinterpret_cast<char *>(&nk_irred_in), sizeof(nk_irred_in));
+    if (!ifs || nk_in != nk) return false;
+
+    kpoint_irred_all.clear();
+    kpoint_irred_all.resize(nk_irred_in);
+
+    std::uint32_t knum_in;
+    double kval_in[3];
+    std::vector<double> ktmp;
+
+    for (auto &k_group: kpoint_irred_all) {
+        ifs.read(reinterpret_cast<char *>(&count), sizeof(count));
+        if (!ifs) return false;
+        for (std::uint32_t j = 0; j < count; ++j) {
+            ifs.read(reinterpret_cast<char *>(&knum_in), sizeof(knum_in));
+            ifs.read(reinterpret_cast<char *>(&kval_in[0]), sizeof(kval_in));
+            ktmp.assign(kval_in, kval_in + 3);
+            k_group.emplace_back(knum_in, ktmp);
+        }
+    }
+
+    kindex_minus_xk.resize(nk);
+    ifs.read(reinterpret_cast<char *>(&kindex_minus_xk[0]),
+             nk * sizeof(unsigned int));
+
+    small_group_of_k.clear();
+    small_group_of_k.resize(nk_irred_in);
+    for (auto &small_group: small_group_of_k) {
+        ifs.read(reinterpret_cast<char *>(&count), sizeof(count));
+        if (!ifs) return false;
+        small_group.resize(count);
+        if (count > 0) {
+            ifs.read(reinterpret_cast<char *>(&small_group[0]),
+                     count * sizeof(int));
+        }
+    }
+
+    return static_cast<bool>(ifs);
+}
+
+void KpointMeshUniform::save_mesh_cache(const std::string &file_cache,
+                                        const std::uint64_t key) const
+{
+    // Write to a temporary file first so an interrupted run never leaves
+    // a truncated cache behind.
+
+    const auto file_tmp = file_cache + ".tmp";
+
+    std::ofstream ofs(file_tmp.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs) return;
+
+    ofs.write(kmesh_cache_magic, sizeof(kmesh_cache_magic));
+    ofs.write(reinterpret_cast<const char *>(&kmesh_cache_version),
+              sizeof(kmesh_cache_version));
+    ofs.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    ofs.write(reinterpret_cast<const char *>(&nk), sizeof(nk));
+    const auto nk_irred_out = static_cast<std::uint32_t>(kpoint_irred_all.size());
+    ofs.write(reinterpret_cast<const char *>(&nk_irred_out), sizeof(nk_irred_out));
+
+    std::uint32_t count, knum_out;
+
+    for (const auto &k_group: kpoint_irred_all) {
+        count = k_group.size();
+        ofs.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        for (const auto &kp: k_group) {
+            knum_out = kp.knum;
+            ofs.write(reinterpret_cast<const char *>(&knum_out), sizeof(knum_out));
+            ofs.write(reinterpret_cast<const char *>(&kp.kval[0]), 3 * sizeof(double));
+        }
+    }
+
+    ofs.write(reinterpret_cast<const char *>(&kindex_minus_xk[0]),
+              nk * sizeof(unsigned int));
+
+    for (const auto &small_group: small_group_of_k) {
+        count = small_group.size();
+        ofs.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        if (count > 0) {
+            ofs.write(reinterpret_cast<const char *>(&small_group[0]),
+                      count * sizeof(int));
+        }
+    }
+
+    ofs.close();
+    if (ofs) std::rename(file_tmp.c_str(), file_cache.c_str());
+}
+
 void KpointMeshUniform::reduce_kpoints(const unsigned int nsym,
                                        const std::vector<SymmetryOperation> &symmlist,
                                        const bool time_reversal_symmetry,
                                        double **xkr)
 {
-    unsigned int ik;
     unsigned int i, j;
     int isym;
 
-    bool *k_found;
-
-    std::vector<KpointList> k_group;
-    std::vector<double> ktmp;
-
     double srot[3][3];
-    double xk_sym[3], xk_orig[3];
     double srot_inv[3][3], srot_inv_t[3][3];
 
     double ***symop_k;
@@ -458,34 +646,84 @@ void KpointMeshUniform::reduce_kpoints(const unsigned int nsym,
 
     kpoint_irred_all.clear();
 
-    allocate(k_found, nk);
-
-    for (ik = 0; ik < nk; ++ik) k_found[ik] = false;
+    // Distinct symmetry orbits never share a member (the operations form
+    // a group), so the orbit of every k point can be computed without
+    // looking at the others: first locate the smallest symmetry image of
+    // each point, which is the representative its serial first-found scan
+    // would have chosen, then build the member list of every
+    // representative. Both loops parallelize over k and get_knum indexes
+    // the uniform grid directly, so no search is involved.
+    std::vector<int> rep(nk);
 
-    for (ik = 0; ik < nk; ++ik) {
+#ifdef _OPENMP
+#pragma omp parallel for private(i, isym) schedule(static)
+#endif
+    for (int jk = 0; jk < nk; ++jk) {
 
-        if (k_found[ik]) continue;
+        double xk_orig[3], xk_sym[3];
 
-        k_group.clear();
+        for (i = 0; i < 3; ++i) xk_orig[i] = xkr[jk][i];
 
-        for (i = 0; i < 3; ++i) xk_orig[i] = xkr[ik][i];
+        auto minloc = jk;
 
         for (isym = 0; isym < nsym; ++isym) {
 
             rotvec(xk_sym, xk_orig, symop_k[isym]);
-
             for (i = 0; i < 3; ++i) xk_sym[i] = xk_sym[i] - nint(xk_sym[i]);
 
-            int nloc = get_knum(xk_sym);
+            auto nloc = get_knum(xk_sym);
+            if (nloc != -1 && nloc < minloc) minloc = nloc;
 
-            if (nloc == -1) {
+            if (time_reversal_symmetry) {
+                for (i = 0; i < 3; ++i) xk_sym[i] *= -1.0;
 
-                //     exit("reduce_kpoints", "Cannot find the kpoint");
+                nloc = get_knum(xk_sym);
+                if (nloc != -1 && nloc < minloc) minloc = nloc;
+            }
+        }
+        rep[jk] = minloc;
+    }
 
-            } else {
+    std::vector<int> rep_list;
+    for (int jk = 0; jk < nk; ++jk) {
+        if (rep[jk] == jk) rep_list.push_back(jk);
+    }
 
-                if (!k_found[nloc]) {
-                    k_found[nloc] = true;
+    const auto ngroup = rep_list.size();
+    kpoint_irred_all.resize(ngroup);
+
+#ifdef _OPENMP
+#pragma omp parallel private(i, isym)
+#endif
+    {
+        std::vector<int> members;
+        std::vector<KpointList> k_group;
+        std::vector<double> ktmp;
+        double xk_orig[3], xk_sym[3];
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 8)
+#endif
+        for (long igroup = 0; igroup < ngroup; ++igroup) {
+
+            const auto ik = rep_list[igroup];
+
+            k_group.clear();
+            members.clear();
+
+            for (i = 0; i < 3; ++i) xk_orig[i] = xkr[ik][i];
+
+            for (isym = 0; isym < nsym; ++isym) {
+
+                rotvec(xk_sym, xk_orig, symop_k[isym]);
+
+                for (i = 0; i < 3; ++i) xk_sym[i] = xk_sym[i] - nint(xk_sym[i]);
+
+                int nloc = get_knum(xk_sym);
+
+                if (nloc != -1
+                    && std::find(members.begin(), members.end(), nloc) == members.end()) {
+                    members.push_back(nloc);
                     ktmp.clear();
                     ktmp.push_back(xk_sym[0]);
                     ktmp.push_back(xk_sym[1]);
@@ -494,24 +732,17 @@ void KpointMeshUniform::reduce_kpoints(const unsigned int nsym,
                     k_group.emplace_back(nloc, ktmp);
                 }
 
-            }
+                // Time-reversal symmetry
 
-            // Time-reversal symmetry
+                if (time_reversal_symmetry) {
 
-            if (time_reversal_symmetry) {
+                    for (i = 0; i < 3; ++i) xk_sym[i] *= -1.0;
 
-                for (i = 0; i < 3; ++i) xk_sym[i] *= -1.0;
-
-                nloc = get_knum(xk_sym);
+                    nloc = get_knum(xk_sym);
 
-                if (nloc == -1) {
-
-                    //     exit("reduce_kpoints", "Cannot find the kpoint");
-
-                } else {
-
-                    if (!k_found[nloc]) {
-                        k_found[nloc] = true;
+                    if (nloc != -1
+                        && std::find(members.begin(), members.end(), nloc) == members.end()) {
+                        members.push_back(nloc);
                         ktmp.clear();
                         ktmp.push_back(xk_sym[0]);
                         ktmp.push_back(xk_sym[1]);
@@ -521,11 +752,10 @@ void KpointMeshUniform::reduce_kpoints(const unsigned int nsym,
                     }
                 }
             }
+            kpoint_irred_all[igroup] = k_group;
         }
-        kpoint_irred_all.push_back(k_group);
     }
 
-    deallocate(k_found);
     deallocate(symop_k);
 }
 
@@ -1127,6 +1357,31 @@ void KpointMeshUniform::get_unique_triplet_k(const int ik,
     deallocate(flag_found);
 }
 
+const std::vector<KsListGroup> &KpointMeshUniform::get_unique_triplet_k_cached(const int ik,
+                                                                              const std::vector<SymmetryOperation> &symmlist,
+                                                                              const bool use_triplet_symmetry,
+                                                                              const bool use_permutation_symmetry,
+                                                                              const int sign) const
+{
+    const auto flags = (use_triplet_symmetry ? 1 : 0)
+                       + (use_permutation_symmetry ? 2 : 0);
+
+    if (ik != triplet_cache_ik
+        || flags != triplet_cache_flags
+        || sign != triplet_cache_sign) {
+        get_unique_triplet_k(ik,
+                             symmlist,
+                             use_triplet_symmetry,
+                             use_permutation_symmetry,
+                             triplet_cache,
+                             sign);
+        triplet_cache_ik = ik;
+        triplet_cache_flags = flags;
+        triplet_cache_sign = sign;
+    }
+    return triplet_cache;
+}
+
 void KpointMeshUniform::get_unique_quartet_k(const int ik,
                                              const std::vector<SymmetryOperation> &symmlist,
                                              const bool use_quartet_symmetry,
@@ -13,6 +13,7 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include "pointers.h"
 #include "memory.h"
 #include "symmetry_core.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -216,9 +217,15 @@ public:
     std::vector<std::vector<int>> small_group_of_k;
     std::vector<unsigned int> kindex_minus_xk;
 
+    // When file_cache is given, the irreducible reduction tables are
+    // loaded from that binary sidecar file if it matches the current
+    // structure and mesh, and written to it (tmpfile + rename) otherwise.
+    // Writing should be enabled on one MPI rank only.
     void setup(const std::vector<SymmetryOperation> &symmlist,
                const double rlavec_p[3][3],
-               const bool time_reversal_symmetry = true);
+               const bool time_reversal_symmetry = true,
+               const std::string &file_cache = "",
+               const bool allow_write_cache = true);
 
     int get_knum(const double xk[3]) const;
 
@@ -231,6 +238,17 @@ public:
                               std::vector<KsListGroup> &triplet,
                               const int sign = -1) const;
 
+    // Memoized variant: the reduced triplet list of the last queried
+    // (ik, flags, sign) is kept and returned by reference, so the band
+    // and temperature loops of one irreducible k point rebuild it only
+    // once instead of on every call. Not thread safe; call outside
+    // OpenMP parallel regions.
+    const std::vector<KsListGroup> &get_unique_triplet_k_cached(const int ik,
+                                                                const std::vector<SymmetryOperation> &symmlist,
+                                                                const bool use_triplet_symmetry,
+                                                                const bool use_permutation_symmetry,
+                                                                const int sign = -1) const;
+
     void get_unique_quartet_k(const int ik,
                               const std::vector<SymmetryOperation> &symmlist,
                               const bool use_quartet_symmetry,
@@ -244,6 +262,18 @@ private:
                    const bool usesym,
                    const bool time_reversal_symmetry);
 
+    void gen_kmesh_grid();
+
+    std::uint64_t mesh_cache_key(const std::vector<SymmetryOperation> &symmlist,
+                                 const double rlavec_p[3][3],
+                                 const bool time_reversal_symmetry) const;
+
+    bool load_mesh_cache(const std::string &file_cache,
+                         const std::uint64_t key);
+
+    void save_mesh_cache(const std::string &file_cache,
+                         const std::uint64_t key) const;
+
     void reduce_kpoints(const unsigned int nsym,
                         const std::vector<SymmetryOperation> &symmlist,
                         const bool time_reversal_symmetry,
@@ -258,6 +288,10 @@ private:
                                           const bool usesym,
                                           const std::vector<SymmetryOperation> &symmlist) const;
 
+    mutable std::vector<KsListGroup> triplet_cache;
+    mutable int triplet_cache_ik = -1;
+    mutable int triplet_cache_flags = -1;
+    mutable int triplet_cache_sign = 0;
 };
 
 class KpointBandStructure {
@@ -325,6 +359,10 @@ public:
 
     int kpoint_mode;
 
+    // Sidecar file caching the irreducible k-point tables of the uniform
+    // mesh (KMESH_CACHE = 1). Empty when the cache is disabled.
+    std::string file_kmesh_cache;
+
     std::vector<KpointInp> kpInp;
 
     std::vector<KpointPlane> *kp_planes;
@@ -11,6 +11,8 @@
 #pragma once
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
 // memsize calculator
 
@@ -152,6 +154,174 @@ T ****allocate(T ****&arr,
     return arr;
 }
 
+/* first-touch allocator */
+
+// First-touch variants of allocate(). The contiguous block is
+// zero-initialized in a static-scheduled OpenMP loop, so on NUMA
+// machines its pages are mapped on the sockets of the threads that
+// later scan the array with the same static distribution, instead of
+// all landing next to the master thread. Equivalent to allocate()
+// followed by a serial zero fill when OpenMP is off.
+
+template<typename T>
+void first_touch_fill(T *ptr,
+                      const size_t n)
+{
+    long long i;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (i = 0; i < static_cast<long long>(n); ++i) {
+        ptr[i] = T();
+    }
+}
+
+template<typename T>
+T *allocate_first_touch(T *&arr,
+                        const size_t n1)
+{
+    allocate(arr, n1);
+    first_touch_fill(arr, n1);
+    return arr;
+}
+
+template<typename T>
+T **allocate_first_touch(T **&arr,
+                         const size_t n1,
+                         const size_t n2)
+{
+    allocate(arr, n1, n2);
+    first_touch_fill(arr[0], n1 * n2);
+    return arr;
+}
+
+template<typename T>
+T ***allocate_first_touch(T ***&arr,
+                          const size_t n1,
+                          const size_t n2,
+                          const size_t n3)
+{
+    allocate(arr, n1, n2, n3);
+    first_touch_fill(arr[0][0], n1 * n2 * n3);
+    return arr;
+}
+
+template<typename T>
+T ****allocate_first_touch(T ****&arr,
+                           const size_t n1,
+                           const size_t n2,
+                           const size_t n3,
+                           const size_t n4)
+{
+    allocate(arr, n1, n2, n3, n4);
+    first_touch_fill(arr[0][0][0], n1 * n2 * n3 * n4);
+    return arr;
+}
+
+/* thread-local scratch arena */
+
+// Bump allocator for hot-loop temporaries. Arrays grabbed from the arena
+// are released all at once with scratch_reset() instead of individual
+// delete[] calls, so steady-state iterations perform no heap allocation
+// (the arena keeps its largest block alive between resets). Only valid
+// for trivially destructible element types, and pointers obtained here
+// must never be passed to deallocate().
+
+class ScratchArena {
+public:
+    static ScratchArena &instance()
+    {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+
+    void *grab(const size_t bytes)
+    {
+        const auto nbytes = (bytes + alignment - 1) & ~(alignment - 1);
+
+        if (offset + nbytes > capacity) {
+            grow(nbytes);
+        }
+        auto ptr = static_cast<void *>(block + offset);
+        offset += nbytes;
+        return ptr;
+    }
+
+    void reset()
+    {
+        // Keep only the largest block so the next iteration runs
+        // allocation-free.
+        if (!overflow.empty()) {
+            for (auto &it: overflow) {
+                if (it.second > capacity) {
+                    delete[] block;
+                    block = it.first;
+                    capacity = it.second;
+                } else {
+                    delete[] it.first;
+                }
+            }
+            overflow.clear();
+        }
+        offset = 0;
+    }
+
+    ~ScratchArena()
+    {
+        reset();
+        delete[] block;
+    }
+
+private:
+    static const size_t alignment = 64;
+
+    char *block = nullptr;
+    size_t capacity = 0;
+    size_t offset = 0;
+    std::vector<std::pair<char *, size_t>> overflow;
+
+    ScratchArena() {};
+
+    void grow(const size_t nbytes)
+    {
+        // The current block may still hold live arrays; park it until the
+        // next reset and continue in a fresh, larger one.
+        auto newcap = capacity > 0 ? 2 * capacity : 1048576;
+        while (newcap < nbytes) newcap *= 2;
+
+        if (block) overflow.emplace_back(block, capacity);
+        block = new char[newcap];
+        capacity = newcap;
+        offset = 0;
+    }
+};
+
+template<typename T>
+T *scratch_allocate(T *&arr,
+                    const size_t n1)
+{
+    arr = static_cast<T *>(ScratchArena::instance().grab(n1 * sizeof(T)));
+    return arr;
+}
+
+template<typename T>
+T **scratch_allocate(T **&arr,
+                     const size_t n1,
+                     const size_t n2)
+{
+    arr = static_cast<T **>(ScratchArena::instance().grab(n1 * sizeof(T *)));
+    arr[0] = static_cast<T *>(ScratchArena::instance().grab(n1 * n2 * sizeof(T)));
+    for (size_t i = 1; i < n1; ++i) {
+        arr[i] = arr[0] + i * n2;
+    }
+    return arr;
+}
+
+inline void scratch_reset()
+{
+    ScratchArena::instance().reset();
+}
+
 /* deallocator */
 
 
@@ -11,6 +11,7 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include "mpi_common.h"
 #include "mode_analysis.h"
 #include "anharmonic_core.h"
+#include "checkpoint.h"
 #include "dielec.h"
 #include "dynamical.h"
 #include "error.h"
@@ -28,9 +29,111 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <string>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <fftw3.h>
 
 using namespace PHON_NS;
 
+namespace {
+// Number of data (non-comment) lines in an existing per-mode output
+// file, or -1 when the file cannot be opened. Used on restart to judge
+// whether a mode was finished before a previous run was interrupted.
+int count_data_lines(const std::string &fname)
+{
+    std::ifstream ifs(fname.c_str(), std::ios::in);
+    if (!ifs) return -1;
+
+    auto nline = 0;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line[0] != '#') ++nline;
+    }
+    return nline;
+}
+
+// FFT-based discrete Kramers-Kronig transform on a uniform frequency
+// grid:
+//
+//   Re Sigma(w_i) = (2/pi) P sum_j w_j Im Sigma(w_j) / (w_j^2 - w_i^2) dw
+//
+// Im Sigma is extended to negative frequencies as an odd function and
+// convolved with the principal-value kernel -1/d (d = grid-index lag,
+// kernel zero at d = 0), which reproduces the direct quadrature term by
+// term while costing two FFTs of length O(nomega) per row instead of
+// O(nomega^2) operations. The kernel spectrum and the FFT plans are
+// set up once and shared by all rows (modes and temperatures).
+class KramersKronigFFT {
+public:
+    KramersKronigFFT(const int nomega, const int offset)
+            : nomega_(nomega), m0_(offset)
+    {
+        mmax_ = m0_ + nomega_ - 1;
+        const auto nfull = 2 * mmax_ + 1; // data indices -mmax .. mmax
+        const auto nkern = 4 * mmax_ + 1; // kernel lags  -2mmax .. 2mmax
+        nfft_ = 1;
+        while (nfft_ < nfull + nkern - 1) nfft_ <<= 1;
+
+        buf_.resize(nfft_);
+        spec_.resize(nfft_);
+        gspec_.resize(nfft_);
+
+        plan_fwd_ = fftw_plan_dft_1d(nfft_,
+                                     reinterpret_cast<fftw_complex *>(&buf_[0]),
+                                     reinterpret_cast<fftw_complex *>(&spec_[0]),
+                                     FFTW_FORWARD, FFTW_ESTIMATE);
+        plan_bwd_ = fftw_plan_dft_1d(nfft_,
+                                     reinterpret_cast<fftw_complex *>(&spec_[0]),
+                                     reinterpret_cast<fftw_complex *>(&buf_[0]),
+                                     FFTW_BACKWARD, FFTW_ESTIMATE);
+
+        std::fill(buf_.begin(), buf_.end(), std::complex<double>(0.0, 0.0));
+        for (auto d = -2 * mmax_; d <= 2 * mmax_; ++d) {
+            if (d == 0) continue;
+            buf_[d + 2 * mmax_] = std::complex<double>(-1.0 / static_cast<double>(d), 0.0);
+        }
+        fftw_execute(plan_fwd_);
+        gspec_ = spec_;
+    }
+
+    ~KramersKronigFFT()
+    {
+        fftw_destroy_plan(plan_fwd_);
+        fftw_destroy_plan(plan_bwd_);
+    }
+
+    // im_in and re_out hold nomega entries on the grid w_i = (m0 + i) dw.
+    // The output has the same units as the input; the grid spacing drops
+    // out of the discrete principal-value sum.
+    void transform(const double *im_in, double *re_out)
+    {
+        std::fill(buf_.begin(), buf_.end(), std::complex<double>(0.0, 0.0));
+
+        for (auto i = 0; i < nomega_; ++i) {
+            const auto m = m0_ + i;
+            if (m == 0) continue; // the odd extension vanishes at w = 0
+            buf_[mmax_ + m] = std::complex<double>(im_in[i], 0.0);
+            buf_[mmax_ - m] = std::complex<double>(-im_in[i], 0.0);
+        }
+        fftw_execute(plan_fwd_);
+        for (auto n = 0; n < nfft_; ++n) spec_[n] *= gspec_[n];
+        fftw_execute(plan_bwd_);
+
+        const auto scale = 1.0 / (pi * static_cast<double>(nfft_));
+        for (auto i = 0; i < nomega_; ++i) {
+            re_out[i] = buf_[(m0_ + i) + 3 * mmax_].real() * scale;
+        }
+    }
+
+private:
+    int nomega_, m0_, mmax_, nfft_;
+    std::vector<std::complex<double>> buf_, spec_, gspec_;
+    fftw_plan plan_fwd_, plan_bwd_;
+};
+}
+
 ModeAnalysis::ModeAnalysis(PHON *phon) : Pointers(phon)
 {
     set_default_variables();
@@ -52,6 +155,7 @@ void ModeAnalysis::set_default_variables()
     print_V4 = 0;
     calc_selfenergy = 0;
     spectral_func = false;
+    nsample_v4 = 0;
 }
 
 void ModeAnalysis::deallocate_variables() const {}
@@ -349,6 +453,37 @@ void ModeAnalysis::print_selfenergy(const unsigned int NT,
         }
     }
 
+    // RESTART = 1: a mode whose output file(s) from a previous run
+    // already contain all NT temperature points is finished; skip it, so
+    // an interrupted mode analysis resumes at the first unfinished mode.
+
+    std::vector<char> is_done(kslist.size(), 0);
+
+    if (phon->restart_flag) {
+        if (mympi->my_rank == 0) {
+            auto ndone = 0;
+            for (size_t i = 0; i < kslist.size(); ++i) {
+                auto complete = count_data_lines(input->job_title + ".Gamma." + std::to_string(i + 1))
+                                >= static_cast<int>(NT);
+                if (calc_realpart) {
+                    complete = complete
+                               && count_data_lines(input->job_title + ".Shift." + std::to_string(i + 1))
+                                  >= static_cast<int>(NT);
+                }
+                if (complete) {
+                    is_done[i] = 1;
+                    ++ndone;
+                }
+            }
+            if (ndone > 0) {
+                std::cout << std::endl;
+                std::cout << " RESTART = 1: " << ndone << " of " << kslist.size()
+                          << " modes already have complete output files and will be skipped." << std::endl;
+            }
+        }
+        MPI_Bcast(&is_done[0], static_cast<int>(kslist.size()), MPI_CHAR, 0, MPI_COMM_WORLD);
+    }
+
     allocate(damping_a, NT);
     allocate(self_a, NT);
     allocate(self_b, NT);
@@ -366,6 +501,8 @@ void ModeAnalysis::print_selfenergy(const unsigned int NT,
     }
 
     for (int i = 0; i < kslist.size(); ++i) {
+        if (is_done[i]) continue;
+
         const auto knum = kslist[i] / ns;
         const auto snum = kslist[i] % ns;
 
@@ -402,11 +539,24 @@ void ModeAnalysis::print_selfenergy(const unsigned int NT,
             for (j = 0; j < NT; ++j) damping_a[j] = self_a[j].imag();
         }
         if (anharmonic_core->quartic_mode == 2) {
-            selfenergy->selfenergy_c(NT, T_arr, omega, knum, snum,
-                                     dos->kmesh_dos,
-                                     dos->dymat_dos->get_eigenvalues(),
-                                     dos->dymat_dos->get_eigenvectors(),
-                                     self_c);
+            if (nsample_v4 > 0) {
+                // Stochastic estimate of diagram (c): at most NSAMPLE_V4
+                // random quartets are drawn, stopping early once the
+                // standard error of Im(Sigma) falls below 1 % of its mean.
+                selfenergy->selfenergy_c_stochastic(NT, T_arr, omega, knum, snum,
+                                                    dos->kmesh_dos,
+                                                    dos->dymat_dos->get_eigenvalues(),
+                                                    dos->dymat_dos->get_eigenvectors(),
+                                                    0.01,
+                                                    static_cast<unsigned long>(nsample_v4),
+                                                    self_c);
+            } else {
+                selfenergy->selfenergy_c(NT, T_arr, omega, knum, snum,
+                                         dos->kmesh_dos,
+                                         dos->dymat_dos->get_eigenvalues(),
+                                         dos->dymat_dos->get_eigenvectors(),
+                                         self_c);
+            }
 //            selfenergy->selfenergy_d(NT, T_arr, omega, knum, snum,
 //                                     dos->kmesh_dos,
 //                                     dos->dymat_dos->get_eigenvalues(),
@@ -541,6 +691,17 @@ void ModeAnalysis::print_selfenergy(const unsigned int NT,
                 std::cout << "  Phonon frequency shift is printed in " << file_shift << std::endl;
             }
         }
+
+        // Every rank passes here after each mode, so the collective check
+        // keeps all ranks consistent.
+        if (checkpoint::stop_requested_any(MPI_COMM_WORLD)) {
+            if (mympi->my_rank == 0) {
+                std::cout << std::endl;
+                std::cout << " Stop signal received. The output files of the finished modes" << std::endl;
+                std::cout << " are kept; rerun with RESTART = 1 to resume from the next mode." << std::endl;
+            }
+            break;
+        }
     }
 
     if (damping_a) {
@@ -719,13 +880,10 @@ void ModeAnalysis::calc_frequency_resolved_final_state(const unsigned int ntemp,
 
     const auto epsilon = integration->epsilon;
 
-    std::vector<KsListGroup> triplet;
-
-    kmesh_in->get_unique_triplet_k(ik_in,
-                                   symmetry->SymmList,
-                                   anharmonic_core->use_triplet_symmetry,
-                                   false,
-                                   triplet);
+    const auto &triplet = kmesh_in->get_unique_triplet_k_cached(ik_in,
+                                                                symmetry->SymmList,
+                                                                anharmonic_core->use_triplet_symmetry,
+                                                                false);
 
     allocate(ret_mpi, ntemp, nomegas, 2);
 
@@ -736,6 +894,15 @@ void ModeAnalysis::calc_frequency_resolved_final_state(const unsigned int ntemp,
         }
     }
 
+    // Per-triplet omega batching: |V3|^2, the occupation factors, and the
+    // energy-conserving deltas at omega0 do not depend on the grid point,
+    // so the delta kernel over the omega grid is evaluated once per
+    // (triplet, band pair) and all grid points are accumulated with a
+    // vectorized multiply-add per temperature. The previous one-omega-at-
+    // a-time loop re-evaluated the kernel ntemp times per pair.
+
+    std::vector<double> kern(nomegas);
+
     for (int ik = mympi->my_rank; ik < triplet.size(); ik += mympi->nprocs) {
         const auto multi = static_cast<double>(triplet[ik].group.size());
         const auto knum = kmesh_in->kpoint_irred_all[ik_in][0].knum;
@@ -754,6 +921,35 @@ void ModeAnalysis::calc_frequency_resolved_final_state(const unsigned int ntemp,
                 omega_inner[1] = eval_in[k2][js];
 
                 const auto v3_tmp = std::norm(anharmonic_core->V3(arr));
+                const auto v3m = v3_tmp * multi;
+
+                double d_emit, d_absorb;
+
+                if (integration->ismear == 0) {
+                    d_emit = delta_lorentz(omega0 - omega_inner[0] - omega_inner[1], epsilon)
+                             - delta_lorentz(omega0 + omega_inner[0] + omega_inner[1], epsilon);
+                    d_absorb = delta_lorentz(omega0 + omega_inner[0] - omega_inner[1], epsilon)
+                               - delta_lorentz(omega0 - omega_inner[0] + omega_inner[1], epsilon);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                    for (j = 0; j < nomegas; ++j) {
+                        kern[j] = delta_lorentz(omega[j] - omega_inner[0], epsilon);
+                    }
+                } else if (integration->ismear == 1) {
+                    d_emit = delta_gauss(omega0 - omega_inner[0] - omega_inner[1], epsilon)
+                             - delta_gauss(omega0 + omega_inner[0] + omega_inner[1], epsilon);
+                    d_absorb = delta_gauss(omega0 + omega_inner[0] - omega_inner[1], epsilon)
+                               - delta_gauss(omega0 - omega_inner[0] + omega_inner[1], epsilon);
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                    for (j = 0; j < nomegas; ++j) {
+                        kern[j] = delta_gauss(omega[j] - omega_inner[0], epsilon);
+                    }
+                } else {
+                    continue;
+                }
 
                 for (i = 0; i < ntemp; ++i) {
                     const auto T_tmp = temperature[i];
@@ -770,38 +966,16 @@ void ModeAnalysis::calc_frequency_resolved_final_state(const unsigned int ntemp,
                         n2 = f1 - f2;
                     }
 
-                    if (integration->ismear == 0) {
-                        prod_tmp[0] = n1
-                                      * (delta_lorentz(omega0 - omega_inner[0] - omega_inner[1], epsilon)
-                                         - delta_lorentz(omega0 + omega_inner[0] + omega_inner[1], epsilon));
-                        prod_tmp[1] = n2
-                                      * (delta_lorentz(omega0 + omega_inner[0] - omega_inner[1], epsilon)
-                                         - delta_lorentz(omega0 - omega_inner[0] + omega_inner[1], epsilon));
+                    prod_tmp[0] = v3m * n1 * d_emit;
+                    prod_tmp[1] = v3m * n2 * d_absorb;
 
-                        for (j = 0; j < nomegas; ++j) {
-                            ret_mpi[i][j][0] += v3_tmp * multi
-                                                * delta_lorentz(omega[j] - omega_inner[0], epsilon)
-                                                * prod_tmp[0];
-                            ret_mpi[i][j][1] += v3_tmp * multi
-                                                * delta_lorentz(omega[j] - omega_inner[0], epsilon)
-                                                * prod_tmp[1];
-                        }
-                    } else if (integration->ismear == 1) {
-                        prod_tmp[0] = n1
-                                      * (delta_gauss(omega0 - omega_inner[0] - omega_inner[1], epsilon)
-                                         - delta_gauss(omega0 + omega_inner[0] + omega_inner[1], epsilon));
-                        prod_tmp[1] = n2
-                                      * (delta_gauss(omega0 + omega_inner[0] - omega_inner[1], epsilon)
-                                         - delta_gauss(omega0 - omega_inner[0] + omega_inner[1], epsilon));
-
-                        for (j = 0; j < nomegas; ++j) {
-                            ret_mpi[i][j][0] += v3_tmp * multi
-                                                * delta_gauss(omega[j] - omega_inner[0], epsilon)
-                                                * prod_tmp[0];
-                            ret_mpi[i][j][1] += v3_tmp * multi
-                                                * delta_gauss(omega[j] - omega_inner[0], epsilon)
-                                                * prod_tmp[1];
-                        }
+                    double *row = &ret_mpi[i][0][0];
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                    for (j = 0; j < nomegas; ++j) {
+                        row[2 * j] += prod_tmp[0] * kern[j];
+                        row[2 * j + 1] += prod_tmp[1] * kern[j];
                     }
                 }
             }
@@ -817,7 +991,6 @@ void ModeAnalysis::calc_frequency_resolved_final_state(const unsigned int ntemp,
     MPI_Reduce(&ret_mpi[0][0][0], &ret[0][0][0], 2 * ntemp * nomegas, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
     deallocate(ret_mpi);
-    triplet.clear();
 }
 
 void ModeAnalysis::calc_frequency_resolved_final_state_tetrahedron(const unsigned int ntemp,
@@ -860,13 +1033,10 @@ void ModeAnalysis::calc_frequency_resolved_final_state_tetrahedron(const unsigne
 
     const auto xk = kmesh_in->xk;
 
-    std::vector<KsListGroup> triplet;
-
-    kmesh_in->get_unique_triplet_k(ik_in,
-                                   symmetry->SymmList,
-                                   anharmonic_core->use_triplet_symmetry,
-                                   false,
-                                   triplet);
+    const auto &triplet = kmesh_in->get_unique_triplet_k_cached(ik_in,
+                                                                symmetry->SymmList,
+                                                                anharmonic_core->use_triplet_symmetry,
+                                                                false);
 
     for (i = 0; i < ntemp; ++i) {
         for (j = 0; j < nomegas; ++j) {
@@ -958,6 +1128,11 @@ void ModeAnalysis::calc_frequency_resolved_final_state_tetrahedron(const unsigne
         deallocate(weight_tetra);
     }
 
+    // The final-state kernel over the omega grid depends only on the band
+    // pair, not on the temperature, so it is evaluated once per pair and
+    // the temperature loop reduces to a vectorized multiply-add.
+    std::vector<double> kern(nomegas);
+
     for (ik = 0; ik < npair_uniq; ++ik) {
         for (is = 0; is < ns; ++is) {
             for (js = 0; js < ns; ++js) {
@@ -969,6 +1144,13 @@ void ModeAnalysis::calc_frequency_resolved_final_state_tetrahedron(const unsigne
                     omega_inner[0] = eval_in[k1][is];
                     omega_inner[1] = eval_in[k2][js];
 
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+                    for (j = 0; j < nomegas; ++j) {
+                        kern[j] = delta_gauss(omega[j] - omega_inner[0], epsilon);
+                    }
+
 #ifdef _OPENMP
 #pragma omp parallel for private(f1, f2, n1, n2, prod_tmp, j)
 #endif
@@ -990,9 +1172,13 @@ void ModeAnalysis::calc_frequency_resolved_final_state_tetrahedron(const unsigne
                         prod_tmp[0] = v3_tmp * n1 * delta_arr[ik][ns * is + js][0];
                         prod_tmp[1] = -v3_tmp * n2 * delta_arr[ik][ns * is + js][1];
 
+                        double *row = &ret[i][0][0];
+#ifdef _OPENMP
+#pragma omp simd
+#endif
                         for (j = 0; j < nomegas; ++j) {
-                            ret[i][j][0] += prod_tmp[0] * delta_gauss(omega[j] - omega_inner[0], epsilon);
-                            ret[i][j][1] += prod_tmp[1] * delta_gauss(omega[j] - omega_inner[0], epsilon);
+                            row[2 * j] += prod_tmp[0] * kern[j];
+                            row[2 * j + 1] += prod_tmp[1] * kern[j];
                         }
                     }
                 }
@@ -1014,7 +1200,6 @@ void ModeAnalysis::calc_frequency_resolved_final_state_tetrahedron(const unsigne
     deallocate(delta_arr);
     deallocate(kmap_identity);
 
-    triplet.clear();
 }
 
 void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
@@ -1030,7 +1215,6 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
     double f1, f2, n1, n2;
     double norm;
     double **eval, **eval2;
-    double **gamma_k;
     const auto ns = dynamical->neval;
 
     std::complex<double> ***evec;
@@ -1079,12 +1263,18 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
 
     double theta_ref = 0.0;
 
+    // Resolution of the output histogram: follow the densest sampling of
+    // the k planes given in the &kpoint field.
+    int nbin_hist = 0;
+
     // Loop over k point planes
 
     for (i = 0; i < kpoint->kp_plane_geometry.size(); ++i) {
         const auto nk1_plane = kpoint->kp_plane_geometry[i].npoints[0];
         const auto nk2_plane = kpoint->kp_plane_geometry[i].npoints[1];
 
+        nbin_hist = std::max(nbin_hist, static_cast<int>(std::max(nk1_plane, nk2_plane)));
+
         const auto div1 = 1.0 / static_cast<double>(nk1_plane - 1);
         const auto div2 = 1.0 / static_cast<double>(nk2_plane - 1);
 
@@ -1395,8 +1585,6 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
 
     deallocate(kplist_conserved);
 
-    std::vector<std::vector<double>> **final_state_xy;
-    std::vector<double> triplet_xyG;
     std::vector<int> small_group_k;
     int selection_type;
 
@@ -1408,7 +1596,6 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
     double ***symop_k;
 
     allocate(symop_k, symmetry->nsym, 3, 3);
-    allocate(final_state_xy, kslist_fstate_k.size(), NT);
 
     allocate(eval, 3, ns);
     allocate(evec, 3, ns, ns);
@@ -1486,24 +1673,63 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
                       << small_group_k.size() << std::endl << std::endl;
         }
 
+        // Each rank evaluates an interleaved share of the contour points
+        // and bins its contributions into a fixed (x, y) histogram, which
+        // is then summed onto the master rank. The previous implementation
+        // replicated the full contour sweep on every rank and kept one
+        // (x, y, gamma) tuple per point and temperature in memory, which
+        // exhausted the master rank on dense meshes.
+
+        auto xmin_h = 0.0, xmax_h = 0.0, ymin_h = 0.0, ymax_h = 0.0;
+        long nentry_total = 0;
+
         for (is = 0; is < ns; ++is) {
             for (js = 0; js < ns; ++js) {
-                const int nklist = kplist_for_target_mode[is][js][i].size();
+                for (const auto &ent: kplist_for_target_mode[is][js][i]) {
+                    if (nentry_total == 0) {
+                        xmin_h = xmax_h = ent.x;
+                        ymin_h = ymax_h = ent.y;
+                    } else {
+                        xmin_h = std::min(xmin_h, ent.x);
+                        xmax_h = std::max(xmax_h, ent.x);
+                        ymin_h = std::min(ymin_h, ent.y);
+                        ymax_h = std::max(ymax_h, ent.y);
+                    }
+                    ++nentry_total;
+                }
+            }
+        }
 
-                if (nklist == 0) continue;
+        const auto nbin = std::max(nbin_hist, 2);
+        auto dx_h = (xmax_h - xmin_h) / static_cast<double>(nbin);
+        auto dy_h = (ymax_h - ymin_h) / static_cast<double>(nbin);
+        if (dx_h <= 0.0) dx_h = 1.0;
+        if (dy_h <= 0.0) dy_h = 1.0;
 
-                allocate(gamma_k, nklist, NT);
+        const auto nhist = static_cast<int>(NT) * nbin * nbin;
+        double *hist;
+        allocate(hist, nhist);
+        for (j = 0; j < nhist; ++j) hist[j] = 0.0;
 
-                for (k = 0; k < nklist; ++k) {
-                    for (l = 0; l < NT; ++l) {
-                        gamma_k[k][l] = 0.0;
-                    }
-                }
+        std::vector<double> gamma_loc(NT);
+
+        long icount = 0;
+
+        for (is = 0; is < ns; ++is) {
+            for (js = 0; js < ns; ++js) {
+                const int nklist = kplist_for_target_mode[is][js][i].size();
+
+                for (k = 0; k < nklist; ++k, ++icount) {
+
+                    if (icount % mympi->nprocs != mympi->my_rank) continue;
 
-                for (k = 0; k < nklist; ++k) {
                     for (l = 0; l < 3; ++l)
                         xk2[l] = dynamical->fold(kplist_for_target_mode[is][js][i][k].xk[l]);
 
+                    selection_type = kplist_for_target_mode[is][js][i][k].selection_type;
+
+                    for (iT = 0; iT < NT; ++iT) gamma_loc[iT] = 0.0;
+
                     for (isym = 0; isym < small_group_k.size(); ++isym) {
                         rotvec(xk_sym, xk2, symop_k[small_group_k[isym]]);
 
@@ -1548,32 +1774,36 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
                             }
 
                             if (selection_type == 0) {
-                                gamma_k[k][iT] += V3norm * n1;
+                                gamma_loc[iT] += V3norm * n1;
                             } else if (selection_type == 1) {
-                                gamma_k[k][iT] += V3norm * n2;
+                                gamma_loc[iT] += V3norm * n2;
                             }
                         }
                     }
 
                     for (iT = 0; iT < NT; ++iT)
-                        gamma_k[k][iT] *= pi * std::pow(0.5, 4) / static_cast<double>(small_group_k.size());
+                        gamma_loc[iT] *= pi * std::pow(0.5, 4) / static_cast<double>(small_group_k.size());
 
-                    auto pos_x = kplist_for_target_mode[is][js][i][k].x;
-                    auto pos_y = kplist_for_target_mode[is][js][i][k].y;
-                    selection_type = kplist_for_target_mode[is][js][i][k].selection_type;
+                    auto ibx = static_cast<int>((kplist_for_target_mode[is][js][i][k].x - xmin_h) / dx_h);
+                    auto iby = static_cast<int>((kplist_for_target_mode[is][js][i][k].y - ymin_h) / dy_h);
+                    if (ibx < 0) ibx = 0;
+                    if (ibx >= nbin) ibx = nbin - 1;
+                    if (iby < 0) iby = 0;
+                    if (iby >= nbin) iby = nbin - 1;
 
                     for (iT = 0; iT < NT; ++iT) {
-                        triplet_xyG.clear();
-                        triplet_xyG.push_back(pos_x);
-                        triplet_xyG.push_back(pos_y);
-                        triplet_xyG.push_back(gamma_k[k][iT]);
-                        final_state_xy[i][iT].push_back(triplet_xyG);
+                        hist[(iT * nbin + ibx) * nbin + iby] += gamma_loc[iT];
                     }
                 }
-                deallocate(gamma_k);
             }
         }
 
+        if (mympi->my_rank == 0) {
+            MPI_Reduce(MPI_IN_PLACE, hist, nhist, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        } else {
+            MPI_Reduce(hist, nullptr, nhist, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        }
+
         if (mympi->my_rank == 0) {
             auto file_mode_tau = input->job_title + ".fk." + std::to_string(i + 1);
             ofs_mode_tau.open(file_mode_tau.c_str(), std::ios::out);
@@ -1586,13 +1816,22 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
             ofs_mode_tau << "# " << "Gamma at ";
             for (l = 0; l < 3; ++l) ofs_mode_tau << std::setw(10) << -xk1[l];
             ofs_mode_tau << " , mode = " << mode + 1 << std::endl;
+            ofs_mode_tau << "# Binned on a " << nbin << "x" << nbin
+                         << " grid; empty bins are omitted." << std::endl;
             ofs_mode_tau << " # Temperature [K], coordinate in FBZ, final state amplitude" << std::endl;
+
             for (iT = 0; iT < NT; ++iT) {
-                for (k = 0; k < final_state_xy[i][iT].size(); ++k) {
-                    ofs_mode_tau << std::setw(10) << T_arr[iT];
-                    ofs_mode_tau << std::setw(15) << final_state_xy[i][iT][k][0];
-                    ofs_mode_tau << std::setw(15) << final_state_xy[i][iT][k][1];
-                    ofs_mode_tau << std::setw(15) << final_state_xy[i][iT][k][2] << std::endl;
+                for (auto ibx = 0; ibx < nbin; ++ibx) {
+                    for (auto iby = 0; iby < nbin; ++iby) {
+                        const auto amp = hist[(iT * nbin + ibx) * nbin + iby];
+                        if (amp == 0.0) continue;
+                        ofs_mode_tau << std::setw(10) << T_arr[iT];
+                        ofs_mode_tau << std::setw(15)
+                                     << xmin_h + (static_cast<double>(ibx) + 0.5) * dx_h;
+                        ofs_mode_tau << std::setw(15)
+                                     << ymin_h + (static_cast<double>(iby) + 0.5) * dy_h;
+                        ofs_mode_tau << std::setw(15) << amp << std::endl;
+                    }
                 }
             }
 
@@ -1600,10 +1839,10 @@ void ModeAnalysis::print_momentum_resolved_final_state(const unsigned int NT,
             std::cout << "  The result is saved in " << file_mode_tau << std::endl;
             std::cout << std::endl;
         }
+        deallocate(hist);
     }
 
     deallocate(kplist_for_target_mode);
-    deallocate(final_state_xy);
     deallocate(symop_k);
     deallocate(eval);
     deallocate(evec);
@@ -2268,6 +2507,16 @@ void ModeAnalysis::print_spectral_function(const unsigned int NT,
         omega_array[i] *= time_ry / Hz_to_kayser;
     }
 
+    // The Kramers-Kronig engine assumes a uniform grid starting at a
+    // non-negative frequency. EMIN < 0 is unusual but allowed, so the
+    // direct quadrature is kept as a fallback for that case. The plans
+    // and the kernel spectrum are shared by all modes and temperatures.
+    const auto m0 = static_cast<int>(std::floor(Omega_min / delta_omega + 0.5));
+    KramersKronigFFT *kk_engine = nullptr;
+    if (mympi->my_rank == 0 && m0 >= 0) {
+        kk_engine = new KramersKronigFFT(static_cast<int>(nomega), m0);
+    }
+
     for (i = 0; i < kslist.size(); ++i) {
         auto knum = kslist[i] / ns;
         const auto snum = kslist[i] % ns;
@@ -2298,10 +2547,25 @@ void ModeAnalysis::print_spectral_function(const unsigned int NT,
             }
             ofs_self << std::endl;
             ofs_self << "# mode = " << snum + 1 << std::endl;
-            ofs_self << "## T[K], Freq (cm^-1), omega (cm^-1), Self.real (cm^-1), Self.imag (cm^-1)";
+            ofs_self << "## T[K], Freq (cm^-1), omega (cm^-1), Self.real (cm^-1), Self.imag (cm^-1), "
+                     << "Spectral function (cm)";
             ofs_self << std::endl;
         }
 
+        // The |V3|^2 elements and tetrahedron weights are temperature
+        // independent, so all temperatures are evaluated in one batched
+        // call instead of once per temperature.
+        anharmonic_core->calc_self3omega_tetrahedron(NT,
+                                                     T_arr,
+                                                     dos->kmesh_dos,
+                                                     dos->dymat_dos->get_eigenvalues(),
+                                                     dos->dymat_dos->get_eigenvectors(),
+                                                     ik_irred,
+                                                     snum,
+                                                     nomega,
+                                                     omega_array,
+                                                     self3_imag);
+
         for (int iT = 0; iT < NT; ++iT) {
             const auto T_now = T_arr[iT];
             const auto omega = dos->dymat_dos->get_eigenvalues()[knum][snum];
@@ -2311,34 +2575,39 @@ void ModeAnalysis::print_spectral_function(const unsigned int NT,
                 std::cout << "  Frequency (cm^-1) : " << std::setw(15) << writes->in_kayser(omega) << std::endl;
             }
 
-            anharmonic_core->calc_self3omega_tetrahedron(T_now,
-                                                         dos->kmesh_dos,
-                                                         dos->dymat_dos->get_eigenvalues(),
-                                                         dos->dymat_dos->get_eigenvectors(),
-                                                         ik_irred,
-                                                         snum,
-                                                         nomega,
-                                                         omega_array,
-                                                         self3_imag[iT]);
-
             // Calculate real part of the self-energy by Kramers-Kronig relation
-            for (iomega = 0; iomega < nomega; ++iomega) {
-                auto self_tmp = 0.0;
-                omega2[0] = omega_array[iomega] * omega_array[iomega];
-                for (int jomega = 0; jomega < nomega; ++jomega) {
-                    if (jomega == iomega) continue;
-                    omega2[1] = omega_array[jomega] * omega_array[jomega];
-                    self_tmp += omega_array[jomega] * self3_imag[iT][jomega] / (omega2[1] - omega2[0]);
+            if (mympi->my_rank == 0) {
+                if (kk_engine) {
+                    kk_engine->transform(self3_imag[iT], self3_real[iT]);
+                } else {
+                    for (iomega = 0; iomega < nomega; ++iomega) {
+                        auto self_tmp = 0.0;
+                        omega2[0] = omega_array[iomega] * omega_array[iomega];
+                        for (int jomega = 0; jomega < nomega; ++jomega) {
+                            if (jomega == iomega) continue;
+                            omega2[1] = omega_array[jomega] * omega_array[jomega];
+                            self_tmp += omega_array[jomega] * self3_imag[iT][jomega] / (omega2[1] - omega2[0]);
+                        }
+                        self3_real[iT][iomega] = 2.0 * delta_omega * time_ry * self_tmp / (pi * Hz_to_kayser);
+                    }
                 }
-                self3_real[iT][iomega] = 2.0 * delta_omega * time_ry * self_tmp / (pi * Hz_to_kayser);
-            }
 
-            if (mympi->my_rank == 0) {
                 for (iomega = 0; iomega < nomega; ++iomega) {
+                    const auto delta_tmp = self3_real[iT][iomega];
+                    const auto gamma_tmp = self3_imag[iT][iomega];
+                    const auto res = omega_array[iomega] * omega_array[iomega]
+                            - omega * omega - 2.0 * omega * delta_tmp;
+                    const auto denom = res * res + 4.0 * omega * omega * gamma_tmp * gamma_tmp;
+                    auto spec_tmp = 0.0;
+                    if (denom > 0.0) {
+                        spec_tmp = 2.0 * omega * gamma_tmp / (pi * denom);
+                    }
+
                     ofs_self << std::setw(10) << T_now << std::setw(15) << writes->in_kayser(omega);
                     ofs_self << std::setw(10) << writes->in_kayser(omega_array[iomega])
                              << std::setw(15) << writes->in_kayser(self3_real[iT][iomega])
-                             << std::setw(15) << writes->in_kayser(self3_imag[iT][iomega]) << std::endl;
+                             << std::setw(15) << writes->in_kayser(self3_imag[iT][iomega])
+                             << std::setw(15) << spec_tmp * time_ry / Hz_to_kayser << std::endl;
                 }
                 ofs_self << std::endl;
             }
@@ -2346,6 +2615,7 @@ void ModeAnalysis::print_spectral_function(const unsigned int NT,
         if (mympi->my_rank == 0) ofs_self.close();
     }
 
+    delete kk_engine;
     deallocate(omega_array);
     deallocate(self3_imag);
     deallocate(self3_real);
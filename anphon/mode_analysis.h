@@ -77,6 +77,11 @@ public:
     int calc_selfenergy;
     bool spectral_func;
 
+    // When positive (NSAMPLE_V4 tag), the quartic self-energy diagram (c)
+    // is estimated stochastically from at most nsample_v4 random quartets
+    // instead of the full O(N_k^2 ns^3) sweep.
+    long nsample_v4;
+
     std::string ks_input;
     std::vector<unsigned int> kslist;
 
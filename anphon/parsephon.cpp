@@ -107,11 +107,11 @@ void Input::parse_general_vars()
     struct stat st;
     std::string str_tmp;
     const std::vector<std::string> input_list{
-            "PREFIX", "MODE", "NSYM", "TOLERANCE", "PRINTSYM", "FCSXML", "FC2XML",
+            "PREFIX", "MODE", "NSYM", "TOLERANCE", "PRINTSYM", "FCSXML", "FC2XML", "FCSBIN",
             "TMIN", "TMAX", "DT", "NBANDS", "NONANALYTIC", "BORNINFO", "NA_SIGMA",
             "ISMEAR", "EPSILON", "EMIN", "EMAX", "DELTA_E", "RESTART",  // "TREVSYM",
             "NKD", "KD", "MASS", "TRISYM", "PREC_EWALD", "CLASSICAL", "BCONNECT", "BORNSYM",
-            "VERBOSITY"
+            "VERBOSITY", "KMESH_CACHE", "EVALK_SERVER", "ASR_CHECK"
     };
 
     std::vector<std::string> no_defaults{"PREFIX", "MODE", "FCSXML", "NKD", "KD"};
@@ -193,6 +193,9 @@ void Input::parse_general_vars()
     unsigned int band_connection = 0;
     unsigned int bornsym = 0;
     unsigned int verbosity = 1;
+    auto kmesh_cache = false;
+    auto evalk_server = false;
+    auto asr_check = false;
 
     auto prec_ewald = 1.0e-12;
 
@@ -203,6 +206,7 @@ void Input::parse_general_vars()
     auto nbands = -1;
     std::string borninfo;
     std::string fc2info;
+    std::string fcsbininfo;
 
     auto ismear = -1;
     auto epsilon = 10.0;
@@ -229,6 +233,7 @@ void Input::parse_general_vars()
     assign_val(nbands, "NBANDS", general_var_dict);
     assign_val(borninfo, "BORNINFO", general_var_dict);
     assign_val(fc2info, "FC2XML", general_var_dict);
+    assign_val(fcsbininfo, "FCSBIN", general_var_dict);
 
     assign_val(ismear, "ISMEAR", general_var_dict);
     assign_val(epsilon, "EPSILON", general_var_dict);
@@ -238,6 +243,14 @@ void Input::parse_general_vars()
     assign_val(use_triplet_symmetry, "TRISYM", general_var_dict);
     assign_val(bornsym, "BORNSYM", general_var_dict);
     assign_val(verbosity, "VERBOSITY", general_var_dict);
+    assign_val(kmesh_cache, "KMESH_CACHE", general_var_dict);
+    assign_val(evalk_server, "EVALK_SERVER", general_var_dict);
+    assign_val(asr_check, "ASR_CHECK", general_var_dict);
+
+    if (evalk_server && mode != "PHONONS") {
+        exit("parse_general_vars",
+             "EVALK_SERVER is available only for MODE = phonons.");
+    }
 
     if (band_connection > 2) {
         exit("parse_general_vars", "BCONNECT-tag can take 0, 1, or 2.");
@@ -320,10 +333,14 @@ void Input::parse_general_vars()
     integration->epsilon = epsilon;
     fcs_phonon->file_fcs = fcsinfo;
     fcs_phonon->file_fc2 = fc2info;
+    fcs_phonon->file_fcsbin = fcsbininfo;
     fcs_phonon->update_fc2 = !fc2info.empty();
+    fcs_phonon->force_asr_check = asr_check;
     thermodynamics->classical = classical;
     integration->ismear = ismear;
     anharmonic_core->use_triplet_symmetry = use_triplet_symmetry;
+    if (kmesh_cache) kpoint->file_kmesh_cache = prefix + ".kmesh";
+    dynamical->eval_server = evalk_server;
 
     general_var_dict.clear();
 }
@@ -336,7 +353,8 @@ void Input::parse_scph_vars()
     const std::vector<std::string> input_list{
             "KMESH_SCPH", "KMESH_INTERPOLATE", "MIXALPHA", "MAXITER",
             "RESTART_SCPH", "IALGO", "SELF_OFFDIAG", "TOL_SCPH",
-            "LOWER_TEMP", "WARMSTART", "BUBBLE"
+            "LOWER_TEMP", "WARMSTART", "BUBBLE", "ANDERSON", "V4_SPARSE",
+            "DYMAT_BINARY", "ADAPTIVE_DT"
     };
     std::vector<std::string> no_defaults{"KMESH_SCPH", "KMESH_INTERPOLATE"};
     std::vector<int> kmesh_v, kmesh_interpolate_v;
@@ -358,8 +376,6 @@ void Input::parse_scph_vars()
         }
     }
 
-    auto file_dymat = this->job_title + ".scph_dymat";
-
     // Default values
 
     auto tolerance_scph = 1.0e-10;
@@ -370,9 +386,19 @@ void Input::parse_scph_vars()
     auto lower_temp = true;
     auto warm_start = true;
     unsigned int bubble = 0;
+    auto anderson_mixing = true;
+    auto v4_sparse = 0.0;
+    auto dymat_binary = false;
+    auto adaptive_dt = true;
 
-    // if file_dymat exists in the current directory,
-    // restart mode will be automatically turned on for SCPH calculations.
+    assign_val(dymat_binary, "DYMAT_BINARY", scph_var_dict);
+
+    // if the restart file (text or binary, depending on DYMAT_BINARY)
+    // exists in the current directory, restart mode will be
+    // automatically turned on for SCPH calculations.
+
+    auto file_dymat = this->job_title
+                      + (dymat_binary ? ".scph_dymat_bin" : ".scph_dymat");
 
     auto restart_scph = stat(file_dymat.c_str(), &st) == 0;
 
@@ -387,6 +413,9 @@ void Input::parse_scph_vars()
     assign_val(lower_temp, "LOWER_TEMP", scph_var_dict);
     assign_val(warm_start, "WARMSTART", scph_var_dict);
     assign_val(bubble, "BUBBLE", scph_var_dict);
+    assign_val(anderson_mixing, "ANDERSON", scph_var_dict);
+    assign_val(v4_sparse, "V4_SPARSE", scph_var_dict);
+    assign_val(adaptive_dt, "ADAPTIVE_DT", scph_var_dict);
 
     auto str_tmp = scph_var_dict["KMESH_SCPH"];
 
@@ -443,6 +472,10 @@ void Input::parse_scph_vars()
     }
     scph->mixalpha = mixalpha;
     scph->maxiter = maxiter;
+    scph->anderson_mixing = anderson_mixing;
+    scph->v4_sparse = v4_sparse;
+    scph->dymat_binary = dymat_binary;
+    scph->adaptive_dt = adaptive_dt;
     scph->restart_scph = restart_scph;
     scph->selfenergy_offdiagonal = selenergy_offdiagonal;
     scph->ialgo = ialgo_scph;
@@ -469,9 +502,9 @@ void Input::parse_analysis_vars(const bool use_default_values)
             "GRUNEISEN", "NEWFCS", "DELTA_A", "ANIME", "ANIME_CELLSIZE",
             "ANIME_FORMAT", "ANIME_FRAMES", "SPS", "PRINTV3", "PRINTPR",
             "FC2_EWALD", "KAPPA_SPEC", "SELF_W", "UCORR", "SHIFT_UCORR",
-            "KAPPA_COHERENT",
+            "KAPPA_COHERENT", "KC_WINDOW", "ITERATIVE_BTE", "MIXED_PREC", "KMESH_COARSE",
             "DIELEC", "SELF_ENERGY", "PRINTV4", "ZMODE", "PROJECTION_AXES",
-            "LONGITUDINAL_DOS"
+            "LONGITUDINAL_DOS", "PRINTHDF5", "NSAMPLE_V4"
     };
 
 #ifdef _FE_BUBBLE
@@ -480,6 +513,7 @@ void Input::parse_analysis_vars(const bool use_default_values)
 
     unsigned int cellsize[3] = {1, 1, 1};
     int shift_ucorr[3] = {0, 0, 0};
+    unsigned int kmesh_coarse[3] = {0, 0, 0};
     double anime_kpoint_double[3] = {0., 0., 0.};
 
     double *isotope_factor = nullptr;
@@ -513,6 +547,7 @@ void Input::parse_analysis_vars(const bool use_default_values)
     auto delta_a = 0.001;
 
     auto quartic_mode = 0;
+    long nsample_v4 = 0;
     auto calc_realpart = false;
     auto include_isotope = 0;
     auto fstate_omega = false;
@@ -525,10 +560,14 @@ void Input::parse_analysis_vars(const bool use_default_values)
     auto print_self_consistent_fc2 = false;
     auto calc_FE_bubble = false;
     auto calc_coherent = 0;
+    auto kc_window = 0.0;
+    auto calc_iterative = 0;
+    auto mixed_precision = false;
 
     auto calculate_dielectric_constant = 0;
     auto calc_selfenergy = 0;
     auto print_zmode = false;
+    auto print_hdf5 = false;
 
     auto do_projection = false;
 
@@ -553,6 +592,7 @@ void Input::parse_analysis_vars(const bool use_default_values)
         assign_val(delta_a, "DELTA_A", analysis_var_dict);
 
         assign_val(quartic_mode, "QUARTIC", analysis_var_dict);
+        assign_val(nsample_v4, "NSAMPLE_V4", analysis_var_dict);
         assign_val(calc_realpart, "REALPART", analysis_var_dict);
         assign_val(include_isotope, "ISOTOPE", analysis_var_dict);
         assign_val(fstate_omega, "FSTATE_W", analysis_var_dict);
@@ -560,6 +600,9 @@ void Input::parse_analysis_vars(const bool use_default_values)
         assign_val(ks_input, "KS_INPUT", analysis_var_dict);
         assign_val(calculate_kappa_spec, "KAPPA_SPEC", analysis_var_dict);
         assign_val(calc_coherent, "KAPPA_COHERENT", analysis_var_dict);
+        assign_val(kc_window, "KC_WINDOW", analysis_var_dict);
+        assign_val(calc_iterative, "ITERATIVE_BTE", analysis_var_dict);
+        assign_val(mixed_precision, "MIXED_PREC", analysis_var_dict);
         assign_val(bubble_omega, "SELF_W", analysis_var_dict);
         assign_val(calc_selfenergy, "SELF_ENERGY", analysis_var_dict);
 
@@ -570,6 +613,7 @@ void Input::parse_analysis_vars(const bool use_default_values)
         assign_val(print_fc2_ewald, "FC2_EWALD", analysis_var_dict);
         assign_val(calculate_dielectric_constant, "DIELEC", analysis_var_dict);
         assign_val(print_zmode, "ZMODE", analysis_var_dict);
+        assign_val(print_hdf5, "PRINTHDF5", analysis_var_dict);
 #ifdef _FE_BUBBLE
         assign_val(calc_FE_bubble, "FE_BUBBLE", analysis_var_dict);
 #endif
@@ -649,6 +693,31 @@ void Input::parse_analysis_vars(const bool use_default_values)
         assign_val(anime_frames, "ANIME_FRAMES", analysis_var_dict);
     }
 
+    if (!use_default_values) {
+        std::string str_kmesh_coarse;
+        std::vector<std::string> list_kmesh_coarse;
+        assign_val(str_kmesh_coarse, "KMESH_COARSE", analysis_var_dict);
+
+        if (!str_kmesh_coarse.empty()) {
+            split_str_by_space(str_kmesh_coarse, list_kmesh_coarse);
+            if (list_kmesh_coarse.size() != 3) {
+                exit("parse_analysis_vars",
+                     "The number of entries for KMESH_COARSE must be 3.");
+            }
+
+            for (i = 0; i < 3; ++i) {
+                try {
+                    kmesh_coarse[i] = boost::lexical_cast<unsigned int>(list_kmesh_coarse[i]);
+                }
+                catch (std::exception &e) {
+                    std::cout << e.what() << std::endl;
+                    exit("parse_analysis_vars",
+                         "KMESH_COARSE must be an array of positive integers.");
+                }
+            }
+        }
+    }
+
     if (print_ucorr) {
         std::string str_shift_ucorr;
         std::vector<std::string> list_shift_ucorr;
@@ -731,6 +800,8 @@ void Input::parse_analysis_vars(const bool use_default_values)
                             shift_ucorr,
                             print_zmode);
 
+    writes->print_hdf5_results = print_hdf5;
+
 //    if (print_anime) {
 //        for (i = 0; i < 3; ++i) {
 //            writes->anime_kpoint[i] = my_cast<double>(anime_kpoint[i]);
@@ -749,7 +820,11 @@ void Input::parse_analysis_vars(const bool use_default_values)
 
     conductivity->calc_kappa_spec = calculate_kappa_spec;
     conductivity->calc_coherent = calc_coherent;
+    conductivity->kc_window = kc_window;
+    conductivity->calc_iterative = calc_iterative;
+    for (i = 0; i < 3; ++i) conductivity->nk_coarse[i] = kmesh_coarse[i];
     anharmonic_core->quartic_mode = quartic_mode;
+    anharmonic_core->mixed_precision = mixed_precision;
     dielec->calc_dielectric_constant = calculate_dielectric_constant;
 
     mode_analysis->ks_input = ks_input;
@@ -760,6 +835,11 @@ void Input::parse_analysis_vars(const bool use_default_values)
     mode_analysis->print_V4 = print_V4;
     mode_analysis->spectral_func = bubble_omega;
     mode_analysis->calc_selfenergy = calc_selfenergy;
+
+    if (nsample_v4 < 0) {
+        exit("parse_analysis_vars", "NSAMPLE_V4 must be a non-negative integer.");
+    }
+    mode_analysis->nsample_v4 = nsample_v4;
     isotope->include_isotope = include_isotope;
 
     gruneisen->print_gruneisen = print_gruneisen;
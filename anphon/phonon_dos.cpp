@@ -112,10 +112,20 @@ void Dos::setup()
 
         set_dos_energy_grid();
 
-        dymat_dos = new DymatEigenValue(dynamical->eigenvectors,
+        // The projected and two-phonon quantities read the stored mesh
+        // eigenvectors; the plain DOS needs the eigenvalues only.
+        if (projected_dos || longitudinal_projected_dos
+            || two_phonon_dos || scattering_phase_space) {
+            dynamical->require_mesh_eigenvectors();
+        }
+
+        // The dos-mesh eigenvectors are by far the largest array of the
+        // run, so they are kept once per node in a shared memory window.
+        dymat_dos = new DymatEigenValue(dynamical->mesh_eigenvectors_required(),
                                         false,
                                         kmesh_dos->nk,
-                                        dynamical->neval);
+                                        dynamical->neval,
+                                        true);
 
         if (integration->ismear == -1) {
             tetra_nodes_dos = new TetraNodes(kmesh_dos->nk_i[0],
@@ -188,7 +198,7 @@ void Dos::calc_dos_all()
                  neval, integration->ismear,
                  tetra_nodes_dos->get_ntetra(),
                  tetra_nodes_dos->get_tetras(),
-                 dos_phonon);
+                 dos_phonon, true);
     }
 
     if (projected_dos) {
@@ -239,10 +249,16 @@ void Dos::calc_dos(const unsigned int nk,
                    const int smearing_method,
                    const unsigned int ntetra,
                    const unsigned int *const *tetras,
-                   double *ret) const
+                   double *ret,
+                   const bool mpi_distribute) const
 {
     double *weight;
 
+    const int istart = mpi_distribute ? mympi->my_rank : 0;
+    const int istride = mpi_distribute ? mympi->nprocs : 1;
+
+    for (int i = 0; i < n; ++i) ret[i] = 0.0;
+
     //    if (mympi->my_rank == 0) std::cout << " Calculating phonon DOS ...";
 #ifdef _OPENMP
 #pragma omp parallel private (weight)
@@ -252,9 +268,7 @@ void Dos::calc_dos(const unsigned int nk,
 #ifdef _OPENMP
 #pragma omp for
 #endif
-        for (int i = 0; i < n; ++i) {
-
-            ret[i] = 0.0;
+        for (int i = istart; i < n; i += istride) {
 
             for (int k = 0; k < neval; ++k) {
                 if (smearing_method == -1) {
@@ -276,6 +290,14 @@ void Dos::calc_dos(const unsigned int nk,
         deallocate(weight);
     }
 
+    if (mpi_distribute) {
+        // Each rank filled a strided subset of the fixed-size histogram;
+        // the reduction (tree-combined inside MPI) leaves the full DOS on
+        // every rank.
+        MPI_Allreduce(MPI_IN_PLACE, &ret[0], n,
+                      MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+
     //    if (mympi->my_rank == 0) std::cout << " done." << std::endl;
 }
 
@@ -294,62 +316,84 @@ void Dos::calc_atom_projected_dos(const unsigned int nk,
     int i;
     unsigned int *kmap_identity;
     double *weight;
-    double **proj;
+    double ***proj;
 
     if (mympi->my_rank == 0)
         std::cout << " PDOS = 1 : Calculating atom-projected phonon DOS ... ";
 
     allocate(kmap_identity, nk);
-    allocate(proj, neval, nk);
 
     for (i = 0; i < nk; ++i) kmap_identity[i] = i;
 
-    for (unsigned int iat = 0; iat < natmin; ++iat) {
+    // The integration weights do not depend on the atom, so they are
+    // computed once per (energy, mode) pair and spread over all atoms,
+    // instead of once per atom. The projections are precomputed with the
+    // atom index innermost so the accumulation runs with unit stride;
+    // the array is a factor 3 smaller than the stored eigenvectors.
 
-        for (unsigned int imode = 0; imode < neval; ++imode) {
-            for (i = 0; i < nk; ++i) {
-
-                proj[imode][i] = 0.0;
+    allocate(proj, neval, nk, natmin);
 
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (i = 0; i < nk; ++i) {
+        for (unsigned int imode = 0; imode < neval; ++imode) {
+            for (unsigned int iat = 0; iat < natmin; ++iat) {
+                auto proj_tmp = 0.0;
                 for (unsigned int icrd = 0; icrd < 3; ++icrd) {
-                    proj[imode][i] += std::norm(evec[i][imode][3 * iat + icrd]);
+                    proj_tmp += std::norm(evec[i][imode][3 * iat + icrd]);
                 }
+                proj[imode][i][iat] = proj_tmp;
             }
         }
+    }
+
+    for (unsigned int iat = 0; iat < natmin; ++iat) {
+        for (i = 0; i < n; ++i) ret[iat][i] = 0.0;
+    }
+
 #ifdef _OPENMP
 #pragma omp parallel private (weight)
 #endif
-        {
-            allocate(weight, nk);
+    {
+        allocate(weight, nk);
 #ifdef _OPENMP
 #pragma omp for
 #endif
-            for (i = 0; i < n; ++i) {
-                ret[iat][i] = 0.0;
+        for (i = mympi->my_rank; i < n; i += mympi->nprocs) {
 
-                for (unsigned int k = 0; k < neval; ++k) {
-                    if (smearing_method == -1) {
-                        integration->calc_weight_tetrahedron(nk, kmap_identity,
-                                                             eval[k], energy[i],
-                                                             tetra_nodes_dos->get_ntetra(),
-                                                             tetra_nodes_dos->get_tetras(),
-                                                             weight);
-                    } else {
-                        integration->calc_weight_smearing(nk, nk, kmap_identity,
-                                                          eval[k], energy[i],
-                                                          smearing_method,
-                                                          weight);
-                    }
+            for (unsigned int k = 0; k < neval; ++k) {
+                if (smearing_method == -1) {
+                    integration->calc_weight_tetrahedron(nk, kmap_identity,
+                                                         eval[k], energy[i],
+                                                         tetra_nodes_dos->get_ntetra(),
+                                                         tetra_nodes_dos->get_tetras(),
+                                                         weight);
+                } else {
+                    integration->calc_weight_smearing(nk, nk, kmap_identity,
+                                                      eval[k], energy[i],
+                                                      smearing_method,
+                                                      weight);
+                }
 
-                    for (unsigned int j = 0; j < nk; ++j) {
-                        ret[iat][i] += proj[k][j] * weight[j];
+                for (unsigned int j = 0; j < nk; ++j) {
+                    const auto w = weight[j];
+                    if (w == 0.0) continue;
+                    for (unsigned int iat = 0; iat < natmin; ++iat) {
+                        ret[iat][i] += proj[k][j][iat] * w;
                     }
                 }
             }
-
-            deallocate(weight);
         }
+
+        deallocate(weight);
     }
+
+    // Combine the strided energy slabs of the ranks; the histograms have
+    // a fixed size, so no mode data is communicated.
+    MPI_Allreduce(MPI_IN_PLACE, &ret[0][0], natmin * n,
+                  MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
     deallocate(proj);
     deallocate(kmap_identity);
 
@@ -430,6 +474,8 @@ void Dos::calc_longitudinal_projected_dos(const unsigned int nk,
         }
     }
 
+    for (i = 0; i < n; ++i) ret[i] = 0.0;
+
 #ifdef _OPENMP
 #pragma omp parallel private (weight)
 #endif
@@ -438,8 +484,7 @@ void Dos::calc_longitudinal_projected_dos(const unsigned int nk,
 #ifdef _OPENMP
 #pragma omp for
 #endif
-            for (i = 0; i < n; ++i) {
-                ret[i] = 0.0;
+            for (i = mympi->my_rank; i < n; i += mympi->nprocs) {
 
                 for (unsigned int k = 0; k < neval; ++k) {
                     if (smearing_method == -1) {
@@ -463,6 +508,10 @@ void Dos::calc_longitudinal_projected_dos(const unsigned int nk,
 
             deallocate(weight);
         }
+
+    MPI_Allreduce(MPI_IN_PLACE, &ret[0], n,
+                  MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
     deallocate(proj);
     deallocate(kmap_identity);
 
@@ -475,6 +524,29 @@ void Dos::calc_two_phonon_dos(double *const *eval_in,
                               const double *energy,
                               const int smearing_method,
                               double ***ret) const
+{
+    const auto nk_reduced = kmesh_dos->nk_irred;
+
+    if (mympi->my_rank == 0) {
+        std::cout << " TDOS = 1 : Calculating two-phonon DOS for all irreducible k points." << std::endl;
+        std::cout << "            This may take a while ... ";
+    }
+
+    for (int ik = 0; ik < nk_reduced; ++ik) {
+        calc_two_phonon_dos_at_k(ik, eval_in, n, energy, smearing_method, ret[ik]);
+    }
+
+    if (mympi->my_rank == 0) {
+        std::cout << "done!" << std::endl;
+    }
+}
+
+void Dos::calc_two_phonon_dos_at_k(const unsigned int ik_irred,
+                                   double *const *eval_in,
+                                   const unsigned int n,
+                                   const double *energy,
+                                   const int smearing_method,
+                                   double **ret) const
 {
     int i, j;
     int jk;
@@ -482,7 +554,6 @@ void Dos::calc_two_phonon_dos(double *const *eval_in,
 
     const auto nk = kmesh_dos->nk;
     const auto ns = dynamical->neval;
-    const auto nk_reduced = kmesh_dos->nk_irred;
 
     const int ns2 = ns * ns;
 
@@ -496,11 +567,6 @@ void Dos::calc_two_phonon_dos(double *const *eval_in,
     int loc;
     int *k_pair;
 
-    if (mympi->my_rank == 0) {
-        std::cout << " TDOS = 1 : Calculating two-phonon DOS for all irreducible k points." << std::endl;
-        std::cout << "            This may take a while ... ";
-    }
-
     allocate(kmap_identity, nk);
     allocate(e_tmp, 2, nk);
     allocate(weight, n, nk);
@@ -510,66 +576,71 @@ void Dos::calc_two_phonon_dos(double *const *eval_in,
 
     for (i = 0; i < nk; ++i) kmap_identity[i] = i;
 
-    for (int ik = 0; ik < nk_reduced; ++ik) {
+    const auto knum = kmesh_dos->kpoint_irred_all[ik_irred][0].knum;
 
-        auto knum = kmesh_dos->kpoint_irred_all[ik][0].knum;
-
-        for (jk = 0; jk < nk; ++jk) {
-            for (i = 0; i < 3; ++i) xk_tmp[i] = xk[knum][i] + xk[jk][i];
-            k_pair[jk] = kmesh_dos->get_knum(xk_tmp);
-        }
+    for (jk = 0; jk < nk; ++jk) {
+        for (i = 0; i < 3; ++i) xk_tmp[i] = xk[knum][i] + xk[jk][i];
+        k_pair[jk] = kmesh_dos->get_knum(xk_tmp);
+    }
 
-        for (i = 0; i < n; ++i) {
-            for (j = 0; j < 2; ++j) {
-                ret[ik][i][j] = 0.0;
-            }
+    for (i = 0; i < n; ++i) {
+        for (j = 0; j < 2; ++j) {
+            ret[i][j] = 0.0;
         }
+    }
 
-        for (int ib = 0; ib < ns2; ++ib) {
+    for (int ib = 0; ib < ns2; ++ib) {
 
-            int is = ib / ns;
-            int js = ib % ns;
+        int is = ib / ns;
+        int js = ib % ns;
 #ifdef _OPENMP
 #pragma omp parallel for private(loc)
 #endif
-            for (jk = 0; jk < nk; ++jk) {
-                loc = k_pair[jk];
-                e_tmp[0][jk] = writes->in_kayser(eval_in[jk][is] + eval_in[loc][js]);
-                e_tmp[1][jk] = writes->in_kayser(eval_in[jk][is] - eval_in[loc][js]);
-            }
+        for (jk = 0; jk < nk; ++jk) {
+            loc = k_pair[jk];
+            e_tmp[0][jk] = writes->in_kayser(eval_in[jk][is] + eval_in[loc][js]);
+            e_tmp[1][jk] = writes->in_kayser(eval_in[jk][is] - eval_in[loc][js]);
+        }
 
-            if (smearing_method == -1) {
+        if (smearing_method == -1) {
+
+            // The corner sort of the tetrahedra depends only on the energy
+            // array; prepare it once per channel and reuse it for the whole
+            // energy grid.
 
-                for (j = 0; j < 2; ++j) {
+            TetraSortedEnergies sorted_tetra;
+
+            for (j = 0; j < 2; ++j) {
+                integration->prepare_sorted_tetrahedra(kmap_identity, e_tmp[j],
+                                                       tetra_nodes_dos->get_ntetra(),
+                                                       tetra_nodes_dos->get_tetras(),
+                                                       sorted_tetra);
 #ifdef _OPENMP
 #pragma omp parallel for private(k)
 #endif
-                    for (i = 0; i < n; ++i) {
-                        integration->calc_weight_tetrahedron(nk, kmap_identity,
-                                                             e_tmp[j], energy[i],
-                                                             tetra_nodes_dos->get_ntetra(),
-                                                             tetra_nodes_dos->get_tetras(),
-                                                             weight[i]);
-                        for (k = 0; k < nk; ++k) {
-                            ret[ik][i][j] += weight[i][k];
-                        }
+                for (i = 0; i < n; ++i) {
+                    integration->calc_weight_tetrahedron_sorted(nk, sorted_tetra,
+                                                                energy[i],
+                                                                weight[i]);
+                    for (k = 0; k < nk; ++k) {
+                        ret[i][j] += weight[i][k];
                     }
                 }
+            }
 
-            } else {
+        } else {
 
-                for (j = 0; j < 2; ++j) {
+            for (j = 0; j < 2; ++j) {
 #ifdef _OPENMP
 #pragma omp parallel for private(k)
 #endif
-                    for (i = 0; i < n; ++i) {
-                        integration->calc_weight_smearing(nk, nk, kmap_identity,
-                                                          e_tmp[j], energy[i],
-                                                          smearing_method,
-                                                          weight[i]);
-                        for (k = 0; k < nk; ++k) {
-                            ret[ik][i][j] += weight[i][k];
-                        }
+                for (i = 0; i < n; ++i) {
+                    integration->calc_weight_smearing(nk, nk, kmap_identity,
+                                                      e_tmp[j], energy[i],
+                                                      smearing_method,
+                                                      weight[i]);
+                    for (k = 0; k < nk; ++k) {
+                        ret[i][j] += weight[i][k];
                     }
                 }
             }
@@ -580,10 +651,6 @@ void Dos::calc_two_phonon_dos(double *const *eval_in,
     deallocate(weight);
     deallocate(kmap_identity);
     deallocate(k_pair);
-
-    if (mympi->my_rank == 0) {
-        std::cout << "done!" << std::endl;
-    }
 }
 
 void Dos::calc_total_scattering_phase_space(double *const *eval_in,
@@ -48,6 +48,18 @@ public:
     KpointMeshUniform *kmesh_dos;
     DymatEigenValue *dymat_dos;
 
+    // Two-phonon spectral weights of one irreducible k point: the
+    // energy-binned tetrahedron (or smearing) weights of the omega1+omega2
+    // and omega1-omega2 channels, summed over k' and band pairs. The
+    // weights are temperature independent; the full table over irreducible
+    // k is cached in dos2_phonon when TDOS = 1.
+    void calc_two_phonon_dos_at_k(const unsigned int ik_irred,
+                                  double *const *eval_in,
+                                  const unsigned int n,
+                                  const double *energy,
+                                  const int smearing_method,
+                                  double **ret) const;
+
     void calc_dos_from_given_frequency(const KpointMeshUniform *kmesh_in,
                                        const double *const *eval_in,
                                        const unsigned int ntetra_in,
@@ -61,6 +73,11 @@ private:
 
     void deallocate_variables();
 
+    // When mpi_distribute is true, the energy axis of the histogram is
+    // divided round-robin over the MPI ranks and the fixed-size result is
+    // combined with an in-place MPI_Allreduce, so the call is collective
+    // over MPI_COMM_WORLD. Leave it false in places that run on one rank
+    // only (e.g. the SCPH postprocess).
     void calc_dos(const unsigned int nk,
                   const unsigned int nk_irreducible,
                   const unsigned int *map_k,
@@ -71,7 +88,8 @@ private:
                   const int smearing_method,
                   const unsigned int ntetra,
                   const unsigned int *const *tetras,
-                  double *ret) const;
+                  double *ret,
+                  const bool mpi_distribute = false) const;
 
     void calc_atom_projected_dos(const unsigned int nk,
                                  double *const *eval,
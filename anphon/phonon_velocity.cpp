@@ -19,6 +19,7 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include "memory.h"
 #include "phonon_dos.h"
 #include "system.h"
+#include "timer.h"
 #include <complex>
 #include <iomanip>
 
@@ -174,7 +175,7 @@ void PhononVelocity::get_phonon_group_velocity_mesh(const KpointMeshUniform &kme
 
     if (irreducible_only) {
         for (unsigned int i = 0; i < nk_irred; ++i) {
-            phonon_vel_k(&kmesh_in.xk[kmesh_in.kpoint_irred_all[i][0].knum][0], vel);
+            phonon_vel_k_analytic(&kmesh_in.xk[kmesh_in.kpoint_irred_all[i][0].knum][0], vel);
 
             for (unsigned int j = 0; j < ns; ++j) {
                 rotvec(vel[j], vel[j], lavec_p);
@@ -186,7 +187,7 @@ void PhononVelocity::get_phonon_group_velocity_mesh(const KpointMeshUniform &kme
         }
     } else {
         for (unsigned int i = 0; i < nk; ++i) {
-            phonon_vel_k(&kmesh_in.xk[i][0], vel);
+            phonon_vel_k_analytic(&kmesh_in.xk[i][0], vel);
 
             for (unsigned int j = 0; j < ns; ++j) {
                 rotvec(vel[j], vel[j], lavec_p);
@@ -264,11 +265,7 @@ void PhononVelocity::get_phonon_group_velocity_mesh_mpi(const KpointMeshUniform
     allocate(vel, ns, 3);
 
     for (unsigned int i = 0; i < nk_loc; ++i) {
-        phonon_vel_k(&kmesh_in.xk[klist_proc[i]][0], vel);
-        //        phonon_vel_k2(kpoint->xk[i],
-        //                      dynamical->eval_phonon[i],
-        //                      dynamical->evec_phonon[i],
-        //                      vel);
+        phonon_vel_k_analytic(&kmesh_in.xk[klist_proc[i]][0], vel);
 
         for (unsigned int j = 0; j < ns; ++j) {
             rotvec(vel[j], vel[j], lavec_p);
@@ -509,6 +506,83 @@ double PhononVelocity::diff(const double *f,
     return df;
 }
 
+void PhononVelocity::phonon_vel_k_analytic(const double *xk_in,
+                                           double **vel_out) const
+{
+    // Group velocities from the Hellmann-Feynman derivative of the
+    // dynamical matrix: one diagonalization at xk_in instead of the six
+    // extra eval_k calls of the central-difference path, and free of the
+    // finite-difference noise near band crossings. The central difference
+    // is kept as a fallback whenever the diagonal-element expression is
+    // not well defined: with the nonanalytic correction, when a frequency
+    // vanishes at the zone center, and at k points carrying a degenerate
+    // subspace. In the last case phonon_vel_k2 rotates each Cartesian
+    // component into its own eigenbasis, so the three components no longer
+    // refer to one set of branches; the finite difference of the sorted
+    // frequencies stays consistent there.
+
+    const auto n = dynamical->neval;
+
+    if (dynamical->nonanalytic) {
+        phonon_vel_k(xk_in, vel_out);
+        return;
+    }
+
+    unsigned int j;
+    double kvec_tmp[3];
+    double *eval_tmp;
+    double *omega_tmp;
+    std::complex<double> **evec_tmp;
+
+    for (j = 0; j < 3; ++j) kvec_tmp[j] = xk_in[j];
+    rotvec(kvec_tmp, kvec_tmp, system->rlavec_p, 'T');
+    const auto norm = std::sqrt(kvec_tmp[0] * kvec_tmp[0]
+                                + kvec_tmp[1] * kvec_tmp[1]
+                                + kvec_tmp[2] * kvec_tmp[2]);
+    if (norm > eps) {
+        for (j = 0; j < 3; ++j) kvec_tmp[j] /= norm;
+    }
+
+    allocate(eval_tmp, n);
+    allocate(omega_tmp, n);
+    allocate(evec_tmp, n, n);
+
+    dynamical->eval_k(xk_in,
+                      kvec_tmp,
+                      fcs_phonon->fc2_ext,
+                      eval_tmp,
+                      evec_tmp,
+                      true);
+
+    auto analytic_ok = true;
+
+    for (j = 0; j < n; ++j) {
+        omega_tmp[j] = dynamical->freq(eval_tmp[j]);
+        if (std::abs(omega_tmp[j]) < eps8) analytic_ok = false;
+    }
+
+    if (analytic_ok) {
+        std::vector<int> degeneracy_at_k;
+        Dynamical::detect_degeneracy(omega_tmp, n, 1.0e-7, degeneracy_at_k);
+        for (const auto &ideg: degeneracy_at_k) {
+            if (ideg > 1) {
+                analytic_ok = false;
+                break;
+            }
+        }
+    }
+
+    if (analytic_ok) {
+        phonon_vel_k2(xk_in, omega_tmp, evec_tmp, vel_out);
+    } else {
+        phonon_vel_k(xk_in, vel_out);
+    }
+
+    deallocate(eval_tmp);
+    deallocate(omega_tmp);
+    deallocate(evec_tmp);
+}
+
 void PhononVelocity::phonon_vel_k2(const double *xk_in,
                                    const double *omega_in,
                                    std::complex<double> **evec_in,
@@ -536,32 +610,19 @@ void PhononVelocity::phonon_vel_k2(const double *xk_in,
     allocate(vel_tmp, 3, nmode);
     calc_derivative_dynmat_k(xk_in, fcs_phonon->fc2_ext, ddyn);
 
-    const auto do_diagonalize = false;
+    // Degenerate branches require the diagonalization of the subspace
+    // matrix e^{*} * DDYN * e; the diagonal elements alone are not unique
+    // within a degenerate subspace.
+    const auto do_diagonalize = true;
 
     if (do_diagonalize) {
         // Detect degeneracy at the given k
         double tol_omega = 1.0e-7; // Approximately equal to 0.01 cm^{-1}
 
         std::vector<int> degeneracy_at_k;
+        Dynamical::detect_degeneracy(omega_in, nmode, tol_omega, degeneracy_at_k);
 
-        degeneracy_at_k.clear();
-
-        double omega_prev = omega_in[0];
-        int ideg = 1;
-
-        for (i = 1; i < nmode; ++i) {
-            double omega_now = omega_in[i];
-
-            if (std::abs(omega_now - omega_prev) < tol_omega) {
-                ++ideg;
-            } else {
-                degeneracy_at_k.push_back(ideg);
-                ideg = 1;
-                omega_prev = omega_now;
-            }
-        }
-        degeneracy_at_k.push_back(ideg);
-
+        int ideg;
         int is = 0;
 
         for (i = 0; i < degeneracy_at_k.size(); ++i) {
@@ -760,6 +821,7 @@ void PhononVelocity::diagonalize_hermite_mat(const int n,
         }
     }
 
+    count_event(EVENT_ZHEEV);
     zheev_(&JOBZ, &UPLO, &n_, mat_1D, &n_, eval_out, WORK, &LWORK, RWORK, &INFO);
 
     deallocate(RWORK);
@@ -33,6 +33,9 @@ public:
                        std::complex<double> **,
                        double **) const;
 
+    void phonon_vel_k_analytic(const double *,
+                               double **) const;
+
     void get_phonon_group_velocity_mesh(const KpointMeshUniform &kmesh_in,
                                         const double lavec_p[3][3],
                                         const std::vector<FcsClassExtent> &fc2_ext_in,
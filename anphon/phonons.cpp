@@ -12,6 +12,7 @@
 #include <iostream>
 #include <iomanip>
 #include "phonons.h"
+#include "checkpoint.h"
 #include "timer.h"
 #include "parsephon.h"
 #include "memory.h"
@@ -43,13 +44,94 @@
 
 #endif
 
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+
+#endif
+
 using namespace PHON_NS;
 
+namespace {
+#if defined(__linux__)
+
+// Bind this MPI rank to the CPUs of "its" socket(s), so that the OpenMP
+// threads and the pages they first touch stay on the same NUMA node.
+// Ranks on a node take consecutive socket blocks; with more ranks than
+// sockets, several ranks share one socket. The binding is skipped when
+// the user already requested an explicit placement through the common
+// affinity variables, or when the topology cannot be read from sysfs.
+void bind_rank_to_socket()
+{
+    if (std::getenv("OMP_PROC_BIND") || std::getenv("OMP_PLACES")
+        || std::getenv("KMP_AFFINITY") || std::getenv("GOMP_CPU_AFFINITY"))
+        return;
+
+    MPI_Comm comm_node;
+    int rank_node, nprocs_node;
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                        MPI_INFO_NULL, &comm_node);
+    MPI_Comm_rank(comm_node, &rank_node);
+    MPI_Comm_size(comm_node, &nprocs_node);
+    MPI_Comm_free(&comm_node);
+
+    std::vector<int> socket_of_cpu;
+
+    for (int icpu = 0;; ++icpu) {
+        std::ifstream ifs("/sys/devices/system/cpu/cpu" + std::to_string(icpu)
+                          + "/topology/physical_package_id");
+        if (!ifs) break;
+        int id;
+        ifs >> id;
+        if (ifs.fail()) return;
+        socket_of_cpu.push_back(id);
+    }
+    if (socket_of_cpu.empty()) return;
+
+    auto sockets = socket_of_cpu;
+    std::sort(sockets.begin(), sockets.end());
+    sockets.erase(std::unique(sockets.begin(), sockets.end()), sockets.end());
+
+    const auto nsocket = static_cast<int>(sockets.size());
+    if (nsocket < 2) return;
+
+    const auto isocket_begin = rank_node * nsocket / nprocs_node;
+    auto isocket_end = (rank_node + 1) * nsocket / nprocs_node;
+    if (isocket_end == isocket_begin) isocket_end = isocket_begin + 1;
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+
+    for (size_t icpu = 0; icpu < socket_of_cpu.size(); ++icpu) {
+        for (auto is = isocket_begin; is < isocket_end; ++is) {
+            if (socket_of_cpu[icpu] == sockets[is]) CPU_SET(icpu, &mask);
+        }
+    }
+
+    sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+#endif
+}
+
 PHON::PHON(int narg,
            char **arg,
            MPI_Comm comm)
 {
     mympi = new MyMPI(this, comm);
+
+#if defined(__linux__)
+    bind_rank_to_socket();
+#endif
+
+    checkpoint::install_signal_handler();
+
     input = new Input(this);
 
     create_pointers();
@@ -94,6 +176,8 @@ PHON::PHON(int narg,
         exit("phonons", "invalid mode: ", mode.c_str());
     }
 
+    timer->print_profile();
+
     if (mympi->my_rank == 0) {
         std::cout << std::endl << " Job finished at "
                   << timer->DateAndTime() << std::endl;
@@ -157,6 +241,7 @@ void PHON::destroy_pointers() const
 
 void PHON::setup_base() const
 {
+    timer->start_clock("setup_base");
     system->setup();
     symmetry->setup_symmetry();
     kpoint->kpoint_setups(mode);
@@ -179,6 +264,7 @@ void PHON::setup_base() const
             std::cout << std::endl;
         }
     }
+    timer->stop_clock("setup_base");
 }
 
 void PHON::execute_phonons() const
@@ -198,10 +284,21 @@ void PHON::execute_phonons() const
 
     setup_base();
 
+    if (dynamical->eval_server) {
+        // Streamed evaluation service: answer k-point batches from the
+        // input stream instead of producing the usual one-shot outputs.
+        dynamical->run_eval_server();
+        return;
+    }
+
+    timer->start_clock("diagonalize_dynamical_all");
     dynamical->diagonalize_dynamical_all();
+    timer->stop_clock("diagonalize_dynamical_all");
 
     if (dos->flag_dos) {
+        timer->start_clock("calc_dos_all");
         dos->calc_dos_all();
+        timer->stop_clock("calc_dos_all");
     }
 
     gruneisen->setup();
@@ -249,7 +346,15 @@ void PHON::execute_RTA() const
     setup_base();
 
     if (kpoint->kpoint_mode < 3) {
+        timer->start_clock("diagonalize_dynamical_all");
         dynamical->diagonalize_dynamical_all();
+        timer->stop_clock("diagonalize_dynamical_all");
+
+        if (dos->kmesh_dos && dos->dymat_dos) {
+            thermodynamics->setup_occupation_grid(dos->kmesh_dos->nk,
+                                                  dynamical->neval,
+                                                  dos->dymat_dos->get_eigenvalues());
+        }
     }
 
     isotope->setup_isotope_scattering();
@@ -264,8 +369,12 @@ void PHON::execute_RTA() const
         writes->setup_result_io();
         conductivity->setup_kappa();
         conductivity->prepare_restart();
+        timer->start_clock("calc_anharmonic_imagself");
         conductivity->calc_anharmonic_imagself();
+        timer->stop_clock("calc_anharmonic_imagself");
+        timer->start_clock("compute_kappa");
         conductivity->compute_kappa();
+        timer->stop_clock("compute_kappa");
         writes->write_kappa();
         writes->write_selfenergy_isotope();
     }
@@ -284,8 +393,14 @@ void PHON::execute_self_consistent_phonon() const
 
     setup_base();
 
+    timer->start_clock("diagonalize_dynamical_all");
     dynamical->diagonalize_dynamical_all();
+    timer->stop_clock("diagonalize_dynamical_all");
 
+    timer->start_clock("setup_scph");
     scph->setup_scph();
+    timer->stop_clock("setup_scph");
+    timer->start_clock("exec_scph");
     scph->exec_scph();
+    timer->stop_clock("exec_scph");
 }
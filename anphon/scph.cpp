@@ -10,6 +10,7 @@
 
 #include "mpi_common.h"
 #include "scph.h"
+#include "checkpoint.h"
 #include "dynamical.h"
 #include "kpoint.h"
 #include "anharmonic_core.h"
@@ -36,7 +37,12 @@
 #include <boost/lexical_cast.hpp>
 #include "timer.h"
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
 #include <vector>
 
 #if defined(WIN32) || defined(_WIN32)
@@ -60,11 +66,15 @@ Scph::~Scph()
 void Scph::set_default_variables()
 {
     restart_scph = false;
+    dymat_binary = false;
     warmstart_scph = false;
     lower_temp = true;
     tolerance_scph = 1.0e-10;
     mixalpha = 0.1;
     maxiter = 100;
+    anderson_mixing = true;
+    adaptive_dt = true;
+    v4_sparse = 0.0;
     print_self_consistent_fc2 = false;
     selfenergy_offdiagonal = true;
     relax_coordinate = false;
@@ -72,7 +82,9 @@ void Scph::set_default_variables()
     kmap_interpolate_to_scph = nullptr;
     evec_harmonic = nullptr;
     omega2_harmonic = nullptr;
-    mat_transform_sym = nullptr;
+    symrot_cart = nullptr;
+    symperm_atom = nullptr;
+    symphase_atom = nullptr;
     symop_minus_at_k = nullptr;
     kpoint_map_symmetry = nullptr;
     mindist_list_scph = nullptr;
@@ -102,8 +114,14 @@ void Scph::deallocate_variables()
     if (omega2_harmonic) {
         deallocate(omega2_harmonic);
     }
-    if (mat_transform_sym) {
-        deallocate(mat_transform_sym);
+    if (symrot_cart) {
+        deallocate(symrot_cart);
+    }
+    if (symperm_atom) {
+        deallocate(symperm_atom);
+    }
+    if (symphase_atom) {
+        deallocate(symphase_atom);
     }
     if (symop_minus_at_k) {
         deallocate(symop_minus_at_k);
@@ -133,6 +151,7 @@ void Scph::setup_scph()
     setup_kmesh();
     setup_eigvecs();
     setup_transform_ifc();
+    prepare_r2q_phase_table();
     setup_pp_interaction();
     setup_transform_symmetry();
 }
@@ -150,6 +169,7 @@ void Scph::exec_scph()
     const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
 
     MPI_Bcast(&restart_scph, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&dymat_binary, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&selfenergy_offdiagonal, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
     MPI_Bcast(&ialgo, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
 
@@ -158,7 +178,11 @@ void Scph::exec_scph()
     if (restart_scph) {
 
         // Read anharmonic correction to the dynamical matrix from the existing file
-        load_scph_dymat_from_file(delta_dymat_scph);
+        if (dymat_binary) {
+            load_scph_dymat_from_binary(delta_dymat_scph);
+        } else {
+            load_scph_dymat_from_file(delta_dymat_scph);
+        }
 
     } else {
 
@@ -170,7 +194,14 @@ void Scph::exec_scph()
         exec_scph_main(delta_dymat_scph);
 
         if (mympi->my_rank == 0) {
-            store_scph_dymat_to_file(delta_dymat_scph);
+            if (dymat_binary) {
+                store_scph_dymat_to_binary(delta_dymat_scph);
+            } else {
+                store_scph_dymat_to_file(delta_dymat_scph);
+            }
+            // The full restart file now exists; the incremental checkpoint
+            // of the temperature loop is no longer needed.
+            remove_scph_checkpoint();
             write_anharmonic_correction_fc2(delta_dymat_scph, NT);
         }
     }
@@ -756,6 +787,385 @@ void Scph::store_scph_dymat_to_file(const std::complex<double> *const *const *co
     std::cout << " : Anharmonic dynamical matrix (restart file)" << std::endl;
 }
 
+namespace {
+// Binary checkpoint of the anharmonic correction to the dynamical matrix
+// (PREFIX.scph_dymat_bin, DYMAT_BINARY = 1). Layout:
+//
+//  char     magic[8]             "ALMDYMAT"
+//  uint32_t version              1
+//  uint32_t kmesh_interpolate[3]
+//  uint32_t kmesh_scph[3]
+//  int32_t  nonanalytic
+//  uint32_t selfenergy_offdiagonal
+//  uint32_t NT, nk_interpolate, ns
+//  double   Tmin, Tmax, dT
+//  NT x { double temperature; uint64_t offset; }   (index table)
+//  NT x [ complex<double> dymat[ns][ns][nk_interpolate] ]
+//
+// The index table lets a reader seek straight to one temperature block,
+// and the fixed (is, js, ik) stride inside a block locates a single
+// k point without touching the rest of the file.
+//
+// The incremental checkpoint (PREFIX.scph_dymat_ckpt) shares the magic,
+// version, and header fields, but replaces the index table and the block
+// array by a sequence of { uint32_t iT; double temperature; block }
+// records appended as the temperatures converge. A record cut short by a
+// crash is detected by its length and discarded on load.
+const char scph_dymat_magic[8] = {'A', 'L', 'M', 'D', 'Y', 'M', 'A', 'T'};
+const std::uint32_t scph_dymat_version = 1;
+}
+
+void Scph::load_scph_dymat_from_binary(std::complex<double> ****dymat_out)
+{
+    const auto ns = dynamical->neval;
+    const auto Tmin = system->Tmin;
+    const auto Tmax = system->Tmax;
+    const auto dT = system->dT;
+    const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
+    const auto nk_interpolate = kmesh_coarse->nk;
+    std::vector<double> Temp_array(NT);
+
+    for (int i = 0; i < NT; ++i) {
+        Temp_array[i] = Tmin + dT * static_cast<double>(i);
+    }
+
+    if (mympi->my_rank == 0) {
+
+        std::ifstream ifs_dymat;
+        auto file_dymat = input->job_title + ".scph_dymat_bin";
+
+        std::cout << " RESTART_SCPH is true." << std::endl;
+        std::cout << " Dynamical matrix is read from the binary file ...";
+
+        ifs_dymat.open(file_dymat.c_str(), std::ios::in | std::ios::binary);
+
+        if (!ifs_dymat) {
+            exit("load_scph_dymat_from_binary",
+                 "Cannot open scph_dymat_bin file");
+        }
+
+        char magic[8];
+        std::uint32_t version, nk_interpolate_ref[3], nk_scph_tmp[3];
+        std::int32_t nonanalytic_tmp;
+        std::uint32_t consider_offdiag_tmp, NT_ref, nk_tmp, ns_tmp;
+        double Tmin_tmp, Tmax_tmp, dT_tmp;
+
+        ifs_dymat.read(magic, 8);
+        ifs_dymat.read(reinterpret_cast<char *>(&version), sizeof(version));
+        if (!ifs_dymat || std::memcmp(magic, scph_dymat_magic, 8) != 0) {
+            exit("load_scph_dymat_from_binary",
+                 "The file is not a scph_dymat_bin file");
+        }
+        if (version != scph_dymat_version) {
+            exit("load_scph_dymat_from_binary",
+                 "Unsupported version of the scph_dymat_bin file");
+        }
+
+        ifs_dymat.read(reinterpret_cast<char *>(nk_interpolate_ref), sizeof(nk_interpolate_ref));
+        ifs_dymat.read(reinterpret_cast<char *>(nk_scph_tmp), sizeof(nk_scph_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&nonanalytic_tmp), sizeof(nonanalytic_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&consider_offdiag_tmp), sizeof(consider_offdiag_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&NT_ref), sizeof(NT_ref));
+        ifs_dymat.read(reinterpret_cast<char *>(&nk_tmp), sizeof(nk_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&ns_tmp), sizeof(ns_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&Tmin_tmp), sizeof(Tmin_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&Tmax_tmp), sizeof(Tmax_tmp));
+        ifs_dymat.read(reinterpret_cast<char *>(&dT_tmp), sizeof(dT_tmp));
+
+        if (nk_interpolate_ref[0] != kmesh_interpolate[0] ||
+            nk_interpolate_ref[1] != kmesh_interpolate[1] ||
+            nk_interpolate_ref[2] != kmesh_interpolate[2]) {
+            exit("load_scph_dymat_from_binary",
+                 "The number of KMESH_INTERPOLATE is not consistent");
+        }
+        if (nk_scph_tmp[0] != kmesh_scph[0] ||
+            nk_scph_tmp[1] != kmesh_scph[1] ||
+            nk_scph_tmp[2] != kmesh_scph[2]) {
+            exit("load_scph_dymat_from_binary",
+                 "The number of KMESH_SCPH is not consistent");
+        }
+        if (nonanalytic_tmp != dynamical->nonanalytic) {
+            warn("load_scph_dymat_from_binary",
+                 "The NONANALYTIC tag is not consistent");
+        }
+        if (static_cast<bool>(consider_offdiag_tmp) != selfenergy_offdiagonal) {
+            exit("load_scph_dymat_from_binary",
+                 "The SELF_OFFDIAG tag is not consistent");
+        }
+        if (nk_tmp != nk_interpolate || ns_tmp != ns) {
+            exit("load_scph_dymat_from_binary",
+                 "The number of k points or branches is not consistent");
+        }
+
+        std::vector<double> temp_ref(NT_ref);
+        std::vector<std::uint64_t> offset_ref(NT_ref);
+        for (std::uint32_t i = 0; i < NT_ref; ++i) {
+            ifs_dymat.read(reinterpret_cast<char *>(&temp_ref[i]), sizeof(double));
+            ifs_dymat.read(reinterpret_cast<char *>(&offset_ref[i]), sizeof(std::uint64_t));
+        }
+
+        // Seek to the matching temperature blocks only; the other blocks
+        // are never touched.
+
+        const auto count_block = static_cast<size_t>(ns) * ns * nk_interpolate;
+        unsigned int icount = 0;
+
+        for (int j = 0; j < NT; ++j) {
+            auto found = false;
+            for (std::uint32_t i = 0; i < NT_ref; ++i) {
+                if (std::abs(temp_ref[i] - Temp_array[j]) < eps6) {
+                    ifs_dymat.seekg(static_cast<std::streamoff>(offset_ref[i]));
+                    ifs_dymat.read(reinterpret_cast<char *>(&dymat_out[icount][0][0][0]),
+                                   count_block * sizeof(std::complex<double>));
+                    found = true;
+                    break;
+                }
+            }
+            if (!found || !ifs_dymat) {
+                exit("load_scph_dymat_from_binary",
+                     "The temperature information is not consistent");
+            }
+            icount += 1;
+        }
+
+        ifs_dymat.close();
+        std::cout << " done." << std::endl;
+    }
+    // Broadcast to all MPI threads
+    mpi_bcast_complex(dymat_out, NT, kmesh_coarse->nk, ns);
+}
+
+void Scph::store_scph_dymat_to_binary(const std::complex<double> *const *const *const *dymat_in)
+{
+    const auto ns = dynamical->neval;
+    const auto Tmin = system->Tmin;
+    const auto Tmax = system->Tmax;
+    const auto dT = system->dT;
+    std::ofstream ofs_dymat;
+    auto file_dymat = input->job_title + ".scph_dymat_bin";
+
+    const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
+    const auto nk_interpolate = kmesh_coarse->nk;
+
+    ofs_dymat.open(file_dymat.c_str(), std::ios::out | std::ios::binary);
+
+    if (!ofs_dymat) {
+        exit("store_scph_dymat_to_binary",
+             "Cannot open scph_dymat_bin file");
+    }
+
+    std::uint32_t header_u32[3];
+    const std::int32_t nonanalytic = dynamical->nonanalytic;
+    const std::uint32_t offdiag = selfenergy_offdiagonal ? 1 : 0;
+
+    ofs_dymat.write(scph_dymat_magic, 8);
+    ofs_dymat.write(reinterpret_cast<const char *>(&scph_dymat_version),
+                    sizeof(scph_dymat_version));
+    for (auto i = 0; i < 3; ++i) header_u32[i] = kmesh_interpolate[i];
+    ofs_dymat.write(reinterpret_cast<const char *>(header_u32), sizeof(header_u32));
+    for (auto i = 0; i < 3; ++i) header_u32[i] = kmesh_scph[i];
+    ofs_dymat.write(reinterpret_cast<const char *>(header_u32), sizeof(header_u32));
+    ofs_dymat.write(reinterpret_cast<const char *>(&nonanalytic), sizeof(nonanalytic));
+    ofs_dymat.write(reinterpret_cast<const char *>(&offdiag), sizeof(offdiag));
+
+    const std::uint32_t NT_out = NT;
+    const std::uint32_t nk_out = nk_interpolate;
+    const std::uint32_t ns_out = ns;
+    ofs_dymat.write(reinterpret_cast<const char *>(&NT_out), sizeof(NT_out));
+    ofs_dymat.write(reinterpret_cast<const char *>(&nk_out), sizeof(nk_out));
+    ofs_dymat.write(reinterpret_cast<const char *>(&ns_out), sizeof(ns_out));
+    ofs_dymat.write(reinterpret_cast<const char *>(&Tmin), sizeof(Tmin));
+    ofs_dymat.write(reinterpret_cast<const char *>(&Tmax), sizeof(Tmax));
+    ofs_dymat.write(reinterpret_cast<const char *>(&dT), sizeof(dT));
+
+    // Index table. The offsets are computable in advance since every
+    // temperature block has the same size.
+
+    const std::uint64_t size_header = 8 + sizeof(scph_dymat_version)
+                                      + 2 * sizeof(header_u32)
+                                      + sizeof(nonanalytic) + sizeof(offdiag)
+                                      + 3 * sizeof(std::uint32_t) + 3 * sizeof(double);
+    const std::uint64_t size_index = NT * (sizeof(double) + sizeof(std::uint64_t));
+    const std::uint64_t size_block = static_cast<std::uint64_t>(ns) * ns * nk_interpolate
+                                     * sizeof(std::complex<double>);
+
+    for (auto iT = 0; iT < NT; ++iT) {
+        const auto temp = Tmin + static_cast<double>(iT) * dT;
+        const std::uint64_t offset = size_header + size_index + iT * size_block;
+        ofs_dymat.write(reinterpret_cast<const char *>(&temp), sizeof(temp));
+        ofs_dymat.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+
+    for (auto iT = 0; iT < NT; ++iT) {
+        ofs_dymat.write(reinterpret_cast<const char *>(&dymat_in[iT][0][0][0]),
+                        size_block);
+    }
+
+    ofs_dymat.close();
+    std::cout << "  " << std::setw(input->job_title.length() + 16) << std::left << file_dymat;
+    std::cout << " : Anharmonic dynamical matrix (binary restart file)" << std::endl;
+}
+
+void Scph::load_scph_checkpoint(std::complex<double> ****dymat_out,
+                                std::vector<char> &is_done)
+{
+    const auto ns = dynamical->neval;
+    const auto Tmin = system->Tmin;
+    const auto Tmax = system->Tmax;
+    const auto dT = system->dT;
+    const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
+    const auto nk_interpolate = kmesh_coarse->nk;
+
+    std::ifstream ifs_ckpt;
+    const auto file_ckpt = input->job_title + ".scph_dymat_ckpt";
+
+    ifs_ckpt.open(file_ckpt.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs_ckpt) return;
+
+    char magic[8];
+    std::uint32_t version, nk_interpolate_ref[3], nk_scph_tmp[3];
+    std::int32_t nonanalytic_tmp;
+    std::uint32_t consider_offdiag_tmp, NT_ref, nk_tmp, ns_tmp;
+    double Tmin_tmp, Tmax_tmp, dT_tmp;
+
+    ifs_ckpt.read(magic, 8);
+    ifs_ckpt.read(reinterpret_cast<char *>(&version), sizeof(version));
+    ifs_ckpt.read(reinterpret_cast<char *>(nk_interpolate_ref), sizeof(nk_interpolate_ref));
+    ifs_ckpt.read(reinterpret_cast<char *>(nk_scph_tmp), sizeof(nk_scph_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&nonanalytic_tmp), sizeof(nonanalytic_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&consider_offdiag_tmp), sizeof(consider_offdiag_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&NT_ref), sizeof(NT_ref));
+    ifs_ckpt.read(reinterpret_cast<char *>(&nk_tmp), sizeof(nk_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&ns_tmp), sizeof(ns_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&Tmin_tmp), sizeof(Tmin_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&Tmax_tmp), sizeof(Tmax_tmp));
+    ifs_ckpt.read(reinterpret_cast<char *>(&dT_tmp), sizeof(dT_tmp));
+
+    // The checkpoint is only a cache of the current run. If it was left
+    // behind by a run with different settings, ignore it and start over
+    // instead of aborting.
+
+    if (!ifs_ckpt
+        || std::memcmp(magic, scph_dymat_magic, 8) != 0
+        || version != scph_dymat_version
+        || nk_interpolate_ref[0] != kmesh_interpolate[0]
+        || nk_interpolate_ref[1] != kmesh_interpolate[1]
+        || nk_interpolate_ref[2] != kmesh_interpolate[2]
+        || nk_scph_tmp[0] != kmesh_scph[0]
+        || nk_scph_tmp[1] != kmesh_scph[1]
+        || nk_scph_tmp[2] != kmesh_scph[2]
+        || nonanalytic_tmp != dynamical->nonanalytic
+        || static_cast<bool>(consider_offdiag_tmp) != selfenergy_offdiagonal
+        || NT_ref != NT || nk_tmp != nk_interpolate || ns_tmp != ns
+        || std::abs(Tmin_tmp - Tmin) >= eps6
+        || std::abs(Tmax_tmp - Tmax) >= eps6
+        || std::abs(dT_tmp - dT) >= eps6) {
+        warn("load_scph_checkpoint",
+             "The scph_dymat_ckpt file is inconsistent with the current input and will be ignored");
+        return;
+    }
+
+    const auto count_block = static_cast<size_t>(ns) * ns * nk_interpolate;
+    unsigned int nrestored = 0;
+
+    while (true) {
+        std::uint32_t iT;
+        double temp;
+
+        ifs_ckpt.read(reinterpret_cast<char *>(&iT), sizeof(iT));
+        ifs_ckpt.read(reinterpret_cast<char *>(&temp), sizeof(temp));
+        if (!ifs_ckpt || iT >= NT) break;
+
+        // An incomplete record leaves is_done unset, so the temperature
+        // is simply recomputed and the garbage overwritten.
+        ifs_ckpt.read(reinterpret_cast<char *>(&dymat_out[iT][0][0][0]),
+                      count_block * sizeof(std::complex<double>));
+        if (!ifs_ckpt) break;
+
+        if (std::abs(temp - (Tmin + dT * static_cast<double>(iT))) < eps6) {
+            is_done[iT] = 1;
+            ++nrestored;
+        }
+    }
+
+    ifs_ckpt.close();
+
+    if (nrestored > 0) {
+        std::cout << " Checkpoint file " << file_ckpt << " found." << std::endl;
+        std::cout << " " << nrestored << " of " << NT
+                  << " temperature points are restored and will be skipped." << std::endl;
+        std::cout << std::endl;
+    }
+}
+
+void Scph::append_scph_checkpoint(const unsigned int iT,
+                                  const double temp,
+                                  const std::complex<double> *const *const *dymat_in)
+{
+    const auto ns = dynamical->neval;
+    const auto Tmin = system->Tmin;
+    const auto Tmax = system->Tmax;
+    const auto dT = system->dT;
+    const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
+    const auto nk_interpolate = kmesh_coarse->nk;
+
+    std::ofstream ofs_ckpt;
+    const auto file_ckpt = input->job_title + ".scph_dymat_ckpt";
+
+    auto write_header = false;
+    {
+        std::ifstream ifs_tmp(file_ckpt.c_str(), std::ios::in | std::ios::binary);
+        if (!ifs_tmp) write_header = true;
+    }
+
+    ofs_ckpt.open(file_ckpt.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+    if (!ofs_ckpt) {
+        warn("append_scph_checkpoint",
+             "Cannot open scph_dymat_ckpt file");
+        return;
+    }
+
+    if (write_header) {
+        std::uint32_t header_u32[3];
+        const std::int32_t nonanalytic = dynamical->nonanalytic;
+        const std::uint32_t offdiag = selfenergy_offdiagonal ? 1 : 0;
+        const std::uint32_t NT_out = NT;
+        const std::uint32_t nk_out = nk_interpolate;
+        const std::uint32_t ns_out = ns;
+
+        ofs_ckpt.write(scph_dymat_magic, 8);
+        ofs_ckpt.write(reinterpret_cast<const char *>(&scph_dymat_version),
+                       sizeof(scph_dymat_version));
+        for (auto i = 0; i < 3; ++i) header_u32[i] = kmesh_interpolate[i];
+        ofs_ckpt.write(reinterpret_cast<const char *>(header_u32), sizeof(header_u32));
+        for (auto i = 0; i < 3; ++i) header_u32[i] = kmesh_scph[i];
+        ofs_ckpt.write(reinterpret_cast<const char *>(header_u32), sizeof(header_u32));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&nonanalytic), sizeof(nonanalytic));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&offdiag), sizeof(offdiag));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&NT_out), sizeof(NT_out));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&nk_out), sizeof(nk_out));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&ns_out), sizeof(ns_out));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&Tmin), sizeof(Tmin));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&Tmax), sizeof(Tmax));
+        ofs_ckpt.write(reinterpret_cast<const char *>(&dT), sizeof(dT));
+    }
+
+    const std::uint32_t iT_out = iT;
+    const std::uint64_t size_block = static_cast<std::uint64_t>(ns) * ns * nk_interpolate
+                                     * sizeof(std::complex<double>);
+
+    ofs_ckpt.write(reinterpret_cast<const char *>(&iT_out), sizeof(iT_out));
+    ofs_ckpt.write(reinterpret_cast<const char *>(&temp), sizeof(temp));
+    ofs_ckpt.write(reinterpret_cast<const char *>(&dymat_in[0][0][0]), size_block);
+    ofs_ckpt.close();
+}
+
+void Scph::remove_scph_checkpoint() const
+{
+    const auto file_ckpt = input->job_title + ".scph_dymat_ckpt";
+    std::remove(file_ckpt.c_str());
+}
+
 void Scph::exec_scph_main(std::complex<double> ****dymat_anharm)
 {
     int ik, is;
@@ -767,38 +1177,75 @@ void Scph::exec_scph_main(std::complex<double> ****dymat_anharm)
     const auto dT = system->dT;
     double ***omega2_anharm;
     std::complex<double> ***evec_anharm_tmp;
-    std::complex<double> ***v3_array_all;
-    std::complex<double> ***v4_array_all;
+    std::complex<double> ***v3_array_all = nullptr;
+    std::complex<double> ***v4_array_all = nullptr;
 
     std::vector<double> vec_temp;
 
     const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
 
+    // Restore the temperatures already finished by an interrupted run
+    // from the checkpoint file; they are skipped in the loop below.
+
+    std::vector<char> done_temperature(NT, 0);
+
+    if (mympi->my_rank == 0) {
+        load_scph_checkpoint(dymat_anharm, done_temperature);
+    }
+    MPI_Bcast(&done_temperature[0], NT, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    unsigned int nT_remain = 0;
+    for (const auto &it: done_temperature) {
+        if (!it) ++nT_remain;
+    }
+
     // Compute matrix element of 4-phonon interaction
 
     allocate(omega2_anharm, NT, nk, ns);
     allocate(evec_anharm_tmp, nk, ns, ns);
-    allocate(v4_array_all, nk_irred_interpolate * nk,
-             ns * ns, ns * ns);
-
-    // Calculate v4 array.
-    // This operation is the most expensive part of the calculation.
-    if (selfenergy_offdiagonal & (ialgo == 1)) {
-        compute_V4_elements_mpi_over_band(v4_array_all,
-                                          evec_harmonic,
-                                          selfenergy_offdiagonal);
-    } else {
-        compute_V4_elements_mpi_over_kpoint(v4_array_all,
-                                            evec_harmonic,
-                                            selfenergy_offdiagonal,
-                                            relax_coordinate);
-    }
 
-    if (relax_coordinate) {
-        allocate(v3_array_all, nk, ns, ns * ns);
-        compute_V3_elements_mpi_over_kpoint(v3_array_all,
-                                            evec_harmonic,
-                                            selfenergy_offdiagonal);
+    if (nT_remain > 0) {
+        allocate_first_touch(v4_array_all, nk_irred_interpolate * nk,
+                             ns * ns, ns * ns);
+
+        // Calculate v4 array.
+        // This operation is the most expensive part of the calculation.
+        timer->start_clock("compute_V4");
+        if (ialgo == 2) {
+            compute_V4_elements_mpi_2d(v4_array_all,
+                                       evec_harmonic,
+                                       selfenergy_offdiagonal,
+                                       relax_coordinate);
+        } else if (selfenergy_offdiagonal & (ialgo == 1)) {
+            compute_V4_elements_mpi_over_band(v4_array_all,
+                                              evec_harmonic,
+                                              selfenergy_offdiagonal);
+        } else {
+            compute_V4_elements_mpi_over_kpoint(v4_array_all,
+                                                evec_harmonic,
+                                                selfenergy_offdiagonal,
+                                                relax_coordinate);
+        }
+        timer->stop_clock("compute_V4");
+
+        if (relax_coordinate) {
+            allocate_first_touch(v3_array_all, nk, ns, ns * ns);
+            timer->start_clock("compute_V3");
+            compute_V3_elements_mpi_over_kpoint(v3_array_all,
+                                                evec_harmonic,
+                                                selfenergy_offdiagonal);
+            timer->stop_clock("compute_V3");
+        }
+
+        if (v4_sparse > 0.0) {
+            // Trade the dense v4 array for the sparse representation and
+            // release the dense storage before entering the temperature loop.
+            if (mympi->my_rank == 0) {
+                compress_v4_array(v4_array_all, selfenergy_offdiagonal);
+            }
+            deallocate(v4_array_all);
+            v4_array_all = nullptr;
+        }
     }
 
     if (mympi->my_rank == 0) {
@@ -806,6 +1253,18 @@ void Scph::exec_scph_main(std::complex<double> ****dymat_anharm)
         std::complex<double> ***cmat_convert;
         allocate(cmat_convert, nk, ns, ns);
 
+        // Copy of the last converged state used by the adaptive
+        // temperature continuation (ADAPTIVE_DT).
+        double **omega2_prev_conv = nullptr;
+        std::complex<double> ***cmat_prev_conv = nullptr;
+        auto temp_prev_conv = 0.0;
+        auto has_prev_conv = false;
+
+        if (adaptive_dt) {
+            allocate(omega2_prev_conv, nk, ns);
+            allocate(cmat_prev_conv, nk, ns, ns);
+        }
+
         vec_temp.clear();
 
         if (lower_temp) {
@@ -823,6 +1282,14 @@ void Scph::exec_scph_main(std::complex<double> ****dymat_anharm)
         for (double temp: vec_temp) {
             auto iT = static_cast<unsigned int>((temp - Tmin) / dT);
 
+            if (done_temperature[iT]) {
+                // Restored from the checkpoint file. The warm-start chain
+                // is broken here and resumes at the next temperature
+                // actually computed in this run.
+                converged_prev = false;
+                continue;
+            }
+
             // Initialize phonon eigenvectors with harmonic values
 
             for (ik = 0; ik < nk; ++ik) {
@@ -848,6 +1315,7 @@ void Scph::exec_scph_main(std::complex<double> ****dymat_anharm)
                 }
             }
 
+            timer->start_clock("scf_loop");
             compute_anharmonic_frequency(v4_array_all,
                                          omega2_anharm[iT],
                                          evec_anharm_tmp,
@@ -857,21 +1325,111 @@ void Scph::exec_scph_main(std::complex<double> ****dymat_anharm)
                                          selfenergy_offdiagonal,
                                          writes->getVerbosity());
 
+            if (!converged_prev && adaptive_dt && warmstart_scph && has_prev_conv) {
+
+                // Continuation with refined temperature steps: walk from
+                // the last converged temperature to the current one in
+                // progressively halved steps, re-seeding each substep
+                // from the converged solution of the previous one. This
+                // only triggers near instabilities; converged grid
+                // points are untouched.
+
+                for (auto ilevel = 1; ilevel <= 4 && !converged_prev; ++ilevel) {
+
+                    const auto nsub = 1 << ilevel;
+
+                    if (writes->getVerbosity() > 0) {
+                        std::cout << " SCF did not converge at " << temp << " K." << std::endl;
+                        std::cout << " Retrying from " << temp_prev_conv << " K with "
+                                  << nsub << " intermediate steps." << std::endl;
+                    }
+
+                    // Restore the last converged state.
+                    for (ik = 0; ik < nk; ++ik) {
+                        for (is = 0; is < ns; ++is) {
+                            omega2_anharm[iT][ik][is] = omega2_prev_conv[ik][is];
+                            for (int js = 0; js < ns; ++js) {
+                                cmat_convert[ik][is][js] = cmat_prev_conv[ik][is][js];
+                            }
+                        }
+                    }
+
+                    auto converged_sub = true;
+
+                    for (auto isub = 1; isub <= nsub; ++isub) {
+                        const auto temp_sub = temp_prev_conv
+                                              + (temp - temp_prev_conv)
+                                                * static_cast<double>(isub) / static_cast<double>(nsub);
+
+                        for (ik = 0; ik < nk; ++ik) {
+                            for (is = 0; is < ns; ++is) {
+                                for (int js = 0; js < ns; ++js) {
+                                    evec_anharm_tmp[ik][is][js] = evec_harmonic[ik][is][js];
+                                }
+                            }
+                        }
+
+                        compute_anharmonic_frequency(v4_array_all,
+                                                     omega2_anharm[iT],
+                                                     evec_anharm_tmp,
+                                                     temp_sub,
+                                                     converged_sub,
+                                                     cmat_convert,
+                                                     selfenergy_offdiagonal,
+                                                     writes->getVerbosity());
+
+                        if (!converged_sub) break;
+                    }
+
+                    converged_prev = converged_sub;
+                }
+            }
+            timer->stop_clock("scf_loop");
+
+            if (adaptive_dt && converged_prev) {
+                for (ik = 0; ik < nk; ++ik) {
+                    for (is = 0; is < ns; ++is) {
+                        omega2_prev_conv[ik][is] = omega2_anharm[iT][ik][is];
+                        for (int js = 0; js < ns; ++js) {
+                            cmat_prev_conv[ik][is][js] = cmat_convert[ik][is][js];
+                        }
+                    }
+                }
+                temp_prev_conv = temp;
+                has_prev_conv = true;
+            }
+
             calc_new_dymat_with_evec(dymat_anharm[iT],
                                      omega2_anharm[iT],
                                      evec_anharm_tmp);
 
+            append_scph_checkpoint(iT, temp, dymat_anharm[iT]);
+            done_temperature[iT] = 1;
+
+            if (checkpoint::stop_requested()) {
+                std::cout << std::endl;
+                std::cout << " Stop signal received. The temperatures finished so far" << std::endl;
+                std::cout << " are kept in " << input->job_title + ".scph_dymat_ckpt"
+                          << "; rerun the same input to resume." << std::endl;
+                exit("exec_scph_main",
+                     "Terminated on request after writing the checkpoint file.");
+            }
+
             if (!warmstart_scph) converged_prev = false;
         }
 
         deallocate(cmat_convert);
+        if (omega2_prev_conv) deallocate(omega2_prev_conv);
+        if (cmat_prev_conv) deallocate(cmat_prev_conv);
 
     }
 
     mpi_bcast_complex(dymat_anharm, NT, kmesh_coarse->nk, ns);
 
     deallocate(omega2_anharm);
-    deallocate(v4_array_all);
+    if (v4_array_all) deallocate(v4_array_all);
+    v4_sparse_rows.clear();
+    v4_onsite.clear();
     deallocate(evec_anharm_tmp);
 }
 
@@ -1064,6 +1622,24 @@ void Scph::compute_V4_elements_mpi_over_kpoint(std::complex<double> ***v4_out,
     allocate(ind, ngroup_v4, 4);
     allocate(v4_mpi, nk2_prod, ns2, ns2);
 
+    // Full band blocks are evaluated as dense matrix products: the group
+    // sum is scattered into an ns^2 x ns^2 coefficient matrix H, and
+    //   v4(is*ns+js, ks*ns+ls) = [G1 H G2^T](is*ns+js, ks*ns+ls)
+    // with G1(is*ns+js, a*ns+b) = conj(e1[is][a]) e1[js][b] and
+    // G2(ks*ns+ls, c*ns+d) = e2[ks][c] conj(e2[ls][d]). This turns the
+    // O(ns^4 * ngroup) scalar contraction into three GEMMs of O(ns^6)
+    // (ngroup >> ns^2 in practice), and leaves the hot path in exactly
+    // the batched-GEMM form a device (GPU) backend would consume.
+    const bool need_full_block = self_offdiag || relax;
+    Eigen::MatrixXcd mat_h, mat_g1, mat_g2, v4_block;
+    long knum_g1_stored = -1;
+    if (need_full_block) {
+        mat_h.resize(ns2, ns2);
+        mat_g1.resize(ns2, ns2);
+        mat_g2.resize(ns2, ns2);
+        v4_block.resize(ns2, ns2);
+    }
+
     for (size_t ik_prod = mympi->my_rank; ik_prod < nk2_prod; ik_prod += mympi->nprocs) {
         const auto ik = ik_prod / nk_scph;
         const auto jk = ik_prod % nk_scph;
@@ -1092,12 +1668,50 @@ void Scph::compute_V4_elements_mpi_over_kpoint(std::complex<double> ***v4_out,
             }
         }
 
-        if (self_offdiag) {
+        if (self_offdiag || (relax && (knum == 0 || jk == 0))) {
 
             // All matrix elements will be calculated when considering the off-diagonal
             // elements of the phonon self-energy (loop diagram).
 
-#pragma omp parallel for private(is, js, ks, ls, ret, i)
+            mat_h.setZero();
+            for (ii = 0; ii < ngroup_v4; ++ii) {
+                mat_h(ind[ii][0] * ns + ind[ii][1],
+                      ind[ii][2] * ns + ind[ii][3]) += v4_array_at_kpair[ii];
+            }
+
+            // G1 depends only on knum, which is shared by all ik_prod with
+            // the same irreducible index ik, so it is rebuilt only when ik
+            // advances.
+            if (static_cast<long>(knum) != knum_g1_stored) {
+#pragma omp parallel for private(is, js)
+                for (ii = 0; ii < ns2; ++ii) {
+                    is = ii / ns;
+                    js = ii % ns;
+                    for (size_t a = 0; a < ns; ++a) {
+                        const auto e1 = std::conj(evec_in[knum][is][a]);
+                        for (size_t b = 0; b < ns; ++b) {
+                            mat_g1(ii, a * ns + b) = e1 * evec_in[knum][js][b];
+                        }
+                    }
+                }
+                knum_g1_stored = static_cast<long>(knum);
+            }
+
+#pragma omp parallel for private(ks, ls)
+            for (ii = 0; ii < ns2; ++ii) {
+                ks = ii / ns;
+                ls = ii % ns;
+                for (size_t c = 0; c < ns; ++c) {
+                    const auto e2 = evec_in[jk][ks][c];
+                    for (size_t d = 0; d < ns; ++d) {
+                        mat_g2(ii, c * ns + d) = e2 * std::conj(evec_in[jk][ls][d]);
+                    }
+                }
+            }
+
+            v4_block.noalias() = mat_g1 * (mat_h * mat_g2.transpose());
+
+#pragma omp parallel for private(is, js, ks, ls)
             for (ii = 0; ii < ns4; ++ii) {
                 is = ii / ns3;
                 js = (ii - ns3 * is) / ns2;
@@ -1106,69 +1720,30 @@ void Scph::compute_V4_elements_mpi_over_kpoint(std::complex<double> ***v4_out,
 
                 if (is < js) continue;
 
-                ret = std::complex<double>(0.0, 0.0);
-
-                for (i = 0; i < ngroup_v4; ++i) {
-
-                    ret += v4_array_at_kpair[i]
-                           * std::conj(evec_in[knum][is][ind[i][0]])
-                           * evec_in[knum][js][ind[i][1]]
-                           * evec_in[jk][ks][ind[i][2]]
-                           * std::conj(evec_in[jk][ls][ind[i][3]]);
-                }
-
-                v4_mpi[ik_prod][ns * is + js][ns * ks + ls] = factor * ret;
+                v4_mpi[ik_prod][ns * is + js][ns * ks + ls] = factor * v4_block(ns * is + js, ns * ks + ls);
             }
 
         } else {
 
             // Only diagonal elements will be computed when neglecting the polarization mixing.
 
-            if (relax && (knum == 0 || jk == 0)) {
-
-#pragma omp parallel for private(is, js, ks, ls, ret, i)
-                for (ii = 0; ii < ns4; ++ii) {
-                    is = ii / ns3;
-                    js = (ii - ns3 * is) / ns2;
-                    ks = (ii - ns3 * is - ns2 * js) / ns;
-                    ls = ii % ns;
-
-                    if (is < js) continue;
-
-                    ret = std::complex<double>(0.0, 0.0);
-
-                    for (i = 0; i < ngroup_v4; ++i) {
-
-                        ret += v4_array_at_kpair[i]
-                               * std::conj(evec_in[knum][is][ind[i][0]])
-                               * evec_in[knum][js][ind[i][1]]
-                               * evec_in[jk][ks][ind[i][2]]
-                               * std::conj(evec_in[jk][ls][ind[i][3]]);
-                    }
-
-                    v4_mpi[ik_prod][ns * is + js][ns * ks + ls] = factor * ret;
-                }
-
-            } else {
-
 #pragma omp parallel for private(is, js, ret, i)
-                for (ii = 0; ii < ns2; ++ii) {
-                    is = ii / ns;
-                    js = ii % ns;
-
-                    ret = std::complex<double>(0.0, 0.0);
+            for (ii = 0; ii < ns2; ++ii) {
+                is = ii / ns;
+                js = ii % ns;
 
-                    for (i = 0; i < ngroup_v4; ++i) {
+                ret = std::complex<double>(0.0, 0.0);
 
-                        ret += v4_array_at_kpair[i]
-                               * std::conj(evec_in[knum][is][ind[i][0]])
-                               * evec_in[knum][is][ind[i][1]]
-                               * evec_in[jk][js][ind[i][2]]
-                               * std::conj(evec_in[jk][js][ind[i][3]]);
-                    }
+                for (i = 0; i < ngroup_v4; ++i) {
 
-                    v4_mpi[ik_prod][(ns + 1) * is][(ns + 1) * js] = factor * ret;
+                    ret += v4_array_at_kpair[i]
+                           * std::conj(evec_in[knum][is][ind[i][0]])
+                           * evec_in[knum][is][ind[i][1]]
+                           * evec_in[jk][js][ind[i][2]]
+                           * std::conj(evec_in[jk][js][ind[i][3]]);
                 }
+
+                v4_mpi[ik_prod][(ns + 1) * is][(ns + 1) * js] = factor * ret;
             }
         }
     }
@@ -1448,14 +2023,375 @@ void Scph::compute_V4_elements_mpi_over_band(std::complex<double> ***v4_out,
         std::cout << "done.\n";
     }
 
-    deallocate(v4_mpi);
+    deallocate(v4_mpi);
+
+    zerofill_elements_acoustic_at_gamma(omega2_harmonic, v4_out, 4);
+
+    if (mympi->my_rank == 0) {
+        std::cout << " done !" << std::endl;
+        timer->print_elapsed();
+    }
+}
+
+void Scph::compute_V4_elements_mpi_2d(std::complex<double> ***v4_out,
+                                      std::complex<double> ***evec_in,
+                                      const bool self_offdiag,
+                                      const bool relax)
+{
+    // Calculate the matrix elements of quartic terms in reciprocal space
+    // with a two-dimensional decomposition over the (k-pair, band-pair)
+    // product space.
+    //
+    // The over_kpoint variant idles ranks once nprocs exceeds the number
+    // of k pairs, and the over_band variant splits only the band axis.
+    // Here each rank takes a contiguous slice of the flattened
+    // (k-pair, band set) work list whose boundaries are chosen by a
+    // simple cost model: one band set costs ns^2 (off-diagonal) or ns
+    // (diagonal) inner products over the quartic clusters, and entering
+    // a new k pair adds the cost of recomputing phi4_reciprocal, counted
+    // as one extra off-diagonal band set. Band sets of the same k pair
+    // therefore stay on as few ranks as possible while all ranks get
+    // work even when nprocs >> number of k pairs.
+
+    const size_t nk_reduced_interpolate = kmesh_coarse->nk_irred;
+    const size_t ns = dynamical->neval;
+    const size_t ns2 = ns * ns;
+    const size_t ns4 = ns * ns * ns * ns;
+    size_t is, js;
+    unsigned int knum;
+    unsigned int **ind;
+    unsigned int i, j;
+    long int ii;
+
+    const auto nk_scph = kmesh_dense->nk;
+    const auto ngroup_v4 = anharmonic_core->get_ngroup_fcs(4);
+    const auto factor = std::pow(0.5, 2) / static_cast<double>(nk_scph);
+    static auto complex_zero = std::complex<double>(0.0, 0.0);
+    std::complex<double> *v4_array_at_kpair;
+    std::complex<double> ***v4_mpi;
+
+    const size_t nk2_prod = nk_reduced_interpolate * nk_scph;
+
+    if (mympi->my_rank == 0) {
+        std::cout << " IALGO = 2 : Use the 2D decomposition over (k point, band pair)\n";
+        if (self_offdiag) {
+            std::cout << " SELF_OFFDIAG = 1: Calculating all components of v4_array ... ";
+        } else {
+            std::cout << " SELF_OFFDIAG = 0: Calculating diagonal components of v4_array ... ";
+        }
+    }
+
+    // Enumerate the band sets of every k pair together with their model
+    // costs. A set computes one (is, js) row of ns^2 elements in the
+    // off-diagonal case and one diagonal row of ns elements otherwise.
+
+    const size_t nset_offdiag = (ns2 - ns) / 2 + ns;
+
+    std::vector<int> ik_vec, is_vec, js_vec;
+    std::vector<double> cost_vec;
+
+    const auto cost_setup = static_cast<double>(ns2);
+
+    for (size_t ik_prod = 0; ik_prod < nk2_prod; ++ik_prod) {
+
+        const auto ik = ik_prod / nk_scph;
+        const auto jk = ik_prod % nk_scph;
+        knum = kmap_interpolate_to_scph[kmesh_coarse->kpoint_irred_all[ik][0].knum];
+
+        const auto full_elements = self_offdiag || (relax && (knum == 0 || jk == 0));
+        auto first_set_of_kpair = true;
+
+        if (full_elements) {
+            for (is = 0; is < ns; ++is) {
+                for (js = 0; js <= is; ++js) {
+                    ik_vec.push_back(ik_prod);
+                    is_vec.push_back(is);
+                    js_vec.push_back(js);
+                    cost_vec.push_back(static_cast<double>(ns2)
+                                       + (first_set_of_kpair ? cost_setup : 0.0));
+                    first_set_of_kpair = false;
+                }
+            }
+        } else {
+            for (is = 0; is < ns; ++is) {
+                ik_vec.push_back(ik_prod);
+                is_vec.push_back(is);
+                js_vec.push_back(-1);
+                cost_vec.push_back(static_cast<double>(ns)
+                                   + (first_set_of_kpair ? cost_setup : 0.0));
+                first_set_of_kpair = false;
+            }
+        }
+    }
+
+    const auto nset_tot = static_cast<long int>(ik_vec.size());
+    auto cost_tot = 0.0;
+    for (const auto &c: cost_vec) cost_tot += c;
+
+    // Contiguous slice of this rank in the cost-weighted work list.
+
+    long int nstart = -1;
+    long int nend = -1;
+    auto cost_acc = 0.0;
+    for (ii = 0; ii < nset_tot; ++ii) {
+        const auto irank_set
+                = std::min(static_cast<int>(cost_acc / cost_tot
+                                            * static_cast<double>(mympi->nprocs)),
+                           mympi->nprocs - 1);
+        if (irank_set == mympi->my_rank) {
+            if (nstart < 0) nstart = ii;
+            nend = ii + 1;
+        }
+        cost_acc += cost_vec[ii];
+    }
+
+    allocate(v4_array_at_kpair, ngroup_v4);
+    allocate(ind, ngroup_v4, 4);
+    allocate(v4_mpi, nk2_prod, ns2, ns2);
+
+    for (size_t ik_prod = 0; ik_prod < nk2_prod; ++ik_prod) {
+#pragma omp parallel for private(js)
+        for (ii = 0; ii < ns2; ++ii) {
+            for (js = 0; js < ns2; ++js) {
+                v4_mpi[ik_prod][ii][js] = complex_zero;
+                v4_out[ik_prod][ii][js] = complex_zero;
+            }
+        }
+    }
+
+    int ik_prod_old = -1;
+
+    for (ii = nstart; ii >= 0 && ii < nend; ++ii) {
+
+        const auto ik_prod = ik_vec[ii];
+        const auto is_now = is_vec[ii];
+        const auto js_now = js_vec[ii];
+
+        const auto ik = ik_prod / nk_scph;
+        const auto jk = ik_prod % nk_scph;
+        knum = kmap_interpolate_to_scph[kmesh_coarse->kpoint_irred_all[ik][0].knum];
+
+        if (ik_prod != ik_prod_old) {
+
+            // Update v4_array_at_kpair and ind
+
+            anharmonic_core->calc_phi4_reciprocal(kmesh_dense->xk[knum],
+                                                  kmesh_dense->xk[jk],
+                                                  kmesh_dense->xk[kmesh_dense->kindex_minus_xk[jk]],
+                                                  phase_factor_scph,
+                                                  phi4_reciprocal);
+
+#ifdef _OPENMP
+#pragma omp parallel for private(j)
+#endif
+            for (long int iig = 0; iig < ngroup_v4; ++iig) {
+                v4_array_at_kpair[iig] = phi4_reciprocal[iig] * anharmonic_core->get_invmass_factor(4)[iig];
+                for (j = 0; j < 4; ++j) ind[iig][j] = anharmonic_core->get_evec_index(4)[iig][j];
+            }
+            ik_prod_old = ik_prod;
+        }
+
+        if (js_now >= 0) {
+
+            // One (is, js) row of the full matrix.
+
+#pragma omp parallel for private(i)
+            for (long int jjs = 0; jjs < ns2; ++jjs) {
+
+                const auto ks = jjs / ns;
+                const auto ls = jjs % ns;
+
+                auto ret = std::complex<double>(0.0, 0.0);
+
+                for (i = 0; i < ngroup_v4; ++i) {
+
+                    ret += v4_array_at_kpair[i]
+                           * std::conj(evec_in[knum][is_now][ind[i][0]])
+                           * evec_in[knum][js_now][ind[i][1]]
+                           * evec_in[jk][ks][ind[i][2]]
+                           * std::conj(evec_in[jk][ls][ind[i][3]]);
+                }
+
+                v4_mpi[ik_prod][ns * is_now + js_now][jjs] = factor * ret;
+            }
+
+        } else {
+
+            // One diagonal row: (is, is) x (js, js) elements only.
+
+#pragma omp parallel for private(i)
+            for (long int jjs = 0; jjs < ns; ++jjs) {
+
+                auto ret = std::complex<double>(0.0, 0.0);
+
+                for (i = 0; i < ngroup_v4; ++i) {
+
+                    ret += v4_array_at_kpair[i]
+                           * std::conj(evec_in[knum][is_now][ind[i][0]])
+                           * evec_in[knum][is_now][ind[i][1]]
+                           * evec_in[jk][jjs][ind[i][2]]
+                           * std::conj(evec_in[jk][jjs][ind[i][3]]);
+                }
+
+                v4_mpi[ik_prod][(ns + 1) * is_now][(ns + 1) * jjs] = factor * ret;
+            }
+        }
+    } // loop over the assigned slice
+
+    deallocate(v4_array_at_kpair);
+    deallocate(ind);
+
+// Now, communicate the calculated data.
+// When the data count is larger than 2^31-1, split it.
+
+    long maxsize = 1;
+    maxsize = (maxsize << 31) - 1;
+
+    const size_t count = nk2_prod * ns4;
+    const size_t count_sub = ns4;
+
+    if (count <= maxsize) {
+#ifdef MPI_CXX_DOUBLE_COMPLEX
+        MPI_Allreduce(&v4_mpi[0][0][0], &v4_out[0][0][0], count,
+                      MPI_CXX_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+#else
+        MPI_Allreduce(&v4_mpi[0][0][0], &v4_out[0][0][0], count,
+                      MPI_COMPLEX16, MPI_SUM, MPI_COMM_WORLD);
+#endif
+    } else if (count_sub <= maxsize) {
+        for (size_t ik_prod = 0; ik_prod < nk2_prod; ++ik_prod) {
+#ifdef MPI_CXX_DOUBLE_COMPLEX
+            MPI_Allreduce(&v4_mpi[ik_prod][0][0], &v4_out[ik_prod][0][0],
+                          count_sub,
+                          MPI_CXX_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+#else
+            MPI_Allreduce(&v4_mpi[ik_prod][0][0], &v4_out[ik_prod][0][0],
+                          count_sub,
+                          MPI_COMPLEX16, MPI_SUM, MPI_COMM_WORLD);
+#endif
+        }
+    } else {
+        for (size_t ik_prod = 0; ik_prod < nk2_prod; ++ik_prod) {
+            for (is = 0; is < ns2; ++is) {
+#ifdef MPI_CXX_DOUBLE_COMPLEX
+                MPI_Allreduce(&v4_mpi[ik_prod][is][0], &v4_out[ik_prod][is][0],
+                              ns2,
+                              MPI_CXX_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+#else
+                MPI_Allreduce(&v4_mpi[ik_prod][is][0], &v4_out[ik_prod][is][0],
+                              ns2,
+                              MPI_COMPLEX16, MPI_SUM, MPI_COMM_WORLD);
+#endif
+            }
+        }
+    }
+
+    deallocate(v4_mpi);
+
+    zerofill_elements_acoustic_at_gamma(omega2_harmonic, v4_out, 4);
+
+    if (mympi->my_rank == 0) {
+        std::cout << " done !" << std::endl;
+        timer->print_elapsed();
+    }
+}
+
+void Scph::compress_v4_array(const std::complex<double> *const *const *v4_array_all,
+                             const bool offdiag)
+{
+    // Convert the dense v4 array into the sparse row representation
+    // consumed by compute_anharmonic_frequency. The dense array stores
+    // the full (ns^2 x ns^2) block per k pair although only the lower
+    // triangle of the (is, js) rows (offdiag) or the diagonal rows
+    // carry data, so the conversion alone roughly halves the memory;
+    // on top of that, elements whose magnitude is below
+    // V4_SPARSE * max|v4| are dropped.
+
+    const auto nk = kmesh_dense->nk;
+    const auto ns = dynamical->neval;
+    const auto ns2 = ns * ns;
+    const auto nk_irred_interpolate = kmesh_coarse->nk_irred;
+
+    size_t nelems_kept = 0;
+    size_t nelems_read = 0;
+
+    v4_sparse_rows.clear();
+    v4_sparse_rows.resize(nk_irred_interpolate);
+    v4_onsite.clear();
+    v4_onsite.resize(nk_irred_interpolate);
+
+    auto v4_max = 0.0;
+
+    for (auto ik = 0; ik < nk_irred_interpolate; ++ik) {
+        for (auto jk = 0; jk < nk; ++jk) {
+            const auto kk = nk * ik + jk;
+            for (auto i = 0; i < ns2; ++i) {
+                for (auto j = 0; j < ns2; ++j) {
+                    v4_max = std::max(v4_max, std::abs(v4_array_all[kk][i][j]));
+                }
+            }
+        }
+    }
+
+    const auto cutoff = v4_sparse * v4_max;
+
+    for (auto ik = 0; ik < nk_irred_interpolate; ++ik) {
+
+        const auto knum_interpolate = kmesh_coarse->kpoint_irred_all[ik][0].knum;
+        const auto knum = kmap_interpolate_to_scph[knum_interpolate];
+
+        v4_sparse_rows[ik].resize(ns2);
+        v4_onsite[ik].resize(ns);
+
+        for (auto is = 0; is < ns; ++is) {
+            v4_onsite[ik][is] = v4_array_all[nk * ik + knum][(ns + 1) * is][(ns + 1) * is];
+        }
+
+        for (auto is = 0; is < ns; ++is) {
+            for (auto js = 0; js <= is; ++js) {
+
+                if (!offdiag && js != is) continue;
+
+                const auto i = ns * is + js;
+                auto &row = v4_sparse_rows[ik][i];
 
-    zerofill_elements_acoustic_at_gamma(omega2_harmonic, v4_out, 4);
+                for (auto jk = 0; jk < nk; ++jk) {
+                    const auto kk = nk * ik + jk;
+                    for (auto ks = 0; ks < ns; ++ks) {
+                        for (auto ls = 0; ls < ns; ++ls) {
 
-    if (mympi->my_rank == 0) {
-        std::cout << " done !" << std::endl;
-        timer->print_elapsed();
+                            if (!offdiag && ls != ks) continue;
+
+                            const auto val = v4_array_all[kk][i][ns * ks + ls];
+                            ++nelems_read;
+                            if (std::abs(val) > cutoff) {
+                                row.push_back(V4SparseElement{static_cast<unsigned int>(jk),
+                                                              static_cast<unsigned int>(ks),
+                                                              static_cast<unsigned int>(ls),
+                                                              val});
+                            }
+                        }
+                    }
+                }
+                nelems_kept += row.size();
+            }
+        }
     }
+
+    const auto nelems_dense = static_cast<size_t>(nk_irred_interpolate) * nk * ns2 * ns2;
+    const auto mem_dense = static_cast<double>(nelems_dense)
+                           * sizeof(std::complex<double>) / 1.0e+9;
+    const auto mem_sparse = static_cast<double>(nelems_kept)
+                            * sizeof(V4SparseElement) / 1.0e+9;
+
+    std::cout << std::endl;
+    std::cout << " V4_SPARSE > 0: Using the sparse storage of the v4 array." << std::endl;
+    std::cout << "  Number of elements kept : " << nelems_kept
+              << " / " << nelems_read << std::endl;
+    std::cout << "  Memory usage (dense -> sparse) : "
+              << std::fixed << std::setprecision(4)
+              << mem_dense << " GB -> " << mem_sparse << " GB" << std::endl;
+    std::cout << std::endl;
 }
 
 void Scph::zerofill_elements_acoustic_at_gamma(double **omega2,
@@ -1614,26 +2550,24 @@ void Scph::setup_kmesh()
 
 void Scph::setup_transform_symmetry()
 {
-    // Construct small_group_at_k, symop_minus_at_k, and
-    // mat_transport_sym.
+    // Construct small_group_at_k, symop_minus_at_k, and the flat
+    // tables (symrot_cart, symperm_atom, symphase_atom) representing
+    // the action of each symmetry operation on the dynamical matrix.
 
     unsigned int ik;
-    unsigned int is, js;
     unsigned int icrd, jcrd;
     double x1[3], x2[3], k[3], k_minus[3], Sk[3], xtmp[3];
-    double S_cart[3][3], S_frac[3][3], S_frac_inv[3][3];
+    double S_frac[3][3], S_frac_inv[3][3];
     double S_recip[3][3];
     std::complex<double> im(0.0, 1.0);
-    std::complex<double> **gamma_tmp;
     bool *flag;
 
     const auto natmin = system->natmin;
-    const auto ns = dynamical->neval;
     const auto nk_irred_interpolate = kmesh_coarse->nk_irred;
 
-    allocate(gamma_tmp, ns, ns);
-    allocate(mat_transform_sym, nk_irred_interpolate,
-             symmetry->nsym, ns, ns);
+    allocate(symrot_cart, symmetry->nsym, 9);
+    allocate(symperm_atom, symmetry->nsym, natmin);
+    allocate(symphase_atom, nk_irred_interpolate, symmetry->nsym, natmin);
     //allocate(small_group_at_k, nk_irred_interpolate);
     allocate(symop_minus_at_k, nk_irred_interpolate);
     allocate(kpoint_map_symmetry, kmesh_coarse->nk);
@@ -1660,12 +2594,20 @@ void Scph::setup_transform_symmetry()
 
             for (icrd = 0; icrd < 3; ++icrd) {
                 for (jcrd = 0; jcrd < 3; ++jcrd) {
-                    S_cart[icrd][jcrd] = it.rot[3 * icrd + jcrd];
                     S_frac[icrd][jcrd] = it.rot_real[3 * icrd + jcrd];
                     S_recip[icrd][jcrd] = it.rot_reciprocal[3 * icrd + jcrd];
                 }
             }
 
+            if (ik == 0) {
+                for (icrd = 0; icrd < 9; ++icrd) {
+                    symrot_cart[isym][icrd] = it.rot[icrd];
+                }
+                for (unsigned int jat = 0; jat < natmin; ++jat) {
+                    symperm_atom[isym][jat] = it.mapping[jat];
+                }
+            }
+
             invmat3(S_frac_inv, S_frac);
             rotvec(Sk, k, S_recip);
 
@@ -1685,12 +2627,6 @@ void Scph::setup_transform_symmetry()
                 flag[knum_sym] = true;
             }
 
-            for (is = 0; is < ns; ++is) {
-                for (js = 0; js < ns; ++js) {
-                    gamma_tmp[is][js] = std::complex<double>(0.0, 0.0);
-                }
-            }
-
             for (unsigned int jat = 0; jat < natmin; ++jat) {
                 const auto iat = it.mapping[jat];
 
@@ -1707,69 +2643,86 @@ void Scph::setup_transform_symmetry()
 
                 auto phase = 2.0 * pi * (k[0] * xtmp[0] + k[1] * xtmp[1] + k[2] * xtmp[2]);
 
-                for (icrd = 0; icrd < 3; ++icrd) {
-                    for (jcrd = 0; jcrd < 3; ++jcrd) {
-                        gamma_tmp[3 * iat + icrd][3 * jat + jcrd]
-                                = S_cart[icrd][jcrd] * std::exp(im * phase);
-                    }
-                }
-            }
-
-            for (is = 0; is < ns; ++is) {
-                for (js = 0; js < ns; ++js) {
-                    mat_transform_sym[ik][isym][is][js] = gamma_tmp[is][js];
-                }
+                symphase_atom[ik][isym][jat] = std::exp(im * phase);
             }
 
             ++isym;
         }
     }
 
-    deallocate(gamma_tmp);
     deallocate(flag);
 }
 
-void Scph::symmetrize_dynamical_matrix(const unsigned int ik,
-                                       Eigen::MatrixXcd &dymat) const
+void Scph::transform_dymat_by_symop(const unsigned int ik_irred,
+                                    const unsigned int isym,
+                                    const Eigen::MatrixXcd &dymat_in,
+                                    Eigen::MatrixXcd &dymat_out) const
 {
-    // Symmetrize the dynamical matrix of given index ik.
+    // Compute Gamma(S) D Gamma(S)^{dagger} from the flat symmetry tables.
+    // Gamma(S) is block sparse: block (iat, jat) is nonzero only for
+    // iat = symperm_atom[isym][jat], where it equals the Cartesian
+    // rotation matrix times a phase factor. The product therefore
+    // reduces to 3x3 block rotations instead of dense ns x ns GEMMs.
     using namespace Eigen;
-    unsigned int i, isym;
-    unsigned int is, js;
-    const auto ns = dynamical->neval;
-    MatrixXcd dymat_sym = MatrixXcd::Zero(ns, ns);
-    MatrixXcd dymat_tmp(ns, ns), gamma(ns, ns);
+    const auto natmin = system->natmin;
 
-    const auto nsym_small = kmesh_coarse->small_group_of_k[ik].size();
-    const auto nsym_minus = symop_minus_at_k[ik].size();
+    Matrix3d S;
+    for (auto icrd = 0; icrd < 3; ++icrd) {
+        for (auto jcrd = 0; jcrd < 3; ++jcrd) {
+            S(icrd, jcrd) = symrot_cart[isym][3 * icrd + jcrd];
+        }
+    }
 
-    for (i = 0; i < nsym_minus; ++i) {
-        isym = symop_minus_at_k[ik][i];
+    for (unsigned int jat1 = 0; jat1 < natmin; ++jat1) {
+        const auto iat1 = symperm_atom[isym][jat1];
+        const auto phase1 = symphase_atom[ik_irred][isym][jat1];
 
-        for (is = 0; is < ns; ++is) {
-            for (js = 0; js < ns; ++js) {
-                gamma(is, js) = mat_transform_sym[ik][isym][is][js];
-            }
-        }
+        for (unsigned int jat2 = 0; jat2 < natmin; ++jat2) {
+            const auto iat2 = symperm_atom[isym][jat2];
+            const auto phase2 = symphase_atom[ik_irred][isym][jat2];
 
-        dymat_tmp = gamma * dymat * gamma.transpose().conjugate();
-        dymat_sym += dymat_tmp.conjugate();
+            dymat_out.block<3, 3>(3 * iat1, 3 * iat2)
+                    = (phase1 * std::conj(phase2))
+                      * (S * dymat_in.block<3, 3>(3 * jat1, 3 * jat2) * S.transpose());
+        }
     }
+}
 
-    for (i = 0; i < nsym_small; ++i) {
-        isym = kmesh_coarse->small_group_of_k[ik][i];
+void Scph::symmetrize_dynamical_matrix(const unsigned int ik,
+                                       Eigen::MatrixXcd &dymat) const
+{
+    // Symmetrize the dynamical matrix of given index ik.
+    using namespace Eigen;
+    const auto ns = dynamical->neval;
+    MatrixXcd dymat_sym = MatrixXcd::Zero(ns, ns);
 
-        for (is = 0; is < ns; ++is) {
-            for (js = 0; js < ns; ++js) {
-                gamma(is, js) = mat_transform_sym[ik][isym][is][js];
+    const int nsym_small = kmesh_coarse->small_group_of_k[ik].size();
+    const int nsym_minus = symop_minus_at_k[ik].size();
+    const int nsym_tot = nsym_minus + nsym_small;
+
+#pragma omp parallel
+    {
+        MatrixXcd dymat_tmp(ns, ns);
+        MatrixXcd dymat_accum = MatrixXcd::Zero(ns, ns);
+
+#pragma omp for nowait
+        for (int i = 0; i < nsym_tot; ++i) {
+            if (i < nsym_minus) {
+                transform_dymat_by_symop(ik, symop_minus_at_k[ik][i],
+                                         dymat, dymat_tmp);
+                dymat_accum += dymat_tmp.conjugate();
+            } else {
+                transform_dymat_by_symop(ik, kmesh_coarse->small_group_of_k[ik][i - nsym_minus],
+                                         dymat, dymat_tmp);
+                dymat_accum += dymat_tmp;
             }
         }
 
-        dymat_tmp = gamma * dymat * gamma.transpose().conjugate();
-        dymat_sym += dymat_tmp;
+#pragma omp critical
+        dymat_sym += dymat_accum;
     }
 
-    dymat = dymat_sym / static_cast<double>(nsym_small + nsym_minus);
+    dymat = dymat_sym / static_cast<double>(nsym_tot);
 }
 
 void Scph::replicate_dymat_for_all_kpoints(std::complex<double> ***dymat_inout) const
@@ -1778,29 +2731,33 @@ void Scph::replicate_dymat_for_all_kpoints(std::complex<double> ***dymat_inout)
     unsigned int i;
     unsigned int is, js;
     const auto ns = dynamical->neval;
-    MatrixXcd dymat_tmp(ns, ns), gamma(ns, ns), dymat(ns, ns);
 
     std::complex<double> ***dymat_all;
 
     allocate(dymat_all, ns, ns, kmesh_coarse->nk);
 
-    for (i = 0; i < kmesh_coarse->nk; ++i) {
+#pragma omp parallel private(is, js)
+    {
+        MatrixXcd dymat_tmp(ns, ns), dymat(ns, ns);
 
-        const auto ik_irred = kpoint_map_symmetry[i].knum_irred_orig;
-        const auto ik_orig = kpoint_map_symmetry[i].knum_orig;
-        const auto isym = kpoint_map_symmetry[i].symmetry_op;
+#pragma omp for
+        for (int ik = 0; ik < static_cast<int>(kmesh_coarse->nk); ++ik) {
 
-        for (is = 0; is < ns; ++is) {
-            for (js = 0; js < ns; ++js) {
-                gamma(is, js) = mat_transform_sym[ik_irred][isym][is][js];
-                dymat(is, js) = dymat_inout[is][js][ik_orig];
+            const auto ik_irred = kpoint_map_symmetry[ik].knum_irred_orig;
+            const auto ik_orig = kpoint_map_symmetry[ik].knum_orig;
+            const auto isym = kpoint_map_symmetry[ik].symmetry_op;
+
+            for (is = 0; is < ns; ++is) {
+                for (js = 0; js < ns; ++js) {
+                    dymat(is, js) = dymat_inout[is][js][ik_orig];
+                }
             }
-        }
-        dymat_tmp = gamma * dymat * gamma.transpose().conjugate();
+            transform_dymat_by_symop(ik_irred, isym, dymat, dymat_tmp);
 
-        for (is = 0; is < ns; ++is) {
-            for (js = 0; js < ns; ++js) {
-                dymat_all[is][js][i] = dymat_tmp(is, js);
+            for (is = 0; is < ns; ++is) {
+                for (js = 0; js < ns; ++js) {
+                    dymat_all[is][js][ik] = dymat_tmp(is, js);
+                }
             }
         }
     }
@@ -1824,8 +2781,8 @@ void Scph::setup_eigvecs()
                   << " Diagonalizing dynamical matrices for all k points ... ";
     }
 
-    allocate(evec_harmonic, kmesh_dense->nk, ns, ns);
-    allocate(omega2_harmonic, kmesh_dense->nk, ns);
+    allocate_first_touch(evec_harmonic, kmesh_dense->nk, ns, ns);
+    allocate_first_touch(omega2_harmonic, kmesh_dense->nk, ns);
 
     // Calculate phonon eigenvalues and eigenvectors for all k-points for scph
 
@@ -2006,6 +2963,117 @@ void Scph::setup_transform_ifc()
     deallocate(x_all);
 }
 
+void Scph::prepare_r2q_phase_table()
+{
+    // Tabulate the phase factors of r2q for the dense SCPH k mesh.
+    // exec_interpolation is called once per SCF iteration per
+    // temperature with the same mesh, so evaluating the exponentials
+    // of all k points in one batch here removes them from the hot loop
+    // entirely. The shift vectors are shared between many
+    // (iat, jat, icell) entries, hence only the unique ones are stored.
+
+    const auto nat = system->natmin;
+    const auto nk = kmesh_dense->nk;
+    const auto ncell = kmesh_coarse->nk;
+    const std::complex<double> im(0.0, 1.0);
+
+    std::vector<ShiftCell> shift_unique;
+    std::map<std::vector<int>, unsigned int> shift_map;
+
+    r2q_shift_index.clear();
+    r2q_shift_index.resize(static_cast<size_t>(nat) * nat * ncell);
+
+    for (unsigned int iat = 0; iat < nat; ++iat) {
+        for (unsigned int jat = 0; jat < nat; ++jat) {
+            for (unsigned int icell = 0; icell < ncell; ++icell) {
+
+                auto &index_now = r2q_shift_index[(iat * nat + jat) * ncell + icell];
+
+                for (const auto &it: mindist_list_scph[iat][jat][icell].shift) {
+                    const std::vector<int> key{it.sx, it.sy, it.sz};
+                    const auto found = shift_map.find(key);
+                    unsigned int idx;
+                    if (found == shift_map.end()) {
+                        idx = shift_unique.size();
+                        shift_map[key] = idx;
+                        shift_unique.push_back(it);
+                    } else {
+                        idx = found->second;
+                    }
+                    index_now.push_back(idx);
+                }
+            }
+        }
+    }
+
+    const auto nshift = shift_unique.size();
+
+    r2q_phase_table.clear();
+    r2q_phase_table.resize(nk);
+
+#pragma omp parallel for
+    for (long int ik = 0; ik < nk; ++ik) {
+        r2q_phase_table[ik].resize(nshift);
+        for (size_t is = 0; is < nshift; ++is) {
+            const auto phase = 2.0 * pi
+                               * (static_cast<double>(shift_unique[is].sx) * kmesh_dense->xk[ik][0]
+                                  + static_cast<double>(shift_unique[is].sy) * kmesh_dense->xk[ik][1]
+                                  + static_cast<double>(shift_unique[is].sz) * kmesh_dense->xk[ik][2]);
+            r2q_phase_table[ik][is] = std::exp(im * phase);
+        }
+    }
+}
+
+void Scph::r2q_from_table(const unsigned int ik,
+                          const unsigned int ns,
+                          std::complex<double> ***dymat_r_in,
+                          std::complex<double> **dymat_k_out) const
+{
+    // Same sum as r2q, but with the phase factors taken from the table
+    // prepared for the dense SCPH mesh.
+
+    const auto nat = ns / 3;
+    const auto ncell = kmesh_coarse->nk;
+    const auto &table = r2q_phase_table[ik];
+
+    std::vector<std::complex<double>> exp_phase(ncell);
+
+    for (unsigned int iat = 0; iat < nat; ++iat) {
+        for (unsigned int jat = 0; jat < nat; ++jat) {
+
+            const auto base = (iat * nat + jat) * ncell;
+
+            // The phase factor depends only on the atom pair, so it is
+            // gathered once and reused for the nine Cartesian components
+            // of the block, which the compiler can fully unroll.
+
+            for (unsigned int icell = 0; icell < ncell; ++icell) {
+
+                const auto &index_now = r2q_shift_index[base + icell];
+
+                auto sum_tmp = std::complex<double>(0.0, 0.0);
+                for (const auto &idx: index_now) {
+                    sum_tmp += table[idx];
+                }
+                exp_phase[icell] = sum_tmp / static_cast<double>(index_now.size());
+            }
+
+            for (unsigned int a = 0; a < 3; ++a) {
+                const auto i = 3 * iat + a;
+                for (unsigned int b = 0; b < 3; ++b) {
+                    const auto j = 3 * jat + b;
+
+                    auto sum_tmp = std::complex<double>(0.0, 0.0);
+                    for (unsigned int icell = 0; icell < ncell; ++icell) {
+                        sum_tmp += dymat_r_in[i][j][icell] * exp_phase[icell];
+                    }
+                    dymat_k_out[i][j] = sum_tmp;
+                }
+            }
+        }
+    }
+}
+
 void Scph::exec_interpolation(const unsigned int kmesh_orig[3],
                               std::complex<double> ***dymat_r,
                               const unsigned int nk_dense,
@@ -2025,6 +3093,11 @@ void Scph::exec_interpolation(const unsigned int kmesh_orig[3],
     std::complex<double> **mat_harmonic, **mat_harmonic_na;
     std::vector<double> eval_vec(ns);
 
+    // The phase table only covers the dense SCPH mesh; any other mesh
+    // (band paths, the DOS mesh of the postprocess) takes the direct sum.
+    const auto use_phase_table = kmesh_dense && (xk_dense == kmesh_dense->xk)
+                                 && !r2q_phase_table.empty();
+
     allocate(mat_tmp, ns, ns);
     allocate(eval_real, ns);
     allocate(mat_harmonic, ns, ns);
@@ -2045,7 +3118,11 @@ void Scph::exec_interpolation(const unsigned int kmesh_orig[3],
                                        mat_harmonic);
         }
 
-        r2q(xk_dense[ik], nk1, nk2, nk3, ns, dymat_r, mat_tmp);
+        if (use_phase_table) {
+            r2q_from_table(ik, ns, dymat_r, mat_tmp);
+        } else {
+            r2q(xk_dense[ik], nk1, nk2, nk3, ns, dymat_r, mat_tmp);
+        }
 
         for (i = 0; i < ns; ++i) {
             for (j = 0; j < ns; ++j) {
@@ -2112,21 +3189,21 @@ void Scph::r2q(const double *xk_in,
 {
     std::complex<double> im(0.0, 1.0);
 
+    const auto nat = ns / 3;
     const auto ncell = nx * ny * nz;
 
-    for (unsigned int i = 0; i < ns; ++i) {
-
-        const auto iat = i / 3;
+    std::vector<std::complex<double>> exp_phase(ncell);
 
-        for (unsigned int j = 0; j < ns; ++j) {
-
-            const auto jat = j / 3;
+    for (unsigned int iat = 0; iat < nat; ++iat) {
+        for (unsigned int jat = 0; jat < nat; ++jat) {
 
-            dymat_k_out[i][j] = std::complex<double>(0.0, 0.0);
+            // The phase factor depends only on the atom pair, so it is
+            // computed once and reused for the nine Cartesian components
+            // of the block.
 
             for (unsigned int icell = 0; icell < ncell; ++icell) {
 
-                auto exp_phase = std::complex<double>(0.0, 0.0);
+                auto sum_tmp = std::complex<double>(0.0, 0.0);
 
                 // This operation is necessary for the Hermiticity of the dynamical matrix.
                 for (const auto &it: mindist_list_scph[iat][jat][icell].shift) {
@@ -2136,13 +3213,24 @@ void Scph::r2q(const double *xk_in,
                                     + static_cast<double>(it.sy) * xk_in[1]
                                     + static_cast<double>(it.sz) * xk_in[2]);
 
-                    exp_phase += std::exp(im * phase);
+                    sum_tmp += std::exp(im * phase);
                 }
-                exp_phase /= static_cast<double>(mindist_list_scph[iat][jat][icell].shift.size());
-
-                dymat_k_out[i][j] += dymat_r_in[i][j][icell] * exp_phase;
+                exp_phase[icell] = sum_tmp
+                                   / static_cast<double>(mindist_list_scph[iat][jat][icell].shift.size());
             }
 
+            for (unsigned int a = 0; a < 3; ++a) {
+                const auto i = 3 * iat + a;
+                for (unsigned int b = 0; b < 3; ++b) {
+                    const auto j = 3 * jat + b;
+
+                    auto sum_tmp = std::complex<double>(0.0, 0.0);
+                    for (unsigned int icell = 0; icell < ncell; ++icell) {
+                        sum_tmp += dymat_r_in[i][j][icell] * exp_phase[icell];
+                    }
+                    dymat_k_out[i][j] = sum_tmp;
+                }
+            }
         }
     }
 }
@@ -2182,6 +3270,7 @@ void Scph::diagonalize_interpolated_matrix(std::complex<double> **mat_in,
         }
     }
 
+    count_event(EVENT_ZHEEV);
     zheev_(&JOBZ, &UPLO, &ns, amat, &ns, eval_out, WORK, &LWORK, RWORK, &INFO);
 
     k = 0;
@@ -2211,25 +3300,7 @@ void Scph::find_degeneracy(std::vector<int> *degeneracy_out,
     const auto tol_omega = 1.0e-7;
 
     for (unsigned int ik = 0; ik < nk_in; ++ik) {
-
-        degeneracy_out[ik].clear();
-
-        auto omega_prev = eval_in[ik][0];
-        auto ideg = 1;
-
-        for (unsigned int is = 1; is < ns; ++is) {
-            const auto omega_now = eval_in[ik][is];
-
-            if (std::abs(omega_now - omega_prev) < tol_omega) {
-                ++ideg;
-            } else {
-                degeneracy_out[ik].push_back(ideg);
-                ideg = 1;
-                omega_prev = omega_now;
-            }
-
-        }
-        degeneracy_out[ik].push_back(ideg);
+        Dynamical::detect_degeneracy(eval_in[ik], ns, tol_omega, degeneracy_out[ik]);
     }
 }
 
@@ -2237,93 +3308,87 @@ void Scph::calc_new_dymat_with_evec(std::complex<double> ***dymat_out,
                                     double **omega2_in,
                                     std::complex<double> ***evec_in)
 {
-    std::complex<double> *polarization_matrix, *mat_tmp;
-    std::complex<double> *eigval_matrix, *dmat;
-    std::complex<double> *beta;
-    std::complex<double> ***dymat_q, **dymat_harmonic;
+    std::complex<double> *evec_packed, *evec_scaled, *dmat_packed;
+    std::complex<double> ***dymat_q;
     std::complex<double> im(0.0, 1.0);
 
     unsigned int ik, is, js;
     int ns = dynamical->neval;
 
     const unsigned int ns2 = ns * ns;
+    const int nk_interpolate = kmesh_coarse->nk;
 
     auto alpha = std::complex<double>(1.0, 0.0);
+    auto beta = std::complex<double>(0.0, 0.0);
 
     char TRANSA[] = "N";
     char TRANSB[] = "C";
 
-    allocate(polarization_matrix, ns2);
-    allocate(mat_tmp, ns2);
-    allocate(eigval_matrix, ns2);
-    allocate(beta, ns);
-    allocate(dmat, ns2);
-    allocate(dymat_q, ns, ns, kmesh_coarse->nk);
-    allocate(dymat_harmonic, ns, ns);
-
-    for (is = 0; is < ns; ++is) beta[is] = std::complex<double>(0.0, 0.0);
+    allocate(evec_packed, nk_interpolate * ns2);
+    allocate(evec_scaled, nk_interpolate * ns2);
+    allocate(dmat_packed, nk_interpolate * ns2);
+    allocate(dymat_q, ns, ns, nk_interpolate);
 
-    for (ik = 0; ik < kmesh_coarse->nk; ++ik) {
+    // Transform the anharmonic frequencies back through the polarization
+    // vectors, U diag(omega2) U^{H}. The operands of all k points are packed
+    // contiguously with stride ns2 and processed as one strided batch: the
+    // diagonal factor is folded into a column scaling of U beforehand, so a
+    // single GEMM per slot remains, and the small GEMMs of the batch run
+    // concurrently over the k points of the interpolation mesh.
+#pragma omp parallel private(is, js)
+    {
+        std::complex<double> **dymat_harmonic;
+        allocate(dymat_harmonic, ns, ns);
 
-        const auto knum = kmap_interpolate_to_scph[ik];
+#pragma omp for
+        for (int ik_in = 0; ik_in < nk_interpolate; ++ik_in) {
 
-        // create eigval matrix
+            const auto knum = kmap_interpolate_to_scph[ik_in];
 
-        for (is = 0; is < ns2; ++is) eigval_matrix[is] = std::complex<double>(0.0, 0.0);
+            auto *mat_u = evec_packed + static_cast<size_t>(ik_in) * ns2;
+            auto *mat_b = evec_scaled + static_cast<size_t>(ik_in) * ns2;
+            auto *mat_d = dmat_packed + static_cast<size_t>(ik_in) * ns2;
 
-        unsigned int m = 0;
-        for (is = 0; is < ns; ++is) {
-            for (js = 0; js < ns; ++js) {
-                if (is == js) {
-                    eigval_matrix[m] = omega2_in[knum][is];
+            unsigned int m = 0;
+            for (is = 0; is < ns; ++is) {
+                const auto omega2_tmp = omega2_in[knum][is];
+                for (js = 0; js < ns; ++js) {
+                    mat_u[m] = evec_in[knum][is][js];
+                    mat_b[m] = mat_u[m] * omega2_tmp;
+                    ++m;
                 }
-                ++m;
             }
-        }
 
-        // create polarization matrix
+            zgemm_(TRANSA, TRANSB, &ns, &ns, &ns, &alpha,
+                   mat_b, &ns, mat_u, &ns, &beta, mat_d, &ns);
 
-        m = 0;
+            m = 0;
 
-        for (is = 0; is < ns; ++is) {
             for (js = 0; js < ns; ++js) {
-                polarization_matrix[m++] = evec_in[knum][is][js];
+                for (is = 0; is < ns; ++is) {
+                    dymat_q[is][js][ik_in] = mat_d[m];
+                    ++m;
+                }
             }
-        }
-
-        zgemm_(TRANSA, TRANSB, &ns, &ns, &ns, &alpha,
-               eigval_matrix, &ns, polarization_matrix, &ns, beta, mat_tmp, &ns);
-        zgemm_(TRANSA, TRANSA, &ns, &ns, &ns, &alpha,
-               polarization_matrix, &ns, mat_tmp, &ns, beta, dmat, &ns);
 
-        m = 0;
+            // Subtract harmonic contribution
+            dynamical->calc_analytic_k(kmesh_coarse->xk[ik_in],
+                                       fcs_phonon->fc2_ext,
+                                       dymat_harmonic);
 
-        for (js = 0; js < ns; ++js) {
             for (is = 0; is < ns; ++is) {
-                dymat_q[is][js][ik] = dmat[m];
-                ++m;
+                for (js = 0; js < ns; ++js) {
+                    dymat_q[is][js][ik_in] -= dymat_harmonic[is][js];
+                }
             }
         }
 
-
-        // Subtract harmonic contribution
-        dynamical->calc_analytic_k(kmesh_coarse->xk[ik],
-                                   fcs_phonon->fc2_ext,
-                                   dymat_harmonic);
-
-        for (is = 0; is < ns; ++is) {
-            for (js = 0; js < ns; ++js) {
-                dymat_q[is][js][ik] -= dymat_harmonic[is][js];
-            }
-        }
+        deallocate(dymat_harmonic);
     }
 
-    deallocate(polarization_matrix);
-    deallocate(mat_tmp);
-    deallocate(eigval_matrix);
-    deallocate(beta);
-    deallocate(dmat);
-    deallocate(dymat_harmonic);
+    deallocate(evec_packed);
+    deallocate(evec_scaled);
+    deallocate(dmat_packed);
 
     const auto nk1 = kmesh_interpolate[0];
     const auto nk2 = kmesh_interpolate[1];
@@ -2422,6 +3487,7 @@ void Scph::compute_anharmonic_frequency(std::complex<double> ***v4_array_all,
     double diff;
     double conv_tol = tolerance_scph;
     double alpha = mixalpha;
+    const auto use_sparse_v4 = v4_sparse > 0.0;
 
     double **eval_interpolate;
     double re_tmp, im_tmp;
@@ -2436,6 +3502,12 @@ void Scph::compute_anharmonic_frequency(std::complex<double> ***v4_array_all,
     std::vector<MatrixXcd> evec_initial;
     std::vector<MatrixXcd> Fmat0;
 
+    // History of iterates and residuals of the flattened density matrices
+    // for Anderson acceleration of the fixed-point iteration.
+    const int mmax_anderson = 4;
+    std::vector<VectorXcd> xvec_history, fvec_history;
+    double fnorm_old = 0.0;
+
     dmat_convert.resize(nk);
     dmat_convert_old.resize(nk);
     evec_initial.resize(nk);
@@ -2567,9 +3639,15 @@ void Scph::compute_anharmonic_frequency(std::complex<double> ***v4_array_all,
 
         // Mixing dmat
         if (iloop > 0) {
+            if (anderson_mixing) {
+                mix_dmat_anderson(dmat_convert, dmat_convert_old,
+                                  xvec_history, fvec_history,
+                                  mmax_anderson, alpha, fnorm_old);
+            } else {
 #pragma omp parallel for
-            for (ik = 0; ik < nk; ++ik) {
-                dmat_convert[ik] = alpha * dmat_convert[ik].eval() + (1.0-alpha) * dmat_convert_old[ik];
+                for (ik = 0; ik < nk; ++ik) {
+                    dmat_convert[ik] = alpha * dmat_convert[ik].eval() + (1.0-alpha) * dmat_convert_old[ik];
+                }
             }
         }
 
@@ -2583,7 +3661,35 @@ void Scph::compute_anharmonic_frequency(std::complex<double> ***v4_array_all,
 
             // Anharmonic correction to Fmat
 
-            if (!offdiag) {
+            if (use_sparse_v4) {
+
+                // Sparse storage: only the elements kept by
+                // compress_v4_array contribute, for both the diagonal
+                // and the off-diagonal algorithm.
+
+                for (is = 0; is < ns; ++is) {
+                    for (js = 0; js <= is; ++js) {
+
+                        if (!offdiag && js != is) continue;
+
+                        const auto &row = v4_sparse_rows[ik][ns * is + js];
+                        const auto nelem_row = static_cast<long int>(row.size());
+
+                        re_tmp = 0.0;
+                        im_tmp = 0.0;
+
+#pragma omp parallel for private(ctmp), reduction(+:re_tmp, im_tmp)
+                        for (long int ielem = 0; ielem < nelem_row; ++ielem) {
+                            const auto &elem = row[ielem];
+                            ctmp = elem.val * dmat_convert[elem.jk](elem.ks, elem.ls);
+                            re_tmp += ctmp.real();
+                            im_tmp += ctmp.imag();
+                        }
+                        Fmat(is, js) += std::complex<double>(re_tmp, im_tmp);
+                    }
+                }
+
+            } else if (!offdiag) {
                 for (is = 0; is < ns; ++is) {
                     i = (ns + 1) * is;
 
@@ -2653,7 +3759,11 @@ void Scph::compute_anharmonic_frequency(std::complex<double> ***v4_array_all,
                         std::cout << '\n';
                     }
 
-                    if (v4_array_all[nk * ik + knum][(ns + 1) * is][(ns + 1) * is].real() > 0.0) {
+                    const auto v4_onsite_now = use_sparse_v4
+                                               ? v4_onsite[ik][is]
+                                               : v4_array_all[nk * ik + knum][(ns + 1) * is][(ns + 1) * is];
+
+                    if (v4_onsite_now.real() > 0.0) {
                         if (verbosity > 1) {
                             std::cout << "  onsite V4 is positive\n\n";
                         }
@@ -2890,6 +4000,98 @@ void Scph::compute_anharmonic_frequency(std::complex<double> ***v4_array_all,
     deallocate(dymat_q_HA);
 }
 
+void Scph::mix_dmat_anderson(std::vector<Eigen::MatrixXcd> &dmat_new,
+                             const std::vector<Eigen::MatrixXcd> &dmat_old,
+                             std::vector<Eigen::VectorXcd> &xvec_history,
+                             std::vector<Eigen::VectorXcd> &fvec_history,
+                             const int mmax,
+                             const double alpha,
+                             double &fnorm_old) const
+{
+    // Anderson (type-II) acceleration of the SCPH fixed-point iteration.
+    //
+    // With x the accepted density matrices of the previous iteration
+    // (dmat_old) and g(x) the matrices just recomputed from them
+    // (dmat_new on entry), the residual is f = g(x) - x. The mixing
+    // coefficients gamma minimize |f - dF gamma| over the last mmax
+    // residual differences, and the accelerated iterate
+    //
+    //   x' = x + alpha * f - sum_j gamma_j (dX_j + alpha * dF_j)
+    //
+    // reduces to the plain linear mixing x + alpha * f when the history
+    // is empty. Whenever the residual norm grows strongly or the solve
+    // returns non-finite coefficients, the history is discarded and a
+    // plain linear step is taken, so the worst case behaves exactly
+    // like MIXALPHA mixing.
+
+    using namespace Eigen;
+
+    const auto nk = static_cast<int>(dmat_new.size());
+    const auto ns = static_cast<int>(dmat_new[0].rows());
+    const auto ndim = nk * ns * ns;
+
+    VectorXcd xvec(ndim), fvec(ndim);
+
+    for (auto ik = 0; ik < nk; ++ik) {
+        for (auto is = 0; is < ns; ++is) {
+            for (auto js = 0; js < ns; ++js) {
+                const auto idx = (ik * ns + is) * ns + js;
+                xvec(idx) = dmat_old[ik](is, js);
+                fvec(idx) = dmat_new[ik](is, js) - dmat_old[ik](is, js);
+            }
+        }
+    }
+
+    const auto fnorm = fvec.norm();
+    if (fnorm_old > 0.0 && fnorm > 2.0 * fnorm_old) {
+        xvec_history.clear();
+        fvec_history.clear();
+    }
+    fnorm_old = fnorm;
+
+    VectorXcd xvec_next = xvec + alpha * fvec;
+
+    const auto m = static_cast<int>(xvec_history.size());
+
+    if (m > 0) {
+        MatrixXcd dX(ndim, m), dF(ndim, m);
+        for (auto j = 0; j < m; ++j) {
+            dX.col(j) = xvec - xvec_history[m - 1 - j];
+            dF.col(j) = fvec - fvec_history[m - 1 - j];
+        }
+
+        // Solve the m x m normal equations with a small Tikhonov term
+        // instead of a QR decomposition of the ndim x m matrix; m is at
+        // most mmax, so this is cheap and numerically safe enough.
+        MatrixXcd AtA = dF.adjoint() * dF;
+        AtA.diagonal().array() += eps10 * AtA.trace();
+        const VectorXcd gamma = AtA.ldlt().solve(dF.adjoint() * fvec);
+
+        if (gamma.allFinite()) {
+            xvec_next -= (dX + alpha * dF) * gamma;
+        } else {
+            xvec_history.clear();
+            fvec_history.clear();
+        }
+    }
+
+    xvec_history.push_back(xvec);
+    fvec_history.push_back(fvec);
+    if (xvec_history.size() > static_cast<size_t>(mmax)) {
+        xvec_history.erase(xvec_history.begin());
+        fvec_history.erase(fvec_history.begin());
+    }
+
+#pragma omp parallel for
+    for (auto ik = 0; ik < nk; ++ik) {
+        for (auto is = 0; is < ns; ++is) {
+            for (auto js = 0; js < ns; ++js) {
+                dmat_new[ik](is, js) = xvec_next((ik * ns + is) * ns + js);
+            }
+        }
+    }
+}
+
 void Scph::compute_free_energy_bubble_SCPH(const unsigned int kmesh[3],
                                            std::complex<double> ****delta_dymat_scph)
 {
@@ -2958,7 +4160,6 @@ void Scph::bubble_correction(std::complex<double> ****delta_dymat_scph,
     double ***eval_bubble = nullptr;
     std::complex<double> ***evec;
     double *real_self = nullptr;
-    std::vector<std::complex<double>> omegalist;
 
     if (mympi->my_rank == 0) {
         std::cout << std::endl;
@@ -3015,120 +4216,115 @@ void Scph::bubble_correction(std::complex<double> ****delta_dymat_scph,
                 std::cout << ")\n";
             }
 
+            // The frequency points of every branch are collected first so
+            // that the |V3|^2 factors, which are shared between the
+            // branches up to the head polarization vector, are computed
+            // in a single MPI+OpenMP sweep over the (k1, s1, s2) space.
+
+            const auto domega = 0.1 * time_ry / Hz_to_kayser;
+
+            std::vector<std::vector<std::complex<double>>> omegalist_b(ns);
+            std::vector<std::vector<std::complex<double>>> se_bubble(ns);
+
             for (unsigned int snum = 0; snum < ns; ++snum) {
 
-                if (eval[knum][snum] < eps8) {
-                    if (mympi->my_rank == 0) real_self[snum] = 0.0;
-                } else {
-                    omegalist.clear();
+                omegalist_b[snum].clear();
 
-                    if (bubble == 1) {
+                if (eval[knum][snum] < eps8) continue;
 
-                        omegalist.push_back(im * epsilon);
+                if (bubble == 1) {
+                    omegalist_b[snum].push_back(im * epsilon);
+                } else if (bubble == 2) {
+                    omegalist_b[snum].push_back(eval[knum][snum] + im * epsilon);
+                } else if (bubble == 3) {
+                    auto maxfreq = eval[knum][snum] + 50.0 * time_ry / Hz_to_kayser;
+                    auto minfreq = eval[knum][snum] - 50.0 * time_ry / Hz_to_kayser;
 
-                        auto se_bubble = get_bubble_selfenergy(kmesh_dense,
-                                                               ns,
-                                                               eval,
-                                                               evec,
-                                                               knum,
-                                                               snum,
-                                                               temp,
-                                                               omegalist);
+                    if (minfreq < 0.0) minfreq = 0.0;
 
-                        if (mympi->my_rank == 0) real_self[snum] = se_bubble[0].real();
+                    auto nomega = static_cast<unsigned int>((maxfreq - minfreq) / domega) + 1;
 
-                    } else if (bubble == 2) {
+                    for (auto iomega = 0; iomega < nomega; ++iomega) {
+                        omegalist_b[snum].push_back(minfreq + static_cast<double>(iomega) * domega + im * epsilon);
+                    }
+                }
+            }
 
-                        omegalist.push_back(eval[knum][snum] + im * epsilon);
+            get_bubble_selfenergy_all_branches(kmesh_dense,
+                                               ns,
+                                               eval,
+                                               evec,
+                                               knum,
+                                               temp,
+                                               omegalist_b,
+                                               se_bubble);
 
-                        auto se_bubble = get_bubble_selfenergy(kmesh_dense,
-                                                               ns,
-                                                               eval,
-                                                               evec,
-                                                               knum,
-                                                               snum,
-                                                               temp,
-                                                               omegalist);
+            for (unsigned int snum = 0; snum < ns; ++snum) {
 
-                        if (mympi->my_rank == 0) real_self[snum] = se_bubble[0].real();
+                if (eval[knum][snum] < eps8) {
+                    if (mympi->my_rank == 0) real_self[snum] = 0.0;
+                } else if (bubble == 1 || bubble == 2) {
 
-                    } else if (bubble == 3) {
+                    if (mympi->my_rank == 0) real_self[snum] = se_bubble[snum][0].real();
 
-                        auto maxfreq = eval[knum][snum] + 50.0 * time_ry / Hz_to_kayser;
-                        auto minfreq = eval[knum][snum] - 50.0 * time_ry / Hz_to_kayser;
+                } else if (bubble == 3) {
 
-                        if (minfreq < 0.0) minfreq = 0.0;
+                    if (mympi->my_rank == 0) {
 
-                        const auto domega = 0.1 * time_ry / Hz_to_kayser;
-                        auto nomega = static_cast<unsigned int>((maxfreq - minfreq) / domega) + 1;
+                        const auto &omegalist_now = omegalist_b[snum];
+                        const auto nomega = omegalist_now.size();
 
+                        std::vector<double> nonlinear_func(nomega);
                         for (auto iomega = 0; iomega < nomega; ++iomega) {
-                            omegalist.push_back(minfreq + static_cast<double>(iomega) * domega + im * epsilon);
+                            nonlinear_func[iomega] = omegalist_now[iomega].real() * omegalist_now[iomega].real()
+                                                     - eval[knum][snum] * eval[knum][snum]
+                                                     + 2.0 * eval[knum][snum] * se_bubble[snum][iomega].real();
                         }
 
-                        auto se_bubble = get_bubble_selfenergy(kmesh_dense,
-                                                               ns,
-                                                               eval,
-                                                               evec,
-                                                               knum,
-                                                               snum,
-                                                               temp,
-                                                               omegalist);
-
-                        if (mympi->my_rank == 0) {
-
-                            std::vector<double> nonlinear_func(nomega);
-                            for (auto iomega = 0; iomega < nomega; ++iomega) {
-                                nonlinear_func[iomega] = omegalist[iomega].real() * omegalist[iomega].real()
-                                                         - eval[knum][snum] * eval[knum][snum]
-                                                         + 2.0 * eval[knum][snum] * se_bubble[iomega].real();
+                        // find a root of nonlinear_func = 0 from the sign change.
+                        int count_root = 0;
+                        std::vector<unsigned int> root_index;
+
+                        for (auto iomega = 0; iomega < nomega - 1; ++iomega) {
+                            if (nonlinear_func[iomega] * nonlinear_func[iomega + 1] < 0.0) {
+                                ++count_root;
+                                root_index.push_back(iomega);
                             }
+                        }
 
-                            // find a root of nonlinear_func = 0 from the sign change.
-                            int count_root = 0;
-                            std::vector<unsigned int> root_index;
+                        if (count_root == 0) {
+                            warn("bubble_correction",
+                                 "Could not find a root in the nonlinear equation at this temperature. "
+                                 "Use the w=0 component.");
 
-                            for (auto iomega = 0; iomega < nomega - 1; ++iomega) {
-                                if (nonlinear_func[iomega] * nonlinear_func[iomega + 1] < 0.0) {
-                                    ++count_root;
-                                    root_index.push_back(iomega);
-                                }
-                            }
+                            real_self[snum] = se_bubble[snum][0].real();
 
-                            if (count_root == 0) {
+                        } else {
+                            if (count_root > 1) {
                                 warn("bubble_correction",
-                                     "Could not find a root in the nonlinear equation at this temperature. "
-                                     "Use the w=0 component.");
-
-                                real_self[snum] = se_bubble[0].real();
-
-                            } else {
-                                if (count_root > 1) {
-                                    warn("bubble_correction",
-                                         "Multiple roots were found in the nonlinear equation at this temperature. "
-                                         "Use the lowest-frequency solution");
-                                    std::cout << "   solution found at the following frequencies:\n";
-                                    for (auto iroot = 0; iroot < count_root; ++iroot) {
-                                        std::cout << std::setw(15)
-                                                  << writes->in_kayser(omegalist[root_index[iroot]].real());
-                                    }
-                                    std::cout << '\n';
+                                     "Multiple roots were found in the nonlinear equation at this temperature. "
+                                     "Use the lowest-frequency solution");
+                                std::cout << "   solution found at the following frequencies:\n";
+                                for (auto iroot = 0; iroot < count_root; ++iroot) {
+                                    std::cout << std::setw(15)
+                                              << writes->in_kayser(omegalist_now[root_index[iroot]].real());
                                 }
+                                std::cout << '\n';
+                            }
 
-                                // Instead of performing a linear interpolation (secant method) of nonlinear_func,
-                                // we interpolate the bubble self-energy. Since the frequency grid is dense (0.1 cm^-1 step),
-                                // this approximation should not make any problems (hopefully).
+                            // Instead of performing a linear interpolation (secant method) of nonlinear_func,
+                            // we interpolate the bubble self-energy. Since the frequency grid is dense (0.1 cm^-1 step),
+                            // this approximation should not make any problems (hopefully).
 
-                                double omega_solution = omegalist[root_index[0] + 1].real()
-                                                        - nonlinear_func[root_index[0] + 1]
-                                                          * domega / (nonlinear_func[root_index[0] + 1] -
-                                                                      nonlinear_func[root_index[0]]);
+                            double omega_solution = omegalist_now[root_index[0] + 1].real()
+                                                    - nonlinear_func[root_index[0] + 1]
+                                                      * domega / (nonlinear_func[root_index[0] + 1] -
+                                                                  nonlinear_func[root_index[0]]);
 
-                                real_self[snum] = (se_bubble[root_index[0] + 1].real()
-                                                   - se_bubble[root_index[0]].real())
-                                                  * (omega_solution - omegalist[root_index[0] + 1].real()) / domega
-                                                  + se_bubble[root_index[0] + 1].real();
-                            }
+                            real_self[snum] = (se_bubble[snum][root_index[0] + 1].real()
+                                               - se_bubble[snum][root_index[0]].real())
+                                              * (omega_solution - omegalist_now[root_index[0] + 1].real()) / domega
+                                              + se_bubble[snum][root_index[0] + 1].real();
                         }
                     }
                 }
@@ -3189,18 +4385,24 @@ void Scph::bubble_correction(std::complex<double> ****delta_dymat_scph,
     }
 }
 
-std::vector<std::complex<double>> Scph::get_bubble_selfenergy(const KpointMeshUniform *kmesh_in,
-                                                              const unsigned int ns_in,
-                                                              const double *const *eval_in,
-                                                              const std::complex<double> *const *const *evec_in,
-                                                              const unsigned int knum,
-                                                              const unsigned int snum,
-                                                              const double temp_in,
-                                                              const std::vector<std::complex<double>> &omegalist)
+void Scph::get_bubble_selfenergy_all_branches(const KpointMeshUniform *kmesh_in,
+                                              const unsigned int ns_in,
+                                              const double *const *eval_in,
+                                              const std::complex<double> *const *const *evec_in,
+                                              const unsigned int knum,
+                                              const double temp_in,
+                                              const std::vector<std::vector<std::complex<double>>> &omegalist,
+                                              std::vector<std::vector<std::complex<double>>> &se_bubble)
 {
-    unsigned int arr_cubic[3];
+    // Bubble self-energy of every phonon branch at the k point knum in
+    // one sweep. The two tail legs of |V3|^2 are identical for all head
+    // branches, so they are contracted once per (k1, s1, s2) via
+    // V3_head_contracted and only the cheap head dot product and the
+    // frequency denominators are evaluated per branch. The (k1, s1, s2)
+    // space is distributed over MPI and the branch/frequency sweep over
+    // OpenMP threads.
+
     double xk_tmp[3];
-    std::complex<double> omega_sum[2];
 
     double factor = 1.0 / (static_cast<double>(kmesh_in->nk) * std::pow(2.0, 4));
     const auto ns2 = ns_in * ns_in;
@@ -3209,21 +4411,26 @@ std::vector<std::complex<double>> Scph::get_bubble_selfenergy(const KpointMeshUn
     double n1, n2;
     double f1, f2;
 
-    auto knum_minus = kmesh_in->kindex_minus_xk[knum];
-    arr_cubic[0] = ns_in * knum_minus + snum;
-
-    std::vector<std::complex<double>> se_bubble(omegalist.size());
+    const auto knum_minus = kmesh_in->kindex_minus_xk[knum];
 
-    const auto nomega = omegalist.size();
+    // Flatten the per-branch frequency lists for the MPI reduction.
 
-    std::complex<double> *ret_sum, *ret_mpi;
-    allocate(ret_sum, nomega);
-    allocate(ret_mpi, nomega);
+    std::vector<size_t> offset(ns_in + 1);
+    offset[0] = 0;
+    for (unsigned int snum = 0; snum < ns_in; ++snum) {
+        offset[snum + 1] = offset[snum] + omegalist[snum].size();
+    }
+    const auto ntot = offset[ns_in];
 
-    for (auto iomega = 0; iomega < nomega; ++iomega) {
-        ret_sum[iomega] = std::complex<double>(0.0, 0.0);
-        ret_mpi[iomega] = std::complex<double>(0.0, 0.0);
+    se_bubble.resize(ns_in);
+    for (unsigned int snum = 0; snum < ns_in; ++snum) {
+        se_bubble[snum].assign(omegalist[snum].size(), std::complex<double>(0.0, 0.0));
     }
+    if (ntot == 0) return;
+
+    std::vector<std::complex<double>> ret_mpi(ntot, std::complex<double>(0.0, 0.0));
+    std::vector<std::complex<double>> ret_sum(ntot, std::complex<double>(0.0, 0.0));
+    std::vector<std::complex<double>> head(ns_in);
 
     for (auto iks = mympi->my_rank; iks < nks; iks += mympi->nprocs) {
 
@@ -3237,14 +4444,14 @@ std::vector<std::complex<double>> Scph::get_bubble_selfenergy(const KpointMeshUn
         double omega1 = eval_in[ik1][is1];
         double omega2 = eval_in[ik2][is2];
 
-        arr_cubic[1] = ns_in * ik1 + is1;
-        arr_cubic[2] = ns_in * ik2 + is2;
+        if (omega1 < eps8 || omega2 < eps8) continue;
 
-        double v3_tmp = std::norm(anharmonic_core->V3(arr_cubic,
-                                                      kmesh_in->xk,
-                                                      eval_in,
-                                                      evec_in,
-                                                      phase_factor_scph));
+        anharmonic_core->V3_head_contracted(ns_in * ik1 + is1,
+                                            ns_in * ik2 + is2,
+                                            kmesh_in->xk,
+                                            evec_in,
+                                            phase_factor_scph,
+                                            &head[0]);
 
         if (thermodynamics->classical) {
             n1 = thermodynamics->fC(omega1, temp_in);
@@ -3257,26 +4464,42 @@ std::vector<std::complex<double>> Scph::get_bubble_selfenergy(const KpointMeshUn
             f1 = n1 + n2 + 1.0;
             f2 = n2 - n1;
         }
-        for (auto iomega = 0; iomega < nomega; ++iomega) {
-            omega_sum[0] = 1.0 / (omegalist[iomega] + omega1 + omega2) - 1.0 / (omegalist[iomega] - omega1 - omega2);
-            omega_sum[1] = 1.0 / (omegalist[iomega] + omega1 - omega2) - 1.0 / (omegalist[iomega] - omega1 + omega2);
-            ret_mpi[iomega] += v3_tmp * (f1 * omega_sum[0] + f2 * omega_sum[1]);
+
+#pragma omp parallel for
+        for (long int snum = 0; snum < ns_in; ++snum) {
+
+            const auto omega0 = eval_in[knum][snum];
+            if (omega0 < eps8 || omegalist[snum].empty()) continue;
+
+            auto v3 = std::complex<double>(0.0, 0.0);
+            for (unsigned int m = 0; m < ns_in; ++m) {
+                v3 += evec_in[knum_minus][snum][m] * head[m];
+            }
+            const auto v3_tmp = std::norm(v3) / (omega0 * omega1 * omega2);
+
+            std::complex<double> omega_sum[2];
+
+            for (size_t iomega = 0; iomega < omegalist[snum].size(); ++iomega) {
+                omega_sum[0] = 1.0 / (omegalist[snum][iomega] + omega1 + omega2)
+                               - 1.0 / (omegalist[snum][iomega] - omega1 - omega2);
+                omega_sum[1] = 1.0 / (omegalist[snum][iomega] + omega1 - omega2)
+                               - 1.0 / (omegalist[snum][iomega] - omega1 + omega2);
+                ret_mpi[offset[snum] + iomega] += v3_tmp * (f1 * omega_sum[0] + f2 * omega_sum[1]);
+            }
         }
     }
-    for (auto iomega = 0; iomega < nomega; ++iomega) {
-        ret_mpi[iomega] *= factor;
-    }
-
-    MPI_Reduce(&ret_mpi[0], &ret_sum[0], nomega, MPI_COMPLEX16, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    for (auto iomega = 0; iomega < nomega; ++iomega) {
-        se_bubble[iomega] = ret_sum[iomega];
+    for (size_t i = 0; i < ntot; ++i) {
+        ret_mpi[i] *= factor;
     }
 
-    deallocate(ret_mpi);
-    deallocate(ret_sum);
+    MPI_Reduce(&ret_mpi[0], &ret_sum[0], ntot, MPI_COMPLEX16, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    return se_bubble;
+    for (unsigned int snum = 0; snum < ns_in; ++snum) {
+        for (size_t iomega = 0; iomega < omegalist[snum].size(); ++iomega) {
+            se_bubble[snum][iomega] = ret_sum[offset[snum] + iomega];
+        }
+    }
 }
 
 double Scph::distance(double *x1,
@@ -64,6 +64,7 @@ public:
     unsigned int bubble;
 
     bool restart_scph;
+    bool dymat_binary;
     bool warmstart_scph;
     bool lower_temp;
     double tolerance_scph;
@@ -74,6 +75,9 @@ public:
 
     double mixalpha;
     unsigned int maxiter;
+    bool anderson_mixing;
+    bool adaptive_dt;
+    double v4_sparse;
     bool print_self_consistent_fc2;
     bool selfenergy_offdiagonal;
     bool relax_coordinate;
@@ -96,8 +100,15 @@ private:
     std::complex<double> ***evec_harmonic;
     MinimumDistList ***mindist_list_scph;
 
-    // Local variables for handling symmetry of dynamical matrix
-    std::complex<double> ****mat_transform_sym;
+    // Local variables for handling symmetry of dynamical matrix.
+    // Each symmetry operation acts on the dynamical matrix as a
+    // permutation of the 3x3 atom blocks (symperm_atom), a rotation of
+    // each block by the Cartesian rotation matrix (symrot_cart), and a
+    // k- and atom-dependent phase factor (symphase_atom). The three
+    // tables are stored flat instead of the full ns x ns Gamma matrices.
+    double **symrot_cart;
+    unsigned int **symperm_atom;
+    std::complex<double> ***symphase_atom;
     std::vector<int> *symop_minus_at_k;
     KpointSymmetry *kpoint_map_symmetry;
 
@@ -119,8 +130,27 @@ private:
 
     void load_scph_dymat_from_file(std::complex<double> ****);
 
+    void load_scph_dymat_from_binary(std::complex<double> ****);
+
+    void store_scph_dymat_to_binary(const std::complex<double> *const *const *const *dymat_in);
+
     void store_scph_dymat_to_file(const std::complex<double> *const *const *const *dymat_in);
 
+    // Incremental checkpoint of the SCPH temperature loop
+    // (PREFIX.scph_dymat_ckpt). Each converged temperature is appended to
+    // the file as soon as it is finished; an interrupted run restores the
+    // finished temperatures and recomputes only the rest. The file is
+    // removed once the final restart file has been written.
+
+    void load_scph_checkpoint(std::complex<double> ****dymat_out,
+                              std::vector<char> &is_done);
+
+    void append_scph_checkpoint(const unsigned int iT,
+                                const double temp,
+                                const std::complex<double> *const *const *dymat_in);
+
+    void remove_scph_checkpoint() const;
+
     void exec_scph_main(std::complex<double> ****);
 
     void postprocess(std::complex<double> ****delta_dymat_scph,
@@ -135,6 +165,28 @@ private:
                                            std::complex<double> ***,
                                            bool);
 
+    void compute_V4_elements_mpi_2d(std::complex<double> ***,
+                                    std::complex<double> ***,
+                                    bool,
+                                    bool);
+
+    // Optional sparse representation of the quartic matrix elements
+    // (V4_SPARSE > 0). Only the elements actually read in the SCPH
+    // iteration are kept, and those below the relative magnitude
+    // threshold are dropped.
+    struct V4SparseElement {
+        unsigned int jk;
+        unsigned int ks;
+        unsigned int ls;
+        std::complex<double> val;
+    };
+
+    std::vector<std::vector<std::vector<V4SparseElement>>> v4_sparse_rows;
+    std::vector<std::vector<std::complex<double>>> v4_onsite;
+
+    void compress_v4_array(const std::complex<double> *const *const *v4_array_all,
+                           bool offdiag);
+
     void compute_V3_elements_mpi_over_kpoint(std::complex<double> ***v3_out,
                                              const std::complex<double> *const *const *evec_in,
                                              const bool self_offdiag);
@@ -156,6 +208,14 @@ private:
                                       bool,
                                       const unsigned int verbosity);
 
+    void mix_dmat_anderson(std::vector<Eigen::MatrixXcd> &dmat_new,
+                           const std::vector<Eigen::MatrixXcd> &dmat_old,
+                           std::vector<Eigen::VectorXcd> &xvec_history,
+                           std::vector<Eigen::VectorXcd> &fvec_history,
+                           int mmax,
+                           double alpha,
+                           double &fnorm_old) const;
+
     void exec_interpolation(const unsigned int [3],
                             std::complex<double> ***,
                             unsigned int,
@@ -164,6 +224,21 @@ private:
                             double **,
                             std::complex<double> ***);
 
+    // Precomputed phase factors of r2q for the dense SCPH k mesh.
+    // r2q_shift_index maps every shift of mindist_list_scph to a unique
+    // shift vector, and r2q_phase_table holds exp(2 pi i s.k) for each
+    // unique shift and each k point of kmesh_dense, so the exponentials
+    // are never re-evaluated inside the SCF loop.
+    std::vector<std::vector<unsigned int>> r2q_shift_index;
+    std::vector<std::vector<std::complex<double>>> r2q_phase_table;
+
+    void prepare_r2q_phase_table();
+
+    void r2q_from_table(unsigned int ik,
+                        unsigned int ns,
+                        std::complex<double> ***dymat_r_in,
+                        std::complex<double> **dymat_k_out) const;
+
     void r2q(const double *,
              unsigned int,
              unsigned int,
@@ -184,6 +259,11 @@ private:
     static double distance(double *,
                            double *);
 
+    void transform_dymat_by_symop(unsigned int ik_irred,
+                                  unsigned int isym,
+                                  const Eigen::MatrixXcd &dymat_in,
+                                  Eigen::MatrixXcd &dymat_out) const;
+
     void symmetrize_dynamical_matrix(unsigned int,
                                      Eigen::MatrixXcd &) const;
 
@@ -213,14 +293,14 @@ private:
     void bubble_correction(std::complex<double> ****,
                            std::complex<double> ****);
 
-    std::vector<std::complex<double>> get_bubble_selfenergy(const KpointMeshUniform *kmesh_in,
-                                                            const unsigned int ns_in,
-                                                            const double *const *eval_in,
-                                                            const std::complex<double> *const *const *evec_in,
-                                                            const unsigned int knum,
-                                                            const unsigned int snum,
-                                                            const double temp_in,
-                                                            const std::vector<std::complex<double>> &omegalist);
+    void get_bubble_selfenergy_all_branches(const KpointMeshUniform *kmesh_in,
+                                            const unsigned int ns_in,
+                                            const double *const *eval_in,
+                                            const std::complex<double> *const *const *evec_in,
+                                            const unsigned int knum,
+                                            const double temp_in,
+                                            const std::vector<std::vector<std::complex<double>>> &omegalist,
+                                            std::vector<std::vector<std::complex<double>>> &se_bubble);
 
 };
 
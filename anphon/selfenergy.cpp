@@ -19,6 +19,7 @@
 #include "mathfunctions.h"
 #include "integration.h"
 #include "phonon_dos.h"
+#include <random>
 
 using namespace PHON_NS;
 
@@ -114,13 +115,15 @@ void Selfenergy::selfenergy_tadpole(const unsigned int N,
 
                 if (omega2 < eps8) continue;
 
+                const auto occ_row = thermodynamics->occupation_row(ik2, is2, N, T, eval_in);
+
                 for (i = 0; i < N; ++i) {
                     const auto T_tmp = T[i];
                     if (thermodynamics->classical) {
-                        n2 = thermodynamics->fC(omega2, T_tmp);
+                        n2 = occ_row ? occ_row[i] : thermodynamics->fC(omega2, T_tmp);
                         ret_mpi[i] += v3_tmp2 * 2.0 * n2;
                     } else {
-                        n2 = thermodynamics->fB(omega2, T_tmp);
+                        n2 = occ_row ? occ_row[i] : thermodynamics->fB(omega2, T_tmp);
                         ret_mpi[i] += v3_tmp2 * (2.0 * n2 + 1.0);
                     }
                 }
@@ -399,6 +402,160 @@ void Selfenergy::selfenergy_c(const unsigned int N,
     deallocate(ret_mpi);
 }
 
+void Selfenergy::selfenergy_c_stochastic(const unsigned int N,
+                                         const double *T,
+                                         const double omega,
+                                         const unsigned int knum,
+                                         const unsigned int snum,
+                                         const KpointMeshUniform *kmesh_in,
+                                         const double *const *eval_in,
+                                         const std::complex<double> *const *const *evec_in,
+                                         const double rel_err_target,
+                                         const unsigned long max_samples,
+                                         std::complex<double> *ret) const
+{
+    /*
+
+    Monte-Carlo estimator of Diagram (c).
+    The deterministic sum in selfenergy_c costs O(N_k^2 * N^3); here
+    quartets are drawn uniformly at random and the sum is estimated as
+    N_quartet * <sample>. Sampling stops when the standard error of
+    Im(Sigma) at the last temperature drops below rel_err_target relative
+    to its mean, or when max_samples quartets have been drawn in total.
+    Sampling is uniform: an importance weight built from the smearing
+    window would itself require the loop over all quartets that this
+    estimator is meant to avoid.
+
+    */
+
+    unsigned int i;
+    unsigned int arr_quartic[4];
+
+    const auto nk = kmesh_in->nk;
+    const auto xk = kmesh_in->xk;
+    double xk_tmp[3];
+
+    std::complex<double> omega_sum[4];
+    std::complex<double> *ret_mpi;
+
+    allocate(ret_mpi, N);
+
+    const std::complex<double> omega_shift = omega + im * epsilon;
+
+    for (i = 0; i < N; ++i) ret_mpi[i] = std::complex<double>(0.0, 0.0);
+
+    arr_quartic[0] = ns * kmesh_in->kindex_minus_xk[knum] + snum;
+
+    const auto nquartet = std::pow(static_cast<double>(nk), 2.0)
+                          * std::pow(static_cast<double>(ns), 3.0);
+
+    std::mt19937_64 rng(123456789ULL + 97ULL * static_cast<unsigned long long>(mympi->my_rank));
+    std::uniform_int_distribution<unsigned int> dist_k(0, nk - 1);
+    std::uniform_int_distribution<unsigned int> dist_s(0, ns - 1);
+
+    const unsigned long chunk = 1024;
+    unsigned long nsample_total = 0;
+    double stat_loc[2] = {0.0, 0.0}; // running sum and sum of squares of Im(sample)
+    auto converged = false;
+
+    while (!converged && nsample_total < max_samples) {
+
+        for (unsigned long isample = 0; isample < chunk; ++isample) {
+
+            const auto ik1 = dist_k(rng);
+            const auto ik2 = dist_k(rng);
+
+            xk_tmp[0] = xk[knum][0] - xk[ik1][0] - xk[ik2][0];
+            xk_tmp[1] = xk[knum][1] - xk[ik1][1] - xk[ik2][1];
+            xk_tmp[2] = xk[knum][2] - xk[ik1][2] - xk[ik2][2];
+
+            const auto ik3 = kmesh_in->get_knum(xk_tmp);
+
+            const auto is1 = dist_s(rng);
+            const auto is2 = dist_s(rng);
+            const auto is3 = dist_s(rng);
+
+            arr_quartic[1] = ns * ik1 + is1;
+            arr_quartic[2] = ns * ik2 + is2;
+            arr_quartic[3] = ns * ik3 + is3;
+
+            const auto omega1 = eval_in[ik1][is1];
+            const auto omega2 = eval_in[ik2][is2];
+            const auto omega3 = eval_in[ik3][is3];
+
+            const auto v4_tmp = std::norm(anharmonic_core->V4(arr_quartic));
+
+            omega_sum[0]
+                    = 1.0 / (omega_shift - omega1 - omega2 - omega3)
+                      - 1.0 / (omega_shift + omega1 + omega2 + omega3);
+            omega_sum[1]
+                    = 1.0 / (omega_shift - omega1 - omega2 + omega3)
+                      - 1.0 / (omega_shift + omega1 + omega2 - omega3);
+            omega_sum[2]
+                    = 1.0 / (omega_shift + omega1 - omega2 - omega3)
+                      - 1.0 / (omega_shift - omega1 + omega2 + omega3);
+            omega_sum[3]
+                    = 1.0 / (omega_shift - omega1 + omega2 - omega3)
+                      - 1.0 / (omega_shift + omega1 - omega2 + omega3);
+
+            auto sample_last = std::complex<double>(0.0, 0.0);
+
+            for (i = 0; i < N; ++i) {
+                const auto T_tmp = T[i];
+
+                const auto n1 = thermodynamics->fB(omega1, T_tmp);
+                const auto n2 = thermodynamics->fB(omega2, T_tmp);
+                const auto n3 = thermodynamics->fB(omega3, T_tmp);
+
+                const auto n12 = n1 * n2;
+                const auto n23 = n2 * n3;
+                const auto n31 = n3 * n1;
+
+                const auto sample
+                        = v4_tmp
+                          * ((n12 + n23 + n31 + n1 + n2 + n3 + 1.0) * omega_sum[0]
+                             + (n31 + n23 + n3 - n12) * omega_sum[1]
+                             + (n12 + n31 + n1 - n23) * omega_sum[2]
+                             + (n23 + n12 + n2 - n31) * omega_sum[3]);
+
+                ret_mpi[i] += sample;
+                if (i == N - 1) sample_last = sample;
+            }
+
+            stat_loc[0] += sample_last.imag();
+            stat_loc[1] += sample_last.imag() * sample_last.imag();
+        }
+
+        nsample_total += chunk * mympi->nprocs;
+
+        double stat_sum[2];
+        MPI_Allreduce(&stat_loc[0], &stat_sum[0], 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+        const auto dn = static_cast<double>(nsample_total);
+        const auto mean = stat_sum[0] / dn;
+        const auto var = std::max(stat_sum[1] / dn - mean * mean, 0.0);
+        const auto stderr_mean = std::sqrt(var / dn);
+
+        converged = std::abs(mean) > 0.0
+                    && stderr_mean < rel_err_target * std::abs(mean);
+    }
+
+    // E[sum] = N_quartet * <sample>
+    const auto factor = -nquartet / (static_cast<double>(nsample_total)
+                                     * std::pow(static_cast<double>(nk), 2) * std::pow(2.0, 5) * 3.0);
+    for (i = 0; i < N; ++i) ret_mpi[i] *= factor;
+
+    mpi_reduce_complex(N, ret_mpi, ret);
+
+    deallocate(ret_mpi);
+
+    if (mympi->my_rank == 0) {
+        std::cout << " selfenergy_c_stochastic: " << nsample_total
+                  << " quartets sampled (target relative error = "
+                  << rel_err_target << ")" << std::endl;
+    }
+}
+
 void Selfenergy::selfenergy_d(const unsigned int N,
                               const double *T,
                               const double omega,
@@ -65,6 +65,18 @@ public:
                       const std::complex<double> *const *const *evec_in,
                       std::complex<double> *ret) const;
 
+    void selfenergy_c_stochastic(const unsigned int N,
+                                 const double *T,
+                                 const double omega,
+                                 const unsigned int knum,
+                                 const unsigned int snum,
+                                 const KpointMeshUniform *kmesh_in,
+                                 const double *const *eval_in,
+                                 const std::complex<double> *const *const *evec_in,
+                                 const double rel_err_target,
+                                 const unsigned long max_samples,
+                                 std::complex<double> *ret) const;
+
     void selfenergy_d(const unsigned int N,
                       const double *T,
                       const double omega,
@@ -29,6 +29,12 @@ Thermodynamics::Thermodynamics(PHON *phon) : Pointers(phon)
     T_to_Ryd = k_Boltzmann / Ryd;
     calc_FE_bubble = false;
     FE_bubble = nullptr;
+    occ_grid = nullptr;
+    temp_grid = nullptr;
+    ntemp_grid = 0;
+    ns_grid = 0;
+    classical_grid = false;
+    occ_grid_eval_tag = nullptr;
 }
 
 Thermodynamics::~Thermodynamics()
@@ -36,6 +42,12 @@ Thermodynamics::~Thermodynamics()
     if (FE_bubble) {
         deallocate(FE_bubble);
     }
+    if (occ_grid) {
+        deallocate(occ_grid);
+    }
+    if (temp_grid) {
+        deallocate(temp_grid);
+    }
 };
 
 void Thermodynamics::setup()
@@ -78,6 +90,135 @@ double Thermodynamics::fC(const double omega,
     return 1.0 / x;
 }
 
+void Thermodynamics::fB_grid(const double omega,
+                             const unsigned int ntemp,
+                             const double *temp_in,
+                             double *ret) const
+{
+    // Evaluate fB on a contiguous temperature grid.
+    // expm1 keeps the low-temperature tail accurate and the loop has no
+    // data dependence, so the compiler can vectorize it.
+
+    unsigned int i;
+
+    if (omega < eps8) {
+        for (i = 0; i < ntemp; ++i) ret[i] = 0.0;
+        return;
+    }
+
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (i = 0; i < ntemp; ++i) {
+        ret[i] = std::abs(temp_in[i]) < eps
+                 ? 0.0 : 1.0 / std::expm1(omega / (T_to_Ryd * temp_in[i]));
+    }
+}
+
+void Thermodynamics::fC_grid(const double omega,
+                             const unsigned int ntemp,
+                             const double *temp_in,
+                             double *ret) const
+{
+    // Classical counterpart of fB_grid.
+
+    unsigned int i;
+
+    if (omega < eps8) {
+        for (i = 0; i < ntemp; ++i) ret[i] = 0.0;
+        return;
+    }
+
+    const auto factor = T_to_Ryd / omega;
+
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+    for (i = 0; i < ntemp; ++i) {
+        ret[i] = std::abs(temp_in[i]) < eps ? 0.0 : factor * temp_in[i];
+    }
+}
+
+void Thermodynamics::setup_occupation_grid(const unsigned int nk_in,
+                                           const unsigned int ns_in,
+                                           const double *const *eval_in)
+{
+    // Precompute the occupation factors n(omega_ks, T) of every mode on the
+    // full temperature grid once, so that the hot loops in the self-energy
+    // and conductivity modules become pure memory reads instead of repeated
+    // exp() evaluations. The table is skipped when it would be
+    // unreasonably large.
+
+    unsigned int i, ik, is;
+
+    if (occ_grid) deallocate(occ_grid);
+    if (temp_grid) deallocate(temp_grid);
+
+    ntemp_grid = static_cast<unsigned int>((system->Tmax - system->Tmin) / system->dT) + 1;
+    ns_grid = ns_in;
+
+    const auto ngrid = static_cast<size_t>(nk_in) * ns_in * ntemp_grid;
+
+    if (memsize_in_MB(sizeof(double), ngrid) > 2000) {
+        // Larger than ~2 GB per process: not worth the footprint.
+        ntemp_grid = 0;
+        return;
+    }
+
+    allocate(temp_grid, ntemp_grid);
+    for (i = 0; i < ntemp_grid; ++i) {
+        temp_grid[i] = system->Tmin + static_cast<double>(i) * system->dT;
+    }
+
+    allocate(occ_grid, ngrid);
+
+#ifdef _OPENMP
+#pragma omp parallel for private(is)
+#endif
+    for (ik = 0; ik < nk_in; ++ik) {
+        for (is = 0; is < ns_in; ++is) {
+            if (classical) {
+                fC_grid(eval_in[ik][is], ntemp_grid, temp_grid,
+                        &occ_grid[(static_cast<size_t>(ik) * ns_in + is) * ntemp_grid]);
+            } else {
+                fB_grid(eval_in[ik][is], ntemp_grid, temp_grid,
+                        &occ_grid[(static_cast<size_t>(ik) * ns_in + is) * ntemp_grid]);
+            }
+        }
+    }
+
+    classical_grid = classical;
+    occ_grid_eval_tag = static_cast<const void *>(eval_in);
+
+    if (mympi->my_rank == 0) {
+        std::cout << " Occupation table precomputed for "
+                  << nk_in * ns_in << " modes and "
+                  << ntemp_grid << " temperatures ("
+                  << memsize_in_MB(sizeof(double), ngrid) << " MB)" << std::endl;
+    }
+}
+
+const double *Thermodynamics::occupation_row(const unsigned int ik,
+                                             const unsigned int is,
+                                             const unsigned int ntemp_in,
+                                             const double *temp_in,
+                                             const double *const *eval_in) const
+{
+    // Return the precomputed n(omega_ks, T) row of the given mode, or
+    // nullptr when the table does not cover the requested grid and the
+    // caller has to evaluate the factors itself.
+
+    if (!occ_grid) return nullptr;
+    if (ntemp_in != ntemp_grid) return nullptr;
+    if (classical != classical_grid) return nullptr;
+    if (occ_grid_eval_tag != static_cast<const void *>(eval_in)) return nullptr;
+    if (std::abs(temp_in[0] - temp_grid[0]) > eps
+        || std::abs(temp_in[ntemp_in - 1] - temp_grid[ntemp_in - 1]) > eps)
+        return nullptr;
+
+    return &occ_grid[(static_cast<size_t>(ik) * ns_grid + is) * ntemp_grid];
+}
+
 double Thermodynamics::Cv_tot(const double temp_in,
                               const unsigned int nk_irred,
                               const unsigned int ns,
@@ -321,6 +462,121 @@ double Thermodynamics::free_energy_QHA(const double temp_in,
     return temp_in * T_to_Ryd * ret;
 }
 
+void Thermodynamics::compute_thermo_grid(const unsigned int ntemp,
+                                         const double *temp_grid,
+                                         const unsigned int nk_irred,
+                                         const unsigned int ns,
+                                         const std::vector<std::vector<KpointList>> &kp_irred,
+                                         const double *weight_k_irred,
+                                         const double *const *eval_in,
+                                         double *cv_out,
+                                         double *entropy_out,
+                                         double *internal_energy_out,
+                                         double *free_energy_out) const
+{
+    // One pass over the modes instead of one pass per temperature point.
+    // With e^{-x} (x = omega / kT) evaluated once per (mode, temperature),
+    // the four properties follow from
+    //   n_B        = e^{-x} / (1 - e^{-x}),
+    //   Cv         = kB x^2 n_B (1 + n_B),
+    //   S / (-kB)  = log(1 - e^{-x}) - x n_B,
+    //   U          = omega (1 + 2 n_B) / 2,
+    //   F / (kB T) = x / 2 + log(1 - e^{-x}),
+    // where log1p keeps log(1 - e^{-x}) accurate at low temperature.
+
+    unsigned int t;
+    const auto N = nk_irred * ns;
+
+    for (t = 0; t < ntemp; ++t) {
+        cv_out[t] = 0.0;
+        entropy_out[t] = 0.0;
+        internal_energy_out[t] = 0.0;
+        free_energy_out[t] = 0.0;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<double> cv_loc(ntemp, 0.0);
+        std::vector<double> s_loc(ntemp, 0.0);
+        std::vector<double> u_loc(ntemp, 0.0);
+        std::vector<double> f_loc(ntemp, 0.0);
+
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+        for (int i = 0; i < N; ++i) {
+            const auto ik_irred = i / ns;
+            const auto ik = kp_irred[ik_irred][0].knum;
+            const auto is = i % ns;
+            const auto omega = eval_in[ik][is];
+            const auto wk = weight_k_irred[ik_irred];
+
+            if (omega < eps8) continue;
+
+            if (classical) {
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for (t = 0; t < ntemp; ++t) {
+                    const auto temp = temp_grid[t];
+                    if (std::abs(temp) < eps) continue;
+
+                    const auto x = omega / (T_to_Ryd * temp);
+                    cv_loc[t] += k_Boltzmann * wk;
+                    s_loc[t] += (std::log(x) - 1.0) * wk;
+                    u_loc[t] += T_to_Ryd * temp * wk;
+                    f_loc[t] += std::log(x) * wk;
+                }
+            } else {
+#ifdef _OPENMP
+#pragma omp simd
+#endif
+                for (t = 0; t < ntemp; ++t) {
+                    const auto temp = temp_grid[t];
+
+                    if (std::abs(temp) < eps) {
+                        // Zero-point motion only.
+                        u_loc[t] += 0.5 * omega * wk;
+                        f_loc[t] += 0.5 * omega * wk;
+                        continue;
+                    }
+
+                    const auto x = omega / (T_to_Ryd * temp);
+                    const auto emx = std::exp(-x);
+                    const auto nb = emx / (1.0 - emx);
+                    const auto lnf = std::log1p(-emx);
+
+                    cv_loc[t] += k_Boltzmann * x * x * nb * (1.0 + nb) * wk;
+                    s_loc[t] += (lnf - x * nb) * wk;
+                    u_loc[t] += 0.5 * omega * (1.0 + 2.0 * nb) * wk;
+                    f_loc[t] += (0.5 * x + lnf) * wk;
+                }
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        {
+            for (t = 0; t < ntemp; ++t) {
+                cv_out[t] += cv_loc[t];
+                entropy_out[t] += s_loc[t];
+                internal_energy_out[t] += u_loc[t];
+                free_energy_out[t] += f_loc[t];
+            }
+        }
+    }
+
+    for (t = 0; t < ntemp; ++t) {
+        entropy_out[t] *= -k_Boltzmann;
+        if (std::abs(temp_grid[t]) >= eps) {
+            free_energy_out[t] *= temp_grid[t] * T_to_Ryd;
+        }
+    }
+}
+
 double Thermodynamics::disp2_avg(const double T_in,
                                  const unsigned int ncrd1,
                                  const unsigned int ncrd2,
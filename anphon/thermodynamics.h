@@ -41,6 +41,26 @@ public:
     double fC(const double omega,
               const double temp_in) const;
 
+    void fB_grid(const double omega,
+                 const unsigned int ntemp,
+                 const double *temp_in,
+                 double *ret) const;
+
+    void fC_grid(const double omega,
+                 const unsigned int ntemp,
+                 const double *temp_in,
+                 double *ret) const;
+
+    void setup_occupation_grid(const unsigned int nk_in,
+                               const unsigned int ns_in,
+                               const double *const *eval_in);
+
+    const double *occupation_row(const unsigned int ik,
+                                 const unsigned int is,
+                                 const unsigned int ntemp_in,
+                                 const double *temp_in,
+                                 const double *const *eval_in) const;
+
     double Cv_tot(const double temp_in,
                   const unsigned int nk_irred,
                   const unsigned int ns,
@@ -77,6 +97,23 @@ public:
                            const double *weight_k_irred,
                            const double *const *eval_in) const;
 
+    // Batched counterpart of Cv_tot, vibrational_entropy, internal_energy,
+    // and free_energy_QHA: the whole temperature grid is evaluated in one
+    // pass over the (k, band) modes, sharing the Bose factor of each mode
+    // between the four properties in a vectorizable inner loop. The output
+    // arrays must hold ntemp elements each.
+    void compute_thermo_grid(const unsigned int ntemp,
+                             const double *temp_grid,
+                             const unsigned int nk_irred,
+                             const unsigned int ns,
+                             const std::vector<std::vector<KpointList>> &kp_irred,
+                             const double *weight_k_irred,
+                             const double *const *eval_in,
+                             double *cv_out,
+                             double *entropy_out,
+                             double *internal_energy_out,
+                             double *free_energy_out) const;
+
     double disp2_avg(const double T_in,
                      const unsigned int ncrd1,
                      const unsigned int ncrd2,
@@ -112,5 +149,15 @@ public:
     double FE_scph_correction(unsigned int,
                               double **,
                               std::complex<double> ***) const;
+
+private:
+    // Process-wide occupation table n(omega_ks, T) on the uniform mesh,
+    // stored flat with the temperature axis contiguous:
+    // occ_grid[(ik * ns + is) * ntemp_grid + iT].
+    double *occ_grid;
+    double *temp_grid;
+    unsigned int ntemp_grid, ns_grid;
+    bool classical_grid;
+    const void *occ_grid_eval_tag;
 };
 }
@@ -10,10 +10,14 @@
 
 #include "mpi_common.h"
 #include "timer.h"
+#include "error.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <ctime>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
 
 using namespace PHON_NS;
 
@@ -25,6 +29,7 @@ Timer::Timer(PHON *phon) : Pointers(phon)
 #else
     gettimeofday(&time_ref, NULL);
 #endif
+    current_region = -1;
 }
 
 Timer::~Timer() {}
@@ -51,9 +56,231 @@ double Timer::elapsed() const
 #endif
 }
 
+#ifdef EVENT_COUNTERS
+
+namespace PHON_NS {
+namespace event_counter {
+ThreadSlot slots[max_threads] = {};
+
+unsigned long long total(const EventKind kind)
+{
+    unsigned long long sum = 0;
+    for (auto i = 0; i < max_threads; ++i) {
+        sum += slots[i].count[kind];
+    }
+    return sum;
+}
+}
+}
+
+#endif
+
 void Timer::print_elapsed() const
 {
     std::cout << std::endl << " Time Elapsed: " << elapsed() << " sec." << std::endl << std::endl;
+
+#ifdef EVENT_COUNTERS
+    print_event_counts();
+#endif
+}
+
+#ifdef EVENT_COUNTERS
+
+void Timer::print_event_counts() const
+{
+    // Cumulative counts of this rank since the start of the run; the
+    // counters are rank local, so each rank reports its own numbers.
+
+    static const char *labels[NUM_EVENT_KINDS] = {
+            "V3/Phi3 vertex evaluations",
+            "V4/Phi4 vertex evaluations",
+            "Dense diagonalizations (zheev)",
+            "Tetrahedron weight computations",
+            "Phase-table fallbacks (direct exp)"
+    };
+
+    std::cout << " Event counts of rank " << mympi->my_rank << ":" << std::endl;
+    for (auto i = 0; i < NUM_EVENT_KINDS; ++i) {
+        std::cout << "  " << std::left << std::setw(36) << labels[i] << std::right
+                  << std::setw(16)
+                  << event_counter::total(static_cast<EventKind>(i)) << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+#endif
+
+void Timer::start_clock(const std::string &name)
+{
+    // Reuse the node when the same region is entered again below the same
+    // parent, so that repeated calls accumulate instead of growing the tree.
+
+    auto inode = -1;
+
+    if (current_region >= 0) {
+        for (const auto &ichild: profile_nodes[current_region].children) {
+            if (profile_nodes[ichild].name == name) {
+                inode = ichild;
+                break;
+            }
+        }
+    } else {
+        for (auto i = 0; i < profile_nodes.size(); ++i) {
+            if (profile_nodes[i].parent == -1 && profile_nodes[i].name == name) {
+                inode = i;
+                break;
+            }
+        }
+    }
+
+    if (inode == -1) {
+        ProfileNode node;
+        node.name = name;
+        node.parent = current_region;
+        node.time_total = 0.0;
+        node.ncalls = 0;
+        inode = profile_nodes.size();
+        profile_nodes.push_back(node);
+        if (current_region >= 0) {
+            profile_nodes[current_region].children.push_back(inode);
+        }
+    }
+
+    profile_nodes[inode].time_start = elapsed();
+    ++profile_nodes[inode].ncalls;
+    current_region = inode;
+}
+
+void Timer::stop_clock(const std::string &name)
+{
+    if (current_region < 0 || profile_nodes[current_region].name != name) {
+        warn("stop_clock", "mismatched start_clock/stop_clock pair; profile will be unreliable");
+        return;
+    }
+    profile_nodes[current_region].time_total
+            += elapsed() - profile_nodes[current_region].time_start;
+    current_region = profile_nodes[current_region].parent;
+}
+
+std::string Timer::node_path(const int inode) const
+{
+    auto path = profile_nodes[inode].name;
+    auto ip = profile_nodes[inode].parent;
+    while (ip >= 0) {
+        path = profile_nodes[ip].name + "/" + path;
+        ip = profile_nodes[ip].parent;
+    }
+    return path;
+}
+
+void Timer::print_profile() const
+{
+    // The region trees may differ between the ranks (e.g. the master rank
+    // of the self-scheduling path never computes a self-energy itself),
+    // so the regions are matched across ranks by their full path and the
+    // printed list is the union over all ranks. A rank that never entered
+    // a region contributes to neither the average nor the minimum.
+
+    // Gather the paths of every rank on the root as one newline-separated
+    // string per rank.
+    std::string paths_local;
+    for (auto i = 0; i < profile_nodes.size(); ++i) {
+        paths_local += node_path(i) + "\n";
+    }
+
+    auto len_local = static_cast<int>(paths_local.size());
+    std::vector<int> len_all(mympi->nprocs);
+    MPI_Gather(&len_local, 1, MPI_INT, &len_all[0], 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<int> displs(mympi->nprocs, 0);
+    auto len_total = 0;
+    if (mympi->my_rank == 0) {
+        for (auto i = 0; i < mympi->nprocs; ++i) {
+            displs[i] = len_total;
+            len_total += len_all[i];
+        }
+    }
+    std::vector<char> paths_buf(std::max(len_total, 1));
+    MPI_Gatherv(paths_local.c_str(), len_local, MPI_CHAR,
+                &paths_buf[0], &len_all[0], &displs[0], MPI_CHAR,
+                0, MPI_COMM_WORLD);
+
+    // Union of the paths, keeping the first-seen (depth-first) order.
+    std::vector<std::string> paths_union;
+    if (mympi->my_rank == 0) {
+        const std::string paths_all(&paths_buf[0], len_total);
+        std::string::size_type pos = 0;
+        while (pos < paths_all.size()) {
+            const auto next = paths_all.find('\n', pos);
+            const auto path = paths_all.substr(pos, next - pos);
+            pos = next + 1;
+            if (std::find(paths_union.begin(), paths_union.end(), path)
+                == paths_union.end()) {
+                paths_union.push_back(path);
+            }
+        }
+    }
+
+    auto nregion = static_cast<int>(paths_union.size());
+    MPI_Bcast(&nregion, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (nregion == 0) return;
+
+    if (mympi->my_rank == 0) {
+        std::cout << std::endl;
+        std::cout << " Walltime profile (ncalls, avg / min / max over "
+                  << mympi->nprocs << " ranks, sec):" << std::endl;
+    }
+
+    for (auto i = 0; i < nregion; ++i) {
+
+        std::string path;
+        if (mympi->my_rank == 0) path = paths_union[i];
+        mympi->MPI_Bcast_string(path, 0, MPI_COMM_WORLD);
+
+        // Local contribution of this rank, if it entered the region.
+        auto time_local = 0.0;
+        unsigned long ncalls_local = 0;
+        auto has_region = 0;
+        for (auto j = 0; j < profile_nodes.size(); ++j) {
+            if (node_path(j) == path) {
+                time_local = profile_nodes[j].time_total;
+                ncalls_local = profile_nodes[j].ncalls;
+                has_region = 1;
+                break;
+            }
+        }
+
+        double time_sum, time_max, time_min;
+        unsigned long ncalls_max;
+        int nranks_region;
+        const auto time_min_in = has_region ? time_local : DBL_MAX;
+
+        MPI_Reduce(&time_local, &time_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&time_local, &time_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&time_min_in, &time_min, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&ncalls_local, &ncalls_max, 1, MPI_UNSIGNED_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&has_region, &nranks_region, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+        if (mympi->my_rank == 0 && nranks_region > 0) {
+            auto depth = 0;
+            for (const auto &c: path) {
+                if (c == '/') ++depth;
+            }
+            const auto name = path.substr(path.find_last_of('/') + 1);
+
+            std::cout << "  ";
+            for (auto j = 0; j < depth; ++j) std::cout << "  ";
+            std::cout << std::left << std::setw(32 - 2 * depth) << name << std::right;
+            std::cout << std::setw(10) << ncalls_max << " calls"
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(12) << time_sum / static_cast<double>(nranks_region)
+                      << std::setw(12) << time_min
+                      << std::setw(12) << time_max << std::endl;
+        }
+    }
+
+    if (mympi->my_rank == 0) std::cout << std::endl;
 }
 
 std::string Timer::DateAndTime() const
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "pointers.h"
 
 #if defined(WIN32) || defined(_WIN32)
@@ -22,7 +23,69 @@
 
 #endif
 
+#if defined(EVENT_COUNTERS) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
 namespace PHON_NS {
+
+// Hot-path event counters. Counting is compiled in only when the build
+// defines EVENT_COUNTERS (cmake -DEVENT_COUNTERS=yes); otherwise
+// count_event() expands to nothing and the call sites cost nothing.
+// Each OpenMP thread owns a cache-line aligned slot, so incrementing
+// never contends; the slots are summed only when the report is printed
+// from Timer::print_elapsed. Counts are local to the MPI rank.
+
+enum EventKind {
+    EVENT_V3 = 0,         // V3/Phi3 vertex evaluations
+    EVENT_V4,             // V4/Phi4 vertex evaluations
+    EVENT_ZHEEV,          // dense diagonalizations (zheev_)
+    EVENT_TETRAHEDRON,    // tetrahedron weight computations
+    EVENT_PHASE_FALLBACK, // PhaseFactorStorage direct-exponential fallbacks
+    NUM_EVENT_KINDS
+};
+
+#ifdef EVENT_COUNTERS
+
+namespace event_counter {
+constexpr int max_threads = 512;
+
+struct alignas(64) ThreadSlot {
+    unsigned long long count[NUM_EVENT_KINDS];
+};
+
+extern ThreadSlot slots[max_threads];
+
+inline void increment(const EventKind kind)
+{
+#ifdef _OPENMP
+    const auto ithread = omp_get_thread_num() & (max_threads - 1);
+#else
+    const auto ithread = 0;
+#endif
+    ++slots[ithread].count[kind];
+}
+
+inline void add(const EventKind kind, const unsigned long long n)
+{
+#ifdef _OPENMP
+    const auto ithread = omp_get_thread_num() & (max_threads - 1);
+#else
+    const auto ithread = 0;
+#endif
+    slots[ithread].count[kind] += n;
+}
+
+unsigned long long total(EventKind kind);
+}
+
+#define count_event(kind) PHON_NS::event_counter::increment(PHON_NS::kind)
+#define count_event_n(kind, n) PHON_NS::event_counter::add(PHON_NS::kind, (n))
+#else
+#define count_event(kind)
+#define count_event_n(kind, n)
+#endif
+
 class Timer : protected Pointers {
 public:
     Timer(class PHON *);
@@ -35,9 +98,39 @@ public:
 
     void print_elapsed() const;
 
+    // Hierarchical profiler. start_clock/stop_clock delimit a named
+    // region; regions started while another one is open become its
+    // children, so repeated calls build a tree of accumulated walltimes
+    // and call counts per rank.
+    void start_clock(const std::string &name);
+
+    void stop_clock(const std::string &name);
+
+    // Collective over MPI_COMM_WORLD: reduces each region over the ranks
+    // and prints the tree with avg/min/max walltimes on the root rank.
+    void print_profile() const;
+
     std::string DateAndTime() const;
 
 private:
+    struct ProfileNode {
+        std::string name;
+        int parent;
+        std::vector<int> children;
+        double time_total;
+        double time_start;
+        unsigned long ncalls;
+    };
+
+    std::vector<ProfileNode> profile_nodes;
+    int current_region;
+
+    std::string node_path(int inode) const;
+
+#ifdef EVENT_COUNTERS
+    void print_event_counts() const;
+#endif
+
 #if defined(WIN32) || defined(_WIN32)
     LARGE_INTEGER time_ref;
     LARGE_INTEGER frequency;
@@ -40,6 +40,73 @@ or http://opensource.org/licenses/mit-license.php for information.
 
 using namespace PHON_NS;
 
+AsyncFileWriter::~AsyncFileWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_requested = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void AsyncFileWriter::enqueue(const std::string &fname,
+                              std::string &&content)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue_pending.emplace_back(fname, std::move(content));
+        if (!worker.joinable()) {
+            worker = std::thread(&AsyncFileWriter::run, this);
+        }
+    }
+    cv.notify_all();
+}
+
+void AsyncFileWriter::finish()
+{
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return queue_pending.empty() && !busy; });
+
+        if (failed_files.empty()) return;
+    }
+    exit("AsyncFileWriter::finish",
+         "cannot open one of the queued output files");
+}
+
+void AsyncFileWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    for (;;) {
+        cv.wait(lock, [this]() { return stop_requested || !queue_pending.empty(); });
+        if (queue_pending.empty()) break;
+
+        queue_writing.swap(queue_pending);
+        busy = true;
+        lock.unlock();
+
+        std::vector<std::string> failed_now;
+
+        for (const auto &job: queue_writing) {
+            std::ofstream ofs(job.fname.c_str(), std::ios::out);
+            if (!ofs) {
+                failed_now.push_back(job.fname);
+                continue;
+            }
+            ofs.write(job.content.data(),
+                      static_cast<std::streamsize>(job.content.size()));
+        }
+        queue_writing.clear();
+
+        lock.lock();
+        busy = false;
+        for (auto &fname: failed_now) failed_files.push_back(fname);
+        cv.notify_all();
+    }
+}
+
 Writes::Writes(PHON *phon) : Pointers(phon)
 {
     Ry_to_kayser = Hz_to_kayser / time_ry;
@@ -49,6 +116,7 @@ Writes::Writes(PHON *phon) : Pointers(phon)
     print_anime = false;
     print_msd = false;
     print_zmode = false;
+    print_hdf5_results = false;
     anime_cellsize[0] = 0;
     anime_cellsize[1] = 0;
     anime_cellsize[2] = 0;
@@ -65,7 +133,10 @@ Writes::Writes(PHON *phon) : Pointers(phon)
     verbosity = 1;
 };
 
-Writes::~Writes() {};
+Writes::~Writes()
+{
+    file_writer.finish();
+};
 
 void Writes::write_input_vars()
 {
@@ -452,6 +523,13 @@ void Writes::setWriteOptions(const bool print_msd_,
     }
 }
 
+bool Writes::uses_mesh_eigenvectors() const
+{
+    // MSD, displacement correlation and animation read the stored mesh
+    // eigenvectors; the other outputs use the band or general k points.
+    return print_msd || print_ucorr || print_anime;
+}
+
 bool Writes::getPrintMSD() const
 {
     return print_msd;
@@ -662,18 +740,17 @@ void Writes::write_phonon_info()
     if (print_zmode) {
         print_normalmode_borncharge();
     }
+
+    write_consolidated_HDF5();
 }
 
 void Writes::write_phonon_bands() const
 {
-    std::ofstream ofs_bands;
+    // The file contents are formatted into a string and handed to the
+    // background writer, so the computation does not wait for the disk.
+    std::ostringstream ofs_bands;
     auto file_bands = input->job_title + ".bands";
 
-    ofs_bands.open(file_bands.c_str(), std::ios::out);
-    if (!ofs_bands)
-        exit("write_phonon_bands",
-             "cannot open file_bands");
-
     unsigned int i, j;
     const auto nk = kpoint->kpoint_bs->nk;
     const auto kaxis = kpoint->kpoint_bs->kaxis;
@@ -729,20 +806,15 @@ void Writes::write_phonon_bands() const
         }
     }
 
-    ofs_bands.close();
+    file_writer.enqueue(file_bands, ofs_bands.str());
 
     std::cout << "  " << std::setw(input->job_title.length() + 12) << std::left << file_bands;
     std::cout << " : Phonon band structure" << std::endl;
 
     if (dynamical->band_connection == 2) {
-        std::ofstream ofs_connect;
+        std::ostringstream ofs_connect;
         auto file_connect = input->job_title + ".connection";
 
-        ofs_connect.open(file_connect.c_str(), std::ios::out);
-        if (!ofs_connect)
-            exit("write_phonon_bands",
-                 "cannot open file_connect");
-
         ofs_connect << "# " << str_kpath << std::endl;
         ofs_connect << "#" << str_kval << std::endl;
         ofs_connect << "# k-axis, mapping" << std::endl;
@@ -754,7 +826,7 @@ void Writes::write_phonon_bands() const
             }
             ofs_connect << std::endl;
         }
-        ofs_connect.close();
+        file_writer.enqueue(file_connect, ofs_connect.str());
         std::cout << "  " << std::setw(input->job_title.length() + 12) << std::left << file_connect;
         std::cout << " : Connectivity map information of band dispersion" << std::endl;
     }
@@ -899,12 +971,9 @@ void Writes::write_phonon_vel_all() const
 void Writes::write_phonon_dos() const
 {
     int i;
-    std::ofstream ofs_dos;
+    std::ostringstream ofs_dos;
     auto file_dos = input->job_title + ".dos";
 
-    ofs_dos.open(file_dos.c_str(), std::ios::out);
-    if (!ofs_dos) exit("write_phonon_dos", "cannot open file_dos");
-
     ofs_dos << "#";
     for (i = 0; i < system->nkd; ++i) {
         ofs_dos << std::setw(5) << system->symbol_kd[i];
@@ -947,7 +1016,7 @@ void Writes::write_phonon_dos() const
         }
         ofs_dos << std::endl;
     }
-    ofs_dos.close();
+    file_writer.enqueue(file_dos, ofs_dos.str());
 
     std::cout << "  " << std::setw(input->job_title.length() + 12) << std::left << file_dos;
 
@@ -1608,6 +1677,144 @@ void Writes::write_eigenvectors_each_HDF5(const std::string &fname_evec,
 
 #endif
 
+#ifdef _HDF5
+namespace {
+void write_dataset_double(H5::Group &group,
+                          const std::string &name,
+                          const std::vector<hsize_t> &dims,
+                          const double *data)
+{
+    H5::DataSpace dataspace(static_cast<int>(dims.size()), dims.data());
+    H5::DataSet dataset(group.createDataSet(name,
+                                            H5::PredType::NATIVE_DOUBLE,
+                                            dataspace));
+    dataset.write(data, H5::PredType::NATIVE_DOUBLE);
+}
+
+void write_dataset_int(H5::Group &group,
+                       const std::string &name,
+                       const std::vector<hsize_t> &dims,
+                       const int *data)
+{
+    H5::DataSpace dataspace(static_cast<int>(dims.size()), dims.data());
+    H5::DataSet dataset(group.createDataSet(name,
+                                            H5::PredType::NATIVE_INT,
+                                            dataspace));
+    dataset.write(data, H5::PredType::NATIVE_INT);
+}
+}
+#endif
+
+void Writes::write_consolidated_HDF5() const
+{
+    // Optional consolidated results container (PRINTHDF5 = 1): the
+    // eigenvalues, group velocities, linewidths, and kappa of the run in
+    // one HDF5 file with (k, band, T) indexed datasets, so post-processing
+    // reads arrays directly instead of parsing the formatted text files.
+    // Every array below is already gathered on the master rank when this
+    // is called, so the file is written serially there; a collective
+    // MPI-IO write would require a parallel HDF5 build.
+    if (!print_hdf5_results) return;
+    if (mympi->my_rank > 0) return;
+
+#ifndef _HDF5
+    warn("write_consolidated_HDF5",
+         "PRINTHDF5 = 1 requires an HDF5-enabled build. The consolidated file is skipped.");
+#else
+    using namespace H5;
+
+    unsigned int i, j, k;
+    const auto ns = dynamical->neval;
+    const auto fname = input->job_title + ".results.hdf5";
+    std::vector<double> buf;
+
+    H5File file(fname, H5F_ACC_TRUNC);
+
+    Group group_kpoint(file.createGroup("/Kpoints"));
+    Group group_eval(file.createGroup("/Eigenvalues"));
+
+    if (dos->kmesh_dos && dos->dymat_dos) {
+        const auto nk = dos->kmesh_dos->nk;
+
+        write_dataset_double(group_kpoint, "mesh_xk",
+                             {nk, 3}, &dos->kmesh_dos->xk[0][0]);
+
+        std::vector<int> kmap(nk);
+        for (i = 0; i < nk; ++i) {
+            kmap[i] = static_cast<int>(dos->kmesh_dos->kmap_to_irreducible[i]);
+        }
+        write_dataset_int(group_kpoint, "mesh_map_to_irreducible",
+                          {nk}, kmap.data());
+
+        const auto eval = dos->dymat_dos->get_eigenvalues();
+        buf.resize(static_cast<size_t>(nk) * ns);
+        for (i = 0; i < nk; ++i) {
+            for (j = 0; j < ns; ++j) {
+                buf[i * ns + j] = in_kayser(eval[i][j]);
+            }
+        }
+        write_dataset_double(group_eval, "mesh", {nk, ns}, buf.data());
+    }
+
+    if (kpoint->kpoint_bs && dynamical->dymat_band) {
+        const auto nk = kpoint->kpoint_bs->nk;
+
+        write_dataset_double(group_kpoint, "band_kaxis",
+                             {nk}, kpoint->kpoint_bs->kaxis);
+
+        const auto eval = dynamical->dymat_band->get_eigenvalues();
+        buf.resize(static_cast<size_t>(nk) * ns);
+        for (i = 0; i < nk; ++i) {
+            for (j = 0; j < ns; ++j) {
+                buf[i * ns + j] = in_kayser(eval[i][j]);
+            }
+        }
+        write_dataset_double(group_eval, "band", {nk, ns}, buf.data());
+    }
+
+    if (phon->mode == "RTA" && dos->kmesh_dos) {
+        const auto nk = dos->kmesh_dos->nk;
+        const auto nk_irred = dos->kmesh_dos->nk_irred;
+        const auto ntemp = conductivity->ntemp;
+
+        Group group_temp(file.createGroup("/Temperatures"));
+        write_dataset_double(group_temp, "grid",
+                             {ntemp}, conductivity->temperature);
+
+        const auto vel = conductivity->get_group_velocity_mesh();
+        if (vel) {
+            // Group velocities in m/s, (k, band, Cartesian direction).
+            Group group_vel(file.createGroup("/GroupVelocities"));
+            write_dataset_double(group_vel, "mesh",
+                                 {nk, ns, 3}, &vel[0][0][0]);
+        }
+
+        if (conductivity->damping3) {
+            // Linewidths gamma in cm^-1, (irreducible k, band, T).
+            Group group_gamma(file.createGroup("/Gamma"));
+            buf.resize(static_cast<size_t>(nk_irred) * ns * ntemp);
+            for (i = 0; i < nk_irred * ns; ++i) {
+                for (k = 0; k < ntemp; ++k) {
+                    buf[static_cast<size_t>(i) * ntemp + k] = in_kayser(conductivity->damping3[i][k]);
+                }
+            }
+            write_dataset_double(group_gamma, "mesh_irreducible",
+                                 {nk_irred, ns, ntemp}, buf.data());
+        }
+
+        if (conductivity->kappa) {
+            // Lattice thermal conductivity in W/mK, (T, 3, 3).
+            Group group_kappa(file.createGroup("/Kappa"));
+            write_dataset_double(group_kappa, "total",
+                                 {ntemp, 3, 3}, &conductivity->kappa[0][0][0]);
+        }
+    }
+
+    std::cout << "  " << std::setw(input->job_title.length() + 12) << std::left << fname;
+    std::cout << " : Consolidated results in HDF5 format" << std::endl;
+#endif
+}
+
 double Writes::in_kayser(const double x) const
 {
     return x * Ry_to_kayser;
@@ -1621,10 +1828,8 @@ void Writes::write_thermodynamics() const
 
     const auto NT = static_cast<unsigned int>((Tmax - Tmin) / dT) + 1;
 
-    std::ofstream ofs_thermo;
+    std::ostringstream ofs_thermo;
     auto file_thermo = input->job_title + ".thermo";
-    ofs_thermo.open(file_thermo.c_str(), std::ios::out);
-    if (!ofs_thermo) exit("write_thermodynamics", "cannot open file_thermo");
     if (thermodynamics->calc_FE_bubble) {
         ofs_thermo << "# The bubble free-energy is also shown." << std::endl;
         ofs_thermo <<
@@ -1640,42 +1845,37 @@ void Writes::write_thermodynamics() const
         ofs_thermo << "# CLASSICAL = 1: use classical statistics" << std::endl;
     }
 
+    // All four properties over the whole temperature grid in a single
+    // pass over the modes.
+
+    double *temp_grid, *heat_capacity, *Svib, *Uvib, *FE_QHA;
+    allocate(temp_grid, NT);
+    allocate(heat_capacity, NT);
+    allocate(Svib, NT);
+    allocate(Uvib, NT);
+    allocate(FE_QHA, NT);
+
     for (unsigned int i = 0; i < NT; ++i) {
-        const auto T = Tmin + dT * static_cast<double>(i);
-
-        const auto heat_capacity = thermodynamics->Cv_tot(T,
-                                                          dos->kmesh_dos->nk_irred,
-                                                          dynamical->neval,
-                                                          dos->kmesh_dos->kpoint_irred_all,
-                                                          &dos->kmesh_dos->weight_k[0],
-                                                          dos->dymat_dos->get_eigenvalues());
-
-        const auto Svib = thermodynamics->vibrational_entropy(T,
-                                                              dos->kmesh_dos->nk_irred,
-                                                              dynamical->neval,
-                                                              dos->kmesh_dos->kpoint_irred_all,
-                                                              &dos->kmesh_dos->weight_k[0],
-                                                              dos->dymat_dos->get_eigenvalues());
-
-        const auto Uvib = thermodynamics->internal_energy(T,
-                                                          dos->kmesh_dos->nk_irred,
-                                                          dynamical->neval,
-                                                          dos->kmesh_dos->kpoint_irred_all,
-                                                          &dos->kmesh_dos->weight_k[0],
-                                                          dos->dymat_dos->get_eigenvalues());
-
-        const auto FE_QHA = thermodynamics->free_energy_QHA(T,
-                                                            dos->kmesh_dos->nk_irred,
-                                                            dynamical->neval,
-                                                            dos->kmesh_dos->kpoint_irred_all,
-                                                            &dos->kmesh_dos->weight_k[0],
-                                                            dos->dymat_dos->get_eigenvalues());
-
-        ofs_thermo << std::setw(16) << std::fixed << T;
-        ofs_thermo << std::setw(18) << std::scientific << heat_capacity / k_Boltzmann;
-        ofs_thermo << std::setw(18) << Svib / k_Boltzmann;
-        ofs_thermo << std::setw(18) << Uvib;
-        ofs_thermo << std::setw(18) << FE_QHA;
+        temp_grid[i] = Tmin + dT * static_cast<double>(i);
+    }
+
+    thermodynamics->compute_thermo_grid(NT, temp_grid,
+                                        dos->kmesh_dos->nk_irred,
+                                        dynamical->neval,
+                                        dos->kmesh_dos->kpoint_irred_all,
+                                        &dos->kmesh_dos->weight_k[0],
+                                        dos->dymat_dos->get_eigenvalues(),
+                                        heat_capacity,
+                                        Svib,
+                                        Uvib,
+                                        FE_QHA);
+
+    for (unsigned int i = 0; i < NT; ++i) {
+        ofs_thermo << std::setw(16) << std::fixed << temp_grid[i];
+        ofs_thermo << std::setw(18) << std::scientific << heat_capacity[i] / k_Boltzmann;
+        ofs_thermo << std::setw(18) << Svib[i] / k_Boltzmann;
+        ofs_thermo << std::setw(18) << Uvib[i];
+        ofs_thermo << std::setw(18) << FE_QHA[i];
 
         if (thermodynamics->calc_FE_bubble) {
             ofs_thermo << std::setw(18) << thermodynamics->FE_bubble[i];
@@ -1683,7 +1883,13 @@ void Writes::write_thermodynamics() const
         ofs_thermo << std::endl;
     }
 
-    ofs_thermo.close();
+    deallocate(temp_grid);
+    deallocate(heat_capacity);
+    deallocate(Svib);
+    deallocate(Uvib);
+    deallocate(FE_QHA);
+
+    file_writer.enqueue(file_thermo, ofs_thermo.str());
 
     std::cout << "  " << std::setw(input->job_title.length() + 12) << std::left << file_thermo;
     std::cout << " : Thermodynamic quantities" << std::endl;
@@ -2091,6 +2297,8 @@ void Writes::write_kappa() const
             std::cout << " Coherent part is stored in the file " << file_kappa_coherent << std::endl;
         }
     }
+
+    write_consolidated_HDF5();
 }
 
 void Writes::write_selfenergy_isotope() const
@@ -2594,7 +2802,6 @@ void Writes::write_participation_ratio_mesh(const std::string &fname_pr,
     unsigned int knum;
     const auto neval = dynamical->neval;
     const auto natmin = system->natmin;
-    const auto nk = kmesh_in->nk;
 
     double **participation_ratio = nullptr;
     double ***atomic_participation_ratio = nullptr;
@@ -2613,12 +2820,15 @@ void Writes::write_participation_ratio_mesh(const std::string &fname_pr,
              "cannot open file_apr");
     ofs_apr.setf(std::ios::scientific);
 
-    allocate(participation_ratio, nk, neval);
-    allocate(atomic_participation_ratio, nk, neval, natmin);
+    // Only the representative k point of each irreducible class is
+    // printed below, so the ratios are computed and stored for those
+    // points only instead of the full mesh.
+    allocate(participation_ratio, kmesh_in->nk_irred, neval);
+    allocate(atomic_participation_ratio, kmesh_in->nk_irred, neval, natmin);
 
-    dynamical->calc_participation_ratio_all(nk, evec_in,
-                                            participation_ratio,
-                                            atomic_participation_ratio);
+    dynamical->calc_participation_ratio_irred(kmesh_in, evec_in,
+                                              participation_ratio,
+                                              atomic_participation_ratio);
 
     ofs_pr << "# Participation ratio of each phonon modes at k points" << std::endl;
     ofs_pr << "# irred. kpoint, mode, frequency[kpoint][mode] (cm^-1), PR[kpoint][mode]" << std::endl;
@@ -2635,7 +2845,7 @@ void Writes::write_participation_ratio_mesh(const std::string &fname_pr,
             ofs_pr << std::setw(8) << i + 1;
             ofs_pr << std::setw(5) << j + 1;
             ofs_pr << std::setw(15) << in_kayser(eval_in[knum][j]);
-            ofs_pr << std::setw(15) << participation_ratio[knum][j];
+            ofs_pr << std::setw(15) << participation_ratio[i][j];
             ofs_pr << std::endl;
         }
         ofs_pr << std::endl;
@@ -2660,7 +2870,7 @@ void Writes::write_participation_ratio_mesh(const std::string &fname_pr,
                 ofs_apr << std::setw(5) << j + 1;
                 ofs_apr << std::setw(5) << k + 1;
                 ofs_apr << std::setw(15) << in_kayser(eval_in[knum][j]);
-                ofs_apr << std::setw(15) << atomic_participation_ratio[knum][j][k];
+                ofs_apr << std::setw(15) << atomic_participation_ratio[i][j][k];
                 ofs_apr << std::endl;
             }
         }
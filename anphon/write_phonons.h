@@ -15,8 +15,53 @@
 #include <string>
 #include <fstream>
 #include <complex>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace PHON_NS {
+
+// Background writer for the larger formatted output files: callers format
+// the whole file into a string and enqueue it, and a worker thread streams
+// the buffers to disk while the computation proceeds. The queue is double
+// buffered so enqueueing never waits for the disk; finish() blocks until
+// everything is written and reports files that could not be opened.
+class AsyncFileWriter {
+public:
+    AsyncFileWriter() = default;
+
+    ~AsyncFileWriter();
+
+    void enqueue(const std::string &fname,
+                 std::string &&content);
+
+    void finish();
+
+private:
+    class FileJob {
+    public:
+        std::string fname;
+        std::string content;
+
+        FileJob() {};
+
+        FileJob(const std::string &fname_in,
+                std::string &&content_in)
+                : fname(fname_in), content(std::move(content_in)) {};
+    };
+
+    void run();
+
+    std::vector<FileJob> queue_pending, queue_writing;
+    std::vector<std::string> failed_files;
+    std::thread worker;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool busy = false;
+    bool stop_requested = false;
+};
+
 class Writes : protected Pointers {
 public:
 
@@ -40,8 +85,16 @@ public:
 
     bool print_zmode;
 
+    // PRINTHDF5 = 1: also write a consolidated HDF5 container with the
+    // eigenvalues, group velocities, linewidths, and kappa of the run.
+    bool print_hdf5_results;
+
     double in_kayser(const double) const;
 
+    // True when one of the requested outputs reads the stored
+    // eigenvectors of the dense k mesh.
+    bool uses_mesh_eigenvectors() const;
+
     void setWriteOptions(const bool print_msd_,
                          const bool print_xsf_,
                          const bool print_anime_,
@@ -92,6 +145,12 @@ public:
 
 private:
 
+    // Shared background writer; mutable because the write_* methods that
+    // enqueue output are const.
+    mutable AsyncFileWriter file_writer;
+
+    void write_consolidated_HDF5() const;
+
     void write_phonon_bands() const;
 
     void write_phonon_vel() const;
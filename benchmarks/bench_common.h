@@ -0,0 +1,71 @@
+/*
+ bench_common.h
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace BENCH_NS {
+
+// Wall-clock stopwatch for the kernel section only; setup of the
+// synthetic inputs is deliberately excluded from the reported time.
+
+class Stopwatch {
+public:
+    void start()
+    {
+        t_start = std::chrono::steady_clock::now();
+    }
+
+    double stop() const
+    {
+        const auto t_end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(t_end - t_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point t_start;
+};
+
+// Returns the value of "--key=value" from the command line, or def_value
+// when the option is absent. All benchmark drivers take their problem
+// sizes this way so that a single binary covers small smoke runs and
+// production-sized measurements.
+
+inline long get_option(const int argc,
+                       char **argv,
+                       const std::string &key,
+                       const long def_value)
+{
+    const auto prefix = "--" + key + "=";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg.compare(0, prefix.size(), prefix) == 0) {
+            return std::atol(arg.c_str() + prefix.size());
+        }
+    }
+    return def_value;
+}
+
+inline void print_throughput(const std::string &kernel,
+                             const double elapsed,
+                             const double nitems,
+                             const std::string &unit)
+{
+    std::cout << " " << std::left << std::setw(28) << kernel
+              << " elapsed = " << std::right << std::setw(10)
+              << std::fixed << std::setprecision(4) << elapsed << " [s]"
+              << "   throughput = " << std::setw(12) << std::setprecision(1)
+              << nitems / elapsed << " [" << unit << "/s]" << std::endl;
+}
+}
@@ -0,0 +1,104 @@
+/*
+ bench_coordinate_descent.cpp
+
+ Microbenchmark mirroring the standardized branch of
+ Optimize::coordinate_descent (alm/optimize.cpp): soft-thresholding
+ updates with lazily built Gram-matrix columns, on a synthetic sensing
+ matrix of configurable size.
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "bench_common.h"
+#include <Eigen/Dense>
+#include <cmath>
+#include <vector>
+
+using namespace BENCH_NS;
+
+namespace {
+
+double shrink(const double x,
+              const double a)
+{
+    const auto xabs = std::abs(x);
+    const auto sign = (x > 0.0) - (x < 0.0);
+    return sign * std::max<double>(xabs - a, 0.0);
+}
+}
+
+int main(int argc, char **argv)
+{
+    // --nrows : number of displacement-force data rows (M)
+    // --ncols : number of irreducible force-constant parameters (N)
+    // --maxiter : coordinate-descent sweeps to run
+    const auto M = static_cast<int>(get_option(argc, argv, "nrows", 4000));
+    const auto N = static_cast<int>(get_option(argc, argv, "ncols", 800));
+    const auto maxiter = get_option(argc, argv, "maxiter", 100);
+
+    const auto alphlambda = 1.0e-4;
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<double> dist(-0.5, 0.5);
+
+    Eigen::MatrixXd A(M, N);
+    Eigen::VectorXd b(M);
+
+    for (auto j = 0; j < N; ++j) {
+        for (auto i = 0; i < M; ++i) A(i, j) = dist(mt);
+        // Standardize columns as Optimize does before entering CD.
+        const auto mean = A.col(j).mean();
+        A.col(j).array() -= mean;
+        A.col(j) /= A.col(j).norm() / std::sqrt(static_cast<double>(M));
+    }
+    for (auto i = 0; i < M; ++i) b(i) = dist(mt);
+
+    Eigen::MatrixXd Prod(N, N);
+    Eigen::VectorXd grad = A.transpose() * b;
+    Eigen::VectorXd beta = Eigen::VectorXd::Zero(N);
+    Eigen::VectorXd delta(N);
+    std::vector<bool> has_prod(N, false);
+
+    const auto Minv = 1.0 / static_cast<double>(M);
+
+    long iloop = 0;
+    auto diff = 0.0;
+
+    Stopwatch watch;
+    watch.start();
+
+    while (iloop < maxiter) {
+        delta = beta;
+        for (auto i = 0; i < N; ++i) {
+            beta(i) = shrink(Minv * grad(i) + beta(i), alphlambda);
+            delta(i) -= beta(i);
+            if (std::abs(delta(i)) > 0.0) {
+                if (!has_prod[i]) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+                    for (auto j = 0; j < N; ++j) {
+                        Prod(j, i) = A.col(j).dot(A.col(i));
+                    }
+                    has_prod[i] = true;
+                }
+                grad = grad + Prod.col(i) * delta(i);
+            }
+        }
+        ++iloop;
+        diff = std::sqrt(delta.dot(delta) / static_cast<double>(N));
+        if (diff < 1.0e-12) break;
+    }
+
+    const auto elapsed = watch.stop();
+
+    std::cout << " bench_coordinate_descent: M = " << M << ", N = " << N
+              << ", sweeps = " << iloop
+              << " (|u_k - u_{k-1}| = " << diff << ")" << std::endl;
+    print_throughput("Optimize::coordinate_descent", elapsed,
+                     static_cast<double>(iloop), "sweep");
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ bench_eval_k.cpp
+
+ Microbenchmark mirroring Dynamical::eval_k (anphon/dynamical.cpp): the
+ Fourier transform of the harmonic force constants into the dynamical
+ matrix followed by the zheev diagonalization, on a synthetic supercell.
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "bench_common.h"
+#include <cmath>
+#include <complex>
+#include <vector>
+
+extern "C" {
+void zheev_(const char *jobz,
+            const char *uplo,
+            int *n,
+            std::complex<double> *a,
+            int *lda,
+            double *w,
+            std::complex<double> *work,
+            int *lwork,
+            double *rwork,
+            int *info);
+}
+
+using namespace BENCH_NS;
+
+int main(int argc, char **argv)
+{
+    // --natmin : number of atoms in the primitive cell (neval = 3 natmin)
+    // --ncell  : number of supercell images contributing to each matrix element
+    // --nk     : number of k points to diagonalize at
+    const auto natmin = get_option(argc, argv, "natmin", 8);
+    const auto ncell = get_option(argc, argv, "ncell", 125);
+    const auto nk = get_option(argc, argv, "nk", 500);
+
+    const auto neval = 3 * natmin;
+    const double tpi = 2.0 * std::acos(-1.0);
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<double> dist(-0.5, 0.5);
+
+    // Synthetic harmonic force constants: one coefficient and one lattice
+    // vector per (element pair, cell image), as in fc2_ext.
+    std::vector<double> fc2(neval * neval * ncell);
+    std::vector<double> relvec(ncell * 3);
+    std::vector<double> invsqrt_mass(natmin);
+
+    for (auto &val: fc2) val = dist(mt);
+    for (auto &val: relvec) val = dist(mt);
+    for (auto &val: invsqrt_mass) val = 1.0 / std::sqrt(1.0 + std::abs(dist(mt)));
+
+    const int LWORK = (2 * neval - 1) * 10;
+    std::vector<std::complex<double>> amat(neval * neval), WORK(LWORK);
+    std::vector<std::complex<double>> dymat(neval * neval);
+    std::vector<double> eval(neval), RWORK(3 * neval - 2);
+
+    auto checksum = 0.0;
+
+    Stopwatch watch;
+    watch.start();
+
+    for (long ik = 0; ik < nk; ++ik) {
+
+        double xk[3];
+        for (auto i = 0; i < 3; ++i) xk[i] = dist(mt);
+
+        // Fourier transform (calc_analytic_k)
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (long i = 0; i < neval; ++i) {
+            for (long j = 0; j < neval; ++j) {
+                auto ctmp = std::complex<double>(0.0, 0.0);
+                for (long icell = 0; icell < ncell; ++icell) {
+                    const auto phase = tpi * (xk[0] * relvec[3 * icell]
+                                              + xk[1] * relvec[3 * icell + 1]
+                                              + xk[2] * relvec[3 * icell + 2]);
+                    ctmp += fc2[(i * neval + j) * ncell + icell]
+                            * std::complex<double>(std::cos(phase), std::sin(phase));
+                }
+                dymat[i * neval + j] = ctmp * invsqrt_mass[i / 3] * invsqrt_mass[j / 3];
+            }
+        }
+
+        // Hermitize and pack in column-major order for LAPACK.
+        for (long j = 0; j < neval; ++j) {
+            for (long i = 0; i < neval; ++i) {
+                amat[j * neval + i] = 0.5 * (dymat[i * neval + j]
+                                             + std::conj(dymat[j * neval + i]));
+            }
+        }
+
+        int n = neval;
+        int lwork = LWORK;
+        int INFO;
+        zheev_("V", "U", &n, amat.data(), &n, eval.data(),
+               WORK.data(), &lwork, RWORK.data(), &INFO);
+
+        checksum += eval[0];
+    }
+
+    const auto elapsed = watch.stop();
+
+    std::cout << " bench_eval_k: natmin = " << natmin << ", ncell = " << ncell
+              << ", nk = " << nk
+              << " (checksum = " << checksum << ")" << std::endl;
+    print_throughput("Dynamical::eval_k", elapsed,
+                     static_cast<double>(nk), "kpoint");
+
+    return 0;
+}
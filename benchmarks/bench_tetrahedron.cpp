@@ -0,0 +1,211 @@
+/*
+ bench_tetrahedron.cpp
+
+ Microbenchmark mirroring Integration::calc_weight_tetrahedron
+ (anphon/integration.cpp) on a synthetic uniform k mesh. The tetrahedron
+ decomposition and the weight formulas are copied verbatim from the
+ production kernel so that a change there can be re-timed here.
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "bench_common.h"
+#include <cmath>
+#include <vector>
+
+using namespace BENCH_NS;
+
+namespace {
+
+double fij(const double ei,
+           const double ej,
+           const double e)
+{
+    return (e - ej) / (ei - ej);
+}
+
+void insertion_sort(double *a,
+                    int *ind,
+                    const int n)
+{
+    int i;
+
+    for (i = 0; i < n; ++i) ind[i] = i;
+
+    for (i = 1; i < n; ++i) {
+        double tmp = a[i];
+
+        int j = i;
+        while (j > 0 && tmp < a[j - 1]) {
+            a[j] = a[j - 1];
+            ind[j] = ind[j - 1];
+            --j;
+        }
+        a[j] = tmp;
+        ind[j] = i;
+    }
+}
+
+void calc_weight_tetrahedron(const unsigned int nk_irreducible,
+                             const unsigned int *map_to_irreducible_k,
+                             const double *energy,
+                             const double e_ref,
+                             const unsigned int ntetra,
+                             const unsigned int *const *tetras,
+                             double *weight)
+{
+    unsigned int i;
+
+    double g;
+    double e_tmp[4];
+    int sort_arg[4], kindex[4];
+
+    for (i = 0; i < nk_irreducible; ++i) weight[i] = 0.0;
+
+    for (i = 0; i < ntetra; ++i) {
+
+        for (int j = 0; j < 4; ++j) {
+            e_tmp[j] = energy[tetras[i][j]];
+            kindex[j] = map_to_irreducible_k[tetras[i][j]];
+        }
+
+        insertion_sort(e_tmp, sort_arg, 4);
+        const auto e1 = e_tmp[0];
+        const auto e2 = e_tmp[1];
+        const auto e3 = e_tmp[2];
+        const auto e4 = e_tmp[3];
+
+        const auto k1 = kindex[sort_arg[0]];
+        const auto k2 = kindex[sort_arg[1]];
+        const auto k3 = kindex[sort_arg[2]];
+        const auto k4 = kindex[sort_arg[3]];
+
+        auto I1 = 0.0;
+        auto I2 = 0.0;
+        auto I3 = 0.0;
+        auto I4 = 0.0;
+
+        if (e3 <= e_ref && e_ref < e4) {
+            g = std::pow(e4 - e_ref, 2) / ((e4 - e1) * (e4 - e2) * (e4 - e3));
+
+            I1 = g * fij(e1, e4, e_ref);
+            I2 = g * fij(e2, e4, e_ref);
+            I3 = g * fij(e3, e4, e_ref);
+            I4 = g * (fij(e4, e1, e_ref) + fij(e4, e2, e_ref) + fij(e4, e3, e_ref));
+
+        } else if (e2 <= e_ref && e_ref < e3) {
+            g = (e2 - e1 + 2.0 * (e_ref - e2) - (e4 + e3 - e2 - e1)
+                                                * std::pow(e_ref - e2, 2) / ((e3 - e2) * (e4 - e2))) /
+                ((e3 - e1) * (e4 - e1));
+
+            I1 = g * fij(e1, e4, e_ref) + fij(e1, e3, e_ref) * fij(e3, e1, e_ref) * fij(e2, e3, e_ref) / (e4 - e1);
+            I2 = g * fij(e2, e3, e_ref) + std::pow(fij(e2, e4, e_ref), 2) * fij(e3, e2, e_ref) / (e4 - e1);
+            I3 = g * fij(e3, e2, e_ref) + std::pow(fij(e3, e1, e_ref), 2) * fij(e2, e3, e_ref) / (e4 - e1);
+            I4 = g * fij(e4, e1, e_ref) + fij(e4, e2, e_ref) * fij(e2, e4, e_ref) * fij(e3, e2, e_ref) / (e4 - e1);
+
+        } else if (e1 <= e_ref && e_ref < e2) {
+            g = std::pow(e_ref - e1, 2) / ((e2 - e1) * (e3 - e1) * (e4 - e1));
+
+            I1 = g * (fij(e1, e2, e_ref) + fij(e1, e3, e_ref) + fij(e1, e4, e_ref));
+            I2 = g * fij(e2, e1, e_ref);
+            I3 = g * fij(e3, e1, e_ref);
+            I4 = g * fij(e4, e1, e_ref);
+
+        }
+        weight[k1] += I1;
+        weight[k2] += I2;
+        weight[k3] += I3;
+        weight[k4] += I4;
+    }
+    const auto factor = 1.0 / static_cast<double>(ntetra);
+    for (i = 0; i < nk_irreducible; ++i) weight[i] *= factor;
+}
+}
+
+int main(int argc, char **argv)
+{
+    // --nkx   : linear mesh density (nk = nkx^3, ntetra = 6 nk)
+    // --neref : number of reference energies to integrate at
+    const auto nkx = get_option(argc, argv, "nkx", 24);
+    const auto neref = get_option(argc, argv, "neref", 200);
+
+    const auto nk = nkx * nkx * nkx;
+    const auto ntetra = 6 * nk;
+
+    // Same 6-tetrahedra decomposition of each mesh cell as TetraNodes.
+    std::vector<unsigned int> tetra_flat(ntetra * 4);
+    std::vector<unsigned int *> tetras(ntetra);
+
+    long m = 0;
+    for (long i = 0; i < nkx; ++i) {
+        for (long j = 0; j < nkx; ++j) {
+            for (long k = 0; k < nkx; ++k) {
+
+                const long ip = (i + 1) % nkx;
+                const long jp = (j + 1) % nkx;
+                const long kp = (k + 1) % nkx;
+
+                const unsigned int n1 = k + j * nkx + i * nkx * nkx;
+                const unsigned int n2 = k + j * nkx + ip * nkx * nkx;
+                const unsigned int n3 = k + jp * nkx + i * nkx * nkx;
+                const unsigned int n4 = k + jp * nkx + ip * nkx * nkx;
+                const unsigned int n5 = kp + j * nkx + i * nkx * nkx;
+                const unsigned int n6 = kp + j * nkx + ip * nkx * nkx;
+                const unsigned int n7 = kp + jp * nkx + i * nkx * nkx;
+                const unsigned int n8 = kp + jp * nkx + ip * nkx * nkx;
+
+                const unsigned int corners[6][4] = {{n1, n2, n3, n6},
+                                                    {n3, n6, n7, n8},
+                                                    {n3, n4, n6, n8},
+                                                    {n1, n3, n5, n6},
+                                                    {n3, n5, n6, n7},
+                                                    {n2, n3, n4, n6}};
+
+                for (auto it = 0; it < 6; ++it) {
+                    tetras[m] = &tetra_flat[4 * m];
+                    for (auto ic = 0; ic < 4; ++ic) tetras[m][ic] = corners[it][ic];
+                    ++m;
+                }
+            }
+        }
+    }
+
+    // Smooth synthetic band on the mesh; identity irreducible map keeps
+    // the scatter pattern identical to a mesh without symmetry.
+    std::vector<double> energy(nk);
+    std::vector<unsigned int> kmap(nk);
+    for (long ik = 0; ik < nk; ++ik) {
+        const double x = static_cast<double>(ik % nkx) / nkx;
+        const double y = static_cast<double>((ik / nkx) % nkx) / nkx;
+        const double z = static_cast<double>(ik / (nkx * nkx)) / nkx;
+        energy[ik] = 3.0 - std::cos(2.0 * std::acos(-1.0) * x)
+                     - std::cos(2.0 * std::acos(-1.0) * y)
+                     - std::cos(2.0 * std::acos(-1.0) * z);
+        kmap[ik] = ik;
+    }
+
+    std::vector<double> weight(nk);
+    auto checksum = 0.0;
+
+    Stopwatch watch;
+    watch.start();
+
+    for (long ie = 0; ie < neref; ++ie) {
+        const auto e_ref = 6.0 * static_cast<double>(ie) / neref;
+        calc_weight_tetrahedron(nk, kmap.data(), energy.data(), e_ref,
+                                ntetra, tetras.data(), weight.data());
+        checksum += weight[nk / 2];
+    }
+
+    const auto elapsed = watch.stop();
+
+    std::cout << " bench_tetrahedron: nk = " << nk << ", ntetra = " << ntetra
+              << ", neref = " << neref
+              << " (checksum = " << checksum << ")" << std::endl;
+    print_throughput("calc_weight_tetrahedron", elapsed,
+                     static_cast<double>(neref) * ntetra, "tetrahedron");
+
+    return 0;
+}
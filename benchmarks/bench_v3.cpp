@@ -0,0 +1,119 @@
+/*
+ bench_v3.cpp
+
+ Microbenchmark mirroring the inner loops of AnharmonicCore::V3
+ (anphon/anharmonic_core.cpp): the phase-factor summation over cubic
+ force-constant groups followed by the eigenvector gather. The driver is
+ self-contained and runs on synthetic force constants, eigenvectors and
+ k points so that kernel changes can be timed without a production run.
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "bench_common.h"
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace BENCH_NS;
+
+int main(int argc, char **argv)
+{
+    // --ngroup : number of (atom, xyz) index combinations of the cubic FCs
+    // --nelem  : number of multiplicity entries per group
+    // --ns     : number of phonon branches (3 * natmin)
+    // --ntriplet : number of (k2, k3) pairs to evaluate
+    const auto ngroup = get_option(argc, argv, "ngroup", 2000);
+    const auto nelem = get_option(argc, argv, "nelem", 8);
+    const auto ns = get_option(argc, argv, "ns", 6);
+    const auto ntriplet = get_option(argc, argv, "ntriplet", 2000);
+
+    const double tpi = 2.0 * std::acos(-1.0);
+
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<double> dist(-0.5, 0.5);
+    std::uniform_int_distribution<int> dist_band(0, static_cast<int>(ns) - 1);
+
+    // Synthetic stand-ins for fcs_group_v3, relvec_v3, invmass_v3 and
+    // evec_index_v3, laid out contiguously per group as in the real code.
+    std::vector<double> fcs(ngroup * nelem);
+    std::vector<double> relvec1(ngroup * nelem * 3), relvec2(ngroup * nelem * 3);
+    std::vector<double> invmass(ngroup);
+    std::vector<int> evec_index(ngroup * 3);
+
+    for (auto &val: fcs) val = dist(mt);
+    for (auto &val: relvec1) val = dist(mt);
+    for (auto &val: relvec2) val = dist(mt);
+    for (auto &val: invmass) val = 1.0 + std::abs(dist(mt));
+    for (auto &val: evec_index) val = dist_band(mt);
+
+    std::vector<std::complex<double>> evec(3 * ns * ns);
+    for (auto &val: evec) val = std::complex<double>(dist(mt), dist(mt));
+
+    std::vector<std::complex<double>> phi3(ngroup);
+    std::complex<double> checksum(0.0, 0.0);
+
+    Stopwatch watch;
+    watch.start();
+
+    for (long itriplet = 0; itriplet < ntriplet; ++itriplet) {
+
+        double xk2[3], xk3[3];
+        for (auto i = 0; i < 3; ++i) {
+            xk2[i] = dist(mt);
+            xk3[i] = dist(mt);
+        }
+
+        // Phase-factor summation (calc_phi3_reciprocal)
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (long i = 0; i < ngroup; ++i) {
+            auto ret_re = 0.0;
+            auto ret_im = 0.0;
+            for (long j = 0; j < nelem; ++j) {
+                const auto idx = (i * nelem + j) * 3;
+                const auto phase = tpi
+                                   * (xk2[0] * relvec1[idx] + xk2[1] * relvec1[idx + 1]
+                                      + xk2[2] * relvec1[idx + 2]
+                                      + xk3[0] * relvec2[idx] + xk3[1] * relvec2[idx + 1]
+                                      + xk3[2] * relvec2[idx + 2]);
+                ret_re += fcs[i * nelem + j] * std::cos(phase);
+                ret_im += fcs[i * nelem + j] * std::sin(phase);
+            }
+            phi3[i] = std::complex<double>(ret_re, ret_im);
+        }
+
+        const auto is1 = dist_band(mt);
+        const auto is2 = dist_band(mt);
+        const auto is3 = dist_band(mt);
+
+        // Eigenvector gather (V3 proper)
+        auto ret_re = 0.0;
+        auto ret_im = 0.0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+: ret_re, ret_im)
+#endif
+        for (long i = 0; i < ngroup; ++i) {
+            const auto vec = evec[is1 * ns + evec_index[3 * i]]
+                             * evec[ns * ns + is2 * ns + evec_index[3 * i + 1]]
+                             * evec[2 * ns * ns + is3 * ns + evec_index[3 * i + 2]]
+                             * invmass[i] * phi3[i];
+            ret_re += vec.real();
+            ret_im += vec.imag();
+        }
+        checksum += std::complex<double>(ret_re, ret_im);
+    }
+
+    const auto elapsed = watch.stop();
+
+    std::cout << " bench_v3: ngroup = " << ngroup << ", nelem = " << nelem
+              << ", ns = " << ns << ", ntriplet = " << ntriplet
+              << " (checksum = " << std::abs(checksum) << ")" << std::endl;
+    print_throughput("AnharmonicCore::V3", elapsed,
+                     static_cast<double>(ntriplet), "triplet");
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ bench_xml_load.cpp
+
+ Microbenchmark mirroring Fcs_phonon::load_fc2_xml
+ (anphon/fcs_phonon.cpp): boost::property_tree parsing of a synthetic
+ FCSXML harmonic block followed by the per-entry attribute decoding.
+ The XML document is generated in memory, so the measurement covers the
+ parser and the lexical casts, not the disk.
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "bench_common.h"
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <sstream>
+#include <vector>
+
+using namespace BENCH_NS;
+
+namespace {
+
+struct FcsEntry {
+    unsigned int atm1, xyz1;
+    unsigned int atm2, xyz2;
+    unsigned int cell_s;
+    double fcs_val;
+};
+
+// Emit a harmonic force-constant block in the same layout as the files
+// written by alm (writer.cpp).
+std::string generate_fcsxml(const long nfcs)
+{
+    std::mt19937_64 mt(1);
+    std::uniform_real_distribution<double> dist(-0.5, 0.5);
+    std::uniform_int_distribution<int> dist_atom(1, 64);
+
+    std::ostringstream ss;
+    ss.precision(15);
+    ss << "<Data>\n <ForceConstants>\n  <HARMONIC>\n";
+    for (long i = 0; i < nfcs; ++i) {
+        ss << "   <FC2 pair1=\"" << dist_atom(mt) << " " << 1 + i % 3
+           << "\" pair2=\"" << dist_atom(mt) << " " << 1 + (i / 3) % 3
+           << " " << 1 + i % 27 << "\">"
+           << std::scientific << dist(mt) << "</FC2>\n";
+    }
+    ss << "  </HARMONIC>\n </ForceConstants>\n</Data>\n";
+    return ss.str();
+}
+}
+
+int main(int argc, char **argv)
+{
+    // --nfcs : number of harmonic force-constant entries in the document
+    // --nrep : number of times the document is parsed
+    const auto nfcs = get_option(argc, argv, "nfcs", 50000);
+    const auto nrep = get_option(argc, argv, "nrep", 10);
+
+    using namespace boost::property_tree;
+
+    const auto document = generate_fcsxml(nfcs);
+    std::vector<FcsEntry> fc2_ext;
+    auto checksum = 0.0;
+
+    Stopwatch watch;
+    watch.start();
+
+    for (long irep = 0; irep < nrep; ++irep) {
+
+        ptree pt;
+        std::istringstream is(document);
+        read_xml(is, pt);
+
+        fc2_ext.clear();
+
+        std::stringstream ss1, ss2;
+        FcsEntry fcext_tmp{};
+
+        BOOST_FOREACH (const ptree::value_type &child_, pt.get_child("Data.ForceConstants.HARMONIC")) {
+                        const auto &child = child_.second;
+                        const auto str_p1 = child.get<std::string>("<xmlattr>.pair1");
+                        const auto str_p2 = child.get<std::string>("<xmlattr>.pair2");
+
+                        ss1.str("");
+                        ss2.str("");
+                        ss1.clear();
+                        ss2.clear();
+
+                        ss1 << str_p1;
+                        ss2 << str_p2;
+
+                        ss1 >> fcext_tmp.atm1 >> fcext_tmp.xyz1;
+                        ss2 >> fcext_tmp.atm2 >> fcext_tmp.xyz2 >> fcext_tmp.cell_s;
+                        fcext_tmp.fcs_val = boost::lexical_cast<double>(child.data());
+
+                        fc2_ext.push_back(fcext_tmp);
+                    }
+        checksum += fc2_ext.back().fcs_val;
+    }
+
+    const auto elapsed = watch.stop();
+
+    std::cout << " bench_xml_load: nfcs = " << nfcs << ", nrep = " << nrep
+              << " (checksum = " << checksum << ")" << std::endl;
+    print_throughput("FCSXML load", elapsed,
+                     static_cast<double>(nrep) * nfcs, "entry");
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ fcs_binary.h
+
+ Copyright (c) 2014 Terumasa Tadano
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Layout of the native binary force-constant container (*.fcsbin) written
+// by ALM (FCS_BINARY = 1) and read by ANPHON (FCSBIN tag). The file is a
+// flat little-endian image:
+//
+//   char      magic[8]     "ALMFCSBN"
+//   uint32    version      currently 2
+//   uint32    norder       number of force-constant tables (1 = harmonic)
+//   uint32    asr_imposed  nonzero if the translational sum rules were
+//                          imposed when the file was created (since v2)
+//   uint32    (reserved)   written as zero (since v2)
+//   norder x  FcsBinaryTableInfo
+//   norder x  uint64       per-table FNV-1a checksum over the table bytes,
+//                          values first, then indices (since v2)
+//   ...       tables
+//
+// Version 1 files lack the asr_imposed and checksum fields and are still
+// accepted by the reader; they simply never qualify for the fast path
+// that skips the translational-invariance check.
+//
+// A table of order n (harmonic: n = 2) stores first all values and then
+// all index tuples, so each array can be read or mapped in one piece:
+//
+//   double    value[nelem]
+//   uint32    index[nelem][n][3]
+//
+// The three indices of a pair are the same 1-based (atom, xyz, cell)
+// numbers that appear in the pairN attributes of the XML format; the cell
+// entry of the first pair is unused and written as zero.
+
+const char fcs_binary_magic[8] = {'A', 'L', 'M', 'F', 'C', 'S', 'B', 'N'};
+const std::uint32_t fcs_binary_version = 2;
+
+struct FcsBinaryTableInfo {
+    std::uint64_t nelem;
+    std::uint64_t offset; // byte offset of the table from the file start
+};
+
+// 64-bit FNV-1a hash used as the per-table checksum. Passing the result of
+// one call as the seed of the next chains the hash over several arrays.
+inline std::uint64_t fcs_binary_checksum(const void *data,
+                                         const std::size_t nbytes,
+                                         std::uint64_t seed = 14695981039346656037ULL)
+{
+    const auto *ptr = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < nbytes; ++i) {
+        seed ^= static_cast<std::uint64_t>(ptr[i]);
+        seed *= 1099511628211ULL;
+    }
+    return seed;
+}
+
+// In-memory variant of the container, used for the direct handoff of the
+// fitted force constants from ALM to ANPHON when both run in the same
+// process (ALM::get_fcs_arrays -> Fcs_phonon::set_fcs_from_arrays).
+// values[order] and indices[order] hold exactly the records of a table of
+// order (order + 2) as described above: nelem values followed by the
+// flattened 1-based (atom, xyz, cell) triplets, nelem x (order + 2) x 3.
+// The struct lives outside both namespaces so that a driver linking the
+// two codes can pass it across without a file in between.
+struct FcsArrays {
+    std::vector<std::vector<double>> values;
+    std::vector<std::vector<std::uint32_t>> indices;
+};
@@ -0,0 +1,120 @@
+/*
+ xml_stream_parser.h
+
+ Copyright (c) 2014 Terumasa Tadano
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#pragma once
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Forward-only scanner for the force-constant sections of ALAMODE XML
+// files. Loading these files through boost::property_tree materializes the
+// whole document in memory, which is prohibitive for multi-GB anharmonic
+// FCSXML files; this scanner reads the file once in fixed-size chunks and
+// hands each force-constant element of the requested section to a callback
+// as soon as it is complete. It understands only the subset of XML written
+// by the ALM writer: elements with double-quoted pairN attributes and a
+// plain text value, no CDATA and no comments inside the sections.
+//
+// Returns true when the section was found, false when the file could not
+// be opened or does not contain the section.
+
+inline bool stream_forceconstant_section(const std::string &filename,
+                                         const std::string &section,
+                                         const std::function<void(const std::vector<std::string> &pairs,
+                                                                  double fcs_val)> &handler)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs) return false;
+
+    const std::size_t chunksize = 1048576;
+    std::vector<char> chunk(chunksize);
+    std::string buf;
+    std::size_t pos = 0;
+    auto in_section = false;
+    auto found_section = false;
+    std::vector<std::string> pairs;
+
+    auto refill = [&ifs, &chunk, &buf, chunksize]() {
+        ifs.read(&chunk[0], chunksize);
+        const auto nread = ifs.gcount();
+        if (nread <= 0) return false;
+        buf.append(&chunk[0], static_cast<std::size_t>(nread));
+        return true;
+    };
+
+    while (true) {
+
+        // Drop the consumed prefix so the buffer stays one chunk long.
+        if (pos > 0) {
+            buf.erase(0, pos);
+            pos = 0;
+        }
+
+        auto lt = buf.find('<');
+        if (lt == std::string::npos) {
+            buf.clear();
+            if (!refill()) break;
+            continue;
+        }
+        auto gt = buf.find('>', lt);
+        if (gt == std::string::npos) {
+            if (!refill()) break;
+            continue;
+        }
+
+        const auto tag = buf.substr(lt + 1, gt - lt - 1);
+        pos = gt + 1;
+
+        if (tag.empty() || tag[0] == '?' || tag[0] == '!') continue;
+
+        if (tag[0] == '/') {
+            // The sections are unique, so the scan can stop at the
+            // closing tag of the requested one.
+            if (in_section && tag.compare(1, std::string::npos, section) == 0) break;
+            continue;
+        }
+
+        const auto name = tag.substr(0, tag.find_first_of(" \t\r\n/"));
+
+        if (name == section) {
+            in_section = true;
+            found_section = true;
+            continue;
+        }
+        if (!in_section) continue;
+
+        // A force-constant element: collect the pairN attributes.
+        pairs.clear();
+        for (auto i = 1;; ++i) {
+            const auto key = "pair" + std::to_string(i) + "=\"";
+            const auto loc = tag.find(key);
+            if (loc == std::string::npos) break;
+            const auto vbegin = loc + key.length();
+            const auto vend = tag.find('"', vbegin);
+            if (vend == std::string::npos) break;
+            pairs.push_back(tag.substr(vbegin, vend - vbegin));
+        }
+        if (pairs.empty()) continue;
+
+        // The value is the text up to the next tag.
+        auto next_lt = buf.find('<', pos);
+        while (next_lt == std::string::npos) {
+            if (!refill()) return found_section;
+            next_lt = buf.find('<', pos);
+        }
+        handler(pairs, std::strtod(buf.c_str() + pos, nullptr));
+        pos = next_lt;
+    }
+
+    return found_section;
+}
@@ -9,10 +9,16 @@
 */
 
 #include <stdlib.h>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "memory.h"
 #include "analyze_phonons.h"
 
@@ -21,8 +27,6 @@ using namespace std;
 int main(int argc,
          char *argv[])
 {
-    string str;
-
     cout << "# Result analyzer ver. 1.0.5" << endl;
     cout << "# Input file : " << argv[1] << endl;
     calc = argv[2];
@@ -72,61 +76,24 @@ int main(int argc,
     ifs >> nkx >> nky >> nkz;
     ifs >> nk;
 
-    if (!locate_tag("##Phonon Frequency")) {
-        cout << "ERROR: Cannot find ##Phonon Frequency tag" << endl;
-        exit(1);
-    }
-    getline(ifs, str);
+    ifs.close();
 
     allocate(omega, nk, ns);
     allocate(tau, nt, nk, ns);
     allocate(vel, nk, ns, 48, 3);
     allocate(n_weight, nk);
 
-    int idummy, jdummy;
-
-    for (i = 0; i < nk; ++i) {
-        for (j = 0; j < ns; ++j) {
-            ifs >> idummy >> jdummy >> omega[i][j];
-        }
-    }
-
-    if (!locate_tag("##Phonon Relaxation Time")) {
-        cout << "ERROR: Cannot find ##Phonon Relaxation Time tag" << endl;
-        exit(1);
-    }
-
-    double vel_tmp[3];
-    double damp_tmp;
-
-    for (i = 0; i < nk; ++i) {
-        for (j = 0; j < ns; ++j) {
-            getline(ifs, str);
-            getline(ifs, str);
-
-            ifs >> n_weight[i];
-
-            for (k = 0; k < n_weight[i]; ++k) {
-                ifs >> vel_tmp[0] >> vel_tmp[1] >> vel_tmp[2];
+    // The frequency and relaxation time tables dominate the startup time on
+    // large meshes. They are parsed from a memory-mapped buffer and cached in
+    // binary next to the .result file, so repeated invocations skip the text
+    // parse entirely.
+    const string file_result = argv[1];
 
-                for (l = 0; l < 3; ++l) vel[i][j][k][l] = vel_tmp[l];
-            }
-
-            for (k = 0; k < nt; ++k) {
-                ifs >> damp_tmp;
-                if (omega[i][j] < eps6) {
-                    tau[k][i][j] = 0.0; // Neglect contributions from imaginary branches
-                } else {
-                    tau[k][i][j] = 1.0e+12 * Hz_to_kayser * 0.5 / damp_tmp;
-                }
-            }
-            ifs.ignore();
-            getline(ifs, str);
-        }
+    if (!load_result_cache(file_result)) {
+        parse_result_arrays(file_result);
+        save_result_cache(file_result);
     }
 
-    ifs.close();
-
     if (average_gamma) average_gamma_at_degenerate_point(omega, tau, nt, nk, ns);
 
     if (calc == "tau") {
@@ -853,6 +820,256 @@ int locate_tag(string key)
     return ret;
 }
 
+namespace {
+// Validation header of the binary sidecar cache written next to the .result
+// file. The cache is invalidated whenever the source file changes.
+struct ResultCacheHeader {
+    char magic[8];
+    long long src_size;
+    long long src_mtime;
+    int nk, ns, nt;
+};
+
+const char result_cache_magic[8] = {'A', 'L', 'M', 'T', 'A', 'U', '0', '1'};
+
+bool stat_file(const std::string &fname,
+               long long &fsize,
+               long long &fmtime)
+{
+    struct stat st;
+
+    if (stat(fname.c_str(), &st) != 0) return false;
+    fsize = static_cast<long long>(st.st_size);
+    fmtime = static_cast<long long>(st.st_mtime);
+    return true;
+}
+
+// Map the whole file read-only. When the file size is not a multiple of the
+// page size, the kernel zero-fills the tail of the last page, so the mapped
+// buffer is effectively NUL terminated and safe for strtod/strtol. In the
+// remaining cases the file is slurped into a heap buffer with an explicit
+// terminator instead.
+char *map_result_file(const std::string &fname,
+                      size_t &length,
+                      bool &mapped)
+{
+    const int fd = open(fname.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        cout << "ERROR: Cannot open file " << fname << endl;
+        exit(1);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        cout << "ERROR: Cannot stat file " << fname << endl;
+        exit(1);
+    }
+    length = static_cast<size_t>(st.st_size);
+
+    const long pagesize = sysconf(_SC_PAGESIZE);
+
+    if (length > 0 && pagesize > 0 && length % static_cast<size_t>(pagesize) != 0) {
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr != MAP_FAILED) {
+            close(fd);
+            mapped = true;
+            return static_cast<char *>(addr);
+        }
+    }
+
+    char *buf = new char[length + 1];
+    size_t nread = 0;
+
+    while (nread < length) {
+        const ssize_t len_read = read(fd, buf + nread, length - nread);
+        if (len_read <= 0) {
+            cout << "ERROR: Cannot read file " << fname << endl;
+            exit(1);
+        }
+        nread += static_cast<size_t>(len_read);
+    }
+    buf[length] = '\0';
+    close(fd);
+    mapped = false;
+    return buf;
+}
+
+void unmap_result_file(char *buf,
+                       const size_t length,
+                       const bool mapped)
+{
+    if (mapped) {
+        munmap(buf, length);
+    } else {
+        delete[] buf;
+    }
+}
+
+double next_double(const char *&p)
+{
+    char *p_end;
+    const double val = strtod(p, &p_end);
+    p = p_end;
+    return val;
+}
+
+long next_long(const char *&p)
+{
+    char *p_end;
+    const long val = strtol(p, &p_end, 10);
+    p = p_end;
+    return val;
+}
+
+void skip_line(const char *&p)
+{
+    while (*p != '\0' && *p != '\n') ++p;
+    if (*p == '\n') ++p;
+}
+}
+
+void parse_result_arrays(const std::string &file_result)
+{
+    size_t length;
+    bool mapped;
+
+    char *buf = map_result_file(file_result, length, mapped);
+
+    const char *p = strstr(buf, "##Phonon Frequency");
+    if (!p) {
+        cout << "ERROR: Cannot find ##Phonon Frequency tag" << endl;
+        exit(1);
+    }
+    skip_line(p); // tag line
+    skip_line(p); // column header
+
+    for (i = 0; i < nk; ++i) {
+        for (j = 0; j < ns; ++j) {
+            next_long(p);
+            next_long(p);
+            omega[i][j] = next_double(p);
+        }
+    }
+
+    p = strstr(p, "##Phonon Relaxation Time");
+    if (!p) {
+        cout << "ERROR: Cannot find ##Phonon Relaxation Time tag" << endl;
+        exit(1);
+    }
+    skip_line(p);
+
+    // The velocity table is only filled up to n_weight[ik] entries;
+    // zero the rest so the cached image is well defined.
+    double *vel_flat = &vel[0][0][0][0];
+    const long len_vel = static_cast<long>(nk) * ns * 48 * 3;
+    for (long ii = 0; ii < len_vel; ++ii) vel_flat[ii] = 0.0;
+
+    double damp_tmp;
+
+    for (i = 0; i < nk; ++i) {
+        for (j = 0; j < ns; ++j) {
+            skip_line(p);
+            skip_line(p);
+
+            n_weight[i] = static_cast<int>(next_long(p));
+
+            for (k = 0; k < n_weight[i]; ++k) {
+                for (l = 0; l < 3; ++l) vel[i][j][k][l] = next_double(p);
+            }
+
+            for (k = 0; k < nt; ++k) {
+                damp_tmp = next_double(p);
+                if (omega[i][j] < eps6) {
+                    tau[k][i][j] = 0.0; // Neglect contributions from imaginary branches
+                } else {
+                    tau[k][i][j] = 1.0e+12 * Hz_to_kayser * 0.5 / damp_tmp;
+                }
+            }
+            skip_line(p);
+            skip_line(p);
+        }
+    }
+
+    unmap_result_file(buf, length, mapped);
+}
+
+bool load_result_cache(const std::string &file_result)
+{
+    long long src_size, src_mtime;
+
+    if (!stat_file(file_result, src_size, src_mtime)) return false;
+
+    const string file_cache = file_result + ".cache";
+
+    std::FILE *fp = std::fopen(file_cache.c_str(), "rb");
+    if (!fp) return false;
+
+    ResultCacheHeader header;
+
+    bool ok = std::fread(&header, sizeof(header), 1, fp) == 1
+            && std::memcmp(header.magic, result_cache_magic, 8) == 0
+            && header.src_size == src_size
+            && header.src_mtime == src_mtime
+            && header.nk == nk && header.ns == ns && header.nt == nt;
+
+    if (ok) {
+        const size_t len_omega = static_cast<size_t>(nk) * ns;
+        const size_t len_tau = static_cast<size_t>(nt) * nk * ns;
+        const size_t len_vel = static_cast<size_t>(nk) * ns * 48 * 3;
+
+        ok = std::fread(n_weight, sizeof(int), nk, fp) == static_cast<size_t>(nk)
+                && std::fread(&omega[0][0], sizeof(double), len_omega, fp) == len_omega
+                && std::fread(&tau[0][0][0], sizeof(double), len_tau, fp) == len_tau
+                && std::fread(&vel[0][0][0][0], sizeof(double), len_vel, fp) == len_vel;
+    }
+
+    std::fclose(fp);
+
+    if (ok) {
+        cout << "# Cache file : " << file_cache << endl;
+    }
+    return ok;
+}
+
+void save_result_cache(const std::string &file_result)
+{
+    long long src_size, src_mtime;
+
+    if (!stat_file(file_result, src_size, src_mtime)) return;
+
+    const string file_cache = file_result + ".cache";
+    const string file_tmp = file_cache + ".tmp";
+
+    std::FILE *fp = std::fopen(file_tmp.c_str(), "wb");
+    if (!fp) return; // The cache is an optimization only; stay silent.
+
+    ResultCacheHeader header;
+    std::memcpy(header.magic, result_cache_magic, 8);
+    header.src_size = src_size;
+    header.src_mtime = src_mtime;
+    header.nk = nk;
+    header.ns = ns;
+    header.nt = nt;
+
+    const size_t len_omega = static_cast<size_t>(nk) * ns;
+    const size_t len_tau = static_cast<size_t>(nt) * nk * ns;
+    const size_t len_vel = static_cast<size_t>(nk) * ns * 48 * 3;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, fp) == 1
+            && std::fwrite(n_weight, sizeof(int), nk, fp) == static_cast<size_t>(nk)
+            && std::fwrite(&omega[0][0], sizeof(double), len_omega, fp) == len_omega
+            && std::fwrite(&tau[0][0][0], sizeof(double), len_tau, fp) == len_tau
+            && std::fwrite(&vel[0][0][0][0], sizeof(double), len_vel, fp) == len_vel;
+
+    ok = (std::fclose(fp) == 0) && ok;
+
+    if (!ok || std::rename(file_tmp.c_str(), file_cache.c_str()) != 0) {
+        std::remove(file_tmp.c_str());
+    }
+}
+
 double Cv(double omega,
           double temp)
 {
@@ -20,6 +20,12 @@
 
 int locate_tag(std::string);
 
+bool load_result_cache(const std::string &);
+
+void save_result_cache(const std::string &);
+
+void parse_result_arrays(const std::string &);
+
 std::ifstream ifs;
 
 int i, j, k, l;
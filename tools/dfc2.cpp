@@ -11,8 +11,13 @@ or http://opensource.org/licenses/mit-license.php for information.
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/foreach.hpp>
@@ -224,23 +229,113 @@ void load_fc2_xml(const std::string file_in)
 }
 
 
-void load_delta_fc2(const std::string file_in, const double temp)
+namespace {
+// Map the whole correction file read-only. When the file size is not a
+// multiple of the page size, the kernel zero-fills the tail of the last
+// page, so the mapped buffer is effectively NUL terminated and safe for
+// strtod/strtol. In the remaining cases the file is slurped into a heap
+// buffer with an explicit terminator instead.
+char *map_correction_file(const std::string &fname,
+                          size_t &length,
+                          bool &mapped)
 {
-    int i;
-    ifstream ifs_in;
-    stringstream ss;
+    const int fd = open(fname.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        cout << "Could not open " + fname << endl;
+        exit(EXIT_FAILURE);
+    }
 
-    // Restart
-    ifs_in.open(file_in.c_str(), ios::in);
-    if (!ifs_in) {
-        cout << "Could not open " + file_in << endl;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        cout << "Could not stat " + fname << endl;
         exit(EXIT_FAILURE);
     }
+    length = static_cast<size_t>(st.st_size);
+
+    const long pagesize = sysconf(_SC_PAGESIZE);
+
+    if (length > 0 && pagesize > 0 && length % static_cast<size_t>(pagesize) != 0) {
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr != MAP_FAILED) {
+            close(fd);
+            mapped = true;
+            return static_cast<char *>(addr);
+        }
+    }
 
-    // Check the consistency
+    char *buf = new char[length + 1];
+    size_t nread = 0;
 
-    string line_tmp, str_tmp;
-    vector<string> str_vec;
+    while (nread < length) {
+        const ssize_t len_read = read(fd, buf + nread, length - nread);
+        if (len_read <= 0) {
+            cout << "Could not read " + fname << endl;
+            exit(EXIT_FAILURE);
+        }
+        nread += static_cast<size_t>(len_read);
+    }
+    buf[length] = '\0';
+    close(fd);
+    mapped = false;
+    return buf;
+}
+
+void unmap_correction_file(char *buf,
+                           const size_t length,
+                           const bool mapped)
+{
+    if (mapped) {
+        munmap(buf, length);
+    } else {
+        delete[] buf;
+    }
+}
+
+double next_double(const char *&p)
+{
+    char *p_end;
+    const double val = strtod(p, &p_end);
+    p = p_end;
+    return val;
+}
+
+long next_long(const char *&p)
+{
+    char *p_end;
+    const long val = strtol(p, &p_end, 10);
+    p = p_end;
+    return val;
+}
+
+void skip_line(const char *&p)
+{
+    while (*p != '\0' && *p != '\n') ++p;
+    if (*p == '\n') ++p;
+}
+
+void skip_space(const char *&p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ++p;
+}
+}
+
+void load_delta_fc2(const std::string file_in, const double temp)
+{
+    int i;
+
+    // The correction file holds one block per temperature and the blocks of
+    // a dense interpolation mesh run to gigabytes, so it is parsed from a
+    // memory-mapped buffer with number cursors instead of getline and
+    // string streams. Skipping to the requested temperature touches only
+    // the "# Temp" tag lines of the preceding blocks.
+
+    size_t length;
+    bool mapped;
+
+    char *buf = map_correction_file(file_in, length, mapped);
+    const char *p = buf;
 
     int sx, sy, sz;
     int atm1, atm2, xyz1, xyz2;
@@ -249,29 +344,41 @@ void load_delta_fc2(const std::string file_in, const double temp)
 
     // Get lattice vectors
     for (i = 0; i < 3; ++i) {
-        ifs_in >> lavec_p[0][i] >> lavec_p[1][i] >> lavec_p[2][i];
+        lavec_p[0][i] = next_double(p);
+        lavec_p[1][i] = next_double(p);
+        lavec_p[2][i] = next_double(p);
     }
     recips(lavec_p, rlavec_p);
 
-    ifs_in >> nat_p >> nkd_p;
-    ifs_in.ignore();
-    getline(ifs_in, line_tmp);
+    nat_p = static_cast<unsigned int>(next_long(p));
+    nkd_p = static_cast<unsigned int>(next_long(p));
+    skip_line(p);
+    skip_line(p); // element symbols
 
     allocate(xr_p, nat_p, 3);
     allocate(kd_p, nat_p);
     for (i = 0; i < nat_p; ++i) {
-        ifs_in >> xr_p[i][0] >> xr_p[i][1] >> xr_p[i][2] >> kd_p[i];
+        xr_p[i][0] = next_double(p);
+        xr_p[i][1] = next_double(p);
+        xr_p[i][2] = next_double(p);
+        kd_p[i] = static_cast<unsigned int>(next_long(p));
     }
-    ifs_in.ignore();
-
-    while (getline(ifs_in, line_tmp)) {
-        if (line_tmp[0] == '#') {
-            boost::split(str_vec, line_tmp, boost::is_space());
-            if (abs(boost::lexical_cast<double>(str_vec[3]) - temp) < eps) {
-                found_tag = true;
-                break;
+    skip_line(p);
+
+    while (*p != '\0') {
+        if (*p == '#') {
+            const char *q = p;
+            while (*q != '\0' && *q != '\n' && *q != '=') ++q;
+            if (*q == '=') {
+                ++q;
+                if (abs(strtod(q, nullptr) - temp) < eps) {
+                    found_tag = true;
+                    skip_line(p);
+                    break;
+                }
             }
         }
+        skip_line(p);
     }
     if (!found_tag) {
         cout << "Could not find the # Temp tag for the target temperature" << endl;
@@ -280,22 +387,23 @@ void load_delta_fc2(const std::string file_in, const double temp)
 
     delta_fc2.clear();
 
-    while (getline(ifs_in, line_tmp)) {
-
-        if (line_tmp[0] == '#') break;
-
-        if (!line_tmp.empty()) {
-            stringstream ss1;
-
-            ss1 << line_tmp;
-            ss1 >> sx >> sy >> sz >> atm1 >> xyz1 >> atm2 >> xyz2 >> dfc2_tmp;
+    while (true) {
+        skip_space(p);
+        if (*p == '\0' || *p == '#') break;
 
-            delta_fc2.emplace_back(DeltaFcs(sx, sy, sz, atm1, xyz1, atm2, xyz2, dfc2_tmp));
-        }
+        sx = static_cast<int>(next_long(p));
+        sy = static_cast<int>(next_long(p));
+        sz = static_cast<int>(next_long(p));
+        atm1 = static_cast<int>(next_long(p));
+        xyz1 = static_cast<int>(next_long(p));
+        atm2 = static_cast<int>(next_long(p));
+        xyz2 = static_cast<int>(next_long(p));
+        dfc2_tmp = next_double(p);
 
+        delta_fc2.emplace_back(DeltaFcs(sx, sy, sz, atm1, xyz1, atm2, xyz2, dfc2_tmp));
     }
 
-    ifs_in.close();
+    unmap_correction_file(buf, length, mapped);
 }
 
 
@@ -342,22 +450,27 @@ void calculate_new_fc2(const std::vector<FcsClassExtent> &fc2_in,
         }
     }
 
-    double vec[3];
-
-    int icount = 0;
+    // The translated keys are independent of each other and so are the
+    // binary searches of the correction entries, so both loops are
+    // threaded. Each correction entry owns a distinct key and therefore a
+    // distinct slot of fc2_new, which keeps the updates race free.
 
-    vector<int> arr_tmp;
-    vector<FcsTrans> fc2_data;
+    const int nfc2 = static_cast<int>(fc2_in.size());
 
-    fc2_data.clear();
+    vector<FcsTrans> fc2_data(nfc2);
 
-    for (const auto &it: fc2_in) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int ielem = 0; ielem < nfc2; ++ielem) {
 
-        arr_tmp.clear();
+        const auto &it = fc2_in[ielem];
+        double vec[3];
+        vector<int> arr_tmp;
 
-        for (i = 0; i < 3; ++i) {
-            vec[i] = xr_s[it.atm2][i] + xshift_s[it.cell_s][i]
-                     - xr_s[map_p2s[map_s2p[it.atm2].atom_num][0]][i];
+        for (int m = 0; m < 3; ++m) {
+            vec[m] = xr_s[it.atm2][m] + xshift_s[it.cell_s][m]
+                     - xr_s[map_p2s[map_s2p[it.atm2].atom_num][0]][m];
         }
 
         rotvec(vec, vec, mat_convert);
@@ -366,31 +479,27 @@ void calculate_new_fc2(const std::vector<FcsClassExtent> &fc2_in,
         arr_tmp.push_back(it.xyz1);
         arr_tmp.push_back(map_s2p[it.atm2].atom_num);
         arr_tmp.push_back(it.xyz2);
-        for (i = 0; i < 3; ++i) arr_tmp.push_back(nint(vec[i]));
-
-//        std::cout << std::setw(5) << vec[0];
-//        std::cout << std::setw(5) << vec[1];
-//        std::cout << std::setw(5) << vec[2];
-//
-//        std::cout << std::setw(5) << it.atm1 << std::setw(5) << it.xyz1;
-//        std::cout << std::setw(5) << map_s2p[it.atm2].atom_num << std::setw(5) << it.xyz2;
-//        std::cout << std::setw(15) << it.fcs_val << '\n';
-
-        fc2_data.emplace_back(arr_tmp, icount);
-        ++icount;
+        for (int m = 0; m < 3; ++m) arr_tmp.push_back(nint(vec[m]));
+
+        fc2_data[ielem].arr.swap(arr_tmp);
+        fc2_data[ielem].fcs_index = ielem;
     }
 
     std::sort(fc2_data.begin(), fc2_data.end());
 
-    vector<FcsTrans>::iterator iter_found;
-    int index_tmp = 0;
+    const int ndelta = static_cast<int>(delta_fc2.size());
 
     bool detect_warnings = false;
 
-    for (auto &it: delta_fc2) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+    for (int ielem = 0; ielem < ndelta; ++ielem) {
+
+        const auto &it = delta_fc2[ielem];
 
         if (abs(it.dfc2) > eps10) {
-            arr_tmp.clear();
+            vector<int> arr_tmp;
             arr_tmp.push_back(it.atm1);
             arr_tmp.push_back(it.xyz1);
             arr_tmp.push_back(it.atm2);
@@ -399,21 +508,25 @@ void calculate_new_fc2(const std::vector<FcsClassExtent> &fc2_in,
             arr_tmp.push_back(it.sy);
             arr_tmp.push_back(it.sz);
 
-            iter_found = lower_bound(fc2_data.begin(), fc2_data.end(),
-                                     FcsTrans(arr_tmp, index_tmp));
+            const auto iter_found = lower_bound(fc2_data.begin(), fc2_data.end(),
+                                                FcsTrans(arr_tmp, ielem));
 
             if (iter_found != fc2_data.end() && arr_tmp == (*iter_found).arr) {
                 fc2_new[(*iter_found).fcs_index].fcs_val += it.dfc2;
             } else {
-                cout << "Warning: The following force constant doesn't exist in the original file:" << endl;
-                cout << setw(5) << it.sx << setw(5) << it.sy << setw(5) << it.sz;
-                cout << setw(5) << it.atm1 << setw(5) << it.xyz1;
-                cout << setw(5) << it.atm2 << setw(5) << it.xyz2;
-                cout << setw(15) << it.dfc2 << endl;
-                detect_warnings = true;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                {
+                    cout << "Warning: The following force constant doesn't exist in the original file:" << endl;
+                    cout << setw(5) << it.sx << setw(5) << it.sy << setw(5) << it.sz;
+                    cout << setw(5) << it.atm1 << setw(5) << it.xyz1;
+                    cout << setw(5) << it.atm2 << setw(5) << it.xyz2;
+                    cout << setw(15) << it.dfc2 << endl;
+                    detect_warnings = true;
+                }
             }
         }
-        ++index_tmp;
     }
 
     if (detect_warnings) {
@@ -473,86 +586,125 @@ void write_new_xml(const std::vector<FcsClassExtent> fc2_in,
                    const std::string xml_out)
 {
     // Write to XML file
+    //
+    // The XML is streamed straight to the output file instead of being
+    // assembled in a property tree first: a tree node per force constant
+    // costs two orders of magnitude more memory than the value it holds.
 
     int i, j;
-    using boost::property_tree::ptree;
 
-    ptree pt;
-    string str_pos[3], str_tmp;
+    ofstream ofs_xml(xml_out.c_str(), std::ios::out);
 
-    str_tmp.clear();
+    if (!ofs_xml) {
+        cout << "Could not open " + xml_out << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<char> obuf(1048576);
+    ofs_xml.rdbuf()->pubsetbuf(&obuf[0], obuf.size());
 
-    pt.put("Data.OriginalFC2", original_xml);
-    pt.put("Data.SCPH_file", file_fc2_correction);
-    pt.put("Data.SCPH_Temperature", double2string(temp, 5));
-    pt.put("Data.Structure.NumberOfAtoms", nat);
-    pt.put("Data.Structure.NumberOfElements", nkd);
+    ofs_xml << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+    ofs_xml << "<Data>\n";
+    ofs_xml << "  <OriginalFC2>" << xml_escape(original_xml) << "</OriginalFC2>\n";
+    ofs_xml << "  <SCPH_file>" << xml_escape(file_fc2_correction) << "</SCPH_file>\n";
+    ofs_xml << "  <SCPH_Temperature>" << double2string(temp, 5) << "</SCPH_Temperature>\n";
+    ofs_xml << "  <Structure>\n";
+    ofs_xml << "    <NumberOfAtoms>" << nat << "</NumberOfAtoms>\n";
+    ofs_xml << "    <NumberOfElements>" << nkd << "</NumberOfElements>\n";
+    ofs_xml << "    <AtomicElements>\n";
 
     for (i = 0; i < nkd; ++i) {
-        ptree &child = pt.add("Data.Structure.AtomicElements.element", kd_symbol[i]);
-        child.put("<xmlattr>.number", i + 1);
+        ofs_xml << "      <element number=\"" << i + 1 << "\">"
+                << xml_escape(kd_symbol[i]) << "</element>\n";
     }
+    ofs_xml << "    </AtomicElements>\n";
 
+    ofs_xml << "    <LatticeVector>\n";
     for (i = 0; i < 3; ++i) {
-        str_pos[i].clear();
+        ofs_xml << "      <a" << i + 1 << ">";
         for (j = 0; j < 3; ++j) {
-            str_pos[i] += " " + double2string(lavec_s[j][i]);
+            ofs_xml << " " << double2string(lavec_s[j][i]);
         }
+        ofs_xml << "</a" << i + 1 << ">\n";
     }
-    pt.put("Data.Structure.LatticeVector", "");
-    pt.put("Data.Structure.LatticeVector.a1", str_pos[0]);
-    pt.put("Data.Structure.LatticeVector.a2", str_pos[1]);
-    pt.put("Data.Structure.LatticeVector.a3", str_pos[2]);
-
-    std::stringstream ss;
-    ss << is_periodic[0] << " "
-       << is_periodic[1] << " "
-       << is_periodic[2];
-    pt.put("Data.Structure.Periodicity", ss.str());
+    ofs_xml << "    </LatticeVector>\n";
 
-    pt.put("Data.Structure.Position", "");
+    ofs_xml << "    <Periodicity>" << is_periodic[0] << " "
+            << is_periodic[1] << " "
+            << is_periodic[2] << "</Periodicity>\n";
 
+    ofs_xml << "    <Position>\n";
     for (i = 0; i < nat; ++i) {
-        str_tmp.clear();
-        for (j = 0; j < 3; ++j) str_tmp += " " + double2string(xr_s[i][j]);
-        ptree &child = pt.add("Data.Structure.Position.pos", str_tmp);
-        child.put("<xmlattr>.index", i + 1);
-        child.put("<xmlattr>.element", kd_symbol[kd[i]]);
+        ofs_xml << "      <pos index=\"" << i + 1
+                << "\" element=\"" << xml_escape(kd_symbol[kd[i]]) << "\">";
+        for (j = 0; j < 3; ++j) {
+            ofs_xml << " " << double2string(xr_s[i][j]);
+        }
+        ofs_xml << "</pos>\n";
     }
+    ofs_xml << "    </Position>\n";
+    ofs_xml << "  </Structure>\n";
 
-    pt.put("Data.Symmetry.NumberOfTranslations", ntran);
+    ofs_xml << "  <Symmetry>\n";
+    ofs_xml << "    <NumberOfTranslations>" << ntran << "</NumberOfTranslations>\n";
+    ofs_xml << "    <Translations>\n";
     for (i = 0; i < ntran; ++i) {
         for (j = 0; j < natmin; ++j) {
-            ptree &child = pt.add("Data.Symmetry.Translations.map", map_p2s[j][i] + 1);
-            child.put("<xmlattr>.tran", i + 1);
-            child.put("<xmlattr>.atom", j + 1);
+            ofs_xml << "      <map tran=\"" << i + 1 << "\" atom=\"" << j + 1 << "\">"
+                    << map_p2s[j][i] + 1 << "</map>\n";
         }
     }
+    ofs_xml << "    </Translations>\n";
+    ofs_xml << "  </Symmetry>\n";
 
-
-    pt.put("Data.ForceConstants", "");
-    str_tmp.clear();
+    ofs_xml << "  <ForceConstants>\n";
+    ofs_xml << "    <HARMONIC>\n";
 
     for (const auto &it: fc2_in) {
-        ptree &child = pt.add("Data.ForceConstants.HARMONIC.FC2", double2string(it.fcs_val));
+        ofs_xml << "      <FC2 pair1=\"" << it.atm1 + 1 << " " << it.xyz1 + 1
+                << "\" pair2=\"" << it.atm2 + 1 << " " << it.xyz2 + 1
+                << " " << it.cell_s + 1 << "\">"
+                << double2string(it.fcs_val) << "</FC2>\n";
+    }
+    ofs_xml << "    </HARMONIC>\n";
+    ofs_xml << "  </ForceConstants>\n";
+    ofs_xml << "</Data>\n";
+
+    ofs_xml.close();
 
-        child.put("<xmlattr>.pair1", std::to_string(it.atm1 + 1)
-                                     + " " + std::to_string(it.xyz1 + 1));
-        child.put("<xmlattr>.pair2", std::to_string(it.atm2 + 1)
-                                     + " " + std::to_string(it.xyz2 + 1)
-                                     + " " + std::to_string(it.cell_s + 1));
+    if (!ofs_xml) {
+        cout << "Could not write " + xml_out << endl;
+        exit(EXIT_FAILURE);
     }
+}
 
-    using namespace boost::property_tree::xml_parser;
-    const int indent = 2;
 
-#if BOOST_VERSION >= 105600
-    write_xml(xml_out, pt, std::locale(),
-              xml_writer_make_settings<ptree::key_type>(' ', indent, widen<std::string>("utf-8")));
-#else
-    write_xml(xml_out, pt, std::locale(),
-              xml_writer_make_settings(' ', indent, widen<char>("utf-8")));
-#endif
+string xml_escape(const std::string &str)
+{
+    std::string rt;
+
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+        switch (*it) {
+            case '&':
+                rt += "&amp;";
+                break;
+            case '<':
+                rt += "&lt;";
+                break;
+            case '>':
+                rt += "&gt;";
+                break;
+            case '"':
+                rt += "&quot;";
+                break;
+            case '\'':
+                rt += "&apos;";
+                break;
+            default:
+                rt += *it;
+        }
+    }
+    return rt;
 }
 
 
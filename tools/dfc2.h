@@ -65,6 +65,8 @@ public:
     int fcs_index;
     std::vector<int> arr;
 
+    FcsTrans() {};
+
     FcsTrans(const std::vector<int> &arr_in, const int index_in)
     {
         std::copy(arr_in.begin(), arr_in.end(), std::back_inserter(arr));
@@ -114,6 +116,8 @@ void write_new_xml(const std::vector<FcsClassExtent>,
 
 std::string double2string(const double, const int nprec = 15);
 
+std::string xml_escape(const std::string &);
+
 
 unsigned int **map_p2s;
 Maps *map_s2p;
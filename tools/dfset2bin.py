@@ -0,0 +1,73 @@
+#!/usr/bin/env python
+#
+# dfset2bin.py
+#
+# Simple script to convert a plain-text DFSET file into the binary
+# variant understood by alm. The binary file loads much faster for
+# large training sets and can be generated once and reused.
+#
+# Copyright (c) 2014-2020 Terumasa Tadano
+#
+# This file is distributed under the terms of the MIT license.
+# Please see the file 'LICENCE.txt' in the root directory
+# or http://opensource.org/licenses/mit-license.php for information.
+#
+
+"""
+This python script converts a DFSET file generated by extract.py
+into a binary file that alm reads directly. The format is the
+8-byte magic 'ALMDFB01', the number of values as a little-endian
+64-bit integer, and the values as native doubles in the same order
+as the text file.
+"""
+
+from __future__ import print_function
+import argparse
+import struct
+
+parser = argparse.ArgumentParser()
+parser.add_argument('dfset',
+                    help="DFSET text file to convert")
+parser.add_argument('--output',
+                    default=None,
+                    help="name of the binary file to create "
+                         "(default: DFSET file name + '.bin')")
+
+
+def read_dfset_values(fname):
+    values = []
+    with open(fname, 'r') as f:
+        for line in f:
+            stripped = line.strip()
+            if not stripped or stripped.startswith('#'):
+                continue
+            for entry in stripped.split():
+                try:
+                    values.append(float(entry))
+                except ValueError:
+                    # alm discards the rest of the line when a token
+                    # is not a number; do the same here.
+                    break
+    return values
+
+
+def write_binary_dfset(fname, values):
+    with open(fname, 'wb') as f:
+        f.write(b'ALMDFB01')
+        f.write(struct.pack('<q', len(values)))
+        f.write(struct.pack('%dd' % len(values), *values))
+
+
+if __name__ == '__main__':
+
+    args = parser.parse_args()
+
+    file_out = args.output
+    if file_out is None:
+        file_out = args.dfset + '.bin'
+
+    values = read_dfset_values(args.dfset)
+    write_binary_dfset(file_out, values)
+
+    print("%i values written to %s" % (len(values), file_out))
+    print("Set DFSET = %s in the &optimize field to use it." % file_out)
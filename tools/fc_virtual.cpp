@@ -4,29 +4,66 @@
  Copyright (c) 2018 Terumasa Tadano
 
  This file is distributed under the terms of the MIT license.
- Please see the file 'LICENCE.txt' in the root directory 
+ Please see the file 'LICENCE.txt' in the root directory
  or http://opensource.org/licenses/mit-license.php for information.
 */
 
 #include "fc_virtual.h"
-#include "xml_parser.h"
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
-#include <map>
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/foreach.hpp>
-#include <boost/version.hpp>
-#include <boost/lexical_cast.hpp>
+#include <iomanip>
+#include <sstream>
 #include "memory.h"
 
 using namespace std;
 
+namespace {
+// Split a comma-separated list of mixing fractions. A plain number is a
+// batch of one, which keeps the original command line working unchanged.
+void parse_alpha_list(const std::string &str_alpha,
+                      std::vector<std::string> &alpha_str,
+                      std::vector<double> &alpha_val)
+{
+    std::stringstream ss(str_alpha);
+    std::string token;
+
+    alpha_str.clear();
+    alpha_val.clear();
+
+    while (std::getline(ss, token, ',')) {
+        const auto first = token.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        const auto last = token.find_last_not_of(" \t");
+        token = token.substr(first, last - first + 1);
+
+        char *p_end;
+        const auto alpha = strtod(token.c_str(), &p_end);
+
+        if (p_end == token.c_str() || *p_end != '\0') {
+            std::cout << "Invalid mixing alpha: " << token << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (alpha < 0.0 || alpha > 1.0) {
+            std::cout << "alpha must be 0 <= alpha <= 1" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        alpha_str.push_back(token);
+        alpha_val.push_back(alpha);
+    }
+
+    if (alpha_val.empty()) {
+        std::cout << "No mixing alpha given." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+}
+
 int main(int argc, char *argv[])
 {
     std::string file_xml1, file_xml2;
-    double alpha = 1.0;
+    std::string str_alpha;
     int maxorder;
 
     if (argc == 1) {
@@ -35,8 +72,8 @@ int main(int argc, char *argv[])
         cin >> file_xml1;
         cout << " Second FCSXML file (B) :  ";
         cin >> file_xml2;
-        cout << " Mixing alpha [alpha * A + (1 - alpha) * B] : ";
-        cin >> alpha;
+        cout << " Mixing alpha [alpha * A + (1 - alpha) * B], comma-separated for a batch : ";
+        cin >> str_alpha;
         cout << " Maxorder (2: harmonic, 3: cubic, 4: quartic, ...) : ";
         cin >> maxorder;
 
@@ -44,21 +81,22 @@ int main(int argc, char *argv[])
 
         file_xml1 = argv[1];
         file_xml2 = argv[2];
-        alpha = boost::lexical_cast<double>(argv[3]);
-        maxorder = boost::lexical_cast<int>(argv[4]);
+        str_alpha = argv[3];
+        maxorder = atoi(argv[4]);
 
     } else {
         std::cout << "Usage: " << std::endl;
-        std::cout << "(command line) > fc_virtual FCSXML1 FCSXML2 mixalpha maxorder " << std::endl;
+        std::cout << "(command line) > fc_virtual FCSXML1 FCSXML2 mixalpha[,mixalpha2,...] maxorder " << std::endl;
         std::cout << "(interactive) > fc_virtual " << std::endl;
         std::cout << std::endl;
-    }
-
-    if (alpha < 0.0 || alpha > 1.0) {
-        std::cout << "alpha must be 0 <= alpha <= 1" << std::endl;
         exit(EXIT_FAILURE);
     }
 
+    std::vector<std::string> alpha_str;
+    std::vector<double> alpha_val;
+
+    parse_alpha_list(str_alpha, alpha_str, alpha_val);
+
     if (maxorder <= 1) {
         std::cout << "Maxorder should be larger than 1. " << std::endl;
         exit(EXIT_FAILURE);
@@ -66,217 +104,71 @@ int main(int argc, char *argv[])
 
     maxorder = maxorder - 1;
 
-    std::vector<FcsArrayWithCell> *fc_orig1, *fc_orig2, *fc_new;
-    StructureProperty structure1, structure2, structure_new;
+    // Both inputs are parsed exactly once; every requested fraction is then
+    // produced from the merged table, so a batch over many alphas costs one
+    // extra sort-free pass per output instead of a re-parse.
+
+    std::vector<FcsArrayWithCell> *fc_orig1, *fc_orig2;
+    std::vector<MixedFcs> *fc_merged;
+    StructureProperty structure1, structure2;
 
     allocate(fc_orig1, maxorder);
     allocate(fc_orig2, maxorder);
-    allocate(fc_new, maxorder);
+    allocate(fc_merged, maxorder);
 
     load_fcs_xml(file_xml1, maxorder, structure1, fc_orig1);
     load_fcs_xml(file_xml2, maxorder, structure2, fc_orig2);
 
-    mix_structure(structure1, structure2, structure_new, alpha);
-    mix_forceconstant(fc_orig1, fc_orig2, fc_new, alpha, maxorder);
+    check_structures(structure1, structure2);
+
+    merge_forceconstant(fc_orig1, fc_orig2, fc_merged, maxorder);
 
     deallocate(fc_orig1);
     deallocate(fc_orig2);
 
-    write_new_xml("VCA.xml", file_xml1, file_xml2, maxorder, alpha, structure_new, fc_new);
-
-    std::cout << std::endl;
-    std::cout << " A new FCSXML is generated as VCA.xml." << std::endl;
-
-    deallocate(fc_new);
-}
-
-
-void load_fcs_xml(const std::string file_in,
-                  const int maxorder,
-                  StructureProperty &StructProp,
-                  std::vector<FcsArrayWithCell> *force_constant_with_cell)
-{
-    using namespace boost::property_tree;
-    ptree pt;
-    map<string, int> dict_atomic_kind;
-    std::stringstream ss;
+    const auto nalpha = static_cast<int>(alpha_val.size());
+    std::vector<std::string> file_out(nalpha);
 
-    try {
-        read_xml(file_in, pt);
-    }
-    catch (exception &e) {
-        cout << "Cannot open file " + file_in << endl;
-        exit(EXIT_FAILURE);
-    }
-
-    StructProp.nat = boost::lexical_cast<unsigned int>(
-            get_value_from_xml(pt,
-                               "Data.Structure.NumberOfAtoms"));
-    StructProp.nspecies = boost::lexical_cast<unsigned int>(
-            get_value_from_xml(pt,
-                               "Data.Structure.NumberOfElements"));
-
-    StructProp.ntran = boost::lexical_cast<unsigned int>(
-            get_value_from_xml(pt,
-                               "Data.Symmetry.NumberOfTranslations"));
-
-
-    for (auto i = 0; i < 3; ++i) {
-        ss.str("");
-        ss.clear();
-        ss << get_value_from_xml(pt,
-                                 "Data.Structure.LatticeVector.a"
-                                 + boost::lexical_cast<string>(i + 1));
-        ss >> StructProp.lattice_vector[0][i]
-           >> StructProp.lattice_vector[1][i]
-           >> StructProp.lattice_vector[2][i];
-    }
-
-    ss.str("");
-    ss.clear();
-    ss << get_value_from_xml(pt, "Data.Structure.Periodicity");
-    ss >> StructProp.is_periodic[0]
-       >> StructProp.is_periodic[1]
-       >> StructProp.is_periodic[2];
-
-    // Parse atomic elements and coordinates
-
-    StructProp.kd_symbol.resize(StructProp.nspecies);
-    StructProp.atoms.resize(StructProp.nat);
-
-    int i = 0;
-
-    BOOST_FOREACH(
-            const ptree::value_type &child_, pt.get_child("Data.Structure.AtomicElements")) {
-                    const ptree &child = child_.second;
-                    const unsigned int icount_kd = child.get<unsigned int>("<xmlattr>.number");
-                    dict_atomic_kind[boost::lexical_cast<string>(child_.second.data())] = icount_kd - 1;
-                    StructProp.kd_symbol[i++] = boost::lexical_cast<string>(child_.second.data());
-                }
-
-    unsigned int index;
-
-    BOOST_FOREACH(
-            const ptree::value_type &child_, pt.get_child("Data.Structure.Position")) {
-                    const ptree &child = child_.second;
-                    const string str_index = child.get<string>("<xmlattr>.index");
-                    const string str_element = child.get<string>("<xmlattr>.element");
-
-                    ss.str("");
-                    ss.clear();
-                    ss << child.data();
-
-                    index = boost::lexical_cast<unsigned int>(str_index) - 1;
-
-                    if (index >= StructProp.nat) {
-                        cout << "index is out of range" << endl;
-                        exit(EXIT_FAILURE);
-                    }
-
-                    StructProp.atoms[index].kind = dict_atomic_kind[str_element];
-                    ss >> StructProp.atoms[index].x
-                       >> StructProp.atoms[index].y
-                       >> StructProp.atoms[index].z;
-                }
-
-    dict_atomic_kind.clear();
-
-    // Parse mapping information
-
-    StructProp.natmin = StructProp.nat / StructProp.ntran;
-
-    unsigned int tran, atom_p, atom_s;
-
-    BOOST_FOREACH(
-            const ptree::value_type &child_, pt.get_child("Data.Symmetry.Translations")) {
-                    const ptree &child = child_.second;
-                    const string str_tran = child.get<string>("<xmlattr>.tran");
-                    const string str_atom = child.get<string>("<xmlattr>.atom");
-
-                    tran = boost::lexical_cast<unsigned int>(str_tran) - 1;
-                    atom_p = boost::lexical_cast<unsigned int>(str_atom) - 1;
-                    atom_s = boost::lexical_cast<unsigned int>(child.data()) - 1;
-
-                    if (tran >= StructProp.ntran || atom_p >= StructProp.natmin || atom_s >= StructProp.nat) {
-                        cout << "index is out of range" << endl;
-                        exit(EXIT_FAILURE);
-                    }
-
-                    StructProp.atoms[atom_s].atom = atom_p;
-                    StructProp.atoms[atom_s].tran = tran;
-                }
-
-    // Parse force constants
-
-    std::vector<AtomCellSuper> ivec_with_cell;
-    std::string str_tag;
-    double fcs_val;
-    unsigned int atmn, xyz, cell_s;
-    std::string str_pairs;
-    std::string str_attr;
-    AtomCellSuper ivec_tmp;
-
-    for (auto order = 0; order < maxorder; ++order) {
-
-        if (order == 0) {
-            str_tag = "Data.ForceConstants.HARMONIC";
+    for (auto ia = 0; ia < nalpha; ++ia) {
+        if (nalpha == 1) {
+            file_out[ia] = "VCA.xml";
         } else {
-            str_tag = "Data.ForceConstants.ANHARM" + std::to_string(order + 2);
+            file_out[ia] = "VCA-" + alpha_str[ia] + ".xml";
         }
+    }
 
-        boost::optional<ptree &> child_ = pt.get_child_optional(str_tag);
-
-        if (!child_) {
-            std::string str_tmp = str_tag + " flag not found in the XML file";
-            exit(EXIT_FAILURE);
-        }
-
-        BOOST_FOREACH(
-                const ptree::value_type &child_, pt.get_child(str_tag)) {
-                        const ptree &child = child_.second;
-
-                        fcs_val = boost::lexical_cast<double>(child.data());
-
-                        ivec_with_cell.clear();
-
-                        for (i = 0; i < order + 2; ++i) {
-                            str_attr = "<xmlattr>.pair" + std::to_string(i + 1);
-                            str_pairs = child.get<std::string>(str_attr);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (auto ia = 0; ia < nalpha; ++ia) {
 
-                            ss.str("");
-                            ss.clear();
-                            ss << str_pairs;
+        StructureProperty structure_new;
+        std::vector<FcsArrayWithCell> *fc_new;
 
-                            if (i == 0) {
-                                ss >> atmn >> xyz;
-                                ivec_tmp.index = 3 * (atmn - 1) + xyz - 1;
-                                ivec_tmp.cell_s = 0;
-                                ivec_tmp.tran = 0; // dummy
-                                ivec_with_cell.push_back(ivec_tmp);
+        allocate(fc_new, maxorder);
 
-                            } else {
-                                ss >> atmn >> xyz >> cell_s;
-                                ivec_tmp.index = 3 * (atmn - 1) + xyz - 1;
-                                ivec_tmp.cell_s = cell_s - 1;
-                                ivec_tmp.tran = 0; // dummy
-                                ivec_with_cell.push_back(ivec_tmp);
-                            }
-                        }
+        mix_structure(structure1, structure2, structure_new, alpha_val[ia]);
+        mix_forceconstant(fc_merged, fc_new, alpha_val[ia], maxorder);
 
-                        force_constant_with_cell[order].emplace_back(fcs_val, ivec_with_cell);
+        write_new_xml(file_out[ia], file_xml1, file_xml2,
+                      maxorder, alpha_val[ia], structure_new, fc_new);
 
-                    }
+        deallocate(fc_new);
+    }
 
+    std::cout << std::endl;
+    for (auto ia = 0; ia < nalpha; ++ia) {
+        std::cout << " A new FCSXML is generated as " << file_out[ia] << "." << std::endl;
     }
 
+    deallocate(fc_merged);
 }
 
-void mix_structure(const StructureProperty &Structure1,
-                   const StructureProperty &Structure2,
-                   StructureProperty &Structure_out,
-                   const double alpha)
+
+void check_structures(const StructureProperty &Structure1,
+                      const StructureProperty &Structure2)
 {
-    // First, check the consistency of the two structures.
+    // Check the consistency of the two structures.
 
     if (Structure1.nat != Structure2.nat ||
         Structure1.nspecies != Structure2.nspecies ||
@@ -309,7 +201,13 @@ void mix_structure(const StructureProperty &Structure1,
             exit(EXIT_FAILURE);
         }
     }
+}
 
+void mix_structure(const StructureProperty &Structure1,
+                   const StructureProperty &Structure2,
+                   StructureProperty &Structure_out,
+                   const double alpha)
+{
     // Copy common variables
 
     Structure_out.nat = Structure1.nat;
@@ -351,41 +249,64 @@ void mix_structure(const StructureProperty &Structure1,
 }
 
 
-void mix_forceconstant(std::vector<FcsArrayWithCell> *fc_orig1,
-                       std::vector<FcsArrayWithCell> *fc_orig2,
-                       std::vector<FcsArrayWithCell> *fc_new,
-                       const double alpha, const int maxorder)
+void merge_forceconstant(const std::vector<FcsArrayWithCell> *fc_orig1,
+                         const std::vector<FcsArrayWithCell> *fc_orig2,
+                         std::vector<MixedFcs> *fc_merged,
+                         const int maxorder)
 {
-    // Mix force constants with the given mixing fraction "alpha"
+    // Match the force constants of the two inputs by their pair keys.
+    // This is the expensive part of the mixing (sort over both sets) and
+    // is independent of alpha, so it is done once for all fractions.
 
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
     for (auto order = 0; order < maxorder; ++order) {
 
-        std::vector<FcsArrayWithCell> fc_tmp;
+        std::vector<MixedFcs> fc_tmp;
+        fc_tmp.reserve(fc_orig1[order].size() + fc_orig2[order].size());
 
         for (const auto &it: fc_orig1[order]) {
-            fc_tmp.emplace_back(alpha * it.fcs_val, it.pairs);
+            fc_tmp.emplace_back(it.pairs, it.fcs_val, 0.0);
         }
 
         for (const auto &it: fc_orig2[order]) {
-            fc_tmp.emplace_back((1.0 - alpha) * it.fcs_val, it.pairs);
+            fc_tmp.emplace_back(it.pairs, 0.0, it.fcs_val);
         }
 
         std::sort(fc_tmp.begin(), fc_tmp.end());
 
-        FcsArrayWithCell fc_now = fc_tmp[0];
-        double fcs_val = fc_now.fcs_val;
+        MixedFcs fc_now = fc_tmp[0];
 
         for (auto i = 1; i < fc_tmp.size(); ++i) {
             if (fc_tmp[i] == fc_now) {
-                fcs_val += fc_tmp[i].fcs_val;
+                fc_now.val1 += fc_tmp[i].val1;
+                fc_now.val2 += fc_tmp[i].val2;
             } else {
-                fc_new[order].emplace_back(fcs_val, fc_now.pairs);
+                fc_merged[order].push_back(fc_now);
                 fc_now = fc_tmp[i];
-                fcs_val = fc_now.fcs_val;
             }
         }
 
-        fc_new[order].emplace_back(fcs_val, fc_now.pairs);
+        fc_merged[order].push_back(fc_now);
+    }
+}
+
+
+void mix_forceconstant(const std::vector<MixedFcs> *fc_merged,
+                       std::vector<FcsArrayWithCell> *fc_new,
+                       const double alpha, const int maxorder)
+{
+    // Mix force constants with the given mixing fraction "alpha"
+
+    for (auto order = 0; order < maxorder; ++order) {
+
+        fc_new[order].reserve(fc_merged[order].size());
+
+        for (const auto &it: fc_merged[order]) {
+            fc_new[order].emplace_back(alpha * it.val1 + (1.0 - alpha) * it.val2,
+                                       it.pairs);
+        }
     }
 }
 
@@ -397,52 +318,70 @@ void write_new_xml(const std::string file_xml,
                    const StructureProperty &structure,
                    std::vector<FcsArrayWithCell> *fcs)
 {
+    // Write to XML file
+    //
+    // The XML is streamed straight to the output file instead of being
+    // assembled in a property tree first, so a batch run over many mixing
+    // fractions is bounded by disk speed rather than tree construction.
+
     int i, j, k;
-    using boost::property_tree::ptree;
-    ptree pt;
 
-    pt.put("Data.VCA.Original1", file_xml1);
-    pt.put("Data.VCA.Original2", file_xml2);
-    pt.put("Data.VCA.Mixalpha", alpha);
-    pt.put("Data.Structure.NumberOfAtoms", structure.nat);
-    pt.put("Data.Structure.NumberOfElements", structure.nspecies);
+    ofstream ofs_xml(file_xml.c_str(), std::ios::out);
+
+    if (!ofs_xml) {
+        cout << "Could not open " + file_xml << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<char> obuf(1048576);
+    ofs_xml.rdbuf()->pubsetbuf(&obuf[0], obuf.size());
+
+    std::stringstream ss_alpha;
+    ss_alpha << std::setprecision(17) << alpha;
+
+    ofs_xml << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+    ofs_xml << "<Data>\n";
+    ofs_xml << "  <VCA>\n";
+    ofs_xml << "    <Original1>" << xml_escape(file_xml1) << "</Original1>\n";
+    ofs_xml << "    <Original2>" << xml_escape(file_xml2) << "</Original2>\n";
+    ofs_xml << "    <Mixalpha>" << ss_alpha.str() << "</Mixalpha>\n";
+    ofs_xml << "  </VCA>\n";
+    ofs_xml << "  <Structure>\n";
+    ofs_xml << "    <NumberOfAtoms>" << structure.nat << "</NumberOfAtoms>\n";
+    ofs_xml << "    <NumberOfElements>" << structure.nspecies << "</NumberOfElements>\n";
+    ofs_xml << "    <AtomicElements>\n";
 
     for (i = 0; i < structure.nspecies; ++i) {
-        ptree &child = pt.add("Data.Structure.AtomicElements.element",
-                              structure.kd_symbol[i]);
-        child.put("<xmlattr>.number", i + 1);
+        ofs_xml << "      <element number=\"" << i + 1 << "\">"
+                << xml_escape(structure.kd_symbol[i]) << "</element>\n";
     }
+    ofs_xml << "    </AtomicElements>\n";
 
-    std::string str_pos[3];
+    ofs_xml << "    <LatticeVector>\n";
     for (i = 0; i < 3; ++i) {
-        str_pos[i].clear();
+        ofs_xml << "      <a" << i + 1 << ">";
         for (j = 0; j < 3; ++j) {
-            str_pos[i] += " " + double2string(structure.lattice_vector[j][i]);
+            ofs_xml << " " << double2string(structure.lattice_vector[j][i]);
         }
+        ofs_xml << "</a" << i + 1 << ">\n";
     }
-    pt.put("Data.Structure.LatticeVector", "");
-    pt.put("Data.Structure.LatticeVector.a1", str_pos[0]);
-    pt.put("Data.Structure.LatticeVector.a2", str_pos[1]);
-    pt.put("Data.Structure.LatticeVector.a3", str_pos[2]);
-
-    std::stringstream ss;
-    ss << structure.is_periodic[0] << " "
-       << structure.is_periodic[1] << " "
-       << structure.is_periodic[2];
-    pt.put("Data.Structure.Periodicity", ss.str());
+    ofs_xml << "    </LatticeVector>\n";
 
-    pt.put("Data.Structure.Position", "");
-    std::string str_tmp;
+    ofs_xml << "    <Periodicity>" << structure.is_periodic[0] << " "
+            << structure.is_periodic[1] << " "
+            << structure.is_periodic[2] << "</Periodicity>\n";
 
+    ofs_xml << "    <Position>\n";
     for (i = 0; i < structure.nat; ++i) {
-        str_tmp.clear();
-        str_tmp = " " + double2string(structure.atoms[i].x)
-                  + " " + double2string(structure.atoms[i].y)
-                  + " " + double2string(structure.atoms[i].z);
-        ptree &child = pt.add("Data.Structure.Position.pos", str_tmp);
-        child.put("<xmlattr>.index", i + 1);
-        child.put("<xmlattr>.element", structure.kd_symbol[structure.atoms[i].kind]);
+        ofs_xml << "      <pos index=\"" << i + 1
+                << "\" element=\"" << xml_escape(structure.kd_symbol[structure.atoms[i].kind]) << "\">"
+                << " " << double2string(structure.atoms[i].x)
+                << " " << double2string(structure.atoms[i].y)
+                << " " << double2string(structure.atoms[i].z)
+                << "</pos>\n";
     }
+    ofs_xml << "    </Position>\n";
+    ofs_xml << "  </Structure>\n";
 
     int **map_p2s;
     allocate(map_p2s, structure.natmin, structure.ntran);
@@ -450,55 +389,63 @@ void write_new_xml(const std::string file_xml,
         map_p2s[structure.atoms[i].atom][structure.atoms[i].tran] = i;
     }
 
-    pt.put("Data.Symmetry.NumberOfTranslations", structure.ntran);
+    ofs_xml << "  <Symmetry>\n";
+    ofs_xml << "    <NumberOfTranslations>" << structure.ntran << "</NumberOfTranslations>\n";
+    ofs_xml << "    <Translations>\n";
     for (i = 0; i < structure.ntran; ++i) {
         for (j = 0; j < structure.natmin; ++j) {
-            ptree &child = pt.add("Data.Symmetry.Translations.map",
-                                  map_p2s[j][i] + 1);
-            child.put("<xmlattr>.tran", i + 1);
-            child.put("<xmlattr>.atom", j + 1);
+            ofs_xml << "      <map tran=\"" << i + 1 << "\" atom=\"" << j + 1 << "\">"
+                    << map_p2s[j][i] + 1 << "</map>\n";
         }
     }
+    ofs_xml << "    </Translations>\n";
+    ofs_xml << "  </Symmetry>\n";
     deallocate(map_p2s);
 
-    std::string elementname;
+    ofs_xml << "  <ForceConstants>\n";
 
     for (auto order = 0; order < maxorder; ++order) {
 
+        std::string section, entry;
+
         if (order == 0) {
-            elementname = "Data.ForceConstants.HARMONIC.FC2";
+            section = "HARMONIC";
+            entry = "FC2";
         } else {
-            elementname = "Data.ForceConstants.ANHARM" + std::to_string(order + 2)
-                          + ".FC" + std::to_string(order + 2);
+            section = "ANHARM" + std::to_string(order + 2);
+            entry = "FC" + std::to_string(order + 2);
         }
 
+        ofs_xml << "    <" << section << ">\n";
+
         for (const auto &it: fcs[order]) {
 
-            ptree &child = pt.add(elementname, double2string(it.fcs_val));
-            child.put("<xmlattr>.pair1", std::to_string(it.pairs[0].index / 3 + 1)
-                                         + " " + std::to_string(it.pairs[0].index % 3 + 1));
+            ofs_xml << "      <" << entry
+                    << " pair1=\"" << it.pairs[0].index / 3 + 1
+                    << " " << it.pairs[0].index % 3 + 1 << "\"";
 
             for (k = 1; k < order + 2; ++k) {
-                child.put("<xmlattr>.pair" + std::to_string(k + 1),
-                          std::to_string(it.pairs[k].index / 3 + 1)
-                          + " " + std::to_string(it.pairs[k].index % 3 + 1)
-                          + " " + std::to_string(it.pairs[k].cell_s + 1));
+                ofs_xml << " pair" << k + 1 << "=\""
+                        << it.pairs[k].index / 3 + 1
+                        << " " << it.pairs[k].index % 3 + 1
+                        << " " << it.pairs[k].cell_s + 1 << "\"";
             }
+
+            ofs_xml << ">" << double2string(it.fcs_val) << "</" << entry << ">\n";
         }
 
+        ofs_xml << "    </" << section << ">\n";
     }
 
-    using namespace boost::property_tree::xml_parser;
-    const int indent = 2;
+    ofs_xml << "  </ForceConstants>\n";
+    ofs_xml << "</Data>\n";
 
-#if BOOST_VERSION >= 105600
-    write_xml(file_xml, pt, std::locale(),
-              xml_writer_make_settings<ptree::key_type>(' ', indent,
-                                                        widen<std::string>("utf-8")));
-#else
-    write_xml(file_xml, pt, std::locale(),
-              xml_writer_make_settings(' ', indent, widen<char>("utf-8")));
-#endif
+    ofs_xml.close();
+
+    if (!ofs_xml) {
+        cout << "Could not write " + file_xml << endl;
+        exit(EXIT_FAILURE);
+    }
 }
 
 
@@ -510,4 +457,33 @@ std::string double2string(const double d, const int nprec)
     ss << std::scientific << std::setprecision(nprec) << d;
     ss >> rt;
     return rt;
-}
\ No newline at end of file
+}
+
+
+std::string xml_escape(const std::string &str)
+{
+    std::string rt;
+
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+        switch (*it) {
+            case '&':
+                rt += "&amp;";
+                break;
+            case '<':
+                rt += "&lt;";
+                break;
+            case '>':
+                rt += "&gt;";
+                break;
+            case '"':
+                rt += "&quot;";
+                break;
+            case '\'':
+                rt += "&apos;";
+                break;
+            default:
+                rt += *it;
+        }
+    }
+    return rt;
+}
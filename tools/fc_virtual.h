@@ -10,80 +10,32 @@
 
 #pragma once
 
-#include <fstream>
-#include <iostream>
-#include <string>
+#include "fcsxml.h"
 #include <algorithm>
+#include <string>
 #include <vector>
 
-class AtomProperty {
-public:
-    double x, y, z;
-    int kind;
-    int atom, tran;
-
-    AtomProperty() {};
-
-    AtomProperty(const AtomProperty &other)
-            : x(other.x), y(other.y), z(other.z),
-              kind(other.kind), atom(other.atom), tran(other.tran) {};
-
-    AtomProperty(const double *pos,
-                 const int kind_in,
-                 const int atom_in,
-                 const int tran_in)
-    {
-        x = pos[0];
-        y = pos[1];
-        z = pos[2];
-        kind = kind_in;
-        atom = atom_in;
-        tran = tran_in;
-    }
-};
-
-class StructureProperty {
-public:
-    double lattice_vector[3][3];
-    std::vector<AtomProperty> atoms;
-    int nat, natmin, ntran;
-    int nspecies;
-    int is_periodic[3];
-    std::vector<std::string> kd_symbol;
-
-    StructureProperty() {};
-};
-
-struct AtomCellSuper {
-    unsigned int index;
-    unsigned int tran;
-    unsigned int cell_s;
-};
-
-inline bool operator<(const AtomCellSuper &a,
-                      const AtomCellSuper &b)
-{
-    return a.index < b.index;
-}
-
-class FcsArrayWithCell {
+// One merged force constant of the two inputs: the pair key together with
+// the summed contribution of each endpoint. The mix at any fraction alpha
+// is alpha * val1 + (1 - alpha) * val2, so the expensive key matching is
+// done once and shared by all requested fractions.
+class MixedFcs {
 public:
     std::vector<AtomCellSuper> pairs;
-    double fcs_val;
+    double val1, val2;
 
-    FcsArrayWithCell() {};
+    MixedFcs() {};
 
-    FcsArrayWithCell(const double fcs_in,
-                     const std::vector<AtomCellSuper> &pairs_in)
-            : pairs(pairs_in), fcs_val(fcs_in) {};
+    MixedFcs(const std::vector<AtomCellSuper> &pairs_in,
+             const double val1_in,
+             const double val2_in)
+            : pairs(pairs_in), val1(val1_in), val2(val2_in) {};
 
-    bool operator==(const FcsArrayWithCell &obj) const
+    bool operator==(const MixedFcs &obj) const
     {
         if (pairs.size() != obj.pairs.size()) return false;
 
         std::vector<unsigned int> index_a, index_b;
-        index_a.clear();
-        index_b.clear();
         for (int i = 0; i < pairs.size(); ++i) {
             index_a.push_back(pairs[i].index);
             index_b.push_back(obj.pairs[i].index);
@@ -97,13 +49,11 @@ public:
         return index_a == index_b;
     }
 
-    bool operator<(const FcsArrayWithCell &obj) const
+    bool operator<(const MixedFcs &obj) const
     {
         if (pairs.size() != obj.pairs.size()) return pairs.size() < obj.pairs.size();
 
         std::vector<unsigned int> index_a, index_b;
-        index_a.clear();
-        index_b.clear();
         for (int i = 0; i < pairs.size(); ++i) {
             index_a.push_back(pairs[i].index);
             index_b.push_back(obj.pairs[i].index);
@@ -119,23 +69,27 @@ public:
     }
 };
 
-void load_fcs_xml(const std::string, const int,
-                  StructureProperty &,
-                  std::vector<FcsArrayWithCell> *);
-
 void write_new_xml(const std::string, const std::string, const std::string,
                    const int, const double,
                    const StructureProperty &,
                    std::vector<FcsArrayWithCell> *);
 
+void check_structures(const StructureProperty &,
+                      const StructureProperty &);
+
 void mix_structure(const StructureProperty &,
                    const StructureProperty &,
                    StructureProperty &, const double);
 
-void mix_forceconstant(std::vector<FcsArrayWithCell> *,
-                       std::vector<FcsArrayWithCell> *,
+void merge_forceconstant(const std::vector<FcsArrayWithCell> *,
+                         const std::vector<FcsArrayWithCell> *,
+                         std::vector<MixedFcs> *,
+                         const int);
+
+void mix_forceconstant(const std::vector<MixedFcs> *,
                        std::vector<FcsArrayWithCell> *,
                        const double, const int);
 
 std::string double2string(const double, const int nprec = 15);
 
+std::string xml_escape(const std::string &);
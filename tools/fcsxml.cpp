@@ -0,0 +1,258 @@
+/*
+ fcsxml.cpp
+
+ Copyright (c) 2021 Terumasa Tadano
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#include "fcsxml.h"
+#include "../include/xml_stream_parser.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+// Text content of the first <name>...</name> element, or an empty string
+// when the element is absent.
+string find_element_text(const string &buf,
+                         const string &name)
+{
+    const auto open_tag = "<" + name + ">";
+    auto loc = buf.find(open_tag);
+    if (loc == string::npos) return "";
+    loc += open_tag.length();
+    const auto end = buf.find('<', loc);
+    if (end == string::npos) return "";
+    return buf.substr(loc, end - loc);
+}
+
+// Value of a double-quoted attribute inside a tag string, or an empty
+// string when the attribute is absent.
+string find_attribute(const string &tag,
+                      const string &name)
+{
+    const auto key = name + "=\"";
+    const auto loc = tag.find(key);
+    if (loc == string::npos) return "";
+    const auto vbegin = loc + key.length();
+    const auto vend = tag.find('"', vbegin);
+    if (vend == string::npos) return "";
+    return tag.substr(vbegin, vend - vbegin);
+}
+
+string trim_copy(const string &str)
+{
+    const auto first = str.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    const auto last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+}
+
+bool FcsXml::open(const std::string &file_in)
+{
+    file_opened = false;
+    filename = file_in;
+
+    // The structure header always precedes the force-constant sections, so
+    // only the prefix of the file up to <ForceConstants is read.
+
+    ifstream ifs(file_in.c_str(), ios::in | ios::binary);
+    if (!ifs) return false;
+
+    const size_t chunksize = 65536;
+    vector<char> chunk(chunksize);
+    string header;
+
+    while (header.find("<ForceConstants") == string::npos) {
+        ifs.read(&chunk[0], chunksize);
+        const auto nread = ifs.gcount();
+        if (nread <= 0) break;
+        header.append(&chunk[0], static_cast<size_t>(nread));
+    }
+
+    file_opened = parse_structure(header);
+    return file_opened;
+}
+
+bool FcsXml::parse_structure(const std::string &header)
+{
+    structure.nat = atoi(find_element_text(header, "NumberOfAtoms").c_str());
+    structure.nspecies = atoi(find_element_text(header, "NumberOfElements").c_str());
+    structure.ntran = atoi(find_element_text(header, "NumberOfTranslations").c_str());
+
+    if (structure.nat <= 0 || structure.nspecies <= 0 || structure.ntran <= 0) return false;
+
+    structure.natmin = structure.nat / structure.ntran;
+
+    for (auto i = 0; i < 3; ++i) {
+        stringstream ss(find_element_text(header, "a" + to_string(i + 1)));
+        ss >> structure.lattice_vector[0][i]
+           >> structure.lattice_vector[1][i]
+           >> structure.lattice_vector[2][i];
+        if (ss.fail()) return false;
+    }
+
+    {
+        stringstream ss(find_element_text(header, "Periodicity"));
+        ss >> structure.is_periodic[0]
+           >> structure.is_periodic[1]
+           >> structure.is_periodic[2];
+        if (ss.fail()) {
+            for (auto i = 0; i < 3; ++i) structure.is_periodic[i] = 1;
+        }
+    }
+
+    structure.kd_symbol.resize(structure.nspecies);
+    structure.atoms.resize(structure.nat);
+
+    map<string, int> dict_atomic_kind;
+
+    size_t pos = 0;
+
+    while ((pos = header.find("<element ", pos)) != string::npos) {
+        const auto gt = header.find('>', pos);
+        if (gt == string::npos) return false;
+        const auto tag = header.substr(pos + 1, gt - pos - 1);
+        const auto end = header.find('<', gt + 1);
+        if (end == string::npos) return false;
+
+        const auto number = atoi(find_attribute(tag, "number").c_str());
+        if (number < 1 || number > structure.nspecies) return false;
+
+        const auto symbol = trim_copy(header.substr(gt + 1, end - gt - 1));
+        dict_atomic_kind[symbol] = number - 1;
+        structure.kd_symbol[number - 1] = symbol;
+
+        pos = end;
+    }
+
+    pos = 0;
+
+    while ((pos = header.find("<pos ", pos)) != string::npos) {
+        const auto gt = header.find('>', pos);
+        if (gt == string::npos) return false;
+        const auto tag = header.substr(pos + 1, gt - pos - 1);
+        const auto end = header.find('<', gt + 1);
+        if (end == string::npos) return false;
+
+        const auto index = atoi(find_attribute(tag, "index").c_str()) - 1;
+        if (index < 0 || index >= structure.nat) return false;
+
+        structure.atoms[index].kind = dict_atomic_kind[find_attribute(tag, "element")];
+
+        stringstream ss(header.substr(gt + 1, end - gt - 1));
+        ss >> structure.atoms[index].x
+           >> structure.atoms[index].y
+           >> structure.atoms[index].z;
+        if (ss.fail()) return false;
+
+        pos = end;
+    }
+
+    pos = 0;
+
+    while ((pos = header.find("<map ", pos)) != string::npos) {
+        const auto gt = header.find('>', pos);
+        if (gt == string::npos) return false;
+        const auto tag = header.substr(pos + 1, gt - pos - 1);
+        const auto end = header.find('<', gt + 1);
+        if (end == string::npos) return false;
+
+        const auto tran = atoi(find_attribute(tag, "tran").c_str()) - 1;
+        const auto atom_p = atoi(find_attribute(tag, "atom").c_str()) - 1;
+        const auto atom_s = atoi(header.substr(gt + 1, end - gt - 1).c_str()) - 1;
+
+        if (tran < 0 || tran >= structure.ntran
+            || atom_p < 0 || atom_p >= structure.natmin
+            || atom_s < 0 || atom_s >= structure.nat)
+            return false;
+
+        structure.atoms[atom_s].atom = atom_p;
+        structure.atoms[atom_s].tran = tran;
+
+        pos = end;
+    }
+
+    return true;
+}
+
+bool FcsXml::get_force_constants(const int order,
+                                 std::vector<FcsArrayWithCell> &fc_out) const
+{
+    fc_out.clear();
+
+    if (!file_opened || order < 0) return false;
+
+    std::string section;
+
+    if (order == 0) {
+        section = "HARMONIC";
+    } else {
+        section = "ANHARM" + std::to_string(order + 2);
+    }
+
+    std::vector<AtomCellSuper> ivec_with_cell;
+    AtomCellSuper ivec_tmp;
+
+    return stream_forceconstant_section(
+            filename, section,
+            [&ivec_with_cell, &ivec_tmp, &fc_out](const std::vector<std::string> &pairs,
+                                                  const double fcs_val) {
+                ivec_with_cell.clear();
+
+                for (size_t i = 0; i < pairs.size(); ++i) {
+                    const char *p = pairs[i].c_str();
+                    char *p_end;
+
+                    const auto atmn = strtol(p, &p_end, 10);
+                    const auto xyz = strtol(p_end, &p_end, 10);
+
+                    ivec_tmp.index = 3 * (atmn - 1) + xyz - 1;
+                    if (i == 0) {
+                        ivec_tmp.cell_s = 0;
+                    } else {
+                        ivec_tmp.cell_s = strtol(p_end, nullptr, 10) - 1;
+                    }
+                    ivec_tmp.tran = 0; // dummy
+                    ivec_with_cell.push_back(ivec_tmp);
+                }
+
+                fc_out.emplace_back(fcs_val, ivec_with_cell);
+            });
+}
+
+void load_fcs_xml(const std::string file_in,
+                  const int maxorder,
+                  StructureProperty &StructProp,
+                  std::vector<FcsArrayWithCell> *force_constant_with_cell)
+{
+    FcsXml parser(file_in);
+
+    if (!parser.is_open()) {
+        cout << "Cannot open file " + file_in << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    StructProp = parser.get_structure();
+
+    for (auto order = 0; order < maxorder; ++order) {
+        if (!parser.get_force_constants(order, force_constant_with_cell[order])) {
+            std::string str_tag;
+            if (order == 0) {
+                str_tag = "HARMONIC";
+            } else {
+                str_tag = "ANHARM" + std::to_string(order + 2);
+            }
+            cout << str_tag + " flag not found in the XML file" << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
@@ -0,0 +1,169 @@
+/*
+ fcsxml.h
+
+ Copyright (c) 2021 Terumasa Tadano
+
+ This file is distributed under the terms of the MIT license.
+ Please see the file 'LICENCE.txt' in the root directory
+ or http://opensource.org/licenses/mit-license.php for information.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+class AtomProperty {
+public:
+    double x, y, z;
+    int kind;
+    int atom, tran;
+
+    AtomProperty() {};
+
+    AtomProperty(const AtomProperty &other)
+            : x(other.x), y(other.y), z(other.z),
+              kind(other.kind), atom(other.atom), tran(other.tran) {};
+
+    AtomProperty(const double *pos,
+                 const int kind_in,
+                 const int atom_in,
+                 const int tran_in)
+    {
+        x = pos[0];
+        y = pos[1];
+        z = pos[2];
+        kind = kind_in;
+        atom = atom_in;
+        tran = tran_in;
+    }
+};
+
+class StructureProperty {
+public:
+    double lattice_vector[3][3];
+    std::vector<AtomProperty> atoms;
+    int nat, natmin, ntran;
+    int nspecies;
+    int is_periodic[3];
+    std::vector<std::string> kd_symbol;
+
+    StructureProperty() {};
+};
+
+struct AtomCellSuper {
+    unsigned int index;
+    unsigned int tran;
+    unsigned int cell_s;
+};
+
+inline bool operator<(const AtomCellSuper &a,
+                      const AtomCellSuper &b)
+{
+    return a.index < b.index;
+}
+
+class FcsArrayWithCell {
+public:
+    std::vector<AtomCellSuper> pairs;
+    double fcs_val;
+
+    FcsArrayWithCell() {};
+
+    FcsArrayWithCell(const double fcs_in,
+                     const std::vector<AtomCellSuper> &pairs_in)
+            : pairs(pairs_in), fcs_val(fcs_in) {};
+
+    bool operator==(const FcsArrayWithCell &obj) const
+    {
+        if (pairs.size() != obj.pairs.size()) return false;
+
+        std::vector<unsigned int> index_a, index_b;
+        index_a.clear();
+        index_b.clear();
+        for (int i = 0; i < pairs.size(); ++i) {
+            index_a.push_back(pairs[i].index);
+            index_b.push_back(obj.pairs[i].index);
+        }
+        for (int i = 0; i < pairs.size(); ++i) {
+            index_a.push_back(pairs[i].tran);
+            index_a.push_back(pairs[i].cell_s);
+            index_b.push_back(obj.pairs[i].tran);
+            index_b.push_back(obj.pairs[i].cell_s);
+        }
+        return index_a == index_b;
+    }
+
+    bool operator<(const FcsArrayWithCell &obj) const
+    {
+        if (pairs.size() != obj.pairs.size()) return pairs.size() < obj.pairs.size();
+
+        std::vector<unsigned int> index_a, index_b;
+        index_a.clear();
+        index_b.clear();
+        for (int i = 0; i < pairs.size(); ++i) {
+            index_a.push_back(pairs[i].index);
+            index_b.push_back(obj.pairs[i].index);
+        }
+        for (int i = 0; i < pairs.size(); ++i) {
+            index_a.push_back(pairs[i].tran);
+            index_a.push_back(pairs[i].cell_s);
+            index_b.push_back(obj.pairs[i].tran);
+            index_b.push_back(obj.pairs[i].cell_s);
+        }
+        return std::lexicographical_compare(index_a.begin(), index_a.end(),
+                                            index_b.begin(), index_b.end());
+    }
+};
+
+// Reader for ALAMODE FCSXML files with lazy per-order loading. open()
+// parses only the structure header, which always precedes the
+// force-constant sections; the force constants of each order are
+// materialized on demand through the streaming scanner, so consumers that
+// need only the harmonic block never pay for the (much larger) anharmonic
+// sections.
+class FcsXml {
+public:
+    FcsXml() : file_opened(false) {};
+
+    explicit FcsXml(const std::string &file_in) : file_opened(false)
+    {
+        open(file_in);
+    }
+
+    // Parse the structure header of the given file. Returns false when the
+    // file cannot be read or is not an FCSXML document.
+    bool open(const std::string &file_in);
+
+    bool is_open() const
+    {
+        return file_opened;
+    }
+
+    const StructureProperty &get_structure() const
+    {
+        return structure;
+    }
+
+    // Materialize the force constants of one order: order = 0 loads the
+    // HARMONIC section, order = n (n >= 1) the ANHARM(n+2) section.
+    // Returns false when the file cannot be read or the section does not
+    // exist.
+    bool get_force_constants(const int order,
+                             std::vector<FcsArrayWithCell> &fc_out) const;
+
+private:
+    bool parse_structure(const std::string &header);
+
+    std::string filename;
+    StructureProperty structure;
+    bool file_opened;
+};
+
+// Compatibility wrapper around FcsXml that loads all orders eagerly and
+// exits on failure, like the original parser did.
+void load_fcs_xml(const std::string file_in,
+                  const int maxorder,
+                  StructureProperty &StructProp,
+                  std::vector<FcsArrayWithCell> *force_constant_with_cell);
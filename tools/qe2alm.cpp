@@ -11,10 +11,10 @@
 #include <iostream>
 #include <fstream>
 #include <stdlib.h>
-#include <boost/property_tree/xml_parser.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/version.hpp>
-#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
 #include "memory.h"
 #include "constants.h"
 #include "mathfunctions.h"
@@ -226,70 +226,79 @@ int main()
     get_pairs_of_minimum_distance(natmin, nat, map_p2s, xcrd_super, mindist);
 
     // Write to XML file
+    //
+    // The XML is streamed straight to the output file instead of being
+    // assembled in a property tree first: a tree node per force constant
+    // costs two orders of magnitude more memory than the value it holds,
+    // which made large supercells impossible to convert.
 
-    using boost::property_tree::ptree;
-
-    ptree pt;
-    string str_pos[3], str_tmp;
-
-    str_tmp.clear();
-
-    //    for (i = 0; i < 3; ++i) {
-    //        str_tmp += " " + std::to_string(nq[i]);
-    //    }
+    ofstream ofs_xml(file_xmlout.c_str(), std::ios::out);
 
+    if (!ofs_xml) {
+        cout << " ERROR: Cannot open file " << file_xmlout << endl;
+        exit(EXIT_FAILURE);
+    }
 
-    pt.put("Data.FilenameOfQE", file_fc2qe);
-    //    pt.put("Data.Qmesh", str_tmp);
+    std::vector<char> obuf(1048576);
+    ofs_xml.rdbuf()->pubsetbuf(&obuf[0], obuf.size());
 
-    pt.put("Data.Structure.NumberOfAtoms", nat);
-    pt.put("Data.Structure.NumberOfElements", nkd);
+    ofs_xml << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+    ofs_xml << "<Data>\n";
+    ofs_xml << "  <FilenameOfQE>" << xml_escape(file_fc2qe) << "</FilenameOfQE>\n";
+    ofs_xml << "  <Structure>\n";
+    ofs_xml << "    <NumberOfAtoms>" << nat << "</NumberOfAtoms>\n";
+    ofs_xml << "    <NumberOfElements>" << nkd << "</NumberOfElements>\n";
+    ofs_xml << "    <AtomicElements>\n";
 
     for (i = 0; i < nkd; ++i) {
-        ptree &child = pt.add("Data.Structure.AtomicElements.element", kd_symbol[i]);
-        child.put("<xmlattr>.number", i + 1);
+        ofs_xml << "      <element number=\"" << i + 1 << "\">"
+                << xml_escape(kd_symbol[i]) << "</element>\n";
     }
+    ofs_xml << "    </AtomicElements>\n";
 
+    ofs_xml << "    <LatticeVector>\n";
     for (i = 0; i < 3; ++i) {
-        str_pos[i].clear();
+        ofs_xml << "      <a" << i + 1 << ">";
         for (j = 0; j < 3; ++j) {
-            str_pos[i] += " " + double2string(lavec[j][i]);
+            ofs_xml << " " << double2string(lavec[j][i]);
         }
+        ofs_xml << "</a" << i + 1 << ">\n";
     }
-    pt.put("Data.Structure.LatticeVector", "");
-    pt.put("Data.Structure.LatticeVector.a1", str_pos[0]);
-    pt.put("Data.Structure.LatticeVector.a2", str_pos[1]);
-    pt.put("Data.Structure.LatticeVector.a3", str_pos[2]);
+    ofs_xml << "    </LatticeVector>\n";
 
-    pt.put("Data.Structure.Position", "");
+    ofs_xml << "    <Position>\n";
 
     icount = 0;
 
     for (i = 0; i < nsize; ++i) {
-
         for (j = 0; j < natmin; ++j) {
-            str_tmp.clear();
-            for (k = 0; k < 3; ++k) str_tmp += " " + double2string(xcrd_super[map_p2s[i][j]][k]);
-            ptree &child = pt.add("Data.Structure.Position.pos", str_tmp);
-            child.put("<xmlattr>.index", icount + 1);
-            child.put("<xmlattr>.element", kd_symbol[kd_super[i][j] - 1]);
+            ofs_xml << "      <pos index=\"" << icount + 1
+                    << "\" element=\"" << xml_escape(kd_symbol[kd_super[i][j] - 1]) << "\">";
+            for (k = 0; k < 3; ++k) {
+                ofs_xml << " " << double2string(xcrd_super[map_p2s[i][j]][k]);
+            }
+            ofs_xml << "</pos>\n";
 
             ++icount;
         }
     }
+    ofs_xml << "    </Position>\n";
+    ofs_xml << "  </Structure>\n";
 
-    pt.put("Data.Symmetry.NumberOfTranslations", nsize);
+    ofs_xml << "  <Symmetry>\n";
+    ofs_xml << "    <NumberOfTranslations>" << nsize << "</NumberOfTranslations>\n";
+    ofs_xml << "    <Translations>\n";
     for (i = 0; i < nsize; ++i) {
         for (j = 0; j < natmin; ++j) {
-            ptree &child = pt.add("Data.Symmetry.Translations.map", map_p2s[i][j] + 1);
-            child.put("<xmlattr>.tran", i + 1);
-            child.put("<xmlattr>.atom", j + 1);
+            ofs_xml << "      <map tran=\"" << i + 1 << "\" atom=\"" << j + 1 << "\">"
+                    << map_p2s[i][j] + 1 << "</map>\n";
         }
     }
+    ofs_xml << "    </Translations>\n";
+    ofs_xml << "  </Symmetry>\n";
 
-
-    pt.put("Data.ForceConstants", "");
-    str_tmp.clear();
+    ofs_xml << "  <ForceConstants>\n";
+    ofs_xml << "    <HARMONIC>\n";
 
     int nmulti, kat;
 
@@ -302,34 +311,28 @@ int main()
                     for (jcrd = 0; jcrd < 3; ++jcrd) {
                         if (std::abs(fc2[3 * iat + icrd][3 * jat + jcrd][icell]) < eps15) continue;
                         for (i = 0; i < nmulti; ++i) {
-                            ptree &child = pt.add("Data.ForceConstants.HARMONIC.FC2",
-                                                  double2string(fc2[3 * iat + icrd][3 * jat + jcrd][icell] /
-                                                                static_cast<double>(nmulti)));
-
-                            child.put("<xmlattr>.pair1", boost::lexical_cast<std::string>(iat + 1)
-                                                         + " " + boost::lexical_cast<std::string>(icrd + 1));
-                            child.put("<xmlattr>.pair2", boost::lexical_cast<std::string>(kat + 1)
-                                                         + " " + boost::lexical_cast<std::string>(jcrd + 1)
-                                                         + " " + boost::lexical_cast<std::string>(
-                                    mindist[iat][kat][i].cell + 1));
+                            ofs_xml << "      <FC2 pair1=\"" << iat + 1 << " " << icrd + 1
+                                    << "\" pair2=\"" << kat + 1 << " " << jcrd + 1
+                                    << " " << mindist[iat][kat][i].cell + 1 << "\">"
+                                    << double2string(fc2[3 * iat + icrd][3 * jat + jcrd][icell] /
+                                                     static_cast<double>(nmulti))
+                                    << "</FC2>\n";
                         }
                     }
                 }
             }
         }
     }
+    ofs_xml << "    </HARMONIC>\n";
+    ofs_xml << "  </ForceConstants>\n";
+    ofs_xml << "</Data>\n";
 
+    ofs_xml.close();
 
-    using namespace boost::property_tree::xml_parser;
-    const int indent = 2;
-
-#if BOOST_VERSION >= 105600
-    write_xml(file_xmlout, pt, std::locale(),
-              xml_writer_make_settings<ptree::key_type>(' ', indent, widen<std::string>("utf-8")));
-#else
-    write_xml(file_xmlout, pt, std::locale(),
-              xml_writer_make_settings(' ', indent, widen<char>("utf-8")));
-#endif
+    if (!ofs_xml) {
+        cout << " ERROR: Failed to write file " << file_xmlout << endl;
+        exit(EXIT_FAILURE);
+    }
 
 
     deallocate(kd);
@@ -713,6 +716,35 @@ string double2string(const double d)
 }
 
 
+string xml_escape(const std::string &str)
+{
+    std::string rt;
+
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+        switch (*it) {
+            case '&':
+                rt += "&amp;";
+                break;
+            case '<':
+                rt += "&lt;";
+                break;
+            case '>':
+                rt += "&gt;";
+                break;
+            case '"':
+                rt += "&quot;";
+                break;
+            case '\'':
+                rt += "&apos;";
+                break;
+            default:
+                rt += *it;
+        }
+    }
+    return rt;
+}
+
+
 void get_pairs_of_minimum_distance(const int natmin, const int nat, int **map_p2s,
                                    double **xf, std::vector<DistInfo> **mindist_pairs)
 {